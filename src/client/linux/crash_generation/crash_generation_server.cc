@@ -51,6 +51,19 @@
 
 static const char kCommandQuit = 'x';
 
+// Under DUMP_PERSIST_BATCH, sync queued dumps once this many have
+// accumulated, even if crash requests keep arriving.
+static const size_t kFsyncBatchSize = 16;
+
+// Rate-limit bucket units per dump token; see set_rate_limit(). With
+// 60 units per token, a dumps-per-minute refill rate lands on a whole
+// number of units per second.
+static const unsigned kTokenScale = 60;
+
+// The length of the regular payload of a crash request:
+static const unsigned kCrashContextSize =
+    sizeof(google_breakpad::ExceptionHandler::CrashContext);
+
 static bool
 GetInodeForFileDescriptor(ino_t* inode_out, int fd)
 {
@@ -161,8 +174,33 @@ FindProcessHoldingSocket(pid_t* pid_out, ino_t socket_inode)
   return already_found;
 }
 
+// Tell a crashing process its request has been handled, whether or not
+// a dump was written: it can exit now.
+static void
+SendCrashDumpDone(int signal_fd)
+{
+  struct msghdr msg = {0};
+  struct iovec done_iov;
+  done_iov.iov_base = const_cast<char*>("\x42");
+  done_iov.iov_len = 1;
+  msg.msg_iov = &done_iov;
+  msg.msg_iovlen = 1;
+
+  HANDLE_EINTR(sendmsg(signal_fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL));
+  HANDLE_EINTR(close(signal_fd));
+}
+
 namespace google_breakpad {
 
+// An accepted crash request waiting for a worker thread. The crash
+// context is copied out of the server thread's receive buffer so the
+// server can go back to accepting requests immediately.
+struct DumpJob {
+  pid_t crashing_pid;
+  int signal_fd;
+  char crash_context[kCrashContextSize];
+};
+
 CrashGenerationServer::CrashGenerationServer(
   const int listen_fd,
   OnClientDumpRequestCallback dump_callback,
@@ -177,18 +215,91 @@ CrashGenerationServer::CrashGenerationServer(
     exit_callback_(exit_callback),
     exit_context_(exit_context),
     generate_dumps_(generate_dumps),
-    started_(false)
+    started_(false),
+    worker_count_(0),
+    workers_shutdown_(false),
+    persistence_policy_(DUMP_PERSIST_NONE),
+    suppression_window_seconds_(0),
+    max_dumps_per_signature_(1),
+    rate_dumps_per_minute_(0),
+    rate_burst_size_(0),
+    rate_bucket_units_(0),
+    rate_last_refill_(0),
+    priority_callback_(NULL),
+    priority_context_(NULL)
 {
   if (dump_path)
     dump_dir_ = *dump_path;
   else
     dump_dir_ = "/tmp";
+
+  for (unsigned i = 0; i <= CRASH_PRIORITY_HIGH; ++i)
+    rate_dropped_counts_[i] = 0;
+
+  pthread_mutex_init(&queue_mutex_, NULL);
+  pthread_cond_init(&queue_cond_, NULL);
 }
 
 CrashGenerationServer::~CrashGenerationServer()
 {
   if (started_)
     Stop();
+
+  pthread_cond_destroy(&queue_cond_);
+  pthread_mutex_destroy(&queue_mutex_);
+}
+
+void
+CrashGenerationServer::set_worker_count(unsigned count)
+{
+  assert(!started_);
+  worker_count_ = count;
+}
+
+void
+CrashGenerationServer::set_persistence_policy(DumpPersistencePolicy policy)
+{
+  assert(!started_);
+  persistence_policy_ = policy;
+}
+
+void
+CrashGenerationServer::set_duplicate_suppression(
+    unsigned window_seconds,
+    unsigned max_dumps_per_signature)
+{
+  assert(!started_);
+  suppression_window_seconds_ = window_seconds;
+  max_dumps_per_signature_ = max_dumps_per_signature;
+}
+
+void
+CrashGenerationServer::set_rate_limit(unsigned dumps_per_minute,
+                                      unsigned burst_size)
+{
+  assert(!started_);
+  rate_dumps_per_minute_ = dumps_per_minute;
+  rate_burst_size_ = burst_size > 0 ? burst_size : 1;
+}
+
+void
+CrashGenerationServer::set_priority_callback(ClientPriorityCallback callback,
+                                             void* callback_context)
+{
+  assert(!started_);
+  priority_callback_ = callback;
+  priority_context_ = callback_context;
+}
+
+unsigned
+CrashGenerationServer::rate_limited_count(CrashPriority priority)
+{
+  assert(priority >= CRASH_PRIORITY_LOW && priority <= CRASH_PRIORITY_HIGH);
+
+  pthread_mutex_lock(&queue_mutex_);
+  const unsigned count = rate_dropped_counts_[priority];
+  pthread_mutex_unlock(&queue_mutex_);
+  return count;
 }
 
 bool
@@ -212,6 +323,20 @@ CrashGenerationServer::Start()
   control_pipe_in_ = control_pipe[0];
   control_pipe_out_ = control_pipe[1];
 
+  // The rate-limit bucket starts full, so a short burst right after
+  // startup is admitted and only a sustained storm is shed.
+  rate_bucket_units_ = static_cast<uint64_t>(rate_burst_size_) * kTokenScale;
+  rate_last_refill_ = time(NULL);
+
+  workers_shutdown_ = false;
+  for (unsigned i = 0; i < worker_count_; ++i) {
+    pthread_t worker;
+    if (pthread_create(&worker, NULL,
+                       WorkerThreadMain, reinterpret_cast<void*>(this)))
+      return false;
+    workers_.push_back(worker);
+  }
+
   if (pthread_create(&thread_, NULL,
                      ThreadMain, reinterpret_cast<void*>(this)))
     return false;
@@ -233,6 +358,25 @@ CrashGenerationServer::Stop()
   void* dummy;
   pthread_join(thread_, &dummy);
 
+  // Workers finish any queued requests before exiting, so clients that
+  // already reported their crash still get dumps.
+  pthread_mutex_lock(&queue_mutex_);
+  workers_shutdown_ = true;
+  pthread_cond_broadcast(&queue_cond_);
+  pthread_mutex_unlock(&queue_mutex_);
+
+  for (unsigned i = 0; i < workers_.size(); ++i)
+    pthread_join(workers_[i], &dummy);
+  workers_.clear();
+
+  // Sync any dumps still queued under DUMP_PERSIST_BATCH.
+  std::vector<int> to_sync;
+  pthread_mutex_lock(&queue_mutex_);
+  to_sync.swap(pending_sync_fds_);
+  pthread_mutex_unlock(&queue_mutex_);
+  if (!to_sync.empty())
+    SyncPendingDumps(&to_sync);
+
   started_ = false;
 }
 
@@ -308,9 +452,6 @@ CrashGenerationServer::ClientEvent(short revents)
   // The length of the control message:
   static const unsigned kControlMsgSize =
       CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(struct ucred));
-  // The length of the regular payload:
-  static const unsigned kCrashContextSize =
-      sizeof(google_breakpad::ExceptionHandler::CrashContext);
 
   struct msghdr msg = {0};
   struct iovec iov[1];
@@ -367,6 +508,17 @@ CrashGenerationServer::ClientEvent(short revents)
     return true;
   }
 
+  // Cheap early rejection under a crash storm: when rate limiting is
+  // on and the bucket has run dry, the client is released here, before
+  // the /proc-wide pid validation below and long before any ptrace
+  // work. The credentials pid is used to classify the client; it has
+  // not been validated yet, but a wrong class merely picks a different
+  // reserve tier.
+  if (!AdmitCrashRequest(crashing_pid)) {
+    SendCrashDumpDone(signal_fd);
+    return true;
+  }
+
   // Kernel bug workaround (broken in 2.6.30 at least):
   // The kernel doesn't translate PIDs in SCM_CREDENTIALS across PID
   // namespaces. Thus |crashing_pid| might be garbage from our point of view.
@@ -384,15 +536,72 @@ CrashGenerationServer::ClientEvent(short revents)
     return true;
   }
 
-  string minidump_filename;
-  if (!MakeMinidumpFilename(minidump_filename))
+  if (worker_count_ > 0) {
+    // Queue the request for the worker pool so this thread can get
+    // back to accepting crash reports; with many clients crashing at
+    // once, writing dumps serially here makes the later ones time out.
+    DumpJob* job = new DumpJob;
+    job->crashing_pid = crashing_pid;
+    job->signal_fd = signal_fd;
+    memcpy(job->crash_context, crash_context, kCrashContextSize);
+
+    pthread_mutex_lock(&queue_mutex_);
+    job_queue_.push_back(job);
+    pthread_cond_signal(&queue_cond_);
+    pthread_mutex_unlock(&queue_mutex_);
     return true;
+  }
 
-  if (!google_breakpad::WriteMinidump(minidump_filename.c_str(),
+  HandleDumpRequest(crashing_pid, signal_fd, crash_context);
+  return true;
+}
+
+void
+CrashGenerationServer::HandleDumpRequest(pid_t crashing_pid, int signal_fd,
+                                         const char* crash_context)
+{
+  // A crash already dumped enough times this window costs only a
+  // signature computation and a line in the repeat log; the crashing
+  // process is never stopped and no dump is written.
+  if (suppression_window_seconds_ > 0 &&
+      SuppressDuplicate(crashing_pid,
+                        ComputeCrashSignature(crashing_pid, crash_context))) {
+    SendCrashDumpDone(signal_fd);
+    return;
+  }
+
+  string minidump_filename;
+  pthread_mutex_lock(&queue_mutex_);
+  const bool have_filename = MakeMinidumpFilename(minidump_filename);
+  pthread_mutex_unlock(&queue_mutex_);
+  if (!have_filename) {
+    HANDLE_EINTR(close(signal_fd));
+    return;
+  }
+
+  // Under a persistence policy the dump is written to a temporary name
+  // and renamed into place by PersistDump(), so a half-written dump is
+  // never visible under a final name.
+  string write_filename = minidump_filename;
+  if (persistence_policy_ != DUMP_PERSIST_NONE)
+    write_filename += ".tmp";
+
+  // The server runs outside the crashing process, so the staged dump
+  // can be flushed through io_uring (where the kernel has it) instead
+  // of blocking this thread in synchronous writes during dump storms.
+  if (!google_breakpad::WriteMinidump(write_filename.c_str(),
                                       crashing_pid, crash_context,
-                                      kCrashContextSize)) {
+                                      kCrashContextSize,
+                                      true /* async_writes */)) {
     HANDLE_EINTR(close(signal_fd));
-    return true;
+    return;
+  }
+
+  if (persistence_policy_ != DUMP_PERSIST_NONE &&
+      !PersistDump(write_filename, minidump_filename)) {
+    unlink(write_filename.c_str());
+    HANDLE_EINTR(close(signal_fd));
+    return;
   }
 
   if (dump_callback_) {
@@ -401,20 +610,228 @@ CrashGenerationServer::ClientEvent(short revents)
     dump_callback_(dump_context_, &info, &minidump_filename);
   }
 
-  // Send the done signal to the process: it can exit now.
-  memset(&msg, 0, sizeof(msg));
-  struct iovec done_iov;
-  done_iov.iov_base = const_cast<char*>("\x42");
-  done_iov.iov_len = 1;
-  msg.msg_iov = &done_iov;
-  msg.msg_iovlen = 1;
+  SendCrashDumpDone(signal_fd);
+}
 
-  HANDLE_EINTR(sendmsg(signal_fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL));
-  HANDLE_EINTR(close(signal_fd));
+bool
+CrashGenerationServer::AdmitCrashRequest(pid_t crashing_pid)
+{
+  if (rate_dumps_per_minute_ == 0)
+    return true;
+
+  CrashPriority priority = CRASH_PRIORITY_NORMAL;
+  if (priority_callback_) {
+    priority = priority_callback_(priority_context_, crashing_pid);
+    if (priority < CRASH_PRIORITY_LOW || priority > CRASH_PRIORITY_HIGH)
+      priority = CRASH_PRIORITY_NORMAL;
+  }
+
+  const time_t now = time(NULL);
+  const uint64_t capacity_units =
+      static_cast<uint64_t>(rate_burst_size_) * kTokenScale;
+
+  // Reserve the bottom of the bucket for the more important classes:
+  // low priority cannot drain it below half capacity and normal below
+  // a quarter, so when everything is crashing at once the remaining
+  // I/O budget goes to the dumps that matter most.
+  uint64_t floor_units = 0;
+  if (priority == CRASH_PRIORITY_LOW)
+    floor_units = capacity_units / 2;
+  else if (priority == CRASH_PRIORITY_NORMAL)
+    floor_units = capacity_units / 4;
+
+  bool admit;
+  pthread_mutex_lock(&queue_mutex_);
+  if (now > rate_last_refill_) {
+    // One second adds dumps_per_minute units - 1/60th of a token each.
+    rate_bucket_units_ +=
+        static_cast<uint64_t>(now - rate_last_refill_) *
+        rate_dumps_per_minute_;
+    if (rate_bucket_units_ > capacity_units)
+      rate_bucket_units_ = capacity_units;
+    rate_last_refill_ = now;
+  }
+  if (rate_bucket_units_ >= floor_units + kTokenScale) {
+    rate_bucket_units_ -= kTokenScale;
+    admit = true;
+  } else {
+    ++rate_dropped_counts_[priority];
+    admit = false;
+  }
+  pthread_mutex_unlock(&queue_mutex_);
+
+  return admit;
+}
+
+uint64_t
+CrashGenerationServer::ComputeCrashSignature(pid_t crashing_pid,
+                                             const char* crash_context) const
+{
+  const ExceptionHandler::CrashContext* context =
+      reinterpret_cast<const ExceptionHandler::CrashContext*>(crash_context);
+
+  uint64_t ip = 0;
+#if defined(__i386)
+  ip = context->context.uc_mcontext.gregs[REG_EIP];
+#elif defined(__x86_64)
+  ip = context->context.uc_mcontext.gregs[REG_RIP];
+#elif defined(__ARM_EABI__)
+  ip = context->context.uc_mcontext.arm_pc;
+#endif
+
+  // Prefer the module-relative address: address space randomization
+  // moves the absolute faulting address between runs of the client,
+  // but every lap of one crash loop faults at the same offset into the
+  // same file. Reading the maps table does not disturb the client.
+  uint64_t offset = ip;
+  uint64_t module_hash = 0;
+  char maps_path[PATH_MAX];
+  snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps",
+           static_cast<int>(crashing_pid));
+  FILE* maps = fopen(maps_path, "r");
+  if (maps) {
+    char line[512];
+    while (fgets(line, sizeof(line), maps)) {
+      unsigned long long start, end, file_offset;
+      int path_index = 0;
+      if (sscanf(line, "%llx-%llx %*4s %llx %*x:%*x %*d %n",
+                 &start, &end, &file_offset, &path_index) != 3 ||
+          path_index == 0)
+        continue;
+      if (ip < start || ip >= end)
+        continue;
+      offset = ip - start + file_offset;
+      for (const char* path = line + path_index; *path && *path != '\n';
+           ++path) {
+        module_hash = module_hash * 131 + static_cast<unsigned char>(*path);
+      }
+      break;
+    }
+    fclose(maps);
+  }
+
+  uint64_t signature = static_cast<uint64_t>(context->siginfo.si_signo);
+  signature = signature * 0x9E3779B97F4A7C15ULL ^ offset;
+  signature = signature * 0x9E3779B97F4A7C15ULL ^ module_hash;
+  return signature;
+}
+
+bool
+CrashGenerationServer::SuppressDuplicate(pid_t crashing_pid,
+                                         uint64_t signature)
+{
+  const time_t now = time(NULL);
+
+  pthread_mutex_lock(&queue_mutex_);
+  SignatureRecord& record = signature_records_[signature];
+  if (record.dumps_written == 0 ||
+      now - record.window_start >=
+          static_cast<time_t>(suppression_window_seconds_)) {
+    record.window_start = now;
+    record.dumps_written = 0;
+    record.suppressed = 0;
+  }
+  bool suppress;
+  unsigned repeat_count = 0;
+  if (record.dumps_written < max_dumps_per_signature_) {
+    ++record.dumps_written;
+    suppress = false;
+  } else {
+    repeat_count = ++record.suppressed;
+    suppress = true;
+  }
+  pthread_mutex_unlock(&queue_mutex_);
+
+  if (!suppress)
+    return false;
+
+  // Leave a tiny record of the repeat in place of a full dump.
+  char log_path[PATH_MAX];
+  snprintf(log_path, sizeof(log_path), "%s/suppressed-crashes.log",
+           dump_dir_.c_str());
+  const int fd =
+      HANDLE_EINTR(open(log_path, O_WRONLY | O_CREAT | O_APPEND, 0600));
+  if (fd >= 0) {
+    char line[128];
+    const int length = snprintf(line, sizeof(line),
+                                "%lld pid %d signature %016llx repeat %u\n",
+                                static_cast<long long>(now),
+                                static_cast<int>(crashing_pid),
+                                static_cast<unsigned long long>(signature),
+                                repeat_count);
+    if (length > 0)
+      HANDLE_EINTR(write(fd, line, length));
+    HANDLE_EINTR(close(fd));
+  }
+  return true;
+}
+
+bool
+CrashGenerationServer::PersistDump(const string& temp_filename,
+                                   const string& filename)
+{
+  const int fd = HANDLE_EINTR(open(temp_filename.c_str(), O_RDONLY));
+  if (fd < 0)
+    return false;
+
+  if (persistence_policy_ == DUMP_PERSIST_ALWAYS) {
+    // The dump's data must be stable before the rename makes it
+    // visible under its final name.
+    if (fsync(fd)) {
+      HANDLE_EINTR(close(fd));
+      return false;
+    }
+  }
+
+  if (rename(temp_filename.c_str(), filename.c_str())) {
+    HANDLE_EINTR(close(fd));
+    return false;
+  }
+
+  if (persistence_policy_ == DUMP_PERSIST_ALWAYS) {
+    HANDLE_EINTR(close(fd));
+    SyncDumpDirectory();
+    return true;
+  }
 
+  // DUMP_PERSIST_BATCH: keep the dump open and sync a whole batch at
+  // once, when the crash requests stop arriving or enough dumps have
+  // piled up. During a crash storm this costs one directory sync and
+  // one burst of file syncs per batch instead of a stall per dump.
+  std::vector<int> to_sync;
+  pthread_mutex_lock(&queue_mutex_);
+  pending_sync_fds_.push_back(fd);
+  if (job_queue_.empty() || pending_sync_fds_.size() >= kFsyncBatchSize)
+    to_sync.swap(pending_sync_fds_);
+  pthread_mutex_unlock(&queue_mutex_);
+
+  if (!to_sync.empty())
+    SyncPendingDumps(&to_sync);
   return true;
 }
 
+void
+CrashGenerationServer::SyncDumpDirectory()
+{
+  const int dir_fd =
+      HANDLE_EINTR(open(dump_dir_.c_str(), O_RDONLY | O_DIRECTORY));
+  if (dir_fd < 0)
+    return;
+  fsync(dir_fd);
+  HANDLE_EINTR(close(dir_fd));
+}
+
+void
+CrashGenerationServer::SyncPendingDumps(std::vector<int>* fds)
+{
+  for (size_t i = 0; i < fds->size(); ++i) {
+    fsync((*fds)[i]);
+    HANDLE_EINTR(close((*fds)[i]));
+  }
+  fds->clear();
+  SyncDumpDirectory();
+}
+
 bool
 CrashGenerationServer::ControlEvent(short revents)
 {
@@ -461,4 +878,36 @@ CrashGenerationServer::ThreadMain(void *arg)
   return NULL;
 }
 
+void
+CrashGenerationServer::WorkerMain()
+{
+  while (true) {
+    pthread_mutex_lock(&queue_mutex_);
+    while (job_queue_.empty() && !workers_shutdown_)
+      pthread_cond_wait(&queue_cond_, &queue_mutex_);
+
+    if (job_queue_.empty()) {
+      // Shutdown was requested and the queue is drained.
+      pthread_mutex_unlock(&queue_mutex_);
+      return;
+    }
+
+    DumpJob* job = job_queue_.front();
+    job_queue_.pop_front();
+    pthread_mutex_unlock(&queue_mutex_);
+
+    HandleDumpRequest(job->crashing_pid, job->signal_fd,
+                      job->crash_context);
+    delete job;
+  }
+}
+
+// static
+void*
+CrashGenerationServer::WorkerThreadMain(void *arg)
+{
+  reinterpret_cast<CrashGenerationServer*>(arg)->WorkerMain();
+  return NULL;
+}
+
 }  // namespace google_breakpad
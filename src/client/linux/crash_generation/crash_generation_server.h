@@ -31,14 +31,20 @@
 #define CLIENT_LINUX_CRASH_GENERATION_CRASH_GENERATION_SERVER_H_
 
 #include <pthread.h>
+#include <stdint.h>
+#include <time.h>
 
+#include <list>
+#include <map>
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 
 namespace google_breakpad {
 
 class ClientInfo;
+struct DumpJob;
 
 class CrashGenerationServer {
 public:
@@ -52,6 +58,48 @@ public:
   typedef void (*OnClientExitingCallback)(void* context,
                                           const ClientInfo* client_info);
 
+  // Priority classes for crash rate limiting; see set_rate_limit().
+  // Higher classes may draw the bucket further down, so the dumps
+  // that matter most keep being written when the box is melting down.
+  enum CrashPriority {
+    CRASH_PRIORITY_LOW = 0,
+    CRASH_PRIORITY_NORMAL = 1,
+    CRASH_PRIORITY_HIGH = 2
+  };
+
+  // Returns the rate-limiting priority class for a crashing client.
+  // WARNING: may be invoked on the server thread while other requests
+  // wait, so it must be cheap and thread safe.
+  typedef CrashPriority (*ClientPriorityCallback)(void* context,
+                                                  pid_t crashing_pid);
+
+  // How thoroughly a finished dump is pushed to stable storage before
+  // the client is released and the dump callback runs.
+  enum DumpPersistencePolicy {
+    // Write the dump with ordinary buffered I/O and leave it in the
+    // page cache; the kernel writes it back on its own schedule. The
+    // cheapest option, but a machine reset shortly after the crash can
+    // lose the dump. This is the default.
+    DUMP_PERSIST_NONE,
+
+    // Write the dump under a temporary name and rename it into place,
+    // deferring the fsync: files are queued and synced together - along
+    // with a single sync of the dump directory - once the queue of
+    // crash requests drains or enough dumps accumulate. Under a crash
+    // storm the sync cost is amortized over the batch instead of
+    // stalling the server once per dump; a reset can lose only the
+    // dumps of the batch still being written back.
+    DUMP_PERSIST_BATCH,
+
+    // Write the dump under a temporary name, fsync it, rename it into
+    // place and fsync the dump directory before releasing the client.
+    // A complete dump is on stable storage - and a half-written one is
+    // never visible under its final name - by the time the callback
+    // runs, at the cost of a sync per dump. For deployments whose dumps
+    // must survive an immediate machine reset.
+    DUMP_PERSIST_ALWAYS
+  };
+
   // Create an instance with the given parameters.
   //
   // Parameter listen_fd: The server fd created by CreateReportChannel().
@@ -83,6 +131,63 @@ public:
   // Stop the server.
   void Stop();
 
+  // Hand accepted crash requests to a pool of |count| worker threads
+  // instead of writing dumps one at a time on the server thread. Each
+  // worker writes its dump independently (WriteMinidump attaches its
+  // own ptrace dumper to the crashing process), so up to |count| dumps
+  // proceed in parallel when many clients crash at once. Must be
+  // called before Start(); 0 (the default) keeps the single-threaded
+  // behavior. Remember that the dump callback may then fire on any of
+  // the worker threads concurrently.
+  void set_worker_count(unsigned count);
+
+  // Choose how dumps are persisted; see DumpPersistencePolicy. Must be
+  // called before Start().
+  void set_persistence_policy(DumpPersistencePolicy policy);
+
+  // Suppress repeated dumps of one crash. When |window_seconds| is
+  // non-zero, each crash request is first reduced to a cheap signature
+  // - the signal number and the module-relative faulting instruction
+  // pointer, read from the crash context the client already sent -
+  // without touching the crashing process. Once
+  // |max_dumps_per_signature| dumps have been written for a signature
+  // within a window, further requests with that signature skip the
+  // stop-the-world dump entirely: a one-line repeat record is appended
+  // to <dump path>/suppressed-crashes.log and the client is released.
+  // A crash-looping process then costs |max_dumps_per_signature| dumps
+  // per window instead of one per crash. The dump callback is not
+  // invoked for suppressed requests. Must be called before Start();
+  // a |window_seconds| of 0 (the default) disables suppression.
+  void set_duplicate_suppression(unsigned window_seconds,
+                                 unsigned max_dumps_per_signature);
+
+  // Bound the rate of dump generation, distinct from duplicate
+  // suppression: during a cascading failure many different crashes
+  // arrive at once, and writing every dump starves the healthy
+  // processes sharing the box of I/O. Admission is a token bucket
+  // holding up to |burst_size| dumps and refilling at
+  // |dumps_per_minute|; a request that finds the bucket empty is
+  // rejected before the pid validation and the stop-the-world dump
+  // work - the client is released immediately and the dump callback
+  // is not invoked. The lower half of the bucket is reserved for
+  // CRASH_PRIORITY_NORMAL and above and the lower quarter for
+  // CRASH_PRIORITY_HIGH, so a flood of low-priority crashes cannot
+  // starve the processes that matter; classes are assigned by the
+  // callback given to set_priority_callback(). Must be called before
+  // Start(); a |dumps_per_minute| of 0 (the default) disables rate
+  // limiting.
+  void set_rate_limit(unsigned dumps_per_minute, unsigned burst_size);
+
+  // Assign rate-limiting priority classes to clients; see
+  // set_rate_limit(). Without a callback every client is
+  // CRASH_PRIORITY_NORMAL. Must be called before Start().
+  void set_priority_callback(ClientPriorityCallback callback,
+                             void* callback_context);
+
+  // Number of crash requests dropped by the rate limiter for the
+  // given priority class since Start().
+  unsigned rate_limited_count(CrashPriority priority);
+
   // Create a "channel" that can be used by clients to report crashes
   // to a CrashGenerationServer.  |*server_fd| should be passed to
   // this class's constructor, and |*client_fd| should be passed to
@@ -101,12 +206,53 @@ private:
   // Returning true => "keep running", false => "exit loop"
   bool ControlEvent(short revents);
 
+  // Write the dump for one accepted crash request, invoke the dump
+  // callback and release the client. Runs on the server thread, or on
+  // a worker thread when a pool is configured.
+  void HandleDumpRequest(pid_t crashing_pid, int signal_fd,
+                         const char* crash_context);
+
   // Return a unique filename at which a minidump can be written
   bool MakeMinidumpFilename(string& outFilename);
 
+  // Apply |persistence_policy_| to a dump just written at
+  // |temp_filename|, renaming it to |filename|. Returns false if the
+  // dump could not be made visible under its final name.
+  bool PersistDump(const string& temp_filename, const string& filename);
+
+  // Sync the dump directory itself, so renames of freshly written
+  // dumps survive a reset.
+  void SyncDumpDirectory();
+
+  // fsync, close and forget the dumps queued under DUMP_PERSIST_BATCH,
+  // followed by one sync of the dump directory. |fds| is consumed.
+  void SyncPendingDumps(std::vector<int>* fds);
+
+  // Reduce one crash request to its signature; see
+  // set_duplicate_suppression().
+  uint64_t ComputeCrashSignature(pid_t crashing_pid,
+                                 const char* crash_context) const;
+
+  // Return true if the crash request from |crashing_pid| may proceed,
+  // drawing one token from the rate-limit bucket; false if it must be
+  // dropped. See set_rate_limit().
+  bool AdmitCrashRequest(pid_t crashing_pid);
+
+  // Return true if the dump for |signature| should be suppressed,
+  // updating the signature's window accounting and, when suppressing,
+  // appending its repeat record.
+  bool SuppressDuplicate(pid_t crashing_pid, uint64_t signature);
+
   // Trampoline to |Run()|
   static void* ThreadMain(void* arg);
 
+  // Worker-pool loop: pop queued dump requests and handle them until
+  // told to shut down and the queue is drained.
+  void WorkerMain();
+
+  // Trampoline to |WorkerMain()|
+  static void* WorkerThreadMain(void* arg);
+
   int server_fd_;
 
   OnClientDumpRequestCallback dump_callback_;
@@ -125,6 +271,45 @@ private:
   int control_pipe_in_;
   int control_pipe_out_;
 
+  // Worker pool state. |queue_mutex_| also serializes minidump
+  // filename generation, which is not thread safe on its own.
+  unsigned worker_count_;
+  std::vector<pthread_t> workers_;
+  std::list<DumpJob*> job_queue_;
+  bool workers_shutdown_;
+  pthread_mutex_t queue_mutex_;
+  pthread_cond_t queue_cond_;
+
+  // See set_persistence_policy().
+  DumpPersistencePolicy persistence_policy_;
+
+  // Dumps written but not yet fsynced under DUMP_PERSIST_BATCH, held
+  // open by descriptor. Guarded by |queue_mutex_|.
+  std::vector<int> pending_sync_fds_;
+
+  // Per-signature accounting for duplicate suppression; see
+  // set_duplicate_suppression(). Guarded by |queue_mutex_|.
+  struct SignatureRecord {
+    time_t window_start;
+    unsigned dumps_written;
+    unsigned suppressed;
+  };
+  unsigned suppression_window_seconds_;
+  unsigned max_dumps_per_signature_;
+  std::map<uint64_t, SignatureRecord> signature_records_;
+
+  // Token-bucket rate limiting; see set_rate_limit(). The bucket is
+  // kept in units of 1/60th of a token so per-minute refill rates
+  // divide evenly into one-second refill steps. Bucket state and the
+  // drop counters are guarded by |queue_mutex_|.
+  unsigned rate_dumps_per_minute_;
+  unsigned rate_burst_size_;
+  uint64_t rate_bucket_units_;
+  time_t rate_last_refill_;
+  ClientPriorityCallback priority_callback_;
+  void* priority_context_;
+  unsigned rate_dropped_counts_[CRASH_PRIORITY_HIGH + 1];
+
   // disable these
   CrashGenerationServer(const CrashGenerationServer&);
   CrashGenerationServer& operator=(const CrashGenerationServer&);
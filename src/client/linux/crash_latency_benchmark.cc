@@ -0,0 +1,317 @@
+// Copyright (c) 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// crash_latency_benchmark.cc: Measure crash-to-dump latency of the
+// Linux ExceptionHandler.
+//
+// This harness forks victim processes that install an ExceptionHandler
+// and then crash, sweeping thread count, thread stack size and the
+// number of extra memory mappings, and reports the distribution of the
+// time from the faulting instruction to dump completion.  Each victim
+// reads a monotonic clock immediately before crashing and again in the
+// minidump callback - which the handler invokes after the dump is
+// written - and reports the difference to the parent over a pipe, so
+// the measurement covers the whole signal-handler path: thread
+// suspension, /proc collection and minidump serialization.  Changes to
+// the client's crash path (ptrace batching, /proc snapshotting) can be
+// proven against these numbers.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "client/linux/handler/exception_handler.h"
+#include "client/linux/handler/minidump_descriptor.h"
+#include "common/using_std_string.h"
+
+namespace {
+
+using std::vector;
+using google_breakpad::ExceptionHandler;
+using google_breakpad::MinidumpDescriptor;
+
+// One point in the parameter sweep.
+struct BenchmarkConfig {
+  unsigned int thread_count;   // threads alive in the victim, besides main
+  unsigned int stack_kb;       // stack size of each of those threads
+  unsigned int mapping_count;  // extra anonymous mappings in the victim
+};
+
+// The default corpus, from a process smaller than anything seen in
+// production up to one larger than the common case in every dimension.
+const BenchmarkConfig kDefaultCorpus[] = {
+  {   1,  64,   16 },
+  {   8, 128,   64 },
+  {  32, 256,  256 },
+  { 128, 512, 1024 },
+};
+
+// The size of each extra mapping in the victim.
+const size_t kMappingSize = 16 * 1024;
+
+static uint64_t NowNanoseconds() {
+  struct timespec time_now;
+  clock_gettime(CLOCK_MONOTONIC, &time_now);
+  return static_cast<uint64_t>(time_now.tv_sec) * 1000000000 +
+      time_now.tv_nsec;
+}
+
+// State shared between the victim's crashing thread and its minidump
+// callback.
+struct VictimState {
+  uint64_t crash_time_ns;  // read just before the faulting instruction
+  int result_fd;           // pipe to the parent
+};
+
+// Runs in the victim's signal handler context after the dump has been
+// written. Reports the latency to the parent; clock_gettime and write
+// are both async-signal-safe.
+static bool DumpCallback(const MinidumpDescriptor& descriptor,
+                         void* context,
+                         bool succeeded) {
+  VictimState* state = static_cast<VictimState*>(context);
+  if (succeeded) {
+    uint64_t latency_ns = NowNanoseconds() - state->crash_time_ns;
+    if (write(state->result_fd, &latency_ns, sizeof(latency_ns)) !=
+        sizeof(latency_ns)) {
+      succeeded = false;
+    }
+  }
+  return succeeded;
+}
+
+// The victim's extra threads park here until the crash; the dumper
+// suspends and walks them along with the crashing thread.
+static void* VictimThread(void* data) {
+  int ready_fd = *static_cast<int*>(data);
+  uint8_t byte = 1;
+  if (write(ready_fd, &byte, sizeof(byte)) != sizeof(byte)) {
+    perror("crash_latency_benchmark: thread notification failed");
+    _exit(1);
+  }
+  struct timespec delay = { 0, 100 * 1000 * 1000 };
+  while (true)
+    nanosleep(&delay, NULL);
+  return NULL;
+}
+
+// Body of a forked victim: build the configured process shape, install
+// the handler, and crash. Reports the latency on result_fd via the
+// minidump callback; on any setup failure, exits without reporting and
+// the parent counts the iteration as failed. Never returns.
+static void RunVictim(const BenchmarkConfig& config,
+                      const string& dump_directory,
+                      int result_fd) {
+  // Give the dumper's /proc/<pid>/maps pass the configured number of
+  // extra lines. The mappings stay mapped until the crash.
+  for (unsigned int mapping = 0; mapping < config.mapping_count; ++mapping) {
+    void* address = mmap(NULL, kMappingSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED)
+      _exit(1);
+    *static_cast<uint8_t*>(address) = 1;
+  }
+
+  int ready_fds[2];
+  if (pipe(ready_fds) != 0)
+    _exit(1);
+
+  size_t stack_size = config.stack_kb * 1024;
+  if (stack_size < PTHREAD_STACK_MIN)
+    stack_size = PTHREAD_STACK_MIN;
+  pthread_attr_t attributes;
+  if (pthread_attr_init(&attributes) != 0 ||
+      pthread_attr_setstacksize(&attributes, stack_size) != 0)
+    _exit(1);
+  for (unsigned int thread = 0; thread < config.thread_count; ++thread) {
+    pthread_t handle;
+    if (pthread_create(&handle, &attributes, VictimThread,
+                       &ready_fds[1]) != 0)
+      _exit(1);
+  }
+  // Wait for every thread to be running before crashing.
+  for (unsigned int thread = 0; thread < config.thread_count; ++thread) {
+    uint8_t byte;
+    if (read(ready_fds[0], &byte, sizeof(byte)) != sizeof(byte))
+      _exit(1);
+  }
+
+  VictimState state;
+  state.result_fd = result_fd;
+  ExceptionHandler handler(MinidumpDescriptor(dump_directory), NULL,
+                           DumpCallback, &state, true, -1);
+
+  state.crash_time_ns = NowNanoseconds();
+  *reinterpret_cast<volatile int*>(NULL) = 42;
+  _exit(1);  // not reached
+}
+
+// Remove the files a victim left in dump_directory, returning the size
+// of the last one seen, so the report can cite the dump size.
+static uint64_t CleanDumpDirectory(const string& dump_directory) {
+  uint64_t dump_size = 0;
+  DIR* directory = opendir(dump_directory.c_str());
+  if (!directory)
+    return 0;
+  struct dirent* entry;
+  while ((entry = readdir(directory)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+    string path = dump_directory + "/" + entry->d_name;
+    struct stat status;
+    if (stat(path.c_str(), &status) == 0)
+      dump_size = status.st_size;
+    unlink(path.c_str());
+  }
+  closedir(directory);
+  return dump_size;
+}
+
+// Crashes iteration_count victims with the given configuration and
+// prints one result line. Returns false if any victim fails to produce
+// a dump and report its latency.
+static bool RunConfiguration(const BenchmarkConfig& config,
+                             const string& dump_directory,
+                             unsigned int iteration_count) {
+  vector<uint64_t> latencies_us;
+  latencies_us.reserve(iteration_count);
+  uint64_t dump_size = 0;
+
+  for (unsigned int iteration = 0; iteration < iteration_count; ++iteration) {
+    int result_fds[2];
+    if (pipe(result_fds) != 0) {
+      perror("crash_latency_benchmark: pipe");
+      return false;
+    }
+    pid_t victim = fork();
+    if (victim < 0) {
+      perror("crash_latency_benchmark: fork");
+      return false;
+    }
+    if (victim == 0) {
+      close(result_fds[0]);
+      RunVictim(config, dump_directory, result_fds[1]);
+    }
+    close(result_fds[1]);
+
+    uint64_t latency_ns;
+    ssize_t bytes_read = read(result_fds[0], &latency_ns, sizeof(latency_ns));
+    close(result_fds[0]);
+    int victim_status;
+    waitpid(victim, &victim_status, 0);
+    dump_size = CleanDumpDirectory(dump_directory);
+    if (bytes_read != sizeof(latency_ns)) {
+      fprintf(stderr, "crash_latency_benchmark: victim produced no dump "
+              "(threads=%u stack_kb=%u mappings=%u)\n",
+              config.thread_count, config.stack_kb, config.mapping_count);
+      return false;
+    }
+    latencies_us.push_back(latency_ns / 1000);
+  }
+
+  std::sort(latencies_us.begin(), latencies_us.end());
+  uint64_t total_us = 0;
+  for (size_t index = 0; index < latencies_us.size(); ++index)
+    total_us += latencies_us[index];
+  uint64_t mean_us = total_us / latencies_us.size();
+  uint64_t p50_us = latencies_us[latencies_us.size() / 2];
+  uint64_t p99_us = latencies_us[latencies_us.size() * 99 / 100];
+  uint64_t max_us = latencies_us[latencies_us.size() - 1];
+
+  printf("threads=%-4u stack_kb=%-4u mappings=%-5u dump_kb=%-6" PRIu64
+         " mean %8" PRIu64 " us  p50 %8" PRIu64 " us  p99 %8" PRIu64
+         " us  max %8" PRIu64 " us\n",
+         config.thread_count, config.stack_kb, config.mapping_count,
+         dump_size / 1024, mean_us, p50_us, p99_us, max_us);
+  return true;
+}
+
+static void usage(const char* program_name) {
+  fprintf(stderr, "usage: %s [-i iterations]\n"
+          "    -i  crashes per configuration (default 20)\n",
+          program_name);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned int iteration_count = 20;
+
+  int argument_index = 1;
+  while (argument_index < argc) {
+    if (strcmp(argv[argument_index], "-i") == 0 &&
+        argument_index + 1 < argc) {
+      iteration_count = atoi(argv[++argument_index]);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+    ++argument_index;
+  }
+  if (iteration_count == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  char dump_directory[] = "/tmp/crash_latency_benchmark_XXXXXX";
+  if (!mkdtemp(dump_directory)) {
+    perror("crash_latency_benchmark: mkdtemp");
+    return 1;
+  }
+
+  bool ok = true;
+  size_t config_count = sizeof(kDefaultCorpus) / sizeof(kDefaultCorpus[0]);
+  for (size_t config_index = 0; config_index < config_count; ++config_index) {
+    if (!RunConfiguration(kDefaultCorpus[config_index], dump_directory,
+                          iteration_count)) {
+      ok = false;
+      break;
+    }
+  }
+
+  CleanDumpDirectory(dump_directory);
+  rmdir(dump_directory);
+  return ok ? 0 : 1;
+}
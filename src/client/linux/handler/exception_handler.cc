@@ -90,6 +90,7 @@
 #include "common/memory.h"
 #include "client/linux/log/log.h"
 #include "client/linux/minidump_writer/linux_dumper.h"
+#include "client/linux/minidump_writer/linux_ptrace_dumper.h"
 #include "client/linux/minidump_writer/minidump_writer.h"
 #include "common/linux/eintr_wrapper.h"
 #include "third_party/lss/linux_syscall_support.h"
@@ -187,10 +188,32 @@ void RestoreAlternateStackLocked() {
 
 // We can stack multiple exception handlers. In that case, this is the global
 // which holds the stack.
-std::vector<ExceptionHandler*>* ExceptionHandler::handler_stack_ = NULL;
+ExceptionHandler::HandlerStack* volatile
+    ExceptionHandler::handler_stack_ = NULL;
 pthread_mutex_t ExceptionHandler::handler_stack_mutex_ =
     PTHREAD_MUTEX_INITIALIZER;
 
+namespace {
+
+// Number of threads currently dispatching a signal through
+// handler_stack_. Incremented before the snapshot pointer is loaded
+// and decremented when dispatch is done, so a writer that has swapped
+// in a new snapshot knows the old one is unreferenced once this
+// reaches zero.
+volatile int handler_dispatch_count = 0;
+
+// Waits until every dispatch that might hold the snapshot current
+// before the caller's swap has drained. The __sync operation is a full
+// barrier, pairing with the increments in SignalHandler. Runs in
+// normal context, under handler_stack_mutex_; dispatches that start
+// after the swap read the new snapshot and are of no concern.
+void WaitForDispatchDrain() {
+  while (__sync_fetch_and_add(&handler_dispatch_count, 0) != 0)
+    sched_yield();
+}
+
+}  // namespace
+
 // Runs before crashing: normal context.
 ExceptionHandler::ExceptionHandler(const MinidumpDescriptor& descriptor,
                                    FilterCallback filter,
@@ -202,7 +225,16 @@ ExceptionHandler::ExceptionHandler(const MinidumpDescriptor& descriptor,
       callback_(callback),
       callback_context_(callback_context),
       minidump_descriptor_(descriptor),
-      crash_handler_(NULL) {
+      crash_handler_(NULL),
+      standby_pid_(-1),
+      current_snapshot_(NULL),
+      mapping_filter_(NULL),
+      mapping_filter_context_(NULL) {
+  standby_request_fd_[0] = standby_request_fd_[1] = -1;
+  standby_status_fd_[0] = standby_status_fd_[1] = -1;
+  my_memset(snapshot_slots_, 0, sizeof(snapshot_slots_));
+  snapshot_thread_capacity_[0] = snapshot_thread_capacity_[1] = 0;
+  snapshot_mapping_capacity_[0] = snapshot_mapping_capacity_[1] = 0;
   if (server_fd >= 0)
     crash_generation_client_.reset(CrashGenerationClient::TryCreate(server_fd));
 
@@ -210,23 +242,59 @@ ExceptionHandler::ExceptionHandler(const MinidumpDescriptor& descriptor,
     minidump_descriptor_.UpdatePath();
 
   pthread_mutex_lock(&handler_stack_mutex_);
-  if (!handler_stack_)
-    handler_stack_ = new std::vector<ExceptionHandler*>;
   if (install_handler) {
     InstallAlternateStackLocked();
     InstallHandlersLocked();
   }
-  handler_stack_->push_back(this);
+  // Copy-on-write registration: the published snapshot is never
+  // mutated, so a concurrently crashing thread dispatches from either
+  // the old stack or the new one, both complete.
+  HandlerStack* const current = handler_stack_;
+  const size_t count = current ? current->count : 0;
+  HandlerStack* const updated = new HandlerStack;
+  updated->handlers = new ExceptionHandler*[count + 1];
+  for (size_t index = 0; index < count; ++index)
+    updated->handlers[index] = current->handlers[index];
+  updated->handlers[count] = this;
+  updated->count = count + 1;
+  __sync_synchronize();
+  handler_stack_ = updated;
+  if (current) {
+    WaitForDispatchDrain();
+    delete[] current->handlers;
+    delete current;
+  }
   pthread_mutex_unlock(&handler_stack_mutex_);
 }
 
 // Runs before crashing: normal context.
 ExceptionHandler::~ExceptionHandler() {
+  StopStandbyDumper();
+  for (int i = 0; i < 2; ++i) {
+    delete[] snapshot_slots_[i].threads;
+    delete[] snapshot_slots_[i].mappings;
+  }
   pthread_mutex_lock(&handler_stack_mutex_);
-  std::vector<ExceptionHandler*>::iterator handler =
-      std::find(handler_stack_->begin(), handler_stack_->end(), this);
-  handler_stack_->erase(handler);
-  if (handler_stack_->empty()) {
+  HandlerStack* const current = handler_stack_;
+  HandlerStack* updated = NULL;
+  if (current->count > 1) {
+    updated = new HandlerStack;
+    updated->handlers = new ExceptionHandler*[current->count - 1];
+    size_t kept = 0;
+    for (size_t index = 0; index < current->count; ++index) {
+      if (current->handlers[index] != this)
+        updated->handlers[kept++] = current->handlers[index];
+    }
+    updated->count = kept;
+  }
+  __sync_synchronize();
+  handler_stack_ = updated;
+  // The drain also guarantees no crashing thread still holds a
+  // snapshot referencing this handler, so destruction may proceed.
+  WaitForDispatchDrain();
+  delete[] current->handlers;
+  delete current;
+  if (!updated) {
     RestoreAlternateStackLocked();
     RestoreHandlersLocked();
   }
@@ -289,8 +357,13 @@ void ExceptionHandler::RestoreHandlersLocked() {
 // Runs on the crashing thread.
 // static
 void ExceptionHandler::SignalHandler(int sig, siginfo_t* info, void* uc) {
-  // All the exception signals are blocked at this point.
-  pthread_mutex_lock(&handler_stack_mutex_);
+  // All the exception signals are blocked at this point. Dispatch is
+  // wait-free: no lock is taken, so a crash while another thread is
+  // registering a handler (and holding the writers' mutex) can no
+  // longer deadlock. The count increment tells writers a dispatch is
+  // in flight, and is a full barrier, ordering it before the snapshot
+  // load below.
+  __sync_fetch_and_add(&handler_dispatch_count, 1);
 
   // Sometimes, Breakpad runs inside a process where some other buggy code
   // saves and restores signal handlers temporarily with 'signal'
@@ -317,13 +390,17 @@ void ExceptionHandler::SignalHandler(int sig, siginfo_t* info, void* uc) {
       // default one to avoid an infinite loop here.
       signal(sig, SIG_DFL);
     }
-    pthread_mutex_unlock(&handler_stack_mutex_);
+    __sync_fetch_and_sub(&handler_dispatch_count, 1);
     return;
   }
 
+  // The loaded snapshot is immutable and - thanks to the dispatch
+  // count - stays alive until this loop is done, even if handlers are
+  // registered or destroyed concurrently.
+  HandlerStack* const stack = handler_stack_;
   bool handled = false;
-  for (int i = handler_stack_->size() - 1; !handled && i >= 0; --i) {
-    handled = (*handler_stack_)[i]->HandleSignal(sig, info, uc);
+  for (size_t i = stack ? stack->count : 0; !handled && i > 0; --i) {
+    handled = stack->handlers[i - 1]->HandleSignal(sig, info, uc);
   }
 
   // Upon returning from this signal handler, sig will become unmasked and then
@@ -334,10 +411,13 @@ void ExceptionHandler::SignalHandler(int sig, siginfo_t* info, void* uc) {
   if (handled) {
     signal(sig, SIG_DFL);
   } else {
+    // Best effort without the writers' mutex: the process is crashing,
+    // and the sigaction calls here are safe against a concurrent
+    // registration at worst re-restoring the same handlers.
     RestoreHandlersLocked();
   }
 
-  pthread_mutex_unlock(&handler_stack_mutex_);
+  __sync_fetch_and_sub(&handler_dispatch_count, 1);
 
   if (info->si_pid) {
     // This signal was triggered by somebody sending us the signal with kill().
@@ -430,6 +510,16 @@ bool ExceptionHandler::GenerateDump(CrashContext *context) {
   if (IsOutOfProcess())
     return crash_generation_client_->RequestDump(context, sizeof(*context));
 
+  // A pre-forked standby dumper saves the clone and ptrace-permission
+  // setup below.  If the standby has died --- OOM killed, crashed, or
+  // killed by mistake --- fall through and dump with a fresh clone
+  // instead.
+  if (standby_pid_ > 0) {
+    bool dump_result;
+    if (GenerateDumpWithStandby(context, &dump_result))
+      return dump_result;
+  }
+
   static const unsigned kChildStackSize = 8000;
   PageAllocator allocator;
   uint8_t* stack = (uint8_t*) allocator.Alloc(kChildStackSize);
@@ -489,6 +579,207 @@ bool ExceptionHandler::GenerateDump(CrashContext *context) {
   return success;
 }
 
+// The request the signal handler sends down the standby pipe: the
+// crashing process's pid followed by its crash context.  Small enough
+// that a single pipe write is atomic (PIPE_BUF).
+struct StandbyRequest {
+  pid_t pid;
+  ExceptionHandler::CrashContext context;
+};
+
+// Runs before crashing: normal context.
+bool ExceptionHandler::StartStandbyDumper() {
+  if (standby_pid_ > 0)
+    return true;
+  // The crash generation server is already a warm out-of-process dumper.
+  if (IsOutOfProcess())
+    return false;
+
+  if (pipe(standby_request_fd_) == -1)
+    return false;
+  if (pipe(standby_status_fd_) == -1) {
+    close(standby_request_fd_[0]);
+    close(standby_request_fd_[1]);
+    standby_request_fd_[0] = standby_request_fd_[1] = -1;
+    return false;
+  }
+
+  const pid_t child = fork();
+  if (child == -1) {
+    StopStandbyDumper();
+    return false;
+  }
+
+  if (child == 0) {
+    // The standby process.  Park on the request pipe; everything the
+    // dump needs - descriptor, mapping list, app memory list - was
+    // snapshotted by fork.
+    close(standby_request_fd_[1]);
+    close(standby_status_fd_[0]);
+    StandbyDumperMain();
+    // Not reached.
+    sys__exit(1);
+  }
+
+  close(standby_request_fd_[0]);
+  close(standby_status_fd_[1]);
+  standby_request_fd_[0] = -1;
+  standby_status_fd_[1] = -1;
+
+  // Grant ptrace permission now, while we are not crashing; the signal
+  // handler re-arms it in case something overwrote it since.
+  sys_prctl(PR_SET_PTRACER, child);
+  standby_pid_ = child;
+  return true;
+}
+
+// Runs before crashing: normal context.
+void ExceptionHandler::StopStandbyDumper() {
+  if (standby_request_fd_[1] >= 0) {
+    // Closing the request pipe wakes the standby's read with EOF and it
+    // exits.
+    close(standby_request_fd_[1]);
+    standby_request_fd_[1] = -1;
+  }
+  if (standby_status_fd_[0] >= 0) {
+    close(standby_status_fd_[0]);
+    standby_status_fd_[0] = -1;
+  }
+  if (standby_pid_ > 0) {
+    int status;
+    HANDLE_EINTR(sys_waitpid(standby_pid_, &status, __WALL));
+    standby_pid_ = -1;
+  }
+}
+
+// Runs before crashing: normal context.
+bool ExceptionHandler::SnapshotProcessState() {
+  // Reuse the dumper's own /proc parsers so the snapshot gets the same
+  // mapping merging and main-module ordering the crash path would
+  // produce. Init() only reads /proc; it does not attach to anything.
+  LinuxPtraceDumper dumper(getpid());
+  if (mapping_filter_)
+    dumper.set_mapping_filter(mapping_filter_, mapping_filter_context_);
+  if (!dumper.Init())
+    return false;
+
+  const wasteful_vector<pid_t>& threads = dumper.threads();
+  const wasteful_vector<MappingInfo*>& mappings = dumper.mappings();
+
+  // Build into the slot the crash path is not reading.
+  const int slot = current_snapshot_ == &snapshot_slots_[0] ? 1 : 0;
+  ProcSnapshot* snapshot = &snapshot_slots_[slot];
+
+  if (threads.size() > snapshot_thread_capacity_[slot]) {
+    // Deliberately leak the old array; see the member comment.
+    snapshot_thread_capacity_[slot] = threads.size() * 2;
+    snapshot->threads = new pid_t[snapshot_thread_capacity_[slot]];
+  }
+  if (mappings.size() > snapshot_mapping_capacity_[slot]) {
+    snapshot_mapping_capacity_[slot] = mappings.size() * 2;
+    snapshot->mappings = new MappingInfo[snapshot_mapping_capacity_[slot]];
+  }
+
+  for (size_t i = 0; i < threads.size(); ++i)
+    snapshot->threads[i] = threads[i];
+  for (size_t i = 0; i < mappings.size(); ++i)
+    snapshot->mappings[i] = *mappings[i];
+  snapshot->thread_count = threads.size();
+  snapshot->mapping_count = mappings.size();
+
+  current_snapshot_ = snapshot;
+  return true;
+}
+
+// The standby process's main loop.  Runs in the forked dumper process;
+// although that process has a healthy heap of its own, it stays on the
+// same no-libc diet as the cloned dumper so that the two paths behave
+// identically.
+void ExceptionHandler::StandbyDumperMain() {
+  for (;;) {
+    StandbyRequest request;
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(&request);
+    size_t done = 0;
+    while (done < sizeof(request)) {
+      ssize_t bytes = HANDLE_EINTR(sys_read(standby_request_fd_[0],
+                                            buffer + done,
+                                            sizeof(request) - done));
+      if (bytes == 0 && done == 0)
+        sys__exit(0);  // handler destroyed; pipe closed with no request
+      if (bytes <= 0)
+        sys__exit(1);
+      done += bytes;
+    }
+
+    char status = DoDump(request.pid, &request.context,
+                         sizeof(request.context)) ? 1 : 0;
+    if (HANDLE_EINTR(sys_write(standby_status_fd_[1], &status,
+                               sizeof(status))) != sizeof(status)) {
+      sys__exit(1);
+    }
+  }
+}
+
+// This function runs in a compromised context: see the top of the file.
+// Runs on the crashing thread.
+bool ExceptionHandler::GenerateDumpWithStandby(CrashContext *context,
+                                               bool* dump_result) {
+  // Another PR_SET_PTRACER call may have overwritten the permission
+  // granted at start; re-arming costs one syscall.
+  sys_prctl(PR_SET_PTRACER, standby_pid_);
+
+  StandbyRequest request;
+  request.pid = getpid();
+  my_memcpy(&request.context, context, sizeof(*context));
+
+  // If the standby is dead the request pipe has no reader, and writing
+  // to it raises SIGPIPE --- which is neither handled nor in the
+  // handler's signal mask, so it would kill the process before the
+  // write could return EPIPE.  Block it for this thread first.
+  struct kernel_sigset_t sigpipe_set, old_set;
+  sys_sigemptyset(&sigpipe_set);
+  sys_sigaddset(&sigpipe_set, SIGPIPE);
+  sys_sigprocmask(SIG_BLOCK, &sigpipe_set, &old_set);
+
+  if (HANDLE_EINTR(sys_write(standby_request_fd_[1], &request,
+                             sizeof(request))) !=
+      static_cast<ssize_t>(sizeof(request))) {
+    static const char msg[] = "ExceptionHandler::GenerateDumpWithStandby \
+                               sys_write failed:";
+    logger::write(msg, sizeof(msg) - 1);
+    logger::write(strerror(errno), strlen(strerror(errno)));
+    logger::write("\n", 1);
+    // Leave SIGPIPE blocked: the failed write may have left it
+    // pending, and restoring the old mask would deliver it.
+    return false;
+  }
+
+  // The write went through, so no SIGPIPE is pending.
+  sys_sigprocmask(SIG_SETMASK, &old_set, NULL);
+
+  // Block until the standby reports the dump landed, as the clone path
+  // blocks in waitpid.  A read of zero bytes means the standby died
+  // after taking the request; report transport failure so the caller
+  // retries with a clone.
+  char status = 0;
+  ssize_t r = HANDLE_EINTR(sys_read(standby_status_fd_[0], &status,
+                                    sizeof(status)));
+  if (r != sizeof(status)) {
+    static const char msg[] = "ExceptionHandler::GenerateDumpWithStandby \
+                               sys_read failed:";
+    logger::write(msg, sizeof(msg) - 1);
+    logger::write(strerror(errno), strlen(strerror(errno)));
+    logger::write("\n", 1);
+    return false;
+  }
+
+  bool success = status == 1;
+  if (callback_)
+    success = callback_(minidump_descriptor_, callback_context_, success);
+  *dump_result = success;
+  return true;
+}
+
 // This function runs in a compromised context: see the top of the file.
 void ExceptionHandler::SendContinueSignalToChild() {
   static const char okToContinueMessage = 'a';
@@ -529,7 +820,15 @@ bool ExceptionHandler::DoDump(pid_t crashing_process, const void* context,
                                           context,
                                           context_size,
                                           mapping_list_,
-                                          app_memory_list_);
+                                          app_memory_list_,
+                                          current_snapshot_,
+                                          minidump_descriptor_.stack_capture_limit(),
+                                          minidump_descriptor_.trim_stack_to_sp(),
+                                          minidump_descriptor_.triage_mode(),
+                                          minidump_descriptor_.copy_then_resume(),
+                                          minidump_descriptor_.full_memory(),
+                                          mapping_filter_,
+                                          mapping_filter_context_);
   }
   return google_breakpad::WriteMinidump(minidump_descriptor_.path(),
                                         minidump_descriptor_.size_limit(),
@@ -537,7 +836,15 @@ bool ExceptionHandler::DoDump(pid_t crashing_process, const void* context,
                                         context,
                                         context_size,
                                         mapping_list_,
-                                        app_memory_list_);
+                                        app_memory_list_,
+                                        current_snapshot_,
+                                        minidump_descriptor_.stack_capture_limit(),
+                                        minidump_descriptor_.trim_stack_to_sp(),
+                                        minidump_descriptor_.triage_mode(),
+                                        minidump_descriptor_.copy_then_resume(),
+                                        minidump_descriptor_.full_memory(),
+                                        mapping_filter_,
+                                        mapping_filter_context_);
 }
 
 // static
@@ -219,6 +219,52 @@ class ExceptionHandler {
 
   // Force signal handling for the specified signal.
   bool SimulateSignalDelivery(int sig);
+
+  // Pre-forks an idle dumper process parked on a pipe.  When a standby
+  // dumper is running, the crash signal handler only writes the crash
+  // context down the pipe and waits for a status byte, removing the
+  // clone and ptrace-permission setup from the crash-to-dump path;
+  // supervisors that hold restart until the dump lands see the saving
+  // directly.  Start the standby after the handler is fully configured:
+  // it inherits a snapshot of the descriptor, mapping list and app
+  // memory list, and later changes do not reach it.  Returns true if
+  // the standby is running.  No-op when dump generation is
+  // out-of-process.  The standby is stopped by the destructor.
+  bool StartStandbyDumper();
+
+  // Stops a running standby dumper and reverts GenerateDump to cloning
+  // at crash time.  Safe to call when none is running.
+  void StopStandbyDumper();
+
+  // Captures the process's thread and mapping lists so that the crash
+  // path can reuse them instead of parsing /proc/self/maps and
+  // /proc/self/task from scratch; for processes with thousands of
+  // mappings that parse is the bulk of in-handler time.  Call this
+  // periodically during normal operation, and after loading or
+  // unloading libraries: threads and mappings created after the last
+  // snapshot are missing from the dump, and threads that have since
+  // exited are dropped by the dumper when it fails to attach to them.
+  // Snapshots are double-buffered, so a crash on another thread always
+  // reads a complete one.  Not compatible with a running standby
+  // dumper, whose memory is frozen at fork time - restart it to pick up
+  // new snapshots.  Returns true on success.
+  bool SnapshotProcessState();
+
+  // Installs a predicate that decides, line by line of
+  // /proc/<pid>/maps, which mappings the dump records; see
+  // MappingFilter in linux_dumper.h.  Processes that map thousands of
+  // anonymous arenas or JIT scratch regions no stackwalk will ever
+  // touch can drop them here, shrinking dumps and the crash-time work
+  // of converting and identifying mappings.  The main module is always
+  // kept.  The filter runs in a compromised context: it must make no
+  // libc calls and allocate nothing.  It also applies to snapshots
+  // taken by later SnapshotProcessState() calls; restart a running
+  // standby dumper to make it pick the filter up.
+  void set_mapping_filter(MappingFilter filter, void* context) {
+    mapping_filter_ = filter;
+    mapping_filter_context_ = context;
+  }
+
  private:
   // Save the old signal handlers and install new ones.
   static bool InstallHandlersLocked();
@@ -227,6 +273,12 @@ class ExceptionHandler {
 
   void PreresolveSymbols();
   bool GenerateDump(CrashContext *context);
+  // Asks the standby dumper process for a dump.  Returns true if the
+  // standby completed the request, with the dump's success in
+  // |dump_result|; returns false if the standby is gone, in which case
+  // the caller should dump with a fresh clone instead.
+  bool GenerateDumpWithStandby(CrashContext *context, bool* dump_result);
+  void StandbyDumperMain();
   void SendContinueSignalToChild();
   void WaitForContinueSignal();
 
@@ -246,10 +298,22 @@ class ExceptionHandler {
 
   HandlerCallback crash_handler_;
 
+  // An immutable snapshot of the stacked handlers. Registration
+  // replaces the whole snapshot rather than mutating it, so the signal
+  // handler can dispatch from one loaded pointer without taking any
+  // lock.
+  struct HandlerStack {
+    size_t count;
+    ExceptionHandler** handlers;  // |count| entries, owned by the snapshot
+  };
+
   // The global exception handler stack. This is need becuase there may exist
   // multiple ExceptionHandler instances in a process. Each will have itself
-  // registered in this stack.
-  static std::vector<ExceptionHandler*> *handler_stack_;
+  // registered in this stack. The signal handler reads the current
+  // snapshot wait-free; the mutex serializes only the writers, which
+  // copy the snapshot, swap the pointer and wait out any in-flight
+  // dispatch before reclaiming the old copy.
+  static HandlerStack* volatile handler_stack_;
   static pthread_mutex_t handler_stack_mutex_;
 
   // We need to explicitly enable ptrace of parent processes on some
@@ -259,6 +323,24 @@ class ExceptionHandler {
   // ptrace. This is used to store the file descriptors for the pipe
   int fdes[2];
 
+  // The standby dumper, when one has been started: its pid, the pipe
+  // the signal handler sends crash contexts down, and the pipe the
+  // standby reports dump success on.  See StartStandbyDumper.
+  pid_t standby_pid_;
+  int standby_request_fd_[2];
+  int standby_status_fd_[2];
+
+  // Double-buffered process snapshots for SnapshotProcessState(). A
+  // snapshot is built in the slot current_snapshot_ does not point at
+  // and then published by updating current_snapshot_, so the crash path
+  // never reads a half-written one. The arrays are never freed on
+  // regrow, only replaced, because a concurrently crashing thread may
+  // still be reading the old ones.
+  ProcSnapshot snapshot_slots_[2];
+  unsigned snapshot_thread_capacity_[2];
+  unsigned snapshot_mapping_capacity_[2];
+  const ProcSnapshot* current_snapshot_;
+
   // Callers can add extra info about mappings for cases where the
   // dumper code cannot extract enough information from /proc/<pid>/maps.
   MappingList mapping_list_;
@@ -266,6 +348,11 @@ class ExceptionHandler {
   // Callers can request additional memory regions to be included in
   // the dump.
   AppMemoryList app_memory_list_;
+
+  // Capture policy for mappings, applied by the dumper at enumeration
+  // time, or NULL to record every mapping.
+  MappingFilter mapping_filter_;
+  void* mapping_filter_context_;
 };
 
 }  // namespace google_breakpad
@@ -39,7 +39,12 @@ MinidumpDescriptor::MinidumpDescriptor(const MinidumpDescriptor& descriptor)
     : fd_(descriptor.fd_),
       directory_(descriptor.directory_),
       c_path_(NULL),
-      size_limit_(descriptor.size_limit_) {
+      size_limit_(descriptor.size_limit_),
+      stack_capture_limit_(descriptor.stack_capture_limit_),
+      trim_stack_to_sp_(descriptor.trim_stack_to_sp_),
+      triage_mode_(descriptor.triage_mode_),
+      copy_then_resume_(descriptor.copy_then_resume_),
+      full_memory_(descriptor.full_memory_) {
   // The copy constructor is not allowed to be called on a MinidumpDescriptor
   // with a valid path_, as getting its c_path_ would require the heap which
   // can cause problems in compromised environments.
@@ -59,6 +64,11 @@ MinidumpDescriptor& MinidumpDescriptor::operator=(
     UpdatePath();
   }
   size_limit_ = descriptor.size_limit_;
+  stack_capture_limit_ = descriptor.stack_capture_limit_;
+  trim_stack_to_sp_ = descriptor.trim_stack_to_sp_;
+  triage_mode_ = descriptor.triage_mode_;
+  copy_then_resume_ = descriptor.copy_then_resume_;
+  full_memory_ = descriptor.full_memory_;
   return *this;
 }
 
@@ -45,20 +45,37 @@ namespace google_breakpad {
 
 class MinidumpDescriptor {
  public:
-  MinidumpDescriptor() : fd_(-1), size_limit_(-1) {}
+  MinidumpDescriptor()
+      : fd_(-1),
+        size_limit_(-1),
+        stack_capture_limit_(-1),
+        trim_stack_to_sp_(false),
+        triage_mode_(false),
+        copy_then_resume_(false),
+        full_memory_(false) {}
 
   explicit MinidumpDescriptor(const string& directory)
       : fd_(-1),
         directory_(directory),
         c_path_(NULL),
-        size_limit_(-1) {
+        size_limit_(-1),
+        stack_capture_limit_(-1),
+        trim_stack_to_sp_(false),
+        triage_mode_(false),
+        copy_then_resume_(false),
+        full_memory_(false) {
     assert(!directory.empty());
   }
 
   explicit MinidumpDescriptor(int fd)
       : fd_(fd),
         c_path_(NULL),
-        size_limit_(-1) {
+        size_limit_(-1),
+        stack_capture_limit_(-1),
+        trim_stack_to_sp_(false),
+        triage_mode_(false),
+        copy_then_resume_(false),
+        full_memory_(false) {
     assert(fd != -1);
   }
 
@@ -80,6 +97,49 @@ class MinidumpDescriptor {
   off_t size_limit() const { return size_limit_; }
   void set_size_limit(off_t limit) { size_limit_ = limit; }
 
+  // Bounds the bytes of stack captured per thread, or -1 for the
+  // dumper's default. Threads with deep live stacks get this much of
+  // the top of the stack.
+  ssize_t stack_capture_limit() const { return stack_capture_limit_; }
+  void set_stack_capture_limit(ssize_t limit) {
+    stack_capture_limit_ = limit;
+  }
+
+  // When set, stack capture starts just below each thread's stack
+  // pointer instead of at a page boundary, trimming up to a page of
+  // dead bytes per thread from the dump.
+  bool trim_stack_to_sp() const { return trim_stack_to_sp_; }
+  void set_trim_stack_to_sp(bool trim) { trim_stack_to_sp_ = trim; }
+
+  // When set, dumps contain only the streams needed to triage the
+  // crash - crashing thread context and stack, module list, exception
+  // record and system info - collapsing both time spent in the crash
+  // handler and upload bytes. Intended for latency-critical services
+  // where a supervisor holds restart until the dump lands.
+  bool triage_mode() const { return triage_mode_; }
+  void set_triage_mode(bool triage) { triage_mode_ = triage; }
+
+  // When set, dumps copy thread state and live stacks into local
+  // buffers and resume the threads before serializing the minidump,
+  // shrinking the stopped window from the whole write to the capture
+  // itself. Intended for periodic diagnostic snapshots of production
+  // processes via ExceptionHandler::WriteMinidump(), where the pause is
+  // user-visible.
+  bool copy_then_resume() const { return copy_then_resume_; }
+  void set_copy_then_resume(bool copy) { copy_then_resume_ = copy; }
+
+  // When set, dumps also carry every writable mapping of the process
+  // as a MEMORY_64_LIST stream, giving core-level fidelity for
+  // post-crash heap analysis without a separate core workflow. The
+  // regions are bulk-copied through /proc/<pid>/mem and streamed in
+  // large writes, but a heap-heavy process still makes the dump
+  // proportionally larger and slower to write; combine with
+  // set_size_limit() to cap the file. Regions are dropped, never
+  // truncated, when the limit (or the 4GB minidump file format ceiling)
+  // is reached.
+  bool full_memory() const { return full_memory_; }
+  void set_full_memory(bool full) { full_memory_ = full; }
+
  private:
   // The file descriptor where the minidump is generated.
   int fd_;
@@ -93,6 +153,16 @@ class MinidumpDescriptor {
   const char* c_path_;
 
   off_t size_limit_;
+
+  ssize_t stack_capture_limit_;
+
+  bool trim_stack_to_sp_;
+
+  bool triage_mode_;
+
+  bool copy_then_resume_;
+
+  bool full_memory_;
 };
 
 }  // namespace google_breakpad
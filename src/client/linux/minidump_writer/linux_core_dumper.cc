@@ -87,6 +87,11 @@ void LinuxCoreDumper::CopyFromProcess(void* dest, pid_t child,
   }
 }
 
+const void* LinuxCoreDumper::GetMemoryView(const void* src, size_t length) {
+  ElfCoreDump::Addr virtual_address = reinterpret_cast<ElfCoreDump::Addr>(src);
+  return core_.GetDataPointer(virtual_address, length);
+}
+
 bool LinuxCoreDumper::GetThreadInfoByIndex(size_t index, ThreadInfo* info) {
   if (index >= thread_infos_.size())
     return false;
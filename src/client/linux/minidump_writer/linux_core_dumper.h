@@ -72,6 +72,15 @@ class LinuxCoreDumper : public LinuxDumper {
   virtual void CopyFromProcess(void* dest, pid_t child, const void* src,
                                size_t length);
 
+  // Implements LinuxDumper::GetMemoryView().
+  // Returns a pointer directly into the memory-mapped core dump file
+  // covering |length| bytes at |src|, or NULL if the range is not
+  // entirely present in the core dump. This lets callers write large
+  // blocks, such as thread stacks, straight from the core mapping to
+  // the minidump without the intermediate copy made by
+  // CopyFromProcess().
+  virtual const void* GetMemoryView(const void* src, size_t length);
+
   // Implements LinuxDumper::GetThreadInfoByIndex().
   // Reads information about the |index|-th thread of |threads_|.
   // Returns true on success. One must have called |ThreadsSuspend| first.
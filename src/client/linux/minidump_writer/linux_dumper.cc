@@ -43,7 +43,6 @@
 #include <stddef.h>
 #include <string.h>
 
-#include "client/linux/minidump_writer/line_reader.h"
 #include "common/linux/file_id.h"
 #include "common/linux/linux_libc_support.h"
 #include "common/linux/memory_mapped_file.h"
@@ -69,6 +68,14 @@ namespace google_breakpad {
 // All interesting auvx entry types are below AT_SYSINFO_EHDR
 #define AT_MAX AT_SYSINFO_EHDR
 
+// The number of bytes of stack which we try to capture per thread when
+// no other limit has been set with set_stack_capture_limit().
+static const size_t kDefaultStackToCapture = 32 * 1024;
+
+// Bytes below the stack pointer included when trimming the capture to
+// the live region, for leaf functions that store below the pointer.
+static const size_t kStackRedZone = 128;
+
 LinuxDumper::LinuxDumper(pid_t pid)
     : pid_(pid),
       crash_address_(0),
@@ -76,16 +83,42 @@ LinuxDumper::LinuxDumper(pid_t pid)
       crash_thread_(0),
       threads_(&allocator_, 8),
       mappings_(&allocator_),
-      auxv_(&allocator_, AT_MAX + 1) {
+      writable_ranges_(&allocator_),
+      auxv_(&allocator_, AT_MAX + 1),
+      snapshot_(NULL),
+      identifier_cache_(NULL),
+      stack_capture_limit_(kDefaultStackToCapture),
+      trim_stack_to_sp_(false),
+      mapping_filter_(NULL),
+      mapping_filter_context_(NULL) {
 }
 
 LinuxDumper::~LinuxDumper() {
 }
 
 bool LinuxDumper::Init() {
+  if (snapshot_)
+    return ReadAuxv() && InitFromSnapshot();
   return ReadAuxv() && EnumerateThreads() && EnumerateMappings();
 }
 
+bool LinuxDumper::InitFromSnapshot() {
+  for (unsigned i = 0; i < snapshot_->thread_count; ++i)
+    threads_.push_back(snapshot_->threads[i]);
+
+  // Deep-copy the mappings so that lookups work off |allocator_| memory,
+  // exactly as if EnumerateMappings had parsed them. The snapshot was
+  // built by EnumerateMappings in the first place, so adjacent mappings
+  // are already merged and the main module is already first.
+  for (unsigned i = 0; i < snapshot_->mapping_count; ++i) {
+    MappingInfo* const module = new(allocator_) MappingInfo;
+    my_memcpy(module, &snapshot_->mappings[i], sizeof(MappingInfo));
+    mappings_.push_back(module);
+  }
+
+  return !threads_.empty() && !mappings_.empty();
+}
+
 bool
 LinuxDumper::ElfFileIdentifierForMapping(const MappingInfo& mapping,
                                          bool member,
@@ -93,6 +126,37 @@ LinuxDumper::ElfFileIdentifierForMapping(const MappingInfo& mapping,
                                          uint8_t identifier[sizeof(MDGUID)])
 {
   assert(!member || mapping_id < mappings_.size());
+  if (!member) {
+    return ComputeElfFileIdentifierForMapping(mapping, member, mapping_id,
+                                              identifier);
+  }
+
+  if (!identifier_cache_) {
+    const size_t cache_size = sizeof(CachedIdentifier) * mappings_.size();
+    identifier_cache_ =
+        reinterpret_cast<CachedIdentifier*>(allocator_.Alloc(cache_size));
+    my_memset(identifier_cache_, 0, cache_size);
+  }
+
+  CachedIdentifier* cached = &identifier_cache_[mapping_id];
+  if (!cached->computed) {
+    cached->valid = ComputeElfFileIdentifierForMapping(mapping, member,
+                                                       mapping_id,
+                                                       cached->identifier);
+    cached->computed = true;
+  }
+
+  my_memcpy(identifier, cached->identifier, sizeof(MDGUID));
+  return cached->valid;
+}
+
+bool
+LinuxDumper::ComputeElfFileIdentifierForMapping(
+    const MappingInfo& mapping,
+    bool member,
+    unsigned int mapping_id,
+    uint8_t identifier[sizeof(MDGUID)])
+{
   my_memset(identifier, 0, sizeof(MDGUID));
   if (IsMappedFileOpenUnsafe(mapping))
     return false;
@@ -161,6 +225,47 @@ bool LinuxDumper::ReadAuxv() {
   return res;
 }
 
+// Reads the whole of |path| into one contiguous buffer allocated from
+// |allocator|, returning the buffer and storing its length in
+// |file_size|, or returning NULL on failure. /proc files report no size
+// up front, so the buffer starts at |initial_capacity| bytes and doubles
+// when full; growth copies, but the initial capacity is chosen so that
+// it almost never happens. Pages abandoned by growth stay with the
+// allocator and are reclaimed when it is destroyed.
+static char* ReadFileIntoAllocator(PageAllocator* allocator,
+                                   const char* path,
+                                   size_t initial_capacity,
+                                   size_t* file_size) {
+  const int fd = sys_open(path, O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+
+  size_t capacity = initial_capacity;
+  char* buffer = reinterpret_cast<char*>(allocator->Alloc(capacity));
+  size_t size = 0;
+
+  for (;;) {
+    if (size == capacity) {
+      capacity *= 2;
+      char* const bigger = reinterpret_cast<char*>(allocator->Alloc(capacity));
+      my_memcpy(bigger, buffer, size);
+      buffer = bigger;
+    }
+    const ssize_t bytes = sys_read(fd, buffer + size, capacity - size);
+    if (bytes < 0) {
+      sys_close(fd);
+      return NULL;
+    }
+    if (bytes == 0)
+      break;
+    size += bytes;
+  }
+
+  sys_close(fd);
+  *file_size = size;
+  return buffer;
+}
+
 bool LinuxDumper::EnumerateMappings() {
   char maps_path[NAME_MAX];
   if (!BuildProcPath(maps_path, pid_, "maps"))
@@ -180,14 +285,34 @@ bool LinuxDumper::EnumerateMappings() {
   // actual entry point to find the mapping.
   const void* entry_point_loc = reinterpret_cast<void *>(auxv_[AT_ENTRY]);
 
-  const int fd = sys_open(maps_path, O_RDONLY, 0);
-  if (fd < 0)
+  // Slurp the whole maps file in large reads and parse it in place,
+  // rather than trickling it through LineReader's small buffer with a
+  // read and a memmove per refill. Thousands-of-mappings processes make
+  // this file hundreds of kilobytes, and every thread of the victim is
+  // stopped while we parse it.
+  static const size_t kMapsInitialCapacity = 1024 * 1024;
+  size_t maps_size;
+  char* const maps_data = ReadFileIntoAllocator(&allocator_, maps_path,
+                                                kMapsInitialCapacity,
+                                                &maps_size);
+  if (!maps_data)
     return false;
-  LineReader* const line_reader = new(allocator_) LineReader(fd);
 
-  const char* line;
-  unsigned line_len;
-  while (line_reader->GetNextLine(&line, &line_len)) {
+  char* cursor = maps_data;
+  char* const maps_end = maps_data + maps_size;
+  while (cursor < maps_end) {
+    // NUL-terminate the line in place; the field parsers below expect
+    // it. A final line without a newline is safe to terminate too:
+    // ReadFileIntoAllocator only returns with size strictly below the
+    // buffer's capacity.
+    char* eol = cursor;
+    while (eol < maps_end && *eol != '\n')
+      ++eol;
+    *eol = '\0';
+
+    const char* const line = cursor;
+    cursor = eol + 1;
+
     uintptr_t start_addr, end_addr, offset;
 
     const char* i1 = my_read_hex_ptr(&start_addr, line);
@@ -205,6 +330,30 @@ bool LinuxDumper::EnumerateMappings() {
             name = kLinuxGateLibraryName;
             offset = 0;
           }
+          // Consult the capture policy, if any. The mapping holding the
+          // entry point is exempt: the minidump format needs the main
+          // module whatever the policy says.
+          if (mapping_filter_ &&
+              !(entry_point_loc &&
+                reinterpret_cast<uintptr_t>(entry_point_loc) >= start_addr &&
+                reinterpret_cast<uintptr_t>(entry_point_loc) < end_addr)) {
+            char perms[5];
+            my_memcpy(perms, i2 + 1, 4);
+            perms[4] = '\0';
+            if (!mapping_filter_(name ? name : "", perms,
+                                 end_addr - start_addr,
+                                 mapping_filter_context_)) {
+              continue;
+            }
+          }
+          // Remember writable spans for full-memory capture before the
+          // merging below can fold them into a larger module.
+          if (i2[2] == 'w') {
+            MappingRange range;
+            range.start_addr = start_addr;
+            range.size = end_addr - start_addr;
+            writable_ranges_.push_back(range);
+          }
           // Merge adjacent mappings with the same name into one module,
           // assuming they're a single library mapped by the dynamic linker
           if (name && !mappings_.empty()) {
@@ -213,7 +362,6 @@ bool LinuxDumper::EnumerateMappings() {
                 (my_strlen(name) == my_strlen(module->name)) &&
                 (my_strncmp(name, module->name, my_strlen(name)) == 0)) {
               module->size = end_addr - module->start_addr;
-              line_reader->PopLine(line_len);
               continue;
             }
           }
@@ -249,11 +397,8 @@ bool LinuxDumper::EnumerateMappings() {
         }
       }
     }
-    line_reader->PopLine(line_len);
   }
 
-  sys_close(fd);
-
   return !mappings_.empty();
 }
 
@@ -262,14 +407,23 @@ bool LinuxDumper::EnumerateMappings() {
 // unwind. So we just grab, up to, 32k of stack.
 bool LinuxDumper::GetStackInfo(const void** stack, size_t* stack_len,
                                uintptr_t int_stack_pointer) {
-  // Move the stack pointer to the bottom of the page that it's in.
-  const uintptr_t page_size = getpagesize();
+  uintptr_t capture_start;
+  if (trim_stack_to_sp_) {
+    // Start just below the stack pointer, keeping a small red zone and
+    // rounding down so the capture start stays 16-byte aligned. Only
+    // the live region above the pointer is captured.
+    capture_start = (int_stack_pointer - kStackRedZone) & ~uintptr_t(15);
+  } else {
+    // Move the stack pointer to the bottom of the page that it's in.
+    const uintptr_t page_size = getpagesize();
+    capture_start = int_stack_pointer & ~(page_size - 1);
+  }
 
-  uint8_t* const stack_pointer =
-      reinterpret_cast<uint8_t*>(int_stack_pointer & ~(page_size - 1));
+  uint8_t* const stack_pointer = reinterpret_cast<uint8_t*>(capture_start);
 
   // The number of bytes of stack which we try to capture.
-  static const ptrdiff_t kStackToCapture = 32 * 1024;
+  const ptrdiff_t stack_to_capture =
+      static_cast<ptrdiff_t>(stack_capture_limit_);
 
   const MappingInfo* mapping = FindMapping(stack_pointer);
   if (!mapping)
@@ -277,8 +431,8 @@ bool LinuxDumper::GetStackInfo(const void** stack, size_t* stack_len,
   const ptrdiff_t offset = stack_pointer - (uint8_t*) mapping->start_addr;
   const ptrdiff_t distance_to_end =
       static_cast<ptrdiff_t>(mapping->size) - offset;
-  *stack_len = distance_to_end > kStackToCapture ?
-      kStackToCapture : distance_to_end;
+  *stack_len = distance_to_end > stack_to_capture ?
+      stack_to_capture : distance_to_end;
   *stack = stack_pointer;
   return true;
 }
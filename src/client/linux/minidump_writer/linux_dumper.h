@@ -100,15 +100,62 @@ struct MappingInfo {
   char name[NAME_MAX];
 };
 
+// A contiguous writable span of the process's address space, one per
+// writable line of /proc/$x/maps. Unlike |MappingInfo|, adjacent
+// segments of the same file are not merged, so a library's read-only
+// text never rides along with its writable data segment.
+struct MappingRange {
+  uintptr_t start_addr;
+  size_t size;
+};
+
+// A predicate deciding whether a mapping parsed out of /proc/<pid>/maps
+// is recorded by EnumerateMappings. |name| is the mapped file's path, or
+// the empty string for anonymous mappings (including the heap and thread
+// stacks, which carry no path in the maps file); |perms| is the
+// four-character permission field from the maps line (e.g. "r-xp");
+// |size| is the mapping's extent in bytes; |context| is the pointer
+// registered alongside the filter. Return false to drop the mapping.
+// May be called at crash time with the victim's threads suspended, in a
+// compromised address space: no libc calls and no heap allocation.
+typedef bool (*MappingFilter)(const char* name,
+                              const char* perms,
+                              size_t size,
+                              void* context);
+
+// A point-in-time copy of a process's thread and mapping lists, captured
+// during normal operation so that a dumper for that process can skip
+// parsing /proc/<pid>/task and /proc/<pid>/maps at crash time. The arrays
+// live in the process being dumped; a dumper reading them must share (a
+// copy of) that process's address space. See
+// ExceptionHandler::SnapshotProcessState().
+struct ProcSnapshot {
+  unsigned thread_count;
+  unsigned mapping_count;
+  pid_t* threads;          // |thread_count| entries
+  MappingInfo* mappings;   // |mapping_count| entries, main module first
+};
+
 class LinuxDumper {
  public:
   explicit LinuxDumper(pid_t pid);
 
   virtual ~LinuxDumper();
 
-  // Parse the data for |threads| and |mappings|.
+  // Parse the data for |threads| and |mappings|. If a snapshot has been
+  // supplied with set_proc_snapshot(), it is copied instead of parsing
+  // /proc from scratch.
   virtual bool Init();
 
+  // Supply a pre-parsed copy of the process's thread and mapping lists.
+  // Must be called before Init(). The snapshot is validated rather than
+  // trusted blindly: threads that have exited since it was taken fail to
+  // attach in ThreadsSuspend() and are dropped as usual. Threads and
+  // mappings created after the snapshot will be missing from the dump.
+  void set_proc_snapshot(const ProcSnapshot* snapshot) {
+    snapshot_ = snapshot;
+  }
+
   // Return true if the dumper performs a post-mortem dump.
   virtual bool IsPostMortem() const = 0;
 
@@ -116,6 +163,17 @@ class LinuxDumper {
   virtual bool ThreadsSuspend() = 0;
   virtual bool ThreadsResume() = 0;
 
+  // Copies everything the writer reads from the suspended threads -
+  // each thread's register state and its live stack region - into
+  // buffers owned by |allocator_|, then resumes the threads, so the
+  // minidump can be serialized while the process runs. Call after
+  // ThreadsSuspend(). Returns false without resuming anything if the
+  // capture cannot be completed, in which case the dump proceeds the
+  // conventional way with the threads still suspended. The default
+  // implementation captures nothing and returns false; post-mortem
+  // dumpers have no threads to pause.
+  virtual bool CaptureThreadsAndResume() { return false; }
+
   // Read information about the |index|-th thread of |threads_|.
   // Returns true on success. One must have called |ThreadsSuspend| first.
   virtual bool GetThreadInfoByIndex(size_t index, ThreadInfo* info) = 0;
@@ -124,6 +182,14 @@ class LinuxDumper {
   const wasteful_vector<pid_t> &threads() { return threads_; }
   const wasteful_vector<MappingInfo*> &mappings() { return mappings_; }
   const MappingInfo* FindMapping(const void* address) const;
+  // The writable spans of the address space, in address order, for
+  // full-memory capture. Recorded while /proc/<pid>/maps is parsed;
+  // empty when the mapping list came from a ProcSnapshot, which does
+  // not carry permissions. Mappings dropped by a mapping filter are
+  // not recorded here either.
+  const wasteful_vector<MappingRange>& writable_ranges() {
+    return writable_ranges_;
+  }
   const wasteful_vector<elf_aux_val_t>& auxv() { return auxv_; }
 
   // Find a block of memory to take as the stack given the top of stack pointer.
@@ -139,14 +205,28 @@ class LinuxDumper {
   virtual void CopyFromProcess(void* dest, pid_t child, const void* src,
                                size_t length) = 0;
 
+  // Returns a pointer to |length| bytes of the dumped process's memory
+  // starting at |src|, valid for the lifetime of this dumper, or NULL
+  // if the memory cannot be referenced directly. Post-mortem dumpers
+  // backed by a memory-mapped core file can serve such requests without
+  // copying; for a live process there is no mapping to point into, so
+  // the default implementation returns NULL and callers must fall back
+  // to CopyFromProcess().
+  virtual const void* GetMemoryView(const void* src, size_t length) {
+    return NULL;
+  }
+
   // Builds a proc path for a certain pid for a node (/proc/<pid>/<node>).
   // |path| is a character array of at least NAME_MAX bytes to return the
   // result.|node| is the final node without any slashes. Returns true on
   // success.
   virtual bool BuildProcPath(char* path, pid_t pid, const char* node) const = 0;
 
-  // Generate a File ID from the .text section of a mapped entry.
-  // If not a member, mapping_id is ignored.
+  // Generate a File ID for a mapped entry, preferring the module's GNU
+  // build id note and falling back on hashing the .text section. If
+  // not a member, mapping_id is ignored. Results for member mappings
+  // are cached, so repeated calls for the same mapping only touch the
+  // module's ELF file once.
   bool ElfFileIdentifierForMapping(const MappingInfo& mapping,
                                    bool member,
                                    unsigned int mapping_id,
@@ -163,9 +243,38 @@ class LinuxDumper {
   pid_t crash_thread() const { return crash_thread_; }
   void set_crash_thread(pid_t crash_thread) { crash_thread_ = crash_thread; }
 
+  // Bounds the number of bytes of stack captured per thread by
+  // GetStackInfo(). Threads with deep live stacks get this much of the
+  // top of the stack; the default is 32KB.
+  void set_stack_capture_limit(size_t bytes) { stack_capture_limit_ = bytes; }
+
+  // When set, GetStackInfo() starts the capture just below the stack
+  // pointer instead of at the base of the stack pointer's page,
+  // trimming up to a page of dead bytes per thread. A small red zone
+  // below the stack pointer is still included for leaf functions that
+  // store below it.
+  void set_trim_stack_to_sp(bool trim) { trim_stack_to_sp_ = trim; }
+
+  // Installs a predicate consulted for each line of /proc/<pid>/maps;
+  // mappings it rejects are never recorded, shrinking the dump and the
+  // crash-time work of converting and identifying them. The mapping
+  // containing the process's entry point is exempt, since the minidump
+  // format requires the main module. Beware that dropping an anonymous
+  // writable mapping that turns out to hold a thread's stack leaves
+  // that thread without stack memory in the dump, and that a policy
+  // keyed on permissions can drop some segments of a file-backed
+  // module, splitting or shrinking its recorded extent.
+  void set_mapping_filter(MappingFilter filter, void* context) {
+    mapping_filter_ = filter;
+    mapping_filter_context_ = context;
+  }
+
  protected:
   bool ReadAuxv();
 
+  // Populate |threads_| and |mappings_| from |snapshot_|.
+  bool InitFromSnapshot();
+
   virtual bool EnumerateMappings();
 
   virtual bool EnumerateThreads() = 0;
@@ -181,6 +290,20 @@ class LinuxDumper {
   // Returns true if |path| is modified.
   bool HandleDeletedFileInMapping(char* path) const;
 
+  // The uncached body of ElfFileIdentifierForMapping().
+  bool ComputeElfFileIdentifierForMapping(const MappingInfo& mapping,
+                                          bool member,
+                                          unsigned int mapping_id,
+                                          uint8_t identifier[sizeof(MDGUID)]);
+
+  // One ElfFileIdentifierForMapping() result per member mapping,
+  // filled in lazily.
+  struct CachedIdentifier {
+    bool computed;
+    bool valid;
+    uint8_t identifier[sizeof(MDGUID)];
+  };
+
    // ID of the crashed process.
   const pid_t pid_;
 
@@ -201,8 +324,31 @@ class LinuxDumper {
   // Info from /proc/<pid>/maps.
   wasteful_vector<MappingInfo*> mappings_;
 
+  // The writable subset of the maps lines, unmerged. See
+  // writable_ranges().
+  wasteful_vector<MappingRange> writable_ranges_;
+
   // Info from /proc/<pid>/auxv
   wasteful_vector<elf_aux_val_t> auxv_;
+
+  // Pre-parsed thread and mapping lists, or NULL to parse /proc.
+  const ProcSnapshot* snapshot_;
+
+  // Identifier cache, |mappings_.size()| entries allocated from
+  // |allocator_| on first use, or NULL.
+  CachedIdentifier* identifier_cache_;
+
+  // Bytes of stack captured per thread, at most.
+  size_t stack_capture_limit_;
+
+  // Whether stack capture starts just below the stack pointer rather
+  // than at a page boundary.
+  bool trim_stack_to_sp_;
+
+  // Predicate dropping uninteresting mappings at enumeration time, with
+  // its user context, or NULL to record every mapping.
+  MappingFilter mapping_filter_;
+  void* mapping_filter_context_;
 };
 
 }  // namespace google_breakpad
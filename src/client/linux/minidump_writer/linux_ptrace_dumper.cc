@@ -54,43 +54,6 @@
 #include "common/linux/linux_libc_support.h"
 #include "third_party/lss/linux_syscall_support.h"
 
-// Suspends a thread by attaching to it.
-static bool SuspendThread(pid_t pid) {
-  // This may fail if the thread has just died or debugged.
-  errno = 0;
-  if (sys_ptrace(PTRACE_ATTACH, pid, NULL, NULL) != 0 &&
-      errno != 0) {
-    return false;
-  }
-  while (sys_waitpid(pid, NULL, __WALL) < 0) {
-    if (errno != EINTR) {
-      sys_ptrace(PTRACE_DETACH, pid, NULL, NULL);
-      return false;
-    }
-  }
-#if defined(__i386) || defined(__x86_64)
-  // On x86, the stack pointer is NULL or -1, when executing trusted code in
-  // the seccomp sandbox. Not only does this cause difficulties down the line
-  // when trying to dump the thread's stack, it also results in the minidumps
-  // containing information about the trusted threads. This information is
-  // generally completely meaningless and just pollutes the minidumps.
-  // We thus test the stack pointer and exclude any threads that are part of
-  // the seccomp sandbox's trusted code.
-  user_regs_struct regs;
-  if (sys_ptrace(PTRACE_GETREGS, pid, NULL, &regs) == -1 ||
-#if defined(__i386)
-      !regs.esp
-#elif defined(__x86_64)
-      !regs.rsp
-#endif
-      ) {
-    sys_ptrace(PTRACE_DETACH, pid, NULL, NULL);
-    return false;
-  }
-#endif
-  return true;
-}
-
 // Resumes a thread by detaching from it.
 static bool ResumeThread(pid_t pid) {
   return sys_ptrace(PTRACE_DETACH, pid, NULL, NULL) >= 0;
@@ -100,7 +63,9 @@ namespace google_breakpad {
 
 LinuxPtraceDumper::LinuxPtraceDumper(pid_t pid)
     : LinuxDumper(pid),
-      threads_suspended_(false) {
+      threads_suspended_(false),
+      regs_cache_(NULL),
+      captured_threads_(NULL) {
 }
 
 bool LinuxPtraceDumper::BuildProcPath(char* path, pid_t pid,
@@ -125,8 +90,38 @@ bool LinuxPtraceDumper::BuildProcPath(char* path, pid_t pid,
   return true;
 }
 
-void LinuxPtraceDumper::CopyFromProcess(void* dest, pid_t child,
-                                        const void* src, size_t length) {
+bool LinuxPtraceDumper::CopyFromProcessByProcMem(void* dest, pid_t child,
+                                                 const void* src,
+                                                 size_t length) {
+  char mem_path[NAME_MAX];
+  if (!BuildProcPath(mem_path, child, "mem"))
+    return false;
+
+  const int fd = sys_open(mem_path, O_RDONLY, 0);
+  if (fd < 0)
+    return false;
+
+  uint8_t* const local = (uint8_t*) dest;
+  const off64_t offset = (off64_t) (uintptr_t) src;
+  size_t done = 0;
+
+  while (done < length) {
+    const ssize_t bytes = sys_pread64(fd, local + done, length - done,
+                                      offset + done);
+    if (bytes <= 0) {
+      sys_close(fd);
+      return false;
+    }
+    done += bytes;
+  }
+
+  sys_close(fd);
+  return true;
+}
+
+void LinuxPtraceDumper::CopyFromProcessByPtrace(void* dest, pid_t child,
+                                                const void* src,
+                                                size_t length) {
   unsigned long tmp = 55;
   size_t done = 0;
   static const size_t word_size = sizeof(tmp);
@@ -143,6 +138,31 @@ void LinuxPtraceDumper::CopyFromProcess(void* dest, pid_t child,
   }
 }
 
+void LinuxPtraceDumper::CopyFromProcess(void* dest, pid_t child,
+                                        const void* src, size_t length) {
+  // A captured stack region is served from the local copy: the threads
+  // are running again and only the copy is consistent with the register
+  // state taken alongside it.
+  const void* view = GetMemoryView(src, length);
+  if (view) {
+    my_memcpy(dest, view, length);
+    return;
+  }
+
+  // Reading the whole region from /proc/<child>/mem costs one syscall
+  // per chunk the kernel will serve, instead of one PTRACE_PEEKDATA per
+  // word, which matters inside the crash window when copying large
+  // stacks. The process is already ptrace-attached, which is what grants
+  // access to its mem file; once CaptureThreadsAndResume() has detached,
+  // holding the same credentials as the (dumpable) process still does.
+  if (CopyFromProcessByProcMem(dest, child, src, length))
+    return;
+
+  // Some kernels do not support reading from /proc/<pid>/mem; copy word
+  // by word via ptrace instead.
+  CopyFromProcessByPtrace(dest, child, src, length);
+}
+
 // Read thread info from /proc/$pid/status.
 // Fill out the |tgid|, |ppid| and |pid| members of |info|. If unavailable,
 // these members are set to -1. Returns true iff all three members are
@@ -151,6 +171,13 @@ bool LinuxPtraceDumper::GetThreadInfoByIndex(size_t index, ThreadInfo* info) {
   if (index >= threads_.size())
     return false;
 
+  if (captured_threads_) {
+    // CaptureThreadsAndResume() took the whole register state before
+    // detaching; the thread is running again and cannot be queried.
+    my_memcpy(info, &captured_threads_[index].info, sizeof(*info));
+    return true;
+  }
+
   pid_t tid = threads_[index];
 
   assert(info != NULL);
@@ -182,7 +209,11 @@ bool LinuxPtraceDumper::GetThreadInfoByIndex(size_t index, ThreadInfo* info) {
   if (info->ppid == -1 || info->tgid == -1)
     return false;
 
-  if (sys_ptrace(PTRACE_GETREGS, tid, NULL, &info->regs) == -1) {
+  if (regs_cache_) {
+    // ThreadsSuspend() captured the general-purpose registers while
+    // reaping this thread's stop notification.
+    my_memcpy(&info->regs, &regs_cache_[index], sizeof(info->regs));
+  } else if (sys_ptrace(PTRACE_GETREGS, tid, NULL, &info->regs) == -1) {
     return false;
   }
 
@@ -227,17 +258,80 @@ bool LinuxPtraceDumper::IsPostMortem() const {
   return false;
 }
 
+void LinuxPtraceDumper::DropThread(size_t index) {
+  my_memmove(&threads_[index], &threads_[index + 1],
+             (threads_.size() - index - 1) * sizeof(threads_[index]));
+  if (regs_cache_) {
+    my_memmove(&regs_cache_[index], &regs_cache_[index + 1],
+               (threads_.size() - index - 1) * sizeof(regs_cache_[index]));
+  }
+  threads_.resize(threads_.size() - 1);
+}
+
+bool LinuxPtraceDumper::WaitForThreadToStop(size_t index) {
+  const pid_t tid = threads_[index];
+  while (sys_waitpid(tid, NULL, __WALL) < 0) {
+    if (errno != EINTR) {
+      sys_ptrace(PTRACE_DETACH, tid, NULL, NULL);
+      return false;
+    }
+  }
+  // The thread is stopped now, so capture its general-purpose registers
+  // while we are here: the seccomp check below needs them anyway, and
+  // caching them saves GetThreadInfoByIndex() a PTRACE_GETREGS round
+  // trip per thread later.
+  if (sys_ptrace(PTRACE_GETREGS, tid, NULL, &regs_cache_[index]) == -1) {
+    sys_ptrace(PTRACE_DETACH, tid, NULL, NULL);
+    return false;
+  }
+#if defined(__i386) || defined(__x86_64)
+  // On x86, the stack pointer is NULL or -1, when executing trusted code in
+  // the seccomp sandbox. Not only does this cause difficulties down the line
+  // when trying to dump the thread's stack, it also results in the minidumps
+  // containing information about the trusted threads. This information is
+  // generally completely meaningless and just pollutes the minidumps.
+  // We thus test the stack pointer and exclude any threads that are part of
+  // the seccomp sandbox's trusted code.
+#if defined(__i386)
+  if (!regs_cache_[index].esp) {
+#elif defined(__x86_64)
+  if (!regs_cache_[index].rsp) {
+#endif
+    sys_ptrace(PTRACE_DETACH, tid, NULL, NULL);
+    return false;
+  }
+#endif
+  return true;
+}
+
 bool LinuxPtraceDumper::ThreadsSuspend() {
   if (threads_suspended_)
     return true;
+  // Issue every PTRACE_ATTACH before waiting for any thread to stop.
+  // An attach is asynchronous - the kernel queues the stop and the
+  // thread parks at its next scheduling point - so attaching them all
+  // first lets the threads stop in parallel. Attaching and waiting one
+  // thread at a time serializes those kernel round trips, and dominates
+  // the stop-the-world window on processes with hundreds of threads.
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    // This may fail if the thread has just died or is being debugged;
+    // it is OK to silently drop such a thread from the minidump.
+    errno = 0;
+    if (sys_ptrace(PTRACE_ATTACH, threads_[i], NULL, NULL) != 0 &&
+        errno != 0) {
+      DropThread(i);
+      --i;
+    }
+  }
+  regs_cache_ = reinterpret_cast<ThreadRegs*>(
+      allocator_.Alloc(sizeof(ThreadRegs) * threads_.size()));
+  // Reap the stop notifications. By the time the attach loop finishes,
+  // the earliest threads have typically parked already, so most of
+  // these waits return without blocking. Threads that fail to stop, or
+  // that belong to the seccomp sandbox's trusted code, are dropped.
   for (size_t i = 0; i < threads_.size(); ++i) {
-    if (!SuspendThread(threads_[i])) {
-      // If the thread either disappeared before we could attach to it, or if
-      // it was part of the seccomp sandbox's trusted code, it is OK to
-      // silently drop it from the minidump.
-      my_memmove(&threads_[i], &threads_[i+1],
-                 (threads_.size() - i - 1) * sizeof(threads_[i]));
-      threads_.resize(threads_.size() - 1);
+    if (!WaitForThreadToStop(i)) {
+      DropThread(i);
       --i;
     }
   }
@@ -252,9 +346,68 @@ bool LinuxPtraceDumper::ThreadsResume() {
   for (size_t i = 0; i < threads_.size(); ++i)
     good &= ResumeThread(threads_[i]);
   threads_suspended_ = false;
+  // The cached registers are stale once the threads run again. The
+  // memory itself stays with allocator_ until the dumper is destroyed.
+  regs_cache_ = NULL;
   return good;
 }
 
+bool LinuxPtraceDumper::CaptureThreadsAndResume() {
+  if (!threads_suspended_)
+    return false;
+
+  CapturedThread* const captured = reinterpret_cast<CapturedThread*>(
+      allocator_.Alloc(sizeof(CapturedThread) * threads_.size()));
+  if (!captured)
+    return false;
+
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    CapturedThread* const entry = &captured[i];
+    // |captured_threads_| is still NULL here, so this queries the
+    // suspended thread rather than the table being built.
+    if (!GetThreadInfoByIndex(i, &entry->info))
+      return false;
+    entry->stack_addr = NULL;
+    entry->stack_len = 0;
+    entry->stack_copy = NULL;
+
+    const void* stack;
+    size_t stack_len;
+    if (GetStackInfo(&stack, &stack_len, entry->info.stack_pointer)) {
+      entry->stack_copy =
+          reinterpret_cast<uint8_t*>(allocator_.Alloc(stack_len));
+      if (!entry->stack_copy)
+        return false;
+      CopyFromProcess(entry->stack_copy, threads_[i], stack, stack_len);
+      entry->stack_addr = stack;
+      entry->stack_len = stack_len;
+    }
+    // A thread whose stack cannot be located keeps an empty stack
+    // record, exactly as the conventional path would write for it.
+  }
+
+  // Publish the table only once it is complete, then let the process
+  // run again. Everything the writer reads about threads from here on
+  // comes from the copies.
+  captured_threads_ = captured;
+  return ThreadsResume();
+}
+
+const void* LinuxPtraceDumper::GetMemoryView(const void* src, size_t length) {
+  if (!captured_threads_)
+    return NULL;
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(src);
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    const CapturedThread& entry = captured_threads_[i];
+    const uintptr_t start = reinterpret_cast<uintptr_t>(entry.stack_addr);
+    if (entry.stack_len && addr >= start && length <= entry.stack_len &&
+        addr - start <= entry.stack_len - length) {
+      return entry.stack_copy + (addr - start);
+    }
+  }
+  return NULL;
+}
+
 // Parse /proc/$pid/task to list all the threads of the process identified by
 // pid.
 bool LinuxPtraceDumper::EnumerateThreads() {
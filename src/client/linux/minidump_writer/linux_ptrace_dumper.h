@@ -54,8 +54,9 @@ class LinuxPtraceDumper : public LinuxDumper {
 
   // Implements LinuxDumper::CopyFromProcess().
   // Copies content of |length| bytes from a given process |child|,
-  // starting from |src|, into |dest|. This method uses ptrace to extract
-  // the content from the target process.
+  // starting from |src|, into |dest|. This method reads the content in
+  // bulk from /proc/<child>/mem where possible, and falls back on
+  // extracting it word by word via ptrace.
   virtual void CopyFromProcess(void* dest, pid_t child, const void* src,
                                size_t length);
 
@@ -71,20 +72,94 @@ class LinuxPtraceDumper : public LinuxDumper {
 
   // Implements LinuxDumper::ThreadsSuspend().
   // Suspends all threads in the given process. Returns true on success.
+  // Attaches to every thread before waiting for any of them to stop, so
+  // the threads park in parallel rather than one kernel round trip at a
+  // time; the stop-the-world window grows far slower with thread count
+  // than a serial attach-and-wait per thread would.
   virtual bool ThreadsSuspend();
 
   // Implements LinuxDumper::ThreadsResume().
   // Resumes all threads in the given process. Returns true on success.
   virtual bool ThreadsResume();
 
+  // Implements LinuxDumper::CaptureThreadsAndResume().
+  // Copies every thread's full register state and its live stack region
+  // into buffers allocated from |allocator_| and detaches from the
+  // threads, shrinking the stopped window to the capture itself.
+  // GetThreadInfoByIndex() and stack reads are then served from the
+  // copies; reads outside them (app memory, the DSO debug list, memory
+  // around the instruction pointer) still go to /proc/<pid>/mem of the
+  // now-running process. Returns false, leaving the threads suspended,
+  // if any thread's state cannot be captured.
+  virtual bool CaptureThreadsAndResume();
+
+  // Implements LinuxDumper::GetMemoryView().
+  // After CaptureThreadsAndResume(), serves requests that fall inside a
+  // captured stack region from the local copy; returns NULL otherwise.
+  virtual const void* GetMemoryView(const void* src, size_t length);
+
  protected:
   // Implements LinuxDumper::EnumerateThreads().
   // Enumerates all threads of the given process into |threads_|.
   virtual bool EnumerateThreads();
 
  private:
+  // The general-purpose register set PTRACE_GETREGS returns on this
+  // architecture; matches the |regs| member of ThreadInfo.
+#if defined(__i386) || defined(__x86_64)
+  typedef user_regs_struct ThreadRegs;
+#elif defined(__ARM_EABI__)
+  typedef struct user_regs ThreadRegs;
+#endif
+
+  // Removes |threads_[index]| (and its cached register set, if any)
+  // from the thread list, e.g. because the thread exited before we
+  // could attach to it.
+  void DropThread(size_t index);
+
+  // Waits for |threads_[index]| to stop after PTRACE_ATTACH and
+  // captures its general-purpose registers into |regs_cache_|. Detaches
+  // and returns false if the wait or register read fails, or if the
+  // thread is part of the seccomp sandbox's trusted code.
+  bool WaitForThreadToStop(size_t index);
+
+  // Copies |length| bytes at |src| in |child| into |dest| with large
+  // pread calls on /proc/<child>/mem, replacing one ptrace syscall per
+  // word with one syscall per region. Returns false, leaving |dest| in
+  // an undefined state, if the file cannot be opened or any read fails;
+  // some kernels refuse reads from /proc/<pid>/mem entirely.
+  bool CopyFromProcessByProcMem(void* dest, pid_t child, const void* src,
+                                size_t length);
+
+  // Copies |length| bytes at |src| in |child| into |dest| one word at a
+  // time with PTRACE_PEEKDATA, zero-filling words that cannot be read.
+  // Works anywhere ptrace attachment does, at one syscall per word.
+  void CopyFromProcessByPtrace(void* dest, pid_t child, const void* src,
+                               size_t length);
+
   // Set to true if all threads of the crashed process are suspended.
   bool threads_suspended_;
+
+  // General-purpose register sets captured while reaping the stop
+  // notifications in ThreadsSuspend(), one entry per entry of
+  // |threads_|, allocated from |allocator_|. GetThreadInfoByIndex()
+  // serves register reads from here instead of issuing another
+  // PTRACE_GETREGS per thread. NULL while threads are not suspended.
+  ThreadRegs* regs_cache_;
+
+  // One entry per entry of |threads_|, filled by
+  // CaptureThreadsAndResume() before it detaches: the thread's full
+  // register state and a copy of its live stack, all allocated from
+  // |allocator_|. |stack_len| is 0 for threads whose stack could not be
+  // located, matching the empty stack record the conventional path
+  // writes for them. NULL until a capture has been taken.
+  struct CapturedThread {
+    ThreadInfo info;
+    const void* stack_addr;  // address of the stack in the dumped process
+    size_t stack_len;        // bytes of stack captured
+    uint8_t* stack_copy;     // local copy of the stack
+  };
+  CapturedThread* captured_threads_;
 };
 
 }  // namespace google_breakpad
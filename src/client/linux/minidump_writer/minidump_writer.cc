@@ -80,10 +80,13 @@ using google_breakpad::LineReader;
 using google_breakpad::LinuxDumper;
 using google_breakpad::LinuxPtraceDumper;
 using google_breakpad::MappingEntry;
+using google_breakpad::MappingFilter;
 using google_breakpad::MappingInfo;
 using google_breakpad::MappingList;
+using google_breakpad::MappingRange;
 using google_breakpad::MinidumpFileWriter;
 using google_breakpad::PageAllocator;
+using google_breakpad::ProcSnapshot;
 using google_breakpad::ThreadInfo;
 using google_breakpad::TypedMDRVA;
 using google_breakpad::UntypedMDRVA;
@@ -374,6 +377,65 @@ void CPUFillFromUContext(MDRawContextARM* out, const ucontext* uc,
 #error "This code has not been ported to your platform yet."
 #endif
 
+// Reads the dynamic linker's link_map chain out of the crashed process.
+//
+// The chain has one node per loaded DSO, so following it naively costs
+// one CopyFromProcess - a syscall round trip into the stopped process -
+// per node, and the DSO debug stream walks the chain twice. The loader
+// allocates the nodes from a small number of contiguous arenas, so this
+// reader pulls the region starting at each node into a local chunk with
+// a single CopyFromProcess and serves later nodes from that copy,
+// refilling only when the chain jumps outside the cached range. Nodes
+// in unreadable memory come back zero-filled either way, because
+// CopyFromProcess zero-fills what it cannot read. The chunk lives in
+// the dumper's page allocator; this code runs in the crashed process
+// and must not touch the heap.
+class LinkMapReader {
+ public:
+  LinkMapReader(LinuxDumper* dumper, pid_t tid)
+      : dumper_(dumper),
+        tid_(tid),
+        chunk_(reinterpret_cast<uint8_t*>(
+            dumper->allocator()->Alloc(kChunkSize))),
+        chunk_start_(0) {}
+
+  // Copy the link_map node at remote address |ptr| into |map|.
+  void ReadNode(const struct link_map* ptr, struct link_map* map) {
+    if (!chunk_) {
+      // The allocator failed; read the node directly.
+      dumper_->CopyFromProcess(map, tid_, ptr, sizeof(*map));
+      return;
+    }
+    uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+    if (!Cached(address, sizeof(*map))) {
+      // Start the chunk at the node rather than centering it on it: the
+      // loader hands out nodes in allocation order, so the rest of the
+      // chain usually lies ahead of this one.
+      chunk_start_ = address;
+      dumper_->CopyFromProcess(chunk_, tid_,
+                               reinterpret_cast<const void*>(chunk_start_),
+                               kChunkSize);
+    }
+    my_memcpy(map, chunk_ + (address - chunk_start_), sizeof(*map));
+  }
+
+ private:
+  bool Cached(uintptr_t address, size_t length) const {
+    return chunk_start_ != 0 &&
+        address >= chunk_start_ &&
+        address - chunk_start_ <= kChunkSize - length;
+  }
+
+  // Covers a few dozen nodes per refill; a process with hundreds of
+  // DSOs takes a handful of remote reads per pass instead of hundreds.
+  static const size_t kChunkSize = 16384;
+
+  LinuxDumper* const dumper_;
+  const pid_t tid_;
+  uint8_t* const chunk_;
+  uintptr_t chunk_start_;
+};
+
 class MinidumpWriter {
  public:
   // The following kLimit* constants are for when minidump_size_limit_ is set
@@ -397,6 +459,10 @@ class MinidumpWriter {
                  const ExceptionHandler::CrashContext* context,
                  const MappingList& mappings,
                  const AppMemoryList& appmem,
+                 bool triage_mode,
+                 bool copy_then_resume,
+                 bool full_memory,
+                 bool async_writes,
                  LinuxDumper* dumper)
       : fd_(minidump_fd),
         path_(minidump_path),
@@ -409,6 +475,10 @@ class MinidumpWriter {
 #endif
         dumper_(dumper),
         minidump_size_limit_(-1),
+        triage_mode_(triage_mode),
+        copy_then_resume_(copy_then_resume),
+        full_memory_(full_memory),
+        async_writes_(async_writes),
         memory_blocks_(dumper_->allocator()),
         mapping_list_(mappings),
         app_memory_list_(appmem) {
@@ -426,7 +496,27 @@ class MinidumpWriter {
     else if (!minidump_writer_.Open(path_))
       return false;
 
-    return dumper_->ThreadsSuspend();
+    // Stage the dump in memory and write it out in a few large calls
+    // instead of an ftruncate per stream and a seek/write pair per copy.
+    // The estimate scales with the thread count, since stacks dominate;
+    // the arena grows if it proves too small, and if it cannot be mapped
+    // at all the writer falls back to direct file writes.
+    const size_t buffer_estimate = kLimitMinidumpFudgeFactor +
+        dumper_->threads().size() * 4 * kLimitAverageThreadStackLength;
+    minidump_writer_.EnableBuffering(buffer_estimate);
+    if (async_writes_)
+      minidump_writer_.EnableAsyncWrites();
+
+    if (!dumper_->ThreadsSuspend())
+      return false;
+
+    if (copy_then_resume_) {
+      // Best effort: if the capture cannot be completed, the threads
+      // simply stay suspended and the dump is written the conventional
+      // way.
+      dumper_->CaptureThreadsAndResume();
+    }
+    return true;
   }
 
   ~MinidumpWriter() {
@@ -439,8 +529,11 @@ class MinidumpWriter {
 
   bool Dump() {
     // A minidump file contains a number of tagged streams. This is the number
-    // of stream which we write.
-    unsigned kNumWriters = 13;
+    // of stream which we write. In triage mode only the streams the
+    // processor needs for a first-pass signature - crashing thread,
+    // module list, exception and system info - are written; full-memory
+    // capture adds a MEMORY_64_LIST stream on top of the usual set.
+    unsigned kNumWriters = triage_mode_ ? 4 : (full_memory_ ? 15 : 14);
 
     TypedMDRVA<MDRawHeader> header(&minidump_writer_);
     TypedMDRVA<MDRawDirectory> dir(&minidump_writer_);
@@ -467,12 +560,14 @@ class MinidumpWriter {
       return false;
     dir.CopyIndex(dir_index++, &dirent);
 
-    if (!WriteAppMemory())
-      return false;
+    if (!triage_mode_) {
+      if (!WriteAppMemory())
+        return false;
 
-    if (!WriteMemoryListStream(&dirent))
-      return false;
-    dir.CopyIndex(dir_index++, &dirent);
+      if (!WriteMemoryListStream(&dirent))
+        return false;
+      dir.CopyIndex(dir_index++, &dirent);
+    }
 
     if (!WriteExceptionStream(&dirent))
       return false;
@@ -482,6 +577,12 @@ class MinidumpWriter {
       return false;
     dir.CopyIndex(dir_index++, &dirent);
 
+    if (triage_mode_) {
+      // The remaining streams are skipped; see kNumWriters above.
+      dumper_->ThreadsResume();
+      return true;
+    }
+
     dirent.stream_type = MD_LINUX_CPU_INFO;
     if (!WriteFile(&dirent.location, "/proc/cpuinfo"))
       NullifyDirectoryEntry(&dirent);
@@ -522,6 +623,20 @@ class MinidumpWriter {
       NullifyDirectoryEntry(&dirent);
     dir.CopyIndex(dir_index++, &dirent);
 
+    dirent.stream_type = MD_IP_TRACE_STREAM;
+    if (!WriteIPTraceStream(&dirent))
+      NullifyDirectoryEntry(&dirent);
+    dir.CopyIndex(dir_index++, &dirent);
+
+    // Written last so the bulk of the file is one long sequential run
+    // of region payloads.
+    if (full_memory_) {
+      dirent.stream_type = MD_MEMORY_64_LIST_STREAM;
+      if (!WriteFullMemoryStream(&dirent))
+        NullifyDirectoryEntry(&dirent);
+      dir.CopyIndex(dir_index++, &dirent);
+    }
+
     // If you add more directory entries, don't forget to update kNumWriters,
     // above.
 
@@ -659,9 +774,19 @@ class MinidumpWriter {
       }
       if (!memory.Allocate(stack_len))
         return false;
-      *stack_copy = reinterpret_cast<uint8_t*>(Alloc(stack_len));
-      dumper_->CopyFromProcess(*stack_copy, thread->thread_id, stack,
-                               stack_len);
+      // When the dumper can expose the stack contents directly (e.g. from
+      // a memory-mapped core file), write them straight to the minidump
+      // and skip the intermediate copy. PopSeccompStackFrame only reads
+      // through |stack_copy|, so pointing it into the mapping is safe.
+      const void* stack_view = dumper_->GetMemoryView(stack, stack_len);
+      if (stack_view) {
+        *stack_copy =
+            reinterpret_cast<uint8_t*>(const_cast<void*>(stack_view));
+      } else {
+        *stack_copy = reinterpret_cast<uint8_t*>(Alloc(stack_len));
+        dumper_->CopyFromProcess(*stack_copy, thread->thread_id, stack,
+                                 stack_len);
+      }
       memory.Copy(*stack_copy, stack_len);
       thread->stack.start_of_memory_range =
           reinterpret_cast<uintptr_t>(stack);
@@ -679,14 +804,32 @@ class MinidumpWriter {
   bool WriteThreadListStream(MDRawDirectory* dirent) {
     const unsigned num_threads = dumper_->threads().size();
 
+    // In triage mode only the crashing thread is written: its context
+    // comes from the signal handler and its stack is the one worth
+    // uploading. If the crashing thread somehow isn't in the thread
+    // list, fall back to writing all of them.
+    bool crash_thread_only = false;
+    unsigned num_output_threads = num_threads;
+    if (triage_mode_) {
+      unsigned crash_thread_count = 0;
+      for (unsigned i = 0; i < num_threads; ++i) {
+        if (static_cast<pid_t>(dumper_->threads()[i]) == GetCrashThread())
+          ++crash_thread_count;
+      }
+      if (crash_thread_count) {
+        crash_thread_only = true;
+        num_output_threads = crash_thread_count;
+      }
+    }
+
     TypedMDRVA<uint32_t> list(&minidump_writer_);
-    if (!list.AllocateObjectAndArray(num_threads, sizeof(MDRawThread)))
+    if (!list.AllocateObjectAndArray(num_output_threads, sizeof(MDRawThread)))
       return false;
 
     dirent->stream_type = MD_THREAD_LIST_STREAM;
     dirent->location = list.location();
 
-    *list.get() = num_threads;
+    *list.get() = num_output_threads;
 
     // If there's a minidump size limit, check if it might be exceeded.  Since
     // most of the space is filled with stack data, just check against that.
@@ -703,11 +846,17 @@ class MinidumpWriter {
         extra_thread_stack_len = kLimitMaxExtraThreadStackLen;
     }
 
+    unsigned output_index = 0;
     for (unsigned i = 0; i < num_threads; ++i) {
       MDRawThread thread;
       my_memset(&thread, 0, sizeof(thread));
       thread.thread_id = dumper_->threads()[i];
 
+      if (crash_thread_only &&
+          static_cast<pid_t>(thread.thread_id) != GetCrashThread()) {
+        continue;
+      }
+
       // We have a different source of information for the crashing thread. If
       // we used the actual state of the thread we would find it running in the
       // signal handler with the alternative stack, which would be deeply
@@ -750,14 +899,21 @@ class MinidumpWriter {
           UntypedMDRVA ip_memory(&minidump_writer_);
           if (!ip_memory.Allocate(ip_memory_d.memory.data_size))
             return false;
-          uint8_t* memory_copy =
-              reinterpret_cast<uint8_t*>(Alloc(ip_memory_d.memory.data_size));
-          dumper_->CopyFromProcess(
-              memory_copy,
-              thread.thread_id,
+          const void* ip_view = dumper_->GetMemoryView(
               reinterpret_cast<void*>(ip_memory_d.start_of_memory_range),
               ip_memory_d.memory.data_size);
-          ip_memory.Copy(memory_copy, ip_memory_d.memory.data_size);
+          if (ip_view) {
+            ip_memory.Copy(ip_view, ip_memory_d.memory.data_size);
+          } else {
+            uint8_t* memory_copy =
+                reinterpret_cast<uint8_t*>(Alloc(ip_memory_d.memory.data_size));
+            dumper_->CopyFromProcess(
+                memory_copy,
+                thread.thread_id,
+                reinterpret_cast<void*>(ip_memory_d.start_of_memory_range),
+                ip_memory_d.memory.data_size);
+            ip_memory.Copy(memory_copy, ip_memory_d.memory.data_size);
+          }
           ip_memory_d.memory = ip_memory.location();
           memory_blocks_.push_back(ip_memory_d);
         }
@@ -803,7 +959,7 @@ class MinidumpWriter {
         }
       }
 
-      list.CopyIndexAfterObject(i, &thread, sizeof(thread));
+      list.CopyIndexAfterObject(output_index++, &thread, sizeof(thread));
     }
 
     return true;
@@ -814,16 +970,20 @@ class MinidumpWriter {
     for (AppMemoryList::const_iterator iter = app_memory_list_.begin();
          iter != app_memory_list_.end();
          ++iter) {
-      uint8_t* data_copy =
-        reinterpret_cast<uint8_t*>(dumper_->allocator()->Alloc(iter->length));
-      dumper_->CopyFromProcess(data_copy, GetCrashThread(), iter->ptr,
-                               iter->length);
-
       UntypedMDRVA memory(&minidump_writer_);
       if (!memory.Allocate(iter->length)) {
         return false;
       }
-      memory.Copy(data_copy, iter->length);
+      const void* data_view = dumper_->GetMemoryView(iter->ptr, iter->length);
+      if (data_view) {
+        memory.Copy(data_view, iter->length);
+      } else {
+        uint8_t* data_copy =
+          reinterpret_cast<uint8_t*>(dumper_->allocator()->Alloc(iter->length));
+        dumper_->CopyFromProcess(data_copy, GetCrashThread(), iter->ptr,
+                                 iter->length);
+        memory.Copy(data_copy, iter->length);
+      }
       MDMemoryDescriptor desc;
       desc.start_of_memory_range = reinterpret_cast<uintptr_t>(iter->ptr);
       desc.memory = memory.location();
@@ -998,6 +1158,122 @@ class MinidumpWriter {
     return true;
   }
 
+  // Writes every writable mapping of the process as an
+  // MD_MEMORY_64_LIST_STREAM: a descriptor table followed by the
+  // regions' bytes laid out back to back. This gives the dump
+  // core-level fidelity for post-crash heap analysis at minidump write
+  // speeds: each region is one large sequential write, filled either
+  // straight from a post-mortem dumper's memory view or bulk-copied
+  // through the dumper's /proc/<pid>/mem path a megabyte at a time,
+  // and the payload starts on a page boundary. Only called when the
+  // caller asked for full-memory capture; fails, leaving the stream
+  // out of the dump, when no writable mappings are known (a dumper
+  // initialized from a ProcSnapshot records none).
+  bool WriteFullMemoryStream(MDRawDirectory* dirent) {
+    const wasteful_vector<MappingRange>& ranges = dumper_->writable_ranges();
+    if (ranges.empty())
+      return false;
+
+    // An MDRVA is 32 bits wide, so the whole file must stay below 4GB;
+    // a caller-set size limit lowers the budget further. Regions that
+    // would overrun the budget are dropped whole - never truncated -
+    // so every descriptor written covers exactly the bytes recorded
+    // for it. |payload_start| is a worst-case estimate assuming all
+    // regions get a descriptor.
+    uint64_t budget = 0xffffffffu;
+    if (minidump_size_limit_ >= 0 &&
+        static_cast<uint64_t>(minidump_size_limit_) < budget) {
+      budget = static_cast<uint64_t>(minidump_size_limit_);
+    }
+    const uint64_t kPageMask = getpagesize() - 1;
+    const uint64_t payload_start =
+        (minidump_writer_.position() + MDRawMemory64List_minsize +
+         static_cast<uint64_t>(ranges.size()) * sizeof(MDMemoryDescriptor64) +
+         kPageMask) & ~kPageMask;
+
+    bool* included = reinterpret_cast<bool*>(Alloc(ranges.size()));
+    size_t range_count = 0;
+    uint64_t payload_size = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      included[i] =
+          payload_start + payload_size + ranges[i].size <= budget;
+      if (included[i]) {
+        payload_size += ranges[i].size;
+        range_count++;
+      }
+    }
+    if (!range_count)
+      return false;
+
+    TypedMDRVA<MDRawMemory64List> list(&minidump_writer_);
+    if (!list.AllocateObjectAndArray(range_count,
+                                     sizeof(MDMemoryDescriptor64)))
+      return false;
+
+    // Step up to the next page boundary so the large region writes
+    // below are page-aligned in the file.
+    const MDRVA unaligned = minidump_writer_.position();
+    const MDRVA aligned =
+        static_cast<MDRVA>((unaligned + kPageMask) & ~kPageMask);
+    if (aligned != unaligned) {
+      UntypedMDRVA padding(&minidump_writer_);
+      if (!padding.Allocate(aligned - unaligned))
+        return false;
+    }
+
+    dirent->stream_type = MD_MEMORY_64_LIST_STREAM;
+    dirent->location = list.location();
+
+    list.get()->number_of_memory_ranges = range_count;
+    list.get()->base_rva = aligned;
+
+    const size_t kChunkSize = 1024 * 1024;
+    uint8_t* buffer = NULL;
+
+    unsigned int index = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      if (!included[i])
+        continue;
+      MDMemoryDescriptor64 desc;
+      desc.start_of_memory_range = ranges[i].start_addr;
+      desc.data_size = ranges[i].size;
+      if (!list.CopyIndexAfterObject(index++, &desc, sizeof(desc)))
+        return false;
+
+      UntypedMDRVA region(&minidump_writer_);
+      if (!region.Allocate(ranges[i].size))
+        return false;
+      const void* view = dumper_->GetMemoryView(
+          reinterpret_cast<const void*>(ranges[i].start_addr),
+          ranges[i].size);
+      if (view) {
+        // A post-mortem dumper serves the bytes straight from the
+        // mapped core; no intermediate copy at all.
+        if (!region.Copy(view, ranges[i].size))
+          return false;
+        continue;
+      }
+      if (!buffer)
+        buffer = reinterpret_cast<uint8_t*>(Alloc(kChunkSize));
+      size_t done = 0;
+      while (done < ranges[i].size) {
+        size_t chunk = ranges[i].size - done;
+        if (chunk > kChunkSize)
+          chunk = kChunkSize;
+        // CopyFromProcess zero-fills anything the kernel refuses to
+        // read, so the recorded size stays true.
+        dumper_->CopyFromProcess(
+            buffer, GetCrashThread(),
+            reinterpret_cast<const void*>(ranges[i].start_addr + done),
+            chunk);
+        if (!region.Copy(region.position() + done, buffer, chunk))
+          return false;
+        done += chunk;
+      }
+    }
+    return true;
+  }
+
   bool WriteExceptionStream(MDRawDirectory* dirent) {
     TypedMDRVA<MDRawExceptionStream> exc(&minidump_writer_);
     if (!exc.Allocate())
@@ -1030,6 +1306,69 @@ class MinidumpWriter {
     return true;
   }
 
+  // Writes the crashing thread's raw frame-pointer-chain instruction
+  // pointers as an MD_IP_TRACE_STREAM. Collecting the chain costs a
+  // handful of word reads here, and lets a processor that trusts it
+  // symbolize the crash directly instead of walking and scanning the
+  // thread's stack. Only written for a live x86/x86-64 crash with a
+  // crash context; when absent the processor walks the stack as usual.
+  bool WriteIPTraceStream(MDRawDirectory* dirent) {
+#if defined(__i386) || defined(__x86_64)
+    if (!ucontext_ || dumper_->IsPostMortem())
+      return false;
+
+    static const unsigned kMaxIPs = 64;
+    uint64_t ips[kMaxIPs];
+    unsigned ip_count = 0;
+    ips[ip_count++] = GetInstructionPointer();
+
+    // A frame pointer that leaves the thread's stack ends the chain.
+    const void* stack;
+    size_t stack_len;
+    if (!dumper_->GetStackInfo(&stack, &stack_len, GetStackPointer()))
+      return false;
+    const uintptr_t stack_low = reinterpret_cast<uintptr_t>(stack);
+    const uintptr_t stack_high = stack_low + stack_len;
+
+    uintptr_t fp = GetFramePointer();
+    while (ip_count < kMaxIPs) {
+      // Each frame holds the caller's frame pointer, with the return
+      // address in the word above it.
+      if (fp < stack_low || fp + 2 * sizeof(uintptr_t) > stack_high ||
+          fp % sizeof(uintptr_t))
+        break;
+      uintptr_t frame[2];
+      dumper_->CopyFromProcess(frame, GetCrashThread(),
+                               reinterpret_cast<void*>(fp), sizeof(frame));
+      if (!frame[1])
+        break;
+      ips[ip_count++] = frame[1];
+      // Frame pointers must strictly increase towards the stack base,
+      // or a corrupt chain could cycle forever.
+      if (frame[0] <= fp)
+        break;
+      fp = frame[0];
+    }
+
+    TypedMDRVA<MDRawIPTrace> trace(&minidump_writer_);
+    if (!trace.AllocateObjectAndArray(ip_count, sizeof(uint64_t)))
+      return false;
+    trace.get()->thread_id = GetCrashThread();
+    trace.get()->ip_count = ip_count;
+    for (unsigned i = 0; i < ip_count; ++i) {
+      if (!trace.CopyIndexAfterObject(i, &ips[i], sizeof(uint64_t)))
+        return false;
+    }
+
+    dirent->stream_type = MD_IP_TRACE_STREAM;
+    dirent->location = trace.location();
+    return true;
+#else
+    // Other architectures do not keep a plain frame-pointer chain.
+    return false;
+#endif
+  }
+
   bool WriteDSODebugStream(MDRawDirectory* dirent) {
     ElfW(Phdr)* phdr = reinterpret_cast<ElfW(Phdr) *>(dumper_->auxv()[AT_PHDR]);
     char* base;
@@ -1086,14 +1425,17 @@ class MinidumpWriter {
     // See <link.h> for a more detailed discussion of the how the dynamic
     // loader communicates with debuggers.
 
-    // Count the number of loaded DSOs
+    // Count the number of loaded DSOs. Both walks of the chain go
+    // through a chunk-caching reader so that a process with hundreds of
+    // DSOs does not pay a remote read per node.
     int dso_count = 0;
     struct r_debug debug_entry;
     dumper_->CopyFromProcess(&debug_entry, GetCrashThread(), r_debug,
                              sizeof(debug_entry));
+    LinkMapReader link_map_reader(dumper_, GetCrashThread());
     for (struct link_map* ptr = debug_entry.r_map; ptr; ) {
       struct link_map map;
-      dumper_->CopyFromProcess(&map, GetCrashThread(), ptr, sizeof(map));
+      link_map_reader.ReadNode(ptr, &map);
       ptr = map.l_next;
       dso_count++;
     }
@@ -1108,10 +1450,11 @@ class MinidumpWriter {
       linkmap_rva = linkmap.location().rva;
       int idx = 0;
 
-      // Iterate over DSOs and write their information to mini dump
+      // Iterate over DSOs and write their information to mini dump.
+      // The reader's chunk is still warm from the counting pass.
       for (struct link_map* ptr = debug_entry.r_map; ptr; ) {
         struct link_map map;
-        dumper_->CopyFromProcess(&map, GetCrashThread(), ptr, sizeof(map));
+        link_map_reader.ReadNode(ptr, &map);
         ptr = map.l_next;
         char filename[257] = { 0 };
         if (map.l_name) {
@@ -1175,6 +1518,10 @@ class MinidumpWriter {
   uintptr_t GetInstructionPointer(const ThreadInfo& info) {
     return info.regs.eip;
   }
+
+  uintptr_t GetFramePointer() {
+    return ucontext_->uc_mcontext.gregs[REG_EBP];
+  }
 #elif defined(__x86_64)
   uintptr_t GetStackPointer() {
     return ucontext_->uc_mcontext.gregs[REG_RSP];
@@ -1187,6 +1534,10 @@ class MinidumpWriter {
   uintptr_t GetInstructionPointer(const ThreadInfo& info) {
     return info.regs.rip;
   }
+
+  uintptr_t GetFramePointer() {
+    return ucontext_->uc_mcontext.gregs[REG_RBP];
+  }
 #elif defined(__ARM_EABI__)
   uintptr_t GetStackPointer() {
     return ucontext_->uc_mcontext.arm_sp;
@@ -1484,6 +1835,18 @@ class MinidumpWriter {
   LinuxDumper* dumper_;
   MinidumpFileWriter minidump_writer_;
   off_t minidump_size_limit_;
+  // When set, only the streams needed to triage the crash - crashing
+  // thread, module list, exception and system info - are written.
+  bool triage_mode_;
+  // Whether Init() captures thread state and resumes the threads before
+  // the dump is serialized. See LinuxDumper::CaptureThreadsAndResume.
+  bool copy_then_resume_;
+  // Whether the dump carries every writable mapping of the process as
+  // an MD_MEMORY_64_LIST_STREAM. See WriteFullMemoryStream.
+  bool full_memory_;
+  // Whether the staged dump is flushed through io_uring. See
+  // MinidumpFileWriter::EnableAsyncWrites.
+  bool async_writes_;
   MDLocationDescriptor crashing_thread_context_;
   // Blocks of memory written to the dump. These are all currently
   // written while writing the thread list stream, but saved here
@@ -1503,8 +1866,30 @@ bool WriteMinidumpImpl(const char* minidump_path,
                        pid_t crashing_process,
                        const void* blob, size_t blob_size,
                        const MappingList& mappings,
-                       const AppMemoryList& appmem) {
+                       const AppMemoryList& appmem,
+                       const ProcSnapshot* snapshot,
+                       ssize_t stack_capture_limit,
+                       bool trim_stack_to_sp,
+                       bool triage_mode,
+                       bool copy_then_resume,
+                       bool full_memory,
+                       bool async_writes,
+                       MappingFilter mapping_filter,
+                       void* mapping_filter_context) {
   LinuxPtraceDumper dumper(crashing_process);
+  // One up-front mapping covers the dumper's usual allocations - the
+  // /proc/<pid>/maps slurp, thread info and stack copies - so the
+  // crash-time mmap count stays at one for typical processes. The
+  // pages are anonymous and only faulted in as they are used.
+  static const unsigned kAllocatorReserve = 2 * 1024 * 1024;
+  dumper.allocator()->Reserve(kAllocatorReserve);
+  if (snapshot)
+    dumper.set_proc_snapshot(snapshot);
+  if (stack_capture_limit >= 0)
+    dumper.set_stack_capture_limit(stack_capture_limit);
+  dumper.set_trim_stack_to_sp(trim_stack_to_sp);
+  if (mapping_filter)
+    dumper.set_mapping_filter(mapping_filter, mapping_filter_context);
   const ExceptionHandler::CrashContext* context = NULL;
   if (blob) {
     if (blob_size != sizeof(ExceptionHandler::CrashContext))
@@ -1516,7 +1901,8 @@ bool WriteMinidumpImpl(const char* minidump_path,
     dumper.set_crash_thread(context->tid);
   }
   MinidumpWriter writer(minidump_path, minidump_fd, context, mappings,
-                        appmem, &dumper);
+                        appmem, triage_mode, copy_then_resume, full_memory,
+                        async_writes, &dumper);
   // Set desired limit for file size of minidump (-1 means no limit).
   writer.set_minidump_size_limit(minidump_size_limit);
   if (!writer.Init())
@@ -1532,14 +1918,25 @@ bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
                    const void* blob, size_t blob_size) {
   return WriteMinidumpImpl(minidump_path, -1, -1,
                            crashing_process, blob, blob_size,
-                           MappingList(), AppMemoryList());
+                           MappingList(), AppMemoryList(), NULL, -1, false,
+                           false, false, false, false, NULL, NULL);
 }
 
 bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                    const void* blob, size_t blob_size) {
   return WriteMinidumpImpl(NULL, minidump_fd, -1,
                            crashing_process, blob, blob_size,
-                           MappingList(), AppMemoryList());
+                           MappingList(), AppMemoryList(), NULL, -1, false,
+                           false, false, false, false, NULL, NULL);
+}
+
+bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
+                   const void* blob, size_t blob_size,
+                   bool async_writes) {
+  return WriteMinidumpImpl(minidump_path, -1, -1,
+                           crashing_process, blob, blob_size,
+                           MappingList(), AppMemoryList(), NULL, -1, false,
+                           false, false, false, async_writes, NULL, NULL);
 }
 
 bool WriteMinidump(const char* minidump_path, pid_t process,
@@ -1549,7 +1946,7 @@ bool WriteMinidump(const char* minidump_path, pid_t process,
   dumper.set_crash_signal(MD_EXCEPTION_CODE_LIN_DUMP_REQUESTED);
   dumper.set_crash_thread(process_blamed_thread);
   MinidumpWriter writer(minidump_path, -1, NULL, MappingList(),
-                        AppMemoryList(), &dumper);
+                        AppMemoryList(), false, false, false, false, &dumper);
   if (!writer.Init())
     return false;
   return writer.Dump();
@@ -1561,7 +1958,8 @@ bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
                    const AppMemoryList& appmem) {
   return WriteMinidumpImpl(minidump_path, -1, -1, crashing_process,
                            blob, blob_size,
-                           mappings, appmem);
+                           mappings, appmem, NULL, -1, false, false, false,
+                           false, false, NULL, NULL);
 }
 
 bool WriteMinidump(int minidump_fd, pid_t crashing_process,
@@ -1570,7 +1968,8 @@ bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                    const AppMemoryList& appmem) {
   return WriteMinidumpImpl(NULL, minidump_fd, -1, crashing_process,
                            blob, blob_size,
-                           mappings, appmem);
+                           mappings, appmem, NULL, -1, false, false, false,
+                           false, false, NULL, NULL);
 }
 
 bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
@@ -1580,7 +1979,8 @@ bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
                    const AppMemoryList& appmem) {
   return WriteMinidumpImpl(minidump_path, -1, minidump_size_limit,
                            crashing_process, blob, blob_size,
-                           mappings, appmem);
+                           mappings, appmem, NULL, -1, false, false, false,
+                           false, false, NULL, NULL);
 }
 
 bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
@@ -1590,14 +1990,58 @@ bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
                    const AppMemoryList& appmem) {
   return WriteMinidumpImpl(NULL, minidump_fd, minidump_size_limit,
                            crashing_process, blob, blob_size,
-                           mappings, appmem);
+                           mappings, appmem, NULL, -1, false, false, false,
+                           false, false, NULL, NULL);
+}
+
+bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
+                   pid_t crashing_process,
+                   const void* blob, size_t blob_size,
+                   const MappingList& mappings,
+                   const AppMemoryList& appmem,
+                   const ProcSnapshot* snapshot,
+                   ssize_t stack_capture_limit,
+                   bool trim_stack_to_sp,
+                   bool triage_mode,
+                   bool copy_then_resume,
+                   bool full_memory,
+                   MappingFilter mapping_filter,
+                   void* mapping_filter_context) {
+  return WriteMinidumpImpl(minidump_path, -1, minidump_size_limit,
+                           crashing_process, blob, blob_size,
+                           mappings, appmem, snapshot,
+                           stack_capture_limit, trim_stack_to_sp,
+                           triage_mode, copy_then_resume, full_memory,
+                           false, mapping_filter, mapping_filter_context);
+}
+
+bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
+                   pid_t crashing_process,
+                   const void* blob, size_t blob_size,
+                   const MappingList& mappings,
+                   const AppMemoryList& appmem,
+                   const ProcSnapshot* snapshot,
+                   ssize_t stack_capture_limit,
+                   bool trim_stack_to_sp,
+                   bool triage_mode,
+                   bool copy_then_resume,
+                   bool full_memory,
+                   MappingFilter mapping_filter,
+                   void* mapping_filter_context) {
+  return WriteMinidumpImpl(NULL, minidump_fd, minidump_size_limit,
+                           crashing_process, blob, blob_size,
+                           mappings, appmem, snapshot,
+                           stack_capture_limit, trim_stack_to_sp,
+                           triage_mode, copy_then_resume, full_memory,
+                           false, mapping_filter, mapping_filter_context);
 }
 
 bool WriteMinidump(const char* filename,
                    const MappingList& mappings,
                    const AppMemoryList& appmem,
                    LinuxDumper* dumper) {
-  MinidumpWriter writer(filename, -1, NULL, mappings, appmem, dumper);
+  MinidumpWriter writer(filename, -1, NULL, mappings, appmem, false, false,
+                        false, false, dumper);
   if (!writer.Init())
     return false;
   return writer.Dump();
@@ -84,6 +84,16 @@ bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
 bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                    const void* blob, size_t blob_size);
 
+// Same as the first form, but when |async_writes| is set the staged
+// dump is flushed through io_uring with several large writes in
+// flight, falling back to synchronous writes on kernels without
+// io_uring. Uses libc, so it is only for out-of-process dump writers
+// such as CrashGenerationServer; see
+// MinidumpFileWriter::EnableAsyncWrites().
+bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
+                   const void* blob, size_t blob_size,
+                   bool async_writes);
+
 // Alternate form of WriteMinidump() that works with processes that
 // are not expected to have crashed.  If |process_blamed_thread| is
 // meaningful, it will be the one from which a crash signature is
@@ -115,6 +125,53 @@ bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
                    const MappingList& mappings,
                    const AppMemoryList& appdata);
 
+// These overloads also allow passing a pre-parsed copy of the crashing
+// process's thread and mapping lists, saving the /proc parsing at dump
+// time, and a stack capture policy. |snapshot| points into the crashing
+// process's address space and may be NULL, in which case /proc is
+// parsed as usual. |stack_capture_limit| bounds the bytes of stack
+// captured per thread, or -1 for the dumper's default;
+// |trim_stack_to_sp| starts each capture just below the thread's stack
+// pointer instead of at a page boundary. |triage_mode| writes only the
+// streams needed to triage the crash: the crashing thread with its
+// context and stack, the module list, the exception record and system
+// info. |copy_then_resume| copies thread state and live stacks into
+// local buffers and resumes the threads before the minidump is
+// serialized, shrinking the stopped window to the capture itself; see
+// LinuxDumper::CaptureThreadsAndResume. |full_memory| additionally
+// captures every writable mapping of the process as a MEMORY_64_LIST
+// stream; see MinidumpDescriptor::set_full_memory(). |mapping_filter|
+// (with
+// |mapping_filter_context|) drops
+// uninteresting mappings as /proc/<pid>/maps is parsed, or may be NULL
+// to record them all; see MappingFilter in linux_dumper.h.
+bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
+                   pid_t crashing_process,
+                   const void* blob, size_t blob_size,
+                   const MappingList& mappings,
+                   const AppMemoryList& appdata,
+                   const ProcSnapshot* snapshot,
+                   ssize_t stack_capture_limit,
+                   bool trim_stack_to_sp,
+                   bool triage_mode,
+                   bool copy_then_resume,
+                   bool full_memory,
+                   MappingFilter mapping_filter,
+                   void* mapping_filter_context);
+bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
+                   pid_t crashing_process,
+                   const void* blob, size_t blob_size,
+                   const MappingList& mappings,
+                   const AppMemoryList& appdata,
+                   const ProcSnapshot* snapshot,
+                   ssize_t stack_capture_limit,
+                   bool trim_stack_to_sp,
+                   bool triage_mode,
+                   bool copy_then_resume,
+                   bool full_memory,
+                   MappingFilter mapping_filter,
+                   void* mapping_filter_context);
+
 bool WriteMinidump(const char* filename,
                    const MappingList& mappings,
                    const AppMemoryList& appdata,
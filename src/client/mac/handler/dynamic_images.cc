@@ -39,6 +39,7 @@ extern "C" { // needed to compile on Leopard
 #include <AvailabilityMacros.h>
 #include <dlfcn.h>
 #include <mach/task_info.h>
+#include <pthread.h>
 #include <sys/sysctl.h>
 #include <TargetConditionals.h>
 #include <unistd.h>
@@ -153,6 +154,7 @@ static mach_vm_size_t GetMemoryRegionSize(task_port_t target_task,
 // Warning!  This will not read any strings longer than kMaxStringLength-1
 //
 static string ReadTaskString(task_port_t target_task,
+                             TaskMemoryBulkReader &reader,
                              const uint64_t address) {
   // The problem is we don't know how much to read until we know how long
   // the string is. And we don't know how long the string is, until we've read
@@ -166,8 +168,7 @@ static string ReadTaskString(task_port_t target_task,
       size_to_end > kMaxStringLength ? kMaxStringLength : size_to_end;
 
     vector<uint8_t> bytes;
-    if (ReadTaskMemory(target_task, address, (size_t)size_to_read, bytes) !=
-        KERN_SUCCESS)
+    if (reader.Read(address, (size_t)size_to_read, bytes) != KERN_SUCCESS)
       return string();
 
     return string(reinterpret_cast<const char*>(&bytes[0]));
@@ -212,6 +213,186 @@ kern_return_t ReadTaskMemory(task_port_t target_task,
   return KERN_SUCCESS;
 }
 
+//==============================================================================
+TaskMemoryBulkReader::TaskMemoryBulkReader(task_port_t target_task)
+    : task_(target_task),
+      chunk_address_(0),
+      chunk_size_(0) {
+}
+
+kern_return_t TaskMemoryBulkReader::Read(const uint64_t address,
+                                         size_t length,
+                                         vector<uint8_t> &bytes) {
+  // Reads bigger than a chunk gain nothing from the arena; pass them
+  // straight through.
+  if (length > kChunkSize)
+    return ReadTaskMemory(task_, address, length, bytes);
+
+  if (chunk_size_ == 0 ||
+      address < chunk_address_ ||
+      address + length > chunk_address_ + chunk_size_) {
+    kern_return_t result = FetchChunk(address, length);
+    if (result != KERN_SUCCESS)
+      return result;
+  }
+
+  bytes.resize(length);
+  memcpy(&bytes[0], &arena_[(size_t)(address - chunk_address_)], length);
+  return KERN_SUCCESS;
+}
+
+kern_return_t TaskMemoryBulkReader::FetchChunk(const uint64_t address,
+                                               size_t length) {
+  // Invalidate the current chunk in case the fetch fails.
+  chunk_size_ = 0;
+
+  // Fetch as much as a chunk holds, but never beyond the end of the
+  // containing vm region, where mach_vm_read would fail.
+  mach_vm_size_t size_to_end = 0;
+  GetMemoryRegionSize(task_, address, &size_to_end);
+
+  mach_vm_size_t fetch_size = kChunkSize;
+  if (size_to_end > 0 && size_to_end < fetch_size)
+    fetch_size = size_to_end;
+  if (fetch_size < length)
+    fetch_size = length;
+
+  kern_return_t result =
+      ReadTaskMemory(task_, address, (size_t)fetch_size, arena_);
+  if (result != KERN_SUCCESS) {
+    // The large read may still have crossed into an unreadable range;
+    // retry with exactly the requested span before giving up.
+    result = ReadTaskMemory(task_, address, length, arena_);
+    if (result != KERN_SUCCESS)
+      return result;
+  }
+
+  chunk_address_ = address;
+  chunk_size_ = arena_.size();
+  return KERN_SUCCESS;
+}
+
+//==============================================================================
+// State behind DyldImageSnapshot. The vector is allocated on Install
+// and mutated only by the dyld callbacks, under the mutex. The crash
+// path takes the mutex with a trylock so a thread suspended mid-update
+// can never hang it.
+
+struct SnapshotImage {
+  const struct mach_header* header;
+  intptr_t slide;
+  string name;
+};
+
+static vector<SnapshotImage>* snapshot_images = NULL;
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool snapshot_acquired = false;
+
+// static
+void DyldImageSnapshot::AddImage(const struct mach_header* header,
+                                 intptr_t slide) {
+  SnapshotImage image;
+  image.header = header;
+  image.slide = slide;
+
+  // dladdr gives the path the image was loaded from. This runs at
+  // image load time, not at crash time, so the lookup is safe.
+  Dl_info info;
+  if (dladdr(header, &info) && info.dli_fname)
+    image.name = info.dli_fname;
+
+  pthread_mutex_lock(&snapshot_mutex);
+  snapshot_images->push_back(image);
+  pthread_mutex_unlock(&snapshot_mutex);
+}
+
+// static
+void DyldImageSnapshot::RemoveImage(const struct mach_header* header,
+                                    intptr_t slide) {
+  pthread_mutex_lock(&snapshot_mutex);
+  for (vector<SnapshotImage>::iterator it = snapshot_images->begin();
+       it != snapshot_images->end();
+       ++it) {
+    if (it->header == header) {
+      snapshot_images->erase(it);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&snapshot_mutex);
+}
+
+// static
+void DyldImageSnapshot::Install() {
+  pthread_mutex_lock(&snapshot_mutex);
+  bool already_installed = snapshot_images != NULL;
+  if (!already_installed)
+    snapshot_images = new vector<SnapshotImage>();
+  pthread_mutex_unlock(&snapshot_mutex);
+
+  if (already_installed)
+    return;
+
+  // Registering the add-image callback invokes it synchronously for
+  // every image already loaded, which builds the initial snapshot.
+  _dyld_register_func_for_add_image(AddImage);
+  _dyld_register_func_for_remove_image(RemoveImage);
+}
+
+// static
+bool DyldImageSnapshot::Acquire() {
+  if (!snapshot_images)
+    return false;
+
+  if (pthread_mutex_trylock(&snapshot_mutex) != 0)
+    return false;
+
+  // Validate the snapshot against dyld before trusting it; a crash
+  // during image load or unload can leave the two out of sync.
+  if (snapshot_images->size() != _dyld_image_count()) {
+    pthread_mutex_unlock(&snapshot_mutex);
+    return false;
+  }
+
+  snapshot_acquired = true;
+  return true;
+}
+
+// static
+void DyldImageSnapshot::Release() {
+  if (snapshot_acquired) {
+    snapshot_acquired = false;
+    pthread_mutex_unlock(&snapshot_mutex);
+  }
+}
+
+// static
+size_t DyldImageSnapshot::ImageCount() {
+  if (snapshot_acquired)
+    return snapshot_images->size();
+  return _dyld_image_count();
+}
+
+// static
+const struct mach_header* DyldImageSnapshot::HeaderAtIndex(size_t index) {
+  if (snapshot_acquired)
+    return (*snapshot_images)[index].header;
+  return _dyld_get_image_header(static_cast<uint32_t>(index));
+}
+
+// static
+intptr_t DyldImageSnapshot::SlideAtIndex(size_t index) {
+  if (snapshot_acquired)
+    return (*snapshot_images)[index].slide;
+  return _dyld_get_image_vmaddr_slide(static_cast<uint32_t>(index));
+}
+
+// static
+const char* DyldImageSnapshot::NameAtIndex(size_t index) {
+  if (snapshot_acquired)
+    return (*snapshot_images)[index].name.c_str();
+  return _dyld_get_image_name(static_cast<uint32_t>(index));
+}
+
 #pragma mark -
 
 //==============================================================================
@@ -419,6 +600,11 @@ void ReadImageInfo(DynamicImages& images,
   typedef typename MachBits::dyld_all_image_infos dyld_all_image_infos;
   typedef typename MachBits::mach_header_type mach_header_type;
 
+  // Use a bulk reader so the many small reads below (immediately
+  // adjacent image headers, load commands and path strings) are served
+  // from a few large chunk fetches instead of one mach message each.
+  TaskMemoryBulkReader reader(images.task_);
+
   // Read the structure inside of dyld that contains information about
   // loaded images.  We're reading from the desired task's address space.
 
@@ -426,10 +612,9 @@ void ReadImageInfo(DynamicImages& images,
   // the crashed process vs. this one.  This is an assumption made in
   // "dyld_debug.c" and is said to be nearly always valid.
   vector<uint8_t> dyld_all_info_bytes;
-  if (ReadTaskMemory(images.task_,
-                     image_list_address,
-                     sizeof(dyld_all_image_infos),
-                     dyld_all_info_bytes) != KERN_SUCCESS)
+  if (reader.Read(image_list_address,
+                  sizeof(dyld_all_image_infos),
+                  dyld_all_info_bytes) != KERN_SUCCESS)
     return;
 
   dyld_all_image_infos *dyldInfo =
@@ -441,10 +626,9 @@ void ReadImageInfo(DynamicImages& images,
   // Read an array of dyld_image_info structures each containing
   // information about a loaded image.
   vector<uint8_t> dyld_info_array_bytes;
-    if (ReadTaskMemory(images.task_,
-                       dyldInfo->infoArray,
-                       count * sizeof(dyld_image_info),
-                       dyld_info_array_bytes) != KERN_SUCCESS)
+    if (reader.Read(dyldInfo->infoArray,
+                    count * sizeof(dyld_image_info),
+                    dyld_info_array_bytes) != KERN_SUCCESS)
       return;
 
     dyld_image_info *infoArray =
@@ -456,10 +640,9 @@ void ReadImageInfo(DynamicImages& images,
 
       // First read just the mach_header from the image in the task.
       vector<uint8_t> mach_header_bytes;
-      if (ReadTaskMemory(images.task_,
-                         info.load_address_,
-                         sizeof(mach_header_type),
-                         mach_header_bytes) != KERN_SUCCESS)
+      if (reader.Read(info.load_address_,
+                      sizeof(mach_header_type),
+                      mach_header_bytes) != KERN_SUCCESS)
         continue;  // bail on this dynamic image
 
       mach_header_type *header =
@@ -470,10 +653,9 @@ void ReadImageInfo(DynamicImages& images,
       size_t header_size =
           sizeof(mach_header_type) + header->sizeofcmds;
 
-      if (ReadTaskMemory(images.task_,
-                         info.load_address_,
-                         header_size,
-                         mach_header_bytes) != KERN_SUCCESS)
+      if (reader.Read(info.load_address_,
+                      header_size,
+                      mach_header_bytes) != KERN_SUCCESS)
         continue;
 
       // Read the file name from the task's memory space.
@@ -482,7 +664,7 @@ void ReadImageInfo(DynamicImages& images,
         // Although we're reading kMaxStringLength bytes, it's copied in the
         // the DynamicImage constructor below with the correct string length,
         // so it's not really wasting memory.
-        file_path = ReadTaskString(images.task_, info.file_path_);
+        file_path = ReadTaskString(images.task_, reader, info.file_path_);
       }
 
       // Create an object representing this image and add it to our list.
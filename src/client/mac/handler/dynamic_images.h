@@ -312,6 +312,84 @@ kern_return_t ReadTaskMemory(task_port_t target_task,
                              size_t length,
                              vector<uint8_t> &bytes);
 
+// Reads memory from another task in large chunks and serves individual
+// reads from a reusable arena. Every call to ReadTaskMemory costs a
+// mach message round trip plus a fresh out-of-line allocation, which
+// dominates the time spent copying many small ranges (image headers,
+// load commands, thread stacks). A bulk reader fetches the containing
+// chunk once and satisfies subsequent reads that fall inside it with a
+// plain memcpy.
+class TaskMemoryBulkReader {
+ public:
+  explicit TaskMemoryBulkReader(task_port_t target_task);
+
+  // Fill bytes with the contents of memory at a particular location in
+  // the target task. Same contract as ReadTaskMemory, but consecutive
+  // reads served from one fetched chunk need no mach messaging.
+  kern_return_t Read(const uint64_t address,
+                     size_t length,
+                     vector<uint8_t> &bytes);
+
+ private:
+  // Fetches the chunk starting at |address| into the arena. |length|
+  // must not exceed kChunkSize.
+  kern_return_t FetchChunk(const uint64_t address, size_t length);
+
+  // Size of the chunks fetched into the arena. Reads larger than this
+  // bypass the arena entirely.
+  static const size_t kChunkSize = 512 * 1024;
+
+  // The task being read.
+  task_port_t task_;
+
+  // Storage for the current chunk, reused across fetches so repeated
+  // reads do not reallocate.
+  vector<uint8_t> arena_;
+
+  // Task address corresponding to arena_[0], and the number of valid
+  // bytes in the arena. chunk_size_ is 0 until the first fetch.
+  uint64_t chunk_address_;
+  size_t chunk_size_;
+};
+
+// Install-time snapshot of the images loaded in this process, kept
+// current by dyld add/remove-image callbacks. Enumerating dyld state at
+// crash time touches every loaded image with the process in an unknown
+// condition, and processes with very many images spend most of their
+// crash window doing it. With a snapshot the crash path only has to
+// validate the prebuilt list instead of rebuilding it.
+class DyldImageSnapshot {
+ public:
+  // Builds the snapshot and registers the dyld callbacks that keep it
+  // current. Safe to call more than once; only the first call does any
+  // work. Must be called from a safe context, such as exception handler
+  // installation - never from a crash handler.
+  static void Install();
+
+  // Tries to take the snapshot for crash-time use. Returns false if no
+  // snapshot was installed, if the snapshot lock is held (possibly by a
+  // thread suspended mid-update) or if the snapshot no longer matches
+  // dyld's image count.
+  static bool Acquire();
+
+  // Releases a snapshot taken with a successful Acquire.
+  static void Release();
+
+  // Image accessors. While a snapshot is acquired they are served from
+  // it without touching dyld; otherwise they simply forward to the
+  // corresponding dyld call, so callers need not branch on whether
+  // Acquire succeeded.
+  static size_t ImageCount();
+  static const struct mach_header* HeaderAtIndex(size_t index);
+  static intptr_t SlideAtIndex(size_t index);
+  static const char* NameAtIndex(size_t index);
+
+ private:
+  // dyld image registration callbacks.
+  static void AddImage(const struct mach_header* header, intptr_t slide);
+  static void RemoveImage(const struct mach_header* header, intptr_t slide);
+};
+
 }   // namespace google_breakpad
 
 #endif // CLIENT_MAC_HANDLER_DYNAMIC_IMAGES_H__
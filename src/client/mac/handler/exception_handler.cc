@@ -81,6 +81,13 @@ static union {
 
 using std::map;
 
+// How many bytes to reserve at install time for the allocations the
+// minidump generator makes while writing a crash dump.  The dominant
+// consumer is one MDMemoryDescriptor per thread, so 64KB covers
+// processes with thousands of threads; crash_allocation_bytes() shows
+// how much of it a dump actually used.
+static const unsigned kCrashAllocationReserve = 64 * 1024;
+
 // These structures and techniques are illustrated in
 // Mac OS X Internals, Amit Singh, ch 9.7
 struct ExceptionMessage {
@@ -237,6 +244,8 @@ ExceptionHandler::ExceptionHandler(const string &dump_path,
   // This will update to the ID and C-string pointers
   set_dump_path(dump_path);
   MinidumpGenerator::GatherSystemInformation();
+  // Reserve the crash-time arena now, while the process is healthy.
+  allocator_.Reserve(kCrashAllocationReserve);
 #if !TARGET_OS_IPHONE
   if (port_name)
     crash_generation_client_.reset(new CrashGenerationClient(port_name));
@@ -381,7 +390,8 @@ bool ExceptionHandler::WriteMinidumpWithException(int exception_type,
     if (!dump_path_.empty()) {
       MinidumpGenerator md(mach_task_self(),
                            report_current_thread ? MACH_PORT_NULL :
-                                                   mach_thread_self());
+                                                   mach_thread_self(),
+                           &allocator_);
       md.SetTaskContext(task_context);
       if (exception_type && exception_code) {
         // If this is a real exception, give the filter (if any) a chance to
@@ -724,6 +734,10 @@ bool ExceptionHandler::Setup(bool install_handler) {
   if (pthread_mutex_init(&minidump_write_mutex_, NULL))
     return false;
 
+  // Snapshot the loaded images now so an in-process dump does not have
+  // to enumerate dyld state at crash time.
+  DyldImageSnapshot::Install();
+
   // Create a receive right
   mach_port_t current_task = mach_task_self();
   kern_return_t result = mach_port_allocate(current_task,
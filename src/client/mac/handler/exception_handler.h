@@ -45,6 +45,7 @@
 
 #if !TARGET_OS_IPHONE
 #include "client/mac/crash_generation/crash_generation_client.h"
+#include "common/memory.h"
 #endif
 
 namespace google_breakpad {
@@ -154,6 +155,15 @@ class ExceptionHandler {
 				    MinidumpCallback callback,
 				    void *callback_context);
 
+  // Total bytes of crash-time allocations served by the arena this
+  // handler reserved at install time, summed over every dump it has
+  // written.  Since the arena never frees, this is also the high-water
+  // mark; if it exceeds the install-time reservation in practice, use
+  // it to size a larger one.
+  unsigned crash_allocation_bytes() const {
+    return allocator_.bytes_allocated();
+  }
+
   // Returns whether out-of-process dump generation is used or not.
   bool IsOutOfProcess() const {
 #if TARGET_OS_IPHONE
@@ -258,6 +268,13 @@ class ExceptionHandler {
   // Save the last result of the last minidump
   bool last_minidump_write_result_;
 
+  // Arena that serves every allocation the minidump generator makes at
+  // crash time.  Pages are reserved in the constructor, while the
+  // process is healthy, so writing a dump neither calls malloc under a
+  // possibly corrupted heap nor maps fresh pages inside the crash
+  // window.
+  PageAllocator allocator_;
+
   // A mutex for use when writing out a minidump that was requested on a
   // thread other than the exception handler.
   pthread_mutex_t minidump_write_mutex_;
@@ -80,14 +80,19 @@ MinidumpGenerator::MinidumpGenerator()
       cpu_type_(DynamicImages::GetNativeCPUType()),
       task_context_(NULL),
       dynamic_images_(NULL),
-      memory_blocks_(&allocator_) {
+      task_memory_reader_(crashing_task_),
+      captured_thread_states_(NULL),
+      captured_thread_state_count_(0),
+      allocator_(&own_allocator_),
+      memory_blocks_(allocator_) {
   GatherSystemInformation();
 }
 
 // constructor when generating from a different process than the
 // crashed process
 MinidumpGenerator::MinidumpGenerator(mach_port_t crashing_task,
-                                     mach_port_t handler_thread)
+                                     mach_port_t handler_thread,
+                                     PageAllocator* allocator)
     : writer_(),
       exception_type_(0),
       exception_code_(0),
@@ -98,7 +103,11 @@ MinidumpGenerator::MinidumpGenerator(mach_port_t crashing_task,
       cpu_type_(DynamicImages::GetNativeCPUType()),
       task_context_(NULL),
       dynamic_images_(NULL),
-      memory_blocks_(&allocator_) {
+      task_memory_reader_(crashing_task_),
+      captured_thread_states_(NULL),
+      captured_thread_state_count_(0),
+      allocator_(allocator ? allocator : &own_allocator_),
+      memory_blocks_(allocator_) {
   if (crashing_task != mach_task_self()) {
     dynamic_images_ = new DynamicImages(crashing_task_);
     cpu_type_ = dynamic_images_->GetCPUType();
@@ -343,10 +352,9 @@ bool MinidumpGenerator::WriteStackFromStartAddress(
 
     if (dynamic_images_) {
       vector<uint8_t> stack_memory;
-      if (ReadTaskMemory(crashing_task_,
-                         start_addr,
-                         size,
-                         stack_memory) != KERN_SUCCESS) {
+      if (task_memory_reader_.Read(start_addr,
+                                   size,
+                                   stack_memory) != KERN_SUCCESS) {
         return false;
       }
 
@@ -774,9 +782,46 @@ bool MinidumpGenerator::WriteContextX86_64(
 }
 #endif
 
+void MinidumpGenerator::CaptureThreadStates(
+    const thread_act_t *threads,
+    mach_msg_type_number_t thread_count) {
+  CapturedThreadState *states = reinterpret_cast<CapturedThreadState *>(
+      allocator_->Alloc(sizeof(CapturedThreadState) * thread_count));
+  if (!states)
+    return;
+
+  // captured_thread_state_count_ is still zero here, so the
+  // GetThreadState() calls below go to the kernel (or task_context_)
+  // rather than the table being filled in.
+  unsigned int captured = 0;
+  for (mach_msg_type_number_t i = 0; i < thread_count; ++i) {
+    CapturedThreadState *entry = &states[captured];
+    entry->thread = threads[i];
+    entry->state_count =
+        static_cast<mach_msg_type_number_t>(sizeof(entry->state));
+    if (GetThreadState(threads[i], entry->state, &entry->state_count))
+      ++captured;
+  }
+
+  captured_thread_states_ = states;
+  captured_thread_state_count_ = captured;
+}
+
 bool MinidumpGenerator::GetThreadState(thread_act_t target_thread,
                                        thread_state_t state,
                                        mach_msg_type_number_t *count) {
+  // Serve the request from the bulk capture pass when one has run.
+  for (unsigned int i = 0; i < captured_thread_state_count_; ++i) {
+    if (captured_thread_states_[i].thread == target_thread) {
+      size_t final_size =
+          std::min(static_cast<size_t>(*count),
+                   sizeof(captured_thread_states_[i].state));
+      memcpy(state, captured_thread_states_[i].state, final_size);
+      *count = captured_thread_states_[i].state_count;
+      return true;
+    }
+  }
+
   if (task_context_ && target_thread == mach_thread_self()) {
     switch (cpu_type_) {
 #ifdef HAS_ARM_SUPPORT
@@ -853,6 +898,11 @@ bool MinidumpGenerator::WriteThreadListStream(
   if (task_threads(crashing_task_, &threads_for_task, &thread_count))
     return false;
 
+  // Capture every thread's state up front in one tight pass, so the
+  // writers below serialize from memory instead of interleaving a mach
+  // call per thread with disk writes while the task stays suspended.
+  CaptureThreadStates(threads_for_task, thread_count);
+
   // Don't include the generator thread
   if (handler_thread_ != MACH_PORT_NULL)
     non_generator_thread_count = thread_count - 1;
@@ -966,10 +1016,9 @@ bool MinidumpGenerator::WriteMemoryListStream(
     if (dynamic_images_) {
       // Out-of-process.
       vector<uint8_t> memory;
-      if (ReadTaskMemory(crashing_task_,
-                         ip_memory_d.start_of_memory_range,
-                         ip_memory_d.memory.data_size,
-                         memory) != KERN_SUCCESS) {
+      if (task_memory_reader_.Read(ip_memory_d.start_of_memory_range,
+                                   ip_memory_d.memory.data_size,
+                                   memory) != KERN_SUCCESS) {
         return false;
       }
 
@@ -1191,7 +1240,7 @@ bool MinidumpGenerator::WriteModuleStream(unsigned int index,
   } else {
     // Getting module info in the crashed process
     const breakpad_mach_header *header;
-    header = (breakpad_mach_header*)_dyld_get_image_header(index);
+    header = (breakpad_mach_header*)DyldImageSnapshot::HeaderAtIndex(index);
     if (!header)
       return false;
 
@@ -1208,8 +1257,8 @@ bool MinidumpGenerator::WriteModuleStream(unsigned int index,
 #endif
 
     int cpu_type = header->cputype;
-    unsigned long slide = _dyld_get_image_vmaddr_slide(index);
-    const char* name = _dyld_get_image_name(index);
+    unsigned long slide = DyldImageSnapshot::SlideAtIndex(index);
+    const char* name = DyldImageSnapshot::NameAtIndex(index);
     const struct load_command *cmd =
         reinterpret_cast<const struct load_command *>(header + 1);
 
@@ -1257,11 +1306,11 @@ int MinidumpGenerator::FindExecutableModule() {
       return index;
     }
   } else {
-    int image_count = _dyld_image_count();
+    int image_count = static_cast<int>(DyldImageSnapshot::ImageCount());
     const struct mach_header *header;
 
     for (int index = 0; index < image_count; ++index) {
-      header = _dyld_get_image_header(index);
+      header = DyldImageSnapshot::HeaderAtIndex(index);
 
       if (header->filetype == MH_EXECUTE)
         return index;
@@ -1343,39 +1392,49 @@ bool MinidumpGenerator::WriteModuleListStream(
     MDRawDirectory *module_list_stream) {
   TypedMDRVA<MDRawModuleList> list(&writer_);
 
+  // For an in-process dump, try to take the install-time image
+  // snapshot so the crash path works from a prebuilt, consistent list
+  // instead of enumerating dyld state. If the snapshot is unavailable
+  // the accessors below transparently fall back to live dyld calls.
+  bool use_snapshot = !dynamic_images_ && DyldImageSnapshot::Acquire();
+  bool result = false;
+
   size_t image_count = dynamic_images_ ?
       static_cast<size_t>(dynamic_images_->GetImageCount()) :
-      _dyld_image_count();
-
-  if (!list.AllocateObjectAndArray(image_count, MD_MODULE_SIZE))
-    return false;
-
-  module_list_stream->stream_type = MD_MODULE_LIST_STREAM;
-  module_list_stream->location = list.location();
-  list.get()->number_of_modules = image_count;
-
-  // Write out the executable module as the first one
-  MDRawModule module;
-  size_t executableIndex = FindExecutableModule();
-
-  if (!WriteModuleStream(executableIndex, &module)) {
-    return false;
-  }
-
-  list.CopyIndexAfterObject(0, &module, MD_MODULE_SIZE);
-  int destinationIndex = 1;  // Write all other modules after this one
-
-  for (size_t i = 0; i < image_count; ++i) {
-    if (i != executableIndex) {
-      if (!WriteModuleStream(i, &module)) {
-        return false;
+      DyldImageSnapshot::ImageCount();
+
+  if (list.AllocateObjectAndArray(image_count, MD_MODULE_SIZE)) {
+    module_list_stream->stream_type = MD_MODULE_LIST_STREAM;
+    module_list_stream->location = list.location();
+    list.get()->number_of_modules = image_count;
+
+    // Write out the executable module as the first one
+    MDRawModule module;
+    size_t executableIndex = FindExecutableModule();
+
+    if (WriteModuleStream(executableIndex, &module)) {
+      list.CopyIndexAfterObject(0, &module, MD_MODULE_SIZE);
+      int destinationIndex = 1;  // Write all other modules after this one
+
+      result = true;
+      for (size_t i = 0; i < image_count; ++i) {
+        if (i != executableIndex) {
+          if (!WriteModuleStream(i, &module)) {
+            result = false;
+            break;
+          }
+
+          list.CopyIndexAfterObject(destinationIndex++, &module,
+                                    MD_MODULE_SIZE);
+        }
       }
-
-      list.CopyIndexAfterObject(destinationIndex++, &module, MD_MODULE_SIZE);
     }
   }
 
-  return true;
+  if (use_snapshot)
+    DyldImageSnapshot::Release();
+
+  return result;
 }
 
 bool MinidumpGenerator::WriteMiscInfoStream(MDRawDirectory *misc_info_stream) {
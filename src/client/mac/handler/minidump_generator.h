@@ -80,7 +80,14 @@ using std::string;
 class MinidumpGenerator {
  public:
   MinidumpGenerator();
-  MinidumpGenerator(mach_port_t crashing_task, mach_port_t handler_thread);
+
+  // If |allocator| is not NULL, every allocation the generator makes
+  // is served from it instead of from an allocator of its own.  The
+  // exception handler passes an allocator it reserved at install time
+  // so a crash-time dump never has to map fresh pages, let alone touch
+  // the heap.
+  MinidumpGenerator(mach_port_t crashing_task, mach_port_t handler_thread,
+                    PageAllocator* allocator = NULL);
 
   virtual ~MinidumpGenerator();
 
@@ -131,6 +138,11 @@ class MinidumpGenerator {
 
   // Helpers
   uint64_t CurrentPCForStack(breakpad_thread_state_data_t state);
+  // Capture the state of every thread in |threads| in one tight pass so
+  // that subsequent GetThreadState() calls are served from memory
+  // instead of issuing a mach call per thread between disk writes.
+  void CaptureThreadStates(const thread_act_t *threads,
+                           mach_msg_type_number_t thread_count);
   bool GetThreadState(thread_act_t target_thread, thread_state_t state,
                       mach_msg_type_number_t *count);
   bool WriteStackFromStartAddress(mach_vm_address_t start_addr,
@@ -210,9 +222,30 @@ class MinidumpGenerator {
   // Information about dynamically loaded code
   DynamicImages *dynamic_images_;
 
+  // Bulk reader for copying memory out of the crashing task. Reusing
+  // one reader across the thread stacks and memory regions written to
+  // the dump serves them from a preallocated arena instead of paying a
+  // mach message and a fresh buffer per read.
+  TaskMemoryBulkReader task_memory_reader_;
+
+  // Thread states captured in one pass over the suspended task by
+  // CaptureThreadStates().  The array is allocated from allocator_ and
+  // holds one entry per thread whose state could be read; threads
+  // missing from it fall back to a direct mach call.
+  struct CapturedThreadState {
+    thread_act_t thread;
+    breakpad_thread_state_data_t state;
+    mach_msg_type_number_t state_count;
+  };
+  CapturedThreadState *captured_thread_states_;
+  unsigned int captured_thread_state_count_;
+
   // PageAllocator makes it possible to allocate memory
   // directly from the system, even while handling an exception.
-  mutable PageAllocator allocator_;
+  // allocator_ points at own_allocator_ unless the creator supplied a
+  // preallocated allocator through the constructor.
+  mutable PageAllocator own_allocator_;
+  PageAllocator* allocator_;
 
  protected:
   // Blocks of memory written to the dump. These are all currently
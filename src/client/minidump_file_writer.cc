@@ -35,6 +35,10 @@
 #include <limits.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "client/minidump_file_writer-inl.h"
@@ -48,8 +52,33 @@ namespace google_breakpad {
 
 const MDRVA MinidumpFileWriter::kInvalidMDRVA = static_cast<MDRVA>(-1);
 
+// Maps |size| bytes of anonymous memory, or returns NULL on failure.
+static uint8_t* MapArena(size_t size) {
+#if __linux__
+  void* const mem = sys_mmap(NULL, size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#else
+  void* const mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANON, -1, 0);
+#endif
+  return mem == MAP_FAILED ? NULL : reinterpret_cast<uint8_t*>(mem);
+}
+
+static void UnmapArena(uint8_t* arena, size_t size) {
+#if __linux__
+  sys_munmap(arena, size);
+#else
+  munmap(arena, size);
+#endif
+}
+
 MinidumpFileWriter::MinidumpFileWriter()
     : file_(-1),
+      buffer_(NULL),
+      buffer_capacity_(0),
+      compression_(COMPRESSION_NONE),
+      async_writes_(false),
+      memory_sink_(false),
       close_file_when_destroyed_(true),
       position_(0),
       size_(0) {
@@ -58,6 +87,15 @@ MinidumpFileWriter::MinidumpFileWriter()
 MinidumpFileWriter::~MinidumpFileWriter() {
   if (close_file_when_destroyed_)
     Close();
+  else
+    FlushBuffer();
+  // A memory sink keeps its arena past Close() so the caller can hand
+  // the dump off; release it here.
+  if (buffer_) {
+    UnmapArena(buffer_, buffer_capacity_);
+    buffer_ = NULL;
+    buffer_capacity_ = 0;
+  }
 }
 
 bool MinidumpFileWriter::Open(const char *path) {
@@ -77,17 +115,349 @@ void MinidumpFileWriter::SetFile(const int file) {
   close_file_when_destroyed_ = false;
 }
 
+bool MinidumpFileWriter::OpenMemory(size_t estimated_size) {
+  assert(file_ == -1);
+  memory_sink_ = true;
+  return EnableBuffering(estimated_size);
+}
+
+bool MinidumpFileWriter::EnableBuffering(size_t estimated_size) {
+  assert(file_ != -1 || memory_sink_);
+  assert(position_ == 0);
+  assert(!buffer_);
+
+  const size_t page_size = getpagesize();
+  size_t capacity = (estimated_size + page_size - 1) & ~(page_size - 1);
+  if (!capacity)
+    capacity = page_size;
+
+  buffer_ = MapArena(capacity);
+  if (!buffer_)
+    return false;
+  buffer_capacity_ = capacity;
+  return true;
+}
+
+bool MinidumpFileWriter::FlushBuffer() {
+  if (!buffer_)
+    return true;
+
+  // A memory sink has nowhere to flush to: the arena is the dump, and
+  // it stays mapped until destruction so the caller can consume it.
+  if (memory_sink_)
+    return true;
+
+  bool result;
+  if (compression_ != COMPRESSION_NONE)
+    result = WriteArenaCompressed();
+  else if (async_writes_ && WriteArenaAsync(file_))
+    result = true;
+  else
+    result = WriteArenaTo(file_);
+
+  UnmapArena(buffer_, buffer_capacity_);
+  buffer_ = NULL;
+  buffer_capacity_ = 0;
+  return result;
+}
+
+bool MinidumpFileWriter::WriteArenaTo(int fd) {
+  size_t done = 0;
+  while (done < position_) {
+    // A single write is capped at about 2GB by the kernel; chunking at
+    // 1GB keeps us comfortably inside while still giving only a handful
+    // of syscalls per dump.
+    static const size_t kMaxWriteChunk = 1 << 30;
+    size_t chunk = position_ - done;
+    if (chunk > kMaxWriteChunk)
+      chunk = kMaxWriteChunk;
+#if __linux__
+    const ssize_t written = sys_write(fd, buffer_ + done, chunk);
+#else
+    const ssize_t written = write(fd, buffer_ + done, chunk);
+#endif
+    if (written <= 0)
+      return false;
+    done += written;
+  }
+  return true;
+}
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && \
+    defined(__NR_io_uring_enter)
+#define HAVE_IO_URING_FLUSH 1
+
+// Minimal copies of the io_uring user API structures, in the spirit of
+// the vendored linux_syscall_support.h: the layouts are part of the
+// kernel's stable ABI, and defining them here keeps the writer
+// building against toolchains whose installed kernel headers predate
+// io_uring. Kernels without the syscalls fail io_uring_setup() at
+// runtime and the flush falls back to synchronous writes.
+struct kernel_io_sqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t resv1;
+  uint64_t resv2;
+};
+
+struct kernel_io_cqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint32_t flags;
+  uint32_t resv1;
+  uint64_t resv2;
+};
+
+struct kernel_io_uring_params {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t wq_fd;
+  uint32_t resv[3];
+  struct kernel_io_sqring_offsets sq_off;
+  struct kernel_io_cqring_offsets cq_off;
+};
+
+struct kernel_io_uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  uint64_t off;
+  uint64_t addr;
+  uint32_t len;
+  uint32_t opcode_flags;
+  uint64_t user_data;
+  uint64_t extra[3];
+};
+
+struct kernel_io_uring_cqe {
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+static const uint64_t kIoringOffSqRing = 0;
+static const uint64_t kIoringOffCqRing = 0x8000000ull;
+static const uint64_t kIoringOffSqes = 0x10000000ull;
+static const uint8_t kIoringOpWritev = 2;  // supported since io_uring's debut
+static const unsigned kIoringEnterGetevents = 1;
+static const uint32_t kIoringFeatSingleMmap = 1;
+#endif  // __NR_io_uring_setup && __NR_io_uring_enter
+
+bool MinidumpFileWriter::WriteArenaAsync(int fd) {
+#if defined(HAVE_IO_URING_FLUSH)
+  // Eight chunks of 8MB in flight cover dumps up to 64MB in a single
+  // submission; larger arenas take one io_uring_enter() per 64MB.
+  static const unsigned kQueueDepth = 8;
+  static const size_t kAsyncWriteChunk = 8 * 1024 * 1024;
+
+  kernel_io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  const int ring_fd =
+      syscall(__NR_io_uring_setup, kQueueDepth, &params);
+  if (ring_fd < 0)
+    return false;
+
+  // Kernels with IORING_FEAT_SINGLE_MMAP serve both rings from one
+  // mapping; older ones need the classic two-mapping layout.
+  size_t sq_ring_size =
+      params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  size_t cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(kernel_io_uring_cqe);
+  const bool single_mmap = (params.features & kIoringFeatSingleMmap) != 0;
+  if (single_mmap) {
+    if (cq_ring_size > sq_ring_size)
+      sq_ring_size = cq_ring_size;
+    cq_ring_size = sq_ring_size;
+  }
+
+  uint8_t* sq_ring = NULL;
+  uint8_t* cq_ring = NULL;
+  kernel_io_uring_sqe* sqes = NULL;
+  bool result = false;
+
+  sq_ring = reinterpret_cast<uint8_t*>(
+      mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+           ring_fd, kIoringOffSqRing));
+  if (sq_ring == MAP_FAILED) {
+    sq_ring = NULL;
+    goto out;
+  }
+  if (single_mmap) {
+    cq_ring = sq_ring;
+  } else {
+    cq_ring = reinterpret_cast<uint8_t*>(
+        mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+             ring_fd, kIoringOffCqRing));
+    if (cq_ring == MAP_FAILED) {
+      cq_ring = NULL;
+      goto out;
+    }
+  }
+  sqes = reinterpret_cast<kernel_io_uring_sqe*>(
+      mmap(NULL, params.sq_entries * sizeof(kernel_io_uring_sqe),
+           PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, kIoringOffSqes));
+  if (sqes == reinterpret_cast<kernel_io_uring_sqe*>(MAP_FAILED)) {
+    sqes = NULL;
+    goto out;
+  }
+
+  {
+    uint32_t* const sq_tail =
+        reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.tail);
+    uint32_t* const sq_array =
+        reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.array);
+    const uint32_t sq_mask =
+        *reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.ring_mask);
+    uint32_t* const cq_head =
+        reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.head);
+    const uint32_t cq_mask =
+        *reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.ring_mask);
+    kernel_io_uring_cqe* const cqes = reinterpret_cast<kernel_io_uring_cqe*>(
+        cq_ring + params.cq_off.cqes);
+
+    struct iovec iov[kQueueDepth];
+    size_t done = 0;
+    result = true;
+    while (result && done < position_) {
+      // Queue up to a ring's worth of chunks, then submit them all and
+      // wait for the whole batch, so the chunks overlap each other in
+      // the device queue while the iovecs stay live on this stack.
+      unsigned batch = 0;
+      size_t batch_bytes = 0;
+      while (batch < kQueueDepth && done + batch_bytes < position_) {
+        size_t chunk = position_ - done - batch_bytes;
+        if (chunk > kAsyncWriteChunk)
+          chunk = kAsyncWriteChunk;
+        iov[batch].iov_base = buffer_ + done + batch_bytes;
+        iov[batch].iov_len = chunk;
+
+        const uint32_t index = (*sq_tail + batch) & sq_mask;
+        kernel_io_uring_sqe* const sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = kIoringOpWritev;
+        sqe->fd = fd;
+        sqe->off = done + batch_bytes;
+        sqe->addr = reinterpret_cast<uintptr_t>(&iov[batch]);
+        sqe->len = 1;
+        sqe->user_data = batch;
+        sq_array[index] = index;
+
+        batch_bytes += chunk;
+        batch++;
+      }
+
+      // Publish the new tail before the kernel sees the enter call.
+      __sync_synchronize();
+      *sq_tail += batch;
+      __sync_synchronize();
+
+      const long submitted = syscall(__NR_io_uring_enter, ring_fd, batch,
+                                     batch, kIoringEnterGetevents, NULL, 0);
+      if (submitted != static_cast<long>(batch)) {
+        result = false;
+        break;
+      }
+
+      for (unsigned i = 0; i < batch; ++i) {
+        const kernel_io_uring_cqe* const cqe = &cqes[(*cq_head + i) & cq_mask];
+        // A short or failed write poisons the flush; the synchronous
+        // fallback rewrites the arena from the start, making the file
+        // whole.
+        if (cqe->res < 0 ||
+            static_cast<size_t>(cqe->res) != iov[cqe->user_data].iov_len) {
+          result = false;
+        }
+      }
+      __sync_synchronize();
+      *cq_head += batch;
+      done += batch_bytes;
+    }
+  }
+
+out:
+  if (sqes)
+    munmap(sqes, params.sq_entries * sizeof(kernel_io_uring_sqe));
+  if (cq_ring && cq_ring != sq_ring)
+    munmap(cq_ring, cq_ring_size);
+  if (sq_ring)
+    munmap(sq_ring, sq_ring_size);
+  close(ring_fd);
+  return result;
+#else
+  return false;  // no io_uring on this platform: use the synchronous path
+#endif  // HAVE_IO_URING_FLUSH
+}
+
+bool MinidumpFileWriter::WriteArenaCompressed() {
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0)
+    return false;
+
+  const pid_t pid = fork();
+  if (pid == -1) {
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    return false;
+  }
+
+  if (pid == 0) {
+    // Child: read the dump from the pipe, write the compressed stream
+    // to the output file.
+    if (dup2(pipe_fds[0], STDIN_FILENO) == -1 ||
+        dup2(file_, STDOUT_FILENO) == -1) {
+      _exit(127);
+    }
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    if (compression_ == COMPRESSION_GZIP)
+      execlp("gzip", "gzip", "-c", static_cast<char*>(NULL));
+    else
+      execlp("zstd", "zstd", "-q", "-c", static_cast<char*>(NULL));
+    _exit(127);
+  }
+
+  close(pipe_fds[0]);
+  bool result = WriteArenaTo(pipe_fds[1]);
+  close(pipe_fds[1]);
+
+  int status = 0;
+  if (waitpid(pid, &status, 0) != pid ||
+      !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    result = false;
+  }
+  return result;
+}
+
 bool MinidumpFileWriter::Close() {
   bool result = true;
 
   if (file_ != -1) {
-    if (-1 == ftruncate(file_, position_)) {
+    if (buffer_) {
+      // The staged dump is written out sequentially here, so the file
+      // ends at exactly position_ bytes with no trailing preallocation
+      // to trim.
+      result = FlushBuffer();
+    } else if (-1 == ftruncate(file_, position_)) {
        return false;
     }
 #if __linux__
-    result = (sys_close(file_) == 0);
+    result = (sys_close(file_) == 0) && result;
 #else
-    result = (close(file_) == 0);
+    result = (close(file_) == 0) && result;
 #endif
     file_ = -1;
   }
@@ -219,9 +589,36 @@ bool MinidumpFileWriter::WriteMemory(const void *src, size_t size,
 
 MDRVA MinidumpFileWriter::Allocate(size_t size) {
   assert(size);
-  assert(file_ != -1);
+  assert(file_ != -1 || memory_sink_);
   size_t aligned_size = (size + 7) & ~7;  // 64-bit alignment
 
+  if (buffer_) {
+    // Buffered mode: grow the arena instead of the file. The estimate
+    // passed to EnableBuffering makes this rare.
+    if (position_ + aligned_size > buffer_capacity_) {
+      size_t new_capacity = buffer_capacity_ * 2;
+      while (position_ + aligned_size > new_capacity)
+        new_capacity *= 2;
+      uint8_t* const bigger = MapArena(new_capacity);
+      if (!bigger)
+        return kInvalidMDRVA;
+#if __linux__
+      my_memcpy(bigger, buffer_, position_);
+#else
+      memcpy(bigger, buffer_, position_);
+#endif
+      UnmapArena(buffer_, buffer_capacity_);
+      buffer_ = bigger;
+      buffer_capacity_ = new_capacity;
+    }
+
+    MDRVA current_position = position_;
+    position_ += static_cast<MDRVA>(aligned_size);
+    size_ = position_;
+
+    return current_position;
+  }
+
   if (position_ + aligned_size > size_) {
     size_t growth = aligned_size;
     size_t minimal_growth = getpagesize();
@@ -246,12 +643,22 @@ MDRVA MinidumpFileWriter::Allocate(size_t size) {
 bool MinidumpFileWriter::Copy(MDRVA position, const void *src, ssize_t size) {
   assert(src);
   assert(size);
-  assert(file_ != -1);
+  assert(file_ != -1 || memory_sink_);
 
   // Ensure that the data will fit in the allocated space
   if (static_cast<size_t>(size + position) > size_)
     return false;
 
+  // In buffered mode the copy lands in the arena, RVA-for-RVA.
+  if (buffer_) {
+#if __linux__
+    my_memcpy(buffer_ + position, src, size);
+#else
+    memcpy(buffer_ + position, src, size);
+#endif
+    return true;
+  }
+
   // Seek and write the data
 #if __linux__
   if (sys_lseek(file_, position, SEEK_SET) == static_cast<off_t>(position)) {
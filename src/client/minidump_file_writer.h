@@ -86,11 +86,70 @@ public:
   // destroyed.
   void SetFile(const int file);
 
+  // Target an anonymous memory arena instead of a file, so a dump
+  // destined for immediate upload never touches disk.  |estimated_size|
+  // sizes the arena as for EnableBuffering().  After Close() the
+  // finished dump is available through memory_contents() and
+  // memory_size() until the writer is destroyed.  Compression and
+  // asynchronous writes do not apply to a memory sink.
+  // Return true on success, or false if the arena cannot be mapped.
+  bool OpenMemory(size_t estimated_size);
+
+  // The finished dump when OpenMemory() was used; NULL otherwise.  The
+  // bytes belong to the writer and are released by its destructor, so
+  // hand them off (say, to LibcurlWrapper::AddFileContents) before the
+  // writer goes away.
+  const void* memory_contents() const { return memory_sink_ ? buffer_ : NULL; }
+
+  // Size in bytes of memory_contents().
+  size_t memory_size() const { return memory_sink_ ? position_ : 0; }
+
   // Close the current file (that was either created when Open was called, or
   // specified with SetFile).
   // Return true on success, or false on failure.
   bool Close();
 
+  // Stage all writes in a single anonymous-mmap arena instead of issuing
+  // an ftruncate per allocation and a seek and write pair per copy; the
+  // whole dump is then written to the file in a few large writes when it
+  // is closed (or on destruction, for descriptors the caller owns).
+  // |estimated_size| sizes the arena; it doubles if the estimate proves
+  // too small. Call after Open() or SetFile() and before any allocation.
+  // Returns false if the arena cannot be mapped, in which case writes go
+  // straight to the file as before.
+  bool EnableBuffering(size_t estimated_size);
+
+  // Compression applied to the staged dump as it is flushed.  See
+  // SetCompression.
+  enum Compression {
+    COMPRESSION_NONE = 0,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD
+  };
+
+  // Streams the staged dump through the system's gzip or zstd tool as
+  // it is flushed, so the file on disk is written compressed in the
+  // same pass - no uncompressed dump ever touches disk and no separate
+  // compress step runs afterwards.  Only effective together with
+  // EnableBuffering(): unbuffered writes backpatch earlier offsets,
+  // which a compressed stream cannot accommodate.  Spawning the
+  // compressor forks and execs, so this is for out-of-process dump
+  // generation (the crash generation server), not for writing a dump
+  // inside a compromised process.  The caller should name the file
+  // accordingly (".dmp.gz" or ".dmp.zst"); the processor's Minidump
+  // reader opens such files transparently.
+  void SetCompression(Compression compression) { compression_ = compression; }
+
+  // Flushes the staged arena through io_uring, with several large
+  // writes in flight at once, instead of one synchronous write at a
+  // time. Only meaningful with EnableBuffering() and without
+  // compression. When the kernel has no io_uring support, or an
+  // asynchronous write fails, the flush silently falls back to the
+  // synchronous path. This uses libc, so it is for out-of-process dump
+  // writers such as CrashGenerationServer, not for writers running
+  // inside a crashed process's signal handler.
+  void EnableAsyncWrites() { async_writes_ = true; }
+
   // Copy the contents of |str| to a MDString and write it to the file.
   // |str| is expected to be either UTF-16 or UTF-32 depending on the size
   // of wchar_t.
@@ -124,9 +183,48 @@ public:
   // unable to allocate the bytes.
   MDRVA Allocate(size_t size);
 
+  // Writes the staged arena to the file in large chunks and releases it.
+  // A no-op when buffering is not enabled. Returns true on success.
+  bool FlushBuffer();
+
+  // Writes the first |position_| bytes of the arena to |fd| in large
+  // chunks.  Returns true when everything was written.
+  bool WriteArenaTo(int fd);
+
+  // Writes the first |position_| bytes of the arena to |fd| through
+  // io_uring, keeping several chunks in flight. Returns false - having
+  // written nothing or a prefix that a synchronous rewrite makes whole
+  // - when the kernel lacks io_uring or a write fails, in which case
+  // the caller falls back to WriteArenaTo().
+  bool WriteArenaAsync(int fd);
+
+  // Pipes the staged arena through the external compressor named by
+  // |compression_| into the output file.  Returns true when the whole
+  // arena was consumed and the compressor exited cleanly.
+  bool WriteArenaCompressed();
+
   // The file descriptor for the output file.
   int file_;
 
+  // Staging arena when EnableBuffering() has been called, NULL otherwise.
+  // The arena mirrors the file RVA-for-RVA, so random-access copies of
+  // backpatched headers land in memory instead of in seek/write pairs.
+  uint8_t* buffer_;
+
+  // Bytes mapped at |buffer_|.
+  size_t buffer_capacity_;
+
+  // Compression the staged arena is flushed through.  See
+  // SetCompression.
+  Compression compression_;
+
+  // Whether FlushBuffer() tries io_uring first.  See EnableAsyncWrites.
+  bool async_writes_;
+
+  // Whether the arena itself is the destination (OpenMemory); the
+  // staged dump is then never flushed to a file and survives Close().
+  bool memory_sink_;
+
   // Whether |file_| should be closed when the instance is destroyed.
   bool close_file_when_destroyed_;
 
@@ -222,6 +222,39 @@ static bool read_lfile(int pid, const char *lname, prheader_t *lhp) {
   return true;
 }
 
+/*
+ * Iterate the lwpids of the process by reading /proc/$pid/lpsinfo in
+ * one gulp and walking the entries in memory, instead of opening and
+ * reading a /proc entry per lwp. Returns the number of entries seen,
+ * or -1 if the lpsinfo read failed, in which case the caller should
+ * fall back to IterateLwpAll.
+ */
+static int IterateLwpAllBatched(int pid,
+                                CallbackParam<LwpidCallback> *callback_param) {
+  prheader_t lphp[HEADER_MAX];
+  prheader_t *Lphp = lphp;
+  lwpsinfo_t *Lpsp;
+  long ninfo;
+  int count = 0;
+
+  if (read_lfile(pid, "lpsinfo", Lphp) == NULL)
+    return -1;
+
+  Lpsp = (lwpsinfo_t *)(uintptr_t)(Lphp + 1);
+
+  for (ninfo = Lphp->pr_nent; ninfo != 0; --ninfo) {
+    int lwpid = Lpsp->pr_lwpid;
+    ++count;
+    if (callback_param &&
+        !(callback_param->call_back)(lwpid, callback_param->context)) {
+      break;
+    }
+    Lpsp = (lwpsinfo_t *)((uintptr_t)Lpsp + Lphp->pr_entsize);
+  }
+
+  return count;
+}
+
 }  // namespace
 
 namespace google_breakpad {
@@ -234,11 +267,19 @@ SolarisLwp::~SolarisLwp() {
 
 int SolarisLwp::ControlAllLwps(bool suspend) {
   CallbackParam<LwpidCallback> callback_param(ControlLwp, &suspend);
-  return IterateLwpAll(pid_, &callback_param);
+  // Enumerate the lwpids from a single lpsinfo read; fall back to
+  // walking the lwp directory entry by entry only if that fails.
+  int count = IterateLwpAllBatched(pid_, &callback_param);
+  if (count < 0)
+    count = IterateLwpAll(pid_, &callback_param);
+  return count;
 }
 
 int SolarisLwp::GetLwpCount() const {
-  return IterateLwpAll(pid_, NULL);
+  int count = IterateLwpAllBatched(pid_, NULL);
+  if (count < 0)
+    count = IterateLwpAll(pid_, NULL);
+  return count;
 }
 
 int SolarisLwp::Lwp_iter_all(int pid,
@@ -99,6 +99,28 @@ struct CustomClientInfo {
   size_t count;
 };
 
+// Crash information that the client publishes into a shared-memory
+// section right before signaling the dump request event. The section
+// is negotiated once at registration: the client creates it and sends
+// its handle in the registration request, and the server duplicates
+// and maps it. At crash time the server then reads the crash details
+// from its mapped view instead of issuing ReadProcessMemory calls
+// against a dying process, so the crash-time IPC collapses to the one
+// kernel signal on the dump request event. Servers and clients that
+// do not know about the section fall back to the address-based
+// protocol carried in the registration message.
+struct CrashNotificationBlock {
+  // Thread id of the crashing client thread.
+  DWORD thread_id;
+
+  // Address, in the client address space, of the EXCEPTION_POINTERS
+  // for the crash, or NULL for non-exception crashes.
+  //
+  // WARNING: the server must not dereference this pointer; it is only
+  // meaningful to pass on to MiniDumpWriteDump as a client pointer.
+  EXCEPTION_POINTERS* exception_pointers;
+};
+
 // Message structure for IPC between crash client and crash server.
 struct ProtocolMessage {
   ProtocolMessage()
@@ -111,7 +133,8 @@ struct ProtocolMessage {
         custom_client_info(),
         dump_request_handle(NULL),
         dump_generated_handle(NULL),
-        server_alive_handle(NULL) {
+        server_alive_handle(NULL),
+        crash_info_section_handle(NULL) {
   }
 
   // Creates an instance with the given parameters.
@@ -124,7 +147,8 @@ struct ProtocolMessage {
                   const CustomClientInfo& custom_info,
                   HANDLE arg_dump_request_handle,
                   HANDLE arg_dump_generated_handle,
-                  HANDLE arg_server_alive)
+                  HANDLE arg_server_alive,
+                  HANDLE arg_crash_info_section)
     : tag(arg_tag),
       id(arg_id),
       dump_type(arg_dump_type),
@@ -134,7 +158,8 @@ struct ProtocolMessage {
       custom_client_info(custom_info),
       dump_request_handle(arg_dump_request_handle),
       dump_generated_handle(arg_dump_generated_handle),
-      server_alive_handle(arg_server_alive) {
+      server_alive_handle(arg_server_alive),
+      crash_info_section_handle(arg_crash_info_section) {
   }
 
   // Tag in the message.
@@ -170,6 +195,12 @@ struct ProtocolMessage {
   // if server process goes down.
   HANDLE server_alive_handle;
 
+  // In a registration request, the handle (valid in the client
+  // process) of a shared-memory section holding a
+  // CrashNotificationBlock, or NULL if the client does not offer the
+  // shared-memory fast path.
+  HANDLE crash_info_section_handle;
+
  private:
   // Disable copy ctor and operator=.
   ProtocolMessage(const ProtocolMessage& msg);
@@ -41,7 +41,8 @@ ClientInfo::ClientInfo(CrashGenerationServer* crash_server,
                        DWORD* thread_id,
                        EXCEPTION_POINTERS** ex_info,
                        MDRawAssertionInfo* assert_info,
-                       const CustomClientInfo& custom_client_info)
+                       const CustomClientInfo& custom_client_info,
+                       HANDLE crash_info_section)
     : crash_server_(crash_server),
       pid_(pid),
       dump_type_(dump_type),
@@ -50,6 +51,9 @@ ClientInfo::ClientInfo(CrashGenerationServer* crash_server,
       custom_client_info_(custom_client_info),
       thread_id_(thread_id),
       process_handle_(NULL),
+      client_crash_info_section_(crash_info_section),
+      crash_info_section_(NULL),
+      crash_info_(NULL),
       dump_requested_handle_(NULL),
       dump_generated_handle_(NULL),
       dump_request_wait_handle_(NULL),
@@ -70,6 +74,32 @@ bool ClientInfo::Initialize() {
                       &kernel_time, &user_time))
     crash_id_ = creation_time.dwLowDateTime;
 
+  // Map the client's crash notification section, if it offered one.
+  // Failure here is not fatal; crash information is then read from the
+  // client address space as before.
+  if (client_crash_info_section_) {
+    if (DuplicateHandle(process_handle_,
+                        client_crash_info_section_,
+                        GetCurrentProcess(),
+                        &crash_info_section_,
+                        FILE_MAP_READ,
+                        FALSE,
+                        0)) {
+      crash_info_ = reinterpret_cast<const CrashNotificationBlock*>(
+          MapViewOfFile(crash_info_section_,
+                        FILE_MAP_READ,
+                        0,
+                        0,
+                        sizeof(CrashNotificationBlock)));
+      if (!crash_info_) {
+        CloseHandle(crash_info_section_);
+        crash_info_section_ = NULL;
+      }
+    } else {
+      crash_info_section_ = NULL;
+    }
+  }
+
   dump_requested_handle_ = CreateEvent(NULL,    // Security attributes.
                                        TRUE,    // Manual reset.
                                        FALSE,   // Initial state.
@@ -129,9 +159,24 @@ ClientInfo::~ClientInfo() {
   if (dump_generated_handle_) {
     CloseHandle(dump_generated_handle_);
   }
+
+  if (crash_info_) {
+    UnmapViewOfFile(const_cast<CrashNotificationBlock*>(crash_info_));
+  }
+
+  if (crash_info_section_) {
+    CloseHandle(crash_info_section_);
+  }
 }
 
 bool ClientInfo::GetClientExceptionInfo(EXCEPTION_POINTERS** ex_info) const {
+  // Prefer the shared-memory view the client filled in before
+  // signaling; it avoids a read from a dying process.
+  if (crash_info_) {
+    *ex_info = crash_info_->exception_pointers;
+    return true;
+  }
+
   SIZE_T bytes_count = 0;
   if (!ReadProcessMemory(process_handle_,
                          ex_info_,
@@ -145,6 +190,11 @@ bool ClientInfo::GetClientExceptionInfo(EXCEPTION_POINTERS** ex_info) const {
 }
 
 bool ClientInfo::GetClientThreadId(DWORD* thread_id) const {
+  if (crash_info_) {
+    *thread_id = crash_info_->thread_id;
+    return true;
+  }
+
   SIZE_T bytes_count = 0;
   if (!ReadProcessMemory(process_handle_,
                          thread_id_,
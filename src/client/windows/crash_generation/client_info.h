@@ -33,6 +33,7 @@
 #include <Windows.h>
 #include <DbgHelp.h>
 #include "client/windows/common/ipc_protocol.h"
+#include "client/windows/crash_generation/minidump_generator.h"
 #include "common/scoped_ptr.h"
 #include "google_breakpad/common/minidump_format.h"
 
@@ -46,13 +47,17 @@ class ClientInfo {
   // Creates an instance with the given values. Gets the process
   // handle for the given process id and creates necessary event
   // objects.
+  // crash_info_section is the handle, valid in the client process, of
+  // the client's CrashNotificationBlock shared-memory section, or NULL
+  // if the client did not offer one.
   ClientInfo(CrashGenerationServer* crash_server,
              DWORD pid,
              MINIDUMP_TYPE dump_type,
              DWORD* thread_id,
              EXCEPTION_POINTERS** ex_info,
              MDRawAssertionInfo* assert_info,
-             const CustomClientInfo& custom_client_info);
+             const CustomClientInfo& custom_client_info,
+             HANDLE crash_info_section);
 
   ~ClientInfo();
 
@@ -66,6 +71,11 @@ class ClientInfo {
   HANDLE dump_requested_handle() const { return dump_requested_handle_; }
   HANDLE dump_generated_handle() const { return dump_generated_handle_; }
   DWORD crash_id() const { return crash_id_; }
+  const DumpPolicy& dump_policy() const { return dump_policy_; }
+
+  void set_dump_policy(const DumpPolicy& policy) {
+    dump_policy_ = policy;
+  }
 
   void set_dump_request_wait_handle(HANDLE value) {
     dump_request_wait_handle_ = value;
@@ -108,6 +118,11 @@ class ClientInfo {
   // Dump type requested by the client.
   MINIDUMP_TYPE dump_type_;
 
+  // Policy restricting what the server writes into this client's dumps,
+  // on top of the requested dump type. Default-constructed (and thus
+  // unrestricted) until the server assigns one.
+  DumpPolicy dump_policy_;
+
   // Address of an EXCEPTION_POINTERS* variable in the client
   // process address space that will point to an instance of
   // EXCEPTION_POINTERS containing information about crash.
@@ -143,6 +158,18 @@ class ClientInfo {
   // Client process handle.
   HANDLE process_handle_;
 
+  // Handle of the client's CrashNotificationBlock section as passed in
+  // the registration request. This value is only meaningful in the
+  // client process; Initialize duplicates it into this process.
+  HANDLE client_crash_info_section_;
+
+  // This process's handle to the duplicated section, and the mapped
+  // view of it. Both NULL if the client did not offer the section or
+  // mapping it failed, in which case crash information is read from
+  // the client address space instead.
+  HANDLE crash_info_section_;
+  const CrashNotificationBlock* crash_info_;
+
   // Dump request event handle.
   HANDLE dump_requested_handle_;
 
@@ -103,7 +103,11 @@ CrashGenerationClient::CrashGenerationClient(
           crash_generated_(NULL),
           server_alive_(NULL),
           exception_pointers_(NULL),
-          custom_info_() {
+          custom_info_(),
+          crash_info_section_(NULL),
+          crash_info_(NULL),
+          register_thread_(NULL),
+          async_registration_pending_(0) {
   memset(&assert_info_, 0, sizeof(assert_info_));
   if (custom_info) {
     custom_info_ = *custom_info;
@@ -123,7 +127,11 @@ CrashGenerationClient::CrashGenerationClient(
           crash_generated_(NULL),
           server_alive_(NULL),
           exception_pointers_(NULL),
-          custom_info_() {
+          custom_info_(),
+          crash_info_section_(NULL),
+          crash_info_(NULL),
+          register_thread_(NULL),
+          async_registration_pending_(0) {
   memset(&assert_info_, 0, sizeof(assert_info_));
   if (custom_info) {
     custom_info_ = *custom_info;
@@ -131,6 +139,13 @@ CrashGenerationClient::CrashGenerationClient(
 }
 
 CrashGenerationClient::~CrashGenerationClient() {
+  if (register_thread_) {
+    // The background registration uses this object; it must finish
+    // before the members are torn down.
+    WaitForSingleObject(register_thread_, INFINITE);
+    CloseHandle(register_thread_);
+  }
+
   if (crash_event_) {
     CloseHandle(crash_event_);
   }
@@ -142,6 +157,14 @@ CrashGenerationClient::~CrashGenerationClient() {
   if (server_alive_) {
     CloseHandle(server_alive_);
   }
+
+  if (crash_info_) {
+    UnmapViewOfFile(crash_info_);
+  }
+
+  if (crash_info_section_) {
+    CloseHandle(crash_info_section_);
+  }
 }
 
 // Performs the registration step with the server process.
@@ -160,6 +183,11 @@ CrashGenerationClient::~CrashGenerationClient() {
 // * Address of an instance of MDRawAssertionInfo that will contain
 //   relevant information in case of non-exception crashes like assertion
 //   failures and pure calls.
+// * Handle of a shared-memory section holding a CrashNotificationBlock
+//   that the client fills in at crash time, so the server can read the
+//   crash details from its mapped view instead of from the client
+//   address space. NULL if the section could not be created, in which
+//   case the server falls back to the addresses above.
 //
 // In return the client expects the following information from the server:
 //
@@ -183,11 +211,61 @@ bool CrashGenerationClient::Register() {
     return false;
   }
 
+  CreateCrashInfoSection();
+
   bool success = RegisterClient(pipe);
   CloseHandle(pipe);
   return success;
 }
 
+bool CrashGenerationClient::RegisterAsync() {
+  InterlockedExchange(&async_registration_pending_, 1);
+  register_thread_ = CreateThread(NULL, 0, RegisterThreadProc, this, 0, NULL);
+  if (!register_thread_) {
+    InterlockedExchange(&async_registration_pending_, 0);
+    return false;
+  }
+  return true;
+}
+
+// static
+DWORD WINAPI CrashGenerationClient::RegisterThreadProc(void* param) {
+  CrashGenerationClient* self = static_cast<CrashGenerationClient*>(param);
+  self->Register();
+  // Publish the result. InterlockedExchange is a full barrier, so the
+  // handles Register stored are visible to the crashing thread before
+  // IsRegistered turns true.
+  InterlockedExchange(&self->async_registration_pending_, 0);
+  return 0;
+}
+
+void CrashGenerationClient::CreateCrashInfoSection() {
+  crash_info_section_ = CreateFileMapping(INVALID_HANDLE_VALUE,
+                                          NULL,
+                                          PAGE_READWRITE,
+                                          0,
+                                          sizeof(CrashNotificationBlock),
+                                          NULL);
+  if (!crash_info_section_) {
+    return;
+  }
+
+  crash_info_ = reinterpret_cast<CrashNotificationBlock*>(
+      MapViewOfFile(crash_info_section_,
+                    FILE_MAP_WRITE,
+                    0,
+                    0,
+                    sizeof(CrashNotificationBlock)));
+  if (!crash_info_) {
+    CloseHandle(crash_info_section_);
+    crash_info_section_ = NULL;
+    return;
+  }
+
+  crash_info_->thread_id = 0;
+  crash_info_->exception_pointers = NULL;
+}
+
 bool CrashGenerationClient::RequestUpload(DWORD crash_id) {
   HANDLE pipe = ConnectToServer();
   if (!pipe) {
@@ -197,7 +275,7 @@ bool CrashGenerationClient::RequestUpload(DWORD crash_id) {
   CustomClientInfo custom_info = {NULL, 0};
   ProtocolMessage msg(MESSAGE_TAG_UPLOAD_REQUEST, crash_id,
                       static_cast<MINIDUMP_TYPE>(NULL), NULL, NULL, NULL,
-                      custom_info, NULL, NULL, NULL);
+                      custom_info, NULL, NULL, NULL, NULL);
   DWORD bytes_count = 0;
   bool success = WriteFile(pipe, &msg, sizeof(msg), &bytes_count, NULL) != 0;
 
@@ -232,7 +310,8 @@ bool CrashGenerationClient::RegisterClient(HANDLE pipe) {
                       custom_info_,
                       NULL,
                       NULL,
-                      NULL);
+                      NULL,
+                      crash_info_section_);
   ProtocolMessage reply;
   DWORD bytes_count = 0;
   // The call to TransactNamedPipe below can be changed to a call
@@ -312,7 +391,7 @@ bool CrashGenerationClient::ValidateResponse(
 }
 
 bool CrashGenerationClient::IsRegistered() const {
-  return crash_event_ != NULL;
+  return async_registration_pending_ == 0 && crash_event_ != NULL;
 }
 
 bool CrashGenerationClient::RequestDump(EXCEPTION_POINTERS* ex_info,
@@ -330,6 +409,14 @@ bool CrashGenerationClient::RequestDump(EXCEPTION_POINTERS* ex_info,
     memset(&assert_info_, 0, sizeof(assert_info_));
   }
 
+  // Publish the crash details into the shared-memory section as well,
+  // so a server that mapped it can pick them up with the one kernel
+  // signal below and no reads from this (dying) process.
+  if (crash_info_) {
+    crash_info_->thread_id = thread_id_;
+    crash_info_->exception_pointers = ex_info;
+  }
+
   return SignalCrashEventAndWait();
 }
 
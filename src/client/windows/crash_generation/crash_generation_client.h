@@ -77,6 +77,16 @@ class CrashGenerationClient {
   // Returns true if the registration is successful; false otherwise.
   bool Register();
 
+  // Starts Register on a background thread and returns immediately,
+  // keeping the pipe transaction - and its full connect and wait
+  // timeout chain when the server is busy or not yet up - off the
+  // caller's startup path.  Until the background registration
+  // completes, RequestDump fails fast, so the caller must keep an
+  // in-process fallback installed.  Returns true if the background
+  // thread was started; on failure the caller can still call Register
+  // synchronously.
+  bool RegisterAsync();
+
   // Requests the crash server to upload a previous dump with the
   // given crash id.
   bool RequestUpload(DWORD crash_id);
@@ -136,6 +146,15 @@ class CrashGenerationClient {
   // Signals the crash event and wait for the server to generate crash.
   bool SignalCrashEventAndWait();
 
+  // Runs Register on the background thread started by RegisterAsync.
+  static DWORD WINAPI RegisterThreadProc(void* param);
+
+  // Creates and maps the shared-memory section used to publish crash
+  // information to the server without pipe traffic at crash time.
+  // On failure the client simply does not offer the fast path and the
+  // server falls back to reading the registered addresses.
+  void CreateCrashInfoSection();
+
   // Pipe name to use to talk to server.
   std::wstring pipe_name_;
 
@@ -172,6 +191,21 @@ class CrashGenerationClient {
   // Assertion info for an invalid parameter or pure call crash.
   MDRawAssertionInfo assert_info_;
 
+  // Handle to the shared-memory section offered to the server at
+  // registration, and the client's mapped view of it. Both are NULL
+  // if the section could not be created; the protocol then degrades
+  // to the server reading the registered addresses.
+  HANDLE crash_info_section_;
+  CrashNotificationBlock* crash_info_;
+
+  // Background registration thread started by RegisterAsync, or NULL.
+  HANDLE register_thread_;
+
+  // Nonzero while a RegisterAsync call is in flight.  IsRegistered
+  // stays false until it drops back to zero, even though RegisterClient
+  // may already have stored some of the server handles.
+  volatile LONG async_registration_pending_;
+
   // Disable copy ctor and operator=.
   CrashGenerationClient(const CrashGenerationClient& crash_client);
   CrashGenerationClient& operator=(const CrashGenerationClient& crash_client);
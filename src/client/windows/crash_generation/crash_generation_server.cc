@@ -29,8 +29,11 @@
 
 #include "client/windows/crash_generation/crash_generation_server.h"
 #include <windows.h>
+#include <stdio.h>
+#include <time.h>
 #include <cassert>
 #include <list>
+#include <vector>
 #include "client/windows/common/auto_critical_section.h"
 #include "common/scoped_ptr.h"
 
@@ -54,11 +57,21 @@ static const DWORD kDumpGeneratedEventAccess = EVENT_MODIFY_STATE |
 // Access flags for the client on the mutex.
 static const DWORD kMutexAccess = SYNCHRONIZE;
 
-// Attribute flags for the pipe.
+// Attribute flags for the first instance of the pipe. Only the first
+// instance may claim FILE_FLAG_FIRST_PIPE_INSTANCE; additional
+// instances of a multi-instance server use kPipeAttrNext.
 static const DWORD kPipeAttr = FILE_FLAG_FIRST_PIPE_INSTANCE |
                                PIPE_ACCESS_DUPLEX |
                                FILE_FLAG_OVERLAPPED;
 
+// Attribute flags for instances of the pipe after the first.
+static const DWORD kPipeAttrNext = PIPE_ACCESS_DUPLEX |
+                                   FILE_FLAG_OVERLAPPED;
+
+// Cap on the number of pipe instances a server may create; well below
+// the PIPE_UNLIMITED_INSTANCES limit of CreateNamedPipe.
+static const int kMaxPipeInstances = 64;
+
 // Mode for the pipe.
 static const DWORD kPipeMode = PIPE_TYPE_MESSAGE |
                                PIPE_READMODE_MESSAGE |
@@ -76,6 +89,11 @@ static const ULONG kPipeIOThreadFlags = WT_EXECUTEINWAITTHREAD;
 static const ULONG kDumpRequestThreadFlags = WT_EXECUTEINWAITTHREAD |
                                              WT_EXECUTELONGFUNCTION;
 
+// Rate-limit bucket units per dump token; see set_rate_limit. With 60
+// units per token, a dumps-per-minute refill rate lands on a whole
+// number of units per second.
+static const DWORD kTokenScale = 60;
+
 static bool IsClientRequestValid(const ProtocolMessage& msg) {
   return msg.tag == MESSAGE_TAG_UPLOAD_REQUEST ||
          (msg.tag == MESSAGE_TAG_REGISTRATION_REQUEST &&
@@ -100,9 +118,10 @@ CrashGenerationServer::CrashGenerationServer(
     const std::wstring* dump_path)
     : pipe_name_(pipe_name),
       pipe_sec_attrs_(pipe_sec_attrs),
-      pipe_(NULL),
-      pipe_wait_handle_(NULL),
+      pipe_instance_count_(1),
       server_alive_handle_(NULL),
+      dump_semaphore_(NULL),
+      max_concurrent_dumps_(0),
       connect_callback_(connect_callback),
       connect_context_(connect_context),
       dump_callback_(dump_callback),
@@ -113,14 +132,25 @@ CrashGenerationServer::CrashGenerationServer(
       upload_context_(upload_context),
       generate_dumps_(generate_dumps),
       dump_generator_(NULL),
-      server_state_(IPC_SERVER_STATE_UNINITIALIZED),
-      shutting_down_(false),
-      overlapped_(),
-      client_info_(NULL) {
+      suppression_window_seconds_(0),
+      max_dumps_per_signature_(1),
+      rate_dumps_per_minute_(0),
+      rate_burst_size_(0),
+      rate_bucket_units_(0),
+      rate_last_refill_(0),
+      priority_callback_(NULL),
+      priority_context_(NULL),
+      started_(false),
+      shutting_down_(false) {
   InitializeCriticalSection(&sync_);
 
+  for (int i = 0; i <= CRASH_PRIORITY_HIGH; ++i) {
+    rate_dropped_counts_[i] = 0;
+  }
+
   if (dump_path) {
     dump_generator_.reset(new MinidumpGenerator(*dump_path));
+    dump_path_ = *dump_path;
   }
 }
 
@@ -143,29 +173,61 @@ CrashGenerationServer::~CrashGenerationServer() {
   // not even from another thread.
 
   // Even if there are no current worker threads running, it is possible that
-  // an I/O request is pending on the pipe right now but not yet done.
-  // In fact, it's very likely this is the case unless we are in an ERROR
-  // state. If we don't wait for the pending I/O to be done, then when the I/O
-  // completes, it may write to invalid memory. AppVerifier will flag this
-  // problem too. So we disconnect from the pipe and then wait for the server
-  // to get into error state so that the pending I/O will fail and get
-  // cleared.
-  DisconnectNamedPipe(pipe_);
+  // an I/O request is pending on a pipe instance right now but not yet done.
+  // In fact, it's very likely this is the case unless an instance is in an
+  // ERROR state. If we don't wait for the pending I/O to be done, then when
+  // the I/O completes, it may write to invalid memory. AppVerifier will flag
+  // this problem too. So we disconnect from the pipes and then wait for every
+  // instance to get into error state so that the pending I/O will fail and
+  // get cleared.
+  std::vector<PipeInstance*>::iterator instance_iter;
+  for (instance_iter = pipe_instances_.begin();
+       instance_iter != pipe_instances_.end();
+       ++instance_iter) {
+    if ((*instance_iter)->pipe) {
+      DisconnectNamedPipe((*instance_iter)->pipe);
+    }
+  }
   int num_tries = 100;
-  while (num_tries-- && server_state_ != IPC_SERVER_STATE_ERROR) {
+  while (num_tries--) {
+    bool all_in_error_state = true;
+    for (instance_iter = pipe_instances_.begin();
+         instance_iter != pipe_instances_.end();
+         ++instance_iter) {
+      if ((*instance_iter)->state != IPC_SERVER_STATE_ERROR) {
+        all_in_error_state = false;
+        break;
+      }
+    }
+    if (all_in_error_state) {
+      break;
+    }
     Sleep(10);
   }
 
-  // Unregister wait on the pipe.
-  if (pipe_wait_handle_) {
-    // Wait for already executing callbacks to finish.
-    UnregisterWaitEx(pipe_wait_handle_, INVALID_HANDLE_VALUE);
-  }
+  for (instance_iter = pipe_instances_.begin();
+       instance_iter != pipe_instances_.end();
+       ++instance_iter) {
+    PipeInstance* instance = *instance_iter;
+
+    // Unregister wait on the pipe instance.
+    if (instance->wait_handle) {
+      // Wait for already executing callbacks to finish.
+      UnregisterWaitEx(instance->wait_handle, INVALID_HANDLE_VALUE);
+    }
+
+    // Close the pipe to avoid further client connections.
+    if (instance->pipe) {
+      CloseHandle(instance->pipe);
+    }
 
-  // Close the pipe to avoid further client connections.
-  if (pipe_) {
-    CloseHandle(pipe_);
+    if (instance->overlapped.hEvent) {
+      CloseHandle(instance->overlapped.hEvent);
+    }
+
+    delete instance;
   }
+  pipe_instances_.clear();
 
   // Request all ClientInfo objects to unregister all waits.
   // No need to enter the critical section because no one is allowed to modify
@@ -195,74 +257,198 @@ CrashGenerationServer::~CrashGenerationServer() {
     CloseHandle(server_alive_handle_);
   }
 
-  if (overlapped_.hEvent) {
-    CloseHandle(overlapped_.hEvent);
+  if (dump_semaphore_) {
+    CloseHandle(dump_semaphore_);
   }
-  
+
   DeleteCriticalSection(&sync_);
 }
 
 bool CrashGenerationServer::Start() {
-  if (server_state_ != IPC_SERVER_STATE_UNINITIALIZED) {
+  if (started_) {
     return false;
   }
 
-  server_state_ = IPC_SERVER_STATE_INITIAL;
+  started_ = true;
+
+  // The rate-limit bucket starts full, so a short burst right after
+  // startup is admitted and only a sustained storm is shed.
+  rate_bucket_units_ =
+      static_cast<ULONGLONG>(rate_burst_size_) * kTokenScale;
+  rate_last_refill_ = time(NULL);
 
   server_alive_handle_ = CreateMutex(NULL, TRUE, NULL);
   if (!server_alive_handle_) {
     return false;
   }
 
+  if (max_concurrent_dumps_ > 0) {
+    dump_semaphore_ = CreateSemaphore(NULL,
+                                      max_concurrent_dumps_,
+                                      max_concurrent_dumps_,
+                                      NULL);
+    if (!dump_semaphore_) {
+      return false;
+    }
+  }
+
+  // The first instance reserves the pipe name; additional instances
+  // attach to it so that multiple clients can run the registration
+  // handshake at the same time.
+  for (int i = 0; i < pipe_instance_count_; ++i) {
+    if (!StartPipeInstance(i == 0)) {
+      return false;
+    }
+  }
+
+  // If we are in error state, it's because we failed to start listening.
+  return true;
+}
+
+bool CrashGenerationServer::StartPipeInstance(bool first_instance) {
+  PipeInstance* instance = new PipeInstance;
+  instance->server = this;
+  instance->pipe = NULL;
+  instance->wait_handle = NULL;
+  // Keep the instance in the error state until it is fully wired up, so
+  // that a failed Start does not leave the destructor waiting for it to
+  // fail its pending I/O.
+  instance->state = IPC_SERVER_STATE_ERROR;
+  memset(&instance->overlapped, 0, sizeof(instance->overlapped));
+  memset(&instance->msg, 0, sizeof(instance->msg));
+  instance->client_info = NULL;
+
+  // The destructor cleans up whatever handles the instance holds once
+  // it is in the list.
+  pipe_instances_.push_back(instance);
+
   // Event to signal the client connection and pipe reads and writes.
-  overlapped_.hEvent = CreateEvent(NULL,   // Security descriptor.
-                                   TRUE,   // Manual reset.
-                                   FALSE,  // Initially nonsignaled.
-                                   NULL);  // Name.
-  if (!overlapped_.hEvent) {
+  instance->overlapped.hEvent = CreateEvent(NULL,   // Security descriptor.
+                                            TRUE,   // Manual reset.
+                                            FALSE,  // Initially nonsignaled.
+                                            NULL);  // Name.
+  if (!instance->overlapped.hEvent) {
     return false;
   }
 
   // Register a callback with the thread pool for the client connection.
-  if (!RegisterWaitForSingleObject(&pipe_wait_handle_,
-                                   overlapped_.hEvent,
+  if (!RegisterWaitForSingleObject(&instance->wait_handle,
+                                   instance->overlapped.hEvent,
                                    OnPipeConnected,
-                                   this,
+                                   instance,
                                    INFINITE,
                                    kPipeIOThreadFlags)) {
     return false;
   }
 
-  pipe_ = CreateNamedPipe(pipe_name_.c_str(),
-                          kPipeAttr,
-                          kPipeMode,
-                          1,
-                          kOutBufferSize,
-                          kInBufferSize,
-                          0,
-                          pipe_sec_attrs_);
-  if (pipe_ == INVALID_HANDLE_VALUE) {
+  instance->pipe = CreateNamedPipe(pipe_name_.c_str(),
+                                   first_instance ? kPipeAttr : kPipeAttrNext,
+                                   kPipeMode,
+                                   pipe_instance_count_,
+                                   kOutBufferSize,
+                                   kInBufferSize,
+                                   0,
+                                   pipe_sec_attrs_);
+  if (instance->pipe == INVALID_HANDLE_VALUE) {
+    instance->pipe = NULL;
     return false;
   }
 
+  instance->state = IPC_SERVER_STATE_INITIAL;
+
   // Kick-start the state machine. This will initiate an asynchronous wait
   // for client connections.
-  if (!SetEvent(overlapped_.hEvent)) {
-    server_state_ = IPC_SERVER_STATE_ERROR;
+  if (!SetEvent(instance->overlapped.hEvent)) {
+    instance->state = IPC_SERVER_STATE_ERROR;
     return false;
   }
 
-  // If we are in error state, it's because we failed to start listening.
   return true;
 }
 
-// If the server thread serving clients ever gets into the
-// ERROR state, reset the event, close the pipe and remain
-// in the error state forever. Error state means something
-// that we didn't account for has happened, and it's dangerous
-// to do anything unknowingly.
-void CrashGenerationServer::HandleErrorState() {
-  assert(server_state_ == IPC_SERVER_STATE_ERROR);
+void CrashGenerationServer::set_pipe_instances(int instances) {
+  assert(!started_);
+  if (instances < 1) {
+    instances = 1;
+  } else if (instances > kMaxPipeInstances) {
+    instances = kMaxPipeInstances;
+  }
+  pipe_instance_count_ = instances;
+}
+
+void CrashGenerationServer::set_max_concurrent_dumps(int max_dumps) {
+  assert(!started_);
+  max_concurrent_dumps_ = max_dumps > 0 ? max_dumps : 0;
+}
+
+void CrashGenerationServer::set_spool_directory(
+    const std::wstring& spool_directory) {
+  assert(!started_);
+  spool_path_ = spool_directory;
+  if (spool_path_.empty()) {
+    spool_generator_.reset(NULL);
+  } else {
+    spool_generator_.reset(new MinidumpGenerator(spool_path_));
+  }
+}
+
+void CrashGenerationServer::set_duplicate_suppression(
+    DWORD window_seconds,
+    DWORD max_dumps_per_signature) {
+  assert(!started_);
+  suppression_window_seconds_ = window_seconds;
+  max_dumps_per_signature_ = max_dumps_per_signature;
+}
+
+void CrashGenerationServer::set_rate_limit(DWORD dumps_per_minute,
+                                           DWORD burst_size) {
+  assert(!started_);
+  rate_dumps_per_minute_ = dumps_per_minute;
+  rate_burst_size_ = burst_size > 0 ? burst_size : 1;
+}
+
+void CrashGenerationServer::set_priority_callback(
+    ClientPriorityCallback callback,
+    void* callback_context) {
+  assert(!started_);
+  priority_callback_ = callback;
+  priority_context_ = callback_context;
+}
+
+DWORD CrashGenerationServer::rate_limited_count(CrashPriority priority) {
+  assert(priority >= CRASH_PRIORITY_LOW && priority <= CRASH_PRIORITY_HIGH);
+
+  AutoCriticalSection lock(&sync_);
+  return rate_dropped_counts_[priority];
+}
+
+void CrashGenerationServer::set_dump_policy(const DumpPolicy& policy) {
+  AutoCriticalSection lock(&sync_);
+  dump_policy_ = policy;
+}
+
+bool CrashGenerationServer::SetClientDumpPolicy(DWORD pid,
+                                                const DumpPolicy& policy) {
+  AutoCriticalSection lock(&sync_);
+
+  for (std::list<ClientInfo*>::iterator iter = clients_.begin();
+       iter != clients_.end();
+       ++iter) {
+    if ((*iter)->pid() == pid) {
+      (*iter)->set_dump_policy(policy);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// If a pipe instance ever gets into the ERROR state, reset the
+// event, close the pipe and remain in the error state forever.
+// Error state means something that we didn't account for has
+// happened, and it's dangerous to do anything unknowingly.
+void CrashGenerationServer::HandleErrorState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_ERROR);
 
   // If the server is shutting down anyway, don't clean up
   // here since shut down process will clean up.
@@ -270,36 +456,36 @@ void CrashGenerationServer::HandleErrorState() {
     return;
   }
 
-  if (pipe_wait_handle_) {
-    UnregisterWait(pipe_wait_handle_);
-    pipe_wait_handle_ = NULL;
+  if (instance->wait_handle) {
+    UnregisterWait(instance->wait_handle);
+    instance->wait_handle = NULL;
   }
 
-  if (pipe_) {
-    CloseHandle(pipe_);
-    pipe_ = NULL;
+  if (instance->pipe) {
+    CloseHandle(instance->pipe);
+    instance->pipe = NULL;
   }
 
-  if (overlapped_.hEvent) {
-    CloseHandle(overlapped_.hEvent);
-    overlapped_.hEvent = NULL;
+  if (instance->overlapped.hEvent) {
+    CloseHandle(instance->overlapped.hEvent);
+    instance->overlapped.hEvent = NULL;
   }
 }
 
-// When the server thread serving clients is in the INITIAL state,
-// try to connect to the pipe asynchronously. If the connection
-// finishes synchronously, directly go into the CONNECTED state;
-// otherwise go into the CONNECTING state. For any problems, go
-// into the ERROR state.
-void CrashGenerationServer::HandleInitialState() {
-  assert(server_state_ == IPC_SERVER_STATE_INITIAL);
+// When a pipe instance is in the INITIAL state, try to connect to
+// the pipe asynchronously. If the connection finishes synchronously,
+// directly go into the CONNECTED state; otherwise go into the
+// CONNECTING state. For any problems, go into the ERROR state.
+void CrashGenerationServer::HandleInitialState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_INITIAL);
 
-  if (!ResetEvent(overlapped_.hEvent)) {
-    EnterErrorState();
+  if (!ResetEvent(instance->overlapped.hEvent)) {
+    EnterErrorState(instance);
     return;
   }
 
-  bool success = ConnectNamedPipe(pipe_, &overlapped_) != FALSE;
+  bool success = ConnectNamedPipe(instance->pipe,
+                                  &instance->overlapped) != FALSE;
   DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
 
   // From MSDN, it is not clear that when ConnectNamedPipe is used
@@ -309,58 +495,58 @@ void CrashGenerationServer::HandleInitialState() {
 
   switch (error_code) {
     case ERROR_IO_PENDING:
-      EnterStateWhenSignaled(IPC_SERVER_STATE_CONNECTING);
+      EnterStateWhenSignaled(instance, IPC_SERVER_STATE_CONNECTING);
       break;
 
     case ERROR_PIPE_CONNECTED:
-      EnterStateImmediately(IPC_SERVER_STATE_CONNECTED);
+      EnterStateImmediately(instance, IPC_SERVER_STATE_CONNECTED);
       break;
 
     default:
-      EnterErrorState();
+      EnterErrorState(instance);
       break;
   }
 }
 
-// When the server thread serving the clients is in the CONNECTING state,
-// try to get the result of the asynchronous connection request using
-// the OVERLAPPED object. If the result indicates the connection is done,
-// go into the CONNECTED state. If the result indicates I/O is still
-// INCOMPLETE, remain in the CONNECTING state. For any problems,
-// go into the DISCONNECTING state.
-void CrashGenerationServer::HandleConnectingState() {
-  assert(server_state_ == IPC_SERVER_STATE_CONNECTING);
+// When a pipe instance is in the CONNECTING state, try to get the
+// result of the asynchronous connection request using the OVERLAPPED
+// object. If the result indicates the connection is done, go into the
+// CONNECTED state. If the result indicates I/O is still INCOMPLETE,
+// remain in the CONNECTING state. For any problems, go into the
+// DISCONNECTING state.
+void CrashGenerationServer::HandleConnectingState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_CONNECTING);
 
   DWORD bytes_count = 0;
-  bool success = GetOverlappedResult(pipe_,
-                                     &overlapped_,
+  bool success = GetOverlappedResult(instance->pipe,
+                                     &instance->overlapped,
                                      &bytes_count,
                                      FALSE) != FALSE;
   DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
 
   if (success) {
-    EnterStateImmediately(IPC_SERVER_STATE_CONNECTED);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_CONNECTED);
   } else if (error_code != ERROR_IO_INCOMPLETE) {
-    EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
   } else {
     // remain in CONNECTING state
   }
 }
 
-// When the server thread serving the clients is in the CONNECTED state,
-// try to issue an asynchronous read from the pipe. If read completes
-// synchronously or if I/O is pending then go into the READING state.
-// For any problems, go into the DISCONNECTING state.
-void CrashGenerationServer::HandleConnectedState() {
-  assert(server_state_ == IPC_SERVER_STATE_CONNECTED);
+// When a pipe instance is in the CONNECTED state, try to issue an
+// asynchronous read from the pipe. If read completes synchronously or
+// if I/O is pending then go into the READING state. For any problems,
+// go into the DISCONNECTING state.
+void CrashGenerationServer::HandleConnectedState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_CONNECTED);
 
   DWORD bytes_count = 0;
-  memset(&msg_, 0, sizeof(msg_));
-  bool success = ReadFile(pipe_,
-                          &msg_,
-                          sizeof(msg_),
+  memset(&instance->msg, 0, sizeof(instance->msg));
+  bool success = ReadFile(instance->pipe,
+                          &instance->msg,
+                          sizeof(instance->msg),
                           &bytes_count,
-                          &overlapped_) != FALSE;
+                          &instance->overlapped) != FALSE;
   DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
 
   // Note that the asynchronous read issued above can finish before the
@@ -369,108 +555,113 @@ void CrashGenerationServer::HandleConnectedState() {
   // is done, the callback for it would not be executed until the current
   // thread finishes its execution.
   if (success || error_code == ERROR_IO_PENDING) {
-    EnterStateWhenSignaled(IPC_SERVER_STATE_READING);
+    EnterStateWhenSignaled(instance, IPC_SERVER_STATE_READING);
   } else {
-    EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
   }
 }
 
-// When the server thread serving the clients is in the READING state,
-// try to get the result of the async read. If async read is done,
-// go into the READ_DONE state. For any problems, go into the
-// DISCONNECTING state.
-void CrashGenerationServer::HandleReadingState() {
-  assert(server_state_ == IPC_SERVER_STATE_READING);
+// When a pipe instance is in the READING state, try to get the result
+// of the async read. If async read is done, go into the READ_DONE
+// state. For any problems, go into the DISCONNECTING state.
+void CrashGenerationServer::HandleReadingState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_READING);
 
   DWORD bytes_count = 0;
-  bool success = GetOverlappedResult(pipe_,
-                                     &overlapped_,
+  bool success = GetOverlappedResult(instance->pipe,
+                                     &instance->overlapped,
                                      &bytes_count,
                                      FALSE) != FALSE;
   DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
 
   if (success && bytes_count == sizeof(ProtocolMessage)) {
-    EnterStateImmediately(IPC_SERVER_STATE_READ_DONE);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_READ_DONE);
   } else {
     // We should never get an I/O incomplete since we should not execute this
     // unless the Read has finished and the overlapped event is signaled. If
     // we do get INCOMPLETE, we have a bug in our code.
     assert(error_code != ERROR_IO_INCOMPLETE);
 
-    EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
   }
 }
 
-// When the server thread serving the client is in the READ_DONE state,
-// validate the client's request message, register the client by
-// creating appropriate objects and prepare the response.  Then try to
-// write the response to the pipe asynchronously. If that succeeds,
-// go into the WRITING state. For any problems, go into the DISCONNECTING
-// state.
-void CrashGenerationServer::HandleReadDoneState() {
-  assert(server_state_ == IPC_SERVER_STATE_READ_DONE);
+// When a pipe instance is in the READ_DONE state, validate the
+// client's request message, register the client by creating
+// appropriate objects and prepare the response.  Then try to write the
+// response to the pipe asynchronously. If that succeeds, go into the
+// WRITING state. For any problems, go into the DISCONNECTING state.
+void CrashGenerationServer::HandleReadDoneState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_READ_DONE);
 
-  if (!IsClientRequestValid(msg_)) {
-    EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+  if (!IsClientRequestValid(instance->msg)) {
+    EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
     return;
   }
 
-  if (msg_.tag == MESSAGE_TAG_UPLOAD_REQUEST) {
+  if (instance->msg.tag == MESSAGE_TAG_UPLOAD_REQUEST) {
     if (upload_request_callback_)
-      upload_request_callback_(upload_context_, msg_.id);
-    EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+      upload_request_callback_(upload_context_, instance->msg.id);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
     return;
   }
 
   scoped_ptr<ClientInfo> client_info(
       new ClientInfo(this,
-                     msg_.id,
-                     msg_.dump_type,
-                     msg_.thread_id,
-                     msg_.exception_pointers,
-                     msg_.assert_info,
-                     msg_.custom_client_info));
+                     instance->msg.id,
+                     instance->msg.dump_type,
+                     instance->msg.thread_id,
+                     instance->msg.exception_pointers,
+                     instance->msg.assert_info,
+                     instance->msg.custom_client_info,
+                     instance->msg.crash_info_section_handle));
+
+  // Assign the current default dump policy to the new client. The
+  // server application can override it later with SetClientDumpPolicy.
+  {
+    AutoCriticalSection lock(&sync_);
+    client_info->set_dump_policy(dump_policy_);
+  }
 
   if (!client_info->Initialize()) {
-    EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
     return;
   }
 
   // Issues an asynchronous WriteFile call if successful.
   // Iff successful, assigns ownership of the client_info pointer to the server
   // instance, in which case we must be sure not to free it in this function.
-  if (!RespondToClient(client_info.get())) {
-    EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+  if (!RespondToClient(instance, client_info.get())) {
+    EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
     return;
   }
 
   // This is only valid as long as it can be found in the clients_ list
-  client_info_ = client_info.release();
+  instance->client_info = client_info.release();
 
   // Note that the asynchronous write issued by RespondToClient function
   // can finish before  the code below executes. But it is okay to change
   // state after issuing the asynchronous write. This is because even if
   // the asynchronous write is done, the callback for it would not be
   // executed until the current thread finishes its execution.
-  EnterStateWhenSignaled(IPC_SERVER_STATE_WRITING);
+  EnterStateWhenSignaled(instance, IPC_SERVER_STATE_WRITING);
 }
 
-// When the server thread serving the clients is in the WRITING state,
-// try to get the result of the async write. If the async write is done,
-// go into the WRITE_DONE state. For any problems, go into the
-// DISONNECTING state.
-void CrashGenerationServer::HandleWritingState() {
-  assert(server_state_ == IPC_SERVER_STATE_WRITING);
+// When a pipe instance is in the WRITING state, try to get the result
+// of the async write. If the async write is done, go into the
+// WRITE_DONE state. For any problems, go into the DISONNECTING state.
+void CrashGenerationServer::HandleWritingState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_WRITING);
 
   DWORD bytes_count = 0;
-  bool success = GetOverlappedResult(pipe_,
-                                     &overlapped_,
+  bool success = GetOverlappedResult(instance->pipe,
+                                     &instance->overlapped,
                                      &bytes_count,
                                      FALSE) != FALSE;
   DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
 
   if (success) {
-    EnterStateImmediately(IPC_SERVER_STATE_WRITE_DONE);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_WRITE_DONE);
     return;
   }
 
@@ -479,41 +670,41 @@ void CrashGenerationServer::HandleWritingState() {
   // we do get INCOMPLETE, we have a bug in our code.
   assert(error_code != ERROR_IO_INCOMPLETE);
 
-  EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+  EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
 }
 
-// When the server thread serving the clients is in the WRITE_DONE state,
-// try to issue an async read on the pipe. If the read completes synchronously
-// or if I/O is still pending then go into the READING_ACK state. For any
+// When a pipe instance is in the WRITE_DONE state, try to issue an
+// async read on the pipe. If the read completes synchronously or if
+// I/O is still pending then go into the READING_ACK state. For any
 // issues, go into the DISCONNECTING state.
-void CrashGenerationServer::HandleWriteDoneState() {
-  assert(server_state_ == IPC_SERVER_STATE_WRITE_DONE);
+void CrashGenerationServer::HandleWriteDoneState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_WRITE_DONE);
 
   DWORD bytes_count = 0;
-  bool success = ReadFile(pipe_,
-                           &msg_,
-                           sizeof(msg_),
+  bool success = ReadFile(instance->pipe,
+                           &instance->msg,
+                           sizeof(instance->msg),
                            &bytes_count,
-                           &overlapped_) != FALSE;
+                           &instance->overlapped) != FALSE;
   DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
 
   if (success) {
-    EnterStateImmediately(IPC_SERVER_STATE_READING_ACK);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_READING_ACK);
   } else if (error_code == ERROR_IO_PENDING) {
-    EnterStateWhenSignaled(IPC_SERVER_STATE_READING_ACK);
+    EnterStateWhenSignaled(instance, IPC_SERVER_STATE_READING_ACK);
   } else {
-    EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+    EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
   }
 }
 
-// When the server thread serving the clients is in the READING_ACK state,
-// try to get result of async read. Go into the DISCONNECTING state.
-void CrashGenerationServer::HandleReadingAckState() {
-  assert(server_state_ == IPC_SERVER_STATE_READING_ACK);
+// When a pipe instance is in the READING_ACK state, try to get result
+// of async read. Go into the DISCONNECTING state.
+void CrashGenerationServer::HandleReadingAckState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_READING_ACK);
 
   DWORD bytes_count = 0;
-  bool success = GetOverlappedResult(pipe_,
-                                     &overlapped_,
+  bool success = GetOverlappedResult(instance->pipe,
+                                     &instance->overlapped,
                                      &bytes_count,
                                      FALSE) != FALSE;
   DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
@@ -525,28 +716,28 @@ void CrashGenerationServer::HandleReadingAckState() {
       // Note that there is only a single copy of the ClientInfo of the
       // currently connected client.  However it is being referenced from
       // two different places:
-      //  - the client_info_ member
+      //  - the instance's client_info member
       //  - the clients_ list
       // The lifetime of this ClientInfo depends on the lifetime of the
       // client process - basically it can go away at any time.
       // However, as long as it is referenced by the clients_ list it
       // is guaranteed to be valid. Enter the critical section and check
-      // to see whether the client_info_ can be found in the list.
-      // If found, execute the callback and only then leave the critical
-      // section.
+      // to see whether the instance's client_info can be found in the
+      // list. If found, execute the callback and only then leave the
+      // critical section.
       AutoCriticalSection lock(&sync_);
 
       bool client_is_still_alive = false;
       std::list<ClientInfo*>::iterator iter;
       for (iter = clients_.begin(); iter != clients_.end(); ++iter) {
-        if (client_info_ == *iter) {
+        if (instance->client_info == *iter) {
           client_is_still_alive = true;
           break;
         }
       }
 
       if (client_is_still_alive) {
-        connect_callback_(connect_context_, client_info_);
+        connect_callback_(connect_context_, instance->client_info);
       }
     }
   } else {
@@ -556,32 +747,32 @@ void CrashGenerationServer::HandleReadingAckState() {
     assert(error_code != ERROR_IO_INCOMPLETE);
   }
 
-  EnterStateImmediately(IPC_SERVER_STATE_DISCONNECTING);
+  EnterStateImmediately(instance, IPC_SERVER_STATE_DISCONNECTING);
 }
 
-// When the server thread serving the client is in the DISCONNECTING state,
-// disconnect from the pipe and reset the event. If anything fails, go into
-// the ERROR state. If it goes well, go into the INITIAL state and set the
-// event to start all over again.
-void CrashGenerationServer::HandleDisconnectingState() {
-  assert(server_state_ == IPC_SERVER_STATE_DISCONNECTING);
+// When a pipe instance is in the DISCONNECTING state, disconnect from
+// the pipe and reset the event. If anything fails, go into the ERROR
+// state. If it goes well, go into the INITIAL state and set the event
+// to start all over again.
+void CrashGenerationServer::HandleDisconnectingState(PipeInstance* instance) {
+  assert(instance->state == IPC_SERVER_STATE_DISCONNECTING);
 
   // Done serving the client.
-  client_info_ = NULL;
+  instance->client_info = NULL;
 
-  overlapped_.Internal = NULL;
-  overlapped_.InternalHigh = NULL;
-  overlapped_.Offset = 0;
-  overlapped_.OffsetHigh = 0;
-  overlapped_.Pointer = NULL;
+  instance->overlapped.Internal = NULL;
+  instance->overlapped.InternalHigh = NULL;
+  instance->overlapped.Offset = 0;
+  instance->overlapped.OffsetHigh = 0;
+  instance->overlapped.Pointer = NULL;
 
-  if (!ResetEvent(overlapped_.hEvent)) {
-    EnterErrorState();
+  if (!ResetEvent(instance->overlapped.hEvent)) {
+    EnterErrorState(instance);
     return;
   }
 
-  if (!DisconnectNamedPipe(pipe_)) {
-    EnterErrorState();
+  if (!DisconnectNamedPipe(instance->pipe)) {
+    EnterErrorState(instance);
     return;
   }
 
@@ -591,23 +782,25 @@ void CrashGenerationServer::HandleDisconnectingState() {
     return;
   }
 
-  EnterStateImmediately(IPC_SERVER_STATE_INITIAL);
+  EnterStateImmediately(instance, IPC_SERVER_STATE_INITIAL);
 }
 
-void CrashGenerationServer::EnterErrorState() {
-  SetEvent(overlapped_.hEvent);
-  server_state_ = IPC_SERVER_STATE_ERROR;
+void CrashGenerationServer::EnterErrorState(PipeInstance* instance) {
+  SetEvent(instance->overlapped.hEvent);
+  instance->state = IPC_SERVER_STATE_ERROR;
 }
 
-void CrashGenerationServer::EnterStateWhenSignaled(IPCServerState state) {
-  server_state_ = state;
+void CrashGenerationServer::EnterStateWhenSignaled(PipeInstance* instance,
+                                                   IPCServerState state) {
+  instance->state = state;
 }
 
-void CrashGenerationServer::EnterStateImmediately(IPCServerState state) {
-  server_state_ = state;
+void CrashGenerationServer::EnterStateImmediately(PipeInstance* instance,
+                                                  IPCServerState state) {
+  instance->state = state;
 
-  if (!SetEvent(overlapped_.hEvent)) {
-    server_state_ = IPC_SERVER_STATE_ERROR;
+  if (!SetEvent(instance->overlapped.hEvent)) {
+    instance->state = IPC_SERVER_STATE_ERROR;
   }
 }
 
@@ -694,18 +887,19 @@ bool CrashGenerationServer::CreateClientHandles(const ClientInfo& client_info,
   return true;
 }
 
-bool CrashGenerationServer::RespondToClient(ClientInfo* client_info) {
+bool CrashGenerationServer::RespondToClient(PipeInstance* instance,
+                                            ClientInfo* client_info) {
   ProtocolMessage reply;
   if (!PrepareReply(*client_info, &reply)) {
     return false;
   }
 
   DWORD bytes_count = 0;
-  bool success = WriteFile(pipe_,
+  bool success = WriteFile(instance->pipe,
                             &reply,
                             sizeof(reply),
                             &bytes_count,
-                            &overlapped_) != FALSE;
+                            &instance->overlapped) != FALSE;
   DWORD error_code = success ? ERROR_SUCCESS : GetLastError();
 
   if (!success && error_code != ERROR_IO_PENDING) {
@@ -719,62 +913,63 @@ bool CrashGenerationServer::RespondToClient(ClientInfo* client_info) {
 
 // The server thread servicing the clients runs this method. The method
 // implements the state machine described in ReadMe.txt along with the
-// helper methods HandleXXXState.
-void CrashGenerationServer::HandleConnectionRequest() {
+// helper methods HandleXXXState, for the pipe instance whose overlapped
+// event was signaled.
+void CrashGenerationServer::HandleConnectionRequest(PipeInstance* instance) {
   // If the server is shutting down, get into ERROR state, reset the event so
   // more workers don't run and return immediately.
   if (shutting_down_) {
-    server_state_ = IPC_SERVER_STATE_ERROR;
-    ResetEvent(overlapped_.hEvent);
+    instance->state = IPC_SERVER_STATE_ERROR;
+    ResetEvent(instance->overlapped.hEvent);
     return;
   }
 
-  switch (server_state_) {
+  switch (instance->state) {
     case IPC_SERVER_STATE_ERROR:
-      HandleErrorState();
+      HandleErrorState(instance);
       break;
 
     case IPC_SERVER_STATE_INITIAL:
-      HandleInitialState();
+      HandleInitialState(instance);
       break;
 
     case IPC_SERVER_STATE_CONNECTING:
-      HandleConnectingState();
+      HandleConnectingState(instance);
       break;
 
     case IPC_SERVER_STATE_CONNECTED:
-      HandleConnectedState();
+      HandleConnectedState(instance);
       break;
 
     case IPC_SERVER_STATE_READING:
-      HandleReadingState();
+      HandleReadingState(instance);
       break;
 
     case IPC_SERVER_STATE_READ_DONE:
-      HandleReadDoneState();
+      HandleReadDoneState(instance);
       break;
 
     case IPC_SERVER_STATE_WRITING:
-      HandleWritingState();
+      HandleWritingState(instance);
       break;
 
     case IPC_SERVER_STATE_WRITE_DONE:
-      HandleWriteDoneState();
+      HandleWriteDoneState(instance);
       break;
 
     case IPC_SERVER_STATE_READING_ACK:
-      HandleReadingAckState();
+      HandleReadingAckState(instance);
       break;
 
     case IPC_SERVER_STATE_DISCONNECTING:
-      HandleDisconnectingState();
+      HandleDisconnectingState(instance);
       break;
 
     default:
       assert(false);
       // This indicates that we added one more state without
       // adding handling code.
-      server_state_ = IPC_SERVER_STATE_ERROR;
+      instance->state = IPC_SERVER_STATE_ERROR;
       break;
   }
 }
@@ -822,9 +1017,8 @@ bool CrashGenerationServer::AddClient(ClientInfo* client_info) {
 void CALLBACK CrashGenerationServer::OnPipeConnected(void* context, BOOLEAN) {
   assert(context);
 
-  CrashGenerationServer* obj =
-      reinterpret_cast<CrashGenerationServer*>(context);
-  obj->HandleConnectionRequest();
+  PipeInstance* instance = reinterpret_cast<PipeInstance*>(context);
+  instance->server->HandleConnectionRequest(instance);
 }
 
 // static
@@ -885,14 +1079,53 @@ void CrashGenerationServer::HandleClientProcessExit(ClientInfo* client_info) {
 
 void CrashGenerationServer::HandleDumpRequest(const ClientInfo& client_info) {
   bool execute_callback = true;
+  bool client_released = false;
   // Generate the dump only if it's explicitly requested by the
   // server application; otherwise the server might want to generate
   // dump in the callback.
   std::wstring dump_path;
   if (generate_dumps_) {
-    if (!GenerateDump(client_info, &dump_path)) {
+    // Cheap early rejection under a crash storm: when rate limiting is
+    // on and the bucket has run dry, the client is released before any
+    // dump work - not even the exception record is read.
+    if (!AdmitCrashRequest(client_info)) {
+      SetEvent(client_info.dump_generated_handle());
+      return;
+    }
+
+    // A crash already dumped enough times this window costs only a
+    // signature computation and a line in the repeat log.
+    if (suppression_window_seconds_ > 0) {
+      ULONGLONG signature = ComputeCrashSignature(client_info);
+      if (signature != 0 && SuppressDuplicate(client_info, signature)) {
+        SetEvent(client_info.dump_generated_handle());
+        return;
+      }
+    }
+
+    // When a cap on concurrent dump writers is set, wait for a slot so
+    // that a burst of simultaneous crashes does not start an unbounded
+    // number of minidump writes at once.
+    if (dump_semaphore_) {
+      WaitForSingleObject(dump_semaphore_, INFINITE);
+    }
+    bool dump_generated = GenerateDump(client_info, &dump_path);
+    if (dump_semaphore_) {
+      ReleaseSemaphore(dump_semaphore_, 1, NULL);
+    }
+    if (!dump_generated) {
       // client proccess terminated or some other error
       execute_callback = false;
+    } else if (spool_generator_.get()) {
+      // The dump is captured; nothing below needs the crashed process
+      // any more, so release it before the move to destination storage
+      // and the dump callback run. client_info itself stays valid: the
+      // client's exit handler blocks until this request returns.
+      SetEvent(client_info.dump_generated_handle());
+      client_released = true;
+
+      std::wstring spool_file_path = dump_path;
+      FlushSpooledDump(spool_file_path, &dump_path);
     }
   }
 
@@ -901,7 +1134,152 @@ void CrashGenerationServer::HandleDumpRequest(const ClientInfo& client_info) {
     dump_callback_(dump_context_, &client_info, ptr_dump_path);
   }
 
-  SetEvent(client_info.dump_generated_handle());
+  if (!client_released) {
+    SetEvent(client_info.dump_generated_handle());
+  }
+}
+
+bool CrashGenerationServer::AdmitCrashRequest(const ClientInfo& client) {
+  if (rate_dumps_per_minute_ == 0) {
+    return true;
+  }
+
+  CrashPriority priority = CRASH_PRIORITY_NORMAL;
+  if (priority_callback_) {
+    priority = priority_callback_(priority_context_, client.pid());
+    if (priority < CRASH_PRIORITY_LOW || priority > CRASH_PRIORITY_HIGH) {
+      priority = CRASH_PRIORITY_NORMAL;
+    }
+  }
+
+  const time_t now = time(NULL);
+  const ULONGLONG capacity_units =
+      static_cast<ULONGLONG>(rate_burst_size_) * kTokenScale;
+
+  // Reserve the bottom of the bucket for the more important classes:
+  // low priority cannot drain it below half capacity and normal below
+  // a quarter, so when everything is crashing at once the remaining
+  // I/O budget goes to the dumps that matter most.
+  ULONGLONG floor_units = 0;
+  if (priority == CRASH_PRIORITY_LOW) {
+    floor_units = capacity_units / 2;
+  } else if (priority == CRASH_PRIORITY_NORMAL) {
+    floor_units = capacity_units / 4;
+  }
+
+  AutoCriticalSection lock(&sync_);
+  if (now > rate_last_refill_) {
+    // One second adds dumps_per_minute units - 1/60th of a token each.
+    rate_bucket_units_ +=
+        static_cast<ULONGLONG>(now - rate_last_refill_) *
+        rate_dumps_per_minute_;
+    if (rate_bucket_units_ > capacity_units) {
+      rate_bucket_units_ = capacity_units;
+    }
+    rate_last_refill_ = now;
+  }
+  if (rate_bucket_units_ >= floor_units + kTokenScale) {
+    rate_bucket_units_ -= kTokenScale;
+    return true;
+  }
+  ++rate_dropped_counts_[priority];
+  return false;
+}
+
+ULONGLONG CrashGenerationServer::ComputeCrashSignature(
+    const ClientInfo& client) {
+  EXCEPTION_POINTERS* client_ex_info = NULL;
+  if (!client.GetClientExceptionInfo(&client_ex_info) || !client_ex_info) {
+    return 0;
+  }
+
+  // The pointers and the exception record they lead to live in the
+  // client's address space; two small reads fetch them.
+  EXCEPTION_POINTERS pointers = {0};
+  SIZE_T bytes_count = 0;
+  if (!ReadProcessMemory(client.process_handle(),
+                         client_ex_info,
+                         &pointers,
+                         sizeof(pointers),
+                         &bytes_count) ||
+      bytes_count != sizeof(pointers) ||
+      pointers.ExceptionRecord == NULL) {
+    return 0;
+  }
+
+  EXCEPTION_RECORD record = {0};
+  if (!ReadProcessMemory(client.process_handle(),
+                         pointers.ExceptionRecord,
+                         &record,
+                         sizeof(record),
+                         &bytes_count) ||
+      bytes_count != sizeof(record)) {
+    return 0;
+  }
+
+  // The raw faulting address is stable across the laps of one crash
+  // loop, since the crashing process is the same process each time it
+  // re-registers; resolving it to a module offset would cost a PSAPI
+  // round trip per crash.
+  ULONGLONG signature = record.ExceptionCode;
+  signature = signature * 0x9E3779B97F4A7C15ULL ^
+      reinterpret_cast<ULONG_PTR>(record.ExceptionAddress);
+  return signature != 0 ? signature : 1;
+}
+
+bool CrashGenerationServer::SuppressDuplicate(const ClientInfo& client,
+                                              ULONGLONG signature) {
+  const time_t now = time(NULL);
+
+  bool suppress;
+  DWORD repeat_count = 0;
+  {
+    AutoCriticalSection lock(&sync_);
+    SignatureRecord& record = signature_records_[signature];
+    if (record.dumps_written == 0 ||
+        now - record.window_start >=
+            static_cast<time_t>(suppression_window_seconds_)) {
+      record.window_start = now;
+      record.dumps_written = 0;
+      record.suppressed = 0;
+    }
+    if (record.dumps_written < max_dumps_per_signature_) {
+      ++record.dumps_written;
+      suppress = false;
+    } else {
+      repeat_count = ++record.suppressed;
+      suppress = true;
+    }
+  }
+
+  if (!suppress) {
+    return false;
+  }
+
+  // Leave a tiny record of the repeat in place of a full dump.
+  std::wstring log_path = dump_path_ + L"\\suppressed-crashes.log";
+  HANDLE log_file = CreateFile(log_path.c_str(),
+                               FILE_APPEND_DATA,
+                               FILE_SHARE_READ,
+                               NULL,
+                               OPEN_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL,
+                               NULL);
+  if (log_file != INVALID_HANDLE_VALUE) {
+    char line[128];
+    const int length = sprintf(line,
+                               "%lld pid %lu signature %016llx repeat %lu\n",
+                               static_cast<long long>(now),
+                               client.pid(),
+                               signature,
+                               repeat_count);
+    if (length > 0) {
+      DWORD bytes_written = 0;
+      WriteFile(log_file, line, length, &bytes_written, NULL);
+    }
+    CloseHandle(log_file);
+  }
+  return true;
 }
 
 bool CrashGenerationServer::GenerateDump(const ClientInfo& client,
@@ -921,15 +1299,55 @@ bool CrashGenerationServer::GenerateDump(const ClientInfo& client,
     return false;
   }
 
-  return dump_generator_->WriteMinidump(client.process_handle(),
-                                        client.pid(),
-                                        client_thread_id,
-                                        GetCurrentThreadId(),
-                                        client_ex_info,
-                                        client.assert_info(),
-                                        client.dump_type(),
-                                        true,
-                                        dump_path);
+  // Copy the client's dump policy under the lock since the server
+  // application may change it concurrently via SetClientDumpPolicy.
+  DumpPolicy policy;
+  {
+    AutoCriticalSection lock(&sync_);
+    policy = client.dump_policy();
+  }
+
+  // Capture into the spool directory when one is configured; the
+  // caller moves the dump to its final location after the client has
+  // been released.
+  MinidumpGenerator* generator =
+      spool_generator_.get() ? spool_generator_.get() : dump_generator_.get();
+  return generator->WriteMinidump(client.process_handle(),
+                                  client.pid(),
+                                  client_thread_id,
+                                  GetCurrentThreadId(),
+                                  client_ex_info,
+                                  client.assert_info(),
+                                  client.dump_type(),
+                                  true,
+                                  dump_path,
+                                  NULL,
+                                  &policy);
+}
+
+void CrashGenerationServer::FlushSpooledDump(
+    const std::wstring& spool_file_path,
+    std::wstring* final_path) {
+  // Keep the file name the generator chose; only the directory changes.
+  std::wstring file_name = spool_file_path;
+  size_t separator = file_name.find_last_of(L"\\/");
+  if (separator != std::wstring::npos) {
+    file_name = file_name.substr(separator + 1);
+  }
+  std::wstring destination = dump_path_ + L"\\" + file_name;
+
+  // On the same volume this is a rename; across volumes MoveFileEx
+  // copies and deletes, which is exactly the slow path spooling keeps
+  // out of the crashed client's way.
+  if (MoveFileEx(spool_file_path.c_str(),
+                 destination.c_str(),
+                 MOVEFILE_COPY_ALLOWED | MOVEFILE_REPLACE_EXISTING)) {
+    *final_path = destination;
+  } else {
+    // Leave the dump in the spool directory rather than lose it; the
+    // callback still receives a path to a complete dump.
+    *final_path = spool_file_path;
+  }
 }
 
 }  // namespace google_breakpad
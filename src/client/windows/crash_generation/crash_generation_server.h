@@ -30,8 +30,12 @@
 #ifndef CLIENT_WINDOWS_CRASH_GENERATION_CRASH_GENERATION_SERVER_H__
 #define CLIENT_WINDOWS_CRASH_GENERATION_CRASH_GENERATION_SERVER_H__
 
+#include <time.h>
+
 #include <list>
+#include <map>
 #include <string>
+#include <vector>
 #include "client/windows/common/ipc_protocol.h"
 #include "client/windows/crash_generation/minidump_generator.h"
 #include "common/scoped_ptr.h"
@@ -47,6 +51,24 @@ class ClientInfo;
 // register. In response, it hands them event handles that the client can
 // signal to request dump generation. When the clients request dump
 // generation in this way, the server generates Windows minidump files.
+//
+// By default the server creates a single pipe instance, so clients
+// register one at a time. Servers that host many processes which can
+// crash simultaneously should call set_pipe_instances before Start to
+// create several pipe instances; each instance runs the registration
+// handshake independently on the thread pool, so clients no longer
+// queue behind each other waiting to connect. The number of minidumps
+// written concurrently can be capped with set_max_concurrent_dumps,
+// and dumps can be staged through a fast local spool directory with
+// set_spool_directory so that slow destination storage does not extend
+// the time a crashed client is held.
+//
+// What a dump contains is normally controlled by the MINIDUMP_TYPE the
+// client passed at registration. The server application can restrict
+// that per client with a DumpPolicy - for example the compact
+// DumpPolicy::Triage preset for a high-crash-volume population while
+// escalated clients keep full fidelity. See set_dump_policy and
+// SetClientDumpPolicy.
 class CrashGenerationServer {
  public:
   typedef void (*OnClientConnectedCallback)(void* context,
@@ -62,6 +84,20 @@ class CrashGenerationServer {
   typedef void (*OnClientUploadRequestCallback)(void* context,
                                                 const DWORD crash_id);
 
+  // Priority classes for crash rate limiting; see set_rate_limit.
+  // Higher classes may draw the bucket further down, so the dumps that
+  // matter most keep being written when the box is melting down.
+  enum CrashPriority {
+    CRASH_PRIORITY_LOW = 0,
+    CRASH_PRIORITY_NORMAL = 1,
+    CRASH_PRIORITY_HIGH = 2
+  };
+
+  // Returns the rate-limiting priority class for a crashing client.
+  // WARNING: invoked on thread pool threads while other requests wait,
+  // so it must be cheap and thread safe.
+  typedef CrashPriority (*ClientPriorityCallback)(void* context, DWORD pid);
+
   // Creates an instance with the given parameters.
   //
   // Parameter pipe_name: Name of the Windows named pipe
@@ -102,6 +138,85 @@ class CrashGenerationServer {
   // Returns true if initialization is successful; false otherwise.
   bool Start();
 
+  // Sets the number of named pipe instances that Start will create.
+  // Values are clamped to a small implementation limit. The default is
+  // 1, which preserves the original single-instance behavior. Must be
+  // called before Start.
+  void set_pipe_instances(int instances);
+
+  // Caps how many minidumps may be written concurrently. A burst of
+  // simultaneous crashes then queues on the cap instead of starting an
+  // unbounded number of dump writers. Zero (the default) leaves dump
+  // generation unbounded, as before. Must be called before Start.
+  void set_max_concurrent_dumps(int max_dumps);
+
+  // Spools dumps through the given directory. Each dump is captured
+  // into spool_directory - typically a fast local disk - and the
+  // crashed client is released as soon as the capture completes; the
+  // server then moves the file to the dump path (which may be slow
+  // storage, such as a network share) and runs the dump callback with
+  // the final location. Client-visible crash latency thus depends only
+  // on the spool disk, not on the destination storage. The spool
+  // directory should be on the same volume as the dump path when
+  // possible, so the move is a rename rather than a copy. An empty
+  // string (the default) disables spooling and keeps the original
+  // write-directly-to-destination behavior. Must be called before
+  // Start.
+  void set_spool_directory(const std::wstring& spool_directory);
+
+  // Suppresses repeated dumps of one crash. When window_seconds is
+  // non-zero, each dump request is first reduced to a cheap signature
+  // (the exception code and faulting address, read from the client's
+  // exception record) before any dump is written. Once
+  // max_dumps_per_signature dumps have been written for a signature
+  // within a window, further requests with that signature skip dump
+  // generation: a one-line repeat record is appended to
+  // <dump path>\suppressed-crashes.log and the client is released. The
+  // dump callback is not invoked for suppressed requests. Must be
+  // called before Start; a window_seconds of 0 (the default) disables
+  // suppression.
+  void set_duplicate_suppression(DWORD window_seconds,
+                                 DWORD max_dumps_per_signature);
+
+  // Bounds the rate of dump generation, distinct from duplicate
+  // suppression: during a cascading failure many different crashes
+  // arrive at once, and writing every dump starves the healthy
+  // processes sharing the box of I/O. Admission is a token bucket
+  // holding up to burst_size dumps and refilling at dumps_per_minute;
+  // a request that finds the bucket empty is rejected before any
+  // MiniDumpWriteDump work - the client is released immediately and
+  // the dump callback is not invoked. The lower half of the bucket is
+  // reserved for CRASH_PRIORITY_NORMAL and above and the lower quarter
+  // for CRASH_PRIORITY_HIGH, so a flood of low-priority crashes cannot
+  // starve the processes that matter; classes are assigned by the
+  // callback given to set_priority_callback. Must be called before
+  // Start; a dumps_per_minute of 0 (the default) disables rate
+  // limiting.
+  void set_rate_limit(DWORD dumps_per_minute, DWORD burst_size);
+
+  // Assigns rate-limiting priority classes to clients; see
+  // set_rate_limit. Without a callback every client is
+  // CRASH_PRIORITY_NORMAL. Must be called before Start.
+  void set_priority_callback(ClientPriorityCallback callback,
+                             void* callback_context);
+
+  // Number of crash requests dropped by the rate limiter for the given
+  // priority class since Start.
+  DWORD rate_limited_count(CrashPriority priority);
+
+  // Sets the dump policy assigned to clients when they register. The
+  // policy restricts what the server writes into a client's minidumps
+  // regardless of the MINIDUMP_TYPE the client requested; see
+  // DumpPolicy in minidump_generator.h. The default policy is
+  // unrestricted. May be called at any time; clients already registered
+  // keep their assigned policy.
+  void set_dump_policy(const DumpPolicy& policy);
+
+  // Overrides the dump policy of the registered client with the given
+  // process id, for example to restore full fidelity for a client under
+  // escalation. Returns false if no such client is registered.
+  bool SetClientDumpPolicy(DWORD pid, const DumpPolicy& policy);
+
  private:
   // Various states the client can be in during the handshake with
   // the server.
@@ -145,19 +260,51 @@ class CrashGenerationServer {
     IPC_SERVER_STATE_DISCONNECTING
   };
 
+  // State for one instance of the named pipe. Each instance runs its
+  // own copy of the connect/read/write handshake state machine, driven
+  // by thread pool callbacks on its overlapped event, so instances can
+  // serve different clients concurrently.
+  struct PipeInstance {
+    // The server this instance belongs to.
+    CrashGenerationServer* server;
+
+    // Handle to this instance of the pipe.
+    HANDLE pipe;
+
+    // Pipe wait handle for this instance.
+    HANDLE wait_handle;
+
+    // State of this instance in performing the IPC with the client.
+    IPCServerState state;
+
+    // Overlapped instance for async I/O on the pipe.
+    OVERLAPPED overlapped;
+
+    // Message object used in IPC with the client.
+    ProtocolMessage msg;
+
+    // Client Info for the client connecting through this instance.
+    ClientInfo* client_info;
+  };
+
+  // Creates one pipe instance, registers its overlapped event with the
+  // thread pool and kick-starts its state machine. Only the first
+  // instance claims FILE_FLAG_FIRST_PIPE_INSTANCE.
+  bool StartPipeInstance(bool first_instance);
+
   //
   // Helper methods to handle various server IPC states.
   //
-  void HandleErrorState();
-  void HandleInitialState();
-  void HandleConnectingState();
-  void HandleConnectedState();
-  void HandleReadingState();
-  void HandleReadDoneState();
-  void HandleWritingState();
-  void HandleWriteDoneState();
-  void HandleReadingAckState();
-  void HandleDisconnectingState();
+  void HandleErrorState(PipeInstance* instance);
+  void HandleInitialState(PipeInstance* instance);
+  void HandleConnectingState(PipeInstance* instance);
+  void HandleConnectedState(PipeInstance* instance);
+  void HandleReadingState(PipeInstance* instance);
+  void HandleReadDoneState(PipeInstance* instance);
+  void HandleWritingState(PipeInstance* instance);
+  void HandleWriteDoneState(PipeInstance* instance);
+  void HandleReadingAckState(PipeInstance* instance);
+  void HandleDisconnectingState(PipeInstance* instance);
 
   // Prepares reply for a client from the given parameters.
   bool PrepareReply(const ClientInfo& client_info,
@@ -170,12 +317,14 @@ class CrashGenerationServer {
   bool CreateClientHandles(const ClientInfo& client_info,
                            ProtocolMessage* reply) const;
 
-  // Response to the given client. Return true if all steps of
-  // responding to the client succeed, false otherwise.
-  bool RespondToClient(ClientInfo* client_info);
+  // Response to the given client over the given pipe instance. Return
+  // true if all steps of responding to the client succeed, false
+  // otherwise.
+  bool RespondToClient(PipeInstance* instance, ClientInfo* client_info);
 
-  // Handles a connection request from the client.
-  void HandleConnectionRequest();
+  // Handles a connection request from the client on the given pipe
+  // instance.
+  void HandleConnectionRequest(PipeInstance* instance);
 
   // Handles a dump request from the client.
   void HandleDumpRequest(const ClientInfo& client_info);
@@ -195,23 +344,48 @@ class CrashGenerationServer {
   // Adds the given client to the list of registered clients.
   bool AddClient(ClientInfo* client_info);
 
-  // Generates dump for the given client.
+  // Generates dump for the given client. When spooling is enabled the
+  // dump is written into the spool directory; FlushSpooledDump moves it
+  // to its final location afterwards.
   bool GenerateDump(const ClientInfo& client, std::wstring* dump_path);
 
-  // Puts the server in a permanent error state and sets a signal such that
-  // the state will be immediately entered after the current state transition
-  // is complete.
-  void EnterErrorState();
-
-  // Puts the server in the specified state and sets a signal such that the
-  // state is immediately entered after the current state transition is
-  // complete.
-  void EnterStateImmediately(IPCServerState state);
-
-  // Puts the server in the specified state. No signal will be set, so the state
-  // transition will only occur when signaled manually or by completion of an
-  // asynchronous IO operation.
-  void EnterStateWhenSignaled(IPCServerState state);
+  // Moves a captured dump from the spool directory to the dump path,
+  // storing the final location in *final_path. Runs after the client
+  // has been released; see set_spool_directory. If the move fails, the
+  // dump stays in the spool directory and *final_path names it there,
+  // so the dump callback still sees a valid file.
+  void FlushSpooledDump(const std::wstring& spool_file_path,
+                        std::wstring* final_path);
+
+  // Reduces the client's crash to its signature; see
+  // set_duplicate_suppression. Returns 0 when the exception record
+  // cannot be read, which disables suppression for the request.
+  ULONGLONG ComputeCrashSignature(const ClientInfo& client);
+
+  // Returns true if the crash request from the client may proceed,
+  // drawing one token from the rate-limit bucket; false if it must be
+  // dropped. See set_rate_limit.
+  bool AdmitCrashRequest(const ClientInfo& client);
+
+  // Returns true if the dump for signature should be suppressed,
+  // updating the signature's window accounting and, when suppressing,
+  // appending its repeat record.
+  bool SuppressDuplicate(const ClientInfo& client, ULONGLONG signature);
+
+  // Puts the pipe instance in a permanent error state and sets a signal
+  // such that the state will be immediately entered after the current
+  // state transition is complete.
+  void EnterErrorState(PipeInstance* instance);
+
+  // Puts the pipe instance in the specified state and sets a signal such
+  // that the state is immediately entered after the current state
+  // transition is complete.
+  void EnterStateImmediately(PipeInstance* instance, IPCServerState state);
+
+  // Puts the pipe instance in the specified state. No signal will be set,
+  // so the state transition will only occur when signaled manually or by
+  // completion of an asynchronous IO operation.
+  void EnterStateWhenSignaled(PipeInstance* instance, IPCServerState state);
 
   // Sync object for thread-safe access to the shared list of clients.
   CRITICAL_SECTION sync_;
@@ -225,15 +399,29 @@ class CrashGenerationServer {
   // Pipe security attributes
   SECURITY_ATTRIBUTES* pipe_sec_attrs_;
 
-  // Handle to the pipe used for handshake with clients.
-  HANDLE pipe_;
+  // Pipe instances used for handshake with clients. Each instance keeps
+  // its own handshake state, so multiple clients can register at the
+  // same time. A single instance degenerates to the original one-state
+  // server.
+  std::vector<PipeInstance*> pipe_instances_;
 
-  // Pipe wait handle.
-  HANDLE pipe_wait_handle_;
+  // Number of pipe instances that Start will create.
+  int pipe_instance_count_;
 
   // Handle to server-alive mutex.
   HANDLE server_alive_handle_;
 
+  // Semaphore bounding the number of concurrently written dumps, or
+  // NULL if dump generation is unbounded.
+  HANDLE dump_semaphore_;
+
+  // Requested cap on concurrently written dumps; 0 means no cap.
+  int max_concurrent_dumps_;
+
+  // Dump policy assigned to newly registering clients. Unrestricted by
+  // default.
+  DumpPolicy dump_policy_;
+
   // Callback for a successful client connection.
   OnClientConnectedCallback connect_callback_;
 
@@ -264,23 +452,46 @@ class CrashGenerationServer {
   // Instance of a mini dump generator.
   scoped_ptr<MinidumpGenerator> dump_generator_;
 
-  // State of the server in performing the IPC with the client.
-  // Note that since we restrict the pipe to one instance, we
-  // only need to keep one state of the server. Otherwise, server
-  // would have one state per client it is talking to.
-  IPCServerState server_state_;
+  // Path dumps are written under; also holds the repeat record log for
+  // suppressed duplicates. Empty when the server does not generate
+  // dumps itself.
+  std::wstring dump_path_;
 
-  // Whether the server is shutting down.
-  bool shutting_down_;
+  // Directory dumps are captured into before being moved to dump_path_,
+  // or empty when spooling is disabled. See set_spool_directory.
+  std::wstring spool_path_;
 
-  // Overlapped instance for async I/O on the pipe.
-  OVERLAPPED overlapped_;
+  // Generator writing into spool_path_; NULL when spooling is disabled.
+  scoped_ptr<MinidumpGenerator> spool_generator_;
 
-  // Message object used in IPC with the client.
-  ProtocolMessage msg_;
+  // Per-signature accounting for duplicate suppression; see
+  // set_duplicate_suppression. Guarded by sync_.
+  struct SignatureRecord {
+    time_t window_start;
+    DWORD dumps_written;
+    DWORD suppressed;
+  };
+  DWORD suppression_window_seconds_;
+  DWORD max_dumps_per_signature_;
+  std::map<ULONGLONG, SignatureRecord> signature_records_;
+
+  // Token-bucket rate limiting; see set_rate_limit. The bucket is kept
+  // in units of 1/60th of a token so per-minute refill rates divide
+  // evenly into one-second refill steps. Bucket state and the drop
+  // counters are guarded by sync_.
+  DWORD rate_dumps_per_minute_;
+  DWORD rate_burst_size_;
+  ULONGLONG rate_bucket_units_;
+  time_t rate_last_refill_;
+  ClientPriorityCallback priority_callback_;
+  void* priority_context_;
+  DWORD rate_dropped_counts_[CRASH_PRIORITY_HIGH + 1];
+
+  // Whether Start has been called.
+  bool started_;
 
-  // Client Info for the client that's connecting to the server.
-  ClientInfo* client_info_;
+  // Whether the server is shutting down.
+  bool shutting_down_;
 
   // Disable copy ctor and operator=.
   CrashGenerationServer(const CrashGenerationServer& crash_server);
@@ -238,6 +238,73 @@ ULONG CALLBACK HandleTraceData::RecordHandleOperations(
   return ERROR_SUCCESS;
 }
 
+// State threaded through DumpPolicyCallback while one dump is written.
+struct DumpPolicyCallbackContext {
+  // The policy being enforced. Never NULL.
+  const google_breakpad::DumpPolicy* policy;
+
+  // Thread stack bytes the dump may still consume. Only meaningful when
+  // the policy caps memory.
+  SIZE_T stack_bytes_remaining;
+};
+
+// MiniDumpWriteDump callback enforcing the parts of a DumpPolicy that
+// MINIDUMP_TYPE bits cannot express: per-thread stack trimming and
+// module data segment removal.
+BOOL CALLBACK DumpPolicyCallback(PVOID context,
+                                 const PMINIDUMP_CALLBACK_INPUT callback_input,
+                                 PMINIDUMP_CALLBACK_OUTPUT callback_output) {
+  DumpPolicyCallbackContext* policy_context =
+      reinterpret_cast<DumpPolicyCallbackContext*>(context);
+  const google_breakpad::DumpPolicy* policy = policy_context->policy;
+
+  switch (callback_input->CallbackType) {
+    case ThreadCallback: {
+      if (policy->module_list_only) {
+        // Keep the thread entry so the thread count stays accurate, but
+        // drop its stack, context and instruction window.
+        callback_output->ThreadWriteFlags &= ThreadWriteThread;
+        break;
+      }
+      if (policy->max_memory_bytes != 0) {
+        const MINIDUMP_THREAD_CALLBACK& thread = callback_input->Thread;
+        ULONG64 stack_size = thread.StackBase > thread.StackEnd ?
+            thread.StackBase - thread.StackEnd :
+            thread.StackEnd - thread.StackBase;
+        if (stack_size > policy_context->stack_bytes_remaining) {
+          // This stack does not fit in the remaining budget; write the
+          // thread without it.
+          callback_output->ThreadWriteFlags &=
+              ~(ThreadWriteStack | ThreadWriteInstructionWindow |
+                ThreadWriteBackingStore);
+        } else {
+          policy_context->stack_bytes_remaining -=
+              static_cast<SIZE_T>(stack_size);
+        }
+      }
+      break;
+    }
+
+    case ModuleCallback:
+      if (policy->module_list_only) {
+        // Keep the module entry and its CodeView record, which symbol
+        // matching needs, but drop the data segments.
+        callback_output->ModuleWriteFlags &= ~ModuleWriteDataSeg;
+      }
+      break;
+
+    case MemoryCallback:
+      // Returning FALSE tells dbghelp not to ask for additional
+      // application-defined memory ranges.
+      return FALSE;
+
+    default:
+      break;
+  }
+
+  return TRUE;
+}
+
 }  // namespace
 
 namespace google_breakpad {
@@ -291,11 +358,46 @@ bool MinidumpGenerator::WriteMinidump(HANDLE process_handle,
                                       bool is_client_pointers,
                                       wstring* dump_path,
                                       wstring* full_dump_path) {
+  // Call the full WriteMinidump with an unrestricted policy.
+  return this->WriteMinidump(process_handle, process_id, thread_id,
+                             requesting_thread_id, exception_pointers,
+                             assert_info, dump_type, is_client_pointers,
+                             dump_path, full_dump_path, NULL);
+}
+
+bool MinidumpGenerator::WriteMinidump(HANDLE process_handle,
+                                      DWORD process_id,
+                                      DWORD thread_id,
+                                      DWORD requesting_thread_id,
+                                      EXCEPTION_POINTERS* exception_pointers,
+                                      MDRawAssertionInfo* assert_info,
+                                      MINIDUMP_TYPE dump_type,
+                                      bool is_client_pointers,
+                                      wstring* dump_path,
+                                      wstring* full_dump_path,
+                                      const DumpPolicy* policy) {
   MiniDumpWriteDumpType write_dump = GetWriteDump();
   if (!write_dump) {
     return false;
   }
 
+  // Strip the dump type bits the policy disallows before deciding which
+  // files to create. The memory-heavy bits are stripped whenever the
+  // policy limits memory in any way, since they cannot honor a budget.
+  if (policy && policy->IsRestrictive()) {
+    int adjusted_type = dump_type;
+    if (!policy->include_handle_data) {
+      adjusted_type &= ~MiniDumpWithHandleData;
+    }
+    if (policy->max_memory_bytes != 0 || policy->module_list_only) {
+      adjusted_type &= ~(MiniDumpWithFullMemory |
+                         MiniDumpWithIndirectlyReferencedMemory |
+                         MiniDumpWithProcessThreadData |
+                         MiniDumpWithPrivateReadWriteMemory);
+    }
+    dump_type = static_cast<MINIDUMP_TYPE>(adjusted_type);
+  }
+
   wstring dump_file_path;
   if (!GenerateDumpFilePath(&dump_file_path)) {
     return false;
@@ -416,9 +518,12 @@ bool MinidumpGenerator::WriteMinidump(HANDLE process_handle,
 
   // If the process is terminated by STATUS_INVALID_HANDLE exception store
   // the trace of operatios for the offending handle value. Do nothing special
-  // if the client already requested the handle trace to be stored in the dump.
+  // if the client already requested the handle trace to be stored in the dump
+  // or the policy excludes handle data altogether.
+  bool want_handle_data = !policy || policy->include_handle_data;
   HandleTraceData handle_trace_data;
-  if (exception_pointers && (dump_type & MiniDumpWithHandleData) == 0) {
+  if (exception_pointers && want_handle_data &&
+      (dump_type & MiniDumpWithHandleData) == 0) {
     if (!handle_trace_data.CollectHandleData(process_handle,
                                              exception_pointers)) {
       CloseHandle(dump_file);
@@ -428,6 +533,19 @@ bool MinidumpGenerator::WriteMinidump(HANDLE process_handle,
     }
   }
 
+  // Enforce the policy restrictions that dump type bits cannot express
+  // through the MiniDumpWriteDump callback.
+  DumpPolicyCallbackContext callback_context;
+  MINIDUMP_CALLBACK_INFORMATION callback_info;
+  MINIDUMP_CALLBACK_INFORMATION* callback_param = NULL;
+  if (policy && policy->IsRestrictive()) {
+    callback_context.policy = policy;
+    callback_context.stack_bytes_remaining = policy->max_memory_bytes;
+    callback_info.CallbackRoutine = DumpPolicyCallback;
+    callback_info.CallbackParam = &callback_context;
+    callback_param = &callback_info;
+  }
+
   bool result_full_memory = true;
   if (full_memory_dump) {
     result_full_memory = write_dump(
@@ -435,10 +553,11 @@ bool MinidumpGenerator::WriteMinidump(HANDLE process_handle,
         process_id,
         full_dump_file,
         static_cast<MINIDUMP_TYPE>((dump_type & (~MiniDumpNormal))
-                                    | MiniDumpWithHandleData),
+                                    | (want_handle_data ?
+                                       MiniDumpWithHandleData : 0)),
         exception_pointers ? &dump_exception_info : NULL,
         &user_streams,
-        NULL) != FALSE;
+        callback_param) != FALSE;
   }
 
   // Add handle operations trace stream to the minidump if it was collected.
@@ -455,7 +574,7 @@ bool MinidumpGenerator::WriteMinidump(HANDLE process_handle,
                                   | MiniDumpNormal),
       exception_pointers ? &dump_exception_info : NULL,
       &user_streams,
-      NULL) != FALSE;
+      callback_param) != FALSE;
 
   bool result = result_minidump && result_full_memory;
 
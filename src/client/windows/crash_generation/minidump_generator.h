@@ -38,6 +38,57 @@
 
 namespace google_breakpad {
 
+// Policy restricting what gets written into a minidump, applied on top
+// of the MINIDUMP_TYPE the client requested at registration. A
+// default-constructed policy is unrestricted and leaves the dump
+// contents exactly as the dump type implies. Restrictive policies let
+// a server keep dumps small and fast for populations where volume
+// matters more than fidelity, without changing the clients.
+struct DumpPolicy {
+  DumpPolicy()
+      : max_memory_bytes(0),
+        include_handle_data(true),
+        module_list_only(false) {
+  }
+
+  // Returns true if the policy restricts the dump in any way.
+  bool IsRestrictive() const {
+    return max_memory_bytes != 0 || !include_handle_data || module_list_only;
+  }
+
+  // Compact preset for triaging high-crash-volume populations: thread
+  // list and contexts with stack memory capped at 256 KB across all
+  // threads, full module list, no handle data and no memory-heavy
+  // optional streams. The resulting dumps are small enough to collect
+  // and upload in bulk but still produce usable stack traces.
+  static DumpPolicy Triage() {
+    DumpPolicy policy;
+    policy.max_memory_bytes = 256 * 1024;
+    policy.include_handle_data = false;
+    return policy;
+  }
+
+  // Caps the total number of thread stack bytes written to the dump;
+  // 0 means unlimited. Threads are considered in the order dbghelp
+  // enumerates them and a thread whose stack does not fit in the
+  // remaining budget is written without its stack. A non-zero cap also
+  // strips the memory-heavy MINIDUMP_TYPE bits (full memory, process
+  // thread data, private read-write memory and indirectly referenced
+  // memory) since those cannot honor a byte budget.
+  size_t max_memory_bytes;
+
+  // Whether the dump may contain handle data. When false, the
+  // MiniDumpWithHandleData bit is stripped from the requested dump type
+  // and no handle operation trace is collected.
+  bool include_handle_data;
+
+  // When true, write only the module list plus a bare thread list:
+  // module data segments, thread stacks and thread contexts are all
+  // dropped. Such dumps identify the crashing binary and its versions
+  // but are not stack-walkable.
+  bool module_list_only;
+};
+
 // Abstraction for various objects and operations needed to generate
 // minidump on Windows. This abstraction is useful to hide all the gory
 // details for minidump generation and provide a clean interface to
@@ -76,6 +127,23 @@ class MinidumpGenerator {
                      std::wstring* dump_path,
                      std::wstring* full_dump_path);
 
+  // Writes the minidump with the given parameters, restricted by the
+  // given policy. policy can be NULL, which is equivalent to an
+  // unrestricted policy. Stores the dump file path in the dump_path
+  // (and full_dump_path) parameter if dump generation succeeds.
+  // full_dump_path and dump_path can be NULL.
+  bool WriteMinidump(HANDLE process_handle,
+                     DWORD process_id,
+                     DWORD thread_id,
+                     DWORD requesting_thread_id,
+                     EXCEPTION_POINTERS* exception_pointers,
+                     MDRawAssertionInfo* assert_info,
+                     MINIDUMP_TYPE dump_type,
+                     bool is_client_pointers,
+                     std::wstring* dump_path,
+                     std::wstring* full_dump_path,
+                     const DumpPolicy* policy);
+
  private:
   // Function pointer type for MiniDumpWriteDump, which is looked up
   // dynamically.
@@ -44,6 +44,16 @@ namespace google_breakpad {
 static const int kWaitForHandlerThreadMs = 60000;
 static const int kExceptionHandlerThreadInitialStackSize = 64 * 1024;
 
+// How much of the handler thread's stack PrewarmHandlerThreadStack
+// touches and locks. Must leave room in the stack above for the
+// dump-writing code itself.
+static const size_t kHandlerThreadStackPrewarmSize = 16 * 1024;
+
+// How many bytes of code to lock at each entry point on the crash
+// path. One page is enough to cover the entry and let the hardware
+// prefetcher do the rest.
+static const size_t kCodePrewarmLockSize = 4096;
+
 // As documented on MSDN, on failure SuspendThread returns (DWORD) -1
 static const DWORD kFailedToSuspendThread = static_cast<DWORD>(-1);
 
@@ -51,6 +61,12 @@ static const DWORD kFailedToSuspendThread = static_cast<DWORD>(-1);
 typedef struct {
   AppMemoryList::const_iterator iter;
   AppMemoryList::const_iterator end;
+  // When has_deadline is set, the GetTickCount() value past which the
+  // dump write should be cancelled; deadline_exceeded records that it
+  // was.
+  bool has_deadline;
+  DWORD deadline_tick;
+  bool deadline_exceeded;
 } MinidumpCallbackContext;
 
 vector<ExceptionHandler*>* ExceptionHandler::handler_stack_ = NULL;
@@ -131,6 +147,11 @@ void ExceptionHandler::Initialize(const wstring& dump_path,
   dbghelp_module_ = NULL;
   minidump_write_dump_ = NULL;
   dump_type_ = dump_type;
+  dump_deadline_ms_ = 0;
+  last_minidump_partial_ = false;
+  prewarm_crash_path_ = false;
+  prewarmed_dump_file_ = INVALID_HANDLE_VALUE;
+  prewarm_stack_request_ = false;
   rpcrt4_module_ = NULL;
   uuid_create_ = NULL;
   handler_types_ = handler_types;
@@ -166,62 +187,70 @@ void ExceptionHandler::Initialize(const wstring& dump_path,
                                   custom_info));
     }
 
-    // If successful in registering with the monitoring process,
-    // there is no need to setup in-process crash generation.
-    if (client->Register()) {
-      crash_generation_client_.reset(client.release());
+    // Registering is a pipe transaction with the server; when the
+    // server is busy or not yet up, it absorbs the full connect and
+    // wait timeout chain. Keep that off application startup: register
+    // on a background thread and rely on the in-process generation set
+    // up below as a fallback for crashes that strike before the
+    // registration completes, and for when it fails.
+    crash_generation_client_.reset(client.release());
+    if (!crash_generation_client_->RegisterAsync()) {
+      // The background thread could not be started; register
+      // synchronously as before, keeping the client only on success.
+      if (!crash_generation_client_->Register()) {
+        crash_generation_client_.reset();
+      }
     }
   }
 
-  if (!IsOutOfProcess()) {
-    // Either client did not ask for out-of-process crash generation
-    // or registration with the server process failed. In either case,
-    // setup to do in-process crash generation.
-
-    // Set synchronization primitives and the handler thread.  Each
-    // ExceptionHandler object gets its own handler thread because that's the
-    // only way to reliably guarantee sufficient stack space in an exception,
-    // and it allows an easy way to get a snapshot of the requesting thread's
-    // context outside of an exception.
-    InitializeCriticalSection(&handler_critical_section_);
-    handler_start_semaphore_ = CreateSemaphore(NULL, 0, 1, NULL);
-    assert(handler_start_semaphore_ != NULL);
-
-    handler_finish_semaphore_ = CreateSemaphore(NULL, 0, 1, NULL);
-    assert(handler_finish_semaphore_ != NULL);
-
-    // Don't attempt to create the thread if we could not create the semaphores.
-    if (handler_finish_semaphore_ != NULL && handler_start_semaphore_ != NULL) {
-      DWORD thread_id;
-      handler_thread_ = CreateThread(NULL,         // lpThreadAttributes
-                                     kExceptionHandlerThreadInitialStackSize,
-                                     ExceptionHandlerThreadMain,
-                                     this,         // lpParameter
-                                     0,            // dwCreationFlags
-                                     &thread_id);
-      assert(handler_thread_ != NULL);
-    }
+  // Set up in-process crash generation. This used to be skipped when
+  // out-of-process registration succeeded; it now always runs so it can
+  // back up an out-of-process client whose background registration has
+  // not completed, has failed, or whose server fails to produce a dump.
+
+  // Set synchronization primitives and the handler thread.  Each
+  // ExceptionHandler object gets its own handler thread because that's the
+  // only way to reliably guarantee sufficient stack space in an exception,
+  // and it allows an easy way to get a snapshot of the requesting thread's
+  // context outside of an exception.
+  InitializeCriticalSection(&handler_critical_section_);
+  handler_start_semaphore_ = CreateSemaphore(NULL, 0, 1, NULL);
+  assert(handler_start_semaphore_ != NULL);
 
-    dbghelp_module_ = LoadLibrary(L"dbghelp.dll");
-    if (dbghelp_module_) {
-      minidump_write_dump_ = reinterpret_cast<MiniDumpWriteDump_type>(
-          GetProcAddress(dbghelp_module_, "MiniDumpWriteDump"));
-    }
+  handler_finish_semaphore_ = CreateSemaphore(NULL, 0, 1, NULL);
+  assert(handler_finish_semaphore_ != NULL);
 
-    // Load this library dynamically to not affect existing projects.  Most
-    // projects don't link against this directly, it's usually dynamically
-    // loaded by dependent code.
-    rpcrt4_module_ = LoadLibrary(L"rpcrt4.dll");
-    if (rpcrt4_module_) {
-      uuid_create_ = reinterpret_cast<UuidCreate_type>(
-          GetProcAddress(rpcrt4_module_, "UuidCreate"));
-    }
+  // Don't attempt to create the thread if we could not create the semaphores.
+  if (handler_finish_semaphore_ != NULL && handler_start_semaphore_ != NULL) {
+    DWORD thread_id;
+    handler_thread_ = CreateThread(NULL,         // lpThreadAttributes
+                                   kExceptionHandlerThreadInitialStackSize,
+                                   ExceptionHandlerThreadMain,
+                                   this,         // lpParameter
+                                   0,            // dwCreationFlags
+                                   &thread_id);
+    assert(handler_thread_ != NULL);
+  }
+
+  dbghelp_module_ = LoadLibrary(L"dbghelp.dll");
+  if (dbghelp_module_) {
+    minidump_write_dump_ = reinterpret_cast<MiniDumpWriteDump_type>(
+        GetProcAddress(dbghelp_module_, "MiniDumpWriteDump"));
+  }
 
-    // set_dump_path calls UpdateNextID.  This sets up all of the path and id
-    // strings, and their equivalent c_str pointers.
-    set_dump_path(dump_path);
+  // Load this library dynamically to not affect existing projects.  Most
+  // projects don't link against this directly, it's usually dynamically
+  // loaded by dependent code.
+  rpcrt4_module_ = LoadLibrary(L"rpcrt4.dll");
+  if (rpcrt4_module_) {
+    uuid_create_ = reinterpret_cast<UuidCreate_type>(
+        GetProcAddress(rpcrt4_module_, "UuidCreate"));
   }
 
+  // set_dump_path calls UpdateNextID.  This sets up all of the path and id
+  // strings, and their equivalent c_str pointers.
+  set_dump_path(dump_path);
+
   // Reserve one element for the instruction memory
   AppMemory instruction_memory;
   instruction_memory.ptr = NULL;
@@ -317,9 +346,9 @@ ExceptionHandler::~ExceptionHandler() {
     LeaveCriticalSection(&handler_stack_critical_section_);
   }
 
-  // Some of the objects were only initialized if out of process
-  // registration was not done.
-  if (!IsOutOfProcess()) {
+  // The in-process generation objects are always initialized now, even
+  // when an out-of-process client is present, since they back it up.
+  if (handler_thread_ != NULL) {
 #ifdef BREAKPAD_NO_TERMINATE_THREAD
     // Clean up the handler thread and synchronization primitives. The handler
     // thread is either waiting on the semaphore to handle a crash or it is
@@ -336,11 +365,22 @@ ExceptionHandler::~ExceptionHandler() {
 
     CloseHandle(handler_thread_);
     handler_thread_ = NULL;
-    DeleteCriticalSection(&handler_critical_section_);
+  }
+  DeleteCriticalSection(&handler_critical_section_);
+  if (handler_start_semaphore_ != NULL) {
     CloseHandle(handler_start_semaphore_);
+  }
+  if (handler_finish_semaphore_ != NULL) {
     CloseHandle(handler_finish_semaphore_);
   }
 
+  // If a dump file was pre-opened and never written, remove it so
+  // prewarming does not litter the dump directory with empty files.
+  if (prewarmed_dump_file_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(prewarmed_dump_file_);
+    DeleteFile(prewarmed_dump_path_.c_str());
+  }
+
   // There is a race condition in the code below: if this instance is
   // deleting the static critical section and a new instance of the class
   // is created, then there is a possibility that the critical section be
@@ -370,6 +410,12 @@ DWORD ExceptionHandler::ExceptionHandlerThreadMain(void* lpParameter) {
       if (self->is_shutdown_) {
         // The instance of the exception handler is being destroyed.
         break;
+      } else if (self->prewarm_stack_request_) {
+        // PrewarmCrashPath asked this thread to warm and lock its own
+        // stack; it has to run here because stack pages belong to the
+        // thread that owns them.
+        self->handler_return_value_ = PrewarmHandlerThreadStack();
+        self->prewarm_stack_request_ = false;
       } else {
         self->handler_return_value_ =
             self->WriteMinidumpWithException(self->requesting_thread_id_,
@@ -462,10 +508,6 @@ LONG ExceptionHandler::HandleException(EXCEPTION_POINTERS* exinfo) {
 
   if (!is_debug_exception ||
       current_handler->get_handle_debug_exceptions()) {
-    // If out-of-proc crash handler client is available, we have to use that
-    // to generate dump and we cannot fall back on in-proc dump generation
-    // because we never prepared for an in-proc dump generation
-
     // In case of out-of-process dump generation, directly call
     // WriteMinidumpWithException since there is no separate thread running.
     if (current_handler->IsOutOfProcess()) {
@@ -814,6 +856,19 @@ bool ExceptionHandler::WriteMinidumpWithException(
   bool success = false;
   if (IsOutOfProcess()) {
     success = crash_generation_client_->RequestDump(exinfo, assertion);
+    if (!success) {
+      // The client's background registration may still be pending or
+      // may have failed, or the server did not produce a dump. Fall
+      // back to the in-process generation that Initialize keeps set up
+      // alongside the out-of-process client. This runs on the calling
+      // thread, which in the out-of-process case is the thread that
+      // hit the exception.
+      success = WriteMinidumpWithExceptionForProcess(requesting_thread_id,
+                                                     exinfo,
+                                                     assertion,
+                                                     GetCurrentProcess(),
+                                                     true);
+    }
   } else {
     success = WriteMinidumpWithExceptionForProcess(requesting_thread_id,
                                                    exinfo,
@@ -863,12 +918,30 @@ BOOL CALLBACK ExceptionHandler::MinidumpWriteDumpCallback(
   case ThreadCallback:
     return TRUE;
 
-    // Stop receiving cancel callbacks.
-  case CancelCallback:
-    callback_output->CheckCancel = FALSE;
-    callback_output->Cancel = FALSE;
+    // Without a deadline, stop receiving cancel callbacks.  With one,
+    // keep them coming and cancel the write once the deadline passes;
+    // MiniDumpWriteDump then returns failure, leaving whatever it
+    // already wrote in the file.
+  case CancelCallback: {
+    MinidumpCallbackContext* callback_context =
+        reinterpret_cast<MinidumpCallbackContext*>(context);
+    if (!callback_context->has_deadline) {
+      callback_output->CheckCancel = FALSE;
+      callback_output->Cancel = FALSE;
+      return TRUE;
+    }
+    // Tick counts wrap after 49.7 days; compare via signed difference.
+    if (static_cast<LONG>(GetTickCount() -
+                          callback_context->deadline_tick) >= 0) {
+      callback_context->deadline_exceeded = true;
+      callback_output->Cancel = TRUE;
+    } else {
+      callback_output->Cancel = FALSE;
+    }
+    callback_output->CheckCancel = TRUE;
     return TRUE;
   }
+  }
   // Ignore other callback types.
   return FALSE;
 }
@@ -881,13 +954,18 @@ bool ExceptionHandler::WriteMinidumpWithExceptionForProcess(
     bool write_requester_stream) {
   bool success = false;
   if (minidump_write_dump_) {
-    HANDLE dump_file = CreateFile(next_minidump_path_c_,
-                                  GENERIC_WRITE,
-                                  0,  // no sharing
-                                  NULL,
-                                  CREATE_NEW,  // fail if exists
-                                  FILE_ATTRIBUTE_NORMAL,
-                                  NULL);
+    // Use the dump file pre-opened by PrewarmCrashPath when there is
+    // one; otherwise create the file now.
+    bool used_prewarmed_file = prewarmed_dump_file_ != INVALID_HANDLE_VALUE;
+    HANDLE dump_file = used_prewarmed_file ?
+        prewarmed_dump_file_ :
+        CreateFile(next_minidump_path_c_,
+                   GENERIC_WRITE,
+                   0,  // no sharing
+                   NULL,
+                   CREATE_NEW,  // fail if exists
+                   FILE_ATTRIBUTE_NORMAL,
+                   NULL);
     if (dump_file != INVALID_HANDLE_VALUE) {
       MINIDUMP_EXCEPTION_INFORMATION except_info;
       except_info.ThreadId = requesting_thread_id;
@@ -973,6 +1051,9 @@ bool ExceptionHandler::WriteMinidumpWithExceptionForProcess(
       MinidumpCallbackContext context;
       context.iter = app_memory_info_.begin();
       context.end = app_memory_info_.end();
+      context.has_deadline = dump_deadline_ms_ != 0;
+      context.deadline_tick = GetTickCount() + dump_deadline_ms_;
+      context.deadline_exceeded = false;
 
       // Skip the reserved element if there was no instruction memory
       if (context.iter->ptr == 0) {
@@ -992,7 +1073,22 @@ bool ExceptionHandler::WriteMinidumpWithExceptionForProcess(
                                       &user_streams,
                                       &callback) == TRUE);
 
+      // A write cancelled by the deadline still leaves everything
+      // dbghelp wrote before the cancel in the file.  Keep that as a
+      // flagged partial dump and report success so crash handling
+      // finishes within its budget: bounded latency is worth more here
+      // than occasional completeness.
+      last_minidump_partial_ = false;
+      if (!success && context.deadline_exceeded) {
+        FlushFileBuffers(dump_file);
+        last_minidump_partial_ = true;
+        success = true;
+      }
+
       CloseHandle(dump_file);
+      if (used_prewarmed_file) {
+        prewarmed_dump_file_ = INVALID_HANDLE_VALUE;
+      }
     }
   }
 
@@ -1017,6 +1113,12 @@ void ExceptionHandler::UpdateNextID() {
 
   next_minidump_path_ = minidump_path;
   next_minidump_path_c_ = next_minidump_path_.c_str();
+
+  // Keep a dump file pre-opened for the new path when the crash path
+  // has been prewarmed, so explicit WriteMinidump calls stay warm too.
+  if (prewarm_crash_path_) {
+    PrewarmDumpFile();
+  }
 }
 
 void ExceptionHandler::RegisterAppMemory(void* ptr, size_t length) {
@@ -1041,4 +1143,93 @@ void ExceptionHandler::UnregisterAppMemory(void* ptr) {
   }
 }
 
+// Locks one page of code at the given entry point so it cannot be
+// paged out before a crash. VirtualLock extends the range to page
+// boundaries itself.
+static bool LockCodeEntry(const void* entry_point) {
+  return VirtualLock(const_cast<void*>(entry_point),
+                     kCodePrewarmLockSize) != FALSE;
+}
+
+bool ExceptionHandler::PrewarmCrashPath() {
+  // Out-of-process dumps are written by the server process; there is
+  // nothing to warm here.
+  if (IsOutOfProcess()) {
+    return true;
+  }
+
+  prewarm_crash_path_ = true;
+
+  // dbghelp is loaded at install time already; failing to resolve
+  // MiniDumpWriteDump means the crash path cannot work at all.
+  bool success = minidump_write_dump_ != NULL;
+
+  // Lock the entry pages of the code the crash path runs, so the first
+  // crash does not have to page them back in.
+  if (minidump_write_dump_) {
+    success = LockCodeEntry(
+        reinterpret_cast<const void*>(minidump_write_dump_)) && success;
+  }
+  success = LockCodeEntry(
+      reinterpret_cast<const void*>(&ExceptionHandler::HandleException)) &&
+      success;
+  success = LockCodeEntry(
+      reinterpret_cast<const void*>(&MinidumpWriteDumpCallback)) && success;
+
+  // Pre-open the dump file so no file creation happens at crash time.
+  success = PrewarmDumpFile() && success;
+
+  // Ask the handler thread to touch and lock its own stack pages,
+  // using the same handshake WriteMinidumpOnHandlerThread uses.
+  EnterCriticalSection(&handler_critical_section_);
+  if (handler_thread_ != NULL) {
+    prewarm_stack_request_ = true;
+    ReleaseSemaphore(handler_start_semaphore_, 1, NULL);
+    WaitForSingleObject(handler_finish_semaphore_, INFINITE);
+    success = handler_return_value_ && success;
+  } else {
+    success = false;
+  }
+  LeaveCriticalSection(&handler_critical_section_);
+
+  return success;
+}
+
+bool ExceptionHandler::PrewarmDumpFile() {
+  if (prewarmed_dump_file_ != INVALID_HANDLE_VALUE) {
+    // A file pre-opened for a previous id was never written; remove it.
+    CloseHandle(prewarmed_dump_file_);
+    DeleteFile(prewarmed_dump_path_.c_str());
+    prewarmed_dump_file_ = INVALID_HANDLE_VALUE;
+  }
+
+  prewarmed_dump_file_ = CreateFile(next_minidump_path_c_,
+                                    GENERIC_WRITE,
+                                    0,  // no sharing
+                                    NULL,
+                                    CREATE_NEW,  // fail if exists
+                                    FILE_ATTRIBUTE_NORMAL,
+                                    NULL);
+  if (prewarmed_dump_file_ == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  prewarmed_dump_path_ = next_minidump_path_;
+  return true;
+}
+
+// static
+bool ExceptionHandler::PrewarmHandlerThreadStack() {
+  // Runs on the handler thread. Touch a chunk of this thread's stack
+  // page by page so the pages are committed, then lock them so they
+  // stay resident for the dump-writing code.
+  volatile char stack_probe[kHandlerThreadStackPrewarmSize];
+  for (size_t offset = 0; offset < sizeof(stack_probe); offset += 4096) {
+    stack_probe[offset] = 0;
+  }
+  stack_probe[sizeof(stack_probe) - 1] = 0;
+  return VirtualLock(const_cast<char*>(stack_probe),
+                     sizeof(stack_probe)) != FALSE;
+}
+
 }  // namespace google_breakpad
@@ -244,6 +244,24 @@ class ExceptionHandler {
     handle_debug_exceptions_ = handle_debug_exceptions;
   }
 
+  // Bounds the time an in-process MiniDumpWriteDump call may spend
+  // writing a dump; 0, the default, means no bound.  MiniDumpWriteDump
+  // can block indefinitely when the disk stalls or the process state
+  // is pathological, which also blocks whatever supervises this
+  // process.  When the deadline passes, the write is cancelled through
+  // dbghelp's cancel callback, whatever reached the dump file is kept,
+  // and the dump is reported as successful so crash handling completes;
+  // last_minidump_was_partial() distinguishes such truncated dumps.
+  // Has no effect on out-of-process dump generation.
+  DWORD dump_deadline_ms() const { return dump_deadline_ms_; }
+  void set_dump_deadline_ms(DWORD deadline_ms) {
+    dump_deadline_ms_ = deadline_ms;
+  }
+
+  // Returns true if the last in-process dump was cut short by the dump
+  // deadline and so contains only the streams written before it passed.
+  bool last_minidump_was_partial() const { return last_minidump_partial_; }
+
   // Returns whether out-of-process dump generation is used or not.
   bool IsOutOfProcess() const { return crash_generation_client_.get() != NULL; }
 
@@ -252,6 +270,22 @@ class ExceptionHandler {
   void RegisterAppMemory(void* ptr, size_t length);
   void UnregisterAppMemory(void* ptr);
 
+  // Hardens and speeds up the in-process crash path by paying its
+  // one-time costs now, while the process is healthy, instead of at
+  // crash time, possibly under memory pressure that makes paging fail:
+  //  - pre-opens the next dump file, so no file needs to be created
+  //    while the process is dying;
+  //  - locks the entry pages of MiniDumpWriteDump and of the handler's
+  //    own dump-writing code with VirtualLock, so they cannot be paged
+  //    out before a crash;
+  //  - asks the handler thread to touch and lock its stack pages.
+  // Call once after constructing the handler.  Returns true if every
+  // step succeeded; on partial failure the crash path still works, it
+  // just falls back to doing the failed step at crash time.  For
+  // out-of-process handlers this is a no-op returning true, since the
+  // server process writes the dump.
+  bool PrewarmCrashPath();
+
  private:
   friend class AutoExceptionHandler;
 
@@ -351,6 +385,17 @@ class ExceptionHandler {
   // path of the next minidump to be written in next_minidump_path_.
   void UpdateNextID();
 
+  // Opens the dump file for next_minidump_path_ ahead of time and keeps
+  // the handle in prewarmed_dump_file_, closing and deleting any unused
+  // previously pre-opened file.  Returns true on success.
+  bool PrewarmDumpFile();
+
+  // Runs on the handler thread: touches the stack pages the
+  // dump-writing code will need so they are committed, and locks them
+  // with VirtualLock so they cannot be paged out before a crash.
+  // Returns true if the lock succeeded.
+  static bool PrewarmHandlerThreadStack();
+
   FilterCallback filter_;
   MinidumpCallback callback_;
   void* callback_context_;
@@ -382,6 +427,27 @@ class ExceptionHandler {
   MiniDumpWriteDump_type minidump_write_dump_;
   MINIDUMP_TYPE dump_type_;
 
+  // Time budget for an in-process MiniDumpWriteDump call, in
+  // milliseconds, or zero for no budget.
+  DWORD dump_deadline_ms_;
+
+  // Whether the last in-process dump was cut short by the deadline.
+  bool last_minidump_partial_;
+
+  // Whether PrewarmCrashPath was called.  When set, UpdateNextID keeps
+  // a dump file pre-opened for the next minidump path.
+  bool prewarm_crash_path_;
+
+  // Pre-opened handle for the next dump file, or INVALID_HANDLE_VALUE
+  // if no file is pre-opened.  The corresponding path is kept in
+  // prewarmed_dump_path_ so an unused file can be deleted.
+  HANDLE prewarmed_dump_file_;
+  wstring prewarmed_dump_path_;
+
+  // When true, the handler thread has been woken to warm and lock its
+  // stack rather than to write a dump.
+  volatile bool prewarm_stack_request_;
+
   HMODULE rpcrt4_module_;
   UuidCreate_type uuid_create_;
 
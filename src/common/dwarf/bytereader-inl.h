@@ -91,14 +91,29 @@ inline uint64 ByteReader::ReadEightBytes(const char* signed_buffer) const {
 
 inline uint64 ByteReader::ReadUnsignedLEB128(const char* buffer,
                                              size_t* len) const {
-  uint64 result = 0;
-  size_t num_read = 0;
-  unsigned int shift = 0;
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(buffer);
+
+  // Nearly every LEB128 number in DWARF - abbreviation codes,
+  // attribute and form codes, small constants - fits in one or two
+  // bytes. Decode those without entering the loop. Note that p[1] is
+  // only touched when p[0]'s continuation bit says it is part of the
+  // number, so this never reads past the encoded value.
+  if (!(p[0] & 0x80)) {
+    *len = 1;
+    return p[0];
+  }
+  if (!(p[1] & 0x80)) {
+    *len = 2;
+    return (p[0] & 0x7f) | static_cast<uint64>(p[1]) << 7;
+  }
+
+  uint64 result = (p[0] & 0x7f) | static_cast<uint64>(p[1] & 0x7f) << 7;
+  size_t num_read = 2;
+  unsigned int shift = 14;
   unsigned char byte;
 
   do {
-    byte = *buffer++;
-    num_read++;
+    byte = p[num_read++];
 
     result |= (static_cast<uint64>(byte & 0x7f)) << shift;
 
@@ -111,19 +126,46 @@ inline uint64 ByteReader::ReadUnsignedLEB128(const char* buffer,
   return result;
 }
 
+inline size_t ByteReader::ReadUnsignedLEB128s(const char* buffer,
+                                              uint64* values,
+                                              size_t count) const {
+  const char* p = buffer;
+
+  for (size_t i = 0; i < count; i++) {
+    size_t len;
+    values[i] = ReadUnsignedLEB128(p, &len);
+    p += len;
+  }
+
+  return p - buffer;
+}
+
 // Read a signed LEB128 number.  These are like regular LEB128
 // numbers, except the last byte may have a sign bit set.
 
 inline int64 ByteReader::ReadSignedLEB128(const char* buffer,
                                           size_t* len) const {
-  int64 result = 0;
-  unsigned int shift = 0;
-  size_t num_read = 0;
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(buffer);
+
+  // One- and two-byte fast paths, as in ReadUnsignedLEB128 above, with
+  // the sign bit folded in by shifting through the full width.
+  if (!(p[0] & 0x80)) {
+    *len = 1;
+    return static_cast<int64>(static_cast<int8_t>(p[0] << 1)) >> 1;
+  }
+  if (!(p[1] & 0x80)) {
+    *len = 2;
+    const uint64 value = (p[0] & 0x7f) | static_cast<uint64>(p[1]) << 7;
+    return static_cast<int64>(value << 50) >> 50;
+  }
+
+  int64 result = (p[0] & 0x7f) | static_cast<uint64>(p[1] & 0x7f) << 7;
+  size_t num_read = 2;
+  unsigned int shift = 14;
   unsigned char byte;
 
   do {
-      byte = *buffer++;
-      num_read++;
+      byte = p[num_read++];
       result |= (static_cast<uint64>(byte & 0x7f) << shift);
       shift += 7;
   } while (byte & 0x80);
@@ -134,14 +176,23 @@ inline int64 ByteReader::ReadSignedLEB128(const char* buffer,
   return result;
 }
 
+// ReadOffset and ReadAddress are on the hot path of DIE reading, one
+// call per address- or offset-sized attribute, so the width chosen by
+// SetOffsetSize or SetAddressSize is tested inline here rather than
+// dispatched through a stored member function pointer.
+
 inline uint64 ByteReader::ReadOffset(const char* buffer) const {
-  assert(this->offset_reader_);
-  return (this->*offset_reader_)(buffer);
+  assert(offset_size_ == 4 || offset_size_ == 8);
+  if (offset_size_ == 4)
+    return ReadFourBytes(buffer);
+  return ReadEightBytes(buffer);
 }
 
 inline uint64 ByteReader::ReadAddress(const char* buffer) const {
-  assert(this->address_reader_);
-  return (this->*address_reader_)(buffer);
+  assert(address_size_ == 4 || address_size_ == 8);
+  if (address_size_ == 4)
+    return ReadFourBytes(buffer);
+  return ReadEightBytes(buffer);
 }
 
 inline void ByteReader::SetCFIDataBase(uint64 section_base,
@@ -35,31 +35,20 @@
 namespace dwarf2reader {
 
 ByteReader::ByteReader(enum Endianness endian)
-    :offset_reader_(NULL), address_reader_(NULL), endian_(endian),
-     address_size_(0), offset_size_(0),
+    :endian_(endian), address_size_(0), offset_size_(0),
      have_section_base_(), have_text_base_(), have_data_base_(),
      have_function_base_() { }
 
 ByteReader::~ByteReader() { }
 
 void ByteReader::SetOffsetSize(uint8 size) {
-  offset_size_ = size;
   assert(size == 4 || size == 8);
-  if (size == 4) {
-    this->offset_reader_ = &ByteReader::ReadFourBytes;
-  } else {
-    this->offset_reader_ = &ByteReader::ReadEightBytes;
-  }
+  offset_size_ = size;
 }
 
 void ByteReader::SetAddressSize(uint8 size) {
-  address_size_ = size;
   assert(size == 4 || size == 8);
-  if (size == 4) {
-    this->address_reader_ = &ByteReader::ReadFourBytes;
-  } else {
-    this->address_reader_ = &ByteReader::ReadEightBytes;
-  }
+  address_size_ = size;
 }
 
 uint64 ByteReader::ReadInitialLength(const char* start, size_t* len) {
@@ -95,6 +95,14 @@ class ByteReader {
   // bytes with the high bit on all but the last.
   uint64 ReadUnsignedLEB128(const char* buffer, size_t* len) const;
 
+  // Read COUNT consecutive unsigned LEB128 numbers from BUFFER into
+  // VALUES, and return the total number of bytes read. Equivalent to
+  // COUNT calls to ReadUnsignedLEB128, but keeps the decode loop hot
+  // for runs of values, such as the attribute/form pairs of an
+  // abbreviation declaration.
+  size_t ReadUnsignedLEB128s(const char* buffer, uint64* values,
+                             size_t count) const;
+
   // Read a signed LEB128 number from BUFFER and return it as an
   // signed 64 bit integer. Set LEN to the number of bytes read.
   //
@@ -278,23 +286,13 @@ class ByteReader {
 
  private:
 
-  // Function pointer type for our address and offset readers.
-  typedef uint64 (ByteReader::*AddressReader)(const char*) const;
-
-  // Read an offset from BUFFER and return it as an unsigned 64 bit
-  // integer.  DWARF2/3 define offsets as either 4 or 8 bytes,
-  // generally depending on the amount of DWARF2/3 info present.
-  // This function pointer gets set by SetOffsetSize.
-  AddressReader offset_reader_;
-
-  // Read an address from BUFFER and return it as an unsigned 64 bit
-  // integer.  DWARF2/3 allow addresses to be any size from 0-255
-  // bytes currently.  Internally we support 4 and 8 byte addresses,
-  // and will CHECK on anything else.
-  // This function pointer gets set by SetAddressSize.
-  AddressReader address_reader_;
-
   Endianness endian_;
+
+  // Widths established by SetAddressSize and SetOffsetSize, or zero
+  // if not yet set.  ReadAddress and ReadOffset select the four- or
+  // eight-byte read inline on these, so each read compiles down to
+  // plain loads behind one predictable compare rather than an
+  // indirect call through a member function pointer.
   uint8 address_size_;
   uint8 offset_size_;
 
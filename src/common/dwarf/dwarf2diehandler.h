@@ -294,6 +294,11 @@ class DIEDispatcher: public Dwarf2Handler {
                             uint8 offset_size, uint64 cu_length,
                             uint8 dwarf_version);
   bool StartDIE(uint64 offset, enum DwarfTag tag);
+  // When our StartDIE returns false, we have already decided to
+  // ignore the DIE's whole subtree: every descendant would be
+  // rejected, too. Let the reader step over the subtree without
+  // reporting it to us at all.
+  bool SkipsRejectedSubtrees() const { return true; }
   void ProcessAttributeUnsigned(uint64 offset,
                                 enum DwarfAttribute attr,
                                 enum DwarfForm form,
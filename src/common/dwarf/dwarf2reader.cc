@@ -55,8 +55,30 @@ CompilationUnit::CompilationUnit(const SectionMap& sections, uint64 offset,
                                  ByteReader* reader, Dwarf2Handler* handler)
     : offset_from_section_start_(offset), reader_(reader),
       sections_(sections), handler_(handler), abbrevs_(NULL),
+      abbrev_cache_(NULL), owns_abbrevs_(true),
       string_buffer_(NULL), string_buffer_length_(0) {}
 
+CompilationUnit::AbbrevCache::~AbbrevCache() {
+  for (std::map<uint64, std::vector<Abbrev>*>::iterator iter =
+           tables_.begin();
+       iter != tables_.end();
+       ++iter) {
+    delete iter->second;
+  }
+}
+
+std::vector<CompilationUnit::Abbrev>*
+CompilationUnit::AbbrevCache::Find(uint64 offset) {
+  std::map<uint64, std::vector<Abbrev>*>::const_iterator iter =
+      tables_.find(offset);
+  return iter == tables_.end() ? NULL : iter->second;
+}
+
+void CompilationUnit::AbbrevCache::Insert(uint64 offset,
+                                          std::vector<Abbrev>* abbrevs) {
+  tables_[offset] = abbrevs;
+}
+
 // Read a DWARF2/3 abbreviation section.
 // Each abbrev consists of a abbreviation number, a tag, a byte
 // specifying whether the tag has children, and a list of
@@ -69,6 +91,18 @@ void CompilationUnit::ReadAbbrevs() {
   if (abbrevs_)
     return;
 
+  // Compilation units routinely share abbreviation tables, so reuse a
+  // table another unit already parsed from this offset if a cache has
+  // been supplied.
+  if (abbrev_cache_) {
+    std::vector<Abbrev>* cached = abbrev_cache_->Find(header_.abbrev_offset);
+    if (cached) {
+      abbrevs_ = cached;
+      owns_abbrevs_ = false;
+      return;
+    }
+  }
+
   // First get the debug_abbrev section.  ".debug_abbrev" is the name
   // recommended in the DWARF spec, and used on Linux;
   // "__debug_abbrev" is the name used in Mac OS X Mach-O files.
@@ -112,12 +146,14 @@ void CompilationUnit::ReadAbbrevs() {
     assert(abbrevptr < abbrev_start + abbrev_length);
 
     while (1) {
-      const uint64 nametemp = reader_->ReadUnsignedLEB128(abbrevptr, &len);
-      abbrevptr += len;
-
-      assert(abbrevptr < abbrev_start + abbrev_length);
-      const uint64 formtemp = reader_->ReadUnsignedLEB128(abbrevptr, &len);
-      abbrevptr += len;
+      // Attribute specifications come in name/form pairs; decode each
+      // pair in one batched call.
+      uint64 pair[2];
+      abbrevptr += reader_->ReadUnsignedLEB128s(abbrevptr, pair, 2);
+      const uint64 nametemp = pair[0];
+      const uint64 formtemp = pair[1];
+
+      assert(abbrevptr <= abbrev_start + abbrev_length);
       if (nametemp == 0 && formtemp == 0)
         break;
 
@@ -129,6 +165,11 @@ void CompilationUnit::ReadAbbrevs() {
     assert(abbrev.number == abbrevs_->size());
     abbrevs_->push_back(abbrev);
   }
+
+  if (abbrev_cache_) {
+    abbrev_cache_->Insert(header_.abbrev_offset, abbrevs_);
+    owns_abbrevs_ = false;
+  }
 }
 
 // Skips a single DIE's attributes.
@@ -142,6 +183,33 @@ const char* CompilationUnit::SkipDIE(const char* start,
   return start;
 }
 
+// Skips an entire tree of DIEs whose root's attributes have already
+// been skipped. We consult the abbreviation table only for the form
+// widths of each skipped DIE's attributes; no attribute values are
+// materialized, and no handler callbacks are made. This makes it cheap
+// for a handler to reject a DIE that roots a large subtree.
+const char* CompilationUnit::SkipDIEChildren(const char* start,
+                                             const char* end) {
+  size_t len;
+  int depth = 1;
+  while (depth > 0 && start < end) {
+    const uint64 abbrev_num = reader_->ReadUnsignedLEB128(start, &len);
+    start += len;
+
+    // Abbrev == 0 ends a list of sibling DIEs.
+    if (abbrev_num == 0) {
+      depth--;
+      continue;
+    }
+
+    const Abbrev& abbrev = abbrevs_->at(static_cast<size_t>(abbrev_num));
+    start = SkipDIE(start, abbrev);
+    if (abbrev.has_children)
+      depth++;
+  }
+  return start;
+}
+
 // Skips a single attribute form's data.
 const char* CompilationUnit::SkipAttribute(const char* start,
                                                     enum DwarfForm form) {
@@ -502,6 +570,15 @@ void CompilationUnit::ProcessDIEs() {
     const enum DwarfTag tag = abbrev.tag;
     if (!handler_->StartDIE(absolute_offset, tag)) {
       dieptr = SkipDIE(dieptr, abbrev);
+      // If the handler tells us a rejected DIE stands for its whole
+      // subtree, step over the children right here, consulting only
+      // the abbreviation table for their sizes. Otherwise fall
+      // through and offer each child to the handler individually.
+      if (abbrev.has_children && handler_->SkipsRejectedSubtrees()) {
+        dieptr = SkipDIEChildren(dieptr, lengthstart + header_.length);
+        handler_->EndDIE(absolute_offset);
+        continue;
+      }
     } else {
       dieptr = ProcessDIE(absolute_offset, dieptr, abbrev);
     }
@@ -2080,130 +2157,412 @@ bool CallFrameInfo::ReadFDEFields(FDE *fde) {
   return true;
 }
   
+bool CallFrameInfo::ProcessEntry(const char *cursor, const char **entry_end,
+                                 EntryKind *kind) {
+  FDE fde;
+
+  // Assume that things are not okay until we've checked all the data,
+  // and that we cannot describe the entry until we've parsed its
+  // prologue.
+  *entry_end = NULL;
+  *kind = kUnknown;
+
+  // Read the entry's prologue.
+  if (!ReadEntryPrologue(cursor, &fde)) {
+    *entry_end = fde.end;
+    return false;
+  }
+
+  *entry_end = fde.end;
+  *kind = fde.kind;
+
+  // Did we see an .eh_frame terminating mark?
+  if (fde.kind == kTerminator) {
+    // If there appears to be more data left in the section after the
+    // terminating mark, warn the user. But this is just a warning;
+    // the entry itself is fine.
+    if (fde.end < buffer_ + buffer_length_)
+      reporter_->EarlyEHTerminator(fde.offset);
+    return true;
+  }
+
+  // We skip CIEs here. We only parse them fully when we parse an FDE
+  // that refers to them. This limits our memory consumption (beyond
+  // the buffer itself) to that needed to process the largest single
+  // entry.
+  if (fde.kind != kFDE)
+    return true;
+
+  // Validate the CIE pointer.
+  if (fde.id > buffer_length_) {
+    reporter_->CIEPointerOutOfRange(fde.offset, fde.id);
+    return false;
+  }
+
+  // Look the CIE up in the cache, and parse it on a miss. Only CIEs
+  // that parsed successfully are cached, so a malformed CIE is still
+  // reported for each FDE that cites it.
+  std::map<size_t, CIE>::iterator cached = cie_cache_.find(fde.id);
+  if (cached == cie_cache_.end()) {
+    CIE cie;
+
+    // Parse this FDE's CIE header.
+    if (!ReadEntryPrologue(buffer_ + fde.id, &cie))
+      return false;
+    // This had better be an actual CIE.
+    if (cie.kind != kCIE) {
+      reporter_->BadCIEId(fde.offset, fde.id);
+      return false;
+    }
+    if (!ReadCIEFields(&cie))
+      return false;
+
+    cached = cie_cache_.insert(std::make_pair(size_t(fde.id), cie)).first;
+    // The cached copy is the one FDEs point at, so its self-pointer
+    // must name the copy, not the local parsed above.
+    cached->second.cie = &cached->second;
+  }
+  CIE &cie = cached->second;
+
+  // We now have the values that govern both the CIE and the FDE.
+  fde.cie = &cie;
+
+  // Parse the FDE's header.
+  if (!ReadFDEFields(&fde))
+    return false;
+
+  // Call Entry to ask the consumer if they're interested.
+  if (!handler_->Entry(fde.offset, fde.address, fde.size,
+                       cie.version, cie.augmentation,
+                       cie.return_address_register)) {
+    // The handler isn't interested in this entry. That's not an error.
+    return true;
+  }
+
+  if (cie.has_z_augmentation) {
+    // Report the personality routine address, if we have one.
+    if (cie.has_z_personality) {
+      if (!handler_
+          ->PersonalityRoutine(cie.personality_address,
+                               IsIndirectEncoding(cie.personality_encoding)))
+        return false;
+    }
+
+    // Report the language-specific data area address, if we have one.
+    if (cie.has_z_lsda) {
+      if (!handler_
+          ->LanguageSpecificDataArea(fde.lsda_address,
+                                     IsIndirectEncoding(cie.lsda_encoding)))
+        return false;
+    }
+
+    // If this is a signal-handling frame, report that.
+    if (cie.has_z_signal_frame) {
+      if (!handler_->SignalHandler())
+        return false;
+    }
+  }
+
+  // Interpret the CIE's instructions, and then the FDE's instructions.
+  State state(reader_, handler_, reporter_, fde.address);
+  bool ok = state.InterpretCIE(cie) && state.InterpretFDE(fde);
+
+  // Tell the ByteReader that the function start address from the
+  // FDE header is no longer valid.
+  reader_->ClearFunctionBase();
+
+  // Report the end of the entry.
+  handler_->End();
+
+  return ok;
+}
+
 bool CallFrameInfo::Start() {
   const char *buffer_end = buffer_ + buffer_length_;
   const char *cursor;
   bool all_ok = true;
   const char *entry_end;
+  EntryKind kind;
   bool ok;
 
   // Traverse all the entries in buffer_, skipping CIEs and offering
   // FDEs to the handler.
   for (cursor = buffer_; cursor < buffer_end;
        cursor = entry_end, all_ok = all_ok && ok) {
-    FDE fde;
-
-    // Make it easy to skip this entry with 'continue': assume that
-    // things are not okay until we've checked all the data, and
-    // prepare the address of the next entry.
-    ok = false;
-
-    // Read the entry's prologue.
-    if (!ReadEntryPrologue(cursor, &fde)) {
-      if (!fde.end) {
-        // If we couldn't even figure out this entry's extent, then we
-        // must stop processing entries altogether.
-        all_ok = false;
-        break;
-      }
-      entry_end = fde.end;
-      continue;
+    ok = ProcessEntry(cursor, &entry_end, &kind);
+
+    // If we couldn't even figure out this entry's extent, then we
+    // must stop processing entries altogether.
+    if (!entry_end) {
+      all_ok = false;
+      break;
     }
 
-    // The next iteration picks up after this entry.
-    entry_end = fde.end;
+    // The terminator's own diagnostics were handled by ProcessEntry.
+    if (kind == kTerminator)
+      break;
+  }
+
+  return all_ok;
+}
+
+bool CallFrameInfo::EnumerateFDEOffsets(std::vector<size_t> *fde_offsets) {
+  const char *buffer_end = buffer_ + buffer_length_;
 
-    // Did we see an .eh_frame terminating mark?
-    if (fde.kind == kTerminator) {
-      // If there appears to be more data left in the section after the
-      // terminating mark, warn the user. But this is just a warning;
-      // we leave all_ok true.
-      if (fde.end < buffer_end) reporter_->EarlyEHTerminator(fde.offset);
+  // Read only each entry's prologue: enough to learn its kind and
+  // find the next entry, without parsing CIE or FDE bodies or
+  // touching the handler.
+  for (const char *cursor = buffer_; cursor < buffer_end;) {
+    Entry entry;
+    if (!ReadEntryPrologue(cursor, &entry) || !entry.end)
+      return false;
+    if (entry.kind == kTerminator)
       break;
-    }
+    if (entry.kind == kFDE)
+      fde_offsets->push_back(entry.offset);
+    cursor = entry.end;
+  }
 
-    // In this loop, we skip CIEs. We only parse them fully when we
-    // parse an FDE that refers to them. This limits our memory
-    // consumption (beyond the buffer itself) to that needed to
-    // process the largest single entry.
-    if (fde.kind != kFDE) {
-      ok = true;
-      continue;
-    }
+  return true;
+}
 
-    // Validate the CIE pointer.
-    if (fde.id > buffer_length_) {
-      reporter_->CIEPointerOutOfRange(fde.offset, fde.id);
-      continue;
-    }
-      
-    CIE cie;
+bool CallFrameInfo::ProcessEntryAt(size_t offset) {
+  const char *entry_end;
+  EntryKind kind;
+  return ProcessEntry(buffer_ + offset, &entry_end, &kind);
+}
 
-    // Parse this FDE's CIE header.
-    if (!ReadEntryPrologue(buffer_ + fde.id, &cie))
-      continue;
-    // This had better be an actual CIE.
-    if (cie.kind != kCIE) {
-      reporter_->BadCIEId(fde.offset, fde.id);
-      continue;
-    }
-    if (!ReadCIEFields(&cie))
-      continue;
+bool CallFrameInfo::ReadEhFrameHdrPointer(const char *cursor,
+                                          const char *hdr_start,
+                                          uint64 hdr_address, uint8 encoding,
+                                          uint64 *value, size_t *len) {
+  if (encoding == DW_EH_PE_omit)
+    return false;
 
-    // We now have the values that govern both the CIE and the FDE.
-    cie.cie = &cie;
-    fde.cie = &cie;
+  // Extract the value first, ignoring whether it's a pointer or an
+  // offset relative to some base.
+  uint64 offset;
+  switch (encoding & 0x0f) {
+    case DW_EH_PE_absptr:
+      offset = reader_->ReadAddress(cursor);
+      *len = reader_->AddressSize();
+      break;
 
-    // Parse the FDE's header.
-    if (!ReadFDEFields(&fde))
-      continue;
+    case DW_EH_PE_uleb128:
+      offset = reader_->ReadUnsignedLEB128(cursor, len);
+      break;
 
-    // Call Entry to ask the consumer if they're interested.
-    if (!handler_->Entry(fde.offset, fde.address, fde.size,
-                         cie.version, cie.augmentation,
-                         cie.return_address_register)) {
-      // The handler isn't interested in this entry. That's not an error.
-      ok = true;
-      continue;
+    case DW_EH_PE_udata2:
+      offset = reader_->ReadTwoBytes(cursor);
+      *len = 2;
+      break;
+
+    case DW_EH_PE_udata4:
+      offset = reader_->ReadFourBytes(cursor);
+      *len = 4;
+      break;
+
+    case DW_EH_PE_udata8:
+      offset = reader_->ReadEightBytes(cursor);
+      *len = 8;
+      break;
+
+    case DW_EH_PE_sleb128:
+      offset = reader_->ReadSignedLEB128(cursor, len);
+      break;
+
+    case DW_EH_PE_sdata2:
+      offset = reader_->ReadTwoBytes(cursor);
+      // Sign-extend from 16 bits.
+      offset = (offset ^ 0x8000) - 0x8000;
+      *len = 2;
+      break;
+
+    case DW_EH_PE_sdata4:
+      offset = reader_->ReadFourBytes(cursor);
+      // Sign-extend from 32 bits.
+      offset = (offset ^ 0x80000000ULL) - 0x80000000ULL;
+      *len = 4;
+      break;
+
+    case DW_EH_PE_sdata8:
+      // No need to sign-extend; this is the full width of our type.
+      offset = reader_->ReadEightBytes(cursor);
+      *len = 8;
+      break;
+
+    default:
+      return false;
+  }
+
+  // The header's relative encodings are relative to the header
+  // itself, so we apply the base here rather than leaving it to
+  // ByteReader, whose bases describe the .eh_frame section.
+  uint64 base;
+  switch (encoding & 0x70) {
+    case DW_EH_PE_absptr:
+      base = 0;
+      break;
+
+    case DW_EH_PE_pcrel:
+      base = hdr_address + (cursor - hdr_start);
+      break;
+
+    case DW_EH_PE_datarel:
+      base = hdr_address;
+      break;
+
+    default:
+      return false;
+  }
+
+  uint64 pointer = base + offset;
+
+  // Remove inappropriate upper bits.
+  if (reader_->AddressSize() == 4)
+    pointer = pointer & 0xffffffff;
+
+  *value = pointer;
+  return true;
+}
+
+bool CallFrameInfo::StartFromEhFrameHdr(const char *hdr, size_t hdr_length,
+                                        uint64 hdr_address,
+                                        uint64 frame_address,
+                                        uint64 low_pc, uint64 high_pc) {
+  const char *hdr_end = hdr + hdr_length;
+  const char *cursor = hdr;
+  uint64 value;
+  size_t len;
+
+  // The header starts with a version byte and the encoding bytes for
+  // its three variable-width fields.
+  if (hdr_length < 4 || static_cast<uint8>(hdr[0]) != 1) {
+    reporter_->UnusableEhFrameHdr();
+    return false;
+  }
+  uint8 eh_frame_ptr_encoding = hdr[1];
+  uint8 fde_count_encoding = hdr[2];
+  uint8 table_encoding = hdr[3];
+  cursor += 4;
+
+  // Without a search table there is nothing here for us; the caller
+  // should scan the section instead.
+  if (fde_count_encoding == DW_EH_PE_omit ||
+      table_encoding == DW_EH_PE_omit) {
+    reporter_->UnusableEhFrameHdr();
+    return false;
+  }
+
+  // Skip the eh_frame_ptr field; the caller gave us the section's
+  // address directly.
+  if (eh_frame_ptr_encoding != DW_EH_PE_omit) {
+    if (!ReadEhFrameHdrPointer(cursor, hdr, hdr_address,
+                               eh_frame_ptr_encoding, &value, &len) ||
+        cursor + len > hdr_end) {
+      reporter_->UnusableEhFrameHdr();
+      return false;
     }
-                         
-    if (cie.has_z_augmentation) {
-      // Report the personality routine address, if we have one.
-      if (cie.has_z_personality) {
-        if (!handler_
-            ->PersonalityRoutine(cie.personality_address,
-                                 IsIndirectEncoding(cie.personality_encoding)))
-          continue;
-      }
+    cursor += len;
+  }
 
-      // Report the language-specific data area address, if we have one.
-      if (cie.has_z_lsda) {
-        if (!handler_
-            ->LanguageSpecificDataArea(fde.lsda_address,
-                                       IsIndirectEncoding(cie.lsda_encoding)))
-          continue;
-      }
+  uint64 fde_count;
+  if (!ReadEhFrameHdrPointer(cursor, hdr, hdr_address, fde_count_encoding,
+                             &fde_count, &len) ||
+      cursor + len > hdr_end) {
+    reporter_->UnusableEhFrameHdr();
+    return false;
+  }
+  cursor += len;
 
-      // If this is a signal-handling frame, report that.
-      if (cie.has_z_signal_frame) {
-        if (!handler_->SignalHandler())
-          continue;
-      }
+  // The search table must use a fixed-width encoding --- anything
+  // else would defeat binary search, and no toolchain emits one ---
+  // and a base we can apply.
+  size_t value_size;
+  switch (table_encoding & 0x0f) {
+    case DW_EH_PE_absptr:
+      value_size = reader_->AddressSize();
+      break;
+    case DW_EH_PE_udata2:
+    case DW_EH_PE_sdata2:
+      value_size = 2;
+      break;
+    case DW_EH_PE_udata4:
+    case DW_EH_PE_sdata4:
+      value_size = 4;
+      break;
+    case DW_EH_PE_udata8:
+    case DW_EH_PE_sdata8:
+      value_size = 8;
+      break;
+    default:
+      reporter_->UnusableEhFrameHdr();
+      return false;
+  }
+  switch (table_encoding & 0x70) {
+    case DW_EH_PE_absptr:
+    case DW_EH_PE_pcrel:
+    case DW_EH_PE_datarel:
+      break;
+    default:
+      reporter_->UnusableEhFrameHdr();
+      return false;
+  }
+
+  // Each table entry holds an initial location and an FDE address.
+  const char *table = cursor;
+  const size_t entry_size = 2 * value_size;
+  if (fde_count > static_cast<size_t>(hdr_end - table) / entry_size) {
+    reporter_->UnusableEhFrameHdr();
+    return false;
+  }
+
+  // The table is sorted by initial location, so if the caller asked
+  // for a range, binary-search for the last entry starting at or
+  // below LOW_PC; an FDE beginning below the range may still cover
+  // its start.
+  size_t first = 0;
+  if (low_pc) {
+    size_t lo = 0, hi = fde_count;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      ReadEhFrameHdrPointer(table + mid * entry_size, hdr, hdr_address,
+                            table_encoding, &value, &len);
+      if (value <= low_pc)
+        lo = mid + 1;
+      else
+        hi = mid;
     }
+    first = lo > 0 ? lo - 1 : 0;
+  }
 
-    // Interpret the CIE's instructions, and then the FDE's instructions.
-    State state(reader_, handler_, reporter_, fde.address);
-    ok = state.InterpretCIE(cie) && state.InterpretFDE(fde);
+  for (size_t i = first; i < fde_count; i++) {
+    const char *entry = table + i * entry_size;
+    uint64 initial_location, fde_pointer;
+    ReadEhFrameHdrPointer(entry, hdr, hdr_address, table_encoding,
+                          &initial_location, &len);
+    ReadEhFrameHdrPointer(entry + value_size, hdr, hdr_address,
+                          table_encoding, &fde_pointer, &len);
 
-    // Tell the ByteReader that the function start address from the
-    // FDE header is no longer valid.
-    reader_->ClearFunctionBase();
+    // Entries past the end of the requested range cannot cover it.
+    if (high_pc && initial_location >= high_pc)
+      break;
+
+    // An FDE address outside the section never corresponds to
+    // anything a scan of the section would have found; skip it.
+    if (fde_pointer < frame_address ||
+        fde_pointer - frame_address >= buffer_length_)
+      continue;
 
-    // Report the end of the entry.
-    handler_->End();
+    // Malformed FDEs are reported by ProcessEntry, but they don't
+    // invalidate the table itself; carry on with the rest.
+    const char *entry_end;
+    EntryKind kind;
+    ProcessEntry(buffer_ + (fde_pointer - frame_address),
+                 &entry_end, &kind);
   }
 
-  return all_ok;
+  return true;
 }
 
 const char *CallFrameInfo::KindName(EntryKind kind) {
@@ -2239,6 +2598,14 @@ void CallFrameInfo::Reporter::EarlyEHTerminator(uint64 offset) {
           filename_.c_str(), offset, section_.c_str());
 }
 
+void CallFrameInfo::Reporter::UnusableEhFrameHdr() {
+  fprintf(stderr,
+          "%s: the '.eh_frame_hdr' data for section '%s' is missing,"
+          " malformed, or uses an encoding this parser cannot process;"
+          " scanning the whole section instead\n",
+          filename_.c_str(), section_.c_str());
+}
+
 void CallFrameInfo::Reporter::CIEPointerOutOfRange(uint64 offset,
                                                    uint64 cie_offset) {
   fprintf(stderr,
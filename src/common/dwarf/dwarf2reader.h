@@ -224,9 +224,19 @@ class CompilationUnit {
   CompilationUnit(const SectionMap& sections, uint64 offset,
                   ByteReader* reader, Dwarf2Handler* handler);
   virtual ~CompilationUnit() {
-    if (abbrevs_) delete abbrevs_;
+    if (abbrevs_ && owns_abbrevs_) delete abbrevs_;
   }
 
+  // A cache of parsed abbreviation tables, keyed by their offset in
+  // the .debug_abbrev section.  See the definition below the class for
+  // details.
+  class AbbrevCache;
+
+  // Share parsed abbreviation tables with the other compilation units
+  // reading from CACHE.  Must be called before Start().  CACHE must
+  // outlive this CompilationUnit.
+  void SetAbbrevCache(AbbrevCache* cache) { abbrev_cache_ = cache; }
+
   // Begin reading a Dwarf2 compilation unit, and calling the
   // callbacks in the Dwarf2Handler
 
@@ -290,6 +300,13 @@ class CompilationUnit {
   const char* SkipAttribute(const char* start,
                                      enum DwarfForm form);
 
+  // Skips the children of a DIE whose own attributes have already
+  // been skipped. START is the first byte of the first child; END
+  // bounds the compilation unit's DIE data. Return the position just
+  // past the subtree's terminating null entry. No handler callbacks
+  // are made for the DIEs stepped over.
+  const char* SkipDIEChildren(const char* start, const char* end);
+
   // Offset from section start is the offset of this compilation unit
   // from the beginning of the .debug_info section.
   uint64 offset_from_section_start_;
@@ -315,6 +332,13 @@ class CompilationUnit {
   // valid.
   std::vector<Abbrev>* abbrevs_;
 
+  // Cache of parsed abbreviation tables shared with other compilation
+  // units in the same file, or NULL if caching is not in use.  When
+  // abbrevs_ belongs to the cache, owns_abbrevs_ is false and the
+  // destructor leaves it alone.
+  AbbrevCache* abbrev_cache_;
+  bool owns_abbrevs_;
+
   // String section buffer and length, if we have a string section.
   // This is here to avoid doing a section lookup for strings in
   // ProcessAttribute, which is in the hot path for DWARF2 reading.
@@ -322,6 +346,35 @@ class CompilationUnit {
   uint64 string_buffer_length_;
 };
 
+// Parsed abbreviation tables retained across the compilation units of
+// one file, keyed by each table's offset in the .debug_abbrev section.
+// Compilers emit a handful of abbreviation tables shared by thousands
+// of compilation units, so reusing the parsed form eliminates most of
+// the LEB128 decoding and allocation that ReadAbbrevs would otherwise
+// repeat for every unit.  The cache owns the tables it holds; it must
+// outlive every CompilationUnit it is passed to via SetAbbrevCache.
+// It performs no locking, so give each parsing thread its own cache.
+class CompilationUnit::AbbrevCache {
+ public:
+  AbbrevCache() { }
+  ~AbbrevCache();
+
+ private:
+  friend class CompilationUnit;
+
+  // Returns the table parsed from OFFSET, or NULL if none is cached.
+  std::vector<Abbrev>* Find(uint64 offset);
+
+  // Takes ownership of ABBREVS, the table parsed from OFFSET.
+  void Insert(uint64 offset, std::vector<Abbrev>* abbrevs);
+
+  std::map<uint64, std::vector<Abbrev>*> tables_;
+
+  // Disallow copy constructor and assignment operator.
+  AbbrevCache(const AbbrevCache&);
+  void operator=(const AbbrevCache&);
+};
+
 // This class is the main interface between the reader and the
 // client.  The virtual functions inside this get called for
 // interesting events that happen during DWARF2 reading.
@@ -344,6 +397,17 @@ class Dwarf2Handler {
   // section. Return false if you would like to skip this DIE.
   virtual bool StartDIE(uint64 offset, enum DwarfTag tag) { return false; }
 
+  // If this returns true, then whenever StartDIE returns false, the
+  // reader steps over the rejected DIE's entire subtree using only the
+  // form widths in the abbreviation table: no attribute values are
+  // decoded, and none of the DIE's descendants are reported via
+  // StartDIE or EndDIE. The rejected DIE itself still receives its
+  // matching EndDIE call. Handlers that reject a DIE but still want to
+  // be offered its children --- say, one that ignores namespace DIEs
+  // but handles the subprograms within them --- must leave this
+  // returning false.
+  virtual bool SkipsRejectedSubtrees() const { return false; }
+
   // Called when we have an attribute with unsigned data to give to our
   // handler. The attribute is for the DIE at OFFSET from the beginning of the
   // .debug_info section. Its name is ATTR, its form is FORM, and its value is
@@ -651,6 +715,52 @@ class CallFrameInfo {
   // false if we encounter an error.
   bool Start();
 
+  // As Start, but instead of scanning BUFFER entry by entry, visit
+  // only the frame description entries listed in the sorted FDE
+  // search table of an .eh_frame_hdr section covering BUFFER. HDR
+  // points to the header's contents and HDR_LENGTH is its size in
+  // bytes; HDR_ADDRESS and FRAME_ADDRESS are the addresses at which
+  // the .eh_frame_hdr and .eh_frame sections are loaded in the
+  // program, used to interpret the header's relative pointer
+  // encodings and to turn the table's FDE addresses into offsets in
+  // BUFFER. If LOW_PC or HIGH_PC is non-zero, binary-search the table
+  // and process only the FDEs that could cover addresses in
+  // [LOW_PC, HIGH_PC); pass zero for both to process every listed
+  // FDE.
+  //
+  // If the header is unusable --- an unrecognized version, an omitted
+  // or variable-length search table, an encoding we cannot process,
+  // or a table that overruns the header --- report that, make no
+  // calls on the handler, and return false, so that the caller can
+  // fall back to a linear Start scan. Malformed FDEs the table points
+  // at are reported as Start would report them, but do not make the
+  // whole call fail.
+  bool StartFromEhFrameHdr(const char *hdr, size_t hdr_length,
+                           uint64 hdr_address, uint64 frame_address,
+                           uint64 low_pc, uint64 high_pc);
+
+  // Scan BUFFER's entry prologues --- initial lengths and ids only,
+  // without parsing entry bodies or making any calls on the handler
+  // --- and append the buffer offset of each frame description entry
+  // to *FDE_OFFSETS, in section order. Stop at an .eh_frame
+  // terminating mark, as Start does. Return true if the scan reached
+  // the end of the section; return false, leaving *FDE_OFFSETS in an
+  // unspecified state, if an entry's extent could not be determined
+  // --- reported as Start would report it.
+  //
+  // The offsets this produces are suitable for ProcessEntryAt, which
+  // lets a caller partition a section's FDEs into ranges and
+  // interpret each range with its own CallFrameInfo --- constructed
+  // over the whole of BUFFER, so that FDEs' CIE pointers still
+  // resolve --- on its own thread.
+  bool EnumerateFDEOffsets(std::vector<size_t> *fde_offsets);
+
+  // Parse and dispatch the single CFI entry at OFFSET in BUFFER, as
+  // one step of Start's scan would. Return true if the entry was
+  // processed successfully or legitimately skipped, or false if it
+  // was malformed.
+  bool ProcessEntryAt(size_t offset);
+
   // Return the textual name of KIND. For error reporting.
   static const char *KindName(EntryKind kind);
 
@@ -764,6 +874,28 @@ class CallFrameInfo {
   // were able to figure that out, or NULL if we weren't.
   bool ReadEntryPrologue(const char *cursor, Entry *entry);
 
+  // Parse and dispatch the single CFI entry at CURSOR, as each pass
+  // of Start's scan does. Set *ENTRY_END to the first byte after the
+  // entry, or to NULL if even the entry's extent could not be
+  // determined, and *KIND to the kind of entry found. Return true if
+  // the entry was processed successfully or legitimately skipped (a
+  // CIE, a terminator, or an FDE the handler declined); return false
+  // if it was malformed.
+  bool ProcessEntry(const char *cursor, const char **entry_end,
+                    EntryKind *kind);
+
+  // Read the .eh_frame_hdr-encoded pointer at CURSOR, which lies
+  // within the header starting at HDR_START and loaded at HDR_ADDRESS
+  // in the program. ENCODING is the header's encoding byte for this
+  // value; the header's relative encodings are applied against the
+  // header's own addresses, not against the bases reader_ holds for
+  // the .eh_frame section. On success, set *VALUE and *LEN and return
+  // true; return false if ENCODING is omitted or one we cannot
+  // process here.
+  bool ReadEhFrameHdrPointer(const char *cursor, const char *hdr_start,
+                             uint64 hdr_address, uint8 encoding,
+                             uint64 *value, size_t *len);
+
   // Parse the fields of a CIE after the entry prologue, including any 'z'
   // augmentation data. Assume that the 'Entry' fields of CIE are
   // populated; use CIE->fields and CIE->end as the start and limit for
@@ -804,6 +936,14 @@ class CallFrameInfo {
 
   // True if we are processing .eh_frame-format data.
   bool eh_frame_;
+
+  // Successfully parsed CIEs, keyed by their offset in the section.
+  // Nearly every FDE in a section cites one of a handful of CIEs, so
+  // ProcessEntry parses each CIE once and reuses the result, instead
+  // of re-parsing it for every FDE that refers to it. The cache is
+  // per-instance: parallel callers give each worker its own
+  // CallFrameInfo, and share only the read-only section buffer.
+  std::map<size_t, CIE> cie_cache_;
 };
 
 // The handler class for CallFrameInfo.  The a CFI parser calls the
@@ -981,6 +1121,11 @@ class CallFrameInfo::Reporter {
   // more data.
   virtual void EarlyEHTerminator(uint64 offset);
 
+  // The .eh_frame_hdr data given to StartFromEhFrameHdr is missing,
+  // malformed, or uses an encoding the parser cannot process, so its
+  // FDE search table cannot be used to index the section.
+  virtual void UnusableEhFrameHdr();
+
   // The FDE at OFFSET refers to the CIE at CIE_OFFSET, but the
   // section is not that large.
   virtual void CIEPointerOutOfRange(uint64 offset, uint64 cie_offset);
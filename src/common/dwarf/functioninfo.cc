@@ -33,8 +33,10 @@
 #include <limits.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <map>
 #include <queue>
+#include <utility>
 #include <vector>
 #include <memory>
 
@@ -94,10 +96,11 @@ void CULineInfoHandler::DefineFile(const string& name,
 void CULineInfoHandler::AddLine(uint64 address, uint64 length, uint32 file_num,
                                 uint32 line_num, uint32 column_num) {
   if (file_num < files_->size()) {
-    linemap_->insert(
-        std::make_pair(address,
-                       std::make_pair(files_->at(file_num).name.c_str(),
-                                      line_num)));
+    LineEntry entry;
+    entry.address = address;
+    entry.file = files_->at(file_num).name;
+    entry.line = line_num;
+    linemap_->push_back(entry);
 
     if(address < files_->at(file_num).lowpc) {
       files_->at(file_num).lowpc = address;
@@ -107,6 +110,49 @@ void CULineInfoHandler::AddLine(uint64 address, uint64 length, uint32 file_num,
   }
 }
 
+namespace {
+
+// Address-only orderings, so that stable sorts preserve the order in
+// which entries for equal addresses were appended.
+struct LineEntryAddressLess {
+  bool operator()(const LineEntry& a, const LineEntry& b) const {
+    return a.address < b.address;
+  }
+};
+
+struct FunctionEntryAddressLess {
+  bool operator()(const std::pair<uint64, FunctionInfo*>& a,
+                  const std::pair<uint64, FunctionInfo*>& b) const {
+    return a.first < b.first;
+  }
+};
+
+}  // namespace
+
+void FinishLineMap(LineMap* linemap) {
+  std::stable_sort(linemap->begin(), linemap->end(), LineEntryAddressLess());
+  // Keep only the first row appended for each address, as map
+  // insertion used to.
+  LineMap::iterator kept = linemap->begin();
+  for (LineMap::iterator it = linemap->begin(); it != linemap->end(); ++it) {
+    if (kept == linemap->begin() || (kept - 1)->address != it->address)
+      *kept++ = *it;
+  }
+  linemap->erase(kept, linemap->end());
+}
+
+void FinishFunctionEntryList(FunctionEntryList* functions) {
+  std::stable_sort(functions->begin(), functions->end(),
+                   FunctionEntryAddressLess());
+  FunctionEntryList::iterator kept = functions->begin();
+  for (FunctionEntryList::iterator it = functions->begin();
+       it != functions->end(); ++it) {
+    if (kept == functions->begin() || (kept - 1)->first != it->first)
+      *kept++ = *it;
+  }
+  functions->erase(kept, functions->end());
+}
+
 bool CUFunctionInfoHandler::StartCompilationUnit(uint64 offset,
                                                  uint8 address_size,
                                                  uint8 offset_size,
@@ -220,8 +266,9 @@ void CUFunctionInfoHandler::ProcessAttributeReference(uint64 offset,
 
 void CUFunctionInfoHandler::EndDIE(uint64 offset) {
   if (current_function_info_ && current_function_info_->lowpc)
-    address_to_funcinfo_->insert(std::make_pair(current_function_info_->lowpc,
-                                                current_function_info_));
+    address_to_funcinfo_->push_back(
+        std::make_pair(current_function_info_->lowpc,
+                       current_function_info_));
 }
 
 }  // namespace dwarf2reader
@@ -68,7 +68,32 @@ struct SourceFileInfo {
 };
 
 typedef std::map<uint64, FunctionInfo*> FunctionMap;
-typedef std::map<uint64, std::pair<string, uint32> > LineMap;
+
+// One line table row: the address of a machine instruction, and the
+// source file name and line number that produced it.
+struct LineEntry {
+  uint64 address;
+  string file;
+  uint32 line;
+};
+
+// Line rows are appended in the order the line-number state machine
+// emits them --- nearly ascending by address --- and sorted once at
+// the end by FinishLineMap, which is far cheaper than paying for a
+// map node per row while reading. Likewise, FunctionEntryList
+// collects (low pc, function) pairs during the DIE walk, to be
+// sorted once by FinishFunctionEntryList.
+typedef std::vector<LineEntry> LineMap;
+typedef std::vector<std::pair<uint64, FunctionInfo*> > FunctionEntryList;
+
+// Sort LINEMAP by address and drop all but the first row appended
+// for any given address, matching what map insertion used to
+// produce. Call this once reading is done, before doing any
+// binary-search lookups on the table.
+void FinishLineMap(LineMap* linemap);
+
+// Likewise for an address-indexed function list.
+void FinishFunctionEntryList(FunctionEntryList* functions);
 
 // This class is a basic line info handler that fills in the dirs,
 // file, and linemap passed into it with the data produced from the
@@ -113,7 +138,7 @@ class CUFunctionInfoHandler: public Dwarf2Handler {
                         std::vector<string>* dirs,
                         LineMap* linemap,
                         FunctionMap* offset_to_funcinfo,
-                        FunctionMap* address_to_funcinfo,
+                        FunctionEntryList* address_to_funcinfo,
                         CULineInfoHandler* linehandler,
                         const SectionMap& sections,
                         ByteReader* reader)
@@ -176,7 +201,7 @@ class CUFunctionInfoHandler: public Dwarf2Handler {
   std::vector<string>* dirs_;
   LineMap* linemap_;
   FunctionMap* offset_to_funcinfo_;
-  FunctionMap* address_to_funcinfo_;
+  FunctionEntryList* address_to_funcinfo_;
   CULineInfoHandler* linehandler_;
   const SectionMap& sections_;
   ByteReader* reader_;
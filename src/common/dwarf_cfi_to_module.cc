@@ -34,14 +34,10 @@
 // Implementation of google_breakpad::DwarfCFIToModule.
 // See dwarf_cfi_to_module.h for details.
 
-#include <sstream>
-
 #include "common/dwarf_cfi_to_module.h"
 
 namespace google_breakpad {
 
-using std::ostringstream;
-
 vector<string> DwarfCFIToModule::RegisterNames::MakeVector(
     const char * const *strings,
     size_t size) {
@@ -127,12 +123,13 @@ bool DwarfCFIToModule::Entry(size_t offset, uint64 address, uint64 length,
   // address on entry to the function. So establish an initial .ra
   // rule citing the return address register.
   if (return_address_ < register_names_.size())
-    entry_->initial_rules[ra_name_] = register_names_[return_address_];
+    entry_->initial_rules[ra_name_] = Module::Rule::Register(
+        module_->InternString(register_names_[return_address_]));
 
   return true;
 }
 
-string DwarfCFIToModule::RegisterName(int i) {
+const string *DwarfCFIToModule::RegisterName(int i) {
   assert(entry_);
   if (i < 0) {
     assert(i == kCFARegister);
@@ -144,81 +141,67 @@ string DwarfCFIToModule::RegisterName(int i) {
 
   // Ensure that a non-empty name exists for this register value.
   if (reg < register_names_.size() && !register_names_[reg].empty())
-    return register_names_[reg];
+    return module_->InternString(register_names_[reg]);
 
   reporter_->UnnamedRegister(entry_offset_, reg);
   char buf[30];
   sprintf(buf, "unnamed_register%u", reg);
-  return buf;
+  return module_->InternString(buf);
 }
 
 void DwarfCFIToModule::Record(Module::Address address, int reg,
-                              const string &rule) {
+                              const Module::Rule &rule) {
   assert(entry_);
 
-  // Place the name in our global set of strings, and then use the string
-  // from the set. Even though the assignment looks like a copy, all the
-  // major std::string implementations use reference counting internally,
-  // so the effect is to have all our data structures share copies of rules
-  // whenever possible. Since register names are drawn from a
-  // vector<string>, register names are already shared.
-  string shared_rule = *common_strings_.insert(rule).first;
-
   // Is this one of this entry's initial rules?
   if (address == entry_->address)
-    entry_->initial_rules[RegisterName(reg)] = shared_rule;
+    entry_->initial_rules[RegisterName(reg)] = rule;
   // File it under the appropriate address.
   else
-    entry_->rule_changes[address][RegisterName(reg)] = shared_rule;
+    entry_->rule_changes[address][RegisterName(reg)] = rule;
 }
 
 bool DwarfCFIToModule::UndefinedRule(uint64 address, int reg) {
-  reporter_->UndefinedNotSupported(entry_offset_, RegisterName(reg));
+  reporter_->UndefinedNotSupported(entry_offset_, *RegisterName(reg));
   // Treat this as a non-fatal error.
   return true;
 }
 
 bool DwarfCFIToModule::SameValueRule(uint64 address, int reg) {
-  ostringstream s;
-  s << RegisterName(reg);
-  Record(address, reg, s.str());
+  Record(address, reg, Module::Rule::Register(RegisterName(reg)));
   return true;
 }
 
 bool DwarfCFIToModule::OffsetRule(uint64 address, int reg,
                                   int base_register, long offset) {
-  ostringstream s;
-  s << RegisterName(base_register) << " " << offset << " + ^";
-  Record(address, reg, s.str());
+  Record(address, reg,
+         Module::Rule::Offset(RegisterName(base_register), offset));
   return true;
 }
 
 bool DwarfCFIToModule::ValOffsetRule(uint64 address, int reg,
                                      int base_register, long offset) {
-  ostringstream s;
-  s << RegisterName(base_register) << " " << offset << " +";
-  Record(address, reg, s.str());
+  Record(address, reg,
+         Module::Rule::ValOffset(RegisterName(base_register), offset));
   return true;
 }
 
 bool DwarfCFIToModule::RegisterRule(uint64 address, int reg,
                                     int base_register) {
-  ostringstream s;
-  s << RegisterName(base_register);
-  Record(address, reg, s.str());
+  Record(address, reg, Module::Rule::Register(RegisterName(base_register)));
   return true;
 }
 
 bool DwarfCFIToModule::ExpressionRule(uint64 address, int reg,
                                       const string &expression) {
-  reporter_->ExpressionsNotSupported(entry_offset_, RegisterName(reg));
+  reporter_->ExpressionsNotSupported(entry_offset_, *RegisterName(reg));
   // Treat this as a non-fatal error.
   return true;
 }
 
 bool DwarfCFIToModule::ValExpressionRule(uint64 address, int reg,
                                          const string &expression) {
-  reporter_->ExpressionsNotSupported(entry_offset_, RegisterName(reg));
+  reporter_->ExpressionsNotSupported(entry_offset_, *RegisterName(reg));
   // Treat this as a non-fatal error.
   return true;
 }
@@ -42,7 +42,6 @@
 #include <assert.h>
 #include <stdio.h>
 
-#include <set>
 #include <string>
 #include <vector>
 
@@ -54,7 +53,6 @@ namespace google_breakpad {
 
 using dwarf2reader::CallFrameInfo;
 using google_breakpad::Module;
-using std::set;
 using std::vector;
 
 // A class that accepts parsed call frame information from the DWARF
@@ -127,7 +125,9 @@ class DwarfCFIToModule: public CallFrameInfo::Handler {
   DwarfCFIToModule(Module *module, const vector<string> &register_names,
                    Reporter *reporter)
       : module_(module), register_names_(register_names), reporter_(reporter),
-        entry_(NULL), return_address_(-1), cfa_name_(".cfa"), ra_name_(".ra") {
+        entry_(NULL), return_address_(-1),
+        cfa_name_(module->InternString(".cfa")),
+        ra_name_(module->InternString(".ra")) {
   }
   virtual ~DwarfCFIToModule() { delete entry_; }
 
@@ -148,11 +148,11 @@ class DwarfCFIToModule: public CallFrameInfo::Handler {
   virtual bool End();
 
  private:
-  // Return the name to use for register REG.
-  string RegisterName(int i);
+  // Return the name to use for register REG, interned in module_.
+  const string *RegisterName(int i);
 
   // Record RULE for register REG at ADDRESS.
-  void Record(Module::Address address, int reg, const string &rule);
+  void Record(Module::Address address, int reg, const Module::Rule &rule);
 
   // The module to which we should add entries.
   Module *module_;
@@ -173,22 +173,9 @@ class DwarfCFIToModule: public CallFrameInfo::Handler {
   // The return address column for that entry.
   unsigned return_address_;
 
-  // The names of the return address and canonical frame address. Putting
-  // these here instead of using string literals allows us to share their
-  // texts in reference-counted std::string implementations (all the
-  // popular ones). Many, many rules cite these strings.
-  string cfa_name_, ra_name_;
-
-  // A set of strings used by this CFI. Before storing a string in one of
-  // our data structures, insert it into this set, and then use the string
-  // from the set.
-  // 
-  // Because std::string uses reference counting internally, simply using
-  // strings from this set, even if passed by value, assigned, or held
-  // directly in structures and containers (map<string, ...>, for example),
-  // causes those strings to share a single instance of each distinct piece
-  // of text.
-  set<string> common_strings_;
+  // The names of the return address and canonical frame address,
+  // interned in module_. Many, many rules cite these strings.
+  const string *cfa_name_, *ra_name_;
 };
 
 } // namespace google_breakpad
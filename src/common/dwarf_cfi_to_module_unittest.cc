@@ -158,7 +158,8 @@ TEST_F(Rule, SameValueRule) {
   ASSERT_TRUE(handler.End());
   CheckEntry();
   Module::RuleMap expected_initial;
-  expected_initial["reg6"] = "reg6";
+  expected_initial[module.InternString("reg6")] =
+      Module::Rule::Register(module.InternString("reg6"));
   EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
   EXPECT_EQ(0U, entries[0]->rule_changes.size());
 }
@@ -172,7 +173,8 @@ TEST_F(Rule, OffsetRule) {
   CheckEntry();
   EXPECT_EQ(0U, entries[0]->initial_rules.size());
   Module::RuleChangeMap expected_changes;
-  expected_changes[entry_address + 1][".ra"] = ".cfa 16927065 + ^";
+  expected_changes[entry_address + 1][module.InternString(".ra")] =
+      Module::Rule::Offset(module.InternString(".cfa"), 16927065);
   EXPECT_THAT(entries[0]->rule_changes, ContainerEq(expected_changes));
 }
 
@@ -184,7 +186,8 @@ TEST_F(Rule, OffsetRuleNegative) {
   CheckEntry();
   EXPECT_EQ(0U, entries[0]->initial_rules.size());
   Module::RuleChangeMap expected_changes;
-  expected_changes[entry_address + 1][".cfa"] = "reg4 -34530721 + ^";
+  expected_changes[entry_address + 1][module.InternString(".cfa")] =
+      Module::Rule::Offset(module.InternString("reg4"), -34530721);
   EXPECT_THAT(entries[0]->rule_changes, ContainerEq(expected_changes));
 }
 
@@ -199,8 +202,9 @@ TEST_F(Rule, ValOffsetRule) {
   CheckEntry();
   EXPECT_EQ(0U, entries[0]->initial_rules.size());
   Module::RuleChangeMap expected_changes;
-  expected_changes[entry_address + 0x5ab7][".cfa"] =
-      "unnamed_register11 61812979 +";
+  expected_changes[entry_address + 0x5ab7][module.InternString(".cfa")] =
+      Module::Rule::ValOffset(module.InternString("unnamed_register11"),
+                              61812979);
   EXPECT_THAT(entries[0]->rule_changes, ContainerEq(expected_changes));
 }
 
@@ -210,7 +214,8 @@ TEST_F(Rule, RegisterRule) {
   ASSERT_TRUE(handler.End());
   CheckEntry();
   Module::RuleMap expected_initial;
-  expected_initial[".ra"] = "reg3";
+  expected_initial[module.InternString(".ra")] =
+      Module::Rule::Register(module.InternString("reg3"));
   EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
   EXPECT_EQ(0U, entries[0]->rule_changes.size());
 }
@@ -244,8 +249,10 @@ TEST_F(Rule, DefaultReturnAddressRule) {
   ASSERT_TRUE(handler.End());
   CheckEntry();
   Module::RuleMap expected_initial;
-  expected_initial[".ra"] = "reg2";
-  expected_initial["reg0"] = "reg1";
+  expected_initial[module.InternString(".ra")] =
+      Module::Rule::Register(module.InternString("reg2"));
+  expected_initial[module.InternString("reg0")] =
+      Module::Rule::Register(module.InternString("reg1"));
   EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
   EXPECT_EQ(0U, entries[0]->rule_changes.size());
 }
@@ -257,7 +264,8 @@ TEST_F(Rule, DefaultReturnAddressRuleOverride) {
   ASSERT_TRUE(handler.End());
   CheckEntry();
   Module::RuleMap expected_initial;
-  expected_initial[".ra"] = "reg1";
+  expected_initial[module.InternString(".ra")] =
+      Module::Rule::Register(module.InternString("reg1"));
   EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
   EXPECT_EQ(0U, entries[0]->rule_changes.size());
 }
@@ -269,10 +277,12 @@ TEST_F(Rule, DefaultReturnAddressRuleLater) {
   ASSERT_TRUE(handler.End());
   CheckEntry();
   Module::RuleMap expected_initial;
-  expected_initial[".ra"] = "reg2";
+  expected_initial[module.InternString(".ra")] =
+      Module::Rule::Register(module.InternString("reg2"));
   EXPECT_THAT(entries[0]->initial_rules, ContainerEq(expected_initial));
   Module::RuleChangeMap expected_changes;
-  expected_changes[entry_address + 1][".ra"] = "reg1";
+  expected_changes[entry_address + 1][module.InternString(".ra")] =
+      Module::Rule::Register(module.InternString("reg1"));
   EXPECT_THAT(entries[0]->rule_changes, ContainerEq(expected_changes));
 }
 
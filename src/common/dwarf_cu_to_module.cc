@@ -59,6 +59,107 @@ using std::set;
 using std::sort;
 using std::vector;
 
+// A hash table mapping .debug_info offsets to values, used for the
+// specification and abstract origin tables below. DW_AT_specification
+// and DW_AT_abstract_origin references are looked up for nearly every
+// named DIE in C++-heavy compilation units, so these tables are on the
+// dumper's hot path; open addressing with linear probing keeps each
+// lookup to a hash and (usually) one cache line, where the ordered map
+// this replaced chased a red-black tree for every reference. DIE
+// offsets are already well-distributed and never need to be visited in
+// order.
+//
+// Keys are offsets into .debug_info, so the all-ones value can never be
+// a real key and marks an empty slot. Values are held on the heap, not
+// in the slots themselves, so pointers returned by Find stay valid when
+// the table rehashes; handlers hold on to specifications and origins
+// long after later DIEs have grown the tables.
+template <typename ValueType>
+class OffsetHashTable {
+ public:
+  OffsetHashTable() : slots_(NULL), capacity_(0), size_(0) { }
+  ~OffsetHashTable() {
+    for (size_t i = 0; i < capacity_; i++) {
+      if (slots_[i].key != kEmptySlotKey)
+        delete slots_[i].value;
+    }
+    delete [] slots_;
+  }
+
+  // Make room for at least COUNT entries beyond those already present,
+  // so that storing them rehashes at most once, up front.
+  void Reserve(size_t count) {
+    size_t capacity = kInitialCapacity;
+    while (capacity - capacity / 3 < size_ + count)
+      capacity *= 2;
+    if (capacity > capacity_)
+      Rehash(capacity);
+  }
+
+  // Return the value stored under KEY, or NULL if there is none. The
+  // pointer stays valid until the table is destroyed.
+  ValueType *Find(uint64 key) {
+    if (!size_)
+      return NULL;
+    size_t slot = FindSlot(key);
+    return slots_[slot].key == key ? slots_[slot].value : NULL;
+  }
+
+  // Store VALUE under KEY, replacing any existing entry.
+  void Set(uint64 key, const ValueType &value) {
+    assert(key != kEmptySlotKey);
+    // Keep the table under two-thirds full.
+    if ((size_ + 1) * 3 >= capacity_ * 2)
+      Rehash(capacity_ ? capacity_ * 2 : kInitialCapacity);
+    size_t slot = FindSlot(key);
+    if (slots_[slot].key != key) {
+      slots_[slot].key = key;
+      slots_[slot].value = new ValueType(value);
+      size_++;
+    } else {
+      *slots_[slot].value = value;
+    }
+  }
+
+ private:
+  struct Slot {
+    Slot() : key(kEmptySlotKey), value(NULL) { }
+    uint64 key;
+    ValueType *value;
+  };
+
+  static const uint64 kEmptySlotKey = ~(uint64) 0;
+  static const size_t kInitialCapacity = 64;
+
+  // Return the slot holding KEY, or the empty slot where KEY would be
+  // stored. capacity_ must be nonzero.
+  size_t FindSlot(uint64 key) const {
+    // A Fibonacci multiply mixes the key's high bits into the low bits
+    // the mask keeps; capacity_ is always a power of two.
+    size_t slot = (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32)
+                  & (capacity_ - 1);
+    while (slots_[slot].key != key && slots_[slot].key != kEmptySlotKey)
+      slot = (slot + 1) & (capacity_ - 1);
+    return slot;
+  }
+
+  void Rehash(size_t new_capacity) {
+    Slot *old_slots = slots_;
+    size_t old_capacity = capacity_;
+    slots_ = new Slot[new_capacity];
+    capacity_ = new_capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+      if (old_slots[i].key != kEmptySlotKey)
+        slots_[FindSlot(old_slots[i].key)] = old_slots[i];
+    }
+    delete [] old_slots;
+  }
+
+  Slot *slots_;
+  size_t capacity_;
+  size_t size_;
+};
+
 // Data provided by a DWARF specification DIE.
 //
 // In DWARF, the DIE for a definition may contain a DW_AT_specification
@@ -96,7 +197,7 @@ struct AbstractOrigin {
   string name;
 };
 
-typedef map<uint64, AbstractOrigin> AbstractOriginByOffset;
+typedef OffsetHashTable<AbstractOrigin> AbstractOriginByOffset;
 
 // Data global to the DWARF-bearing file that is private to the
 // DWARF-to-Module process.
@@ -120,10 +221,10 @@ struct DwarfCUToModule::FilePrivate {
   // we will probably need to use pointers to strings held in this set.
   set<string> common_strings;
 
-  // A map from offsets of DIEs within the .debug_info section to
+  // A table mapping offsets of DIEs within the .debug_info section to
   // Specifications describing those DIEs. Specification references can
   // cross compilation unit boundaries.
-  SpecificationByOffset specifications;
+  OffsetHashTable<Specification> specifications;
 
   AbstractOriginByOffset origins;
 };
@@ -282,11 +383,10 @@ void DwarfCUToModule::GenericDIEHandler::ProcessAttributeReference(
       // EndAttribute member function, at which point we know we have
       // seen all the DIE's attributes.
       FileContext *file_context = cu_context_->file_context;
-      SpecificationByOffset *specifications
-          = &file_context->file_private->specifications;
-      SpecificationByOffset::iterator spec = specifications->find(data);
-      if (spec != specifications->end()) {
-        specification_ = &spec->second;
+      Specification *spec
+          = file_context->file_private->specifications.Find(data);
+      if (spec) {
+        specification_ = spec;
       } else {
         // Technically, there's no reason a DW_AT_specification
         // couldn't be a forward reference, but supporting that would
@@ -373,7 +473,7 @@ string DwarfCUToModule::GenericDIEHandler::ComputeQualifiedName() {
       spec.enclosing_name = *enclosing_name;
       spec.unqualified_name = *unqualified_name;
     }
-    file_context->file_private->specifications[offset_] = spec;
+    file_context->file_private->specifications.Set(offset_, spec);
   }
 
   if (qualified_name)
@@ -459,11 +559,11 @@ void DwarfCUToModule::FuncHandler::ProcessAttributeReference(
     uint64 data) {
   switch(attr) {
     case dwarf2reader::DW_AT_abstract_origin: {
-      const AbstractOriginByOffset& origins =
+      AbstractOriginByOffset& origins =
           cu_context_->file_context->file_private->origins;
-      AbstractOriginByOffset::const_iterator origin = origins.find(data);
-      if (origin != origins.end()) {
-        abstract_origin_ = &(origin->second);
+      const AbstractOrigin *origin = origins.Find(data);
+      if (origin) {
+        abstract_origin_ = origin;
       } else {
         cu_context_->reporter->UnknownAbstractOrigin(offset_, data);
       }
@@ -500,11 +600,12 @@ void DwarfCUToModule::FuncHandler::Finish() {
     Module::Function *func = new Module::Function;
     // Malformed DWARF may omit the name, but all Module::Functions must
     // have names.
+    Module *module = cu_context_->file_context->module;
     if (!name_.empty()) {
-      func->name = name_;
+      func->name = module->InternString(name_);
     } else {
       cu_context_->reporter->UnnamedFunction(offset_);
-      func->name = "<name omitted>";
+      func->name = module->InternString("<name omitted>");
     }
     func->address = low_pc_;
     func->size = high_pc_ - low_pc_;
@@ -516,7 +617,7 @@ void DwarfCUToModule::FuncHandler::Finish() {
      }
   } else if (inline_) {
     AbstractOrigin origin(name_);
-    cu_context_->file_context->file_private->origins[offset_] = origin;
+    cu_context_->file_context->file_private->origins.Set(offset_, origin);
   }
 }
 
@@ -610,7 +711,7 @@ void DwarfCUToModule::WarningReporter::UncoveredFunction(
   UncoveredHeading();
   fprintf(stderr, "    function%s: %s\n",
           function.size == 0 ? " (zero-length)" : "",
-          function.name.c_str());
+          function.name->c_str());
 }
 
 void DwarfCUToModule::WarningReporter::UncoveredLine(const Module::Line &line) {
@@ -758,6 +859,13 @@ void DwarfCUToModule::ReadSourceLines(uint64 offset) {
     cu_context_->reporter->BadLineInfoOffset(offset);
     return;
   }
+  // A unit that yielded no functions --- typically because they were
+  // all dead-stripped by the linker --- has nothing to attach lines
+  // to. The checks above still report missing or corrupt line data
+  // for such units, but running the line-number state machine is
+  // expensive and its output would be thrown away, so stop here.
+  if (cu_context_->functions.empty())
+    return;
   line_reader_->ReadProgram(section_start + offset, section_length - offset,
                             cu_context_->file_context->module, &lines_);
 }
@@ -973,12 +1081,16 @@ void DwarfCUToModule::Finish() {
   if (!cu_context_->language->HasFunctions())
     return;
 
-  // Read source line info, if we have any.
+  vector<Module::Function *> *functions = &cu_context_->functions;
+
+  // Read source line info, if we have any. We've only noted the line
+  // program's offset so far; ReadSourceLines validates it --- and
+  // reports missing or corrupt line data --- for every unit, but only
+  // runs the line-number state machine for units with functions to
+  // attach the lines to.
   if (has_source_line_info_)
     ReadSourceLines(source_line_offset_);
 
-  vector<Module::Function *> *functions = &cu_context_->functions;
-
   // Dole out lines to the appropriate functions.
   AssignLinesToFunctions();
 
@@ -997,7 +1109,29 @@ bool DwarfCUToModule::StartCompilationUnit(uint64 offset,
                                            uint8 offset_size,
                                            uint64 cu_length,
                                            uint8 dwarf_version) {
-  return dwarf_version >= 2;
+  if (dwarf_version < 2)
+    return false;
+
+  // Size the specification and origin tables for this CU up front, so
+  // recording its declarations rehashes at most once instead of
+  // repeatedly as the tables fill. The ratios are rough empirical
+  // figures for C++ debug info: declaration DIEs that land in the
+  // specification table run about one per hundred bytes of DIE data,
+  // and unused inline definitions are rarer still. Reserving generously
+  // is cheap - empty slots are small - while undershooting just means a
+  // rehash later.
+  //
+  // The length comes straight from the CU header, which a corrupt or
+  // hostile file can set to anything, so don't let it size an
+  // arbitrarily large allocation: clamp the hint to more DIE data than
+  // any real compilation unit carries. Undershooting on a genuinely
+  // huge CU just means the tables rehash a few more times as it loads.
+  static const uint64 kMaxCULengthHint = 1 << 24;
+  FilePrivate *file_private = cu_context_->file_context->file_private;
+  uint64 cu_length_hint = std::min(cu_length, kMaxCULengthHint);
+  file_private->specifications.Reserve(cu_length_hint / 96);
+  file_private->origins.Reserve(cu_length_hint / 512);
+  return true;
 }
 
 bool DwarfCUToModule::StartRootDIE(uint64 offset, enum DwarfTag tag) {
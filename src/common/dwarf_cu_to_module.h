@@ -229,9 +229,6 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
   class FuncHandler;
   class NamedScopeHandler;
 
-  // A map from section offsets to specifications.
-  typedef map<uint64, Specification> SpecificationByOffset;
-
   // Set this compilation unit's source language to LANGUAGE.
   void SetLanguage(DwarfLanguage language);
   
@@ -266,7 +263,9 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
   bool has_source_line_info_;
 
   // The offset of this compilation unit's line number information in
-  // the .debug_line section.
+  // the .debug_line section. We note the offset when we see
+  // DW_AT_stmt_list, but only run the line program in Finish, and
+  // only if the unit produced at least one function to give lines to.
   uint64 source_line_offset_;
 
   // The line numbers we have seen thus far.  We accumulate these here
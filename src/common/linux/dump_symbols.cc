@@ -39,6 +39,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <link.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -78,7 +80,7 @@ using google_breakpad::DwarfLineToModule;
 using google_breakpad::ElfClass;
 using google_breakpad::ElfClass32;
 using google_breakpad::ElfClass64;
-using google_breakpad::FindElfSectionByName;
+using google_breakpad::ElfSectionIndex;
 using google_breakpad::GetOffset;
 using google_breakpad::IsValidElf;
 using google_breakpad::Module;
@@ -112,6 +114,43 @@ class FDWrapper {
   int fd_;
 };
 
+//
+// SectionPageAdvisor
+//
+// A scoped paging hint for one ELF section within a mapped file.
+// Construction tells the kernel we are about to read the section
+// (MADV_WILLNEED); destruction tells it we are done with those pages
+// (MADV_DONTNEED), so parallel dump_syms jobs parsing multi-gigabyte
+// debug sections do not evict each other's page cache. The hints are
+// best effort: madvise failures are simply ignored. Note that
+// MADV_DONTNEED discards private dirty pages, so this must only cover
+// sections that are never written through the mapping; every parser
+// here reads through const pointers.
+//
+class SectionPageAdvisor {
+ public:
+  SectionPageAdvisor(const void* base, size_t length)
+      : base_(NULL), length_(0) {
+    if (!base || length == 0)
+      return;
+    // madvise operates on whole pages; round the start down.
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t address = reinterpret_cast<uintptr_t>(base);
+    const uintptr_t page_start = address & ~(page_size - 1);
+    base_ = reinterpret_cast<void*>(page_start);
+    length_ = length + (address - page_start);
+    madvise(base_, length_, MADV_WILLNEED);
+  }
+  ~SectionPageAdvisor() {
+    if (base_)
+      madvise(base_, length_, MADV_DONTNEED);
+  }
+
+ private:
+  void* base_;
+  size_t length_;
+};
+
 //
 // MmapWrapper
 //
@@ -212,6 +251,98 @@ class DumperLineToModule: public DwarfCUToModule::LineToModuleHandler {
   dwarf2reader::ByteReader *byte_reader_;
 };
 
+// Parse the compilation unit at OFFSET in the file described by
+// FILE_CONTEXT, populating FILE_CONTEXT->module with the results.
+static void LoadDwarfCU(const string& dwarf_filename,
+                        uint64 offset,
+                        DwarfCUToModule::FileContext* file_context,
+                        DumperLineToModule* line_to_module,
+                        dwarf2reader::ByteReader* byte_reader,
+                        dwarf2reader::CompilationUnit::AbbrevCache*
+                            abbrev_cache) {
+  // Make a handler for the root DIE that populates the module with the
+  // data that was found.
+  DwarfCUToModule::WarningReporter reporter(dwarf_filename, offset);
+  DwarfCUToModule root_handler(file_context, line_to_module, &reporter);
+  // Make a Dwarf2Handler that drives the DIEHandler.
+  dwarf2reader::DIEDispatcher die_dispatcher(&root_handler);
+  // Make a DWARF parser for the compilation unit at OFFSET.
+  dwarf2reader::CompilationUnit reader(file_context->section_map,
+                                       offset,
+                                       byte_reader,
+                                       &die_dispatcher);
+  reader.SetAbbrevCache(abbrev_cache);
+  // Process the entire compilation unit.
+  reader.Start();
+}
+
+// State shared by the threads parsing one file's compilation units.
+// CU parsing is independent except for cross-unit DW_AT_specification
+// references, which each worker resolves through its own FileContext,
+// so the workers only synchronize to claim the next unit.
+struct LoadDwarfCUQueue {
+  string dwarf_filename;
+  bool big_endian;
+  const dwarf2reader::SectionMap* section_map;
+  const std::vector<uint64>* cu_offsets;
+
+  // Index of the next unclaimed entry of |cu_offsets|, guarded by
+  // |mutex|. When |stream_module| is non-NULL the output module is
+  // streaming, and each worker merges and flushes its scratch module
+  // into |stream_module| after every unit, also under |mutex|.
+  size_t next_cu;
+  Module* stream_module;
+  pthread_mutex_t mutex;
+};
+
+// One worker parsing compilation units from a LoadDwarfCUQueue into
+// its own scratch module.
+struct LoadDwarfCUWorker {
+  LoadDwarfCUQueue* queue;
+  Module* module;
+  pthread_t thread;
+};
+
+static void* LoadDwarfCUWorkerMain(void* arg) {
+  LoadDwarfCUWorker* worker = static_cast<LoadDwarfCUWorker*>(arg);
+  LoadDwarfCUQueue* queue = worker->queue;
+
+  const dwarf2reader::Endianness endianness = queue->big_endian ?
+      dwarf2reader::ENDIANNESS_BIG : dwarf2reader::ENDIANNESS_LITTLE;
+  dwarf2reader::ByteReader byte_reader(endianness);
+  DwarfCUToModule::FileContext file_context(queue->dwarf_filename,
+                                            worker->module);
+  file_context.section_map = *queue->section_map;
+  DumperLineToModule line_to_module(&byte_reader);
+  // The cache is per-worker, like the ByteReader, so no locking is
+  // needed; each worker still parses each abbreviation table at most
+  // once instead of once per unit.
+  dwarf2reader::CompilationUnit::AbbrevCache abbrev_cache;
+
+  while (true) {
+    pthread_mutex_lock(&queue->mutex);
+    const size_t index = queue->next_cu++;
+    pthread_mutex_unlock(&queue->mutex);
+    if (index >= queue->cu_offsets->size())
+      return NULL;
+
+    LoadDwarfCU(queue->dwarf_filename, (*queue->cu_offsets)[index],
+                &file_context, &line_to_module, &byte_reader, &abbrev_cache);
+
+    if (queue->stream_module) {
+      // Hand this unit's records to the output module and write them
+      // out now, instead of accumulating them until the join, so that
+      // memory stays bounded to roughly a unit per worker. A write
+      // error here leaves the stream bad; the caller's final flush
+      // reports it.
+      pthread_mutex_lock(&queue->mutex);
+      queue->stream_module->Merge(worker->module);
+      queue->stream_module->FlushStream();
+      pthread_mutex_unlock(&queue->mutex);
+    }
+  }
+}
+
 template<typename ElfClass>
 bool LoadDwarf(const string& dwarf_filename,
                const typename ElfClass::Ehdr* elf_header,
@@ -242,29 +373,93 @@ bool LoadDwarf(const string& dwarf_filename,
     file_context.section_map[name] = std::make_pair(contents, length);
   }
 
-  // Parse all the compilation units in the .debug_info section.
-  DumperLineToModule line_to_module(&byte_reader);
   std::pair<const char *, uint64> debug_info_section
       = file_context.section_map[".debug_info"];
   // This should never have been called if the file doesn't have a
   // .debug_info section.
   assert(debug_info_section.first);
   uint64 debug_info_length = debug_info_section.second;
+
+  // Enumerate the compilation units in the .debug_info section. Only
+  // the initial length field of each header is read here; the units
+  // themselves are parsed below.
+  std::vector<uint64> cu_offsets;
   for (uint64 offset = 0; offset < debug_info_length;) {
-    // Make a handler for the root DIE that populates MODULE with the
-    // data that was found.
-    DwarfCUToModule::WarningReporter reporter(dwarf_filename, offset);
-    DwarfCUToModule root_handler(&file_context, &line_to_module, &reporter);
-    // Make a Dwarf2Handler that drives the DIEHandler.
-    dwarf2reader::DIEDispatcher die_dispatcher(&root_handler);
-    // Make a DWARF parser for the compilation unit at OFFSET.
-    dwarf2reader::CompilationUnit reader(file_context.section_map,
-                                         offset,
-                                         &byte_reader,
-                                         &die_dispatcher);
-    // Process the entire compilation unit; get the offset of the next.
-    offset += reader.Start();
+    cu_offsets.push_back(offset);
+    size_t initial_length_size;
+    const uint64 cu_length = byte_reader.ReadInitialLength(
+        debug_info_section.first + offset, &initial_length_size);
+    offset += cu_length + initial_length_size;
+  }
+
+  long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_threads > static_cast<long>(cu_offsets.size()))
+    num_threads = cu_offsets.size();
+
+  if (num_threads <= 1) {
+    // Parse the compilation units serially, straight into MODULE.
+    DumperLineToModule line_to_module(&byte_reader);
+    dwarf2reader::CompilationUnit::AbbrevCache abbrev_cache;
+    for (size_t i = 0; i < cu_offsets.size(); i++) {
+      LoadDwarfCU(dwarf_filename, cu_offsets[i], &file_context,
+                  &line_to_module, &byte_reader, &abbrev_cache);
+      if (module->IsStreaming() && !module->FlushStream())
+        return false;
+    }
+    return true;
+  }
+
+  // Parse independent compilation units on a pool of worker threads,
+  // each populating a scratch module, and merge the results into
+  // MODULE once all the workers have finished. Output is deterministic
+  // regardless of which worker parses which unit: the module keeps its
+  // contents sorted, and duplicates are dropped on insertion. (When
+  // MODULE is streaming, the workers instead merge and flush after
+  // every unit, so record order follows unit completion order.)
+  LoadDwarfCUQueue queue;
+  queue.dwarf_filename = dwarf_filename;
+  queue.big_endian = big_endian;
+  queue.section_map = &file_context.section_map;
+  queue.cu_offsets = &cu_offsets;
+  queue.next_cu = 0;
+  queue.stream_module = module->IsStreaming() ? module : NULL;
+  pthread_mutex_init(&queue.mutex, NULL);
+
+  std::vector<LoadDwarfCUWorker> workers(num_threads);
+  for (long i = 0; i < num_threads; i++) {
+    workers[i].queue = &queue;
+    workers[i].module = new Module(module->name(), module->os(),
+                                   module->architecture(),
+                                   module->identifier());
+    if (pthread_create(&workers[i].thread, NULL,
+                       LoadDwarfCUWorkerMain, &workers[i])) {
+      // Thread creation failed; have this worker's units parsed by the
+      // others (or, if none started, fall through to the merge with
+      // the queue untouched and parse serially below).
+      delete workers[i].module;
+      workers.resize(i);
+      break;
+    }
   }
+
+  for (size_t i = 0; i < workers.size(); i++) {
+    pthread_join(workers[i].thread, NULL);
+    module->Merge(workers[i].module);
+    delete workers[i].module;
+  }
+  pthread_mutex_destroy(&queue.mutex);
+
+  if (workers.empty()) {
+    DumperLineToModule line_to_module(&byte_reader);
+    dwarf2reader::CompilationUnit::AbbrevCache abbrev_cache;
+    for (size_t i = 0; i < cu_offsets.size(); i++) {
+      LoadDwarfCU(dwarf_filename, cu_offsets[i], &file_context,
+                  &line_to_module, &byte_reader, &abbrev_cache);
+      if (module->IsStreaming() && !module->FlushStream())
+        return false;
+    }
+  }
+
   return true;
 }
 
@@ -291,12 +486,77 @@ bool DwarfCFIRegisterNames(const typename ElfClass::Ehdr* elf_header,
   }
 }
 
+// The FDEs of one .debug_frame or .eh_frame section are independent
+// given their CIEs, so LoadDwarfCFI splits a large section's FDEs
+// into contiguous offset ranges and interprets each range on its own
+// thread. The workers share only the read-only section contents:
+// each builds its own ByteReader, parser, and handler, parses the
+// handful of CIEs its FDEs cite itself (once each, cached by its
+// parser), and records its range's entries in its own scratch
+// module.
+struct LoadDwarfCFIShard {
+  // The section being converted and how to read it; identical in
+  // every shard.
+  string dwarf_filename;
+  const char* section_name;
+  const char* cfi;
+  size_t cfi_size;
+  bool eh_frame;
+  dwarf2reader::Endianness endianness;
+  uint8_t address_size;
+  uint64 cfi_address;
+  bool has_data_base;
+  uint64 data_base;
+  bool has_text_base;
+  uint64 text_base;
+  const std::vector<string>* register_names;
+
+  // The FDE offsets this shard interprets: the entries [begin, end)
+  // of *fde_offsets.
+  const std::vector<size_t>* fde_offsets;
+  size_t begin;
+  size_t end;
+
+  // The shard's scratch module.
+  Module* module;
+  pthread_t thread;
+};
+
+static void* LoadDwarfCFIShardMain(void* arg) {
+  LoadDwarfCFIShard* shard = static_cast<LoadDwarfCFIShard*>(arg);
+
+  dwarf2reader::ByteReader byte_reader(shard->endianness);
+  byte_reader.SetAddressSize(shard->address_size);
+  byte_reader.SetCFIDataBase(shard->cfi_address, shard->cfi);
+  if (shard->has_data_base)
+    byte_reader.SetDataBase(shard->data_base);
+  if (shard->has_text_base)
+    byte_reader.SetTextBase(shard->text_base);
+
+  DwarfCFIToModule::Reporter module_reporter(shard->dwarf_filename,
+                                             shard->section_name);
+  DwarfCFIToModule handler(shard->module, *shard->register_names,
+                           &module_reporter);
+  dwarf2reader::CallFrameInfo::Reporter dwarf_reporter(shard->dwarf_filename,
+                                                       shard->section_name);
+  // The parser spans the whole section, not just this shard's range,
+  // so that the FDEs' CIE pointers still resolve.
+  dwarf2reader::CallFrameInfo parser(shard->cfi, shard->cfi_size,
+                                     &byte_reader, &handler, &dwarf_reporter,
+                                     shard->eh_frame);
+  for (size_t i = shard->begin; i < shard->end; i++)
+    parser.ProcessEntryAt((*shard->fde_offsets)[i]);
+
+  return NULL;
+}
+
 template<typename ElfClass>
 bool LoadDwarfCFI(const string& dwarf_filename,
                   const typename ElfClass::Ehdr* elf_header,
                   const char* section_name,
                   const typename ElfClass::Shdr* section,
                   const bool eh_frame,
+                  const typename ElfClass::Shdr* eh_frame_hdr_section,
                   const typename ElfClass::Shdr* got_section,
                   const typename ElfClass::Shdr* text_section,
                   const bool big_endian,
@@ -339,6 +599,87 @@ bool LoadDwarfCFI(const string& dwarf_filename,
   dwarf2reader::CallFrameInfo parser(cfi, cfi_size,
                                      &byte_reader, &handler, &dwarf_reporter,
                                      eh_frame);
+
+  // When the section holds enough FDEs for the thread plumbing to pay
+  // for itself, enumerate them and interpret contiguous ranges on
+  // worker threads. The scratch modules are merged into MODULE in
+  // shard order --- section order --- and the merged records then
+  // sorted, so they come out in ascending address order whichever
+  // shard produced them.
+  static const size_t kMinFDEsPerShard = 4096;
+  std::vector<size_t> fde_offsets;
+  long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_threads > 1 && parser.EnumerateFDEOffsets(&fde_offsets)) {
+    if (num_threads > static_cast<long>(fde_offsets.size() / kMinFDEsPerShard))
+      num_threads = fde_offsets.size() / kMinFDEsPerShard;
+    if (num_threads > 1) {
+      const size_t shard_size =
+          (fde_offsets.size() + num_threads - 1) / num_threads;
+      std::vector<LoadDwarfCFIShard> shards(num_threads);
+      for (long i = 0; i < num_threads; i++) {
+        LoadDwarfCFIShard &shard = shards[i];
+        shard.dwarf_filename = dwarf_filename;
+        shard.section_name = section_name;
+        shard.cfi = cfi;
+        shard.cfi_size = cfi_size;
+        shard.eh_frame = eh_frame;
+        shard.endianness = endianness;
+        shard.address_size = ElfClass::kAddrSize;
+        shard.cfi_address = section->sh_addr;
+        shard.has_data_base = got_section != NULL;
+        shard.data_base = got_section ? got_section->sh_addr : 0;
+        shard.has_text_base = text_section != NULL;
+        shard.text_base = text_section ? text_section->sh_addr : 0;
+        shard.register_names = &register_names;
+        shard.fde_offsets = &fde_offsets;
+        shard.begin = i * shard_size;
+        shard.end = shard.begin + shard_size;
+        if (shard.end > fde_offsets.size())
+          shard.end = fde_offsets.size();
+        shard.module = new Module(module->name(), module->os(),
+                                  module->architecture(),
+                                  module->identifier());
+      }
+
+      size_t started = 0;
+      while (started < shards.size()) {
+        if (pthread_create(&shards[started].thread, NULL,
+                           LoadDwarfCFIShardMain, &shards[started]))
+          break;
+        started++;
+      }
+      // Shards whose thread could not be started are interpreted
+      // here, on the calling thread.
+      for (size_t i = started; i < shards.size(); i++)
+        LoadDwarfCFIShardMain(&shards[i]);
+
+      for (size_t i = 0; i < shards.size(); i++) {
+        if (i < started)
+          pthread_join(shards[i].thread, NULL);
+        module->Merge(shards[i].module);
+        delete shards[i].module;
+      }
+      // Shard order is section order, which the linker does not
+      // guarantee is address order; sort so the merged records come
+      // out exactly as the .eh_frame_hdr path below would emit them.
+      module->SortStackFrameEntries();
+      return true;
+    }
+  }
+
+  // If the linker left an .eh_frame_hdr search table, use it to visit
+  // the section's FDEs directly instead of scanning the whole section
+  // entry by entry. An unusable header makes no handler calls, so
+  // falling back to the scan cannot produce duplicate records.
+  if (eh_frame && eh_frame_hdr_section) {
+    const char* hdr =
+        GetOffset<ElfClass, char>(elf_header, eh_frame_hdr_section->sh_offset);
+    if (parser.StartFromEhFrameHdr(hdr, eh_frame_hdr_section->sh_size,
+                                   eh_frame_hdr_section->sh_addr,
+                                   section->sh_addr, 0, 0))
+      return true;
+  }
+
   parser.Start();
   return true;
 }
@@ -515,6 +856,87 @@ class LoadSymbolsInfo {
                                       // between calls to LoadSymbols().
 };
 
+// The STABS and CFI passes of LoadSymbols are independent of the
+// DWARF pass, so when a binary carries several kinds of debugging
+// information, each kind is parsed into its own scratch module on its
+// own thread while the DWARF pass keeps the calling thread busy; the
+// scratch modules are merged once every stage has joined. Each stage
+// struct holds one stage's inputs and its result.
+template<typename ElfClass>
+struct LoadStabsStage {
+  const typename ElfClass::Ehdr* elf_header;
+  const typename ElfClass::Shdr* stab_section;
+  const typename ElfClass::Shdr* stabstr_section;
+  bool big_endian;
+  Module* module;
+  bool result;
+  pthread_t thread;
+};
+
+template<typename ElfClass>
+void* LoadStabsStageMain(void* arg) {
+  LoadStabsStage<ElfClass>* stage =
+      static_cast<LoadStabsStage<ElfClass>*>(arg);
+  SectionPageAdvisor stab_advisor(
+      GetOffset<ElfClass, char>(stage->elf_header,
+                                stage->stab_section->sh_offset),
+      stage->stab_section->sh_size);
+  SectionPageAdvisor stabstr_advisor(
+      GetOffset<ElfClass, char>(stage->elf_header,
+                                stage->stabstr_section->sh_offset),
+      stage->stabstr_section->sh_size);
+  stage->result = LoadStabs<ElfClass>(stage->elf_header, stage->stab_section,
+                                      stage->stabstr_section,
+                                      stage->big_endian, stage->module);
+  return NULL;
+}
+
+template<typename ElfClass>
+struct LoadCFIStage {
+  const string* obj_file;
+  const typename ElfClass::Ehdr* elf_header;
+  const typename ElfClass::Shdr* debug_frame_section;
+  const typename ElfClass::Shdr* eh_frame_section;
+  const typename ElfClass::Shdr* eh_frame_hdr_section;
+  const typename ElfClass::Shdr* got_section;
+  const typename ElfClass::Shdr* text_section;
+  bool big_endian;
+  Module* module;
+  bool result;
+  pthread_t thread;
+};
+
+template<typename ElfClass>
+void* LoadCFIStageMain(void* arg) {
+  LoadCFIStage<ElfClass>* stage = static_cast<LoadCFIStage<ElfClass>*>(arg);
+  stage->result = false;
+  if (stage->debug_frame_section) {
+    SectionPageAdvisor cfi_advisor(
+        GetOffset<ElfClass, char>(stage->elf_header,
+                                  stage->debug_frame_section->sh_offset),
+        stage->debug_frame_section->sh_size);
+    stage->result =
+        LoadDwarfCFI<ElfClass>(*stage->obj_file, stage->elf_header,
+                               ".debug_frame", stage->debug_frame_section,
+                               false, 0, 0, 0, stage->big_endian,
+                               stage->module) || stage->result;
+  }
+  if (stage->eh_frame_section) {
+    SectionPageAdvisor eh_frame_advisor(
+        GetOffset<ElfClass, char>(stage->elf_header,
+                                  stage->eh_frame_section->sh_offset),
+        stage->eh_frame_section->sh_size);
+    stage->result =
+        LoadDwarfCFI<ElfClass>(*stage->obj_file, stage->elf_header,
+                               ".eh_frame", stage->eh_frame_section, true,
+                               stage->eh_frame_hdr_section,
+                               stage->got_section, stage->text_section,
+                               stage->big_endian,
+                               stage->module) || stage->result;
+  }
+  return NULL;
+}
+
 template<typename ElfClass>
 bool LoadSymbols(const string& obj_file,
                  const bool big_endian,
@@ -539,90 +961,152 @@ bool LoadSymbols(const string& obj_file,
   const char* names =
       GetOffset<ElfClass, char>(elf_header, section_names->sh_offset);
   const char *names_end = names + section_names->sh_size;
+  // Index the section table up front; -ffunction-sections builds can
+  // carry hundreds of thousands of sections, and the lookups below
+  // would each scan the whole table otherwise.
+  ElfSectionIndex<ElfClass> section_index(sections, names, names_end,
+                                          elf_header->e_shnum);
   bool found_debug_info_section = false;
   bool found_usable_info = false;
 
-  if (symbol_data != ONLY_CFI) {
+  // Find each kind of debugging information up front; the independent
+  // kinds are parsed as concurrent stages below.
+  const Shdr* stab_section = NULL;
+  const Shdr* stabstr_section = NULL;
 #ifndef NO_STABS_SUPPORT
-    // Look for STABS debugging information, and load it if present.
-    const Shdr* stab_section =
-      FindElfSectionByName<ElfClass>(".stab", SHT_PROGBITS,
-                                     sections, names, names_end,
-                                     elf_header->e_shnum);
-    if (stab_section) {
-      const Shdr* stabstr_section = stab_section->sh_link + sections;
-      if (stabstr_section) {
-        found_debug_info_section = true;
-        found_usable_info = true;
-        info->LoadedSection(".stab");
-        if (!LoadStabs<ElfClass>(elf_header, stab_section, stabstr_section,
-                                 big_endian, module)) {
-          fprintf(stderr, "%s: \".stab\" section found, but failed to load"
-                  " STABS debugging information\n", obj_file.c_str());
-        }
-      }
-    }
+  if (symbol_data != ONLY_CFI) {
+    // Look for STABS debugging information.
+    stab_section = section_index.Find(".stab", SHT_PROGBITS);
+    if (stab_section)
+      stabstr_section = stab_section->sh_link + sections;
+  }
 #endif  // NO_STABS_SUPPORT
 
-    // Look for DWARF debugging information, and load it if present.
-    const Shdr* dwarf_section =
-      FindElfSectionByName<ElfClass>(".debug_info", SHT_PROGBITS,
-                                     sections, names, names_end,
-                                     elf_header->e_shnum);
-    if (dwarf_section) {
-      found_debug_info_section = true;
-      found_usable_info = true;
-      info->LoadedSection(".debug_info");
-      if (!LoadDwarf<ElfClass>(obj_file, elf_header, big_endian, module))
-        fprintf(stderr, "%s: \".debug_info\" section found, but failed to load "
-                "DWARF debugging information\n", obj_file.c_str());
-    }
+  // Look for DWARF debugging information.
+  const Shdr* dwarf_section = NULL;
+  if (symbol_data != ONLY_CFI) {
+    dwarf_section = section_index.Find(".debug_info", SHT_PROGBITS);
   }
 
+  // Dwarf Call Frame Information (CFI) is actually independent from
+  // the other DWARF debugging information, and can be used alone.
+  // Linux C++ exception handling information can also provide
+  // unwinding data.
+  const Shdr* dwarf_cfi_section = NULL;
+  const Shdr* eh_frame_section = NULL;
+  const Shdr* eh_frame_hdr_section = NULL;
+  const Shdr* got_section = NULL;
+  const Shdr* text_section = NULL;
   if (symbol_data != NO_CFI) {
-    // Dwarf Call Frame Information (CFI) is actually independent from
-    // the other DWARF debugging information, and can be used alone.
-    const Shdr* dwarf_cfi_section =
-        FindElfSectionByName<ElfClass>(".debug_frame", SHT_PROGBITS,
-                                       sections, names, names_end,
-                                       elf_header->e_shnum);
-    if (dwarf_cfi_section) {
-      // Ignore the return value of this function; even without call frame
-      // information, the other debugging information could be perfectly
-      // useful.
-      info->LoadedSection(".debug_frame");
-      bool result =
-          LoadDwarfCFI<ElfClass>(obj_file, elf_header, ".debug_frame",
-                                 dwarf_cfi_section, false, 0, 0, big_endian,
-                                 module);
-      found_usable_info = found_usable_info || result;
-    }
-
-    // Linux C++ exception handling information can also provide
-    // unwinding data.
-    const Shdr* eh_frame_section =
-        FindElfSectionByName<ElfClass>(".eh_frame", SHT_PROGBITS,
-                                       sections, names, names_end,
-                                       elf_header->e_shnum);
+    dwarf_cfi_section = section_index.Find(".debug_frame", SHT_PROGBITS);
+    eh_frame_section = section_index.Find(".eh_frame", SHT_PROGBITS);
     if (eh_frame_section) {
       // Pointers in .eh_frame data may be relative to the base addresses of
       // certain sections. Provide those sections if present.
-      const Shdr* got_section =
-          FindElfSectionByName<ElfClass>(".got", SHT_PROGBITS,
-                                         sections, names, names_end,
-                                         elf_header->e_shnum);
-      const Shdr* text_section =
-          FindElfSectionByName<ElfClass>(".text", SHT_PROGBITS,
-                                         sections, names, names_end,
-                                         elf_header->e_shnum);
+      got_section = section_index.Find(".got", SHT_PROGBITS);
+      text_section = section_index.Find(".text", SHT_PROGBITS);
+      // The linker's FDE search table, if present, lets us index the
+      // section instead of scanning it.
+      eh_frame_hdr_section =
+          section_index.Find(".eh_frame_hdr", SHT_PROGBITS);
+    }
+  }
+
+  // Start the STABS and CFI stages on their own threads when another
+  // pass will keep this thread busy anyway. If a thread cannot be
+  // started, the stage simply runs on this thread after the DWARF
+  // pass; either way the stage's scratch module is merged below.
+#ifndef NO_STABS_SUPPORT
+  LoadStabsStage<ElfClass> stabs_stage;
+  bool stabs_stage_started = false;
+  if (stab_section && stabstr_section) {
+    found_debug_info_section = true;
+    found_usable_info = true;
+    info->LoadedSection(".stab");
+    stabs_stage.elf_header = elf_header;
+    stabs_stage.stab_section = stab_section;
+    stabs_stage.stabstr_section = stabstr_section;
+    stabs_stage.big_endian = big_endian;
+    stabs_stage.module = new Module(module->name(), module->os(),
+                                    module->architecture(),
+                                    module->identifier());
+    stabs_stage.result = false;
+    stabs_stage_started = dwarf_section &&
+        pthread_create(&stabs_stage.thread, NULL,
+                       LoadStabsStageMain<ElfClass>, &stabs_stage) == 0;
+  }
+#endif  // NO_STABS_SUPPORT
+
+  LoadCFIStage<ElfClass> cfi_stage;
+  bool cfi_stage_started = false;
+  if (dwarf_cfi_section || eh_frame_section) {
+    if (dwarf_cfi_section)
+      info->LoadedSection(".debug_frame");
+    if (eh_frame_section)
       info->LoadedSection(".eh_frame");
-      // As above, ignore the return value of this function.
-      bool result =
-          LoadDwarfCFI<ElfClass>(obj_file, elf_header, ".eh_frame",
-                                 eh_frame_section, true,
-                                 got_section, text_section, big_endian, module);
-      found_usable_info = found_usable_info || result;
+    cfi_stage.obj_file = &obj_file;
+    cfi_stage.elf_header = elf_header;
+    cfi_stage.debug_frame_section = dwarf_cfi_section;
+    cfi_stage.eh_frame_section = eh_frame_section;
+    cfi_stage.eh_frame_hdr_section = eh_frame_hdr_section;
+    cfi_stage.got_section = got_section;
+    cfi_stage.text_section = text_section;
+    cfi_stage.big_endian = big_endian;
+    cfi_stage.module = new Module(module->name(), module->os(),
+                                  module->architecture(),
+                                  module->identifier());
+    cfi_stage.result = false;
+    cfi_stage_started = (dwarf_section || stab_section) &&
+        pthread_create(&cfi_stage.thread, NULL,
+                       LoadCFIStageMain<ElfClass>, &cfi_stage) == 0;
+  }
+
+  if (dwarf_section) {
+    found_debug_info_section = true;
+    found_usable_info = true;
+    info->LoadedSection(".debug_info");
+    // Hint the two largest inputs of the DWARF parse; the remaining
+    // .debug_* sections are small by comparison.
+    SectionPageAdvisor dwarf_advisor(
+        GetOffset<ElfClass, char>(elf_header, dwarf_section->sh_offset),
+        dwarf_section->sh_size);
+    const Shdr* line_section =
+        section_index.Find(".debug_line", SHT_PROGBITS);
+    SectionPageAdvisor line_advisor(
+        line_section ?
+            GetOffset<ElfClass, char>(elf_header, line_section->sh_offset) :
+            NULL,
+        line_section ? line_section->sh_size : 0);
+    if (!LoadDwarf<ElfClass>(obj_file, elf_header, big_endian, module))
+      fprintf(stderr, "%s: \".debug_info\" section found, but failed to load "
+              "DWARF debugging information\n", obj_file.c_str());
+  }
+
+#ifndef NO_STABS_SUPPORT
+  if (stab_section && stabstr_section) {
+    if (stabs_stage_started)
+      pthread_join(stabs_stage.thread, NULL);
+    else
+      LoadStabsStageMain<ElfClass>(&stabs_stage);
+    if (!stabs_stage.result) {
+      fprintf(stderr, "%s: \".stab\" section found, but failed to load"
+              " STABS debugging information\n", obj_file.c_str());
     }
+    module->Merge(stabs_stage.module);
+    delete stabs_stage.module;
+  }
+#endif  // NO_STABS_SUPPORT
+
+  if (dwarf_cfi_section || eh_frame_section) {
+    if (cfi_stage_started)
+      pthread_join(cfi_stage.thread, NULL);
+    else
+      LoadCFIStageMain<ElfClass>(&cfi_stage);
+    // Ignore a failed CFI parse; even without call frame information,
+    // the other debugging information could be perfectly useful.
+    found_usable_info = found_usable_info || cfi_stage.result;
+    module->Merge(cfi_stage.module);
+    delete cfi_stage.module;
   }
 
   if (!found_debug_info_section) {
@@ -633,9 +1117,7 @@ bool LoadSymbols(const string& obj_file,
     // Failed, but maybe there's a .gnu_debuglink section?
     if (read_gnu_debug_link) {
       const Shdr* gnu_debuglink_section
-          = FindElfSectionByName<ElfClass>(".gnu_debuglink", SHT_PROGBITS,
-                                           sections, names,
-                                           names_end, elf_header->e_shnum);
+          = section_index.Find(".gnu_debuglink", SHT_PROGBITS);
       if (gnu_debuglink_section) {
         if (!info->debug_dirs().empty()) {
           const char* debuglink_contents =
@@ -659,13 +1141,9 @@ bool LoadSymbols(const string& obj_file,
         // The caller doesn't want to consult .gnu_debuglink.
         // See if there are export symbols available.
         const Shdr* dynsym_section =
-          FindElfSectionByName<ElfClass>(".dynsym", SHT_DYNSYM,
-                                         sections, names, names_end,
-                                         elf_header->e_shnum);
+          section_index.Find(".dynsym", SHT_DYNSYM);
         const Shdr* dynstr_section =
-          FindElfSectionByName<ElfClass>(".dynstr", SHT_STRTAB,
-                                         sections, names, names_end,
-                                         elf_header->e_shnum);
+          section_index.Find(".dynstr", SHT_STRTAB);
         if (dynsym_section && dynstr_section) {
           info->LoadedSection(".dynsym");
 
@@ -754,6 +1232,7 @@ bool ReadSymbolDataElfClass(const typename ElfClass::Ehdr* elf_header,
                              const string& obj_filename,
                              const std::vector<string>& debug_dirs,
                              SymbolData symbol_data,
+                             std::ostream* sym_stream,
                              Module** out_module) {
   typedef typename ElfClass::Ehdr Ehdr;
   typedef typename ElfClass::Shdr Shdr;
@@ -786,6 +1265,11 @@ bool ReadSymbolDataElfClass(const typename ElfClass::Ehdr* elf_header,
 
   LoadSymbolsInfo<ElfClass> info(debug_dirs);
   scoped_ptr<Module> module(new Module(name, os, architecture, id));
+  // When the caller supplied an output stream, emit records as the
+  // debugging information is read rather than accumulating the whole
+  // module; this writes the MODULE header now.
+  if (sym_stream && !module->StartWritingStream(*sym_stream, symbol_data))
+    return false;
   if (!LoadSymbols<ElfClass>(obj_filename, big_endian, elf_header,
                              !debug_dirs.empty(), &info,
                              symbol_data, module.get())) {
@@ -836,15 +1320,34 @@ bool ReadSymbolDataElfClass(const typename ElfClass::Ehdr* elf_header,
   return true;
 }
 
+// Set IDENTIFIER to the formatted debug identifier of ELF_HEADER.
+template<typename ElfClass>
+bool ReadIdentifierElfClass(const typename ElfClass::Ehdr* elf_header,
+                            const string& obj_filename,
+                            string* identifier) {
+  unsigned char identifier_bytes[16];
+  if (!google_breakpad::FileID::ElfFileIdentifierFromMappedFile(
+          elf_header, identifier_bytes)) {
+    fprintf(stderr, "%s: unable to generate file identifier\n",
+            obj_filename.c_str());
+    return false;
+  }
+  *identifier = FormatIdentifier(identifier_bytes);
+  return true;
+}
+
 }  // namespace
 
 namespace google_breakpad {
 
 // Not explicitly exported, but not static so it can be used in unit tests.
+// If SYM_STREAM is non-NULL, the returned module streams its records to it
+// as they are read; see WriteSymbolFileStreaming.
 bool ReadSymbolDataInternal(const uint8_t* obj_file,
                             const string& obj_filename,
                             const std::vector<string>& debug_dirs,
                             SymbolData symbol_data,
+                            std::ostream* sym_stream,
                             Module** module) {
 
   if (!IsValidElf(obj_file)) {
@@ -856,12 +1359,12 @@ bool ReadSymbolDataInternal(const uint8_t* obj_file,
   if (elfclass == ELFCLASS32) {
     return ReadSymbolDataElfClass<ElfClass32>(
         reinterpret_cast<const Elf32_Ehdr*>(obj_file), obj_filename, debug_dirs,
-        symbol_data, module);
+        symbol_data, sym_stream, module);
   }
   if (elfclass == ELFCLASS64) {
     return ReadSymbolDataElfClass<ElfClass64>(
         reinterpret_cast<const Elf64_Ehdr*>(obj_file), obj_filename, debug_dirs,
-        symbol_data, module);
+        symbol_data, sym_stream, module);
   }
 
   return false;
@@ -880,6 +1383,29 @@ bool WriteSymbolFile(const string &obj_file,
   return result;
 }
 
+bool WriteSymbolFileStreaming(const string &obj_file,
+                              const std::vector<string>& debug_dirs,
+                              SymbolData symbol_data,
+                              std::ostream &sym_stream) {
+  MmapWrapper map_wrapper;
+  void* elf_header = NULL;
+  if (!LoadELF(obj_file, &map_wrapper, &elf_header))
+    return false;
+
+  Module* module;
+  if (!ReadSymbolDataInternal(reinterpret_cast<uint8_t*>(elf_header),
+                              obj_file, debug_dirs, symbol_data,
+                              &sym_stream, &module))
+    return false;
+
+  // Compilation units were flushed as they were read; this writes out
+  // whatever arrived after the last unit - the externs, the CFI
+  // records, and anything from loaders that do not flush as they go.
+  bool result = module->FlushStream();
+  delete module;
+  return result;
+}
+
 bool ReadSymbolData(const string& obj_file,
                     const std::vector<string>& debug_dirs,
                     SymbolData symbol_data,
@@ -890,7 +1416,33 @@ bool ReadSymbolData(const string& obj_file,
     return false;
 
   return ReadSymbolDataInternal(reinterpret_cast<uint8_t*>(elf_header),
-                                obj_file, debug_dirs, symbol_data, module);
+                                obj_file, debug_dirs, symbol_data,
+                                NULL, module);
+}
+
+bool ReadModuleIdentifier(const string& obj_file, string* identifier) {
+  MmapWrapper map_wrapper;
+  void* elf_header = NULL;
+  if (!LoadELF(obj_file, &map_wrapper, &elf_header))
+    return false;
+
+  const uint8_t* obj = reinterpret_cast<uint8_t*>(elf_header);
+  if (!IsValidElf(obj)) {
+    fprintf(stderr, "Not a valid ELF file: %s\n", obj_file.c_str());
+    return false;
+  }
+
+  int elfclass = ElfClass(obj);
+  if (elfclass == ELFCLASS32) {
+    return ReadIdentifierElfClass<ElfClass32>(
+        reinterpret_cast<const Elf32_Ehdr*>(obj), obj_file, identifier);
+  }
+  if (elfclass == ELFCLASS64) {
+    return ReadIdentifierElfClass<ElfClass64>(
+        reinterpret_cast<const Elf64_Ehdr*>(obj), obj_file, identifier);
+  }
+
+  return false;
 }
 
 }  // namespace google_breakpad
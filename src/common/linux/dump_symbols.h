@@ -57,6 +57,19 @@ bool WriteSymbolFile(const string &obj_file,
                      SymbolData symbol_data,
                      std::ostream &sym_stream);
 
+// As above, but write each record to SYM_STREAM as soon as its
+// compilation unit has been read, instead of accumulating the whole
+// module in memory first. This bounds memory to roughly one
+// compilation unit at a time (plus the module's file and name
+// tables), at a cost in output order: FILE and FUNC records appear in
+// the order their units finish rather than sorted by name and
+// address, and a function present in several units may produce a
+// repeated FUNC record.
+bool WriteSymbolFileStreaming(const string &obj_file,
+                              const std::vector<string>& debug_dirs,
+                              SymbolData symbol_data,
+                              std::ostream &sym_stream);
+
 // As above, but simply return the debugging information in MODULE
 // instead of writing it to a stream. The caller owns the resulting
 // Module object and must delete it when finished.
@@ -65,6 +78,14 @@ bool ReadSymbolData(const string& obj_file,
                     SymbolData symbol_data,
                     Module** module);
 
+// Set IDENTIFIER to OBJ_FILE's debug identifier, formatted as it
+// appears in the MODULE record of the symbol file WriteSymbolFile
+// would produce. This only maps the file and hashes its identifying
+// bits --- no DWARF is parsed --- so it is cheap enough to use as a
+// cache key for deciding whether a previously converted symbol file
+// is still current.
+bool ReadModuleIdentifier(const string& obj_file, string* identifier);
+
 }  // namespace google_breakpad
 
 #endif  // COMMON_LINUX_DUMP_SYMBOLS_H__
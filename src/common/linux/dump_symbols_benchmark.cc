@@ -0,0 +1,456 @@
+// Copyright (c) 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// dump_symbols_benchmark.cc: Measure symbol dumping performance on
+// synthetic ELF binaries.
+//
+// This harness fabricates x86-64 ELF files with synth_elf, sweeping
+// compilation unit count, DIE nesting depth, line table size and call
+// frame information density, and runs WriteSymbolFile over each one,
+// reporting wall time and input bytes per second for the DWARF
+// debugging information pass, the CFI pass, and the two combined,
+// along with the process's peak resident set size.  Because the
+// inputs are synthesized, results are exactly reproducible from one
+// build to the next, which makes the numbers suitable for catching
+// performance regressions in the symbol pipeline at review time.
+//
+// The passes are separated through the SymbolData argument that
+// dump_syms itself exposes: NO_CFI exercises the .debug_info and
+// .debug_line readers, ONLY_CFI exercises the .debug_frame reader,
+// and ALL_SYMBOL_DATA runs the full pipeline.
+
+#include <assert.h>
+#include <elf.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/dwarf/cfi_assembler.h"
+#include "common/dwarf/dwarf2enums.h"
+#include "common/dwarf/dwarf2reader_test_common.h"
+#include "common/linux/dump_symbols.h"
+#include "common/linux/synth_elf.h"
+#include "common/test_assembler.h"
+#include "common/using_std_string.h"
+
+namespace {
+
+using std::vector;
+using google_breakpad::CFISection;
+using google_breakpad::WriteSymbolFile;
+using google_breakpad::synth_elf::ELF;
+using google_breakpad::test_assembler::Label;
+using google_breakpad::test_assembler::Section;
+using google_breakpad::test_assembler::kLittleEndian;
+
+// One point in the parameter sweep.
+struct BenchmarkConfig {
+  unsigned int cu_count;         // compilation units in .debug_info
+  unsigned int functions_per_cu; // subprogram DIEs per unit
+  unsigned int die_depth;        // lexical blocks nested in each function
+  unsigned int line_rows_per_cu; // rows in each unit's line number program
+  unsigned int cfi_rule_changes; // rule changes in each function's FDE
+};
+
+// The default corpus, from a binary smaller than anything seen in
+// production up to one larger than the common case in every dimension.
+const BenchmarkConfig kDefaultCorpus[] = {
+  {   4,  16, 1,   64, 1 },
+  {  32,  64, 2,  256, 2 },
+  { 128,  64, 4, 1024, 4 },
+  { 512, 128, 8, 4096, 8 },
+};
+
+// Synthetic address space layout. Functions are kFunctionSize bytes
+// apart, and each unit covers its functions contiguously.
+const uint64_t kTextAddress = 0x400000;
+const uint64_t kFunctionSize = 0x100;
+
+static uint64_t NowMicroseconds() {
+  struct timeval time_now;
+  gettimeofday(&time_now, NULL);
+  return static_cast<uint64_t>(time_now.tv_sec) * 1000000 + time_now.tv_usec;
+}
+
+// Returns the peak resident set size of this process in kilobytes, or 0
+// where the measurement is unavailable.
+static uint64_t PeakResidentKB() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    return static_cast<uint64_t>(usage.ru_maxrss);
+  }
+  return 0;
+}
+
+// The lowest text address belonging to unit cu_index.
+static uint64_t UnitLowPC(const BenchmarkConfig &config,
+                          unsigned int cu_index) {
+  return kTextAddress +
+      static_cast<uint64_t>(cu_index) * config.functions_per_cu *
+      kFunctionSize;
+}
+
+// Append a DWARF 2 line number program for unit cu_index to
+// debug_line, with config.line_rows_per_cu rows spread over the
+// unit's text range. Returns the program's offset within the section,
+// for the unit's DW_AT_stmt_list.
+static size_t AppendLineProgram(const BenchmarkConfig &config,
+                                unsigned int cu_index,
+                                Section *debug_line) {
+  size_t program_offset = debug_line->Size();
+
+  Label unit_length, header_length;
+  debug_line->D32(unit_length);
+  size_t post_length_offset = debug_line->Size();
+  debug_line->D16(2);  // DWARF version
+  debug_line->D32(header_length);
+  size_t post_header_length_offset = debug_line->Size();
+  debug_line->D8(1);     // minimum instruction length
+  debug_line->D8(1);     // default is_stmt
+  debug_line->D8(0xfb);  // line base: -5
+  debug_line->D8(14);    // line range
+  debug_line->D8(10);    // opcode base
+  // Standard opcode argument counts, DW_LNS_copy through
+  // DW_LNS_fixed_advance_pc.
+  static const uint8_t opcode_lengths[] = { 0, 1, 1, 1, 1, 0, 0, 0, 1 };
+  for (size_t i = 0; i < sizeof(opcode_lengths); ++i)
+    debug_line->D8(opcode_lengths[i]);
+  debug_line->D8(0);  // end of include directories
+  char file_name[32];
+  snprintf(file_name, sizeof(file_name), "cu_%u.c", cu_index);
+  debug_line->AppendCString(file_name);
+  debug_line->ULEB128(0);  // directory index
+  debug_line->ULEB128(0);  // modification time
+  debug_line->ULEB128(0);  // file length
+  debug_line->D8(0);       // end of file names
+  header_length = debug_line->Size() - post_header_length_offset;
+
+  // DW_LNE_set_address, then one copy per row, advancing the address
+  // so the rows stay inside the unit's functions.
+  uint64_t advance_pc =
+      static_cast<uint64_t>(config.functions_per_cu) * kFunctionSize /
+      (config.line_rows_per_cu + 1);
+  if (advance_pc == 0)
+    advance_pc = 1;
+  debug_line->D8(0);
+  debug_line->ULEB128(9);
+  debug_line->D8(dwarf2reader::DW_LNE_set_address);
+  debug_line->D64(UnitLowPC(config, cu_index));
+  for (unsigned int row = 0; row < config.line_rows_per_cu; ++row) {
+    debug_line->D8(dwarf2reader::DW_LNS_advance_line);
+    debug_line->LEB128(1);
+    debug_line->D8(dwarf2reader::DW_LNS_advance_pc);
+    debug_line->ULEB128(advance_pc);
+    debug_line->D8(dwarf2reader::DW_LNS_copy);
+  }
+  debug_line->D8(0);  // DW_LNE_end_sequence
+  debug_line->ULEB128(1);
+  debug_line->D8(dwarf2reader::DW_LNE_end_sequence);
+  unit_length = debug_line->Size() - post_length_offset;
+
+  return program_offset;
+}
+
+// Append the DIEs of unit cu_index to debug_info: a compile unit
+// containing config.functions_per_cu subprograms, each wrapping
+// config.die_depth nested lexical blocks. The deliberately pointless
+// blocks give the DIE reader the same skipping work that inlined and
+// scoped debugging information causes on real binaries.
+static void AppendCompilationUnit(const BenchmarkConfig &config,
+                                  unsigned int cu_index,
+                                  size_t line_program_offset,
+                                  Section *debug_info) {
+  TestCompilationUnit unit;
+  unit.set_endianness(kLittleEndian);
+  unit.set_format_size(4);
+  unit.Header(2, 0, 8);
+
+  uint64_t low_pc = UnitLowPC(config, cu_index);
+  uint64_t high_pc = low_pc + config.functions_per_cu * kFunctionSize;
+
+  char name_buffer[32];
+  snprintf(name_buffer, sizeof(name_buffer), "cu_%u.c", cu_index);
+  unit.ULEB128(1);  // abbrev: compile unit
+  unit.AppendCString(name_buffer);
+  unit.D64(low_pc);
+  unit.D64(high_pc);
+  unit.D32(line_program_offset);
+
+  for (unsigned int function = 0;
+       function < config.functions_per_cu;
+       ++function) {
+    uint64_t function_low = low_pc + function * kFunctionSize;
+    snprintf(name_buffer, sizeof(name_buffer), "function_%u_%u",
+             cu_index, function);
+    unit.ULEB128(2);  // abbrev: subprogram
+    unit.AppendCString(name_buffer);
+    unit.D64(function_low);
+    unit.D64(function_low + kFunctionSize);
+    for (unsigned int depth = 0; depth < config.die_depth; ++depth) {
+      unit.ULEB128(3);  // abbrev: lexical block
+      unit.D64(function_low);
+      unit.D64(function_low + kFunctionSize);
+    }
+    // Close the innermost block's (empty) child list, each enclosing
+    // block, and the subprogram.
+    for (unsigned int depth = 0; depth < config.die_depth + 1; ++depth)
+      unit.D8(0);
+  }
+  unit.D8(0);  // end of the compile unit's children
+  unit.Finish();
+
+  debug_info->Append(unit);
+}
+
+// Append one FDE for each function to cfi, citing the CIE at
+// cie_label, with config.cfi_rule_changes rule changes spread over
+// the function's range.
+static void AppendCallFrameInfo(const BenchmarkConfig &config,
+                                const Label &cie_label,
+                                CFISection *cfi) {
+  for (unsigned int cu_index = 0; cu_index < config.cu_count; ++cu_index) {
+    for (unsigned int function = 0;
+         function < config.functions_per_cu;
+         ++function) {
+      uint64_t function_low =
+          UnitLowPC(config, cu_index) + function * kFunctionSize;
+      cfi->FDEHeader(cie_label, function_low, kFunctionSize);
+      for (unsigned int change = 0;
+           change < config.cfi_rule_changes;
+           ++change) {
+        cfi->D8(dwarf2reader::DW_CFA_advance_loc | 4);
+        cfi->D8(dwarf2reader::DW_CFA_def_cfa_offset);
+        cfi->ULEB128(16 + 8 * change);
+      }
+      cfi->FinishEntry();
+    }
+  }
+}
+
+// Builds a synthetic x86-64 ELF binary for the given configuration
+// and returns its bytes in contents. On success, also reports the
+// sizes of the DWARF debugging information sections and the CFI
+// section, so per-pass rates can cite the bytes each pass actually
+// reads.
+static bool BuildELF(const BenchmarkConfig &config, string *contents,
+                     size_t *dwarf_bytes, size_t *cfi_bytes) {
+  // One abbreviation table serves every unit. DWARF 2 forms only, so
+  // the plain dwarf2reader can parse the result.
+  TestAbbrevTable abbrevs;
+  abbrevs.set_endianness(kLittleEndian);
+  abbrevs
+      .Abbrev(1, dwarf2reader::DW_TAG_compile_unit,
+              dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .Attribute(dwarf2reader::DW_AT_low_pc, dwarf2reader::DW_FORM_addr)
+      .Attribute(dwarf2reader::DW_AT_high_pc, dwarf2reader::DW_FORM_addr)
+      .Attribute(dwarf2reader::DW_AT_stmt_list, dwarf2reader::DW_FORM_data4)
+      .EndAbbrev()
+      .Abbrev(2, dwarf2reader::DW_TAG_subprogram,
+              dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .Attribute(dwarf2reader::DW_AT_low_pc, dwarf2reader::DW_FORM_addr)
+      .Attribute(dwarf2reader::DW_AT_high_pc, dwarf2reader::DW_FORM_addr)
+      .EndAbbrev()
+      .Abbrev(3, dwarf2reader::DW_TAG_lexical_block,
+              dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_low_pc, dwarf2reader::DW_FORM_addr)
+      .Attribute(dwarf2reader::DW_AT_high_pc, dwarf2reader::DW_FORM_addr)
+      .EndAbbrev()
+      .EndTable();
+
+  Section debug_info(kLittleEndian);
+  Section debug_line(kLittleEndian);
+  for (unsigned int cu_index = 0; cu_index < config.cu_count; ++cu_index) {
+    size_t line_program_offset =
+        AppendLineProgram(config, cu_index, &debug_line);
+    AppendCompilationUnit(config, cu_index, line_program_offset,
+                          &debug_info);
+  }
+
+  CFISection cfi(kLittleEndian, 8);
+  Label cie_label;
+  cfi.Mark(&cie_label)
+      .CIEHeader(1, -8, 16)  // return address in $rip's column
+      .D8(dwarf2reader::DW_CFA_def_cfa)
+      .ULEB128(7)            // $rsp
+      .ULEB128(8)
+      .D8(dwarf2reader::DW_CFA_offset | 16)
+      .ULEB128(1)
+      .FinishEntry();
+  AppendCallFrameInfo(config, cie_label, &cfi);
+
+  // The file identifier falls back to hashing .text when there is no
+  // build ID note, so give the section a page of bytes to hash.
+  Section text(kLittleEndian);
+  for (unsigned int byte = 0; byte < 4096; ++byte)
+    text.D8(static_cast<uint8_t>(byte * 41));
+
+  ELF elf(EM_X86_64, ELFCLASS64, kLittleEndian);
+  elf.AddSection(".text", text, SHT_PROGBITS,
+                 SHF_ALLOC | SHF_EXECINSTR, kTextAddress);
+  elf.AddSection(".debug_abbrev", abbrevs, SHT_PROGBITS);
+  elf.AddSection(".debug_info", debug_info, SHT_PROGBITS);
+  elf.AddSection(".debug_line", debug_line, SHT_PROGBITS);
+  elf.AddSection(".debug_frame", cfi, SHT_PROGBITS);
+  elf.Finish();
+
+  *dwarf_bytes = debug_info.Size() + debug_line.Size();
+  *cfi_bytes = cfi.Size();
+  return elf.GetContents(contents);
+}
+
+// Runs WriteSymbolFile over obj_file iteration_count times with the
+// given SymbolData selection and prints one result line, attributing
+// input_bytes of section data to each run. Returns false if any run
+// fails.
+static bool RunPass(const string &obj_file,
+                    SymbolData symbol_data,
+                    const char *pass_name,
+                    size_t input_bytes,
+                    unsigned int iteration_count) {
+  vector<string> debug_dirs;
+  uint64_t total_us = 0;
+  size_t symbol_bytes = 0;
+
+  for (unsigned int iteration = 0; iteration < iteration_count; ++iteration) {
+    std::ostringstream stream;
+    uint64_t start_us = NowMicroseconds();
+    if (!WriteSymbolFile(obj_file, debug_dirs, symbol_data, stream)) {
+      fprintf(stderr, "dump_symbols_benchmark: WriteSymbolFile failed "
+              "(pass %s)\n", pass_name);
+      return false;
+    }
+    total_us += NowMicroseconds() - start_us;
+    symbol_bytes = stream.str().size();
+  }
+
+  uint64_t mean_us = total_us / iteration_count;
+  double bytes_per_second =
+      mean_us ? input_bytes * 1e6 / mean_us : 0;
+  printf("  %-6s mean %8" PRIu64 " us  %7.1f MB/s  symbol file %u KB\n",
+         pass_name, mean_us, bytes_per_second / (1024 * 1024),
+         static_cast<unsigned int>(symbol_bytes / 1024));
+  return true;
+}
+
+// Synthesizes the binary for config, runs each pass over it, and
+// prints the configuration's results. Returns false on failure.
+static bool RunConfiguration(const BenchmarkConfig &config,
+                             unsigned int iteration_count) {
+  string contents;
+  size_t dwarf_bytes, cfi_bytes;
+  uint64_t synth_start_us = NowMicroseconds();
+  if (!BuildELF(config, &contents, &dwarf_bytes, &cfi_bytes)) {
+    fprintf(stderr, "dump_symbols_benchmark: could not synthesize ELF "
+            "(cus=%u functions=%u depth=%u rows=%u cfi=%u)\n",
+            config.cu_count, config.functions_per_cu, config.die_depth,
+            config.line_rows_per_cu, config.cfi_rule_changes);
+    return false;
+  }
+  uint64_t synth_us = NowMicroseconds() - synth_start_us;
+
+  char path[] = "/tmp/dump_symbols_benchmark_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    fprintf(stderr, "dump_symbols_benchmark: mkstemp failed\n");
+    return false;
+  }
+  bool written =
+      write(fd, contents.data(), contents.size()) ==
+      static_cast<ssize_t>(contents.size());
+  close(fd);
+  if (!written) {
+    fprintf(stderr, "dump_symbols_benchmark: could not write %s\n", path);
+    unlink(path);
+    return false;
+  }
+
+  printf("cus=%-4u functions=%-4u depth=%-2u rows=%-5u cfi=%-2u "
+         "size_kb=%-6u synth %" PRIu64 " us\n",
+         config.cu_count, config.functions_per_cu, config.die_depth,
+         config.line_rows_per_cu, config.cfi_rule_changes,
+         static_cast<unsigned int>(contents.size() / 1024), synth_us);
+
+  bool ok =
+      RunPass(path, NO_CFI, "dwarf", dwarf_bytes, iteration_count) &&
+      RunPass(path, ONLY_CFI, "cfi", cfi_bytes, iteration_count) &&
+      RunPass(path, ALL_SYMBOL_DATA, "all", contents.size(),
+              iteration_count);
+  printf("  peak RSS %" PRIu64 " KB\n", PeakResidentKB());
+
+  unlink(path);
+  return ok;
+}
+
+static void usage(const char *program_name) {
+  fprintf(stderr, "usage: %s [-i iterations]\n"
+          "    -i  iterations per pass (default 10)\n",
+          program_name);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned int iteration_count = 10;
+
+  int argument_index = 1;
+  while (argument_index < argc) {
+    if (strcmp(argv[argument_index], "-i") == 0 &&
+        argument_index + 1 < argc) {
+      iteration_count = atoi(argv[++argument_index]);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+    ++argument_index;
+  }
+  if (iteration_count == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  size_t config_count = sizeof(kDefaultCorpus) / sizeof(kDefaultCorpus[0]);
+  for (size_t config_index = 0; config_index < config_count; ++config_index) {
+    if (!RunConfiguration(kDefaultCorpus[config_index], iteration_count)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -49,6 +49,7 @@ bool ReadSymbolDataInternal(const uint8_t* obj_file,
                             const string& obj_filename,
                             const std::vector<string>& debug_dir,
                             SymbolData symbol_data,
+                            std::ostream* sym_stream,
                             Module** module);
 }
 
@@ -87,6 +88,7 @@ TEST_F(DumpSymbols, Invalid) {
                                       "foo",
                                       vector<string>(),
                                       ALL_SYMBOL_DATA,
+                                      NULL,
                                       &module));
 }
 
@@ -119,6 +121,7 @@ TEST_F(DumpSymbols, SimplePublic32) {
                                      "foo",
                                      vector<string>(),
                                      ALL_SYMBOL_DATA,
+                                     NULL,
                                      &module));
 
   stringstream s;
@@ -158,6 +161,7 @@ TEST_F(DumpSymbols, SimplePublic64) {
                                      "foo",
                                      vector<string>(),
                                      ALL_SYMBOL_DATA,
+                                     NULL,
                                      &module));
 
   stringstream s;
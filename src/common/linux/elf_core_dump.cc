@@ -147,6 +147,16 @@ unsigned ElfCoreDump::GetProgramHeaderCount() const {
 }
 
 bool ElfCoreDump::CopyData(void* buffer, Addr virtual_address, size_t length) {
+  const void* data = GetDataPointer(virtual_address, length);
+  if (data) {
+    memcpy(buffer, data, length);
+    return true;
+  }
+  return false;
+}
+
+const void* ElfCoreDump::GetDataPointer(Addr virtual_address,
+                                        size_t length) const {
   for (unsigned i = 0, n = GetProgramHeaderCount(); i < n; ++i) {
     const Phdr* program = GetProgramHeader(i);
     if (program->p_type != PT_LOAD)
@@ -155,15 +165,10 @@ bool ElfCoreDump::CopyData(void* buffer, Addr virtual_address, size_t length) {
     size_t offset_in_segment = virtual_address - program->p_vaddr;
     if (virtual_address >= program->p_vaddr &&
         offset_in_segment < program->p_filesz) {
-      const void* data =
-          content_.GetData(program->p_offset + offset_in_segment, length);
-      if (data) {
-        memcpy(buffer, data, length);
-        return true;
-      }
+      return content_.GetData(program->p_offset + offset_in_segment, length);
     }
   }
-  return false;
+  return NULL;
 }
 
 ElfCoreDump::Note ElfCoreDump::GetFirstNote() const {
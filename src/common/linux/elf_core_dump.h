@@ -134,6 +134,14 @@ class ElfCoreDump {
   // the core dump, or false otherwise.
   bool CopyData(void* buffer, Addr virtual_address, size_t length);
 
+  // Returns a pointer to |length| bytes of data starting at
+  // |virtual_address| in the core dump, or NULL if the range is not
+  // entirely contained within a single loaded segment. The pointer
+  // refers directly into the mapped core dump content and remains valid
+  // for as long as the content does, allowing callers to consume the
+  // data without an intermediate copy.
+  const void* GetDataPointer(Addr virtual_address, size_t length) const;
+
   // Returns the first note found in the note section of the core dump, or
   // an empty note if no note is found.
   Note GetFirstNote() const;
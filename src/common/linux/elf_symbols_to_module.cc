@@ -156,7 +156,8 @@ bool ELFSymbolsToModule(const uint8_t *symtab_section,
     if (ELF32_ST_TYPE(iterator->info) == STT_FUNC &&
         iterator->shndx != SHN_UNDEF) {
       Module::Extern *ext = new Module::Extern;
-      ext->name = SymbolString(iterator->name_offset, strings);
+      ext->name =
+          module->InternString(SymbolString(iterator->name_offset, strings));
       ext->address = iterator->value;
       module->AddExtern(ext);
     }
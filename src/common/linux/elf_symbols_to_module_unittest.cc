@@ -126,7 +126,7 @@ TEST_P(ELFSymbolsToModuleTest32, OneFunc) {
 
   ASSERT_EQ((size_t)1, externs.size());
   Module::Extern *extern1 = externs[0];
-  EXPECT_EQ(kFuncName, extern1->name);
+  EXPECT_EQ(kFuncName, *extern1->name);
   EXPECT_EQ((Module::Address)kFuncAddr, extern1->address);
 }
 
@@ -150,7 +150,7 @@ TEST_P(ELFSymbolsToModuleTest32, NameOutOfBounds) {
 
   ASSERT_EQ((size_t)1, externs.size());
   Module::Extern *extern1 = externs[0];
-  EXPECT_EQ(kFuncName, extern1->name);
+  EXPECT_EQ(kFuncName, *extern1->name);
   EXPECT_EQ((Module::Address)kFuncAddr, extern1->address);
 }
 
@@ -179,7 +179,7 @@ TEST_P(ELFSymbolsToModuleTest32, NonTerminatedStringTable) {
 
   ASSERT_EQ((size_t)1, externs.size());
   Module::Extern *extern1 = externs[0];
-  EXPECT_EQ(kFuncName, extern1->name);
+  EXPECT_EQ(kFuncName, *extern1->name);
   EXPECT_EQ((Module::Address)kFuncAddr, extern1->address);
 }
 
@@ -211,13 +211,13 @@ TEST_P(ELFSymbolsToModuleTest32, MultipleFuncs) {
 
   ASSERT_EQ((size_t)3, externs.size());
   Module::Extern *extern1 = externs[0];
-  EXPECT_EQ(kFuncName1, extern1->name);
+  EXPECT_EQ(kFuncName1, *extern1->name);
   EXPECT_EQ((Module::Address)kFuncAddr1, extern1->address);
   Module::Extern *extern2 = externs[1];
-  EXPECT_EQ(kFuncName2, extern2->name);
+  EXPECT_EQ(kFuncName2, *extern2->name);
   EXPECT_EQ((Module::Address)kFuncAddr2, extern2->address);
   Module::Extern *extern3 = externs[2];
-  EXPECT_EQ(kFuncName3, extern3->name);
+  EXPECT_EQ(kFuncName3, *extern3->name);
   EXPECT_EQ((Module::Address)kFuncAddr3, extern3->address);
 }
 
@@ -243,7 +243,7 @@ TEST_P(ELFSymbolsToModuleTest32, SkipStuff) {
 
   ASSERT_EQ((size_t)1, externs.size());
   Module::Extern *extern1 = externs[0];
-  EXPECT_EQ(kFuncName, extern1->name);
+  EXPECT_EQ(kFuncName, *extern1->name);
   EXPECT_EQ((Module::Address)kFuncAddr, extern1->address);
 }
 
@@ -296,7 +296,7 @@ TEST_P(ELFSymbolsToModuleTest64, OneFunc) {
 
   ASSERT_EQ((size_t)1, externs.size());
   Module::Extern *extern1 = externs[0];
-  EXPECT_EQ(kFuncName, extern1->name);
+  EXPECT_EQ(kFuncName, *extern1->name);
   EXPECT_EQ((Module::Address)kFuncAddr, extern1->address);
 }
 
@@ -328,13 +328,13 @@ TEST_P(ELFSymbolsToModuleTest64, MultipleFuncs) {
 
   ASSERT_EQ((size_t)3, externs.size());
   Module::Extern *extern1 = externs[0];
-  EXPECT_EQ(kFuncName1, extern1->name);
+  EXPECT_EQ(kFuncName1, *extern1->name);
   EXPECT_EQ((Module::Address)kFuncAddr1, extern1->address);
   Module::Extern *extern2 = externs[1];
-  EXPECT_EQ(kFuncName2, extern2->name);
+  EXPECT_EQ(kFuncName2, *extern2->name);
   EXPECT_EQ((Module::Address)kFuncAddr2, extern2->address);
   Module::Extern *extern3 = externs[2];
-  EXPECT_EQ(kFuncName3, extern3->name);
+  EXPECT_EQ(kFuncName3, *extern3->name);
   EXPECT_EQ((Module::Address)kFuncAddr3, extern3->address);
 }
 
@@ -360,7 +360,7 @@ TEST_P(ELFSymbolsToModuleTest64, SkipStuff) {
 
   ASSERT_EQ((size_t)1, externs.size());
   Module::Extern *extern1 = externs[0];
-  EXPECT_EQ(kFuncName, extern1->name);
+  EXPECT_EQ(kFuncName, *extern1->name);
   EXPECT_EQ((Module::Address)kFuncAddr, extern1->address);
 }
 
@@ -69,6 +69,40 @@ const typename ElfClass::Shdr* FindElfSectionByName(
   return NULL;
 }
 
+template<typename ElfClass>
+ElfSectionIndex<ElfClass>::ElfSectionIndex(const Shdr* sections,
+                                           const char* section_names,
+                                           const char* names_end,
+                                           int nsection) {
+  assert(sections != NULL);
+  for (int i = 0; i < nsection; ++i) {
+    const char* section_name = section_names + sections[i].sh_name;
+    // Only index sections whose names are properly terminated within
+    // the name table.
+    if (section_name < section_names || section_name >= names_end ||
+        memchr(section_name, '\0', names_end - section_name) == NULL)
+      continue;
+    sections_.insert(std::make_pair(section_name, sections + i));
+  }
+}
+
+template<typename ElfClass>
+const typename ElfClass::Shdr* ElfSectionIndex<ElfClass>::Find(
+    const char* name,
+    typename ElfClass::Word section_type) const {
+  assert(name != NULL);
+  if (*name == '\0')
+    return NULL;
+
+  for (typename SectionMap::const_iterator it = sections_.lower_bound(name);
+       it != sections_.end() && strcmp(it->first, name) == 0;
+       ++it) {
+    if (it->second->sh_type == section_type)
+      return it->second;
+  }
+  return NULL;
+}
+
 }  // namespace google_breakpad
 
 #endif  // COMMON_LINUX_ELFUTILS_INL_H__
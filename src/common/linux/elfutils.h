@@ -36,6 +36,9 @@
 #include <elf.h>
 #include <link.h>
 #include <stdint.h>
+#include <string.h>
+
+#include <map>
 
 namespace google_breakpad {
 
@@ -82,6 +85,19 @@ bool FindElfSection(const void *elf_mapped_base,
                     int *section_size,
                     int *elfclass);
 
+// Attempt to find the first segment of type |segment_type| in the ELF
+// binary data at |elf_mapped_base|. On success, returns true and sets
+// |*segment_start| to point to the start of the segment data, and
+// |*segment_size| to its size in the file. If |elfclass| is not NULL,
+// set |*elfclass| to the ELF file class. Unlike sections, segments are
+// described by the program headers at the start of the file, so this
+// works on binaries whose section headers have been stripped.
+bool FindElfSegment(const void *elf_mapped_base,
+                    uint32_t segment_type,
+                    const void **segment_start,
+                    int *segment_size,
+                    int *elfclass);
+
 // Internal helper method, exposed for convenience for callers
 // that already have more info.
 template<typename ElfClass>
@@ -93,6 +109,45 @@ FindElfSectionByName(const char* name,
                      const char* names_end,
                      int nsection);
 
+// An index over an ELF file's section header table, built in a single
+// pass, so that callers issuing many named-section lookups need not
+// rescan the table each time: binaries built with -ffunction-sections
+// can carry hundreds of thousands of section headers, making repeated
+// FindElfSectionByName scans noticeably slow. The index keeps pointers
+// into the caller's section table and section name table, so both must
+// outlive it. This class allocates; code that must run in a crashed
+// process should keep using FindElfSection, which does not.
+template<typename ElfClass>
+class ElfSectionIndex {
+ public:
+  typedef typename ElfClass::Shdr Shdr;
+
+  // Build an index over the |nsection| section headers at |sections|,
+  // whose names live in the table at |section_names|, bounded by
+  // |names_end|. Sections whose names fall outside the name table are
+  // left out of the index, as FindElfSectionByName would skip them.
+  ElfSectionIndex(const Shdr* sections, const char* section_names,
+                  const char* names_end, int nsection);
+
+  // Return the first section named |name| of type |section_type|, or
+  // NULL if there is no such section.
+  const Shdr* Find(const char* name,
+                   typename ElfClass::Word section_type) const;
+
+ private:
+  // Order section names by their contents, not their addresses.
+  struct CompareNames {
+    bool operator()(const char* lhs, const char* rhs) const {
+      return strcmp(lhs, rhs) < 0;
+    }
+  };
+
+  // Several sections may share a name (with different types), so keep
+  // them all; entries with equal names stay in section table order.
+  typedef std::multimap<const char*, const Shdr*, CompareNames> SectionMap;
+  SectionMap sections_;
+};
+
 // Convert an offset from an Elf header into a pointer to the mapped
 // address in the current process. Takes an extra template parameter
 // to specify the return type to avoid having to dynamic_cast the
@@ -58,19 +58,37 @@ FileID::FileID(const char* path) {
 // These six functions are also used inside the crashed process, so be safe
 // and use the syscall/libc wrappers instead of direct syscalls or libc.
 
+// ELF note entries are 4-byte aligned; n_namesz and n_descsz give the
+// unpadded lengths.
+#define NOTE_PADDING(x) (((x) + 3) & ~3)
+
+// Walk a span of ELF notes looking for NT_GNU_BUILD_ID and copy as
+// many bytes of it as will fit into |identifier|. The span may contain
+// several notes (a PT_NOTE segment typically also carries the ABI tag).
 template<typename ElfClass>
-static bool ElfClassBuildIDNoteIdentifier(const void *section,
+static bool ElfClassBuildIDNoteIdentifier(const void *section, int length,
                                           uint8_t identifier[kMDGUIDSize]) {
   typedef typename ElfClass::Nhdr Nhdr;
 
+  const char* section_end = reinterpret_cast<const char*>(section) + length;
   const Nhdr* note_header = reinterpret_cast<const Nhdr*>(section);
-  if (note_header->n_type != NT_GNU_BUILD_ID ||
+  while (reinterpret_cast<const char*>(note_header) + sizeof(Nhdr) <=
+         section_end) {
+    if (note_header->n_type == NT_GNU_BUILD_ID)
+      break;
+    note_header = reinterpret_cast<const Nhdr*>(
+        reinterpret_cast<const char*>(note_header) + sizeof(Nhdr) +
+        NOTE_PADDING(note_header->n_namesz) +
+        NOTE_PADDING(note_header->n_descsz));
+  }
+  if (reinterpret_cast<const char*>(note_header) + sizeof(Nhdr) >
+          section_end ||
       note_header->n_descsz == 0) {
     return false;
   }
 
-  const char* build_id = reinterpret_cast<const char*>(section) +
-    sizeof(Nhdr) + note_header->n_namesz;
+  const char* build_id = reinterpret_cast<const char*>(note_header) +
+    sizeof(Nhdr) + NOTE_PADDING(note_header->n_namesz);
   // Copy as many bits of the build ID as will fit
   // into the GUID space.
   my_memset(identifier, 0, kMDGUIDSize);
@@ -80,12 +98,31 @@ static bool ElfClassBuildIDNoteIdentifier(const void *section,
   return true;
 }
 
-// Attempt to locate a .note.gnu.build-id section in an ELF binary
-// and copy as many bytes of it as will fit into |identifier|.
+// Attempt to locate the GNU build id note in an ELF binary and copy as
+// many bytes of it as will fit into |identifier|. The program headers
+// are tried first: they sit right after the ELF header, survive section
+// stripping, and save touching the section table at the end of the
+// file. The .note.gnu.build-id section lookup is kept as a fallback for
+// files whose build id note lives outside the first PT_NOTE segment.
 static bool FindElfBuildIDNote(const void *elf_mapped_base,
                                uint8_t identifier[kMDGUIDSize]) {
   void* note_section;
   int note_size, elfclass;
+  if (FindElfSegment(elf_mapped_base, PT_NOTE,
+                     (const void**)&note_section, &note_size, &elfclass) &&
+      note_size > 0) {
+    if (elfclass == ELFCLASS32 &&
+        ElfClassBuildIDNoteIdentifier<ElfClass32>(note_section, note_size,
+                                                  identifier)) {
+      return true;
+    } else if (elfclass == ELFCLASS64 &&
+               ElfClassBuildIDNoteIdentifier<ElfClass64>(note_section,
+                                                         note_size,
+                                                         identifier)) {
+      return true;
+    }
+  }
+
   if (!FindElfSection(elf_mapped_base, ".note.gnu.build-id", SHT_NOTE,
                       (const void**)&note_section, &note_size, &elfclass) ||
       note_size == 0) {
@@ -93,9 +130,11 @@ static bool FindElfBuildIDNote(const void *elf_mapped_base,
   }
 
   if (elfclass == ELFCLASS32) {
-    return ElfClassBuildIDNoteIdentifier<ElfClass32>(note_section, identifier);
+    return ElfClassBuildIDNoteIdentifier<ElfClass32>(note_section, note_size,
+                                                     identifier);
   } else if (elfclass == ELFCLASS64) {
-    return ElfClassBuildIDNoteIdentifier<ElfClass64>(note_section, identifier);
+    return ElfClassBuildIDNoteIdentifier<ElfClass64>(note_section, note_size,
+                                                     identifier);
   }
 
   return false;
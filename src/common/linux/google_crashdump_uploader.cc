@@ -31,6 +31,7 @@
 #include "common/linux/google_crashdump_uploader.h"
 #include "common/linux/libcurl_wrapper.h"
 
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -118,6 +119,8 @@ void GoogleCrashdumpUploader::Init(const string& product,
   proxy_host_ = proxy_host;
   proxy_userpassword_ = proxy_userpassword;
   minidump_pathname_ = minidump_pathname;
+  minidump_contents_ = NULL;
+  minidump_contents_size_ = 0;
   std::cout << "Uploader initializing";
   std::cout << "\tProduct: " << product_;
   std::cout << "\tVersion: " << version_;
@@ -150,8 +153,8 @@ bool GoogleCrashdumpUploader::CheckRequiredParametersArePresent() {
     error_text.append("\nClient ID must be specified.");
   }
 
-  if (minidump_pathname_.empty()) {
-    error_text.append("\nMinidump pathname must be specified.");
+  if (minidump_pathname_.empty() && minidump_contents_ == NULL) {
+    error_text.append("\nMinidump pathname or contents must be specified.");
   }
 
   if (!error_text.empty()) {
@@ -173,11 +176,13 @@ bool GoogleCrashdumpUploader::Upload() {
     return false;
   }
 
-  struct stat st;
-  int err = stat(minidump_pathname_.c_str(), &st);
-  if (err) {
-    std::cout << minidump_pathname_ << " could not be found";
-    return false;
+  if (minidump_contents_ == NULL) {
+    struct stat st;
+    int err = stat(minidump_pathname_.c_str(), &st);
+    if (err) {
+      std::cout << minidump_pathname_ << " could not be found";
+      return false;
+    }
   }
 
   parameters_["prod"] = product_;
@@ -187,8 +192,17 @@ bool GoogleCrashdumpUploader::Upload() {
   parameters_["ctime"] = ctime_;
   parameters_["email"] = email_;
   parameters_["comments_"] = comments_;
-  if (!http_layer_->AddFile(minidump_pathname_,
-                            "upload_file_minidump")) {
+  if (minidump_contents_ != NULL) {
+    // Zero-disk handoff: the dump goes straight from the writer's
+    // memory sink into the multipart payload.
+    if (!http_layer_->AddFileContents("upload_file_minidump",
+                                      "minidump.dmp",
+                                      minidump_contents_,
+                                      minidump_contents_size_)) {
+      return false;
+    }
+  } else if (!http_layer_->AddFile(minidump_pathname_,
+                                   "upload_file_minidump")) {
     return false;
   }
   std::cout << "Sending request to " << crash_server_;
@@ -196,4 +210,152 @@ bool GoogleCrashdumpUploader::Upload() {
                                   parameters_,
                                   NULL);
 }
+
+struct GoogleCrashdumpUploadQueue::WorkQueue {
+  GoogleCrashdumpUploadQueue* owner;
+  pthread_mutex_t lock;
+  size_t next_dump;
+  // One flag per queued dump, set when its upload succeeded.
+  std::vector<bool> uploaded;
+};
+
+GoogleCrashdumpUploadQueue::GoogleCrashdumpUploadQueue(
+    const string& product,
+    const string& version,
+    const string& guid,
+    const string& crash_server,
+    const string& proxy_host,
+    const string& proxy_userpassword)
+    : product_(product),
+      version_(version),
+      guid_(guid),
+      crash_server_(crash_server),
+      proxy_host_(proxy_host),
+      proxy_userpassword_(proxy_userpassword),
+      worker_count_(1),
+      max_retries_(3),
+      max_upload_speed_(0) {
+}
+
+void GoogleCrashdumpUploadQueue::AddDump(const string& minidump_pathname) {
+  dumps_.push_back(minidump_pathname);
+}
+
+void GoogleCrashdumpUploadQueue::UploadDumps(WorkQueue* queue) {
+  // One wrapper per worker: its curl handle, and the connection it
+  // holds to the crash server, serves every dump this worker claims.
+  LibcurlWrapper http_layer;
+  if (http_layer.Init()) {
+    if (!proxy_host_.empty()) {
+      http_layer.SetProxy(proxy_host_, proxy_userpassword_);
+    }
+    if (max_upload_speed_ != 0) {
+      // Split the aggregate budget evenly, so the cap holds however
+      // many workers are transferring at once.
+      http_layer.SetMaxUploadSpeed(max_upload_speed_ / worker_count_);
+    }
+  }
+
+  for (;;) {
+    pthread_mutex_lock(&queue->lock);
+    size_t index = queue->next_dump;
+    if (index < dumps_.size()) {
+      ++queue->next_dump;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    if (index >= dumps_.size()) {
+      break;
+    }
+
+    // A multipart POST cannot resume partway, so a failed transfer is
+    // retried from the start - over the connection the worker already
+    // holds - backing off to give a struggling server room.
+    bool ok = false;
+    for (unsigned int attempt = 0;
+         attempt <= max_retries_ && !ok;
+         ++attempt) {
+      if (attempt != 0) {
+        sleep(1u << (attempt - 1));
+      }
+      GoogleCrashdumpUploader uploader(product_,
+                                       version_,
+                                       guid_,
+                                       "",
+                                       "",
+                                       "",
+                                       "",
+                                       dumps_[index],
+                                       crash_server_,
+                                       proxy_host_,
+                                       proxy_userpassword_,
+                                       &http_layer);
+      ok = uploader.Upload();
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    queue->uploaded[index] = ok;
+    pthread_mutex_unlock(&queue->lock);
+  }
+}
+
+// static
+void* GoogleCrashdumpUploadQueue::WorkerMain(void* arg) {
+  WorkQueue* queue = static_cast<WorkQueue*>(arg);
+  queue->owner->UploadDumps(queue);
+  return NULL;
+}
+
+size_t GoogleCrashdumpUploadQueue::DrainQueue() {
+  failed_dumps_.clear();
+
+  WorkQueue queue;
+  queue.owner = this;
+  queue.next_dump = 0;
+  queue.uploaded.resize(dumps_.size(), false);
+  pthread_mutex_init(&queue.lock, NULL);
+
+  unsigned int worker_count = worker_count_;
+  if (worker_count > dumps_.size()) {
+    worker_count = dumps_.size();
+  }
+
+  // The calling thread uploads too, so only worker_count - 1 extra
+  // threads are started; if none can be started this degrades to the
+  // serial path.
+  unsigned int started = 0;
+  std::vector<pthread_t> workers;
+  if (worker_count > 1) {
+    workers.resize(worker_count - 1);
+    while (started < worker_count - 1) {
+      if (pthread_create(&workers[started], NULL, WorkerMain, &queue) != 0) {
+        std::cout << "Failed to create upload worker thread";
+        break;
+      }
+      ++started;
+    }
+  }
+
+  UploadDumps(&queue);
+
+  for (unsigned int worker_index = 0; worker_index < started; ++worker_index) {
+    pthread_join(workers[worker_index], NULL);
+  }
+
+  pthread_mutex_destroy(&queue.lock);
+
+  size_t upload_count = 0;
+  for (size_t index = 0; index < dumps_.size(); ++index) {
+    if (queue.uploaded[index]) {
+      ++upload_count;
+    } else {
+      failed_dumps_.push_back(dumps_[index]);
+    }
+  }
+
+  // Dumps that could not be uploaded stay queued, so a later
+  // DrainQueue call tries them again.
+  dumps_ = failed_dumps_;
+
+  return upload_count;
+}
 }
@@ -28,8 +28,11 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
+#include <stdint.h>
+
 #include <string>
 #include <map>
+#include <vector>
 
 #include "common/using_std_string.h"
 
@@ -76,6 +79,18 @@ class GoogleCrashdumpUploader {
             const string& proxy_host,
             const string& proxy_userpassword,
             LibcurlWrapper* http_layer);
+
+  // Uploads the dump from a buffer held in memory instead of from
+  // minidump_pathname, so a dump written to a memory sink (see
+  // MinidumpFileWriter::OpenMemory) reaches the crash server without
+  // ever touching disk.  The buffer is not copied and must stay alive
+  // until Upload returns.  When set, minidump_pathname is ignored and
+  // need not name an existing file.
+  void set_minidump_contents(const void* contents, size_t contents_size) {
+    minidump_contents_ = contents;
+    minidump_contents_size_ = contents_size;
+  }
+
   bool Upload();
 
  private:
@@ -91,10 +106,93 @@ class GoogleCrashdumpUploader {
   string comments_;
   string minidump_pathname_;
 
+  // See set_minidump_contents().  NULL when uploading from
+  // minidump_pathname_.
+  const void* minidump_contents_;
+  size_t minidump_contents_size_;
+
   string crash_server_;
   string proxy_host_;
   string proxy_userpassword_;
 
   std::map<string, string> parameters_;
 };
+
+// Drains a backlog of crash dumps that share one set of product
+// metadata, as accumulates on a machine during an incident.  Each
+// worker thread owns one LibcurlWrapper whose curl handle - and
+// connection to the crash server - persists across every dump that
+// worker uploads, failed uploads are retried with exponential backoff,
+// and an aggregate rate cap can keep a recovery drain from competing
+// with production traffic.
+class GoogleCrashdumpUploadQueue {
+ public:
+  GoogleCrashdumpUploadQueue(const string& product,
+                             const string& version,
+                             const string& guid,
+                             const string& crash_server,
+                             const string& proxy_host,
+                             const string& proxy_userpassword);
+
+  // The number of dumps uploaded concurrently, each over its own
+  // connection.  Defaults to 1, which uploads serially on the calling
+  // thread.
+  void set_worker_count(unsigned int worker_count) {
+    worker_count_ = worker_count;
+  }
+
+  // How many times a failed upload is retried before its dump is
+  // reported in failed_dumps().  Retries back off exponentially
+  // starting at one second.  Defaults to 3.
+  void set_max_retries(unsigned int max_retries) {
+    max_retries_ = max_retries;
+  }
+
+  // Caps the aggregate upload rate in bytes per second, split evenly
+  // across workers; 0 (the default) does not limit.
+  void set_max_upload_speed(int64_t bytes_per_second) {
+    max_upload_speed_ = bytes_per_second;
+  }
+
+  // Queues the dump at |minidump_pathname| for upload.
+  void AddDump(const string& minidump_pathname);
+
+  // Uploads every queued dump and returns the number uploaded
+  // successfully.  Dumps that still fail after retries are listed in
+  // failed_dumps(), and stay queued so a later DrainQueue call tries
+  // them again.
+  size_t DrainQueue();
+
+  // The dumps the last DrainQueue call could not upload.
+  const std::vector<string>& failed_dumps() const { return failed_dumps_; }
+
+ private:
+  // State shared by the workers of one DrainQueue call.  Workers claim
+  // queued dumps under lock and upload each through their own
+  // LibcurlWrapper.
+  struct WorkQueue;
+
+  // Claims dumps from |queue| and uploads them until none remain.
+  void UploadDumps(WorkQueue* queue);
+
+  // pthread entry point wrapping UploadDumps.
+  static void* WorkerMain(void* arg);
+
+  string product_;
+  string version_;
+  string guid_;
+  string crash_server_;
+  string proxy_host_;
+  string proxy_userpassword_;
+
+  unsigned int worker_count_;
+  unsigned int max_retries_;
+  int64_t max_upload_speed_;
+
+  // The queued dumps, in the order they were added.
+  std::vector<string> dumps_;
+
+  // See failed_dumps().
+  std::vector<string> failed_dumps_;
+};
 }
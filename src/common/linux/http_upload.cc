@@ -31,10 +31,21 @@
 
 #include <assert.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <set>
+
 #include "third_party/curl/curl.h"
 
 namespace {
 
+using google_breakpad::HTTPUpload;
+using std::map;
+using std::string;
+using std::vector;
+
 // Callback to get the response data from server.
 static size_t WriteCallback(void *ptr, size_t size,
                             size_t nmemb, void *userp) {
@@ -47,29 +58,32 @@ static size_t WriteCallback(void *ptr, size_t size,
   return real_size;
 }
 
-}  // namespace
-
-namespace google_breakpad {
-
-static const char kUserAgent[] = "Breakpad/1.0 (Linux)";
-
-// static
-bool HTTPUpload::SendRequest(const string &url,
-                             const map<string, string> &parameters,
-                             const string &upload_file,
-                             const string &file_part_name,
-                             const string &proxy,
-                             const string &proxy_user_pwd,
-                             const string &ca_certificate_file,
-                             string *response_body,
-                             long *response_code,
-                             string *error_description) {
-  if (response_code != NULL)
-    *response_code = 0;
-
-  if (!CheckParameters(parameters))
-    return false;
+// The dlopened libcurl, along with the entry points the uploader
+// uses.  Loading the library and resolving its symbols once per
+// SendRequest call was fine for single files, but a batch resolves
+// everything once and shares it between its uploads.
+struct CurlLib {
+  void *handle;
+  CURLcode (*global_init)(long);
+  void (*global_cleanup)(void);
+  CURL *(*easy_init)(void);
+  void (*easy_reset)(CURL *);
+  CURLcode (*easy_setopt)(CURL *, CURLoption, ...);
+  CURLcode (*easy_perform)(CURL *);
+  CURLcode (*easy_getinfo)(CURL *, CURLINFO, ...);
+  const char *(*easy_strerror)(CURLcode);
+  void (*easy_cleanup)(CURL *);
+  CURLFORMcode (*formadd)(struct curl_httppost **,
+                          struct curl_httppost **, ...);
+  void (*formfree)(struct curl_httppost *);
+  struct curl_slist *(*slist_append)(struct curl_slist *, const char *);
+  void (*slist_free_all)(struct curl_slist *);
+};
 
+// Loads libcurl and resolves the entry points in |lib|.  Returns
+// false if the library cannot be loaded, leaving a description of
+// the first failure in |error_description| when it is non-NULL.
+static bool LoadCurlLib(CurlLib *lib, string *error_description) {
   void *curl_lib = dlopen("libcurl.so", RTLD_NOW);
   if (!curl_lib) {
     if (error_description != NULL)
@@ -88,104 +102,522 @@ bool HTTPUpload::SendRequest(const string &url,
     return false;
   }
 
-  CURL* (*curl_easy_init)(void);
-  *(void**) (&curl_easy_init) = dlsym(curl_lib, "curl_easy_init");
-  CURL *curl = (*curl_easy_init)();
-  if (error_description != NULL)
-    *error_description = "No Error";
+  lib->handle = curl_lib;
+  *(void**) (&lib->global_init) = dlsym(curl_lib, "curl_global_init");
+  *(void**) (&lib->global_cleanup) = dlsym(curl_lib, "curl_global_cleanup");
+  *(void**) (&lib->easy_init) = dlsym(curl_lib, "curl_easy_init");
+  *(void**) (&lib->easy_reset) = dlsym(curl_lib, "curl_easy_reset");
+  *(void**) (&lib->easy_setopt) = dlsym(curl_lib, "curl_easy_setopt");
+  *(void**) (&lib->easy_perform) = dlsym(curl_lib, "curl_easy_perform");
+  *(void**) (&lib->easy_getinfo) = dlsym(curl_lib, "curl_easy_getinfo");
+  *(void**) (&lib->easy_strerror) = dlsym(curl_lib, "curl_easy_strerror");
+  *(void**) (&lib->easy_cleanup) = dlsym(curl_lib, "curl_easy_cleanup");
+  *(void**) (&lib->formadd) = dlsym(curl_lib, "curl_formadd");
+  *(void**) (&lib->formfree) = dlsym(curl_lib, "curl_formfree");
+  *(void**) (&lib->slist_append) = dlsym(curl_lib, "curl_slist_append");
+  *(void**) (&lib->slist_free_all) = dlsym(curl_lib, "curl_slist_free_all");
 
-  if (!curl) {
+  if (!lib->easy_init || !lib->easy_setopt ||
+      !lib->easy_perform || !lib->easy_cleanup) {
     dlclose(curl_lib);
+    lib->handle = NULL;
     return false;
   }
+  return true;
+}
+
+static void UnloadCurlLib(CurlLib *lib) {
+  if (lib->handle) {
+    dlclose(lib->handle);
+    lib->handle = NULL;
+  }
+}
+
+// Performs one multipart POST on |curl|, an easy handle created from
+// |lib|.  The handle is reset first so options do not leak from one
+// request into the next, but its connection cache is retained, which
+// is what lets a batch reuse server connections across files.  When
+// |display_filename| is nonempty, it is presented as the file part's
+// filename in place of upload_file's pathname.  The out-parameters
+// have the same meanings as in HTTPUpload::SendRequest.
+static bool SendRequestOnHandle(CurlLib *lib,
+                                CURL *curl,
+                                const string &url,
+                                const map<string, string> &parameters,
+                                const string &upload_file,
+                                const string &display_filename,
+                                const string &file_part_name,
+                                const string &proxy,
+                                const string &proxy_user_pwd,
+                                const string &ca_certificate_file,
+                                string *response_body,
+                                long *response_code,
+                                string *error_description) {
+  if (response_code != NULL)
+    *response_code = 0;
+  if (error_description != NULL)
+    *error_description = "No Error";
+
+  if (lib->easy_reset)
+    (*lib->easy_reset)(curl);
 
-  CURLcode err_code = CURLE_OK;
-  CURLcode (*curl_easy_setopt)(CURL *, CURLoption, ...);
-  *(void**) (&curl_easy_setopt) = dlsym(curl_lib, "curl_easy_setopt");
-  (*curl_easy_setopt)(curl, CURLOPT_URL, url.c_str());
-  (*curl_easy_setopt)(curl, CURLOPT_USERAGENT, kUserAgent);
+  (*lib->easy_setopt)(curl, CURLOPT_URL, url.c_str());
+  (*lib->easy_setopt)(curl, CURLOPT_USERAGENT, "Breakpad/1.0 (Linux)");
   // Set proxy information if necessary.
   if (!proxy.empty())
-    (*curl_easy_setopt)(curl, CURLOPT_PROXY, proxy.c_str());
+    (*lib->easy_setopt)(curl, CURLOPT_PROXY, proxy.c_str());
   if (!proxy_user_pwd.empty())
-    (*curl_easy_setopt)(curl, CURLOPT_PROXYUSERPWD, proxy_user_pwd.c_str());
+    (*lib->easy_setopt)(curl, CURLOPT_PROXYUSERPWD, proxy_user_pwd.c_str());
 
   if (!ca_certificate_file.empty())
-    (*curl_easy_setopt)(curl, CURLOPT_CAINFO, ca_certificate_file.c_str());
+    (*lib->easy_setopt)(curl, CURLOPT_CAINFO, ca_certificate_file.c_str());
 
   struct curl_httppost *formpost = NULL;
   struct curl_httppost *lastptr = NULL;
   // Add form data.
-  CURLFORMcode (*curl_formadd)(struct curl_httppost **, struct curl_httppost **, ...);
-  *(void**) (&curl_formadd) = dlsym(curl_lib, "curl_formadd");
   map<string, string>::const_iterator iter = parameters.begin();
   for (; iter != parameters.end(); ++iter)
-    (*curl_formadd)(&formpost, &lastptr,
+    (*lib->formadd)(&formpost, &lastptr,
                  CURLFORM_COPYNAME, iter->first.c_str(),
                  CURLFORM_COPYCONTENTS, iter->second.c_str(),
                  CURLFORM_END);
 
   // Add form file.
-  (*curl_formadd)(&formpost, &lastptr,
-               CURLFORM_COPYNAME, file_part_name.c_str(),
-               CURLFORM_FILE, upload_file.c_str(),
-               CURLFORM_END);
+  if (!display_filename.empty()) {
+    (*lib->formadd)(&formpost, &lastptr,
+                 CURLFORM_COPYNAME, file_part_name.c_str(),
+                 CURLFORM_FILE, upload_file.c_str(),
+                 CURLFORM_FILENAME, display_filename.c_str(),
+                 CURLFORM_END);
+  } else {
+    (*lib->formadd)(&formpost, &lastptr,
+                 CURLFORM_COPYNAME, file_part_name.c_str(),
+                 CURLFORM_FILE, upload_file.c_str(),
+                 CURLFORM_END);
+  }
 
-  (*curl_easy_setopt)(curl, CURLOPT_HTTPPOST, formpost);
+  (*lib->easy_setopt)(curl, CURLOPT_HTTPPOST, formpost);
 
   // Disable 100-continue header.
   struct curl_slist *headerlist = NULL;
   char buf[] = "Expect:";
-  struct curl_slist* (*curl_slist_append)(struct curl_slist *, const char *);
-  *(void**) (&curl_slist_append) = dlsym(curl_lib, "curl_slist_append");
-  headerlist = (*curl_slist_append)(headerlist, buf);
-  (*curl_easy_setopt)(curl, CURLOPT_HTTPHEADER, headerlist);
+  headerlist = (*lib->slist_append)(headerlist, buf);
+  (*lib->easy_setopt)(curl, CURLOPT_HTTPHEADER, headerlist);
 
   if (response_body != NULL) {
-    (*curl_easy_setopt)(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    (*curl_easy_setopt)(curl, CURLOPT_WRITEDATA,
+    (*lib->easy_setopt)(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    (*lib->easy_setopt)(curl, CURLOPT_WRITEDATA,
                      reinterpret_cast<void *>(response_body));
   }
 
   // Fail if 400+ is returned from the web server.
-  (*curl_easy_setopt)(curl, CURLOPT_FAILONERROR, 1);
-
-  CURLcode (*curl_easy_perform)(CURL *);
-  *(void**) (&curl_easy_perform) = dlsym(curl_lib, "curl_easy_perform");
-  err_code = (*curl_easy_perform)(curl);
-  if (response_code != NULL) {
-    CURLcode (*curl_easy_getinfo)(CURL *, CURLINFO, ...);
-    *(void**) (&curl_easy_getinfo) = dlsym(curl_lib, "curl_easy_getinfo");
-    (*curl_easy_getinfo)(curl, CURLINFO_RESPONSE_CODE, response_code);
-  }
-  const char* (*curl_easy_strerror)(CURLcode);
-  *(void**) (&curl_easy_strerror) = dlsym(curl_lib, "curl_easy_strerror");
+  (*lib->easy_setopt)(curl, CURLOPT_FAILONERROR, 1);
+
+  CURLcode err_code = (*lib->easy_perform)(curl);
+  if (response_code != NULL && lib->easy_getinfo) {
+    (*lib->easy_getinfo)(curl, CURLINFO_RESPONSE_CODE, response_code);
+  }
 #ifndef NDEBUG
   if (err_code != CURLE_OK)
     fprintf(stderr, "Failed to send http request to %s, error: %s\n",
             url.c_str(),
-            (*curl_easy_strerror)(err_code));
+            (*lib->easy_strerror)(err_code));
 #endif
   if (error_description != NULL)
-    *error_description = (*curl_easy_strerror)(err_code);
+    *error_description = (*lib->easy_strerror)(err_code);
 
-  void (*curl_easy_cleanup)(CURL *);
-  *(void**) (&curl_easy_cleanup) = dlsym(curl_lib, "curl_easy_cleanup");
-  (*curl_easy_cleanup)(curl);
   if (formpost != NULL) {
-    void (*curl_formfree)(struct curl_httppost *);
-    *(void**) (&curl_formfree) = dlsym(curl_lib, "curl_formfree");
-    (*curl_formfree)(formpost);
+    (*lib->formfree)(formpost);
   }
   if (headerlist != NULL) {
-    void (*curl_slist_free_all)(struct curl_slist *);
-    *(void**) (&curl_slist_free_all) = dlsym(curl_lib, "curl_slist_free_all");
-    (*curl_slist_free_all)(headerlist);
+    (*lib->slist_free_all)(headerlist);
   }
-  dlclose(curl_lib);
   return err_code == CURLE_OK;
 }
 
+// Returns path wrapped in single quotes, with embedded single quotes
+// escaped, so it can be interpolated into a shell command line.
+static string ShellQuote(const string &path) {
+  string quoted = "'";
+  for (size_t index = 0; index < path.size(); ++index) {
+    if (path[index] == '\'') {
+      quoted.append("'\\''");
+    } else {
+      quoted.push_back(path[index]);
+    }
+  }
+  quoted.push_back('\'');
+  return quoted;
+}
+
+// Returns the basename of path, following the rules used when naming
+// a compressed upload after its source file.
+static string BaseName(const string &path) {
+  string::size_type slash = path.rfind('/');
+  if (slash == string::npos)
+    return path;
+  return path.substr(slash + 1);
+}
+
+// Compresses |path| with gzip into a freshly created temporary file,
+// whose pathname is returned in |compressed_path|.  The caller is
+// responsible for removing the temporary file.  This shells out to
+// gzip rather than linking a compression library, the same way
+// compressed symbol stores are read back on the processor side.
+static bool CompressFileForUpload(const string &path,
+                                  string *compressed_path) {
+  const char *temp_dir = getenv("TMPDIR");
+  string temp_template = string(temp_dir ? temp_dir : "/tmp") +
+      "/symupload.XXXXXX";
+  vector<char> temp_path(temp_template.begin(), temp_template.end());
+  temp_path.push_back('\0');
+  int temp_fd = mkstemp(&temp_path[0]);
+  if (temp_fd == -1)
+    return false;
+  close(temp_fd);
+  *compressed_path = &temp_path[0];
+
+  string command = "gzip -c < " + ShellQuote(path) +
+      " > " + ShellQuote(*compressed_path);
+  if (system(command.c_str()) != 0) {
+    remove(compressed_path->c_str());
+    compressed_path->clear();
+    return false;
+  }
+  return true;
+}
+
+// Builds the "debug_file debug_identifier" line identifying one
+// upload in a symbol presence query.  Returns false if either field
+// is missing from |parameters|, in which case the upload cannot be
+// queried and must always be sent.
+static bool PresenceKeyForParameters(const map<string, string> &parameters,
+                                     string *key) {
+  map<string, string>::const_iterator debug_file =
+      parameters.find("debug_file");
+  map<string, string>::const_iterator debug_identifier =
+      parameters.find("debug_identifier");
+  if (debug_file == parameters.end() || debug_identifier == parameters.end())
+    return false;
+  *key = debug_file->second + " " + debug_identifier->second;
+  return true;
+}
+
+// Shared state for one SendBatch call.  Workers claim items by
+// advancing next_item under the mutex; everything else is read-only
+// while the workers run.
+struct UploadQueue {
+  const string *url;
+  const string *file_part_name;
+  const string *proxy;
+  const string *proxy_user_pwd;
+  const string *ca_certificate_file;
+  bool compress;
+  int max_retries;
+  CurlLib *lib;
+  vector<HTTPUpload::UploadItem> *items;
+  size_t next_item;
+  pthread_mutex_t mutex;
+};
+
+// Uploads one item, compressing it first if requested and retrying
+// with exponential backoff on transient failures.  Responses in the
+// 4xx range mean the server has authoritatively rejected the upload,
+// so they are not retried.
+static void ProcessUploadItem(UploadQueue *queue,
+                              CURL *curl,
+                              HTTPUpload::UploadItem *item) {
+  string upload_path = item->upload_file;
+  string display_filename;
+  string compressed_path;
+  if (queue->compress &&
+      CompressFileForUpload(item->upload_file, &compressed_path)) {
+    // If compression fails, fall through and send the file as-is.
+    upload_path = compressed_path;
+    display_filename = BaseName(item->upload_file) + ".gz";
+  }
+
+  for (int attempt = 0; ; ++attempt) {
+    item->response_body.clear();
+    item->success = SendRequestOnHandle(queue->lib, curl,
+                                        *queue->url,
+                                        item->parameters,
+                                        upload_path,
+                                        display_filename,
+                                        *queue->file_part_name,
+                                        *queue->proxy,
+                                        *queue->proxy_user_pwd,
+                                        *queue->ca_certificate_file,
+                                        &item->response_body,
+                                        &item->response_code,
+                                        &item->error_description);
+    if (item->success || attempt >= queue->max_retries)
+      break;
+    if (item->response_code >= 400 && item->response_code < 500)
+      break;
+    sleep(attempt < 6 ? 1 << attempt : 64);
+  }
+
+  if (!compressed_path.empty())
+    remove(compressed_path.c_str());
+}
+
+// Thread entry point for SendBatch workers.  Each worker creates one
+// curl handle and keeps it for every item it claims, so connections
+// opened for the first upload carry the rest.
+static void *UploadWorkerMain(void *arg) {
+  UploadQueue *queue = reinterpret_cast<UploadQueue *>(arg);
+
+  CURL *curl = (*queue->lib->easy_init)();
+  if (!curl)
+    return NULL;
+
+  for (;;) {
+    pthread_mutex_lock(&queue->mutex);
+    size_t item_index = queue->next_item;
+    if (item_index < queue->items->size())
+      queue->next_item++;
+    pthread_mutex_unlock(&queue->mutex);
+    if (item_index >= queue->items->size())
+      break;
+
+    ProcessUploadItem(queue, curl, &(*queue->items)[item_index]);
+  }
+
+  (*queue->lib->easy_cleanup)(curl);
+  return NULL;
+}
+
+}  // namespace
+
+namespace google_breakpad {
+
+// static
+bool HTTPUpload::SendRequest(const string &url,
+                             const map<string, string> &parameters,
+                             const string &upload_file,
+                             const string &file_part_name,
+                             const string &proxy,
+                             const string &proxy_user_pwd,
+                             const string &ca_certificate_file,
+                             string *response_body,
+                             long *response_code,
+                             string *error_description) {
+  if (response_code != NULL)
+    *response_code = 0;
+
+  if (!CheckParameters(parameters))
+    return false;
+
+  CurlLib lib;
+  if (!LoadCurlLib(&lib, error_description)) {
+    return false;
+  }
+
+  CURL *curl = (*lib.easy_init)();
+  if (!curl) {
+    UnloadCurlLib(&lib);
+    return false;
+  }
+
+  bool success = SendRequestOnHandle(&lib, curl, url, parameters,
+                                     upload_file,
+                                     "",  // display_filename
+                                     file_part_name,
+                                     proxy, proxy_user_pwd,
+                                     ca_certificate_file,
+                                     response_body, response_code,
+                                     error_description);
+
+  (*lib.easy_cleanup)(curl);
+  UnloadCurlLib(&lib);
+  return success;
+}
+
+// static
+bool HTTPUpload::SendBatch(const string &url,
+                           const string &file_part_name,
+                           const string &proxy,
+                           const string &proxy_user_pwd,
+                           const string &ca_certificate_file,
+                           bool compress,
+                           int max_in_flight,
+                           int max_retries,
+                           vector<UploadItem> *items) {
+  assert(items);
+  assert(max_in_flight > 0);
+  assert(max_retries >= 0);
+
+  for (size_t item_index = 0; item_index < items->size(); ++item_index) {
+    UploadItem *item = &(*items)[item_index];
+    item->success = false;
+    item->response_body.clear();
+    item->response_code = 0;
+    item->error_description.clear();
+    if (!CheckParameters(item->parameters))
+      return false;
+  }
+  if (items->empty())
+    return true;
+
+  CurlLib lib;
+  if (!LoadCurlLib(&lib, NULL)) {
+    for (size_t item_index = 0; item_index < items->size(); ++item_index)
+      (*items)[item_index].error_description = "Could not load libcurl";
+    return false;
+  }
+
+  // curl_easy_init would do this lazily, but doing it up front keeps
+  // the non-thread-safe global setup out of the workers.
+  if (lib.global_init)
+    (*lib.global_init)(CURL_GLOBAL_ALL);
+
+  UploadQueue queue;
+  queue.url = &url;
+  queue.file_part_name = &file_part_name;
+  queue.proxy = &proxy;
+  queue.proxy_user_pwd = &proxy_user_pwd;
+  queue.ca_certificate_file = &ca_certificate_file;
+  queue.compress = compress;
+  queue.max_retries = max_retries;
+  queue.lib = &lib;
+  queue.items = items;
+  queue.next_item = 0;
+  pthread_mutex_init(&queue.mutex, NULL);
+
+  // Start up to max_in_flight - 1 helpers; the calling thread works
+  // the queue too, so upload still proceeds if none can be created.
+  size_t helper_count = static_cast<size_t>(max_in_flight) - 1;
+  if (helper_count > items->size() - 1)
+    helper_count = items->size() - 1;
+  vector<pthread_t> helpers;
+  for (size_t helper_index = 0; helper_index < helper_count; ++helper_index) {
+    pthread_t helper;
+    if (pthread_create(&helper, NULL, UploadWorkerMain, &queue) != 0)
+      break;
+    helpers.push_back(helper);
+  }
+
+  UploadWorkerMain(&queue);
+
+  for (size_t helper_index = 0; helper_index < helpers.size(); ++helper_index)
+    pthread_join(helpers[helper_index], NULL);
+
+  pthread_mutex_destroy(&queue.mutex);
+  if (lib.global_cleanup)
+    (*lib.global_cleanup)();
+  UnloadCurlLib(&lib);
+
+  bool all_succeeded = true;
+  for (size_t item_index = 0; item_index < items->size(); ++item_index)
+    all_succeeded = all_succeeded && (*items)[item_index].success;
+  return all_succeeded;
+}
+
+// static
+bool HTTPUpload::FilterPresentSymbols(const string &check_url,
+                                      const string &proxy,
+                                      const string &proxy_user_pwd,
+                                      const string &ca_certificate_file,
+                                      vector<UploadItem> *items,
+                                      size_t *skipped_count) {
+  assert(items);
+  if (skipped_count != NULL)
+    *skipped_count = 0;
+  if (items->empty())
+    return true;
+
+  // One line per upload the server might already have.
+  string query_body;
+  for (size_t item_index = 0; item_index < items->size(); ++item_index) {
+    string key;
+    if (PresenceKeyForParameters((*items)[item_index].parameters, &key))
+      query_body += key + "\n";
+  }
+  if (query_body.empty())
+    return true;
+
+  CurlLib lib;
+  if (!LoadCurlLib(&lib, NULL))
+    return false;
+
+  CURL *curl = (*lib.easy_init)();
+  if (!curl) {
+    UnloadCurlLib(&lib);
+    return false;
+  }
+
+  (*lib.easy_setopt)(curl, CURLOPT_URL, check_url.c_str());
+  (*lib.easy_setopt)(curl, CURLOPT_USERAGENT, "Breakpad/1.0 (Linux)");
+  if (!proxy.empty())
+    (*lib.easy_setopt)(curl, CURLOPT_PROXY, proxy.c_str());
+  if (!proxy_user_pwd.empty())
+    (*lib.easy_setopt)(curl, CURLOPT_PROXYUSERPWD, proxy_user_pwd.c_str());
+  if (!ca_certificate_file.empty())
+    (*lib.easy_setopt)(curl, CURLOPT_CAINFO, ca_certificate_file.c_str());
+
+  // A plain POST rather than a multipart form: the query is a few
+  // lines of text, and the server only has to read them back.
+  (*lib.easy_setopt)(curl, CURLOPT_POSTFIELDS, query_body.c_str());
+  (*lib.easy_setopt)(curl, CURLOPT_POSTFIELDSIZE,
+                      static_cast<long>(query_body.size()));
+
+  struct curl_slist *headerlist = NULL;
+  headerlist = (*lib.slist_append)(headerlist, "Content-Type: text/plain");
+  headerlist = (*lib.slist_append)(headerlist, "Expect:");
+  (*lib.easy_setopt)(curl, CURLOPT_HTTPHEADER, headerlist);
+
+  string response_body;
+  (*lib.easy_setopt)(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+  (*lib.easy_setopt)(curl, CURLOPT_WRITEDATA,
+                      reinterpret_cast<void *>(&response_body));
+
+  // A server without the presence endpoint answers 404; FAILONERROR
+  // turns that into a failed query, and the caller uploads everything
+  // as it would have without the check.
+  (*lib.easy_setopt)(curl, CURLOPT_FAILONERROR, 1);
+
+  CURLcode err_code = (*lib.easy_perform)(curl);
+
+  if (headerlist != NULL)
+    (*lib.slist_free_all)(headerlist);
+  (*lib.easy_cleanup)(curl);
+  UnloadCurlLib(&lib);
+
+  if (err_code != CURLE_OK)
+    return false;
+
+  // The response repeats the lines for the symbols the server has.
+  std::set<string> present;
+  string::size_type line_start = 0;
+  while (line_start < response_body.size()) {
+    string::size_type line_end = response_body.find('\n', line_start);
+    if (line_end == string::npos)
+      line_end = response_body.size();
+    string line = response_body.substr(line_start, line_end - line_start);
+    if (!line.empty() && line[line.size() - 1] == '\r')
+      line.resize(line.size() - 1);
+    if (!line.empty())
+      present.insert(line);
+    line_start = line_end + 1;
+  }
+
+  size_t kept_count = 0;
+  for (size_t item_index = 0; item_index < items->size(); ++item_index) {
+    string key;
+    if (PresenceKeyForParameters((*items)[item_index].parameters, &key) &&
+        present.find(key) != present.end())
+      continue;
+    if (kept_count != item_index)
+      (*items)[kept_count] = (*items)[item_index];
+    ++kept_count;
+  }
+  if (skipped_count != NULL)
+    *skipped_count = items->size() - kept_count;
+  items->resize(kept_count);
+  return true;
+}
+
 // static
 bool HTTPUpload::CheckParameters(const map<string, string> &parameters) {
   for (map<string, string>::const_iterator pos = parameters.begin();
@@ -36,12 +36,14 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 
 namespace google_breakpad {
 
 using std::map;
+using std::vector;
 
 class HTTPUpload {
  public:
@@ -69,6 +71,60 @@ class HTTPUpload {
                           long *response_code,
                           string *error_description);
 
+  // One file in a SendBatch upload.  parameters and upload_file are
+  // inputs; the remaining fields are outputs with the same meanings
+  // as the corresponding SendRequest arguments.
+  struct UploadItem {
+    map<string, string> parameters;
+    string upload_file;
+    bool success;
+    string response_body;
+    long response_code;
+    string error_description;
+  };
+
+  // Uploads every entry in |items| to |url| as SendRequest would,
+  // but tuned for publishing many symbol files in one run: libcurl
+  // is loaded once for the whole batch, up to |max_in_flight|
+  // uploads run in parallel, and each in-flight upload reuses a
+  // single curl handle for all of the files it sends, so server
+  // connections persist from file to file.  Failed uploads are
+  // retried up to |max_retries| additional times with exponential
+  // backoff; responses in the 4xx range are treated as permanent and
+  // are not retried.  When |compress| is true, each file is gzipped
+  // to a temporary file before upload and submitted under its
+  // original basename with ".gz" appended -- text symbol files
+  // typically shrink around fivefold.  Returns true only if every
+  // item succeeded; per-item results are left in the items.
+  static bool SendBatch(const string &url,
+                        const string &file_part_name,
+                        const string &proxy,
+                        const string &proxy_user_pwd,
+                        const string &ca_certificate_file,
+                        bool compress,
+                        int max_in_flight,
+                        int max_retries,
+                        vector<UploadItem> *items);
+
+  // Asks the symbol server which of |items| it already has and
+  // removes those items from the vector, so a following SendBatch
+  // uploads only the missing symbols.  |check_url| receives a
+  // text/plain POST body with one "debug_file debug_identifier" line
+  // per item, and is expected to answer 200 with the subset of those
+  // lines naming symbols the server already stores.  Items whose
+  // parameters lack either field cannot be queried and are never
+  // removed.  On any failure -- no such endpoint, a non-2xx response,
+  // or a transport error -- |items| is left untouched and false is
+  // returned, so the caller can fall back to uploading everything.
+  // |skipped_count|, when non-NULL, receives the number of items
+  // removed.
+  static bool FilterPresentSymbols(const string &check_url,
+                                   const string &proxy,
+                                   const string &proxy_user_pwd,
+                                   const string &ca_certificate_file,
+                                   vector<UploadItem> *items,
+                                   size_t *skipped_count);
+
  private:
   // Checks that the given list of parameters has only printable
   // ASCII characters in the parameter name, and does not contain
@@ -38,6 +38,8 @@
 namespace google_breakpad {
 LibcurlWrapper::LibcurlWrapper()
     : init_ok_(false),
+      curl_(NULL),
+      max_upload_speed_(0),
       formpost_(NULL),
       lastptr_(NULL),
       headerlist_(NULL) {
@@ -57,6 +59,21 @@ LibcurlWrapper::LibcurlWrapper()
   return;
 }
 
+LibcurlWrapper::~LibcurlWrapper() {
+  if (curl_) {
+    if (formpost_ != NULL) {
+      (*formfree_)(formpost_);
+    }
+    (*easy_cleanup_)(curl_);
+    if (headerlist_ != NULL) {
+      (*slist_free_all_)(headerlist_);
+    }
+  }
+  if (curl_lib_) {
+    dlclose(curl_lib_);
+  }
+}
+
 bool LibcurlWrapper::SetProxy(const string& proxy_host,
                               const string& proxy_userpwd) {
   if (!init_ok_) {
@@ -79,6 +96,15 @@ bool LibcurlWrapper::SetProxy(const string& proxy_host,
   return true;
 }
 
+bool LibcurlWrapper::SetMaxUploadSpeed(int64_t bytes_per_second) {
+  max_upload_speed_ = bytes_per_second;
+  if (curl_) {
+    (*easy_setopt_)(curl_, CURLOPT_MAX_SEND_SPEED_LARGE,
+                    static_cast<curl_off_t>(max_upload_speed_));
+  }
+  return true;
+}
+
 bool LibcurlWrapper::AddFile(const string& upload_file_path,
                              const string& basename) {
   if (!init_ok_) {
@@ -94,6 +120,27 @@ bool LibcurlWrapper::AddFile(const string& upload_file_path,
   return true;
 }
 
+bool LibcurlWrapper::AddFileContents(const string& basename,
+                                     const string& filename,
+                                     const void* contents,
+                                     size_t contents_size) {
+  if (!init_ok_) {
+    return false;
+  }
+  std::cout << "Adding " << contents_size << " bytes from memory as "
+            << filename << " to form upload.";
+  // CURLFORM_BUFFERPTR does not copy the buffer; the caller keeps it
+  // alive until SendRequest has run.
+  (*formadd_)(&formpost_, &lastptr_,
+              CURLFORM_COPYNAME, basename.c_str(),
+              CURLFORM_BUFFER, filename.c_str(),
+              CURLFORM_BUFFERPTR, contents,
+              CURLFORM_BUFFERLENGTH, static_cast<long>(contents_size),
+              CURLFORM_END);
+
+  return true;
+}
+
 // Callback to get the response data from server.
 static size_t WriteCallback(void *ptr, size_t size,
                             size_t nmemb, void *userp) {
@@ -135,13 +182,13 @@ bool LibcurlWrapper::SendRequest(const string& url,
             url.c_str(),
             (*easy_strerror_)(err_code));
 #endif
-  if (headerlist_ != NULL) {
-    (*slist_free_all_)(headerlist_);
-  }
-
-  (*easy_cleanup_)(curl_);
+  // Free the form built for this request, but keep the handle - and
+  // with it the connection to the server - for the next one.  The
+  // handle and header list are released by the destructor.
   if (formpost_ != NULL) {
     (*formfree_)(formpost_);
+    formpost_ = NULL;
+    lastptr_ = NULL;
   }
 
   return err_code == CURLE_OK;
@@ -153,6 +200,13 @@ bool LibcurlWrapper::Init() {
     return false;
   }
 
+  // A wrapper that was already initialized keeps its curl handle, so
+  // repeated Init calls - one per uploaded file - reuse the handle and
+  // its open connection instead of building a new one.
+  if (curl_) {
+    return true;
+  }
+
   if (!SetFunctionPointers()) {
     std::cout << "Could not find function pointers";
     init_ok_ = false;
@@ -174,6 +228,11 @@ bool LibcurlWrapper::Init() {
 
   headerlist_ = (*slist_append_)(headerlist_, buf);
   (*easy_setopt_)(curl_, CURLOPT_HTTPHEADER, headerlist_);
+
+  if (max_upload_speed_ != 0) {
+    (*easy_setopt_)(curl_, CURLOPT_MAX_SEND_SPEED_LARGE,
+                    static_cast<curl_off_t>(max_upload_speed_));
+  }
   return true;
 }
 
@@ -30,6 +30,8 @@
 // A wrapper for libcurl to do HTTP Uploads, to support easy mocking
 // and unit testing of the HTTPUpload class.
 
+#include <stdint.h>
+
 #include <string>
 #include <map>
 
@@ -40,11 +42,30 @@ namespace google_breakpad {
 class LibcurlWrapper {
  public:
   LibcurlWrapper();
+  virtual ~LibcurlWrapper();
   virtual bool Init();
   virtual bool SetProxy(const string& proxy_host,
                         const string& proxy_userpwd);
+  // Caps the transfer rate of every request sent through this wrapper,
+  // in bytes per second; 0 removes the cap.  May be called before or
+  // after Init.
+  virtual bool SetMaxUploadSpeed(int64_t bytes_per_second);
   virtual bool AddFile(const string& upload_file_path,
                        const string& basename);
+  // Attaches an in-memory buffer as a file part of the upload, so a
+  // dump held in memory is streamed to the server without ever being
+  // written to disk.  |filename| is the name the part carries in the
+  // form.  The buffer is not copied: it must stay alive until
+  // SendRequest returns.
+  virtual bool AddFileContents(const string& basename,
+                               const string& filename,
+                               const void* contents,
+                               size_t contents_size);
+  // Performs the upload.  The curl handle - and with it any open
+  // connection to the server - survives the request, so sending many
+  // requests through one wrapper reuses the connection instead of
+  // renegotiating it per request.  The handle is released by the
+  // destructor.
   virtual bool SendRequest(const string& url,
                            const std::map<string, string>& parameters,
                            string* server_response);
@@ -62,6 +83,9 @@ class LibcurlWrapper {
 
   CURL *curl_;                   // Pointer for handle for CURL calls.
 
+  int64_t max_upload_speed_;     // Transfer rate cap in bytes per
+                                 // second; 0 for unlimited.
+
   CURL* (*easy_init_)(void);
 
   // Stateful pointers for calling into curl_formadd()
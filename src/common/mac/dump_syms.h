@@ -116,6 +116,15 @@ class DumpSymbols {
   // return false.
   bool WriteSymbolFile(std::ostream &stream);
 
+  // Read the debugging information for every architecture in this
+  // dumper's file, and write each architecture's symbol file to
+  // |stream| in the order AvailableArchitectures lists them.  The
+  // architectures are independent slices and are dumped concurrently,
+  // one thread per architecture, all sharing the file mapping made by
+  // Read.  Return true if every architecture was dumped successfully;
+  // if any fails, report it and return false once the rest finish.
+  bool WriteSymbolFilesForAllArchitectures(std::ostream &stream);
+
   // As above, but simply return the debugging information in module
   // instead of writing it to a stream. The caller owns the resulting
   // module object and must delete it when finished.
@@ -126,6 +135,14 @@ class DumpSymbols {
   class DumperLineToModule;
   class LoadCommandDumper;
 
+  // Creates a dumper over the same mapped contents and file names as
+  // |other|, with |object_file| selected for dumping.
+  // WriteSymbolFilesForAllArchitectures gives each worker thread its
+  // own dumper this way, so per-architecture selection and
+  // error-message state is never shared between threads; only the
+  // immutable mapping is.
+  DumpSymbols(const DumpSymbols &other, const struct fat_arch &object_file);
+
   // Return an identifier string for the file this DumpSymbols is dumping.
   std::string Identifier();
 
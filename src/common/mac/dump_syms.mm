@@ -38,9 +38,11 @@
 #include <Foundation/Foundation.h>
 #include <mach-o/arch.h>
 #include <mach-o/fat.h>
+#include <pthread.h>
 #include <stdio.h>
 
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -530,4 +532,78 @@ bool DumpSymbols::WriteSymbolFile(std::ostream &stream) {
   return false;
 }
 
+DumpSymbols::DumpSymbols(const DumpSymbols &other,
+                         const struct fat_arch &object_file)
+    : symbol_data_(other.symbol_data_),
+      input_pathname_([other.input_pathname_ retain]),
+      object_filename_([other.object_filename_ retain]),
+      contents_([other.contents_ retain]),
+      object_files_(1, object_file),
+      selected_object_file_(&object_files_[0]),
+      selected_object_name_() {
+}
+
+namespace {
+
+// The work handed to one WriteSymbolFilesForAllArchitectures thread: a
+// dumper with the thread's architecture selected, the buffer its symbol
+// file is rendered into, and whether the dump succeeded.
+struct ArchitectureDumpTask {
+  ArchitectureDumpTask() : dumper(NULL), ok(false) { }
+
+  DumpSymbols *dumper;
+  std::ostringstream stream;
+  bool ok;
+};
+
+void *DumpArchitectureThread(void *arg) {
+  ArchitectureDumpTask *task = static_cast<ArchitectureDumpTask *>(arg);
+  NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+  task->ok = task->dumper->WriteSymbolFile(task->stream);
+  [pool release];
+  return NULL;
+}
+
+}  // namespace
+
+bool DumpSymbols::WriteSymbolFilesForAllArchitectures(std::ostream &stream) {
+  if (object_files_.empty())
+    return false;
+
+  // One worker per architecture.  Each worker gets its own dumper over
+  // the shared mapping and renders into its own buffer; the buffers are
+  // concatenated in architecture order once every worker finishes, so
+  // the output reads as if the slices had been dumped serially.
+  const size_t architecture_count = object_files_.size();
+  vector<ArchitectureDumpTask *> tasks(architecture_count);
+  vector<pthread_t> threads(architecture_count);
+  vector<bool> started(architecture_count, false);
+
+  for (size_t index = 0; index < architecture_count; ++index) {
+    tasks[index] = new ArchitectureDumpTask();
+    tasks[index]->dumper = new DumpSymbols(*this, object_files_[index]);
+    started[index] = pthread_create(&threads[index], NULL,
+                                    DumpArchitectureThread,
+                                    tasks[index]) == 0;
+    if (!started[index]) {
+      // Fall back to dumping this architecture on the calling thread.
+      DumpArchitectureThread(tasks[index]);
+    }
+  }
+
+  bool result = true;
+  for (size_t index = 0; index < architecture_count; ++index) {
+    if (started[index])
+      pthread_join(threads[index], NULL);
+    if (tasks[index]->ok)
+      stream << tasks[index]->stream.str();
+    else
+      result = false;
+    delete tasks[index]->dumper;
+    delete tasks[index];
+  }
+
+  return result;
+}
+
 }  // namespace google_breakpad
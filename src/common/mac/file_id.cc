@@ -34,14 +34,57 @@
 // Author: Dan Waylonis
 
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <map>
+#include <string>
+
 #include "common/mac/file_id.h"
 #include "common/mac/macho_id.h"
 
 using MacFileUtilities::MachoID;
 
+namespace {
+
+// Identifiers already computed by this process, keyed by the file's
+// path, mtime, size, and requested architecture. Symbol tools
+// re-identify the same frameworks constantly, and when a binary has
+// no LC_UUID the fallback rereads and hashes the whole architecture
+// each time, so memoize the result for as long as the file looks
+// unchanged. Guarded by |identifier_cache_mutex|; allocated on first
+// insertion and deliberately never freed.
+struct CachedIdentifier {
+  unsigned char bytes[16];
+};
+
+pthread_mutex_t identifier_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+std::map<std::string, CachedIdentifier>* identifier_cache;
+
+// Set KEY to the cache key for PATH as CPU_TYPE/CPU_SUBTYPE. Return
+// false if PATH cannot be statted, in which case it cannot be cached.
+bool MakeIdentifierCacheKey(const char* path,
+                            cpu_type_t cpu_type,
+                            cpu_subtype_t cpu_subtype,
+                            std::string* key) {
+  struct stat file_stat;
+  if (stat(path, &file_stat) != 0)
+    return false;
+  char suffix[96];
+  snprintf(suffix, sizeof(suffix), ":%lld:%lld:%d:%d",
+           static_cast<long long>(file_stat.st_mtime),
+           static_cast<long long>(file_stat.st_size),
+           static_cast<int>(cpu_type),
+           static_cast<int>(cpu_subtype));
+  *key = std::string(path) + suffix;
+  return true;
+}
+
+}  // namespace
+
 namespace google_breakpad {
 
 FileID::FileID(const char *path) {
@@ -73,12 +116,38 @@ bool FileID::FileIdentifier(unsigned char identifier[16]) {
 bool FileID::MachoIdentifier(cpu_type_t cpu_type,
                              cpu_subtype_t cpu_subtype,
                              unsigned char identifier[16]) {
-  MachoID macho(path_);
-
-  if (macho.UUIDCommand(cpu_type, cpu_subtype, identifier))
-    return true;
+  std::string key;
+  bool have_key = MakeIdentifierCacheKey(path_, cpu_type, cpu_subtype, &key);
+  if (have_key) {
+    pthread_mutex_lock(&identifier_cache_mutex);
+    if (identifier_cache) {
+      std::map<std::string, CachedIdentifier>::const_iterator entry =
+          identifier_cache->find(key);
+      if (entry != identifier_cache->end()) {
+        memcpy(identifier, entry->second.bytes, sizeof(entry->second.bytes));
+        pthread_mutex_unlock(&identifier_cache_mutex);
+        return true;
+      }
+    }
+    pthread_mutex_unlock(&identifier_cache_mutex);
+  }
 
-  return macho.MD5(cpu_type, cpu_subtype, identifier);
+  // Prefer the linker-recorded LC_UUID, which the walker reads without
+  // hashing anything; only fall back to digesting the architecture's
+  // bytes when the command is absent.
+  MachoID macho(path_);
+  bool result = macho.UUIDCommand(cpu_type, cpu_subtype, identifier);
+  if (!result)
+    result = macho.MD5(cpu_type, cpu_subtype, identifier);
+
+  if (result && have_key) {
+    pthread_mutex_lock(&identifier_cache_mutex);
+    if (!identifier_cache)
+      identifier_cache = new std::map<std::string, CachedIdentifier>();
+    memcpy((*identifier_cache)[key].bytes, identifier, 16);
+    pthread_mutex_unlock(&identifier_cache_mutex);
+  }
+  return result;
 }
 
 // static
@@ -60,6 +60,9 @@ class FileID {
   // Return the unique identifier in |identifier|.
   // The current implementation will look for the (in order of priority):
   // LC_UUID, LC_ID_DYLIB, or MD5 hash of the given |cpu_type|.
+  // Results are memoized for the life of the process, keyed by the
+  // file's path, mtime, and size, so re-identifying an unchanged
+  // binary is a map lookup rather than a header walk or hash.
   bool MachoIdentifier(cpu_type_t cpu_type,
                        cpu_subtype_t cpu_subtype,
                        unsigned char identifier[16]);
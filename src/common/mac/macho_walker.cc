@@ -40,6 +40,8 @@ extern "C" {  // necessary for Leopard
   #include <mach-o/loader.h>
   #include <mach-o/swap.h>
   #include <string.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
   #include <unistd.h>
 }
 
@@ -54,12 +56,29 @@ MachoWalker::MachoWalker(const char *path, LoadCommandCallback callback,
     : file_(0),
       memory_(NULL),
       memory_size_(0),
+      memory_is_mapped_(false),
       callback_(callback),
       callback_context_(context),
       current_header_(NULL),
       current_header_size_(0),
       current_header_offset_(0) {
   file_ = open(path, O_RDONLY);
+
+  // Map the file so ReadBytes can serve every request from memory with
+  // no syscalls after setup. On any failure the mapping is simply not
+  // used and ReadBytes falls back to pread as before.
+  if (file_ != -1) {
+    struct stat st;
+    if (fstat(file_, &st) == 0 && st.st_size > 0) {
+      void *mapped = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ,
+                          MAP_PRIVATE, file_, 0);
+      if (mapped != MAP_FAILED) {
+        memory_ = mapped;
+        memory_size_ = static_cast<size_t>(st.st_size);
+        memory_is_mapped_ = true;
+      }
+    }
+  }
 }
 
 MachoWalker::MachoWalker(void *memory, size_t size,
@@ -67,6 +86,7 @@ MachoWalker::MachoWalker(void *memory, size_t size,
     : file_(0),
       memory_(memory),
       memory_size_(size),
+      memory_is_mapped_(false),
       callback_(callback),
       callback_context_(context),
       current_header_(NULL),
@@ -75,6 +95,8 @@ MachoWalker::MachoWalker(void *memory, size_t size,
 }
 
 MachoWalker::~MachoWalker() {
+  if (memory_is_mapped_)
+    munmap(memory_, memory_size_);
   if (file_ != -1)
     close(file_);
 }
@@ -52,6 +52,10 @@ class MachoWalker {
   typedef bool (*LoadCommandCallback)(MachoWalker *walker, load_command *cmd,
                                       off_t offset, bool swap, void *context);
 
+  // Walk the file at |path|. The file is memory-mapped when possible
+  // so that ReadBytes is a plain copy out of the mapping instead of a
+  // syscall per structure; if mapping fails the walker silently reads
+  // through the file descriptor as before.
   MachoWalker(const char *path, LoadCommandCallback callback, void *context);
   MachoWalker(void *memory, size_t size, LoadCommandCallback callback,
               void *context);
@@ -96,6 +100,11 @@ class MachoWalker {
   // Size of the memory segment we can read from.
   size_t memory_size_;
 
+  // Whether memory_ is a file mapping created by this walker, which
+  // must be unmapped on destruction, rather than memory supplied by
+  // the caller.
+  bool memory_is_mapped_;
+
   // User specified callback & context
   LoadCommandCallback callback_;
   void *callback_context_;
@@ -22,6 +22,12 @@ void MD5Update(struct MD5Context *ctx, unsigned char const *buf, unsigned len);
 
 void MD5Final(unsigned char digest[16], struct MD5Context *ctx);
 
+// Hash the entire contents of the file at PATH into DIGEST, reading
+// in large sequential chunks and hinting the kernel to fetch each
+// following chunk while the current one is digested. Return true on
+// success; on failure to open or read the file, return false.
+bool MD5HashFile(const char *path, unsigned char digest[16]);
+
 }  // namespace google_breakpad
 
 #endif  // COMMON_MD5_H__
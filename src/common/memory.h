@@ -56,25 +56,46 @@ class PageAllocator {
   PageAllocator()
       : page_size_(getpagesize()),
         last_(NULL),
-        current_page_(NULL),
-        page_offset_(0) {
+        region_(NULL),
+        region_size_(0),
+        region_offset_(0),
+        mmap_calls_(0),
+        bytes_allocated_(0) {
   }
 
   ~PageAllocator() {
     FreeAll();
   }
 
+  // Maps enough pages for |bytes| up front so that subsequent Alloc
+  // calls are served from the reservation without further mmap
+  // syscalls. Call from a normal context before a crash; sizing the
+  // reservation from a previous dump's bytes_allocated() high-water
+  // mark typically drops the crash-time mmap count to zero. Returns
+  // true on success.
+  bool Reserve(unsigned bytes) {
+    if (!bytes)
+      return true;
+
+    const unsigned pages =
+        (bytes + sizeof(PageHeader) + page_size_ - 1) / page_size_;
+    uint8_t *const ret = GetNPages(pages);
+    if (!ret)
+      return false;
+
+    SwitchRegion(ret + sizeof(PageHeader),
+                 pages * page_size_ - sizeof(PageHeader));
+    return true;
+  }
+
   void *Alloc(unsigned bytes) {
     if (!bytes)
       return NULL;
 
-    if (current_page_ && page_size_ - page_offset_ >= bytes) {
-      uint8_t *const ret = current_page_ + page_offset_;
-      page_offset_ += bytes;
-      if (page_offset_ == page_size_) {
-        page_offset_ = 0;
-        current_page_ = NULL;
-      }
+    if (region_ && region_size_ - region_offset_ >= bytes) {
+      uint8_t *const ret = region_ + region_offset_;
+      region_offset_ += bytes;
+      bytes_allocated_ += bytes;
 
       return ret;
     }
@@ -85,12 +106,28 @@ class PageAllocator {
     if (!ret)
       return NULL;
 
-    page_offset_ = (page_size_ - (page_size_ * pages - (bytes + sizeof(PageHeader)))) % page_size_;
-    current_page_ = page_offset_ ? ret + page_size_ * (pages - 1) : NULL;
+    // Keep whichever partial region has more room left - the tail of
+    // the fresh mapping or the remainder of the old region - for future
+    // small allocations. With no free operation this is as close to
+    // reuse as the allocator gets; previously the old remainder was
+    // always abandoned.
+    const unsigned tail = pages * page_size_ - (bytes + sizeof(PageHeader));
+    if (!region_ || region_size_ - region_offset_ < tail)
+      SwitchRegion(ret + sizeof(PageHeader) + bytes, tail);
 
+    bytes_allocated_ += bytes;
     return ret + sizeof(PageHeader);
   }
 
+  // The number of mmap syscalls this allocator has issued. Each one
+  // happens inside the crash handler window unless Reserve was called.
+  unsigned mmap_calls() const { return mmap_calls_; }
+
+  // Total bytes handed out by Alloc. Since nothing is ever freed this
+  // is also the high-water mark, suitable for sizing a Reserve call
+  // before the next dump.
+  unsigned bytes_allocated() const { return bytes_allocated_; }
+
  private:
   uint8_t *GetNPages(unsigned num_pages) {
 #ifdef __x86_64
@@ -103,6 +140,8 @@ class PageAllocator {
     if (a == MAP_FAILED)
       return NULL;
 
+    ++mmap_calls_;
+
     struct PageHeader *header = reinterpret_cast<PageHeader*>(a);
     header->next = last_;
     header->num_pages = num_pages;
@@ -120,6 +159,14 @@ class PageAllocator {
     }
   }
 
+  // Makes [start, start + size) the bump region future Allocs are
+  // served from.
+  void SwitchRegion(uint8_t *start, unsigned size) {
+    region_ = size ? start : NULL;
+    region_size_ = size;
+    region_offset_ = 0;
+  }
+
   struct PageHeader {
     PageHeader *next;  // pointer to the start of the next set of pages.
     unsigned num_pages;  // the number of pages in this set.
@@ -127,8 +174,14 @@ class PageAllocator {
 
   const unsigned page_size_;
   PageHeader *last_;
-  uint8_t *current_page_;
-  unsigned page_offset_;
+  // The span of not-yet-used bytes small allocations are bumped
+  // through. Unlike the original single-page cursor this can cover a
+  // whole reservation.
+  uint8_t *region_;
+  unsigned region_size_;
+  unsigned region_offset_;
+  unsigned mmap_calls_;
+  unsigned bytes_allocated_;
 };
 
 // A wasteful vector is like a normal std::vector, except that it's very much
@@ -35,17 +35,59 @@
 
 #include <assert.h>
 #include <errno.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <iostream>
 #include <utility>
 
 namespace google_breakpad {
 
-using std::dec;
-using std::endl;
-using std::hex;
+namespace {
+
+// Symbol files are formatted into a user-space buffer and handed to
+// the underlying stream in chunks of this size.
+const size_t kSymbolBufferSize = 1024 * 1024;
+
+// The number of records one shard of a parallel Write formats per
+// round. Large enough that a round's worth of formatting dwarfs the
+// cost of starting its threads, small enough that a round's buffers
+// stay a modest fraction of a large module's output.
+const size_t kWriteShardRecords = 16 * 1024;
+
+// Append VALUE to BUFFER in lowercase hexadecimal, with no leading
+// zeros, as ostream's hex manipulator would print it.
+void AppendHex(uint64_t value, string *buffer) {
+  static const char hex_digits[] = "0123456789abcdef";
+  char digits[16];
+  int i = 16;
+  do {
+    digits[--i] = hex_digits[value & 0xf];
+    value >>= 4;
+  } while (value);
+  buffer->append(digits + i, 16 - i);
+}
+
+// Append VALUE to BUFFER in decimal.
+void AppendDec(int64_t value, string *buffer) {
+  char digits[20];
+  int i = 20;
+  uint64_t magnitude = value < 0 ? -static_cast<uint64_t>(value) : value;
+  do {
+    digits[--i] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+  if (value < 0)
+    buffer->push_back('-');
+  buffer->append(digits + i, 20 - i);
+}
+
+}  // namespace
 
 
 Module::Module(const string &name, const string &os,
@@ -54,12 +96,16 @@ Module::Module(const string &name, const string &os,
     os_(os),
     architecture_(architecture),
     id_(id),
-    load_address_(0) { }
+    load_address_(0),
+    records_sorted_(true),
+    stream_(NULL),
+    stream_symbol_data_(ALL_SYMBOL_DATA),
+    next_stream_source_id_(0) { }
 
 Module::~Module() {
   for (FileByNameMap::iterator it = files_.begin(); it != files_.end(); ++it)
     delete it->second;
-  for (FunctionSet::iterator it = functions_.begin();
+  for (FunctionList::const_iterator it = functions_.begin();
        it != functions_.end(); ++it) {
     delete *it;
   }
@@ -67,7 +113,8 @@ Module::~Module() {
        it != stack_frame_entries_.end(); ++it) {
     delete *it;
   }
-  for (ExternSet::iterator it = externs_.begin(); it != externs_.end(); ++it)
+  for (ExternList::const_iterator it = externs_.begin();
+       it != externs_.end(); ++it)
     delete *it;
 }
 
@@ -78,13 +125,11 @@ void Module::SetLoadAddress(Address address) {
 void Module::AddFunction(Function *function) {
   // FUNC lines must not hold an empty name, so catch the problem early if
   // callers try to add one.
-  assert(!function->name.empty());
-  std::pair<FunctionSet::iterator,bool> ret = functions_.insert(function);
-  if (!ret.second) {
-    // Free the duplicate that was not inserted because this Module
-    // now owns it.
-    delete function;
-  }
+  assert(!function->name->empty());
+  // Just append; EnsureSorted sorts the list and frees any duplicates
+  // before the module is read back or written.
+  functions_.push_back(function);
+  records_sorted_ = false;
 }
 
 void Module::AddFunctions(vector<Function *>::iterator begin,
@@ -97,22 +142,72 @@ void Module::AddStackFrameEntry(StackFrameEntry *stack_frame_entry) {
   stack_frame_entries_.push_back(stack_frame_entry);
 }
 
-void Module::AddExtern(Extern *ext) {
-  std::pair<ExternSet::iterator,bool> ret = externs_.insert(ext);
-  if (!ret.second) {
-    // Free the duplicate that was not inserted because this Module
-    // now owns it.
-    delete ext;
+// A StackFrameEntry ordering for SortStackFrameEntries: by starting
+// address, with the stable sort leaving equal addresses in arrival
+// order.
+struct StackFrameEntryCompare {
+  bool operator() (const Module::StackFrameEntry *lhs,
+                   const Module::StackFrameEntry *rhs) const {
+    return lhs->address < rhs->address;
+  }
+};
+
+void Module::SortStackFrameEntries() {
+  std::stable_sort(stack_frame_entries_.begin(), stack_frame_entries_.end(),
+                   StackFrameEntryCompare());
+}
+
+void Module::Merge(Module *module) {
+  for (FunctionList::const_iterator it = module->functions_.begin();
+       it != module->functions_.end(); ++it) {
+    Function *func = *it;
+    // The moved records must not keep pointing at the source module's
+    // File objects and interned strings, which die with that module.
+    func->name = InternString(*func->name);
+    for (vector<Line>::iterator line = func->lines.begin();
+         line != func->lines.end(); ++line)
+      line->file = FindFile(line->file->name);
+    AddFunction(func);
+  }
+  module->functions_.clear();
+
+  for (vector<StackFrameEntry *>::const_iterator it =
+           module->stack_frame_entries_.begin();
+       it != module->stack_frame_entries_.end(); ++it) {
+    StackFrameEntry *entry = *it;
+    // Rule maps cite the source module's interned strings; re-intern
+    // them here as function names are above.
+    InternRuleMap(&entry->initial_rules);
+    for (RuleChangeMap::iterator change = entry->rule_changes.begin();
+         change != entry->rule_changes.end(); ++change)
+      InternRuleMap(&change->second);
+    stack_frame_entries_.push_back(entry);
+  }
+  module->stack_frame_entries_.clear();
+
+  for (ExternList::const_iterator it = module->externs_.begin();
+       it != module->externs_.end(); ++it) {
+    Extern *ext = *it;
+    ext->name = InternString(*ext->name);
+    AddExtern(ext);
   }
+  module->externs_.clear();
+}
+
+void Module::AddExtern(Extern *ext) {
+  externs_.push_back(ext);
+  records_sorted_ = false;
 }
 
 void Module::GetFunctions(vector<Function *> *vec,
                           vector<Function *>::iterator i) {
+  EnsureSorted();
   vec->insert(i, functions_.begin(), functions_.end());
 }
 
 void Module::GetExterns(vector<Extern *> *vec,
                         vector<Extern *>::iterator i) {
+  EnsureSorted();
   vec->insert(i, externs_.begin(), externs_.end());
 }
 
@@ -149,6 +244,10 @@ Module::File *Module::FindExistingFile(const string &name) {
   return (it == files_.end()) ? NULL : it->second;
 }
 
+const string *Module::InternString(const string &str) {
+  return &*interned_strings_.insert(str).first;
+}
+
 void Module::GetFiles(vector<File *> *vec) {
   vec->clear();
   for (FileByNameMap::iterator it = files_.begin(); it != files_.end(); ++it)
@@ -159,6 +258,39 @@ void Module::GetStackFrameEntries(vector<StackFrameEntry *> *vec) {
   *vec = stack_frame_entries_;
 }
 
+void Module::EnsureSorted() {
+  if (records_sorted_)
+    return;
+
+  // Sort stably so that, among records with equal keys, the one added
+  // first is the one kept, as inserting into a set would have done.
+  std::stable_sort(functions_.begin(), functions_.end(), FunctionCompare());
+  FunctionList::iterator func_kept = functions_.begin();
+  for (FunctionList::iterator it = functions_.begin();
+       it != functions_.end(); ++it) {
+    if (func_kept == functions_.begin()
+        || FunctionCompare()(*(func_kept - 1), *it))
+      *func_kept++ = *it;
+    else
+      delete *it;
+  }
+  functions_.erase(func_kept, functions_.end());
+
+  std::stable_sort(externs_.begin(), externs_.end(), ExternCompare());
+  ExternList::iterator ext_kept = externs_.begin();
+  for (ExternList::iterator it = externs_.begin();
+       it != externs_.end(); ++it) {
+    if (ext_kept == externs_.begin()
+        || ExternCompare()(*(ext_kept - 1), *it))
+      *ext_kept++ = *it;
+    else
+      delete *it;
+  }
+  externs_.erase(ext_kept, externs_.end());
+
+  records_sorted_ = true;
+}
+
 void Module::AssignSourceIds() {
   // First, give every source file an id of -1.
   for (FileByNameMap::iterator file_it = files_.begin();
@@ -168,7 +300,7 @@ void Module::AssignSourceIds() {
 
   // Next, mark all files actually cited by our functions' line number
   // info, by setting each one's source id to zero.
-  for (FunctionSet::const_iterator func_it = functions_.begin();
+  for (FunctionList::const_iterator func_it = functions_.begin();
        func_it != functions_.end(); ++func_it) {
     Function *func = *func_it;
     for (vector<Line>::iterator line_it = func->lines.begin();
@@ -194,21 +326,206 @@ bool Module::ReportError() {
   return false;
 }
 
-bool Module::WriteRuleMap(const RuleMap &rule_map, std::ostream &stream) {
+void Module::WriteRuleMap(const RuleMap &rule_map, string *buffer) {
   for (RuleMap::const_iterator it = rule_map.begin();
        it != rule_map.end(); ++it) {
     if (it != rule_map.begin())
-      stream << ' ';
-    stream << it->first << ": " << it->second;
+      buffer->push_back(' ');
+    buffer->append(*it->first);
+    buffer->append(": ");
+    const Rule &rule = it->second;
+    buffer->append(*rule.base);
+    switch (rule.shape) {
+      case Rule::kRegister:
+      case Rule::kExpression:
+        break;
+      case Rule::kValOffset:
+        buffer->push_back(' ');
+        AppendDec(rule.offset, buffer);
+        buffer->append(" +");
+        break;
+      case Rule::kOffset:
+        buffer->push_back(' ');
+        AppendDec(rule.offset, buffer);
+        buffer->append(" + ^");
+        break;
+    }
   }
+}
+
+void Module::InternRuleMap(RuleMap *rule_map) {
+  RuleMap interned;
+  for (RuleMap::const_iterator it = rule_map->begin();
+       it != rule_map->end(); ++it) {
+    Rule rule = it->second;
+    rule.base = InternString(*rule.base);
+    interned[InternString(*it->first)] = rule;
+  }
+  rule_map->swap(interned);
+}
+
+void Module::WriteFunction(const Function *function,
+                           string *buffer) const {
+  buffer->append("FUNC ");
+  AppendHex(function->address - load_address_, buffer);
+  buffer->push_back(' ');
+  AppendHex(function->size, buffer);
+  buffer->push_back(' ');
+  AppendHex(function->parameter_size, buffer);
+  buffer->push_back(' ');
+  buffer->append(*function->name);
+  buffer->push_back('\n');
+
+  for (vector<Line>::const_iterator line_it = function->lines.begin();
+       line_it != function->lines.end(); ++line_it) {
+    AppendHex(line_it->address - load_address_, buffer);
+    buffer->push_back(' ');
+    AppendHex(line_it->size, buffer);
+    buffer->push_back(' ');
+    AppendDec(line_it->number, buffer);
+    buffer->push_back(' ');
+    AppendDec(line_it->file->source_id, buffer);
+    buffer->push_back('\n');
+  }
+}
+
+void Module::WriteExtern(const Extern *ext, string *buffer) const {
+  buffer->append("PUBLIC ");
+  AppendHex(ext->address - load_address_, buffer);
+  buffer->append(" 0 ");
+  buffer->append(*ext->name);
+  buffer->push_back('\n');
+}
+
+void Module::WriteStackFrameEntry(const StackFrameEntry *entry,
+                                  string *buffer) const {
+  buffer->append("STACK CFI INIT ");
+  AppendHex(entry->address - load_address_, buffer);
+  buffer->push_back(' ');
+  AppendHex(entry->size, buffer);
+  buffer->push_back(' ');
+  WriteRuleMap(entry->initial_rules, buffer);
+  buffer->push_back('\n');
+
+  // Write out this entry's delta rules as 'STACK CFI' records.
+  for (RuleChangeMap::const_iterator delta_it = entry->rule_changes.begin();
+       delta_it != entry->rule_changes.end(); ++delta_it) {
+    buffer->append("STACK CFI ");
+    AppendHex(delta_it->first - load_address_, buffer);
+    buffer->push_back(' ');
+    WriteRuleMap(delta_it->second, buffer);
+    buffer->push_back('\n');
+  }
+}
+
+bool Module::FlushBuffer(string *buffer, std::ostream &stream) {
+  stream.write(buffer->data(), buffer->size());
+  buffer->clear();
   return stream.good();
 }
 
+#ifndef _WIN32
+// One shard of a parallel Write round: a contiguous slice of the
+// module's FUNC or STACK CFI records, formatted into the shard's own
+// buffer on its own thread and written out in slice order.
+struct Module::WriteShard {
+  const Module *module;
+
+  // The records this shard formats: exactly one is non-NULL.
+  const Function* const* functions;
+  const StackFrameEntry* const* stack_frame_entries;
+  size_t count;
+
+  string buffer;
+  pthread_t thread;
+};
+
+// static
+void* Module::WriteShardMain(void* arg) {
+  WriteShard *shard = static_cast<WriteShard *>(arg);
+  if (shard->functions) {
+    for (size_t i = 0; i < shard->count; i++)
+      shard->module->WriteFunction(shard->functions[i], &shard->buffer);
+  } else {
+    for (size_t i = 0; i < shard->count; i++)
+      shard->module->WriteStackFrameEntry(shard->stack_frame_entries[i],
+                                          &shard->buffer);
+  }
+  return NULL;
+}
+
+bool Module::WriteShardedRecords(
+    const Function* const* functions,
+    const StackFrameEntry* const* stack_frame_entries,
+    size_t count, long num_threads,
+    std::ostream &stream) {
+  std::vector<WriteShard> shards(num_threads);
+
+  // Each round hands every shard one contiguous slice of the records,
+  // and the round's buffers are written out in slice order before the
+  // next round starts, so memory stays bounded by the round while the
+  // records keep their order.
+  for (size_t next = 0; next < count;) {
+    size_t used = 0;
+    while (used < shards.size() && next < count) {
+      WriteShard &shard = shards[used];
+      shard.module = this;
+      shard.functions = functions ? functions + next : NULL;
+      shard.stack_frame_entries =
+          stack_frame_entries ? stack_frame_entries + next : NULL;
+      shard.count = count - next < kWriteShardRecords ? count - next
+                                                      : kWriteShardRecords;
+      shard.buffer.clear();
+      next += shard.count;
+      used++;
+    }
+
+    size_t started = 0;
+    while (started < used) {
+      if (pthread_create(&shards[started].thread, NULL, WriteShardMain,
+                         &shards[started]) != 0)
+        break;
+      started++;
+    }
+    // Shards whose thread could not be started are formatted here, on
+    // the calling thread.
+    for (size_t i = started; i < used; i++)
+      WriteShardMain(&shards[i]);
+
+    for (size_t i = 0; i < started; i++)
+      pthread_join(shards[i].thread, NULL);
+    for (size_t i = 0; i < used; i++) {
+      if (!FlushBuffer(&shards[i].buffer, stream))
+        return false;
+    }
+  }
+
+  return true;
+}
+#endif  // _WIN32
+
 bool Module::Write(std::ostream &stream, SymbolData symbol_data) {
-  stream << "MODULE " << os_ << " " << architecture_ << " "
-         << id_ << " " << name_ << endl;
-  if (!stream.good())
-    return ReportError();
+  EnsureSorted();
+
+#ifndef _WIN32
+  // Formatting the records dominates Write for large modules, and
+  // once the containers are sorted the FUNC and STACK CFI records are
+  // read-only and independent, so those two blocks --- nearly all of
+  // a large symbol file --- can be formatted on parallel threads.
+  const long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+  string buffer;
+  buffer.reserve(kSymbolBufferSize);
+  buffer.append("MODULE ");
+  buffer.append(os_);
+  buffer.push_back(' ');
+  buffer.append(architecture_);
+  buffer.push_back(' ');
+  buffer.append(id_);
+  buffer.push_back(' ');
+  buffer.append(name_);
+  buffer.push_back('\n');
 
   if (symbol_data != ONLY_CFI) {
     AssignSourceIds();
@@ -218,76 +535,188 @@ bool Module::Write(std::ostream &stream, SymbolData symbol_data) {
          file_it != files_.end(); ++file_it) {
       File *file = file_it->second;
       if (file->source_id >= 0) {
-        stream << "FILE " << file->source_id << " " <<  file->name << endl;
-        if (!stream.good())
+        buffer.append("FILE ");
+        AppendDec(file->source_id, &buffer);
+        buffer.push_back(' ');
+        buffer.append(file->name);
+        buffer.push_back('\n');
+        if (buffer.size() >= kSymbolBufferSize
+            && !FlushBuffer(&buffer, stream))
           return ReportError();
       }
     }
 
     // Write out functions and their lines.
-    for (FunctionSet::const_iterator func_it = functions_.begin();
-         func_it != functions_.end(); ++func_it) {
-      Function *func = *func_it;
-      stream << "FUNC " << hex
-             << (func->address - load_address_) << " "
-             << func->size << " "
-             << func->parameter_size << " "
-             << func->name << dec << endl;
-      if (!stream.good())
+    bool functions_written = false;
+#ifndef _WIN32
+    if (num_threads > 1 && functions_.size() >= 2 * kWriteShardRecords) {
+      // Hand the buffered header and FILE records to the stream
+      // first, so the shard buffers concatenate after them.
+      if (!FlushBuffer(&buffer, stream)
+          || !WriteShardedRecords(&functions_[0], NULL, functions_.size(),
+                                  num_threads, stream))
         return ReportError();
-
-      for (vector<Line>::iterator line_it = func->lines.begin();
-           line_it != func->lines.end(); ++line_it) {
-        stream << hex
-               << (line_it->address - load_address_) << " "
-               << line_it->size << " "
-               << dec
-               << line_it->number << " "
-               << line_it->file->source_id << endl;
-        if (!stream.good())
+      functions_written = true;
+    }
+#endif
+    if (!functions_written) {
+      for (FunctionList::const_iterator func_it = functions_.begin();
+           func_it != functions_.end(); ++func_it) {
+        WriteFunction(*func_it, &buffer);
+        if (buffer.size() >= kSymbolBufferSize
+            && !FlushBuffer(&buffer, stream))
           return ReportError();
       }
     }
 
     // Write out 'PUBLIC' records.
-    for (ExternSet::const_iterator extern_it = externs_.begin();
+    for (ExternList::const_iterator extern_it = externs_.begin();
          extern_it != externs_.end(); ++extern_it) {
-      Extern *ext = *extern_it;
-      stream << "PUBLIC " << hex
-             << (ext->address - load_address_) << " 0 "
-             << ext->name << dec << endl;
+      WriteExtern(*extern_it, &buffer);
+      if (buffer.size() >= kSymbolBufferSize
+          && !FlushBuffer(&buffer, stream))
+        return ReportError();
     }
   }
 
   if (symbol_data != NO_CFI) {
     // Write out 'STACK CFI INIT' and 'STACK CFI' records.
-    vector<StackFrameEntry *>::const_iterator frame_it;
-    for (frame_it = stack_frame_entries_.begin();
-         frame_it != stack_frame_entries_.end(); ++frame_it) {
-      StackFrameEntry *entry = *frame_it;
-      stream << "STACK CFI INIT " << hex
-             << (entry->address - load_address_) << " "
-             << entry->size << " " << dec;
-      if (!stream.good()
-          || !WriteRuleMap(entry->initial_rules, stream))
+    bool entries_written = false;
+#ifndef _WIN32
+    if (num_threads > 1
+        && stack_frame_entries_.size() >= 2 * kWriteShardRecords) {
+      if (!FlushBuffer(&buffer, stream)
+          || !WriteShardedRecords(NULL, &stack_frame_entries_[0],
+                                  stack_frame_entries_.size(),
+                                  num_threads, stream))
         return ReportError();
+      entries_written = true;
+    }
+#endif
+    if (!entries_written) {
+      vector<StackFrameEntry *>::const_iterator frame_it;
+      for (frame_it = stack_frame_entries_.begin();
+           frame_it != stack_frame_entries_.end(); ++frame_it) {
+        WriteStackFrameEntry(*frame_it, &buffer);
+        if (buffer.size() >= kSymbolBufferSize
+            && !FlushBuffer(&buffer, stream))
+          return ReportError();
+      }
+    }
+  }
 
-      stream << endl;
+  if (!FlushBuffer(&buffer, stream))
+    return ReportError();
+  return true;
+}
 
-      // Write out this entry's delta rules as 'STACK CFI' records.
-      for (RuleChangeMap::const_iterator delta_it = entry->rule_changes.begin();
-           delta_it != entry->rule_changes.end(); ++delta_it) {
-        stream << "STACK CFI " << hex
-               << (delta_it->first - load_address_) << " " << dec;
-        if (!stream.good()
-            || !WriteRuleMap(delta_it->second, stream))
-          return ReportError();
+bool Module::StartWritingStream(std::ostream &stream,
+                                SymbolData symbol_data) {
+  stream_ = &stream;
+  stream_symbol_data_ = symbol_data;
+  next_stream_source_id_ = 0;
+
+  string buffer;
+  buffer.append("MODULE ");
+  buffer.append(os_);
+  buffer.push_back(' ');
+  buffer.append(architecture_);
+  buffer.push_back(' ');
+  buffer.append(id_);
+  buffer.push_back(' ');
+  buffer.append(name_);
+  buffer.push_back('\n');
+  if (!FlushBuffer(&buffer, stream))
+    return ReportError();
+  return true;
+}
 
-        stream << endl;
+bool Module::FlushStream() {
+  assert(stream_);
+  EnsureSorted();
+
+  std::ostream &stream = *stream_;
+  string buffer;
+  buffer.reserve(kSymbolBufferSize);
+
+  if (stream_symbol_data_ != ONLY_CFI) {
+    // Files cited by this batch's line records for the first time need
+    // their FILE records written before the FUNC records that refer to
+    // them. Mark them with a sentinel id, then assign ids by walking
+    // files_, which keeps each batch in lexicographical order. Ids
+    // assigned by earlier flushes are final, so this never renumbers a
+    // file that has already been written.
+    for (FunctionList::const_iterator func_it = functions_.begin();
+         func_it != functions_.end(); ++func_it) {
+      Function *func = *func_it;
+      for (vector<Line>::iterator line_it = func->lines.begin();
+           line_it != func->lines.end(); ++line_it) {
+        if (line_it->file->source_id == -1)
+          line_it->file->source_id = -2;
       }
     }
+    for (FileByNameMap::iterator file_it = files_.begin();
+         file_it != files_.end(); ++file_it) {
+      File *file = file_it->second;
+      if (file->source_id == -2) {
+        file->source_id = next_stream_source_id_++;
+        buffer.append("FILE ");
+        AppendDec(file->source_id, &buffer);
+        buffer.push_back(' ');
+        buffer.append(file->name);
+        buffer.push_back('\n');
+        if (buffer.size() >= kSymbolBufferSize
+            && !FlushBuffer(&buffer, stream))
+          return ReportError();
+      }
+    }
+
+    // Write out this batch's functions and their lines, then free
+    // them; an error leaves the records in place for the destructor.
+    for (FunctionList::const_iterator func_it = functions_.begin();
+         func_it != functions_.end(); ++func_it) {
+      WriteFunction(*func_it, &buffer);
+      if (buffer.size() >= kSymbolBufferSize
+          && !FlushBuffer(&buffer, stream))
+        return ReportError();
+    }
+    for (FunctionList::const_iterator func_it = functions_.begin();
+         func_it != functions_.end(); ++func_it)
+      delete *func_it;
+    functions_.clear();
+
+    // Write out this batch's 'PUBLIC' records, then free them.
+    for (ExternList::const_iterator extern_it = externs_.begin();
+         extern_it != externs_.end(); ++extern_it) {
+      WriteExtern(*extern_it, &buffer);
+      if (buffer.size() >= kSymbolBufferSize
+          && !FlushBuffer(&buffer, stream))
+        return ReportError();
+    }
+    for (ExternList::const_iterator extern_it = externs_.begin();
+         extern_it != externs_.end(); ++extern_it)
+      delete *extern_it;
+    externs_.clear();
+  }
+
+  if (stream_symbol_data_ != NO_CFI) {
+    // Write out this batch's 'STACK CFI' records, then free them.
+    vector<StackFrameEntry *>::const_iterator frame_it;
+    for (frame_it = stack_frame_entries_.begin();
+         frame_it != stack_frame_entries_.end(); ++frame_it) {
+      WriteStackFrameEntry(*frame_it, &buffer);
+      if (buffer.size() >= kSymbolBufferSize
+          && !FlushBuffer(&buffer, stream))
+        return ReportError();
+    }
+    for (frame_it = stack_frame_entries_.begin();
+         frame_it != stack_frame_entries_.end(); ++frame_it)
+      delete *frame_it;
+    stack_frame_entries_.clear();
   }
 
+  if (!FlushBuffer(&buffer, stream))
+    return ReportError();
   return true;
 }
 
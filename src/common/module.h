@@ -91,8 +91,11 @@ class Module {
       return x->address < y->address;
     }
 
-    // The function's name.
-    string name;
+    // The function's name, interned via Module::InternString. Template
+    // instantiations repeat the same names massively across
+    // compilation units; holding a pointer to the single interned copy
+    // keeps them from dominating the dumper's memory use.
+    const string *name;
 
     // The start address and length of the function's code.
     Address address, size;
@@ -121,14 +124,80 @@ class Module {
   // An exported symbol.
   struct Extern {
     Address address;
-    string name;
+    // The symbol's name, interned via Module::InternString.
+    const string *name;
   };
 
-  // A map from register names to postfix expressions that recover
-  // their their values. This can represent a complete set of rules to
+  // Relation for maps whose keys are strings shared with some other
+  // structure.
+  struct CompareStringPtrs {
+    bool operator()(const string *x, const string *y) const { return *x < *y; }
+  };
+
+  // A register recovery rule, stored in a compact encoded form.
+  // Nearly every DWARF CFI rule is either a copy of another
+  // register's value or a base register plus a small offset, so a
+  // rule stores a shape tag, a pointer to the interned base text, and
+  // an offset, rather than the full postfix expression it stands for;
+  // unwind-heavy binaries produce millions of rules, and the
+  // expression strings would otherwise dominate the dumper's memory.
+  // Write expands rules back to expression text. Rules that fit none
+  // of the common shapes keep their whole postfix expression,
+  // interned via InternString, as their base.
+  struct Rule {
+    enum Shape {
+      kRegister,    // "BASE": the value BASE held on entry
+      kValOffset,   // "BASE OFFSET +": BASE plus OFFSET
+      kOffset,      // "BASE OFFSET + ^": loaded from BASE plus OFFSET
+      kExpression   // BASE is itself a complete postfix expression
+    };
+
+    static Rule Register(const string *base) {
+      return Make(kRegister, base, 0);
+    }
+    static Rule ValOffset(const string *base, long offset) {
+      return Make(kValOffset, base, offset);
+    }
+    static Rule Offset(const string *base, long offset) {
+      return Make(kOffset, base, offset);
+    }
+    static Rule Expression(const string *text) {
+      return Make(kExpression, text, 0);
+    }
+
+    bool operator==(const Rule &rhs) const {
+      return shape == rhs.shape && *base == *rhs.base &&
+             offset == rhs.offset;
+    }
+    bool operator!=(const Rule &rhs) const { return !(*this == rhs); }
+
+    Shape shape;
+
+    // The interned register name the rule builds on, or, for
+    // kExpression, the interned text of the whole expression.
+    const string *base;
+
+    // The offset applied to the base register; zero for kRegister and
+    // kExpression.
+    long offset;
+
+   private:
+    static Rule Make(Shape shape, const string *base, long offset) {
+      Rule rule;
+      rule.shape = shape;
+      rule.base = base;
+      rule.offset = offset;
+      return rule;
+    }
+  };
+
+  // A map from interned register names to the rules that recover
+  // their values. This can represent a complete set of rules to
   // follow at some address, or a set of changes to be applied to an
-  // extant set of rules.
-  typedef map<string, string> RuleMap;
+  // extant set of rules. Both the keys and the rules' base strings
+  // must be interned in this module; Merge re-interns them when
+  // entries move between modules.
+  typedef map<const string *, Rule, CompareStringPtrs> RuleMap;
 
   // A map from addresses to RuleMaps, representing changes that take
   // effect at given addresses.
@@ -157,7 +226,7 @@ class Module {
     bool operator() (const Function *lhs,
                      const Function *rhs) const {
       if (lhs->address == rhs->address)
-        return lhs->name < rhs->name;
+        return *lhs->name < *rhs->name;
       return lhs->address < rhs->address;
     }
   };
@@ -175,6 +244,12 @@ class Module {
          const string &id);
   ~Module();
 
+  // The identity fields given to the constructor.
+  const string &name() const { return name_; }
+  const string &os() const { return os_; }
+  const string &architecture() const { return architecture_; }
+  const string &identifier() const { return id_; }
+
   // Set the module's load address to LOAD_ADDRESS; addresses given
   // for functions and lines will be written to the Breakpad symbol
   // file as offsets from this address.  Construction initializes this
@@ -205,11 +280,26 @@ class Module {
   // function: destroying the module destroys them as well.
   void AddStackFrameEntry(StackFrameEntry *stack_frame_entry);
 
+  // Stably sort the stack frame entries added so far by starting
+  // address. Entries are otherwise written in the order they were
+  // added; CFI converters whose sources visit frame descriptions out
+  // of address order --- a section scanned in shards, or a section
+  // the linker did not lay out sorted --- call this so the STACK
+  // records come out in address order regardless of arrival order.
+  void SortStackFrameEntries();
+
   // Add PUBLIC to the module.
   // This module owns all Extern objects added with this function:
   // destroying the module destroys them as well.
   void AddExtern(Extern *ext);
 
+  // Move the functions, stack frame entries and externs of MODULE
+  // into this module, leaving MODULE with no program data of its own.
+  // Line number records in the moved functions are rewritten to refer
+  // to this module's File objects. This lets several scratch modules
+  // be populated concurrently and combined afterwards.
+  void Merge(Module *module);
+
   // If this module has a file named NAME, return a pointer to it. If
   // it has none, then create one and return a pointer to the new
   // file. This module owns all File objects created using these
@@ -221,6 +311,14 @@ class Module {
   // Otherwise, return NULL.
   File *FindExistingFile(const string &name);
 
+  // Return a pointer to this module's single stored copy of STR,
+  // adding one if needed. The pointer stays valid for the module's
+  // lifetime, so Function and Extern names that repeat - template
+  // instantiations, especially - are stored once and shared. This
+  // module owns the interned strings; destroying the module destroys
+  // them as well.
+  const string *InternString(const string &str);
+
   // Insert pointers to the functions added to this module at I in
   // VEC. The pointed-to Functions are still owned by this module.
   // (Since this is effectively a copy of the function list, this is
@@ -270,15 +368,88 @@ class Module {
   // established by SetLoadAddress.
   bool Write(std::ostream &stream, SymbolData symbol_data);
 
+  // Begin streaming this module to STREAM instead of accumulating it:
+  // write the module header now, and have FlushStream write out and
+  // free the records added since the previous flush. SYMBOL_DATA
+  // limits the record types written, as for Write. Return true if all
+  // goes well, or false if an error occurs.
+  //
+  // Streaming keeps memory proportional to the records added between
+  // flushes, plus the file and interned-name tables, which must
+  // persist so ids and names stay consistent. The cost is output
+  // order: FILE and FUNC records appear in the order the batches are
+  // flushed rather than sorted globally, and duplicate records
+  // arriving in different batches are not coalesced.
+  bool StartWritingStream(std::ostream &stream, SymbolData symbol_data);
+
+  // Return true if StartWritingStream has been called on this module.
+  bool IsStreaming() const { return stream_ != NULL; }
+
+  // Write the functions, externs and stack frame entries added since
+  // the last flush to the stream given to StartWritingStream, then
+  // free them. Files keep the source ids they are assigned the first
+  // time a flushed line record cites them, so later batches refer to
+  // them consistently. Return true if all goes well, or false if an
+  // error occurs.
+  bool FlushStream();
+
  private:
   // Report an error that has occurred writing the symbol file, using
   // errno to find the appropriate cause.  Return false.
   static bool ReportError();
 
-  // Write RULE_MAP to STREAM, in the form appropriate for 'STACK CFI'
-  // records, without a final newline. Return true if all goes well;
-  // if an error occurs, return false, and leave errno set.
-  static bool WriteRuleMap(const RuleMap &rule_map, std::ostream &stream);
+  // Records are formatted into a large user-space buffer with direct
+  // integer-to-text routines, and handed to the underlying stream in
+  // megabyte-sized chunks; per-field ostream formatting is slow
+  // enough to dominate writing multi-gigabyte symbol files otherwise.
+
+  // Append RULE_MAP to BUFFER, in the form appropriate for 'STACK
+  // CFI' records, without a final newline. This is where compactly
+  // stored rules are expanded back to postfix expression text.
+  static void WriteRuleMap(const RuleMap &rule_map, string *buffer);
+
+  // Replace RULE_MAP's keys and rule base strings with copies
+  // interned in this module, for rule maps arriving from another
+  // module via Merge.
+  void InternRuleMap(RuleMap *rule_map);
+
+  // Append FUNCTION and its line records to BUFFER.
+  void WriteFunction(const Function *function, string *buffer) const;
+
+  // Append EXT as a 'PUBLIC' record to BUFFER.
+  void WriteExtern(const Extern *ext, string *buffer) const;
+
+  // Append ENTRY as 'STACK CFI INIT' and 'STACK CFI' records to
+  // BUFFER.
+  void WriteStackFrameEntry(const StackFrameEntry *entry,
+                            string *buffer) const;
+
+  // Write BUFFER to STREAM and clear it. Return true if all goes
+  // well; if an error occurs, return false, and leave errno set.
+  static bool FlushBuffer(string *buffer, std::ostream &stream);
+
+#ifndef _WIN32
+  // One shard of a parallel Write round: a contiguous slice of the
+  // module's FUNC or STACK CFI records, formatted into the shard's
+  // own buffer on its own thread. Defined in module.cc.
+  struct WriteShard;
+
+  // Entry point for Write's shard threads; arg is the WriteShard.
+  static void* WriteShardMain(void* arg);
+
+  // Format COUNT records --- FUNCTIONS' functions with their lines,
+  // or STACK_FRAME_ENTRIES' CFI entries; exactly one is non-NULL ---
+  // into per-shard buffers on up to NUM_THREADS parallel threads,
+  // writing each round's buffers to STREAM in slice order, so the
+  // output is byte-identical to Write's serial loops while memory
+  // stays bounded by the round size. Return true if all goes well;
+  // on a write error return false and leave errno set, as
+  // FlushBuffer does.
+  bool WriteShardedRecords(const Function* const* functions,
+                           const StackFrameEntry* const* stack_frame_entries,
+                           size_t count, long num_threads,
+                           std::ostream &stream);
+#endif
 
   // Module header entries.
   string name_, os_, architecture_, id_;
@@ -288,27 +459,38 @@ class Module {
   // address.
   Address load_address_;
 
-  // Relation for maps whose keys are strings shared with some other
-  // structure.
-  struct CompareStringPtrs {
-    bool operator()(const string *x, const string *y) const { return *x < *y; }
-  };
-
   // A map from filenames to File structures.  The map's keys are
   // pointers to the Files' names.
   typedef map<const string *, File *, CompareStringPtrs> FileByNameMap;
 
-  // A set containing Function structures, sorted by address.
-  typedef set<Function *, FunctionCompare> FunctionSet;
+  // The distinct strings handed out by InternString. std::set nodes
+  // never move, so pointers to the elements stay valid as the set
+  // grows.
+  typedef set<string> InternedStringSet;
 
-  // A set containing Extern structures, sorted by address.
-  typedef set<Extern *, ExternCompare> ExternSet;
+  // Functions and externs are appended to plain vectors as they are
+  // added, and sorted and deduplicated in a single pass the first
+  // time the module is read back or written. Building the containers
+  // this way is much cheaper, in both time and per-node overhead,
+  // than keeping millions of records in a std::set.
+  typedef vector<Function *> FunctionList;
+  typedef vector<Extern *> ExternList;
+
+  // If records have been added since the last call, sort FUNCTIONS_
+  // and EXTERNS_ by address and free any duplicates, keeping the
+  // record added first, as inserting into a set would have.
+  void EnsureSorted();
 
   // The module owns all the files and functions that have been added
   // to it; destroying the module frees the Files and Functions these
   // point to.
   FileByNameMap files_;    // This module's source files.
-  FunctionSet functions_;  // This module's functions.
+  FunctionList functions_;  // This module's functions.
+  InternedStringSet interned_strings_;  // Backing store for InternString.
+
+  // True if no records have been added to FUNCTIONS_ or EXTERNS_
+  // since EnsureSorted last sorted them.
+  bool records_sorted_;
 
   // The module owns all the call frame info entries that have been
   // added to it.
@@ -316,7 +498,15 @@ class Module {
 
   // The module owns all the externs that have been added to it;
   // destroying the module frees the Externs these point to.
-  ExternSet externs_;
+  ExternList externs_;
+
+  // When non-NULL, the stream given to StartWritingStream, to which
+  // FlushStream writes the records it frees; STREAM_SYMBOL_DATA_
+  // limits the record types written, and NEXT_STREAM_SOURCE_ID_ is
+  // the id the next newly cited file will receive.
+  std::ostream *stream_;
+  SymbolData stream_symbol_data_;
+  int next_stream_source_id_;
 };
 
 }  // namespace google_breakpad
@@ -49,13 +49,14 @@ using std::stringstream;
 using std::vector;
 using testing::ContainerEq;
 
-static Module::Function *generate_duplicate_function(const string &name) {
+static Module::Function *generate_duplicate_function(Module *module,
+                                                     const string &name) {
   const Module::Address DUP_ADDRESS = 0xd35402aac7a7ad5cLL;
   const Module::Address DUP_SIZE = 0x200b26e605f99071LL;
   const Module::Address DUP_PARAMETER_SIZE = 0xf14ac4fed48c4a99LL;
 
   Module::Function *function = new(Module::Function);
-  function->name = name;
+  function->name = module->InternString(name);
   function->address = DUP_ADDRESS;
   function->size = DUP_SIZE;
   function->parameter_size = DUP_PARAMETER_SIZE;
@@ -82,7 +83,7 @@ TEST(Write, OneLineFunc) {
 
   Module::File *file = m.FindFile("file_name.cc");
   Module::Function *function = new(Module::Function);
-  function->name = "function_name";
+  function->name = m.InternString("function_name");
   function->address = 0xe165bf8023b9d9abLL;
   function->size = 0x1e4bb0eb1cbf5b09LL;
   function->parameter_size = 0x772beee89114358aLL;
@@ -111,7 +112,8 @@ TEST(Write, RelativeLoadAddress) {
 
   // A function.
   Module::Function *function = new(Module::Function);
-  function->name = "A_FLIBBERTIJIBBET::a_will_o_the_wisp(a clown)";
+  function->name =
+      m.InternString("A_FLIBBERTIJIBBET::a_will_o_the_wisp(a clown)");
   function->address = 0xbec774ea5dd935f3LL;
   function->size = 0x2922088f98d3f6fcLL;
   function->parameter_size = 0xe5e9aa008bd5f0d0LL;
@@ -130,11 +132,15 @@ TEST(Write, RelativeLoadAddress) {
   Module::StackFrameEntry *entry = new Module::StackFrameEntry();
   entry->address = 0x30f9e5c83323973dULL;
   entry->size = 0x49fc9ca7c7c13dc2ULL;
-  entry->initial_rules[".cfa"] = "he was a handsome man";
-  entry->initial_rules["and"] = "what i want to know is";
-  entry->rule_changes[0x30f9e5c83323973eULL]["how"] =
-    "do you like your blueeyed boy";
-  entry->rule_changes[0x30f9e5c83323973eULL]["Mister"] = "Death";
+  entry->initial_rules[m.InternString(".cfa")] =
+      Module::Rule::Expression(m.InternString("he was a handsome man"));
+  entry->initial_rules[m.InternString("and")] =
+      Module::Rule::Expression(m.InternString("what i want to know is"));
+  entry->rule_changes[0x30f9e5c83323973eULL][m.InternString("how")] =
+      Module::Rule::Expression(
+          m.InternString("do you like your blueeyed boy"));
+  entry->rule_changes[0x30f9e5c83323973eULL][m.InternString("Mister")] =
+      Module::Rule::Expression(m.InternString("Death"));
   m.AddStackFrameEntry(entry);
 
   // Set the load address.  Doing this after adding all the data to
@@ -169,7 +175,7 @@ TEST(Write, OmitUnusedFiles) {
 
   // Create a function.
   Module::Function *function = new(Module::Function);
-  function->name = "function_name";
+  function->name = m.InternString("function_name");
   function->address = 0x9b926d464f0b9384LL;
   function->size = 0x4f524a4ba795e6a6LL;
   function->parameter_size = 0xbbe8133a6641c9b7LL;
@@ -218,7 +224,8 @@ TEST(Write, NoCFI) {
 
   // A function.
   Module::Function *function = new(Module::Function);
-  function->name = "A_FLIBBERTIJIBBET::a_will_o_the_wisp(a clown)";
+  function->name =
+      m.InternString("A_FLIBBERTIJIBBET::a_will_o_the_wisp(a clown)");
   function->address = 0xbec774ea5dd935f3LL;
   function->size = 0x2922088f98d3f6fcLL;
   function->parameter_size = 0xe5e9aa008bd5f0d0LL;
@@ -234,11 +241,15 @@ TEST(Write, NoCFI) {
   Module::StackFrameEntry *entry = new Module::StackFrameEntry();
   entry->address = 0x30f9e5c83323973dULL;
   entry->size = 0x49fc9ca7c7c13dc2ULL;
-  entry->initial_rules[".cfa"] = "he was a handsome man";
-  entry->initial_rules["and"] = "what i want to know is";
-  entry->rule_changes[0x30f9e5c83323973eULL]["how"] =
-    "do you like your blueeyed boy";
-  entry->rule_changes[0x30f9e5c83323973eULL]["Mister"] = "Death";
+  entry->initial_rules[m.InternString(".cfa")] =
+      Module::Rule::Expression(m.InternString("he was a handsome man"));
+  entry->initial_rules[m.InternString("and")] =
+      Module::Rule::Expression(m.InternString("what i want to know is"));
+  entry->rule_changes[0x30f9e5c83323973eULL][m.InternString("how")] =
+      Module::Rule::Expression(
+          m.InternString("do you like your blueeyed boy"));
+  entry->rule_changes[0x30f9e5c83323973eULL][m.InternString("Mister")] =
+      Module::Rule::Expression(m.InternString("Death"));
   m.AddStackFrameEntry(entry);
 
   // Set the load address.  Doing this after adding all the data to
@@ -261,13 +272,13 @@ TEST(Construct, AddFunctions) {
 
   // Two functions.
   Module::Function *function1 = new(Module::Function);
-  function1->name = "_without_form";
+  function1->name = m.InternString("_without_form");
   function1->address = 0xd35024aa7ca7da5cLL;
   function1->size = 0x200b26e605f99071LL;
   function1->parameter_size = 0xf14ac4fed48c4a99LL;
 
   Module::Function *function2 = new(Module::Function);
-  function2->name = "_and_void";
+  function2->name = m.InternString("_and_void");
   function2->address = 0x2987743d0b35b13fLL;
   function2->size = 0xb369db048deb3010LL;
   function2->parameter_size = 0x938e556cb5a79988LL;
@@ -310,24 +321,31 @@ TEST(Construct, AddFrames) {
   Module::StackFrameEntry *entry2 = new Module::StackFrameEntry();
   entry2->address = 0x8064f3af5e067e38ULL;
   entry2->size = 0x0de2a5ee55509407ULL;
-  entry2->initial_rules[".cfa"] = "I think that I shall never see";
-  entry2->initial_rules["stromboli"] = "a poem lovely as a tree";
-  entry2->initial_rules["cannoli"] = "a tree whose hungry mouth is prest";
+  entry2->initial_rules[m.InternString(".cfa")] =
+      Module::Rule::Expression(
+          m.InternString("I think that I shall never see"));
+  entry2->initial_rules[m.InternString("stromboli")] =
+      Module::Rule::Expression(m.InternString("a poem lovely as a tree"));
+  entry2->initial_rules[m.InternString("cannoli")] =
+      Module::Rule::Expression(
+          m.InternString("a tree whose hungry mouth is prest"));
   m.AddStackFrameEntry(entry2);
 
   // Third STACK CFI entry, with initial rules and deltas.
   Module::StackFrameEntry *entry3 = new Module::StackFrameEntry();
   entry3->address = 0x5e8d0db0a7075c6cULL;
   entry3->size = 0x1c7edb12a7aea229ULL;
-  entry3->initial_rules[".cfa"] = "Whose woods are these";
-  entry3->rule_changes[0x47ceb0f63c269d7fULL]["calzone"] =
-    "the village though";
-  entry3->rule_changes[0x47ceb0f63c269d7fULL]["cannoli"] =
-    "he will not see me stopping here";
-  entry3->rule_changes[0x36682fad3763ffffULL]["stromboli"] =
-    "his house is in";
-  entry3->rule_changes[0x36682fad3763ffffULL][".cfa"] =
-    "I think I know";
+  entry3->initial_rules[m.InternString(".cfa")] =
+      Module::Rule::Expression(m.InternString("Whose woods are these"));
+  entry3->rule_changes[0x47ceb0f63c269d7fULL][m.InternString("calzone")] =
+      Module::Rule::Expression(m.InternString("the village though"));
+  entry3->rule_changes[0x47ceb0f63c269d7fULL][m.InternString("cannoli")] =
+      Module::Rule::Expression(
+          m.InternString("he will not see me stopping here"));
+  entry3->rule_changes[0x36682fad3763ffffULL][m.InternString("stromboli")] =
+      Module::Rule::Expression(m.InternString("his house is in"));
+  entry3->rule_changes[0x36682fad3763ffffULL][m.InternString(".cfa")] =
+      Module::Rule::Expression(m.InternString("I think I know"));
   m.AddStackFrameEntry(entry3);
 
   // Check that Write writes STACK CFI records properly.
@@ -363,23 +381,33 @@ TEST(Construct, AddFrames) {
   EXPECT_EQ(0x0de2a5ee55509407ULL, entries[1]->size);
   ASSERT_EQ(3U, entries[1]->initial_rules.size());
   Module::RuleMap entry2_initial;
-  entry2_initial[".cfa"] = "I think that I shall never see";
-  entry2_initial["stromboli"] = "a poem lovely as a tree";
-  entry2_initial["cannoli"] = "a tree whose hungry mouth is prest";
+  entry2_initial[m.InternString(".cfa")] =
+      Module::Rule::Expression(
+          m.InternString("I think that I shall never see"));
+  entry2_initial[m.InternString("stromboli")] =
+      Module::Rule::Expression(m.InternString("a poem lovely as a tree"));
+  entry2_initial[m.InternString("cannoli")] =
+      Module::Rule::Expression(
+          m.InternString("a tree whose hungry mouth is prest"));
   EXPECT_THAT(entries[1]->initial_rules, ContainerEq(entry2_initial));
   ASSERT_EQ(0U, entries[1]->rule_changes.size());
   // Check third entry.
   EXPECT_EQ(0x5e8d0db0a7075c6cULL, entries[2]->address);
   EXPECT_EQ(0x1c7edb12a7aea229ULL, entries[2]->size);
   Module::RuleMap entry3_initial;
-  entry3_initial[".cfa"] = "Whose woods are these";
+  entry3_initial[m.InternString(".cfa")] =
+      Module::Rule::Expression(m.InternString("Whose woods are these"));
   EXPECT_THAT(entries[2]->initial_rules, ContainerEq(entry3_initial));
   Module::RuleChangeMap entry3_changes;
-  entry3_changes[0x36682fad3763ffffULL][".cfa"] = "I think I know";
-  entry3_changes[0x36682fad3763ffffULL]["stromboli"] = "his house is in";
-  entry3_changes[0x47ceb0f63c269d7fULL]["calzone"] = "the village though";
-  entry3_changes[0x47ceb0f63c269d7fULL]["cannoli"] =
-    "he will not see me stopping here";
+  entry3_changes[0x36682fad3763ffffULL][m.InternString(".cfa")] =
+      Module::Rule::Expression(m.InternString("I think I know"));
+  entry3_changes[0x36682fad3763ffffULL][m.InternString("stromboli")] =
+      Module::Rule::Expression(m.InternString("his house is in"));
+  entry3_changes[0x47ceb0f63c269d7fULL][m.InternString("calzone")] =
+      Module::Rule::Expression(m.InternString("the village though"));
+  entry3_changes[0x47ceb0f63c269d7fULL][m.InternString("cannoli")] =
+      Module::Rule::Expression(
+          m.InternString("he will not see me stopping here"));
   EXPECT_THAT(entries[2]->rule_changes, ContainerEq(entry3_changes));
 }
 
@@ -401,8 +429,10 @@ TEST(Construct, DuplicateFunctions) {
   Module m(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
 
   // Two functions.
-  Module::Function *function1 = generate_duplicate_function("_without_form");
-  Module::Function *function2 = generate_duplicate_function("_without_form");
+  Module::Function *function1 =
+      generate_duplicate_function(&m, "_without_form");
+  Module::Function *function2 =
+      generate_duplicate_function(&m, "_without_form");
 
   m.AddFunction(function1);
   m.AddFunction(function2);
@@ -420,8 +450,10 @@ TEST(Construct, FunctionsWithSameAddress) {
   Module m(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
 
   // Two functions.
-  Module::Function *function1 = generate_duplicate_function("_without_form");
-  Module::Function *function2 = generate_duplicate_function("_and_void");
+  Module::Function *function1 =
+      generate_duplicate_function(&m, "_without_form");
+  Module::Function *function2 =
+      generate_duplicate_function(&m, "_and_void");
 
   m.AddFunction(function1);
   m.AddFunction(function2);
@@ -445,10 +477,10 @@ TEST(Construct, Externs) {
   // Two externs.
   Module::Extern *extern1 = new(Module::Extern);
   extern1->address = 0xffff;
-  extern1->name = "_abc";
+  extern1->name = m.InternString("_abc");
   Module::Extern *extern2 = new(Module::Extern);
   extern2->address = 0xaaaa;
-  extern2->name = "_xyz";
+  extern2->name = m.InternString("_xyz");
 
   m.AddExtern(extern1);
   m.AddExtern(extern2);
@@ -472,10 +504,10 @@ TEST(Construct, DuplicateExterns) {
   // Two externs.
   Module::Extern *extern1 = new(Module::Extern);
   extern1->address = 0xffff;
-  extern1->name = "_xyz";
+  extern1->name = m.InternString("_xyz");
   Module::Extern *extern2 = new(Module::Extern);
   extern2->address = 0xffff;
-  extern2->name = "_abc";
+  extern2->name = m.InternString("_abc");
 
   m.AddExtern(extern1);
   m.AddExtern(extern2);
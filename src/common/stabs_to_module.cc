@@ -91,7 +91,7 @@ bool StabsToModule::StartFunction(const string &name,
                                   uint64_t address) {
   assert(!current_function_);
   Module::Function *f = new Module::Function;
-  f->name = Demangle(name);
+  f->name = module_->InternString(Demangle(name));
   f->address = address;
   f->size = 0;           // We compute this in StabsToModule::Finalize().
   f->parameter_size = 0; // We don't provide this information.
@@ -137,11 +137,11 @@ bool StabsToModule::Extern(const string &name, uint64_t address) {
   // Older libstdc++ demangle implementations can crash on unexpected
   // input, so be careful about what gets passed in.
   if (name.compare(0, 3, "__Z") == 0) {
-    ext->name = Demangle(name.substr(1));
+    ext->name = module_->InternString(Demangle(name.substr(1)));
   } else if (name[0] == '_') {
-    ext->name = name.substr(1);
+    ext->name = module_->InternString(name.substr(1));
   } else {
-    ext->name = name;
+    ext->name = module_->InternString(name);
   }
   ext->address = address;
   module_->AddExtern(ext);
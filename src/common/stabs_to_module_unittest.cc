@@ -62,7 +62,7 @@ TEST(StabsToModule, SimpleCU) {
   m.GetFunctions(&functions, functions.end());
   ASSERT_EQ((size_t) 1, functions.size());
   Module::Function *function = functions[0];
-  EXPECT_STREQ("function", function->name.c_str());
+  EXPECT_STREQ("function", function->name->c_str());
   EXPECT_EQ(0xfde4abbed390c394LL, function->address);
   EXPECT_EQ(0x10U, function->size);
   EXPECT_EQ(0U, function->parameter_size);
@@ -92,13 +92,13 @@ TEST(StabsToModule, Externs) {
   m.GetExterns(&externs, externs.end());
   ASSERT_EQ((size_t) 3, externs.size());
   Module::Extern *extern1 = externs[0];
-  EXPECT_STREQ("MorphTableGetNextMorphChain", extern1->name.c_str());
+  EXPECT_STREQ("MorphTableGetNextMorphChain", extern1->name->c_str());
   EXPECT_EQ((Module::Address)0x1111, extern1->address);
   Module::Extern *extern2 = externs[1];
-  EXPECT_STREQ("dyldGlobalLockAcquire()", extern2->name.c_str());
+  EXPECT_STREQ("dyldGlobalLockAcquire()", extern2->name->c_str());
   EXPECT_EQ((Module::Address)0xaaaa, extern2->address);
   Module::Extern *extern3 = externs[2];
-  EXPECT_STREQ("foo", extern3->name.c_str());
+  EXPECT_STREQ("foo", extern3->name->c_str());
   EXPECT_EQ((Module::Address)0xffff, extern3->address);
 }
 #endif  // __GNUC__
@@ -164,7 +164,7 @@ TEST(InferSizes, LineSize) {
   ASSERT_EQ((size_t) 1, functions.size());
 
   Module::Function *function = functions[0];
-  EXPECT_STREQ("function", function->name.c_str());
+  EXPECT_STREQ("function", function->name->c_str());
   EXPECT_EQ(0xb4513962eff94e92LL, function->address);
   EXPECT_EQ(0x1000100000000ULL, function->size); // inferred from CU end
   EXPECT_EQ(0U, function->parameter_size);
@@ -214,7 +214,7 @@ TEST(FunctionNames, Mangled) {
   EXPECT_STREQ("std::vector<unsigned long long, "
                "std::allocator<unsigned long long> >::"
                "push_back(unsigned long long const&)",
-               function->name.c_str());
+               function->name->c_str());
   EXPECT_EQ(0xf2cfda63cef7f46dLL, function->address);
   EXPECT_LT(0U, function->size); // should have used dummy size
   EXPECT_EQ(0U, function->parameter_size);
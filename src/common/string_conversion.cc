@@ -38,6 +38,43 @@ namespace google_breakpad {
 
 using std::vector;
 
+// Counts the leading units of |in| that are plain ASCII.  The chunked
+// loop OR-combines several units per iteration, a form compilers
+// vectorize with whatever SIMD width the target offers, so
+// ASCII-dominant strings - the common case for module names and paths -
+// are scanned at memory speed instead of through the byte-at-a-time
+// converter in convert_UTF.c.
+static size_t UTF8ASCIIPrefixLength(const UTF8 *in, size_t length) {
+  size_t index = 0;
+  while (index + 16 <= length) {
+    UTF8 combined = 0;
+    for (int unit = 0; unit < 16; ++unit)
+      combined |= in[index + unit];
+    if (combined & 0x80)
+      break;
+    index += 16;
+  }
+  while (index < length && (in[index] & 0x80) == 0)
+    ++index;
+  return index;
+}
+
+// The UTF-16 counterpart of UTF8ASCIIPrefixLength.
+static size_t UTF16ASCIIPrefixLength(const uint16_t *in, size_t length) {
+  size_t index = 0;
+  while (index + 8 <= length) {
+    uint16_t combined = 0;
+    for (int unit = 0; unit < 8; ++unit)
+      combined |= in[index + unit];
+    if (combined & 0xFF80)
+      break;
+    index += 8;
+  }
+  while (index < length && (in[index] & 0xFF80) == 0)
+    ++index;
+  return index;
+}
+
 void UTF8ToUTF16(const char *in, vector<uint16_t> *out) {
   size_t source_length = strlen(in);
   const UTF8 *source_ptr = reinterpret_cast<const UTF8 *>(in);
@@ -45,11 +82,24 @@ void UTF8ToUTF16(const char *in, vector<uint16_t> *out) {
   // Erase the contents and zero fill to the expected size
   out->clear();
   out->insert(out->begin(), source_length, 0);
-  uint16_t *target_ptr = &(*out)[0];
-  uint16_t *target_end_ptr = target_ptr + out->capacity() * sizeof(uint16_t);
-  ConversionResult result = ConvertUTF8toUTF16(&source_ptr, source_end_ptr,
-                                               &target_ptr, target_end_ptr,
-                                               strictConversion);
+
+  // Widen the leading ASCII run directly; only the remainder, if any,
+  // is handed to the general converter.
+  size_t ascii_length = UTF8ASCIIPrefixLength(source_ptr, source_length);
+  for (size_t index = 0; index < ascii_length; ++index)
+    (*out)[index] = source_ptr[index];
+
+  uint16_t *target_ptr = &(*out)[0] + ascii_length;
+  ConversionResult result = conversionOK;
+  if (ascii_length != source_length) {
+    // A UTF-8 sequence never produces more UTF-16 units than it has
+    // bytes, so the zero-filled buffer is large enough.
+    uint16_t *target_end_ptr = &(*out)[0] + source_length;
+    source_ptr += ascii_length;
+    result = ConvertUTF8toUTF16(&source_ptr, source_end_ptr,
+                                &target_ptr, target_end_ptr,
+                                strictConversion);
+  }
 
   // Resize to be the size of the # of converted characters + NULL
   out->resize(result == conversionOK ? target_ptr - &(*out)[0] + 1: 0);
@@ -134,19 +184,37 @@ string UTF16ToUTF8(const vector<uint16_t> &in, bool swap) {
     source_ptr = source_buffer.get();
   }
 
-  // The maximum expansion would be 4x the size of the input string.
   const UTF16 *source_end_ptr = source_ptr + in.size();
-  size_t target_capacity = in.size() * 4;
-  scoped_array<UTF8> target_buffer(new UTF8[target_capacity]);
+
+  // Narrow the leading ASCII run directly.  As when constructing the
+  // result from a C string, conversion stops at the first NUL, which
+  // terminates strings read from a dump.
+  size_t ascii_length = UTF16ASCIIPrefixLength(source_ptr, in.size());
+  string target;
+  target.reserve(in.size());
+  for (size_t index = 0; index < ascii_length; ++index) {
+    if (source_ptr[index] == 0)
+      return target;
+    target.push_back(static_cast<char>(source_ptr[index]));
+  }
+  if (ascii_length == in.size())
+    return target;
+
+  // Hand the non-ASCII remainder to the general converter.  The maximum
+  // expansion would be 4x the size of the input string.
+  source_ptr += ascii_length;
+  size_t target_capacity = (in.size() - ascii_length) * 4;
+  scoped_array<UTF8> target_buffer(new UTF8[target_capacity + 1]);
   UTF8 *target_ptr = target_buffer.get();
   UTF8 *target_end_ptr = target_ptr + target_capacity;
-  ConversionResult result = ConvertUTF16toUTF8(&source_ptr, source_end_ptr, 
+  ConversionResult result = ConvertUTF16toUTF8(&source_ptr, source_end_ptr,
                                                &target_ptr, target_end_ptr,
                                                strictConversion);
 
   if (result == conversionOK) {
-    const char *targetPtr = reinterpret_cast<const char *>(target_buffer.get());
-    return targetPtr;
+    *target_ptr = '\0';
+    target.append(reinterpret_cast<const char *>(target_buffer.get()));
+    return target;
   }
 
   return "";
@@ -33,6 +33,7 @@
 #pragma warning( disable : 4530 )
 
 #include <fstream>
+#include <set>
 
 #include "common/windows/string_utils-inl.h"
 
@@ -121,9 +122,32 @@ bool HTTPUpload::SendRequest(const wstring &url,
     return false;
   }
 
+  return SendRequestOnConnection(connection.get(), path, secure, parameters,
+                                 upload_file, file_part_name, timeout,
+                                 response_body, response_code);
+}
+
+// static
+bool HTTPUpload::SendRequestOnConnection(
+    HINTERNET connection,
+    const wchar_t *path,
+    bool secure,
+    const map<wstring, wstring> &parameters,
+    const wstring &upload_file,
+    const wstring &file_part_name,
+    int *timeout,
+    wstring *response_body,
+    int *response_code) {
+  if (response_code) {
+    *response_code = 0;
+  }
+
   DWORD http_open_flags = secure ? INTERNET_FLAG_SECURE : 0;
   http_open_flags |= INTERNET_FLAG_NO_COOKIES;
-  AutoInternetHandle request(HttpOpenRequest(connection.get(),
+  // Ask for a keep-alive request so the connection stays usable for
+  // any further requests a batch sends over it.
+  http_open_flags |= INTERNET_FLAG_KEEP_CONNECTION;
+  AutoInternetHandle request(HttpOpenRequest(connection,
                                              L"POST",
                                              path,
                                              NULL,    // version
@@ -193,6 +217,284 @@ bool HTTPUpload::SendRequest(const wstring &url,
   return result;
 }
 
+// static
+bool HTTPUpload::SendBatch(const wstring &url,
+                           const wstring &file_part_name,
+                           int *timeout,
+                           int max_retries,
+                           vector<UploadItem> *items) {
+  assert(items);
+  assert(max_retries >= 0);
+
+  for (size_t item_index = 0; item_index < items->size(); ++item_index) {
+    UploadItem *item = &(*items)[item_index];
+    item->success = false;
+    item->response_body.clear();
+    item->response_code = 0;
+    if (!CheckParameters(item->parameters)) {
+      return false;
+    }
+  }
+  if (items->empty()) {
+    return true;
+  }
+
+  // Break up the URL and make sure we can handle it
+  wchar_t scheme[16], host[256], path[256];
+  URL_COMPONENTS components;
+  memset(&components, 0, sizeof(components));
+  components.dwStructSize = sizeof(components);
+  components.lpszScheme = scheme;
+  components.dwSchemeLength = sizeof(scheme) / sizeof(scheme[0]);
+  components.lpszHostName = host;
+  components.dwHostNameLength = sizeof(host) / sizeof(host[0]);
+  components.lpszUrlPath = path;
+  components.dwUrlPathLength = sizeof(path) / sizeof(path[0]);
+  if (!InternetCrackUrl(url.c_str(), static_cast<DWORD>(url.size()),
+                        0, &components)) {
+    return false;
+  }
+  bool secure = false;
+  if (wcscmp(scheme, L"https") == 0) {
+    secure = true;
+  } else if (wcscmp(scheme, L"http") != 0) {
+    return false;
+  }
+
+  // One session and one server connection carry the whole batch.
+  AutoInternetHandle internet(InternetOpen(kUserAgent,
+                                           INTERNET_OPEN_TYPE_PRECONFIG,
+                                           NULL,  // proxy name
+                                           NULL,  // proxy bypass
+                                           0));   // flags
+  if (!internet.get()) {
+    return false;
+  }
+
+  AutoInternetHandle connection(InternetConnect(internet.get(),
+                                                host,
+                                                components.nPort,
+                                                NULL,    // user name
+                                                NULL,    // password
+                                                INTERNET_SERVICE_HTTP,
+                                                0,       // flags
+                                                NULL));  // context
+  if (!connection.get()) {
+    return false;
+  }
+
+  bool all_succeeded = true;
+  for (size_t item_index = 0; item_index < items->size(); ++item_index) {
+    UploadItem *item = &(*items)[item_index];
+    for (int attempt = 0; ; ++attempt) {
+      item->response_body.clear();
+      item->success = SendRequestOnConnection(connection.get(), path, secure,
+                                              item->parameters,
+                                              item->upload_file,
+                                              file_part_name,
+                                              timeout,
+                                              &item->response_body,
+                                              &item->response_code);
+      if (item->success || attempt >= max_retries) {
+        break;
+      }
+      if (item->response_code >= 400 && item->response_code < 500) {
+        // The server has authoritatively rejected this upload; trying
+        // again will not change its mind.
+        break;
+      }
+      Sleep((attempt < 6 ? 1 << attempt : 64) * 1000);
+    }
+    all_succeeded = all_succeeded && item->success;
+  }
+
+  return all_succeeded;
+}
+
+// static
+bool HTTPUpload::FilterPresentSymbols(const wstring &check_url,
+                                      int *timeout,
+                                      vector<UploadItem> *items,
+                                      size_t *skipped_count) {
+  assert(items);
+  if (skipped_count) {
+    *skipped_count = 0;
+  }
+  if (items->empty()) {
+    return true;
+  }
+
+  // One line per upload the server might already have.
+  string query_body;
+  for (size_t item_index = 0; item_index < items->size(); ++item_index) {
+    wstring key;
+    if (PresenceKeyForParameters((*items)[item_index].parameters, &key)) {
+      query_body += WideToUTF8(key) + "\n";
+    }
+  }
+  if (query_body.empty()) {
+    return true;
+  }
+
+  // Break up the URL and make sure we can handle it
+  wchar_t scheme[16], host[256], path[256];
+  URL_COMPONENTS components;
+  memset(&components, 0, sizeof(components));
+  components.dwStructSize = sizeof(components);
+  components.lpszScheme = scheme;
+  components.dwSchemeLength = sizeof(scheme) / sizeof(scheme[0]);
+  components.lpszHostName = host;
+  components.dwHostNameLength = sizeof(host) / sizeof(host[0]);
+  components.lpszUrlPath = path;
+  components.dwUrlPathLength = sizeof(path) / sizeof(path[0]);
+  if (!InternetCrackUrl(check_url.c_str(),
+                        static_cast<DWORD>(check_url.size()),
+                        0, &components)) {
+    return false;
+  }
+  bool secure = false;
+  if (wcscmp(scheme, L"https") == 0) {
+    secure = true;
+  } else if (wcscmp(scheme, L"http") != 0) {
+    return false;
+  }
+
+  AutoInternetHandle internet(InternetOpen(kUserAgent,
+                                           INTERNET_OPEN_TYPE_PRECONFIG,
+                                           NULL,  // proxy name
+                                           NULL,  // proxy bypass
+                                           0));   // flags
+  if (!internet.get()) {
+    return false;
+  }
+
+  AutoInternetHandle connection(InternetConnect(internet.get(),
+                                                host,
+                                                components.nPort,
+                                                NULL,    // user name
+                                                NULL,    // password
+                                                INTERNET_SERVICE_HTTP,
+                                                0,       // flags
+                                                NULL));  // context
+  if (!connection.get()) {
+    return false;
+  }
+
+  DWORD http_open_flags = secure ? INTERNET_FLAG_SECURE : 0;
+  http_open_flags |= INTERNET_FLAG_NO_COOKIES;
+  AutoInternetHandle request(HttpOpenRequest(connection.get(),
+                                             L"POST",
+                                             path,
+                                             NULL,    // version
+                                             NULL,    // referer
+                                             NULL,    // agent type
+                                             http_open_flags,
+                                             NULL));  // context
+  if (!request.get()) {
+    return false;
+  }
+
+  // A plain POST rather than a multipart form: the query is a few
+  // lines of text, and the server only has to read them back.
+  HttpAddRequestHeaders(request.get(),
+                        L"Content-Type: text/plain",
+                        static_cast<DWORD>(-1),
+                        HTTP_ADDREQ_FLAG_ADD);
+
+  if (timeout) {
+    if (!InternetSetOption(request.get(),
+                           INTERNET_OPTION_SEND_TIMEOUT,
+                           timeout,
+                           sizeof(*timeout))) {
+      fwprintf(stderr, L"Could not unset send timeout, continuing...\n");
+    }
+
+    if (!InternetSetOption(request.get(),
+                           INTERNET_OPTION_RECEIVE_TIMEOUT,
+                           timeout,
+                           sizeof(*timeout))) {
+      fwprintf(stderr, L"Could not unset receive timeout, continuing...\n");
+    }
+  }
+
+  if (!HttpSendRequest(request.get(), NULL, 0,
+                       const_cast<char *>(query_body.data()),
+                       static_cast<DWORD>(query_body.size()))) {
+    return false;
+  }
+
+  // A server without the presence endpoint answers 404; treat anything
+  // but 200 as a failed query, and the caller uploads everything as it
+  // would have without the check.
+  wchar_t http_status[4];
+  DWORD http_status_size = sizeof(http_status);
+  if (!HttpQueryInfo(request.get(), HTTP_QUERY_STATUS_CODE,
+                     static_cast<LPVOID>(&http_status), &http_status_size,
+                     0)) {
+    return false;
+  }
+  if (wcstol(http_status, NULL, 10) != 200) {
+    return false;
+  }
+
+  wstring response_body;
+  if (!ReadResponse(request.get(), &response_body)) {
+    return false;
+  }
+
+  // The response repeats the lines for the symbols the server has.
+  std::set<wstring> present;
+  wstring::size_type line_start = 0;
+  while (line_start < response_body.size()) {
+    wstring::size_type line_end = response_body.find(L'\n', line_start);
+    if (line_end == wstring::npos) {
+      line_end = response_body.size();
+    }
+    wstring line = response_body.substr(line_start, line_end - line_start);
+    if (!line.empty() && line[line.size() - 1] == L'\r') {
+      line.resize(line.size() - 1);
+    }
+    if (!line.empty()) {
+      present.insert(line);
+    }
+    line_start = line_end + 1;
+  }
+
+  size_t kept_count = 0;
+  for (size_t item_index = 0; item_index < items->size(); ++item_index) {
+    wstring key;
+    if (PresenceKeyForParameters((*items)[item_index].parameters, &key) &&
+        present.find(key) != present.end()) {
+      continue;
+    }
+    if (kept_count != item_index) {
+      (*items)[kept_count] = (*items)[item_index];
+    }
+    ++kept_count;
+  }
+  if (skipped_count) {
+    *skipped_count = items->size() - kept_count;
+  }
+  items->resize(kept_count);
+  return true;
+}
+
+// static
+bool HTTPUpload::PresenceKeyForParameters(
+    const map<wstring, wstring> &parameters,
+    wstring *key) {
+  map<wstring, wstring>::const_iterator debug_file =
+      parameters.find(L"debug_file");
+  map<wstring, wstring>::const_iterator debug_identifier =
+      parameters.find(L"debug_identifier");
+  if (debug_file == parameters.end() ||
+      debug_identifier == parameters.end()) {
+    return false;
+  }
+  *key = debug_file->second + L" " + debug_identifier->second;
+  return true;
+}
+
 // static
 bool HTTPUpload::ReadResponse(HINTERNET request, wstring *response) {
   bool has_content_length_header = false;
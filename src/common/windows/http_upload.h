@@ -73,9 +73,64 @@ class HTTPUpload {
                           wstring *response_body,
                           int *response_code);
 
+  // One file in a SendBatch upload.  parameters and upload_file are
+  // inputs; the remaining fields are outputs with the same meanings
+  // as the corresponding SendRequest arguments.
+  struct UploadItem {
+    map<wstring, wstring> parameters;
+    wstring upload_file;
+    bool success;
+    wstring response_body;
+    int response_code;
+  };
+
+  // Uploads every entry in |items| to |url| as SendRequest would, but
+  // opens the WinInet session and server connection once for the whole
+  // batch and issues keep-alive requests over it, instead of paying
+  // for a fresh session, connection, and TLS handshake per file.
+  // Failed uploads are retried up to |max_retries| additional times
+  // with exponential backoff; responses in the 4xx range are treated
+  // as permanent and are not retried.  Returns true only if every
+  // item succeeded; per-item results are left in the items.
+  static bool SendBatch(const wstring &url,
+                        const wstring &file_part_name,
+                        int *timeout,
+                        int max_retries,
+                        vector<UploadItem> *items);
+
+  // Asks the symbol server which of |items| it already has and removes
+  // those items from the vector, so only the missing symbols get
+  // uploaded.  The query is a text/plain POST to |check_url| with one
+  // "debug_file debug_identifier" line per item; the server answers
+  // 200 with the subset of those lines naming symbols it already
+  // stores.  Items missing either field are never removed.  If the
+  // query fails for any reason (including a server without the
+  // endpoint), |items| is left untouched and false is returned, so the
+  // caller can fall back to uploading everything.  |skipped_count|,
+  // when non-NULL, receives the number of items removed.
+  static bool FilterPresentSymbols(const wstring &check_url,
+                                   int *timeout,
+                                   vector<UploadItem> *items,
+                                   size_t *skipped_count);
+
  private:
   class AutoInternetHandle;
 
+  // Sends one multipart POST over |connection|, an InternetConnect
+  // handle for the target server, with the keep-alive flag set so the
+  // underlying connection can carry subsequent requests.  |path| and
+  // |secure| come from cracking the request URL.  The remaining
+  // arguments match SendRequest.
+  static bool SendRequestOnConnection(HINTERNET connection,
+                                      const wchar_t *path,
+                                      bool secure,
+                                      const map<wstring, wstring> &parameters,
+                                      const wstring &upload_file,
+                                      const wstring &file_part_name,
+                                      int *timeout,
+                                      wstring *response_body,
+                                      int *response_code);
+
   // Retrieves the HTTP response.  If NULL is passed in for response,
   // this merely checks (via the return value) that we were successfully
   // able to retrieve exactly as many bytes of content in the response as
@@ -100,6 +155,13 @@ class HTTPUpload {
   // Fills the supplied vector with the contents of filename.
   static bool GetFileContents(const wstring &filename, vector<char> *contents);
 
+  // Builds the "debug_file debug_identifier" line identifying one
+  // upload in a symbol presence query.  Returns false if either field
+  // is missing from |parameters|, in which case the upload cannot be
+  // queried and must always be sent.
+  static bool PresenceKeyForParameters(const map<wstring, wstring> &parameters,
+                                       wstring *key);
+
   // Converts a UTF8 string to UTF16.
   static wstring UTF8ToWide(const string &utf8);
 
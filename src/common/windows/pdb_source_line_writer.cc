@@ -30,6 +30,7 @@
 #include <atlbase.h>
 #include <dia2.h>
 #include <ImageHlp.h>
+#include <stdarg.h>
 #include <stdio.h>
 
 #include "common/windows/string_utils-inl.h"
@@ -47,6 +48,16 @@ namespace google_breakpad {
 
 using std::vector;
 
+// Flush output_buffer_ to the output stream once it holds this much
+// data, so a conversion costs a handful of large writes rather than a
+// locked CRT call per record.
+static const size_t kOutputBufferSize = 1024 * 1024;
+
+// The number of IDiaLineNumber interfaces to pull from a DIA line
+// enumerator per Next call.  Fetching rows one at a time makes the
+// COM call overhead dominate PrintLines, the hottest loop here.
+static const ULONG kDiaLineBatchSize = 128;
+
 // A helper class to scope a PLOADED_IMAGE.
 class AutoImage {
  public:
@@ -127,38 +138,67 @@ bool PDBSourceLineWriter::Open(const wstring &file, FileFormat format) {
 bool PDBSourceLineWriter::PrintLines(IDiaEnumLineNumbers *lines) {
   // The line number format is:
   // <rva> <line number> <source file id>
-  CComPtr<IDiaLineNumber> line;
+  IDiaLineNumber *line_batch[kDiaLineBatchSize];
   ULONG count;
 
-  while (SUCCEEDED(lines->Next(1, &line, &count)) && count == 1) {
-    DWORD rva;
-    if (FAILED(line->get_relativeVirtualAddress(&rva))) {
-      fprintf(stderr, "failed to get line rva\n");
-      return false;
-    }
+  while (SUCCEEDED(lines->Next(kDiaLineBatchSize, line_batch, &count)) &&
+         count > 0) {
+    bool ok = true;
+    for (ULONG i = 0; i < count; i++) {
+      // The enumerator transferred a reference on every interface in
+      // the batch to us; adopt each one so the whole batch is released
+      // even after a failed row.
+      CComPtr<IDiaLineNumber> line;
+      line.Attach(line_batch[i]);
+      if (!ok) {
+        continue;
+      }
 
-    DWORD length;
-    if (FAILED(line->get_length(&length))) {
-      fprintf(stderr, "failed to get line code length\n");
-      return false;
-    }
+      DWORD rva;
+      if (FAILED(line->get_relativeVirtualAddress(&rva))) {
+        fprintf(stderr, "failed to get line rva\n");
+        ok = false;
+        continue;
+      }
 
-    DWORD dia_source_id;
-    if (FAILED(line->get_sourceFileId(&dia_source_id))) {
-      fprintf(stderr, "failed to get line source file id\n");
-      return false;
-    }
-    // duplicate file names are coalesced to share one ID
-    DWORD source_id = GetRealFileID(dia_source_id);
+      DWORD length;
+      if (FAILED(line->get_length(&length))) {
+        fprintf(stderr, "failed to get line code length\n");
+        ok = false;
+        continue;
+      }
 
-    DWORD line_num;
-    if (FAILED(line->get_lineNumber(&line_num))) {
-      fprintf(stderr, "failed to get line number\n");
+      DWORD dia_source_id;
+      if (FAILED(line->get_sourceFileId(&dia_source_id))) {
+        fprintf(stderr, "failed to get line source file id\n");
+        ok = false;
+        continue;
+      }
+      // duplicate file names are coalesced to share one ID
+      DWORD source_id = GetRealFileID(dia_source_id);
+
+      DWORD line_num;
+      if (FAILED(line->get_lineNumber(&line_num))) {
+        fprintf(stderr, "failed to get line number\n");
+        ok = false;
+        continue;
+      }
+
+      AppendHex(rva);
+      AppendChar(' ');
+      AppendHex(length);
+      AppendChar(' ');
+      AppendDec(line_num);
+      AppendChar(' ');
+      AppendDec(source_id);
+      AppendChar('\n');
+      if (output_buffer_.size() >= kOutputBufferSize) {
+        FlushOutputBuffer();
+      }
+    }
+    if (!ok) {
       return false;
     }
-
-    fprintf(output_, "%x %x %d %d\n", rva, length, line_num, source_id);
-    line.Release();
   }
   return true;
 }
@@ -196,8 +236,8 @@ bool PDBSourceLineWriter::PrintFunction(IDiaSymbol *function,
     stack_param_size = GetFunctionStackParamSize(function);
   }
 
-  fprintf(output_, "FUNC %x %" WIN_STRING_FORMAT_LL "x %x %ws\n",
-          rva, length, stack_param_size, name);
+  AppendFormat("FUNC %x %" WIN_STRING_FORMAT_LL "x %x %ws\n",
+               rva, length, stack_param_size, name);
 
   CComPtr<IDiaEnumLineNumbers> lines;
   if (FAILED(session_->findLinesByRVA(rva, DWORD(length), &lines))) {
@@ -247,7 +287,7 @@ bool PDBSourceLineWriter::PrintSourceFiles() {
       if (!FileIDIsCached(file_name_string)) {
         // this is a new file name, cache it and output a FILE line.
         CacheFileID(file_name_string, file_id);
-        fwprintf(output_, L"FILE %d %s\n", file_id, file_name);
+        AppendFormat("FILE %d %ws\n", file_id, file_name);
       } else {
         // this file name has already been seen, just save this
         // ID for later lookup.
@@ -460,14 +500,14 @@ bool PDBSourceLineWriter::PrintFrameData() {
     // this check reduces the size of the dumped symbol file by a third.
     if (type != last_type || rva != last_rva || code_size != last_code_size ||
         prolog_size != last_prolog_size) {
-      fprintf(output_, "STACK WIN %x %x %x %x %x %x %x %x %x %d ",
-              type, rva, code_size, prolog_size, epilog_size,
-              parameter_size, saved_register_size, local_size, max_stack_size,
-              program_string_result == S_OK);
+      AppendFormat("STACK WIN %x %x %x %x %x %x %x %x %x %d ",
+                   type, rva, code_size, prolog_size, epilog_size,
+                   parameter_size, saved_register_size, local_size,
+                   max_stack_size, program_string_result == S_OK);
       if (program_string_result == S_OK) {
-        fprintf(output_, "%ws\n", program_string);
+        AppendFormat("%ws\n", program_string);
       } else {
-        fprintf(output_, "%d\n", allocates_base_pointer);
+        AppendFormat("%d\n", allocates_base_pointer);
       }
 
       last_type = type;
@@ -502,8 +542,8 @@ bool PDBSourceLineWriter::PrintCodePublicSymbol(IDiaSymbol *symbol) {
     return false;
   }
 
-  fprintf(output_, "PUBLIC %x %x %ws\n", rva,
-          stack_param_size > 0 ? stack_param_size : 0, name);
+  AppendFormat("PUBLIC %x %x %ws\n", rva,
+               stack_param_size > 0 ? stack_param_size : 0, name);
   return true;
 }
 
@@ -516,9 +556,9 @@ bool PDBSourceLineWriter::PrintPDBInfo() {
   // Hard-code "windows" for the OS because that's the only thing that makes
   // sense for PDB files.  (This might not be strictly correct for Windows CE
   // support, but we don't care about that at the moment.)
-  fprintf(output_, "MODULE windows %ws %ws %ws\n",
-          info.cpu.c_str(), info.debug_identifier.c_str(),
-          info.debug_file.c_str());
+  AppendFormat("MODULE windows %ws %ws %ws\n",
+               info.cpu.c_str(), info.debug_identifier.c_str(),
+               info.debug_file.c_str());
 
   return true;
 }
@@ -529,9 +569,9 @@ bool PDBSourceLineWriter::PrintPEInfo() {
     return false;
   }
 
-  fprintf(output_, "INFO CODE_ID %ws %ws\n",
-	  info.code_identifier.c_str(),
-	  info.code_file.c_str());
+  AppendFormat("INFO CODE_ID %ws %ws\n",
+	       info.code_identifier.c_str(),
+	       info.code_file.c_str());
   return true;
 }
 
@@ -800,17 +840,81 @@ next_child:
   return param_size;
 }
 
+void PDBSourceLineWriter::AppendFormat(const char *format, ...) {
+  // Most records fit in the stack buffer; when one doesn't (very long
+  // decorated names), size it exactly and format again.
+  char stack_buffer[512];
+  va_list args;
+  va_start(args, format);
+  int length = _vsnprintf(stack_buffer, sizeof(stack_buffer), format, args);
+  va_end(args);
+  if (length >= 0 && length <= static_cast<int>(sizeof(stack_buffer))) {
+    output_buffer_.append(stack_buffer, length);
+  } else {
+    va_start(args, format);
+    length = _vscprintf(format, args);
+    va_end(args);
+    if (length > 0) {
+      vector<char> heap_buffer(length + 1);
+      va_start(args, format);
+      _vsnprintf(&heap_buffer[0], heap_buffer.size(), format, args);
+      va_end(args);
+      output_buffer_.append(&heap_buffer[0], length);
+    }
+  }
+  if (output_buffer_.size() >= kOutputBufferSize) {
+    FlushOutputBuffer();
+  }
+}
+
+void PDBSourceLineWriter::AppendHex(DWORD value) {
+  static const char hex_digits[] = "0123456789abcdef";
+  char digits[2 * sizeof(value)];
+  char *digit = digits + sizeof(digits);
+  do {
+    *--digit = hex_digits[value & 0xf];
+    value >>= 4;
+  } while (value != 0);
+  output_buffer_.append(digit, digits + sizeof(digits) - digit);
+}
+
+void PDBSourceLineWriter::AppendDec(DWORD value) {
+  char digits[10];
+  char *digit = digits + sizeof(digits);
+  do {
+    *--digit = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  output_buffer_.append(digit, digits + sizeof(digits) - digit);
+}
+
+bool PDBSourceLineWriter::FlushOutputBuffer() {
+  if (output_buffer_.empty()) {
+    return true;
+  }
+  size_t written = fwrite(output_buffer_.data(), 1, output_buffer_.size(),
+                          output_);
+  bool ret = written == output_buffer_.size();
+  output_buffer_.clear();
+  return ret;
+}
+
 bool PDBSourceLineWriter::WriteMap(FILE *map_file) {
   output_ = map_file;
+  output_buffer_.clear();
+  output_buffer_.reserve(kOutputBufferSize);
 
   bool ret = PrintPDBInfo();
   // This is not a critical piece of the symbol file.
   PrintPEInfo();
   ret = ret &&
-    PrintSourceFiles() && 
+    PrintSourceFiles() &&
     PrintFunctions() &&
     PrintFrameData();
 
+  // The Print* methods above wrote into output_buffer_; push whatever
+  // is still buffered out to the stream.
+  ret = FlushOutputBuffer() && ret;
   output_ = NULL;
   return ret;
 }
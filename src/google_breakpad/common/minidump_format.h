@@ -233,6 +233,10 @@ typedef struct {
  * MDRawHeader is at offset 0. */
 typedef uint32_t MDRVA;  /* RVA */
 
+/* An MDRVA64 is a 64-bit offset into the minidump file, used where the
+ * file may exceed the 4GB reach of an MDRVA (full-memory dumps). */
+typedef uint64_t MDRVA64;  /* RVA64 */
+
 typedef struct {
   uint32_t  data_size;
   MDRVA     rva;
@@ -248,6 +252,19 @@ typedef struct {
 } MDMemoryDescriptor;  /* MINIDUMP_MEMORY_DESCRIPTOR */
 
 
+typedef struct {
+  /* The base address of the memory range on the host that produced the
+   * minidump. */
+  uint64_t  start_of_memory_range;
+
+  /* The size of the range.  There is no per-range file location: the
+   * ranges' contents are laid out contiguously in the file starting at
+   * the base_rva of the MDRawMemory64List that carries the descriptor,
+   * in descriptor order. */
+  uint64_t  data_size;
+} MDMemoryDescriptor64;  /* MINIDUMP_MEMORY_DESCRIPTOR64 */
+
+
 typedef struct {
   uint32_t  signature;
   uint32_t  version;
@@ -341,7 +358,8 @@ typedef enum {
   MD_LINUX_ENVIRON               = 0x47670007,  /* /proc/$x/environ   */
   MD_LINUX_AUXV                  = 0x47670008,  /* /proc/$x/auxv      */
   MD_LINUX_MAPS                  = 0x47670009,  /* /proc/$x/maps      */
-  MD_LINUX_DSO_DEBUG             = 0x4767000A   /* MDRawDebug         */
+  MD_LINUX_DSO_DEBUG             = 0x4767000A,  /* MDRawDebug         */
+  MD_IP_TRACE_STREAM             = 0x4767000B   /* MDRawIPTrace       */
 } MDStreamType;  /* MINIDUMP_STREAM_TYPE */
 
 
@@ -509,6 +527,19 @@ static const size_t MDRawMemoryList_minsize = offsetof(MDRawMemoryList,
                                                        memory_ranges[0]);
 
 
+typedef struct {
+  uint64_t             number_of_memory_ranges;
+  MDRVA64              base_rva;            /* Start of the contiguous
+                                             * memory payload; range i's
+                                             * bytes follow range i-1's
+                                             * immediately. */
+  MDMemoryDescriptor64 memory_ranges[1];
+} MDRawMemory64List;  /* MINIDUMP_MEMORY64_LIST */
+
+static const size_t MDRawMemory64List_minsize = offsetof(MDRawMemory64List,
+                                                         memory_ranges[0]);
+
+
 #define MD_EXCEPTION_MAXIMUM_PARAMETERS 15
 
 typedef struct {
@@ -784,6 +815,20 @@ typedef struct {
   uint32_t type;
 } MDRawAssertionInfo;
 
+/* The header of an MD_IP_TRACE_STREAM, a Breakpad extension recording
+ * the instruction pointers of one thread's frame-pointer chain as
+ * captured by the client at crash time.  The header is immediately
+ * followed by ip_count uint64_t instruction pointers, callee first:
+ * the first entry is the faulting instruction pointer and each
+ * subsequent entry is a return address recovered by following the
+ * chain of saved frame pointers.  A processor that trusts the chain
+ * can symbolize these directly instead of walking the thread's
+ * stack. */
+typedef struct {
+  uint32_t thread_id;  /* Thread whose frame-pointer chain was captured */
+  uint32_t ip_count;   /* Number of instruction pointers that follow */
+} MDRawIPTrace;
+
 /* For (MDRawAssertionInfo).type: */
 typedef enum {
   MD_ASSERTION_INFO_TYPE_UNKNOWN = 0,
@@ -93,6 +93,12 @@ class minidump_size<MDRawMemoryList> {
   static size_t size() { return MDRawMemoryList_minsize; }
 };
 
+template<>
+class minidump_size<MDRawMemory64List> {
+ public:
+  static size_t size() { return MDRawMemory64List_minsize; }
+};
+
 // Explicit specialization for MDRawModule, for which sizeof may include
 // tail-padding on some architectures but not others.
 
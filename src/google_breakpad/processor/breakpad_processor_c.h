@@ -0,0 +1,253 @@
+/* Copyright (c) 2010 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* breakpad_processor_c.h: A stable C API for embedding the minidump
+ * processor.
+ *
+ * Services that are not written in C++ have had to shell out to
+ * minidump_stackwalk per dump, paying a process spawn, a full symbol
+ * reload, and stdout parsing every time.  This header wraps
+ * MinidumpProcessor::Process, ProcessState, and the batch session in
+ * plain C so such services can link the processor (see the
+ * libbreakpad_processor.so target) and process dumps in-process, with
+ * symbol caches that persist across dumps.
+ *
+ * Usage outline:
+ *
+ *   bp_processor* processor = bp_processor_create("/symbols");
+ *   bp_state* state = NULL;
+ *   if (bp_processor_process_file(processor, "crash.dmp", &state)
+ *       == BP_PROCESS_OK) {
+ *     ... bp_state_* and bp_frame_* accessors ...
+ *     bp_state_destroy(state);
+ *   }
+ *   bp_processor_destroy(processor);
+ *
+ * All functions are thread-compatible: one bp_processor (and each state
+ * or batch derived from it) may only be used from one thread at a time,
+ * but distinct processors are fully independent.  Internal worker
+ * threads (bp_processor_set_max_worker_threads and the batch session)
+ * are managed by the library.
+ *
+ * Strings returned by accessors are owned by the bp_state they were
+ * read from and remain valid until it is destroyed; they are never
+ * NULL unless documented otherwise.  A bp_state obtained from a batch
+ * is owned by the batch instead and must not be destroyed by the
+ * caller.
+ */
+
+#ifndef GOOGLE_BREAKPAD_PROCESSOR_BREAKPAD_PROCESSOR_C_H__
+#define GOOGLE_BREAKPAD_PROCESSOR_BREAKPAD_PROCESSOR_C_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A long-lived processing context: symbol supplier, resolver, and
+ * processor.  Symbols loaded while processing one dump stay loaded for
+ * every later dump processed through the same bp_processor. */
+typedef struct bp_processor bp_processor;
+
+/* One processed dump: the C view of a ProcessState. */
+typedef struct bp_state bp_state;
+
+/* A batch session processing many dumps through the processor's shared
+ * symbol caches, optionally on worker threads. */
+typedef struct bp_batch bp_batch;
+
+/* Result of processing one dump.  Mirrors
+ * google_breakpad::ProcessResult value for value. */
+typedef enum {
+  BP_PROCESS_OK = 0,
+  BP_PROCESS_ERROR_MINIDUMP_NOT_FOUND,
+  BP_PROCESS_ERROR_NO_MINIDUMP_HEADER,
+  BP_PROCESS_ERROR_NO_THREAD_LIST,
+  BP_PROCESS_ERROR_GETTING_THREAD,
+  BP_PROCESS_ERROR_GETTING_THREAD_ID,
+  BP_PROCESS_ERROR_DUPLICATE_REQUESTING_THREADS,
+  BP_PROCESS_SYMBOL_SUPPLIER_INTERRUPTED,
+  /* Not part of ProcessResult: a NULL handle or out-of-range index was
+   * passed to this API. */
+  BP_PROCESS_ERROR_INVALID_ARGUMENT = 100
+} bp_process_result;
+
+/* How a frame's instruction pointer was recovered.  Mirrors
+ * google_breakpad::StackFrame::FrameTrust value for value; larger is
+ * more trustworthy. */
+typedef enum {
+  BP_FRAME_TRUST_NONE = 0,
+  BP_FRAME_TRUST_SCAN,
+  BP_FRAME_TRUST_CFI_SCAN,
+  BP_FRAME_TRUST_FP,
+  BP_FRAME_TRUST_CFI,
+  BP_FRAME_TRUST_CONTEXT
+} bp_frame_trust;
+
+/* Creates a processor.  symbol_path names the root directory of a
+ * symbol store laid out as the simple symbol supplier expects
+ * (<debug file>/<debug identifier>/<debug file base>.sym); pass NULL to
+ * process without symbols.  Returns NULL on allocation failure. */
+bp_processor* bp_processor_create(const char* symbol_path);
+
+void bp_processor_destroy(bp_processor* processor);
+
+/* Walks each dump's threads on up to this many worker threads.  The
+ * default of 1 walks on the calling thread.  Honored where pthreads
+ * are available. */
+void bp_processor_set_max_worker_threads(bp_processor* processor,
+                                         unsigned int max_worker_threads);
+
+/* Caps the stack-walking time per dump in milliseconds; stacks still
+ * being walked when the budget expires are reported truncated.  0, the
+ * default, applies no budget. */
+void bp_processor_set_time_budget_ms(bp_processor* processor,
+                                     unsigned int budget_ms);
+
+/* Processes the minidump in the named file.  On BP_PROCESS_OK, *state
+ * receives a new bp_state the caller owns and must destroy. */
+bp_process_result bp_processor_process_file(bp_processor* processor,
+                                            const char* minidump_file,
+                                            bp_state** state);
+
+/* As bp_processor_process_file, for a minidump already in memory.  The
+ * buffer is only read during this call. */
+bp_process_result bp_processor_process_buffer(bp_processor* processor,
+                                              const void* data,
+                                              size_t size,
+                                              bp_state** state);
+
+void bp_state_destroy(bp_state* state);
+
+/* Crash information. */
+int bp_state_crashed(const bp_state* state);
+const char* bp_state_crash_reason(const bp_state* state);
+unsigned long long bp_state_crash_address(const bp_state* state);
+const char* bp_state_assertion(const bp_state* state);
+/* Index of the crashing (or dump-requesting) thread, or -1. */
+int bp_state_requesting_thread(const bp_state* state);
+
+/* System information. */
+const char* bp_state_os(const bp_state* state);
+const char* bp_state_os_version(const bp_state* state);
+const char* bp_state_cpu(const bp_state* state);
+const char* bp_state_cpu_info(const bp_state* state);
+unsigned int bp_state_cpu_count(const bp_state* state);
+
+/* Threads and frames.  thread_index < bp_state_thread_count and
+ * frame_index < bp_state_frame_count for that thread; out-of-range
+ * indices read as zero/NULL. */
+unsigned int bp_state_thread_count(const bp_state* state);
+unsigned int bp_state_frame_count(const bp_state* state,
+                                  unsigned int thread_index);
+/* Nonzero if the thread's walk stopped early (time budget or frame
+ * limit), so outer callers may be missing. */
+int bp_state_thread_truncated(const bp_state* state,
+                              unsigned int thread_index);
+
+unsigned long long bp_frame_instruction(const bp_state* state,
+                                        unsigned int thread_index,
+                                        unsigned int frame_index);
+/* NULL when the frame has no symbols. */
+const char* bp_frame_function_name(const bp_state* state,
+                                   unsigned int thread_index,
+                                   unsigned int frame_index);
+unsigned long long bp_frame_function_base(const bp_state* state,
+                                          unsigned int thread_index,
+                                          unsigned int frame_index);
+/* NULL when no source line information was found. */
+const char* bp_frame_source_file(const bp_state* state,
+                                 unsigned int thread_index,
+                                 unsigned int frame_index);
+int bp_frame_source_line(const bp_state* state,
+                         unsigned int thread_index,
+                         unsigned int frame_index);
+bp_frame_trust bp_frame_get_trust(const bp_state* state,
+                                  unsigned int thread_index,
+                                  unsigned int frame_index);
+/* Index into the state's module list of the module containing the
+ * frame's instruction, or -1 if none. */
+int bp_frame_module(const bp_state* state,
+                    unsigned int thread_index,
+                    unsigned int frame_index);
+
+/* Loaded modules. */
+unsigned int bp_state_module_count(const bp_state* state);
+const char* bp_module_code_file(const bp_state* state,
+                                unsigned int module_index);
+const char* bp_module_debug_file(const bp_state* state,
+                                 unsigned int module_index);
+const char* bp_module_debug_identifier(const bp_state* state,
+                                       unsigned int module_index);
+unsigned long long bp_module_base_address(const bp_state* state,
+                                          unsigned int module_index);
+unsigned long long bp_module_size(const bp_state* state,
+                                  unsigned int module_index);
+/* Nonzero if no symbols were found for the module while processing. */
+int bp_module_missing_symbols(const bp_state* state,
+                              unsigned int module_index);
+
+/* Batch sessions.  A batch borrows the processor's symbolizer, so
+ * modules loaded for one dump serve every other dump in the batch (and
+ * later single-dump calls).  The processor must outlive the batch, and
+ * the batch owns every bp_state it returns. */
+bp_batch* bp_batch_create(bp_processor* processor);
+
+void bp_batch_destroy(bp_batch* batch);
+
+/* Processes up to this many of the batch's dumps concurrently.  The
+ * default is 1. */
+void bp_batch_set_max_worker_threads(bp_batch* batch,
+                                     unsigned int max_worker_threads);
+
+/* Adds a dump file to the batch and returns its index, by which its
+ * result and state are read back after bp_batch_process_all. */
+size_t bp_batch_add_file(bp_batch* batch, const char* minidump_file);
+
+size_t bp_batch_dump_count(const bp_batch* batch);
+
+/* Processes every dump added so far and returns the number that
+ * processed with BP_PROCESS_OK.  May be called again after adding more
+ * dumps; dumps already processed are not reprocessed. */
+size_t bp_batch_process_all(bp_batch* batch);
+
+bp_process_result bp_batch_result(const bp_batch* batch, size_t index);
+
+/* The state for one processed dump, or NULL if it did not process with
+ * BP_PROCESS_OK.  Owned by the batch: valid until the batch is
+ * destroyed, and must not be passed to bp_state_destroy. */
+bp_state* bp_batch_state(bp_batch* batch, size_t index);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif  /* GOOGLE_BREAKPAD_PROCESSOR_BREAKPAD_PROCESSOR_C_H__ */
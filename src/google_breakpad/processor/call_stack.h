@@ -45,6 +45,8 @@
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_CALL_STACK_H__
 #define GOOGLE_BREAKPAD_PROCESSOR_CALL_STACK_H__
 
+#include <stddef.h>
+
 #include <vector>
 
 namespace google_breakpad {
@@ -54,9 +56,11 @@ using std::vector;
 struct StackFrame;
 template<typename T> class linked_ptr;
 
+class StackFrameArena;
+
 class CallStack {
  public:
-  CallStack() { Clear(); }
+  CallStack() : frames_(), arena_(NULL) { Clear(); }
   ~CallStack();
 
   // Resets the CallStack to its initial empty state
@@ -68,8 +72,27 @@ class CallStack {
   // Stackwalker is responsible for building the frames_ vector.
   friend class Stackwalker;
 
+  // MinidumpProcessor builds the frames directly when a dump carries a
+  // trusted client-captured IP trace; see
+  // ProcessingProfile::trust_ip_trace.
+  friend class MinidumpProcessor;
+
+  // ProcessStateSerializer rebuilds the frames_ vector when
+  // reconstructing a cached ProcessState.
+  friend class ProcessStateSerializer;
+
+  // Returns the arena that provides storage for this stack's frames,
+  // creating it on first use.  Frames are constructed in the arena by
+  // Stackwalker and destroyed by Clear; their storage is released
+  // wholesale rather than freed one frame at a time.
+  StackFrameArena* arena();
+
   // Storage for pushed frames.
   vector<StackFrame*> frames_;
+
+  // Arena owning the storage behind frames_.  NULL until arena() is
+  // first called.
+  StackFrameArena* arena_;
 };
 
 }  // namespace google_breakpad
@@ -44,6 +44,7 @@ namespace google_breakpad {
 
 class CodeModule {
  public:
+  CodeModule() : code_file_hash_(0) {}
   virtual ~CodeModule() {}
 
   // The base address of this code module as it was loaded by the process.
@@ -87,8 +88,41 @@ class CodeModule {
   // than the CodeModule being copied, but will behave identically to the
   // copied CodeModule as far as the CodeModule interface is concerned.
   virtual const CodeModule* Copy() const = 0;
+
+  // Returns a hash of code_file(), computed on the first call and cached.
+  // The source line resolvers key their module maps on this hash so that
+  // repeated per-frame lookups compare integers rather than path strings.
+  // Safe to call concurrently: racing threads compute and store the same
+  // value.
+  uint64_t code_file_hash() const;
+
+  // The hash function behind code_file_hash(), usable on a bare path.
+  // Never returns 0.
+  static uint64_t HashCodeFilePath(const string &path);
+
+ private:
+  // Cache for code_file_hash(); 0 means not yet computed.
+  mutable uint64_t code_file_hash_;
 };
 
+// static
+inline uint64_t CodeModule::HashCodeFilePath(const string &path) {
+  // 64-bit FNV-1a.
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < path.size(); ++i) {
+    hash ^= static_cast<unsigned char>(path[i]);
+    hash *= 1099511628211ULL;
+  }
+  // 0 is reserved to mean "not yet computed".
+  return hash ? hash : 1;
+}
+
+inline uint64_t CodeModule::code_file_hash() const {
+  if (code_file_hash_ == 0)
+    code_file_hash_ = HashCodeFilePath(code_file());
+  return code_file_hash_;
+}
+
 }  // namespace google_breakpad
 
 #endif  // GOOGLE_BREAKPAD_PROCESSOR_CODE_MODULE_H__
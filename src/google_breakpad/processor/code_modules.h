@@ -55,6 +55,14 @@ class CodeModules {
   // comparison with pointers returned by the other Get methods.
   virtual const CodeModule* GetModuleForAddress(uint64_t address) const = 0;
 
+  // Returns true if any module's code is present at |address|.  This is
+  // the membership test GetModuleForAddress implies, broken out so that
+  // hot callers such as the stackwalkers' return-address scan can use an
+  // implementation-provided fast path; the default simply delegates.
+  virtual bool IsTextAddress(uint64_t address) const {
+    return GetModuleForAddress(address) != 0;
+  }
+
   // Returns the module corresponding to the main executable.  If there is
   // no main executable, returns NULL.  Ownership of the returned CodeModule
   // is retained by the CodeModules object; pointers returned by this method
@@ -83,8 +91,10 @@ class CodeModules {
   virtual const CodeModule* GetModuleAtIndex(unsigned int index) const = 0;
 
   // Creates a new copy of this CodeModules object, which the caller takes
-  // ownership of.  The new object will also contain copies of the existing
-  // object's child CodeModule objects.  The new CodeModules object may be of
+  // ownership of.  The new object will either contain copies of the
+  // existing object's child CodeModule objects, or share immutable child
+  // objects with it; shared children remain valid for as long as any
+  // copy referencing them is alive.  The new CodeModules object may be of
   // a different concrete class than the object being copied, but will behave
   // identically to the copied object as far as the CodeModules and CodeModule
   // interfaces are concerned, except that the order that GetModuleAtIndex
@@ -68,6 +68,25 @@ class FastSourceLineResolver : public SourceLineResolverBase {
   using SourceLineResolverBase::LoadModuleUsingMemoryBuffer;
   using SourceLineResolverBase::UnloadModule;
 
+  // Loads symbols for module from the size bytes at data, which must be
+  // a serialized module container (see serialized_module_format.h) as
+  // produced by ModuleSerializer::SerializeToContainer or by
+  // dump_syms's binary output mode.  The container is validated and its
+  // payload loaded directly; no symbol text is parsed.  Returns false
+  // if the container is malformed or the module is already loaded.
+  bool LoadModuleFromContainer(const CodeModule *module,
+                               const char *data,
+                               size_t size);
+
+  // Loaded modules are backed by immutable serialized data and are
+  // shareable: lookups never mutate module state, apart from usage
+  // counters that advance atomically and a compiled-rule memo guarded
+  // by its own short-lived lock.  Only loads and unloads must be
+  // serialized against other calls.  StackFrameSymbolizer relies on
+  // this to resolve frames from several worker threads through one
+  // resolver without duplicating its symbol data.
+  virtual bool SupportsConcurrentLookups() const { return true; }
+
  private:
   // Friend declarations.
   friend class ModuleComparer;
@@ -39,6 +39,8 @@
 #define GOOGLE_BREAKPAD_PROCESSOR_MEMORY_REGION_H__
 
 
+#include <stddef.h>
+
 #include "google_breakpad/common/breakpad_types.h"
 
 
@@ -67,6 +69,18 @@ class MemoryRegion {
   virtual bool GetMemoryAtAddress(uint64_t address, uint16_t* value) const = 0;
   virtual bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const = 0;
   virtual bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const = 0;
+
+  // Returns a pointer to size bytes of the region's memory beginning at
+  // address, or NULL if [address, address + size) does not lie wholly
+  // within the region or the implementation cannot provide direct
+  // access to its bytes.  The bytes are as stored in the dump: unlike
+  // GetMemoryAtAddress, no byte swapping is performed.  Regions backed
+  // by in-memory buffers should override this so that callers examining
+  // many consecutive words can batch bounds checks or issue software
+  // prefetches; the default implementation returns NULL.
+  virtual const uint8_t* GetMemorySpan(uint64_t address, size_t size) const {
+    return NULL;
+  }
 };
 
 
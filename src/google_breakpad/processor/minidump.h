@@ -74,12 +74,21 @@
 // Minidump::ReadString will return a string object to the user, and the user
 // is responsible for its deletion.
 //
+// A memory-backed Minidump - one opened from a caller-supplied buffer,
+// or from a file with set_use_mmap enabled - may be read from multiple
+// threads at once: each thread gets its own read cursor, so concurrent
+// GetThreadList, GetMemoryList, and similar calls do not contend over a
+// shared file position, and the stream cache those calls populate is
+// guarded internally.  A stream-backed Minidump keeps its historical
+// single-cursor behavior and must not be used concurrently.
+//
 // Author: Mark Mentovai
 
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_MINIDUMP_H__
 #define GOOGLE_BREAKPAD_PROCESSOR_MINIDUMP_H__
 
 #ifndef _WIN32
+#include <pthread.h>
 #include <unistd.h>
 #endif
 
@@ -147,6 +156,11 @@ class MinidumpStream : public MinidumpObject {
   explicit MinidumpStream(Minidump* minidump);
 
  private:
+  // Minidump's stream cache invokes Read through a base-class pointer
+  // when populating a stream installed by RegisterStreamParser, where
+  // only this base type is known.
+  friend class Minidump;
+
   // Populate (and validate) the MinidumpStream.  minidump_ is expected
   // to be positioned at the beginning of the stream, so that the next
   // read from the minidump will be at the beginning of the stream.
@@ -182,6 +196,10 @@ class MinidumpContext : public MinidumpStream {
   // MDRawContext, since it varies per-CPU architecture.
   bool GetInstructionPointer(uint64_t* ip) const;
 
+  // A convenience method to get the stack pointer out of the
+  // MDRawContext, since it varies per-CPU architecture.
+  bool GetStackPointer(uint64_t* sp) const;
+
   // Returns raw CPU-specific context data for the named CPU type.  If the
   // context data does not match the CPU type or does not exist, returns
   // NULL.
@@ -246,6 +264,14 @@ class MinidumpMemoryRegion : public MinidumpObject,
   static void set_max_bytes(uint32_t max_bytes) { max_bytes_ = max_bytes; }
   static uint32_t max_bytes() { return max_bytes_; }
 
+  // The maximum number of bytes of a region's contents that Print will
+  // hex-dump; anything beyond is summarized as a byte count.  0 prints
+  // every byte, and is the default.
+  static void set_max_print_bytes(uint32_t max_print_bytes) {
+    max_print_bytes_ = max_print_bytes;
+  }
+  static uint32_t max_print_bytes() { return max_print_bytes_; }
+
   // Returns a pointer to the base of the memory region.  Returns the
   // cached value if available, otherwise, reads the minidump file and
   // caches the memory region.
@@ -254,7 +280,10 @@ class MinidumpMemoryRegion : public MinidumpObject,
   // The address of the base of the memory region.
   uint64_t GetBase() const;
 
-  // The size, in bytes, of the memory region.
+  // The size, in bytes, of the memory region.  Regions from a
+  // MD_MEMORY_64_LIST_STREAM may exceed 32 bits; such sizes are clamped
+  // to the largest uint32_t, though bounds checks within the region's
+  // accessors use the full 64-bit size.
   uint32_t GetSize() const;
 
   // Frees the cached memory region, if cached.
@@ -266,6 +295,18 @@ class MinidumpMemoryRegion : public MinidumpObject,
   bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const;
   bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const;
 
+  // Implements MemoryRegion::GetMemorySpan().
+  // Returns a pointer to size bytes of the region's memory beginning at
+  // address, or NULL if [address, address + size) does not lie wholly
+  // within the region or the memory cannot be read.  This allows callers
+  // that examine many consecutive words, such as stack scanners, to make
+  // a single bounds-checked request instead of one GetMemoryAtAddress
+  // call per word.  The pointer is valid until FreeMemory is called, or
+  // for the lifetime of the backing Minidump when it is memory-mapped.
+  // The bytes are as stored in the dump: as with GetMemory, no byte
+  // swapping is performed.
+  const uint8_t* GetMemorySpan(uint64_t address, size_t size) const;
+
   // Print a human-readable representation of the object to stdout.
   void Print();
 
@@ -280,20 +321,57 @@ class MinidumpMemoryRegion : public MinidumpObject,
   // location it may be found in the minidump file.
   void SetDescriptor(MDMemoryDescriptor* descriptor);
 
+  // As SetDescriptor, for a MD_MEMORY_64_LIST_STREAM descriptor.  Such
+  // descriptors carry no per-region file location: |file_offset| is the
+  // region's position within the list's contiguous payload, computed by
+  // the caller from the list's base_rva and the preceding regions'
+  // sizes, and may lie beyond 4GB.
+  void SetDescriptor64(const MDMemoryDescriptor64* descriptor,
+                       uint64_t file_offset);
+
   // Implementation for GetMemoryAtAddress
   template<typename T> bool GetMemoryAtAddressInternal(uint64_t address,
                                                        T*        value) const;
 
+  // For stream-backed dumps, reads and caches only the kPageSize-aligned
+  // window of the region containing [offset, offset + size), instead of
+  // the entire region.  Returns a pointer to the requested bytes within
+  // the cached page, or NULL if the request spans a page boundary or the
+  // page cannot be read; callers fall back to GetMemory.
+  const uint8_t* GetPageAtOffset(uint64_t offset, uint32_t size) const;
+
+  // The granularity of demand reads performed by GetPageAtOffset.
+  static const uint32_t kPageSize = 4096;
+
   // The largest memory region that will be read from a minidump.  The
   // default is 1MB.
   static uint32_t max_bytes_;
 
+  // See set_max_print_bytes.
+  static uint32_t max_print_bytes_;
+
   // Base address and size of the memory region, and its position in the
-  // minidump file.
-  MDMemoryDescriptor* descriptor_;
+  // minidump file, copied out of the descriptor by SetDescriptor or
+  // SetDescriptor64.  All three are 64-bit so that regions from a
+  // MD_MEMORY_64_LIST_STREAM, whose contiguous payload can place a
+  // region past the 4GB reach of an MDRVA, are addressed correctly.
+  uint64_t base_address_;
+  uint64_t region_size_;
+  uint64_t file_offset_;
 
   // Cached memory.
   mutable vector<uint8_t>* memory_;
+
+  // Sparse cache of pages read on demand by GetPageAtOffset, keyed by
+  // offset / kPageSize.  Only populated for stream-backed dumps when the
+  // region has not been fully cached in memory_.
+  mutable map<uint64_t, vector<uint8_t> >* pages_;
+
+  // When the Minidump is backed by a memory mapping, a pointer to this
+  // region's data within the mapping.  The pointed-to data is owned by
+  // the Minidump object; when set, memory_ is left unused and no copy
+  // is made.
+  mutable const uint8_t* mapped_memory_;
 };
 
 
@@ -448,8 +526,10 @@ class MinidumpModule : public MinidumpObject,
   void Print();
 
  private:
-  // These objects are managed by MinidumpModuleList.
+  // These objects are managed by MinidumpModuleList.  Minidump::ScanModules
+  // constructs short-lived instances directly.
   friend class MinidumpModuleList;
+  friend class Minidump;
 
   explicit MinidumpModule(Minidump* minidump);
 
@@ -466,6 +546,14 @@ class MinidumpModule : public MinidumpObject,
   // allow the CodeModule getters to be const methods.
   bool ReadAuxiliaryData();
 
+  // A cheaper alternative to ReadAuxiliaryData used by
+  // Minidump::ScanModules.  Reads the module name, and when
+  // |read_cv_record| is true the CodeView record, but never fetches the
+  // miscellaneous debugging record.  A module prepared this way serves
+  // code_file(), and - when the CodeView record was read - debug_file()
+  // and debug_identifier().
+  bool ReadLeanAuxiliaryData(bool read_cv_record);
+
   // The largest number of bytes that will be read from a minidump for a
   // CodeView record or miscellaneous debugging record, respectively.  The
   // default for each is 1024.
@@ -582,37 +670,82 @@ class MinidumpMemoryList : public MinidumpStream {
   // Sequential access to memory regions.
   MinidumpMemoryRegion* GetMemoryRegionAtIndex(unsigned int index);
 
-  // Random access to memory regions.  Returns the region encompassing
-  // the address identified by address.
+  // Random access to memory regions.  Returns the region backing the
+  // byte at the address identified by address.  Dumps from some Windows
+  // versions carry overlapping or duplicate memory descriptors; these
+  // are normalized into a clean interval index when the list is read,
+  // so where descriptors overlap each byte is attributed to exactly one
+  // of them, and the lookup still succeeds.
   MinidumpMemoryRegion* GetMemoryRegionForAddress(uint64_t address);
 
   // Print a human-readable representation of the object to stdout.
   void Print();
 
+ protected:
+  // |is_memory64| selects the descriptor format Read expects:
+  // MD_MEMORY_LIST_STREAM's 32-bit descriptors, or the 64-bit
+  // descriptors with a contiguous payload of MD_MEMORY_64_LIST_STREAM.
+  MinidumpMemoryList(Minidump* minidump, bool is_memory64);
+
  private:
   friend class Minidump;
 
   typedef vector<MDMemoryDescriptor>   MemoryDescriptors;
+  typedef vector<MDMemoryDescriptor64> MemoryDescriptors64;
   typedef vector<MinidumpMemoryRegion> MemoryRegions;
 
+  // One entry of the normalized interval index: a half-open byte range
+  // and the index of the descriptor that backs it.
+  struct MemoryInterval {
+    uint64_t     base_address;
+    uint64_t     size;
+    unsigned int region_index;
+  };
+  typedef vector<MemoryInterval> MemoryIntervals;
+
+  // Orders intervals for the normalization sweep in Read: by base
+  // address, with the largest interval first among those sharing a base
+  // so that it shadows the others.
+  static bool IntervalBeforeInterval(const MemoryInterval& left,
+                                     const MemoryInterval& right);
+
+  // Comparator for the binary search in GetMemoryRegionForAddress.
+  static bool AddressBeforeInterval(uint64_t address,
+                                    const MemoryInterval& interval);
+
   static const uint32_t kStreamType = MD_MEMORY_LIST_STREAM;
 
   explicit MinidumpMemoryList(Minidump* minidump);
 
   bool Read(uint32_t expected_size);
 
+  // The format-specific halves of Read: parse the stream's descriptor
+  // list and point *regions at the minidump file, leaving the regions'
+  // contents to be read on demand.  On success, return true and set
+  // *region_count.
+  bool ReadDescriptors(uint32_t expected_size, uint32_t* region_count,
+                       MemoryRegions* regions);
+  bool ReadDescriptors64(uint32_t expected_size, uint32_t* region_count,
+                         MemoryRegions* regions);
+
   // The largest number of memory regions that will be read from a minidump.
   // The default is 256.
   static uint32_t max_regions_;
 
-  // Access to memory regions using addresses as the key.
-  RangeMap<uint64_t, unsigned int> *range_map_;
+  // The normalized interval index: disjoint intervals sorted by base
+  // address, built by Read from the descriptor list.  Unlike a RangeMap,
+  // this tolerates overlapping and duplicate descriptors.
+  MemoryIntervals *intervals_;
+
+  // Selects which descriptor format Read parses and which of
+  // descriptors_ and descriptors64_ is populated.
+  bool is_memory64_;
 
-  // The list of descriptors.  This is maintained separately from the list
-  // of regions, because MemoryRegion doesn't own its MemoryDescriptor, it
-  // maintains a pointer to it.  descriptors_ provides the storage for this
-  // purpose.
+  // The list of descriptors, retained for Print.  Exactly one of these
+  // is populated, according to is_memory64_; the regions copy the
+  // fields they need out of their descriptors when the list is read.
   MemoryDescriptors *descriptors_;
+  MemoryDescriptors64 *descriptors64_;
 
   // The list of regions.
   MemoryRegions *regions_;
@@ -620,6 +753,23 @@ class MinidumpMemoryList : public MinidumpStream {
 };
 
 
+// MinidumpMemory64List corresponds to a minidump's MEMORY_64_LIST_STREAM
+// stream, the format full-memory dumps from 64-bit Windows use: 64-bit
+// descriptors with the regions' contents laid out contiguously at the
+// stream's base_rva, allowing the file to exceed 4GB.  Only the
+// descriptor list is read eagerly; regions hand out their contents on
+// demand through the usual MinidumpMemoryRegion machinery, so processing
+// such a dump does not materialize its memory payload.
+class MinidumpMemory64List : public MinidumpMemoryList {
+ private:
+  friend class Minidump;
+
+  static const uint32_t kStreamType = MD_MEMORY_64_LIST_STREAM;
+
+  explicit MinidumpMemory64List(Minidump* minidump);
+};
+
+
 // MinidumpException wraps MDRawExceptionStream, which contains information
 // about the exception that caused the minidump to be generated, if the
 // minidump was generated in an exception handler called as a result of
@@ -808,6 +958,40 @@ class MinidumpBreakpadInfo : public MinidumpStream {
   MDRawBreakpadInfo breakpad_info_;
 };
 
+
+// MinidumpIPTrace wraps MD_IP_TRACE_STREAM, a Breakpad extension the
+// client dump writers produce at crash time recording the crashing
+// thread's raw frame-pointer-chain instruction pointers.  When the
+// trace looks well formed, a processor can symbolize these entries
+// directly instead of walking and scanning the thread's stack.
+class MinidumpIPTrace : public MinidumpStream {
+ public:
+  const MDRawIPTrace* ip_trace() const { return valid_ ? &ip_trace_ : NULL; }
+
+  // The thread whose frame-pointer chain was captured.
+  uint32_t thread_id() const { return valid_ ? ip_trace_.thread_id : 0; }
+
+  // The captured instruction pointers, callee first; ips()->at(0) is
+  // the faulting instruction pointer.  NULL if the stream is invalid.
+  const std::vector<uint64_t>* ips() const { return valid_ ? &ips_ : NULL; }
+
+  // Print a human-readable representation of the object to stdout.
+  void Print();
+
+ private:
+  friend class Minidump;
+
+  static const uint32_t kStreamType = MD_IP_TRACE_STREAM;
+
+  explicit MinidumpIPTrace(Minidump* minidump_);
+
+  bool Read(uint32_t expected_size_);
+
+  MDRawIPTrace ip_trace_;
+  std::vector<uint64_t> ips_;
+};
+
+
 // MinidumpMemoryInfo wraps MDRawMemoryInfo, which provides information
 // about mapped memory regions in a process, including their ranges
 // and protection.
@@ -879,16 +1063,45 @@ class MinidumpMemoryInfoList : public MinidumpStream {
 };
 
 
+// One module list entry as produced by Minidump::ScanModules.  Plain
+// data, with no ties to the Minidump object that produced it.
+struct MinidumpScannedModule {
+  MinidumpScannedModule() : base_of_image(0), size_of_image(0) {}
+
+  uint64_t base_of_image;
+  uint64_t size_of_image;
+
+  // The module's pathname, from the name string each module references.
+  string code_file;
+
+  // The debugging file name and identifier, decoded from the module's
+  // CodeView record.  Empty if ScanModules was asked to skip CodeView
+  // records, or if the module carries none.
+  string debug_file;
+  string debug_identifier;
+};
+
+
 // Minidump is the user's interface to a minidump file.  It wraps MDRawHeader
 // and provides access to the minidump's top-level stream directory.
 class Minidump {
  public:
-  // path is the pathname of a file containing the minidump.
+  // path is the pathname of a file containing the minidump.  A path
+  // with a ".gz" or ".zst" suffix is decompressed transparently when
+  // the minidump is opened and read from memory, so compressed dumps
+  // process directly.
   explicit Minidump(const string& path);
   // input is an istream wrapping minidump data. Minidump holds a
   // weak pointer to input, and the caller must ensure that the stream
   // is valid as long as the Minidump object is.
   explicit Minidump(std::istream& input);
+  // buffer points to size bytes of minidump data already in memory, for
+  // example received over a network.  Minidump does not copy or take
+  // ownership of the buffer; the caller must keep it valid and unchanged
+  // as long as the Minidump object is.  Reads behave as in the
+  // memory-mapped mode: no file I/O is performed, and objects such as
+  // MinidumpMemoryRegion return pointers directly into the buffer.
+  Minidump(const void* buffer, size_t size);
 
   virtual ~Minidump();
 
@@ -896,6 +1109,41 @@ class Minidump {
   virtual string path() const {
     return path_;
   }
+
+  // When enabled, Open will attempt to map the minidump file into memory
+  // instead of reading it through an istream.  In this mode, objects that
+  // deal in raw dump data, such as MinidumpMemoryRegion, return pointers
+  // directly into the mapping instead of copying into freshly allocated
+  // buffers.  The mapping is read-only and remains valid for the lifetime
+  // of the Minidump object.  If mapping is unavailable (not built on this
+  // platform, the minidump was opened from a stream, or mmap fails), the
+  // istream path is used and behavior is unchanged.  Must be called before
+  // Read.
+  void set_use_mmap(bool use_mmap) { use_mmap_ = use_mmap; }
+  bool use_mmap() const { return use_mmap_; }
+
+  // Caps the total bytes of parse-driven allocations this Minidump will
+  // make.  Length fields in a hostile or corrupt dump drive allocations
+  // such as thread, module and memory lists, memory region contents,
+  // and strings; the per-object maximums below bound each one, but a
+  // dump full of maximum-sized objects can still balloon a process.
+  // When budget_bytes is non-zero, those allocations are charged
+  // against the budget and a read that would exceed it fails like any
+  // other malformed-dump read.  0 (the default) disables budgeting.
+  // Set before Read().
+  void set_allocation_budget(uint64_t budget_bytes) {
+    allocation_budget_ = budget_bytes;
+  }
+  uint64_t allocation_budget() const { return allocation_budget_; }
+
+  // Total bytes charged against the allocation budget so far.
+  uint64_t allocated_bytes() const { return allocated_bytes_; }
+
+  // Charges bytes against the allocation budget on behalf of a stream
+  // being read.  Returns false, charging nothing, if the allocation
+  // would exceed the budget.
+  bool AccountAllocation(uint64_t bytes);
+
   static void set_max_streams(uint32_t max_streams) {
     max_streams_ = max_streams;
   }
@@ -924,6 +1172,18 @@ class Minidump {
   // Minidump object.
   virtual bool Read();
 
+  // Hints to the operating system that the streams MinidumpProcessor is
+  // known to need (thread list, module list, memory list, exception,
+  // system info, misc info, and Breakpad info) will be read soon.  For
+  // memory-mapped dumps this issues madvise readahead; for stream-backed
+  // dumps each stream's extent is read through sequentially once to warm
+  // the cache, sorted by file offset, so cold-cache processing does a
+  // few sequential bursts instead of many scattered small reads.  May
+  // only be called on a valid (successfully Read) Minidump; the read
+  // position is preserved.  Purely an optimization: failures are
+  // ignored.
+  void Prefetch();
+
   // The next set of methods are stubs that call GetStream.  They exist to
   // force code generation of the templatized API within the module, and
   // to avoid exposing an ugly API (GetStream needs to accept a garbage
@@ -936,8 +1196,35 @@ class Minidump {
   virtual MinidumpSystemInfo* GetSystemInfo();
   MinidumpMiscInfo* GetMiscInfo();
   MinidumpBreakpadInfo* GetBreakpadInfo();
+  MinidumpIPTrace* GetIPTrace();
   MinidumpMemoryInfoList* GetMemoryInfoList();
 
+  // A StreamFactory constructs an empty instance of an embedder's
+  // MinidumpStream subclass on behalf of GetRegisteredStream, which
+  // positions it at the stream and drives its Read.
+  typedef MinidumpStream* (*StreamFactory)(Minidump* minidump);
+
+  // Installs factory as the parser for directory entries of type
+  // stream_type, so that vendor-specific streams are parsed through the
+  // same lazily-populated stream cache as the built-in types instead of
+  // being decoded outside the library with SeekToStreamType.  Returns
+  // false if factory is NULL or if stream_type is one of the types this
+  // library parses itself, whose cache slots the typed Get* methods
+  // above downcast unconditionally.  Not synchronized against the
+  // stream cache: register parsers before handing the Minidump to other
+  // threads.
+  bool RegisterStreamParser(uint32_t stream_type, StreamFactory factory);
+
+  // Returns the stream of type stream_type, parsed by the factory
+  // registered for that type: the first call seeks to the stream,
+  // constructs the subclass, and has it Read; later calls return the
+  // cached object, exactly as the typed Get* methods above do.  The
+  // returned object is owned by this Minidump.  Returns NULL if no
+  // parser is registered for stream_type, the stream is absent from the
+  // dump, or the subclass's Read fails.  Callers downcast the result to
+  // the type their factory creates.
+  MinidumpStream* GetRegisteredStream(uint32_t stream_type);
+
   // The next set of methods are provided for users who wish to access
   // data in minidump files directly, while leveraging the rest of
   // this class and related classes to handle the basic minidump
@@ -958,9 +1245,25 @@ class Minidump {
   // Sets the position of the minidump file to offset.
   bool SeekSet(off_t offset);
 
+  // If the minidump is backed by a memory mapping, returns a pointer to
+  // count bytes of dump data beginning at offset, without copying.  The
+  // pointer is owned by the Minidump object and is valid until the
+  // Minidump is destroyed.  Returns NULL if the minidump is not
+  // memory-backed or if [offset, offset + count) does not lie within the
+  // dump.  Does not move the read position.
+  const uint8_t* GetMappedBytes(off_t offset, size_t count) const;
+
   // Returns the current position of the minidump file.
   off_t Tell();
 
+  // Carves size bytes out of an arena owned by this Minidump, suitably
+  // aligned for any of the MDRaw* structures.  The arena grows in large
+  // blocks and is released wholesale when the Minidump is destroyed, so
+  // the many small allocations a dump's objects make - one CPU context
+  // per thread, for example - cost a pointer bump each instead of a
+  // trip to the heap.  Storage obtained here must not be deleted.
+  void* AllocateBytes(size_t size);
+
   // The next 2 methods are medium-level I/O routines.
 
   // ReadString returns a string which is owned by the caller!  offset
@@ -982,6 +1285,19 @@ class Minidump {
   // type in a single minidump file.
   bool SeekToStreamType(uint32_t stream_type, uint32_t* stream_length);
 
+  // Decodes the module list into |modules| in one sequential pass,
+  // without building MinidumpModule objects or caching a
+  // MinidumpModuleList on this object.  Reads each MDRawModule and its
+  // name string; CodeView records - which debug_file and
+  // debug_identifier come from - are only fetched when |read_cv_records|
+  // is true, and miscellaneous debugging records are never fetched.
+  // Much cheaper than GetModuleList for callers that only need module
+  // paths and identifiers, such as a symbol-completeness check run over
+  // every incoming dump.  Returns false if the dump has no module list
+  // or the list is malformed.
+  bool ScanModules(bool read_cv_records,
+                   vector<MinidumpScannedModule>* modules);
+
   bool swap() const { return valid_ ? swap_ : false; }
 
   // Print a human-readable representation of the object to stdout.
@@ -1007,9 +1323,39 @@ class Minidump {
 
   template<typename T> T* GetStream(T** stream);
 
+  // The StreamFactory GetStream supplies to GetCachedStream.  A member
+  // rather than a free function because the stream classes' constructors
+  // are only open to their friend Minidump.
+  template<typename T> static MinidumpStream* AllocateStream(
+      Minidump* minidump);
+
+  // The machinery shared by GetStream and GetRegisteredStream: finds
+  // stream_type in the directory, returns the cached object if the
+  // stream was already parsed, and otherwise constructs an object with
+  // factory, positions it at the stream, has it Read, and caches it.
+  // Returns NULL if the stream is absent or cannot be read.
+  MinidumpStream* GetCachedStream(uint32_t stream_type,
+                                  StreamFactory factory);
+
   // Opens the minidump file, or if already open, seeks to the beginning.
   bool Open();
 
+  // The calling thread's read position within a memory-backed dump.
+  // Each thread has its own cursor, so concurrent readers do not
+  // mutate a shared file position; stream-backed dumps fall back to
+  // the single shared position.  Used by ReadBytes, SeekSet, and Tell.
+  off_t cursor_position() const;
+  void set_cursor_position(off_t position);
+
+  // Establishes the per-thread cursor key and the locks guarding the
+  // stream cache and arena.  Shared by the constructors.
+  void InitializeReadState();
+
+  // Returns the total size in bytes of the minidump data, or -1 if it
+  // cannot be determined.  Used by Read to bounds-check the stream
+  // directory up front.  Restores the read position before returning.
+  off_t DumpSize();
+
   // The largest number of top-level streams that will be read from a minidump.
   // Note that streams are only read (and only consume memory) as needed,
   // when directed by the caller.  The default is 128.
@@ -1029,14 +1375,67 @@ class Minidump {
   // Access to streams using the stream type as the key.
   MinidumpStreamMap*        stream_map_;
 
+  // Parsers installed by RegisterStreamParser, keyed by stream type.
+  map<uint32_t, StreamFactory> registered_stream_parsers_;
+
   // The pathname of the minidump file to process, set in the constructor.
   // This may be empty if the minidump was opened directly from a stream.
   const string              path_;
 
   // The stream for all file I/O.  Used by ReadBytes and SeekSet.
   // Set based on the path in Open, or directly in the constructor.
+  // NULL when the minidump is backed by a memory mapping instead.
   std::istream*             stream_;
 
+  // When use_mmap_ is set and mapping succeeds, the base and size of the
+  // read-only mapping of the minidump file, and the read position within
+  // it for threads without a per-thread cursor.  mapped_base_ is NULL
+  // when the minidump is stream-backed.
+  const uint8_t*            mapped_base_;
+  size_t                    mapped_size_;
+  off_t                     mapped_position_;
+
+  // When Open transparently decompresses a .gz or .zst minidump, the
+  // decompressed contents, which mapped_base_ points into.  NULL
+  // otherwise.  Owned.
+  const string*             decompressed_;
+
+#ifndef _WIN32
+  // Per-thread read cursors for memory-backed dumps, keyed by calling
+  // thread.  Positions are stored biased by one so that a thread's
+  // never-set slot reads as position zero.  See cursor_position.
+  pthread_key_t             cursor_key_;
+  bool                      cursor_key_valid_;
+
+  // Serializes stream cache population in GetStream.  Recursive,
+  // because reading one stream can require another: a thread context
+  // read consults the system info stream.
+  pthread_mutex_t           stream_lock_;
+
+  // Guards the AllocateBytes arena against concurrent stream reads.
+  pthread_mutex_t           arena_lock_;
+#endif  // _WIN32
+
+  // true if mapped_base_ is a mapping established by Open that must be
+  // unmapped on destruction, false if it is a caller-owned buffer.
+  bool                      mapped_owned_;
+
+  // The blocks backing AllocateBytes, freed by the destructor, and the
+  // unused portion of the most recent block.
+  vector<uint8_t*>          arena_blocks_;
+  uint8_t*                  arena_next_;
+  size_t                    arena_remaining_;
+
+  // Whether Open should attempt to mmap the minidump file.  See
+  // set_use_mmap.
+  bool                      use_mmap_;
+
+  // The parse-driven allocation budget and the bytes charged against it
+  // so far.  See set_allocation_budget.  allocated_bytes_ is guarded by
+  // arena_lock_, alongside the other memory bookkeeping.
+  uint64_t                  allocation_budget_;
+  uint64_t                  allocated_bytes_;
+
   // swap_ is true if the minidump file should be byte-swapped.  If the
   // minidump was produced by a CPU that is other-endian than the CPU
   // processing the minidump, this will be true.  If the two CPUs are
@@ -0,0 +1,186 @@
+// -*- mode: C++ -*-
+
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_batch_processor.h: A session that processes many minidumps
+// through one shared StackFrameSymbolizer.
+//
+// A driver loop that calls MinidumpProcessor::Process once per dump
+// pays for every shared module load again and processes one dump at a
+// time.  MinidumpBatchProcessor turns the loop into a session: add the
+// dump paths, call ProcessAll, and read back one ProcessState per dump.
+// The session symbolizes every dump through the caller's symbolizer, so
+// a module loaded for one dump serves every later dump that references
+// it, and schedules dumps across a pool of worker threads where
+// pthreads are available.
+//
+// The frames in the resulting ProcessStates intern their name strings
+// in a pool owned by this session, so the session must outlive any use
+// of the states it produced.
+
+#ifndef GOOGLE_BREAKPAD_PROCESSOR_MINIDUMP_BATCH_PROCESSOR_H__
+#define GOOGLE_BREAKPAD_PROCESSOR_MINIDUMP_BATCH_PROCESSOR_H__
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/minidump_processor.h"
+#include "google_breakpad/processor/process_state.h"
+#include "google_breakpad/processor/string_intern_pool.h"
+
+namespace google_breakpad {
+
+class StackFrameSymbolizer;
+
+class MinidumpBatchProcessor {
+ public:
+  // The session does not take ownership of frame_symbolizer, which must
+  // NOT be NULL.  Dumps in the batch may be processed concurrently, so
+  // the symbolizer's resolver should support concurrent lookups (see
+  // SourceLineResolverInterface::SupportsConcurrentLookups) when more
+  // than one worker thread is requested.
+  MinidumpBatchProcessor(StackFrameSymbolizer* frame_symbolizer,
+                         bool enable_exploitability);
+
+  ~MinidumpBatchProcessor();
+
+  // Sets the maximum number of dumps processed concurrently by
+  // ProcessAll.  The default is 1, which processes the batch serially
+  // on the calling thread.  Values greater than 1 are honored only
+  // where pthreads are available.
+  void set_max_worker_threads(unsigned int max_worker_threads) {
+    max_worker_threads_ = max_worker_threads;
+  }
+  unsigned int max_worker_threads() const { return max_worker_threads_; }
+
+  // When set, ProcessAll on a multi-node (NUMA) Linux machine pins
+  // each worker thread to one node, groups the batch's dumps by their
+  // module lists (read ahead of processing; a few KB per dump) and
+  // dispatches each group to one node's workers.  Dumps sharing
+  // modules are then symbolized on the node that first loaded those
+  // modules, and since the kernel places pages on the node that first
+  // touches them, the modules' resolver data stays node-local for
+  // every later lookup - no explicit page binding is needed.  Idle
+  // workers still steal dumps from other nodes rather than sit out
+  // the tail of the batch.  Off by default; a no-op on single-node
+  // machines, on non-Linux hosts, and with a single worker.
+  void set_numa_aware(bool numa_aware) { numa_aware_ = numa_aware; }
+  bool numa_aware() const { return numa_aware_; }
+
+  // Adds a dump to the batch and returns its index, by which its result
+  // and ProcessState can be read back after ProcessAll.
+  size_t AddMinidumpFile(const string& minidump_file);
+
+  // Processes every dump added so far and returns the number that
+  // processed with PROCESS_OK.  May be called again after adding more
+  // dumps; already processed dumps are not reprocessed.
+  size_t ProcessAll();
+
+  size_t entry_count() const { return entries_.size(); }
+  const string& minidump_file(size_t index) const {
+    return entries_[index]->minidump_file;
+  }
+  ProcessResult result(size_t index) const {
+    return entries_[index]->result;
+  }
+  ProcessState* process_state(size_t index) {
+    return &entries_[index]->process_state;
+  }
+
+ private:
+  // One dump's slot in the batch.  Heap-allocated so that ProcessState,
+  // which owns its call stacks, is never copied.
+  struct Entry {
+    explicit Entry(const string& set_minidump_file)
+        : minidump_file(set_minidump_file),
+          processed(false),
+          claimed(false),
+          preferred_node(0),
+          result(PROCESS_ERROR_MINIDUMP_NOT_FOUND) {}
+
+    string minidump_file;
+    bool processed;
+    // Whether a worker holds this entry; distinct from processed so
+    // preference-scanning claims never hand one dump to two workers.
+    bool claimed;
+    // The NUMA node whose workers should symbolize this dump.  Always
+    // 0 unless the session is numa_aware.
+    unsigned int preferred_node;
+    ProcessResult result;
+    ProcessState process_state;
+  };
+
+  struct WorkPool;
+  struct WorkerArg;
+
+  // Processes entries claimed from pool until none remain.  Each worker
+  // runs its own MinidumpProcessor against the shared symbolizer.
+  // |node| names the NUMA node this worker serves; 0 when the session
+  // is not numa_aware.
+  static void ProcessEntries(WorkPool* pool, unsigned int node);
+
+  // Claims the next unprocessed entry from pool, or returns NULL.
+  // With more than one node, entries preferring |node| are claimed
+  // first and other nodes' entries are stolen only when none remain.
+  static Entry* ClaimEntry(WorkPool* pool, unsigned int node);
+
+  // Spreads the pending entries over |node_count| nodes, one node per
+  // distinct module-list fingerprint, so dumps of the same program are
+  // symbolized - and their modules' pages first touched - on one node.
+  void AssignPreferredNodes(unsigned int node_count);
+
+#ifndef _WIN32
+  // pthread entry point: pins the worker to its node's CPUs where the
+  // session is numa_aware, then runs ProcessEntries.
+  static void* WorkerMain(void* arg);
+#endif
+
+  StackFrameSymbolizer* frame_symbolizer_;
+  bool enable_exploitability_;
+  unsigned int max_worker_threads_;
+  bool numa_aware_;
+
+  // The dumps in the batch, owned.
+  std::vector<Entry*> entries_;
+
+  // The pool every frame in the batch interns its name strings in.
+  // Thread-safe, and shared across dumps: concurrent workers cannot
+  // each point the symbolizer at their own per-dump pool.
+  StringInternPool intern_pool_;
+
+  // Disallow copy constructor and assignment operator.
+  MinidumpBatchProcessor(const MinidumpBatchProcessor&);
+  void operator=(const MinidumpBatchProcessor&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // GOOGLE_BREAKPAD_PROCESSOR_MINIDUMP_BATCH_PROCESSOR_H__
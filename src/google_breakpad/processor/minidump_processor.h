@@ -38,9 +38,13 @@
 
 namespace google_breakpad {
 
+class CallStack;
 class Minidump;
+class MinidumpContext;
 class ProcessState;
 class StackFrameSymbolizer;
+class PrologueLayoutCache;
+class StackScanTelemetry;
 class SourceLineResolverInterface;
 class SymbolSupplier;
 struct SystemInfo;
@@ -80,6 +84,50 @@ enum ProcessResult {
                                               // fatal)
 };
 
+// Selects which stages of Process a caller wants to pay for.  The
+// default profile preserves the historical behavior: every thread is
+// walked, every frame is symbolized, the assertion stream is read, and
+// exploitability runs if the processor enabled it.  A triage tier that
+// only consumes the crashing thread's addresses can switch the
+// expensive stages off individually.
+struct ProcessingProfile {
+  ProcessingProfile()
+      : crashing_thread_only(false),
+        resolve_source_lines(true),
+        check_exploitability(true),
+        read_assertion(true),
+        trust_ip_trace(false) {}
+
+  // Walk only the requesting (crashing) thread's stack.  Threads that
+  // are skipped do not appear in ProcessState::threads at all, so the
+  // requesting thread is at index 0.  If the dump does not identify a
+  // requesting thread, every thread is walked as usual.
+  bool crashing_thread_only;
+
+  // When false, symbols are still loaded - the walkers keep their CFI
+  // and Windows frame info, and modules without symbols are still
+  // reported - but frames are not annotated with function names or
+  // source lines.  See StackFrameSymbolizer::set_resolve_source_lines.
+  bool resolve_source_lines;
+
+  // When false, the exploitability engine is skipped even if the
+  // processor was constructed with it enabled.
+  bool check_exploitability;
+
+  // When false, the minidump's assertion stream is not read.
+  bool read_assertion;
+
+  // When true and the dump carries a client-captured instruction
+  // pointer trace (MD_IP_TRACE_STREAM) for the requesting thread, its
+  // stack is built straight from the trace with pure symbol lookups,
+  // skipping that thread's unwind and stack-scan work.  The trace is
+  // only trusted when it looks well formed: it must start at the
+  // exception context's instruction pointer and every entry must fall
+  // inside a known module; otherwise the thread is walked as usual.
+  // Defaults to false.
+  bool trust_ip_trace;
+};
+
 class MinidumpProcessor {
  public:
   // Initializes this MinidumpProcessor.  supplier should be an
@@ -103,6 +151,63 @@ class MinidumpProcessor {
 
   ~MinidumpProcessor();
 
+  // Sets the maximum number of worker threads that Process may use to
+  // walk the stacks of independent minidump threads concurrently.  The
+  // default is 1, which walks each stack serially on the calling thread,
+  // preserving the historical behavior.  Values greater than 1 are
+  // honored only where pthreads are available; each thread's stack memory
+  // is read from the minidump serially beforehand, and the shared
+  // StackFrameSymbolizer serializes symbol loading internally.  Results
+  // are stored in ProcessState in original thread order regardless.
+  void set_max_worker_threads(unsigned int max_worker_threads) {
+    max_worker_threads_ = max_worker_threads;
+  }
+  unsigned int max_worker_threads() const { return max_worker_threads_; }
+
+  // Sets a wall-clock budget, in milliseconds, for the stack-walking
+  // phase of each Process call.  Threads whose walks are still running
+  // when the budget expires keep the frames walked so far, and their
+  // indices are recorded in ProcessState::truncated_threads, so a
+  // pathological dump yields a mostly complete report quickly instead
+  // of pinning a worker.  0, the default, means no budget.  Honored
+  // only where a cheap wall clock is available (not on Windows).
+  void set_processing_time_budget_ms(uint64_t processing_time_budget_ms) {
+    processing_time_budget_ms_ = processing_time_budget_ms;
+  }
+  uint64_t processing_time_budget_ms() const {
+    return processing_time_budget_ms_;
+  }
+
+  // Caps the number of stack words any single scan for a return address
+  // examines while walking this processor's dumps.  0, the default,
+  // leaves the walkers' own search depths alone.  See
+  // Stackwalker::set_scan_word_limit.
+  void set_scan_word_limit(int scan_word_limit) {
+    scan_word_limit_ = scan_word_limit;
+  }
+
+  // Returns the scan telemetry this processor accumulates across the
+  // dumps it processes: per-module CFI-hit and scan-success counters
+  // that size the walkers' scan windows and can be exported for tuning.
+  // Owned by the processor; valid for its lifetime.
+  StackScanTelemetry* scan_telemetry() { return scan_telemetry_; }
+
+  // By default, Process resets the symbolizer's per-dump state (its
+  // missing-symbol memo) before walking each dump.  A batch session
+  // sharing one symbolizer among dumps processed concurrently must not
+  // do that per dump; it resets the symbolizer once for the whole batch
+  // and turns this off.  See MinidumpBatchProcessor.
+  void set_reset_symbolizer_per_dump(bool reset_symbolizer_per_dump) {
+    reset_symbolizer_per_dump_ = reset_symbolizer_per_dump;
+  }
+
+  // Sets the stage profile used by subsequent Process calls.  See
+  // ProcessingProfile.
+  void set_processing_profile(const ProcessingProfile& profile) {
+    profile_ = profile;
+  }
+  const ProcessingProfile& processing_profile() const { return profile_; }
+
   // Processes the minidump file and fills process_state with the result.
   ProcessResult Process(const string &minidump_file,
                         ProcessState* process_state);
@@ -153,7 +258,31 @@ class MinidumpProcessor {
   // does not exist or cannot be determined.
   static string GetAssertion(Minidump* dump);
 
+  // Computes a signature for the crash in |dump| without walking or
+  // symbolizing anything, reading only the exception stream, the
+  // crashing thread's context, and the module list.  The signature
+  // combines the exception code and flags with the crashing module's
+  // debug file and identifier and the module-relative offset of the
+  // faulting instruction, so it is stable across machines and address
+  // space layouts for the same crash in the same binaries.  Intake
+  // pipelines can use it to recognize duplicates of known crashes and
+  // skip full processing.  On success, sets *fingerprint to a 16-digit
+  // lowercase hex hash and returns true; returns false if the dump
+  // carries no usable exception information.
+  static bool GetCrashFingerprint(Minidump* dump, string* fingerprint);
+
  private:
+  // Builds the requesting thread's stack from the dump's IP trace
+  // stream, with every frame symbolized, for
+  // ProcessingProfile::trust_ip_trace.  |thread_id| is the requesting
+  // thread and |context| the context its frames would be walked from.
+  // Returns NULL - and the caller walks the thread as usual - if the
+  // stream is absent, belongs to another thread, or fails validation.
+  CallStack* BuildStackFromIPTrace(Minidump* dump,
+                                   uint32_t thread_id,
+                                   MinidumpContext* context,
+                                   ProcessState* process_state);
+
   StackFrameSymbolizer* frame_symbolizer_;
   // Indicate whether resolver_helper_ is owned by this instance.
   bool own_frame_symbolizer_;
@@ -162,6 +291,32 @@ class MinidumpProcessor {
   // guess how likely it is that the crash represents an exploitable
   // memory corruption issue.
   bool enable_exploitability_;
+
+  // The maximum number of worker threads used to walk thread stacks
+  // concurrently.  See set_max_worker_threads.
+  unsigned int max_worker_threads_;
+
+  // Whether Process resets the symbolizer before each dump.  See
+  // set_reset_symbolizer_per_dump.
+  bool reset_symbolizer_per_dump_;
+
+  // The stack-walking time budget (0 = none) and scan depth cap
+  // (0 = none).  See set_processing_time_budget_ms and
+  // set_scan_word_limit.
+  uint64_t processing_time_budget_ms_;
+  int scan_word_limit_;
+
+  // Per-module scan telemetry shared by every walker this processor
+  // starts.  See scan_telemetry.
+  StackScanTelemetry* scan_telemetry_;
+
+  // Prologue-derived ARM frame layouts, cached across every thread and
+  // dump this processor walks so each function's entry instructions are
+  // decoded once.  See StackwalkerARM::GetCallerByPrologueAnalysis.
+  PrologueLayoutCache* prologue_layout_cache_;
+
+  // Which pipeline stages Process runs.  See set_processing_profile.
+  ProcessingProfile profile_;
 };
 
 }  // namespace google_breakpad
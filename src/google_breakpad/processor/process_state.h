@@ -39,6 +39,7 @@
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
+#include "google_breakpad/processor/string_intern_pool.h"
 #include "google_breakpad/processor/system_info.h"
 #include "google_breakpad/processor/minidump.h"
 
@@ -85,6 +86,60 @@ enum ExploitabilityRating {
                                           // was calculated.
 };
 
+// Per-dump timings and counters recorded by MinidumpProcessor::Process,
+// for export to monitoring.  Timings are wall-clock microseconds and are
+// zero on platforms without a cheap clock (Windows); counters are always
+// maintained.
+struct ProcessingStats {
+  ProcessingStats() { Clear(); }
+
+  void Clear() {
+    dump_parse_time_us = 0;
+    walk_time_us = 0;
+    symbol_fetch_time_us = 0;
+    symbol_parse_time_us = 0;
+    resolve_time_us = 0;
+    modules_loaded = 0;
+    symbol_cache_hits = 0;
+    cfi_frames = 0;
+    scan_frames = 0;
+    total_frames = 0;
+  }
+
+  // Time spent reading the dump's streams and gathering per-thread
+  // contexts and stack memory, before any walking.
+  uint64_t dump_parse_time_us;
+
+  // Wall time of the stack-walking phase.  Symbolization happens inside
+  // the walk, so the symbol timings below overlap this figure rather
+  // than adding to it.
+  uint64_t walk_time_us;
+
+  // Time in the symbol supplier retrieving symbol data, and in the
+  // resolver parsing it, for this dump.  Summed across walk workers, so
+  // either can exceed walk_time_us during a concurrent walk.
+  uint64_t symbol_fetch_time_us;
+  uint64_t symbol_parse_time_us;
+
+  // Time spent filling per-frame function and source line information,
+  // outside the fetching and parsing counted above.  Summed across walk
+  // workers, like the symbol timings.
+  uint64_t resolve_time_us;
+
+  // Symbol loads performed for this dump, and frame fills served by a
+  // module some earlier frame - or an earlier dump sharing the
+  // symbolizer - had already loaded.
+  uint64_t modules_loaded;
+  uint64_t symbol_cache_hits;
+
+  // Of total_frames walked, how many were recovered via call frame
+  // info, and how many by falling back to stack scanning (with or
+  // without CFI assistance).
+  uint64_t cfi_frames;
+  uint64_t scan_frames;
+  uint64_t total_frames;
+};
+
 class ProcessState {
  public:
   ProcessState() : modules_(NULL) { Clear(); }
@@ -93,6 +148,16 @@ class ProcessState {
   // Resets the ProcessState to its default values
   void Clear();
 
+  // Exchanges the entire contents - including ownership of the call
+  // stacks, the module list and the interned strings - with |other|,
+  // in constant time and without copying.  A pipeline stage hands a
+  // finished state to the next stage or across a thread boundary by
+  // swapping it into an empty ProcessState; the donor ends up with the
+  // recipient's (typically default) contents and remains safe to
+  // Clear, reuse or destroy.  Like Clear, must not be called while
+  // another thread is using either state.
+  void Swap(ProcessState* other);
+
   // Accessors.  See the data declarations below.
   uint32_t time_date_stamp() const { return time_date_stamp_; }
   bool crashed() const { return crashed_; }
@@ -109,12 +174,25 @@ class ProcessState {
   const vector<const CodeModule*>* modules_without_symbols() const {
     return &modules_without_symbols_;
   }
+  const vector<unsigned int>* truncated_threads() const {
+    return &truncated_threads_;
+  }
   ExploitabilityRating exploitability() const { return exploitability_; }
+  const ProcessingStats* processing_stats() const {
+    return &processing_stats_;
+  }
+
+  // The pool this state's stack frames intern their name strings in.
+  StringInternPool* intern_pool() { return &intern_pool_; }
 
  private:
   // MinidumpProcessor is responsible for building ProcessState objects.
   friend class MinidumpProcessor;
 
+  // ProcessStateSerializer rebuilds ProcessState objects from their
+  // serialized form.  See processor/process_state_serializer.h.
+  friend class ProcessStateSerializer;
+
   // The time-date stamp of the minidump (time_t format)
   uint32_t time_date_stamp_;
 
@@ -150,13 +228,20 @@ class ProcessState {
   int requesting_thread_;
 
   // Stacks for each thread (except possibly the exception handler
-  // thread) at the time of the crash.
+  // thread) at the time of the crash.  Threads that had byte-identical
+  // stacks may point at the same CallStack object; Clear deletes each
+  // distinct stack once.
   vector<CallStack*> threads_;
   vector<MinidumpMemoryRegion*> thread_memory_regions_;
 
   // OS and CPU information.
   SystemInfo system_info_;
 
+  // Each distinct function and source file name is stored here once and
+  // referenced by every frame that names it.  Owned by this state, as
+  // the frames are, so the references stay valid for the state's life.
+  StringInternPool intern_pool_;
+
   // The modules that were loaded into the process represented by the
   // ProcessState.
   const CodeModules *modules_;
@@ -164,10 +249,21 @@ class ProcessState {
   // The modules that didn't have symbols when the report was processed.
   vector<const CodeModule*> modules_without_symbols_;
 
+  // Indices into threads_ of stacks whose walks stopped early - because
+  // the processing time budget ran out or the frame limit was reached -
+  // so their innermost frames are present but outer callers may be
+  // missing.  Empty when every walk ran to completion.  See
+  // MinidumpProcessor::set_processing_time_budget_ms.
+  vector<unsigned int> truncated_threads_;
+
   // The exploitability rating as determined by the exploitability
   // engine. When the exploitability engine is not enabled this
   // defaults to EXPLOITABILITY_NONE.
   ExploitabilityRating exploitability_;
+
+  // Timings and counters for the Process call that built this state.
+  // See ProcessingStats.
+  ProcessingStats processing_stats_;
 };
 
 }  // namespace google_breakpad
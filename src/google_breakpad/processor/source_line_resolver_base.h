@@ -64,6 +64,31 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
   // ownership of the buffer, and should call delete [] to free the buffer.
   static bool ReadSymbolFile(char **symbol_data, const string &file_name);
 
+  // Sets a budget, in symbol-data bytes, for loaded modules.  When a
+  // load pushes the total over the budget, the least-recently-resolved
+  // modules are unloaded until the total fits (the module being loaded
+  // is never evicted).  0, the default, disables eviction.  Modules
+  // loaded through LoadModuleUsingMemoryBuffer have no known size and
+  // do not count toward the budget.
+  void set_max_loaded_bytes(uint64_t max_loaded_bytes);
+  uint64_t max_loaded_bytes() const;
+
+  // The byte total currently counted against the budget.
+  uint64_t loaded_bytes() const;
+
+  // Statistics for sizing the budget: the number of resolutions served
+  // by a loaded module, and the number of modules evicted.
+  uint64_t resolution_hit_count() const;
+  uint64_t eviction_count() const;
+
+  // Controls whether subsequent loads parse FILE and source line
+  // records.  Walk-only workloads that never fill in source line
+  // information can turn this off and load only the FUNC, PUBLIC, and
+  // stack-walking records, which is substantially faster and smaller.
+  // Defaults to true; only affects resolvers that parse symbol text.
+  void set_load_source_lines(bool load_source_lines);
+  bool load_source_lines() const;
+
  protected:
   // Users are not allowed create SourceLineResolverBase instance directly.
   SourceLineResolverBase(ModuleFactory *module_factory);
@@ -75,32 +100,89 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
                                         const string &map_buffer);
   virtual bool LoadModuleUsingMemoryBuffer(const CodeModule *module,
                                            char *memory_buffer);
+  virtual bool LoadModuleUsingSharedBuffer(const CodeModule *module,
+                                           SymbolDataBuffer *symbol_data);
   virtual bool ShouldDeleteMemoryBufferAfterLoadModule();
   virtual void UnloadModule(const CodeModule *module);
   virtual bool HasModule(const CodeModule *module);
   virtual void FillSourceLineInfo(StackFrame *frame);
-  virtual WindowsFrameInfo *FindWindowsFrameInfo(const StackFrame *frame);
-  virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame);
+  virtual void FillSourceLineInfoBatch(std::vector<StackFrame*> *frames);
+  virtual bool FindWindowsFrameInfo(const StackFrame *frame,
+                                    WindowsFrameInfo *frame_info);
+  virtual bool FindCFIFrameInfo(const StackFrame *frame,
+                                CFIFrameInfo *frame_info);
 
   // Nested structs and classes.
   struct Line;
   struct Function;
   struct PublicSymbol;
-  struct CompareString {
-    bool operator()(const string &s1, const string &s2) const;
-  };
   // Module is an interface for an in-memory symbol file.
   class Module;
   class AutoFileCloser;
 
+  // ModuleKey names a loaded module by its code file path together with
+  // a hash of that path (see CodeModule::code_file_hash(), which caches
+  // the hash on the module).  The maps below order keys by the hash
+  // first, so the per-frame map descents in FillSourceLineInfo and the
+  // frame info lookups compare integers; the path string only breaks
+  // the (rare) hash ties and confirms the final match.
+  struct ModuleKey {
+    ModuleKey() : hash(0) {}
+    explicit ModuleKey(const string &code_file_arg);
+    explicit ModuleKey(const CodeModule *module);
+    bool operator<(const ModuleKey &other) const;
+    bool operator==(const ModuleKey &other) const;
+
+    uint64_t hash;
+    string code_file;
+  };
+
   // All of the modules that are loaded.
-  typedef map<string, Module*, CompareString> ModuleMap;
+  typedef map<ModuleKey, Module*> ModuleMap;
   ModuleMap *modules_;
 
   // All of heap-allocated buffers that are owned locally by resolver.
-  typedef std::map<string, char*, CompareString> MemoryMap;
+  typedef std::map<ModuleKey, char*> MemoryMap;
   MemoryMap *memory_buffers_;
 
+  // Shared buffers this resolver holds a reference to, for modules
+  // loaded through LoadModuleUsingSharedBuffer when the resolver keeps
+  // pointers into the symbol data.  Each entry's reference is released
+  // when its module is unloaded.
+  typedef std::map<ModuleKey, SymbolDataBuffer*> SharedBufferMap;
+  SharedBufferMap *shared_buffers_;
+
+  // Records that a module of size bytes was loaded under key, and
+  // evicts least-recently-resolved modules if the budget is exceeded.
+  void RecordModuleLoad(const ModuleKey &key, uint64_t size);
+
+  // Marks key's module as the most recently resolved.
+  void NoteModuleUsed(const ModuleKey &key);
+
+  // Unloads least-recently-resolved modules, other than protected_key,
+  // until loaded_bytes_ fits within max_loaded_bytes_.  Pass a
+  // default-constructed key to protect nothing.
+  void EvictOverBudget(const ModuleKey &protected_key);
+
+  // Byte budget (0 = unlimited), the total counted against it, and the
+  // eviction statistics.
+  uint64_t max_loaded_bytes_;
+  uint64_t loaded_bytes_;
+  uint64_t resolution_hit_count_;
+  uint64_t eviction_count_;
+
+  // A monotonic counter advanced on every load and resolution; the
+  // module with the smallest stamp is the eviction candidate.
+  uint64_t lru_clock_;
+
+  // Per-module byte footprints and last-used stamps.
+  typedef std::map<ModuleKey, uint64_t> UsageMap;
+  UsageMap *module_sizes_;
+  UsageMap *last_used_;
+
+  // Whether newly loaded modules parse FILE and source line records.
+  bool load_source_lines_;
+
   // Creates a concrete module at run-time.
   ModuleFactory *module_factory_;
 
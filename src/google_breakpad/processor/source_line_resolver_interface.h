@@ -35,10 +35,12 @@
 #define GOOGLE_BREAKPAD_PROCESSOR_SOURCE_LINE_RESOLVER_INTERFACE_H__
 
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
 #include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/symbol_data_buffer.h"
 
 namespace google_breakpad {
 
@@ -76,6 +78,21 @@ class SourceLineResolverInterface {
   // alive during the lifetime of the corresponding Module.
   virtual bool ShouldDeleteMemoryBufferAfterLoadModule() = 0;
 
+  // Same as LoadModuleUsingMemoryBuffer, but takes a reference-counted
+  // read-only buffer instead of raw memory, so a resolver that keeps
+  // the symbol data alive for the module's lifetime can hold a
+  // reference to the supplier's buffer rather than owning a private
+  // copy.  Does not consume the caller's reference: a resolver that
+  // retains the buffer takes its own reference and releases it when the
+  // module is unloaded.  The default implementation copies the bytes,
+  // which is always safe; resolvers that read symbol data in place
+  // without modifying it should override.
+  virtual bool LoadModuleUsingSharedBuffer(const CodeModule *module,
+                                           SymbolDataBuffer *symbol_data) {
+    return LoadModuleUsingMapBuffer(
+        module, string(symbol_data->data(), symbol_data->size()));
+  }
+
   // Request that the specified module be unloaded from this resolver.
   // A resolver may choose to ignore such a request.
   virtual void UnloadModule(const CodeModule *module) = 0;
@@ -83,23 +100,47 @@ class SourceLineResolverInterface {
   // Returns true if the module has been loaded.
   virtual bool HasModule(const CodeModule *module) = 0;
 
+  // Returns true if HasModule, FillSourceLineInfo, FindWindowsFrameInfo
+  // and FindCFIFrameInfo may be called concurrently from several
+  // threads, as long as no load or unload runs at the same time.
+  // Callers seeing false must serialize all calls into the resolver.
+  virtual bool SupportsConcurrentLookups() const { return false; }
+
   // Fills in the function_base, function_name, source_file_name,
   // and source_line fields of the StackFrame.  The instruction and
   // module_name fields must already be filled in.
   virtual void FillSourceLineInfo(StackFrame *frame) = 0;
 
+  // Fills in source line info for every frame in |frames|, as
+  // FillSourceLineInfo does for a single frame.  After a walk, all of a
+  // stack's instruction addresses are known at once; a resolver may
+  // override this to handle the set more efficiently than the default
+  // implementation's independent per-frame lookups - for example, by
+  // visiting each module's structures in a single sorted sweep.  Frames
+  // with no module, or whose module has no symbols loaded, are left
+  // untouched, and the order of |frames| is preserved.
+  virtual void FillSourceLineInfoBatch(std::vector<StackFrame*> *frames) {
+    for (size_t frame_index = 0; frame_index < frames->size(); ++frame_index)
+      FillSourceLineInfo((*frames)[frame_index]);
+  }
+
   // If Windows stack walking information is available covering
-  // FRAME's instruction address, return a WindowsFrameInfo structure
-  // describing it. If the information is not available, returns NULL.
-  // A NULL return value does not indicate an error. The caller takes
-  // ownership of any returned WindowsFrameInfo object.
-  virtual WindowsFrameInfo *FindWindowsFrameInfo(const StackFrame *frame) = 0;
+  // FRAME's instruction address, fill *frame_info with it and return
+  // true. If the information is not available, return false, leaving
+  // *frame_info in an unspecified state; a false return does not
+  // indicate an error. The caller provides the structure, so a single
+  // object can be reused across lookups instead of each lookup
+  // allocating one.
+  virtual bool FindWindowsFrameInfo(const StackFrame *frame,
+                                    WindowsFrameInfo *frame_info) = 0;
 
   // If CFI stack walking information is available covering ADDRESS,
-  // return a CFIFrameInfo structure describing it. If the information
-  // is not available, return NULL. The caller takes ownership of any
-  // returned CFIFrameInfo object.
-  virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) = 0;
+  // fill *frame_info with it and return true. If the information is
+  // not available, return false, leaving *frame_info in an unspecified
+  // state. The caller provides the structure, as for
+  // FindWindowsFrameInfo above.
+  virtual bool FindCFIFrameInfo(const StackFrame *frame,
+                                CFIFrameInfo *frame_info) = 0;
 
  protected:
   // SourceLineResolverInterface cannot be instantiated except by subclasses
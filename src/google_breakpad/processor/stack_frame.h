@@ -34,6 +34,7 @@
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
+#include "google_breakpad/processor/string_intern_pool.h"
 
 namespace google_breakpad {
 
@@ -56,14 +57,39 @@ struct StackFrame {
   StackFrame()
       : instruction(),
         module(NULL),
-        function_name(),
+        function_name(NULL),
         function_base(),
-        source_file_name(),
+        source_file_name(NULL),
         source_line(),
         source_line_base(),
-        trust(FRAME_TRUST_NONE) {}
+        trust(FRAME_TRUST_NONE),
+        intern_pool(NULL),
+        owned_function_name_(),
+        owned_source_file_name_() {}
   virtual ~StackFrame() {}
 
+  // Sets function_name.  When an intern pool is attached, the name is
+  // interned there and shared with every other frame naming the same
+  // function; otherwise the frame keeps its own copy.
+  void SetFunctionName(const string &name) {
+    if (intern_pool) {
+      function_name = intern_pool->Intern(name);
+    } else {
+      owned_function_name_ = name;
+      function_name = &owned_function_name_;
+    }
+  }
+
+  // As SetFunctionName, for source_file_name.
+  void SetSourceFileName(const string &name) {
+    if (intern_pool) {
+      source_file_name = intern_pool->Intern(name);
+    } else {
+      owned_source_file_name_ = name;
+      source_file_name = &owned_source_file_name_;
+    }
+  }
+
   // Return a string describing how this stack frame was found
   // by the stackwalker.
   string trust_description() const {
@@ -113,15 +139,18 @@ struct StackFrame {
   // The module in which the instruction resides.
   const CodeModule *module;
 
-  // The function name, may be omitted if debug symbols are not available.
-  string function_name;
+  // The function name; NULL if debug symbols are not available.  Set via
+  // SetFunctionName; points into the attached intern pool or at this
+  // frame's own copy.
+  const string *function_name;
 
   // The start address of the function, may be omitted if debug symbols
   // are not available.
   uint64_t function_base;
 
-  // The source file name, may be omitted if debug symbols are not available.
-  string source_file_name;
+  // The source file name; NULL if debug symbols are not available.  Set
+  // via SetSourceFileName, sharing storage as function_name does.
+  const string *source_file_name;
 
   // The (1-based) source line number, may be omitted if debug symbols are
   // not available.
@@ -134,6 +163,15 @@ struct StackFrame {
   // Amount of trust the stack walker has in the instruction pointer
   // of this frame.
   FrameTrust trust;
+
+  // The pool SetFunctionName and SetSourceFileName intern names in.  Set
+  // by StackFrameSymbolizer before symbol lookup; NULL means the frame
+  // owns its name strings.  Not owned by the frame.
+  StringInternPool *intern_pool;
+
+  // Backing storage for the names when no intern pool is attached.
+  string owned_function_name_;
+  string owned_source_file_name_;
 };
 
 }  // namespace google_breakpad
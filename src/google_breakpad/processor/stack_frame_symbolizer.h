@@ -31,12 +31,26 @@
 
 // Helper class that encapsulates the logic of how symbol supplier interacts
 // with source line resolver to fill stack frame information.
+//
+// A StackFrameSymbolizer is safe to keep for the life of a batch
+// processor and reuse across MinidumpProcessor::Process calls: modules
+// loaded into the resolver stay loaded, so later dumps referencing the
+// same modules skip the symbol fetch and parse entirely.  Call Reset
+// between dumps to clear the per-dump missing-symbol memo (a symbol
+// file absent for one dump may have appeared by the next); loaded
+// modules and session statistics survive Reset.
 
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_STACK_FRAME_SYMBOLIZER_H__
 #define GOOGLE_BREAKPAD_PROCESSOR_STACK_FRAME_SYMBOLIZER_H__
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
@@ -45,14 +59,54 @@
 namespace google_breakpad {
 class CFIFrameInfo;
 class CodeModules;
+class StringInternPool;
 class SymbolSupplier;
 class SourceLineResolverInterface;
+class UnwindStrategyHints;
 struct StackFrame;
 struct SystemInfo;
 struct WindowsFrameInfo;
 
 class StackFrameSymbolizer {
  public:
+  // Counters accumulated over the life of this symbolizer, across every
+  // dump it has helped process.  Suitable for export to monitoring.
+  struct SessionStats {
+    SessionStats()
+        : module_hits(0),
+          module_misses(0),
+          modules_loaded(0),
+          load_time_us(0),
+          fetch_time_us(0),
+          parse_time_us(0),
+          fill_time_us(0) {}
+
+    // Fills served by a module that was already loaded.
+    uint64_t module_hits;
+
+    // Fills that found no symbols for the frame's module.
+    uint64_t module_misses;
+
+    // Symbol loads performed (fetch plus parse).
+    uint64_t modules_loaded;
+
+    // Total wall time spent fetching and loading symbols that were
+    // found, microseconds.  Retained for callers that do not care about
+    // the split below.
+    uint64_t load_time_us;
+
+    // Time in the supplier retrieving symbol data - including lookups
+    // that found nothing, which load_time_us does not count - and time
+    // in the resolver parsing data that was found.
+    uint64_t fetch_time_us;
+    uint64_t parse_time_us;
+
+    // Total time spent in FillSourceLineInfo, microseconds, including
+    // load_time_us.  Summed across worker threads, so it can exceed
+    // wall time during a concurrent walk.
+    uint64_t fill_time_us;
+  };
+
   enum SymbolizerResult {
     // Symbol data was found and successfully loaded in resolver.
     // This does NOT guarantee source line info is found within symbol file.
@@ -68,7 +122,13 @@ class StackFrameSymbolizer {
   StackFrameSymbolizer(SymbolSupplier* supplier,
                        SourceLineResolverInterface* resolver);
 
-  virtual ~StackFrameSymbolizer() { }
+  virtual ~StackFrameSymbolizer();
+
+  // Forwards the module list to the supplier's batch prefetch hook, so
+  // symbol fetching can overlap with the stack walk.  Safe to call with
+  // a NULL supplier or module list.
+  virtual void PrefetchSymbolFiles(const CodeModules* modules,
+                                   const SystemInfo* system_info);
 
   // Encapsulate the step of resolving source line info for a stack frame.
   // "frame" must not be NULL.
@@ -76,15 +136,50 @@ class StackFrameSymbolizer {
                                               const SystemInfo* system_info,
                                               StackFrame* stack_frame);
 
-  virtual WindowsFrameInfo* FindWindowsFrameInfo(const StackFrame* frame);
+  // Resolves source line info for a whole set of frames at once, through
+  // the resolver's sorted batch lookup.  The frames' modules must already
+  // have been identified and their symbols loaded by earlier
+  // FillSourceLineInfo calls - as is the case for every frame of a walked
+  // stack.  Callers that defer line resolution during the walk with
+  // set_resolve_source_lines(false) can use this to resolve each stack
+  // in one sweep afterwards.  Frames without loaded symbols are left
+  // untouched.
+  virtual void FillSourceLineInfoBatch(std::vector<StackFrame*>* frames);
+
+  // Same as FillSourceLineInfo, except the per-frame function and
+  // source line lookup is always skipped, regardless of
+  // set_resolve_source_lines: the module is identified and its symbols
+  // loaded - so frame info stays available to the walker and missing
+  // symbols are detected - but the frame is left unsymbolized.  A
+  // pipelined walk uses this for the frames it pushes, then resolves
+  // each finished stack with FillSourceLineInfoBatch, so symbol lookups
+  // overlap with the unwinding instead of stalling it.
+  virtual SymbolizerResult LoadFrameSymbols(const CodeModules* modules,
+                                            const SystemInfo* system_info,
+                                            StackFrame* stack_frame);
 
-  virtual CFIFrameInfo* FindCFIFrameInfo(const StackFrame* frame);
+  // Fill the caller-provided *frame_info with the resolver's frame info
+  // covering |frame|, returning true when any was found.  See
+  // SourceLineResolverInterface; the caller supplies the structure so
+  // the walkers can reuse one object across the frames of a walk.
+  virtual bool FindWindowsFrameInfo(const StackFrame* frame,
+                                    WindowsFrameInfo* frame_info);
+
+  virtual bool FindCFIFrameInfo(const StackFrame* frame,
+                                CFIFrameInfo* frame_info);
 
   // Reset internal (locally owned) data as if the helper is re-instantiated.
   // A typical case is to call Reset() after processing an individual report
   // before start to process next one, in order to reset internal information
-  // about missing symbols found so far.
-  virtual void Reset() { no_symbol_modules_.clear(); }
+  // about missing symbols found so far.  Modules already loaded into the
+  // resolver, and session_stats(), are deliberately retained, as is the
+  // module co-occurrence history behind set_predictive_prefetch, which
+  // treats each Reset() as a dump boundary.  Must not be called while
+  // other threads are symbolizing frames.
+  virtual void Reset();
+
+  // Returns a snapshot of the session counters.
+  SessionStats session_stats();
 
   // Returns true if there is valid implementation for stack symbolization.
   virtual bool HasImplementation() { return resolver_ && supplier_; }
@@ -92,12 +187,155 @@ class StackFrameSymbolizer {
   SourceLineResolverInterface* resolver() { return resolver_; }
   SymbolSupplier* supplier() { return supplier_; }
 
+  // Sets the pool frames symbolized from now on intern their name
+  // strings in.  The pool is not owned and must outlive the frames; pass
+  // NULL to let each frame own its strings again.
+  void set_intern_pool(StringInternPool* intern_pool) {
+    intern_pool_ = intern_pool;
+  }
+
+  // Sets a pool that takes precedence over set_intern_pool for every
+  // frame symbolized through this object.  Dumps processed concurrently
+  // through one symbolizer cannot each point intern_pool_ at their own
+  // ProcessState, so a batch session pins one thread-safe pool here for
+  // the whole batch; see MinidumpBatchProcessor.  The pool is not owned
+  // and must outlive the frames.  Pass NULL to return to per-dump pools.
+  void set_session_intern_pool(StringInternPool* session_intern_pool) {
+    session_intern_pool_ = session_intern_pool;
+  }
+
+  // Sets the per-module unwind strategy hint store walkers consult
+  // through this symbolizer.  Like the symbolizer itself the store is a
+  // cross-dump session object: it accumulates strategy outcomes over
+  // every dump processed and lets later dumps skip lookups it has
+  // learned are doomed for a module.  Not owned, and must outlive any
+  // walk in progress; pass NULL for no hints (the default).
+  void set_unwind_strategy_hints(UnwindStrategyHints* hints) {
+    unwind_strategy_hints_ = hints;
+  }
+
+  UnwindStrategyHints* unwind_strategy_hints() {
+    return unwind_strategy_hints_;
+  }
+
+  // When false, FillSourceLineInfo still loads each module's symbols -
+  // so CFI and Windows frame info remain available to the walkers, and
+  // modules with missing symbols are still detected - but skips the
+  // per-frame function and source line lookup, leaving the frame
+  // unsymbolized.  For callers that only consume the stack addresses or
+  // the modules-without-symbols list.  Defaults to true.
+  void set_resolve_source_lines(bool resolve_source_lines) {
+    resolve_source_lines_ = resolve_source_lines;
+  }
+
+  // When enabled, the symbolizer learns which modules get touched
+  // together across the dumps of this session - dump boundaries being
+  // the Reset() calls - and, on the first module touch of each new
+  // dump, starts a background worker that fetches and parses symbols
+  // for the companions history predicts for that module.  By the time
+  // the walker reaches them, their symbols are warm instead of being
+  // faulted in serially.  Only useful when the symbolizer is reused
+  // across dumps with a Reset() per dump; concurrent batch sessions
+  // reset once per batch and learn nothing.  Off by default; no effect
+  // on Windows, where the worker implementation is not available.
+  void set_predictive_prefetch(bool enable) {
+    predictive_prefetch_ = enable;
+  }
+
  protected:
+  // Serves the frame from state already in the resolver: a memoized
+  // missing symbol file, or a module that is already loaded.  Returns
+  // true and sets *symbolizer_result if the frame was served.
+  // resolve_lines controls whether a served frame also gets its source
+  // line lookup.  The caller must hold lock_, shared or exclusive.
+  bool ResolveFromLoadedModule(StackFrame* frame,
+                               const CodeModule* module,
+                               bool resolve_lines,
+                               SymbolizerResult* symbolizer_result);
+
+  // The work behind FillSourceLineInfo and LoadFrameSymbols, which
+  // differ only in whether the per-frame line lookup runs.
+  SymbolizerResult FillSourceLineInfoInternal(const CodeModules* modules,
+                                              const SystemInfo* system_info,
+                                              StackFrame* stack_frame,
+                                              bool resolve_lines);
+
   SymbolSupplier* supplier_;
   SourceLineResolverInterface* resolver_;
   // A list of modules known to have symbols missing. This helps avoid
   // repeated lookups for the missing symbols within one minidump.
+  // Read under either side of lock_; modified only under the exclusive
+  // side.
   std::set<string> no_symbol_modules_;
+
+  // Counters for session_stats(), advanced atomically under either
+  // side of lock_ and snapshotted under the exclusive side.
+  SessionStats stats_;
+
+  // The pool frames intern their name strings in; NULL for none.  Not
+  // owned.  MinidumpProcessor points this at the ProcessState being
+  // filled, so frames share the strings with the state that owns them.
+  StringInternPool* intern_pool_;
+
+  // When set, overrides intern_pool_.  See set_session_intern_pool.
+  StringInternPool* session_intern_pool_;
+
+  // The unwind strategy hint store walkers consult; NULL for none.
+  // Not owned.  See set_unwind_strategy_hints.
+  UnwindStrategyHints* unwind_strategy_hints_;
+
+  // Whether FillSourceLineInfo performs the per-frame source line
+  // lookup.  See set_resolve_source_lines.
+  bool resolve_source_lines_;
+
+  // Whether module touches feed the co-occurrence history and trigger
+  // the predictive prefetch worker.  See set_predictive_prefetch.
+  bool predictive_prefetch_;
+
+#ifndef _WIN32
+  // Lets a single symbolizer be shared by stackwalkers running
+  // concurrently on several threads (see
+  // MinidumpProcessor::set_max_worker_threads).  Symbol loads always
+  // hold the lock exclusively.  When the resolver supports concurrent
+  // lookups, frames resolved from already loaded modules hold it
+  // shared, so workers no longer take turns on the hot path; otherwise
+  // lookups are exclusive too.
+  pthread_rwlock_t lock_;
+
+  // Notes that |module| was touched by the dump in flight and, on the
+  // first touch of a dump, starts the predictive prefetch worker for
+  // the companions the history predicts.  Called with lock_ not held.
+  void RecordModuleTouch(const CodeModule* module,
+                         const CodeModules* modules,
+                         const SystemInfo* system_info);
+
+  // Fetches and parses one predicted module's symbols, exactly as a
+  // frame touching it would, except that the supplier fetch runs
+  // outside lock_ so walkers are not blocked behind the prefetch I/O.
+  void PrefetchOneModule(const CodeModule* module,
+                         const SystemInfo* system_info);
+
+  // Entry point of the predictive prefetch worker thread; arg is the
+  // job built by RecordModuleTouch.
+  static void* PredictivePrefetchWorker(void* arg);
+
+  // Joins the in-flight prefetch worker, if any.
+  void JoinPrefetchWorker();
+
+  // Module co-occurrence history: for each code file, the code files
+  // that have been touched in the same dump at least once this
+  // session.  With it, the touched set of the dump in flight and the
+  // one-spawn-per-dump latch.  Guarded by history_mutex_; the worker
+  // thread itself never takes it.
+  std::map<string, std::set<string> > companion_history_;
+  std::set<string> touched_this_dump_;
+  pthread_mutex_t history_mutex_;
+
+  // The predictive prefetch worker, at most one in flight.  Joined at
+  // each Reset() and on destruction.
+  pthread_t prefetch_thread_;
+  bool prefetch_thread_running_;
+#endif
 };
 
 }  // namespace google_breakpad
@@ -41,6 +41,11 @@
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_STACKWALKER_H__
 #define GOOGLE_BREAKPAD_PROCESSOR_STACKWALKER_H__
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
@@ -55,11 +60,73 @@ namespace google_breakpad {
 
 class CallStack;
 class MinidumpContext;
+class MinidumpMemoryList;
+class PrologueLayoutCache;
+class StackFrameArena;
 class StackFrameSymbolizer;
 
 using std::set;
 using std::vector;
 
+// Records, per code module, how often CFI recovered a caller frame and
+// how often stack scanning was attempted and succeeded.  One instance is
+// shared by every walker of a processing session (see MinidumpProcessor),
+// so the numbers accumulate across threads and dumps; updates are
+// internally locked.  Walkers consult the record to size their scan
+// windows: a module whose frames CFI reliably unwinds rarely profits
+// from a deep scan, while a module whose scans usually succeed deserves
+// a wider window.  The counters are also exported for offline tuning.
+class StackScanTelemetry {
+ public:
+  // Counters for one code module, keyed by code file so they aggregate
+  // across the dumps of a batch.
+  struct ModuleStats {
+    ModuleStats()
+        : cfi_hits(0), cfi_misses(0), scan_attempts(0), scan_successes(0) {}
+
+    string code_file;
+    uint64_t cfi_hits;
+    uint64_t cfi_misses;
+    uint64_t scan_attempts;
+    uint64_t scan_successes;
+  };
+
+  StackScanTelemetry();
+  ~StackScanTelemetry();
+
+  // Records whether CFI produced a caller frame for a frame in |module|.
+  // |module| may be NULL, in which case nothing is recorded.
+  void RecordCFIResult(const CodeModule* module, bool hit);
+
+  // Records the outcome of a stack scan below a frame in |module|.
+  void RecordScanResult(const CodeModule* module, bool success);
+
+  // Returns the number of stack words a scan below a frame in |module|
+  // should examine.  Until enough outcomes accumulate this is
+  // |default_words|; afterwards the window narrows for modules that CFI
+  // unwinds reliably and scans rarely help, and widens for modules whose
+  // scans usually succeed.
+  int ScanWindow(const CodeModule* module, int default_words);
+
+  // Copies a snapshot of every module's counters into |stats|, in no
+  // particular order.
+  void GetStats(vector<ModuleStats>* stats);
+
+ private:
+  typedef std::map<string, ModuleStats> StatsMap;
+
+  // Returns the stats slot for |module|, creating it on first use.
+  // The lock must be held.
+  ModuleStats* StatsForModule(const CodeModule* module);
+
+  StatsMap stats_;
+
+#ifndef _WIN32
+  // Guards stats_ against the concurrent walkers of one session.
+  pthread_mutex_t lock_;
+#endif
+};
+
 class Stackwalker {
  public:
   virtual ~Stackwalker() {}
@@ -91,6 +158,64 @@ class Stackwalker {
   static void set_max_frames(uint32_t max_frames) { max_frames_ = max_frames; }
   static uint32_t max_frames() { return max_frames_; }
 
+  // Caps the number of stack words any single ScanForReturnAddress call
+  // examines, overriding the caller's requested search depth when that
+  // is larger.  0, the default, leaves requested depths alone.  Deep
+  // scan-heavy stacks are the dominant cost of pathological dumps; see
+  // MinidumpProcessor::set_processing_time_budget_ms.
+  void set_scan_word_limit(int scan_word_limit) {
+    scan_word_limit_ = scan_word_limit;
+  }
+
+  // Sets an absolute wall-clock deadline, in microseconds as returned
+  // by gettimeofday, after which Walk stops adding caller frames and
+  // reports the stack as truncated.  0, the default, means no deadline.
+  // Has no effect where no cheap clock is available (Windows).
+  void set_walk_deadline_us(uint64_t walk_deadline_us) {
+    walk_deadline_us_ = walk_deadline_us;
+  }
+
+  // Returns true if the last Walk stopped before the end of the stack,
+  // because it reached max_frames or its deadline.
+  bool walk_truncated() const { return walk_truncated_; }
+
+  // Points this walker at a session's scan telemetry, so that scan
+  // windows adapt to how each module has unwound so far.  The telemetry
+  // is not owned and must outlive the walker; NULL, the default,
+  // disables both recording and adaptation.
+  void set_scan_telemetry(StackScanTelemetry* scan_telemetry) {
+    scan_telemetry_ = scan_telemetry;
+  }
+
+  // Gives the walker access to the dump's full memory list, so fallbacks
+  // that inspect function code - such as the ARM prologue analysis - can
+  // read the instruction bytes minidumps capture around each thread's
+  // program counter.  Reading these regions goes through Minidump I/O,
+  // which is not safe for concurrent use: only set this when the walk
+  // runs on the thread that owns the dump.  The list is not owned and
+  // NULL, the default, disables code inspection.
+  void set_instruction_memory(MinidumpMemoryList* instruction_memory) {
+    instruction_memory_ = instruction_memory;
+  }
+
+  // Points this walker at a session's cache of prologue-derived frame
+  // layouts, so a function analyzed for one thread or dump is not
+  // re-analyzed for the next.  Not owned; must outlive the walker.
+  void set_prologue_layout_cache(PrologueLayoutCache* prologue_layout_cache) {
+    prologue_layout_cache_ = prologue_layout_cache;
+  }
+
+  // When true, Walk loads each frame's symbols without filling its
+  // function and source line fields, leaving the walked stack to be
+  // resolved afterwards with StackFrameSymbolizer::FillSourceLineInfoBatch
+  // - typically on a pipelined symbolization stage that runs while the
+  // next stack unwinds.  The unwind itself is unaffected: frame info
+  // and the scanning heuristics still see loaded symbols.  Defaults to
+  // false.
+  void set_defer_source_lines(bool defer_source_lines) {
+    defer_source_lines_ = defer_source_lines;
+  }
+
  protected:
   // system_info identifies the operating system, NULL or empty if unknown.
   // memory identifies a MemoryRegion that provides the stack memory
@@ -142,18 +267,49 @@ class Stackwalker {
                             InstructionType* location_found,
                             InstructionType* ip_found,
                             int searchwords) {
-    for (InstructionType location = location_start;
-         location <= location_start + searchwords * sizeof(InstructionType);
-         location += sizeof(InstructionType)) {
-      InstructionType ip;
-      if (!memory_->GetMemoryAtAddress(location, &ip))
-        break;
-
-      if (modules_ && modules_->GetModuleForAddress(ip) &&
-          InstructionAddressSeemsValid(ip)) {
-        *ip_found = ip;
-        *location_found = location;
-        return true;
+    if (scan_word_limit_ && searchwords > scan_word_limit_) {
+      searchwords = scan_word_limit_;
+    }
+    // Gather candidate words in batches and cheaply reject those that
+    // cannot lie within any loaded module before paying for the module
+    // map lookup and the symbol-based validity check.  The range test is
+    // vectorized in WordsInRange where SSE2 is available.
+    const InstructionType end =
+        location_start + searchwords * sizeof(InstructionType);
+    InstructionType location = location_start;
+    bool read_failed = false;
+
+    while (!read_failed && location <= end) {
+      InstructionType words[kScanBatchWords];
+      int count = 0;
+      InstructionType batch_start = location;
+      while (count < kScanBatchWords && location <= end) {
+        if (!memory_->GetMemoryAtAddress(location, &words[count])) {
+          read_failed = true;
+          break;
+        }
+        ++count;
+        location += sizeof(InstructionType);
+      }
+
+      unsigned int candidates = WordsInRange(words, count,
+                                             modules_lowest_address_,
+                                             modules_highest_address_);
+      while (candidates) {
+        // Consider candidates lowest-address-first so that the first
+        // plausible return address wins, as in a straight linear scan.
+        int index = 0;
+        while (!(candidates & (1u << index)))
+          ++index;
+        candidates &= ~(1u << index);
+
+        InstructionType ip = words[index];
+        if (modules_ && modules_->IsTextAddress(ip) &&
+            InstructionAddressSeemsValid(ip)) {
+          *ip_found = ip;
+          *location_found = batch_start + index * sizeof(InstructionType);
+          return true;
+        }
       }
     }
     // nothing found
@@ -172,15 +328,61 @@ class Stackwalker {
   // This field is optional and may be NULL.
   const CodeModules* modules_;
 
+  // The number of words ScanForReturnAddress examines per batch.  Must
+  // not exceed the number of bits in the mask WordsInRange returns.
+  static const int kScanBatchWords = 16;
+
+  // Returns a bitmask with bit i set if words[i] lies in [low, high).
+  // count must not exceed kScanBatchWords.  Implemented with SSE2 where
+  // available; both bounds are zero when no modules are known, so every
+  // word is rejected, matching the old scan's behavior.
+  static unsigned int WordsInRange(const uint32_t* words, int count,
+                                   uint64_t low, uint64_t high);
+  static unsigned int WordsInRange(const uint64_t* words, int count,
+                                   uint64_t low, uint64_t high);
+
+  // The lowest base address and highest end address of any module in
+  // modules_, cached at construction as the bounds for WordsInRange.
+  uint64_t modules_lowest_address_;
+  uint64_t modules_highest_address_;
+
+  // The scan depth cap and walk deadline, 0 when unset.  See
+  // set_scan_word_limit and set_walk_deadline_us.
+  int scan_word_limit_;
+  uint64_t walk_deadline_us_;
+
+  // Session-wide scan telemetry, NULL when unset.  See
+  // set_scan_telemetry.
+  StackScanTelemetry* scan_telemetry_;
+
+  // The dump's memory list for code inspection and the session's cache
+  // of prologue-derived layouts, NULL when unset.  See
+  // set_instruction_memory and set_prologue_layout_cache.
+  MinidumpMemoryList* instruction_memory_;
+  PrologueLayoutCache* prologue_layout_cache_;
+
+  // Whether the last Walk stopped early.  See walk_truncated.
+  bool walk_truncated_;
+
+  // Whether Walk leaves source line resolution to a later batch pass.
+  // See set_defer_source_lines.
+  bool defer_source_lines_;
+
  protected:
   // The StackFrameSymbolizer implementation.
   StackFrameSymbolizer* frame_symbolizer_;
 
+  // The arena, owned by the CallStack being walked, from which the
+  // GetContextFrame and GetCallerFrame implementations allocate frames.
+  // Set by Walk for the duration of a walk, NULL otherwise.
+  StackFrameArena* frame_arena_;
+
  private:
   // Obtains the context frame, the innermost called procedure in a stack
   // trace.  Returns NULL on failure.  GetContextFrame allocates a new
-  // StackFrame (or StackFrame subclass), ownership of which is taken by
-  // the caller.
+  // StackFrame (or StackFrame subclass) from frame_arena_; the caller is
+  // responsible for running its destructor if it is not pushed onto the
+  // CallStack.
   virtual StackFrame* GetContextFrame() = 0;
 
   // Obtains a caller frame.  Each call to GetCallerFrame should return the
@@ -189,8 +391,9 @@ class Stackwalker {
   // made of frames that have already been walked.  GetCallerFrame should
   // return NULL on failure or when there are no more caller frames (when
   // the end of the stack has been reached).  GetCallerFrame allocates a new
-  // StackFrame (or StackFrame subclass), ownership of which is taken by
-  // the caller.
+  // StackFrame (or StackFrame subclass) from frame_arena_; the caller is
+  // responsible for running its destructor if it is not pushed onto the
+  // CallStack.
   virtual StackFrame* GetCallerFrame(const CallStack* stack) = 0;
 
   // The maximum number of frames Stackwalker will walk through.
@@ -0,0 +1,112 @@
+// -*- mode: C++ -*-
+
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// string_intern_pool.h: A pool of shared immutable strings.
+//
+// A minidump with many threads blocked in the same runtime symbolizes
+// the same long function and file names once per frame.  Interning those
+// names in a per-ProcessState pool stores each distinct string once;
+// frames reference the pooled copy instead of owning their own.
+//
+// Author: Mark Mentovai
+
+#ifndef GOOGLE_BREAKPAD_PROCESSOR_STRING_INTERN_POOL_H__
+#define GOOGLE_BREAKPAD_PROCESSOR_STRING_INTERN_POOL_H__
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include <set>
+#include <string>
+
+#include "common/using_std_string.h"
+
+namespace google_breakpad {
+
+class StringInternPool {
+ public:
+  StringInternPool() : strings_() {
+#ifndef _WIN32
+    pthread_mutex_init(&lock_, NULL);
+#endif
+  }
+
+  ~StringInternPool() {
+#ifndef _WIN32
+    pthread_mutex_destroy(&lock_);
+#endif
+  }
+
+  // Returns a pointer to a pooled copy of |str|, valid until the pool is
+  // cleared or destroyed.  Equal strings always yield the same pointer.
+  // Safe to call from several threads at once; see lock_.
+  const string* Intern(const string &str) {
+#ifndef _WIN32
+    pthread_mutex_lock(&lock_);
+#endif
+    const string* interned = &*strings_.insert(str).first;
+#ifndef _WIN32
+    pthread_mutex_unlock(&lock_);
+#endif
+    return interned;
+  }
+
+  // Discards all pooled strings, invalidating pointers Intern returned.
+  // Unlike Intern, must not race with other calls into the pool.
+  void Clear() { strings_.clear(); }
+
+  // Exchanges the pooled strings with |other| without copying them;
+  // pointers Intern returned remain valid but are owned by the other
+  // pool afterwards.  The locks are not exchanged.  Same threading
+  // requirements as Clear.
+  void Swap(StringInternPool* other) { strings_.swap(other->strings_); }
+
+ private:
+  // std::set never relocates its elements, so pointers into it remain
+  // valid as the pool grows.
+  std::set<string> strings_;
+
+#ifndef _WIN32
+  // Serializes insertions, so frames symbolized concurrently can share
+  // one pool.  On Windows, where the processor has no concurrent
+  // callers, locking is omitted.
+  pthread_mutex_t lock_;
+#endif
+
+  // Disallow copy constructor and assignment operator.
+  StringInternPool(const StringInternPool&);
+  void operator=(const StringInternPool&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // GOOGLE_BREAKPAD_PROCESSOR_STRING_INTERN_POOL_H__
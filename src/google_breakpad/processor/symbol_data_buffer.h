@@ -0,0 +1,89 @@
+// Copyright (c) 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbol_data_buffer.h: A reference-counted, immutable block of symbol
+// data.
+//
+// A symbol supplier that hands the same module's symbol bytes to
+// several resolvers - or to several dumps in flight - can back them all
+// with one SymbolDataBuffer instead of a private copy each.  Consumers
+// must treat the bytes as read-only; a resolver whose parser writes to
+// its input (the basic resolver tokenizes in place) has to work on a
+// copy.  The buffer deletes itself when the last reference is released.
+
+#ifndef GOOGLE_BREAKPAD_PROCESSOR_SYMBOL_DATA_BUFFER_H__
+#define GOOGLE_BREAKPAD_PROCESSOR_SYMBOL_DATA_BUFFER_H__
+
+#include <stddef.h>
+
+namespace google_breakpad {
+
+class SymbolDataBuffer {
+ public:
+  // Takes ownership of |data|, which must have been allocated with
+  // new[].  The initial reference belongs to the caller.
+  SymbolDataBuffer(char *data, size_t size)
+      : data_(data), size_(size), references_(1) {}
+
+  // The symbol bytes, NUL-terminated at size().
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Reference management.  The base implementations are not
+  // synchronized; a supplier that shares buffers across threads
+  // overrides them to take the lock that also guards its registry of
+  // buffers, so a registry lookup cannot revive a buffer whose last
+  // reference is being dropped.
+  virtual void AddRef() { TakeRef(); }
+  virtual void Release() {
+    if (DropRef() == 0)
+      delete this;
+  }
+
+ protected:
+  virtual ~SymbolDataBuffer() { delete [] data_; }
+
+  // Unsynchronized count manipulation, for Release/AddRef overrides
+  // that provide their own locking.  DropRef returns the new count.
+  void TakeRef() { ++references_; }
+  int DropRef() { return --references_; }
+
+ private:
+  char *data_;
+  size_t size_;
+  int references_;
+
+  // Disable copy ctor and operator=.
+  SymbolDataBuffer(const SymbolDataBuffer&);
+  SymbolDataBuffer& operator=(const SymbolDataBuffer&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // GOOGLE_BREAKPAD_PROCESSOR_SYMBOL_DATA_BUFFER_H__
@@ -39,6 +39,8 @@
 namespace google_breakpad {
 
 class CodeModule;
+class CodeModules;
+class SymbolDataBuffer;
 struct SystemInfo;
 
 class SymbolSupplier {
@@ -57,6 +59,14 @@ class SymbolSupplier {
 
   virtual ~SymbolSupplier() {}
 
+  // Hints that symbol files for all of modules will be requested soon,
+  // so a supplier may begin fetching or reading them in the background
+  // before the stack walk first touches each module.  Purely advisory:
+  // GetSymbolFile must still be called to obtain results, and the
+  // default implementation does nothing.
+  virtual void PrefetchSymbolFiles(const CodeModules *modules,
+                                   const SystemInfo *system_info) {}
+
   // Retrieves the symbol file for the given CodeModule, placing the
   // path in symbol_file if successful.  system_info contains strings
   // identifying the operating system and CPU; SymbolSupplier may use
@@ -91,6 +101,26 @@ class SymbolSupplier {
 
   // Frees the data buffer allocated for the module in GetCStringSymbolData.
   virtual void FreeSymbolData(const CodeModule *module) = 0;
+
+  // Returns true if this supplier implements GetSharedSymbolData, in
+  // which case callers should prefer it over GetCStringSymbolData.
+  virtual bool SupportsSharedSymbolData() const { return false; }
+
+  // Same as GetCStringSymbolData, except the symbol data is returned as
+  // a reference-counted SymbolDataBuffer, so one physical buffer can
+  // back every consumer of the module's symbols at once.  On FOUND,
+  // *symbol_data carries a reference belonging to the caller; the
+  // caller must treat the bytes as read-only and call Release - not
+  // FreeSymbolData - when done.  The buffer outlives the reference
+  // holders' use of it regardless of what the supplier does afterwards.
+  // The default implementation returns NOT_FOUND; see
+  // SupportsSharedSymbolData.
+  virtual SymbolResult GetSharedSymbolData(const CodeModule *module,
+                                           const SystemInfo *system_info,
+                                           string *symbol_file,
+                                           SymbolDataBuffer **symbol_data) {
+    return NOT_FOUND;
+  }
 };
 
 }  // namespace google_breakpad
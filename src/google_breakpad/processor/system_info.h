@@ -56,6 +56,18 @@ struct SystemInfo {
     cpu_count = 0;
   }
 
+  // Exchanges contents with |other| without copying the strings.
+  void Swap(SystemInfo* other) {
+    os.swap(other->os);
+    os_short.swap(other->os_short);
+    os_version.swap(other->os_version);
+    cpu.swap(other->cpu);
+    cpu_info.swap(other->cpu_info);
+    int other_cpu_count = other->cpu_count;
+    other->cpu_count = cpu_count;
+    cpu_count = other_cpu_count;
+  }
+
   // A string identifying the operating system, such as "Windows NT",
   // "Mac OS X", or "Linux".  If the information is present in the dump but
   // its value is unknown, this field will contain a numeric value.  If
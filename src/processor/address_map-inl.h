@@ -47,6 +47,11 @@ namespace google_breakpad {
 template<typename AddressType, typename EntryType>
 bool AddressMap<AddressType, EntryType>::Store(const AddressType &address,
                                                const EntryType &entry) {
+  // Late store into a frozen map: restore the tree representation so the
+  // conflict check and insertion below work normally.
+  if (!flat_.empty())
+    Thaw();
+
   // Ensure that the specified address doesn't conflict with something already
   // in the map.
   if (map_.find(address) != map_.end()) {
@@ -66,6 +71,28 @@ bool AddressMap<AddressType, EntryType>::Retrieve(
   BPLOG_IF(ERROR, !entry) << "AddressMap::Retrieve requires |entry|";
   assert(entry);
 
+  // We want the last element whose key is less than or equal to address.
+  if (!flat_.empty()) {
+    size_t low = 0;
+    size_t high = flat_.size();
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      if (flat_[mid].first <= address) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    if (low == 0)
+      return false;
+
+    *entry = flat_[low - 1].second;
+    if (entry_address)
+      *entry_address = flat_[low - 1].first;
+
+    return true;
+  }
+
   // upper_bound gives the first element whose key is greater than address,
   // but we want the first element whose key is less than or equal to address.
   // Decrement the iterator to get there, but not if the upper_bound already
@@ -86,6 +113,29 @@ bool AddressMap<AddressType, EntryType>::Retrieve(
 template<typename AddressType, typename EntryType>
 void AddressMap<AddressType, EntryType>::Clear() {
   map_.clear();
+  flat_.clear();
+}
+
+template<typename AddressType, typename EntryType>
+void AddressMap<AddressType, EntryType>::Freeze() {
+  if (map_.empty())
+    return;
+
+  flat_.reserve(map_.size());
+  for (MapConstIterator iterator = map_.begin();
+       iterator != map_.end();
+       ++iterator) {
+    flat_.push_back(*iterator);
+  }
+  map_.clear();
+}
+
+template<typename AddressType, typename EntryType>
+void AddressMap<AddressType, EntryType>::Thaw() {
+  for (size_t index = 0; index < flat_.size(); ++index) {
+    map_.insert(flat_[index]);
+  }
+  flat_.clear();
 }
 
 }  // namespace google_breakpad
@@ -39,6 +39,8 @@
 #define PROCESSOR_ADDRESS_MAP_H__
 
 #include <map>
+#include <utility>
+#include <vector>
 
 namespace google_breakpad {
 
@@ -67,6 +69,15 @@ class AddressMap {
   // initially created.
   void Clear();
 
+  // Converts the map to a flat sorted-vector representation, queried by
+  // binary search over contiguous memory instead of a tree descent.  Call
+  // once the map is fully built.  Storing into a frozen map folds it back
+  // into tree form first.
+  void Freeze();
+
+  // Reverses Freeze, restoring the tree representation.
+  void Thaw();
+
  private:
   friend class AddressMapSerializer<AddressType, EntryType>;
   friend class ModuleComparer;
@@ -76,8 +87,15 @@ class AddressMap {
   typedef typename AddressToEntryMap::const_iterator MapConstIterator;
   typedef typename AddressToEntryMap::value_type MapValue;
 
-  // Maps the address of each entry to an EntryType.
+  typedef std::vector<std::pair<AddressType, EntryType> > FlatEntryVector;
+
+  // Maps the address of each entry to an EntryType.  Empty when the map
+  // is frozen.
   AddressToEntryMap map_;
+
+  // The frozen representation: the same (address, entry) pairs in
+  // ascending key order.  Non-empty only after Freeze.
+  FlatEntryVector flat_;
 };
 
 }  // namespace google_breakpad
@@ -38,6 +38,8 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
 #include "google_breakpad/processor/code_module.h"
 #include "processor/linked_ptr.h"
 #include "processor/logging.h"
@@ -47,7 +49,8 @@ namespace google_breakpad {
 
 BasicCodeModules::BasicCodeModules(const CodeModules *that)
     : main_address_(0),
-      map_(new RangeMap<uint64_t, linked_ptr<const CodeModule> >()) {
+      map_(new RangeMap<uint64_t, linked_ptr<const CodeModule> >()),
+      extents_(new std::vector<Extent>()) {
   BPLOG_IF(ERROR, !that) << "BasicCodeModules::BasicCodeModules requires "
                             "|that|";
   assert(that);
@@ -69,12 +72,37 @@ BasicCodeModules::BasicCodeModules(const CodeModules *that)
                           linked_ptr<const CodeModule>(module))) {
       BPLOG(ERROR) << "Module " << module->code_file() <<
                       " could not be stored";
+      continue;
     }
+
+    // Index only modules that were actually stored, so that IsTextAddress
+    // agrees with GetModuleForAddress.
+    Extent extent;
+    extent.base = module->base_address();
+    extent.limit = module->base_address() + module->size();
+    extents_->push_back(extent);
   }
+
+  std::sort(extents_->begin(), extents_->end(), ExtentBaseLessThan);
+
+  // The module list never changes after construction; flatten the range
+  // map for query speed.
+  map_->Freeze();
+}
+
+// static
+bool BasicCodeModules::ExtentBaseLessThan(const Extent &left,
+                                          const Extent &right) {
+  return left.base < right.base;
+}
+
+BasicCodeModules::BasicCodeModules(const BasicCodeModules &that)
+    : main_address_(that.main_address_),
+      map_(that.map_),
+      extents_(that.extents_) {
 }
 
 BasicCodeModules::~BasicCodeModules() {
-  delete map_;
 }
 
 unsigned int BasicCodeModules::module_count() const {
@@ -92,6 +120,23 @@ const CodeModule* BasicCodeModules::GetModuleForAddress(
   return module.get();
 }
 
+bool BasicCodeModules::IsTextAddress(uint64_t address) const {
+  // Find the first extent whose base is above address; the only extent
+  // that can contain address is the one before it.
+  const std::vector<Extent> &extents = *extents_;
+  size_t low = 0;
+  size_t high = extents.size();
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (extents[mid].base <= address) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low > 0 && address < extents[low - 1].limit;
+}
+
 const CodeModule* BasicCodeModules::GetMainModule() const {
   return GetModuleForAddress(main_address_);
 }
@@ -117,7 +162,9 @@ const CodeModule* BasicCodeModules::GetModuleAtIndex(
 }
 
 const CodeModules* BasicCodeModules::Copy() const {
-  return new BasicCodeModules(this);
+  // The snapshot is immutable, so a copy is just another shared handle
+  // on the same contents.
+  return new BasicCodeModules(*this);
 }
 
 }  // namespace google_breakpad
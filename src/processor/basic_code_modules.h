@@ -36,16 +36,24 @@
 // implementation a place to store information when the life of the original
 // object (such as a MinidumpModuleList) cannot be guaranteed.
 //
+// A BasicCodeModules object is an immutable snapshot: nothing can be
+// added or removed after construction.  That makes Copy cheap - copies
+// are small handles that share the snapshot's reference-counted
+// contents, rather than duplicating every contained CodeModule and its
+// strings.
+//
 // Author: Mark Mentovai
 
 #ifndef PROCESSOR_BASIC_CODE_MODULES_H__
 #define PROCESSOR_BASIC_CODE_MODULES_H__
 
+#include <vector>
+
 #include "google_breakpad/processor/code_modules.h"
+#include "processor/linked_ptr.h"
 
 namespace google_breakpad {
 
-template<typename T> class linked_ptr;
 template<typename AddressType, typename EntryType> class RangeMap;
 
 class BasicCodeModules : public CodeModules {
@@ -62,21 +70,42 @@ class BasicCodeModules : public CodeModules {
   // See code_modules.h for descriptions of these methods.
   virtual unsigned int module_count() const;
   virtual const CodeModule* GetModuleForAddress(uint64_t address) const;
+  virtual bool IsTextAddress(uint64_t address) const;
   virtual const CodeModule* GetMainModule() const;
   virtual const CodeModule* GetModuleAtSequence(unsigned int sequence) const;
   virtual const CodeModule* GetModuleAtIndex(unsigned int index) const;
   virtual const CodeModules* Copy() const;
 
  private:
+  // The sharing constructor used by Copy.  The new object is a handle on
+  // the same immutable snapshot as |that|: the module map and extent
+  // index are shared by reference, and no CodeModule objects are
+  // duplicated.
+  explicit BasicCodeModules(const BasicCodeModules &that);
+
   // The base address of the main module.
   uint64_t main_address_;
 
   // The map used to contain each CodeModule, keyed by each CodeModule's
-  // address range.
-  RangeMap<uint64_t, linked_ptr<const CodeModule> > *map_;
+  // address range.  Reference-counted so that copies made after
+  // construction share the snapshot instead of duplicating it.
+  linked_ptr<RangeMap<uint64_t, linked_ptr<const CodeModule> > > map_;
+
+  // The address range of each stored module, sorted by base address.
+  // Stack scanning tests every candidate word on the stack for module
+  // membership; a binary search over this flat array is a handful of
+  // cache-friendly loads, where the equivalent RangeMap descent chases
+  // tree nodes and copies a linked_ptr.
+  struct Extent {
+    uint64_t base;
+    uint64_t limit;  // one past the last address in the module
+  };
+  linked_ptr<std::vector<Extent> > extents_;
+
+  // Orders extents by base address for std::sort.
+  static bool ExtentBaseLessThan(const Extent &left, const Extent &right);
 
-  // Disallow copy constructor and assignment operator.
-  BasicCodeModules(const BasicCodeModules &that);
+  // Disallow assignment operator.
   void operator=(const BasicCodeModules &that);
 };
 
@@ -37,6 +37,10 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 #include <map>
 #include <utility>
@@ -61,11 +65,268 @@ namespace google_breakpad {
 
 static const char *kWhitespace = " \r\n";
 
+#ifndef _WIN32
+// Symbol files at least this large are split into chunks and parsed on
+// multiple threads.  Smaller files aren't worth the thread startup and
+// merge costs.
+static const size_t kParallelParseThreshold = 4 * 1024 * 1024;
+
+// The maximum number of parsing threads.  The serial merge phase limits
+// how far parsing can usefully scale.
+static const long kMaxParseThreads = 8;
+#endif  // _WIN32
+
+#ifndef _WIN32
+// Returns the number of threads to use when parsing a symbol file of
+// map_buffer_length bytes.
+static int SymbolParseThreadCount(size_t map_buffer_length) {
+  if (map_buffer_length >= kParallelParseThreshold) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processors > kMaxParseThreads) {
+      processors = kMaxParseThreads;
+    }
+    if (processors > 1) {
+      return static_cast<int>(processors);
+    }
+  }
+  return 1;
+}
+
+// Returns true if line begins one of the keyword records that may start
+// a parse chunk.  Any other line is a source line record, which belongs
+// to the most recent FUNC record before it.
+static bool IsRecordBoundaryLine(const char *line) {
+  return strncmp(line, "FUNC ", 5) == 0 ||
+         strncmp(line, "PUBLIC ", 7) == 0 ||
+         strncmp(line, "FILE ", 5) == 0 ||
+         strncmp(line, "STACK ", 6) == 0 ||
+         strncmp(line, "MODULE ", 7) == 0 ||
+         strncmp(line, "INFO ", 5) == 0;
+}
+
+// One contiguous slice of a symbol file, split on record boundaries, and
+// the records parsed from it.  FUNC records (with their source lines) and
+// PUBLIC records, the bulk of a large symbol file, are parsed into the
+// chunk-local containers on a worker thread.  FILE and STACK records are
+// only collected here; the merge phase parses them serially because they
+// store into the module's shared maps.
+struct BasicSourceLineResolver::Module::ParseChunk {
+  ParseChunk() : module(NULL), begin(NULL), end(NULL), store(NULL),
+                 ok(true), error_line(NULL) {}
+
+  Module *module;
+  char *begin;  // the first character of the chunk
+  char *end;    // one past the last character of the chunk
+
+  // Storage for the records parsed from this chunk; owned by the module
+  // (see RecordStore), which adopts it during the merge.
+  RecordStore *store;
+
+  // FUNC records, with their source line records already attached.
+  vector<Function*> functions;
+
+  // PUBLIC records.
+  vector<PublicSymbol*> public_symbols;
+
+  // FILE and STACK lines, already NUL-terminated, in file order.
+  vector<char*> deferred_lines;
+
+  bool ok;
+  const char *error_line;  // the first line that failed to parse, if !ok
+};
+
+// static
+void* BasicSourceLineResolver::Module::ParseChunkWorker(void *arg) {
+  ParseChunk *chunk = static_cast<ParseChunk*>(arg);
+  chunk->module->ParseChunkRecords(chunk);
+  return NULL;
+}
+
+bool BasicSourceLineResolver::Module::ParseChunkRecords(ParseChunk *chunk) {
+  Function *cur_func = NULL;
+
+  char *line = chunk->begin;
+  while (line < chunk->end) {
+    char *eol = static_cast<char*>(memchr(line, '\n', chunk->end - line));
+    char *next = eol ? eol + 1 : chunk->end;
+    if (!eol) {
+      eol = chunk->end;
+    }
+    while (eol > line && eol[-1] == '\r') {
+      --eol;
+    }
+    *eol = '\0';
+
+    if (eol == line) {
+      // An empty line; strtok_r would have skipped it too.
+      line = next;
+      continue;
+    }
+
+    if (strncmp(line, "FUNC ", 5) == 0) {
+      cur_func = ParseFunction(line, chunk->store);
+      if (!cur_func) {
+        chunk->ok = false;
+        chunk->error_line = line;
+        return false;
+      }
+      chunk->functions.push_back(cur_func);
+    } else if (strncmp(line, "PUBLIC ", 7) == 0) {
+      // Clear cur_func: public symbols don't contain line number
+      // information.
+      cur_func = NULL;
+
+      PublicSymbol *symbol = NULL;
+      if (!ParsePublicSymbolRecord(line, chunk->store, &symbol)) {
+        chunk->ok = false;
+        chunk->error_line = line;
+        return false;
+      }
+      if (symbol) {
+        chunk->public_symbols.push_back(symbol);
+      }
+    } else if (strncmp(line, "FILE ", 5) == 0) {
+      if (load_source_lines_) {
+        chunk->deferred_lines.push_back(line);
+      }
+    } else if (strncmp(line, "STACK ", 6) == 0) {
+      chunk->deferred_lines.push_back(line);
+    } else if (strncmp(line, "MODULE ", 7) == 0 ||
+               strncmp(line, "INFO ", 5) == 0) {
+      // Ignored, as in the serial parser.
+    } else if (load_source_lines_) {
+      if (!cur_func) {
+        chunk->ok = false;
+        chunk->error_line = line;
+        return false;
+      }
+      Line *parsed_line = ParseLine(line, chunk->store);
+      if (!parsed_line) {
+        chunk->ok = false;
+        chunk->error_line = line;
+        return false;
+      }
+      cur_func->lines.StoreRange(parsed_line->address, parsed_line->size,
+                                 parsed_line);
+    }
+
+    line = next;
+  }
+  return true;
+}
+
+bool BasicSourceLineResolver::Module::LoadMapFromMemoryParallel(
+    char *memory_buffer,
+    size_t map_buffer_length,
+    int thread_count) {
+  char *buffer_end = memory_buffer + map_buffer_length;
+
+  // Cut the buffer into roughly equal chunks, moving each cut forward to
+  // the next keyword record.  Source line records left behind belong to
+  // the final FUNC of the preceding chunk.
+  vector<ParseChunk> chunks;
+  chunks.reserve(thread_count);
+  char *position = memory_buffer;
+  for (int chunk_index = 0;
+       chunk_index < thread_count && position < buffer_end;
+       ++chunk_index) {
+    ParseChunk chunk;
+    chunk.module = this;
+    chunk.begin = position;
+    // The store is adopted by this module right after the parse, so it
+    // is owned here whether or not the merge below succeeds.
+    chunk.store = new RecordStore;
+    record_stores_.push_back(chunk.store);
+
+    char *cut = buffer_end;
+    if (chunk_index < thread_count - 1) {
+      cut = memory_buffer +
+          map_buffer_length * (chunk_index + 1) / thread_count;
+      if (cut < position) {
+        cut = position;
+      }
+      char *newline =
+          static_cast<char*>(memchr(cut, '\n', buffer_end - cut));
+      cut = newline ? newline + 1 : buffer_end;
+      while (cut < buffer_end && !IsRecordBoundaryLine(cut)) {
+        newline = static_cast<char*>(memchr(cut, '\n', buffer_end - cut));
+        cut = newline ? newline + 1 : buffer_end;
+      }
+    }
+
+    chunk.end = cut;
+    position = cut;
+    chunks.push_back(chunk);
+  }
+
+  // Parse chunk 0 on the calling thread while workers handle the rest.
+  // A chunk whose thread could not be created is parsed inline after the
+  // others are joined.
+  vector<pthread_t> threads(chunks.size());
+  vector<bool> thread_created(chunks.size(), false);
+  for (size_t chunk_index = 1; chunk_index < chunks.size(); ++chunk_index) {
+    thread_created[chunk_index] =
+        pthread_create(&threads[chunk_index], NULL, ParseChunkWorker,
+                       &chunks[chunk_index]) == 0;
+  }
+  ParseChunkRecords(&chunks[0]);
+  for (size_t chunk_index = 1; chunk_index < chunks.size(); ++chunk_index) {
+    if (thread_created[chunk_index]) {
+      pthread_join(threads[chunk_index], NULL);
+    } else {
+      ParseChunkRecords(&chunks[chunk_index]);
+    }
+  }
+
+  // Merge the chunk-local results in chunk order, and parse the deferred
+  // FILE and STACK records, which store into the module's shared maps.
+  for (size_t chunk_index = 0; chunk_index < chunks.size(); ++chunk_index) {
+    ParseChunk &chunk = chunks[chunk_index];
+    if (!chunk.ok) {
+      BPLOG(ERROR) << "Parallel symbol parse failed at: " <<
+          (chunk.error_line ? chunk.error_line : "(unknown line)");
+      return false;
+    }
+    for (size_t function_index = 0;
+         function_index < chunk.functions.size();
+         ++function_index) {
+      // As in the serial parser, silently ignore StoreRange failures for
+      // functions with an invalid address or size.
+      Function *func = chunk.functions[function_index];
+      functions_.StoreRange(func->address, func->size, func);
+    }
+    for (size_t symbol_index = 0;
+         symbol_index < chunk.public_symbols.size();
+         ++symbol_index) {
+      PublicSymbol *symbol = chunk.public_symbols[symbol_index];
+      public_symbols_.Store(symbol->address, symbol);
+    }
+    for (size_t line_index = 0;
+         line_index < chunk.deferred_lines.size();
+         ++line_index) {
+      char *deferred_line = chunk.deferred_lines[line_index];
+      if (strncmp(deferred_line, "FILE ", 5) == 0) {
+        if (!ParseFile(deferred_line)) {
+          BPLOG(ERROR) << "ParseFile failed for " << deferred_line;
+          return false;
+        }
+      } else {
+        if (!ParseStackInfo(deferred_line)) {
+          BPLOG(ERROR) << "ParseStackInfo failed for " << deferred_line;
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+#endif  // _WIN32
+
 BasicSourceLineResolver::BasicSourceLineResolver() :
     SourceLineResolverBase(new BasicModuleFactory) { }
 
 bool BasicSourceLineResolver::Module::LoadMapFromMemory(char *memory_buffer) {
-  linked_ptr<Function> cur_func;
+  Function *cur_func = NULL;
   int line_number = 0;
   char *save_ptr;
   size_t map_buffer_length = strlen(memory_buffer);
@@ -77,10 +338,25 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(char *memory_buffer) {
     return true;
   }
 
+#ifndef _WIN32
+  int thread_count = SymbolParseThreadCount(map_buffer_length);
+  if (thread_count > 1) {
+    if (!LoadMapFromMemoryParallel(memory_buffer, map_buffer_length,
+                                   thread_count)) {
+      return false;
+    }
+    FreezeLookupStructures();
+    return true;
+  }
+#endif  // _WIN32
+
   if (memory_buffer[map_buffer_length - 1] == '\n') {
     memory_buffer[map_buffer_length - 1] = '\0';
   }
 
+  RecordStore *store = new RecordStore;
+  record_stores_.push_back(store);
+
   char *buffer;
   buffer = strtok_r(memory_buffer, "\r\n", &save_ptr);
 
@@ -88,7 +364,7 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(char *memory_buffer) {
     ++line_number;
 
     if (strncmp(buffer, "FILE ", 5) == 0) {
-      if (!ParseFile(buffer)) {
+      if (load_source_lines_ && !ParseFile(buffer)) {
         BPLOG(ERROR) << "ParseFile on buffer failed at " <<
             ":" << line_number;
         return false;
@@ -100,21 +376,21 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(char *memory_buffer) {
         return false;
       }
     } else if (strncmp(buffer, "FUNC ", 5) == 0) {
-      cur_func.reset(ParseFunction(buffer));
-      if (!cur_func.get()) {
+      cur_func = ParseFunction(buffer, store);
+      if (!cur_func) {
         BPLOG(ERROR) << "ParseFunction failed at " <<
             ":" << line_number;
         return false;
       }
       // StoreRange will fail if the function has an invalid address or size.
-      // We'll silently ignore this, the function and any corresponding lines
-      // will be destroyed when cur_func is released.
+      // We'll silently ignore this; the function and any corresponding lines
+      // stay in the record store until the module is destroyed.
       functions_.StoreRange(cur_func->address, cur_func->size, cur_func);
     } else if (strncmp(buffer, "PUBLIC ", 7) == 0) {
       // Clear cur_func: public symbols don't contain line number information.
-      cur_func.reset();
+      cur_func = NULL;
 
-      if (!ParsePublicSymbol(buffer)) {
+      if (!ParsePublicSymbol(buffer, store)) {
         BPLOG(ERROR) << "ParsePublicSymbol failed at " <<
             ":" << line_number;
         return false;
@@ -130,26 +406,52 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(char *memory_buffer) {
       // Ignore these as well, they're similarly just for housekeeping.
       //
       // INFO CODE_ID <code id> <filename>
-    } else {
-      if (!cur_func.get()) {
+    } else if (load_source_lines_) {
+      if (!cur_func) {
         BPLOG(ERROR) << "Found source line data without a function at " <<
             ":" << line_number;
         return false;
       }
-      Line *line = ParseLine(buffer);
+      Line *line = ParseLine(buffer, store);
       if (!line) {
         BPLOG(ERROR) << "ParseLine failed at " << line_number << " for " <<
             buffer;
         return false;
       }
-      cur_func->lines.StoreRange(line->address, line->size,
-                                 linked_ptr<Line>(line));
+      cur_func->lines.StoreRange(line->address, line->size, line);
     }
     buffer = strtok_r(NULL, "\r\n", &save_ptr);
   }
+
+  FreezeLookupStructures();
   return true;
 }
 
+void BasicSourceLineResolver::Module::FreezeLookupStructures() {
+  // The module's lookup structures are complete; flatten them so that the
+  // per-frame lookups run on contiguous memory.
+  functions_.Freeze();
+  public_symbols_.Freeze();
+  cfi_initial_rules_.Freeze();
+
+  for (int type_index = 0;
+       type_index < WindowsFrameInfo::STACK_INFO_LAST;
+       ++type_index) {
+    windows_frame_info_[type_index].Freeze();
+  }
+
+  int function_count = functions_.GetCount();
+  for (int function_index = 0;
+       function_index < function_count;
+       ++function_index) {
+    Function *function = NULL;
+    if (functions_.RetrieveRangeAtIndex(function_index, &function,
+                                        NULL, NULL)) {
+      function->lines.Freeze();
+    }
+  }
+}
+
 void BasicSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
   MemAddr address = frame->instruction - frame->module->base_address();
 
@@ -159,39 +461,39 @@ void BasicSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
   // extent of the PUBLIC symbol we find, below. This does mean we
   // need to check that address indeed falls within the function we
   // find; do the range comparison in an overflow-friendly way.
-  linked_ptr<Function> func;
-  linked_ptr<PublicSymbol> public_symbol;
+  Function *func = NULL;
+  PublicSymbol *public_symbol = NULL;
   MemAddr function_base;
   MemAddr function_size;
   MemAddr public_address;
   if (functions_.RetrieveNearestRange(address, &func,
                                       &function_base, &function_size) &&
       address >= function_base && address - function_base < function_size) {
-    frame->function_name = func->name;
+    frame->SetFunctionName(func->name);
     frame->function_base = frame->module->base_address() + function_base;
 
-    linked_ptr<Line> line;
+    Line *line = NULL;
     MemAddr line_base;
     if (func->lines.RetrieveRange(address, &line, &line_base, NULL)) {
       FileMap::const_iterator it = files_.find(line->source_file_id);
       if (it != files_.end()) {
-        frame->source_file_name = files_.find(line->source_file_id)->second;
+        frame->SetSourceFileName(files_.find(line->source_file_id)->second);
       }
       frame->source_line = line->line;
       frame->source_line_base = frame->module->base_address() + line_base;
     }
   } else if (public_symbols_.Retrieve(address,
                                       &public_symbol, &public_address) &&
-             (!func.get() || public_address > function_base)) {
-    frame->function_name = public_symbol->name;
+             (!func || public_address > function_base)) {
+    frame->SetFunctionName(public_symbol->name);
     frame->function_base = frame->module->base_address() + public_address;
   }
 }
 
-WindowsFrameInfo *BasicSourceLineResolver::Module::FindWindowsFrameInfo(
-    const StackFrame *frame) const {
+bool BasicSourceLineResolver::Module::FindWindowsFrameInfo(
+    const StackFrame *frame, WindowsFrameInfo *result) const {
   MemAddr address = frame->instruction - frame->module->base_address();
-  scoped_ptr<WindowsFrameInfo> result(new WindowsFrameInfo());
+  result->Clear();
 
   // We only know about WindowsFrameInfo::STACK_INFO_FRAME_DATA and
   // WindowsFrameInfo::STACK_INFO_FPO. Prefer them in this order.
@@ -204,8 +506,24 @@ WindowsFrameInfo *BasicSourceLineResolver::Module::FindWindowsFrameInfo(
        .RetrieveRange(address, &frame_info))
       || (windows_frame_info_[WindowsFrameInfo::STACK_INFO_FPO]
           .RetrieveRange(address, &frame_info))) {
+    // Compile the program string once, here on the module's own entry,
+    // so every retrieval of this record reuses the compiled form.  This
+    // runs under the caller's exclusive resolver lock, so the lazy fill
+    // is safe.
+    if (frame_info->program_cache.get() &&
+        !frame_info->program_cache->program) {
+      frame_info->program_cache->program =
+          PostfixProgram::Compile(frame_info->program_string);
+    }
     result->CopyFrom(*frame_info.get());
-    return result.release();
+    // The result outlives the resolver lock, and linked_ptr sharing is
+    // not thread-safe, so detach it from the cache and hand the caller
+    // a plain pointer to the module-owned compiled program instead.
+    if (frame_info->program_cache.get()) {
+      result->program = frame_info->program_cache->program;
+    }
+    result->program_cache = linked_ptr<PostfixProgramCache>();
+    return true;
   }
 
   // Even without a relevant STACK line, many functions contain
@@ -215,30 +533,30 @@ WindowsFrameInfo *BasicSourceLineResolver::Module::FindWindowsFrameInfo(
   // below. However, this does mean we need to check that ADDRESS
   // falls within the retrieved function's range; do the range
   // comparison in an overflow-friendly way.
-  linked_ptr<Function> function;
+  Function *function = NULL;
   MemAddr function_base, function_size;
   if (functions_.RetrieveNearestRange(address, &function,
                                       &function_base, &function_size) &&
       address >= function_base && address - function_base < function_size) {
     result->parameter_size = function->parameter_size;
     result->valid |= WindowsFrameInfo::VALID_PARAMETER_SIZE;
-    return result.release();
+    return true;
   }
 
   // PUBLIC symbols might have a parameter size. Use the function we
   // found above to limit the range the public symbol covers.
-  linked_ptr<PublicSymbol> public_symbol;
+  PublicSymbol *public_symbol = NULL;
   MemAddr public_address;
   if (public_symbols_.Retrieve(address, &public_symbol, &public_address) &&
-      (!function.get() || public_address > function_base)) {
+      (!function || public_address > function_base)) {
     result->parameter_size = public_symbol->parameter_size;
   }
 
-  return NULL;
+  return false;
 }
 
-CFIFrameInfo *BasicSourceLineResolver::Module::FindCFIFrameInfo(
-    const StackFrame *frame) const {
+bool BasicSourceLineResolver::Module::FindCFIFrameInfo(
+    const StackFrame *frame, CFIFrameInfo *rules) const {
   MemAddr address = frame->instruction - frame->module->base_address();
   MemAddr initial_base, initial_size;
   string initial_rules;
@@ -249,14 +567,14 @@ CFIFrameInfo *BasicSourceLineResolver::Module::FindCFIFrameInfo(
   // instruction address, applying delta rules.
   if (!cfi_initial_rules_.RetrieveRange(address, &initial_rules,
                                         &initial_base, &initial_size)) {
-    return NULL;
+    return false;
   }
 
-  // Create a frame info structure, and populate it with the rules from
-  // the STACK CFI INIT record.
-  scoped_ptr<CFIFrameInfo> rules(new CFIFrameInfo());
-  if (!ParseCFIRuleSet(initial_rules, rules.get()))
-    return NULL;
+  // Populate the caller's frame info structure with the rules from the
+  // STACK CFI INIT record, dropping whatever an earlier lookup left in it.
+  rules->Clear();
+  if (!ParseCFIRuleSet(initial_rules, rules))
+    return false;
 
   // Find the first delta rule that falls within the initial rule's range.
   map<MemAddr, string>::const_iterator delta =
@@ -264,19 +582,19 @@ CFIFrameInfo *BasicSourceLineResolver::Module::FindCFIFrameInfo(
 
   // Apply delta rules up to and including the frame's address.
   while (delta != cfi_delta_rules_.end() && delta->first <= address) {
-    ParseCFIRuleSet(delta->second, rules.get());
+    ParseCFIRuleSet(delta->second, rules);
     delta++;
   }
 
-  return rules.release();
+  return true;
 }
 
 bool BasicSourceLineResolver::Module::ParseFile(char *file_line) {
   // FILE <id> <filename>
   file_line += 5;  // skip prefix
 
-  vector<char*> tokens;
-  if (!Tokenize(file_line, kWhitespace, 2, &tokens)) {
+  char *tokens[2];
+  if (!TokenizeInPlace(file_line, 2, tokens)) {
     return false;
   }
 
@@ -295,12 +613,13 @@ bool BasicSourceLineResolver::Module::ParseFile(char *file_line) {
 }
 
 BasicSourceLineResolver::Function*
-BasicSourceLineResolver::Module::ParseFunction(char *function_line) {
+BasicSourceLineResolver::Module::ParseFunction(char *function_line,
+                                               RecordStore *store) {
   // FUNC <address> <size> <stack_param_size> <name>
   function_line += 5;  // skip prefix
 
-  vector<char*> tokens;
-  if (!Tokenize(function_line, kWhitespace, 4, &tokens)) {
+  char *tokens[4];
+  if (!TokenizeInPlace(function_line, 4, tokens)) {
     return NULL;
   }
 
@@ -309,14 +628,15 @@ BasicSourceLineResolver::Module::ParseFunction(char *function_line) {
   int stack_param_size = strtoull(tokens[2], NULL, 16);
   char *name           = tokens[3];
 
-  return new Function(name, address, size, stack_param_size);
+  store->functions.push_back(Function(name, address, size, stack_param_size));
+  return &store->functions.back();
 }
 
 BasicSourceLineResolver::Line* BasicSourceLineResolver::Module::ParseLine(
-    char *line_line) {
+    char *line_line, RecordStore *store) {
   // <address> <line number> <source file id>
-  vector<char*> tokens;
-  if (!Tokenize(line_line, kWhitespace, 4, &tokens)) {
+  char *tokens[4];
+  if (!TokenizeInPlace(line_line, 4, tokens)) {
     return NULL;
   }
 
@@ -328,17 +648,31 @@ BasicSourceLineResolver::Line* BasicSourceLineResolver::Module::ParseLine(
     return NULL;
   }
 
-  return new Line(address, size, source_file, line_number);
+  store->lines.push_back(Line(address, size, source_file, line_number));
+  return &store->lines.back();
+}
+
+bool BasicSourceLineResolver::Module::ParsePublicSymbol(char *public_line,
+                                                        RecordStore *store) {
+  PublicSymbol *symbol = NULL;
+  if (!ParsePublicSymbolRecord(public_line, store, &symbol)) {
+    return false;
+  }
+  if (!symbol) {
+    return true;
+  }
+  return public_symbols_.Store(symbol->address, symbol);
 }
 
-bool BasicSourceLineResolver::Module::ParsePublicSymbol(char *public_line) {
+bool BasicSourceLineResolver::Module::ParsePublicSymbolRecord(
+    char *public_line, RecordStore *store, PublicSymbol **symbol) {
   // PUBLIC <address> <stack_param_size> <name>
 
   // Skip "PUBLIC " prefix.
   public_line += 7;
 
-  vector<char*> tokens;
-  if (!Tokenize(public_line, kWhitespace, 3, &tokens)) {
+  char *tokens[3];
+  if (!TokenizeInPlace(public_line, 3, tokens)) {
     return false;
   }
 
@@ -351,14 +685,15 @@ bool BasicSourceLineResolver::Module::ParsePublicSymbol(char *public_line) {
   // RtlDescribeChunkLZNT1, and RtlReserveChunkLZNT1.  They would conflict
   // with one another if they were allowed into the public_symbols_ map,
   // but since the address is obviously invalid, gracefully accept them
-  // as input without putting them into the map.
+  // as input without producing a symbol.
   if (address == 0) {
     return true;
   }
 
-  linked_ptr<PublicSymbol> symbol(new PublicSymbol(name, address,
-                                                   stack_param_size));
-  return public_symbols_.Store(address, symbol);
+  store->public_symbols.push_back(
+      PublicSymbol(name, address, stack_param_size));
+  *symbol = &store->public_symbols.back();
+  return true;
 }
 
 bool BasicSourceLineResolver::Module::ParseStackInfo(char *stack_info_line) {
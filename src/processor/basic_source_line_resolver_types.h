@@ -37,8 +37,10 @@
 #ifndef PROCESSOR_BASIC_SOURCE_LINE_RESOLVER_TYPES_H__
 #define PROCESSOR_BASIC_SOURCE_LINE_RESOLVER_TYPES_H__
 
+#include <deque>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/basic_source_line_resolver.h"
@@ -65,7 +67,7 @@ BasicSourceLineResolver::Function : public SourceLineResolverBase::Function {
                                           code_size,
                                           set_parameter_size),
                                      lines() { }
-  RangeMap< MemAddr, linked_ptr<Line> > lines;
+  RangeMap<MemAddr, Line*> lines;
  private:
   typedef SourceLineResolverBase::Function Base;
 };
@@ -73,29 +75,42 @@ BasicSourceLineResolver::Function : public SourceLineResolverBase::Function {
 
 class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
  public:
-  explicit Module(const string &name) : name_(name) { }
-  virtual ~Module() { }
+  explicit Module(const string &name)
+      : name_(name), load_source_lines_(true) { }
+  virtual ~Module() {
+    for (size_t store_index = 0;
+         store_index < record_stores_.size();
+         ++store_index) {
+      delete record_stores_[store_index];
+    }
+  }
 
   // Loads a map from the given buffer in char* type.
   // Does NOT have ownership of memory_buffer.
   virtual bool LoadMapFromMemory(char *memory_buffer);
 
+  // When turned off, LoadMapFromMemory skips FILE and source line
+  // records and builds only the FUNC, PUBLIC, and stack-walking maps.
+  virtual void set_load_source_lines(bool load_source_lines) {
+    load_source_lines_ = load_source_lines;
+  }
+
   // Looks up the given relative address, and fills the StackFrame struct
   // with the result.
   virtual void LookupAddress(StackFrame *frame) const;
 
   // If Windows stack walking information is available covering ADDRESS,
-  // return a WindowsFrameInfo structure describing it. If the information
-  // is not available, returns NULL. A NULL return value does not indicate
-  // an error. The caller takes ownership of any returned WindowsFrameInfo
-  // object.
-  virtual WindowsFrameInfo *FindWindowsFrameInfo(const StackFrame *frame) const;
+  // fill the caller-provided *frame_info with it and return true. If
+  // the information is not available, return false; a false return
+  // does not indicate an error.
+  virtual bool FindWindowsFrameInfo(const StackFrame *frame,
+                                    WindowsFrameInfo *frame_info) const;
 
   // If CFI stack walking information is available covering ADDRESS,
-  // return a CFIFrameInfo structure describing it. If the information
-  // is not available, return NULL. The caller takes ownership of any
-  // returned CFIFrameInfo object.
-  virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) const;
+  // fill the caller-provided *frame_info with it and return true. If
+  // the information is not available, return false.
+  virtual bool FindCFIFrameInfo(const StackFrame *frame,
+                                CFIFrameInfo *frame_info) const;
 
  private:
   // Friend declarations.
@@ -105,18 +120,45 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
 
   typedef std::map<int, string> FileMap;
 
+  // Bulk storage for the parsed Function, Line, and PublicSymbol
+  // records.  The lookup maps hold plain pointers into these deques,
+  // which allocate element storage in blocks and never relocate
+  // elements, so parsing pays no per-record heap allocation or
+  // reference count and everything is released wholesale when the
+  // module is destroyed.  Serial parsing fills one store; the parallel
+  // parser gives each chunk its own, adopted during the merge.
+  struct RecordStore {
+    std::deque<Function> functions;
+    std::deque<Line> lines;
+    std::deque<PublicSymbol> public_symbols;
+  };
+
+  // Flattens the lookup structures once the map is fully loaded, so that
+  // per-frame lookups run over contiguous memory.
+  void FreezeLookupStructures();
+
   // Parses a file declaration
   bool ParseFile(char *file_line);
 
-  // Parses a function declaration, returning a new Function object.
-  Function* ParseFunction(char *function_line);
+  // Parses a function declaration, returning a new Function object
+  // allocated in store.
+  Function* ParseFunction(char *function_line, RecordStore *store);
 
-  // Parses a line declaration, returning a new Line object.
-  Line* ParseLine(char *line_line);
+  // Parses a line declaration, returning a new Line object allocated
+  // in store.
+  Line* ParseLine(char *line_line, RecordStore *store);
 
   // Parses a PUBLIC symbol declaration, storing it in public_symbols_.
   // Returns false if an error occurs.
-  bool ParsePublicSymbol(char *public_line);
+  bool ParsePublicSymbol(char *public_line, RecordStore *store);
+
+  // Parses a PUBLIC symbol declaration, returning through symbol a new
+  // object allocated in store.  Returns false if an error occurs.
+  // Symbols with an address of 0 parse successfully but yield no
+  // symbol; see the comment in the implementation.
+  bool ParsePublicSymbolRecord(char *public_line,
+                               RecordStore *store,
+                               PublicSymbol **symbol);
 
   // Parses a STACK WIN or STACK CFI frame info declaration, storing
   // it in the appropriate table.
@@ -125,10 +167,41 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
   // Parses a STACK CFI record, storing it in cfi_frame_info_.
   bool ParseCFIFrameInfo(char *stack_info_line);
 
+#ifndef _WIN32
+  // One slice of a symbol file being parsed in parallel, along with the
+  // records parsed from it.  Defined in basic_source_line_resolver.cc.
+  struct ParseChunk;
+
+  // pthread entry point; parses the ParseChunk passed as arg.
+  static void* ParseChunkWorker(void *arg);
+
+  // Parses the records in chunk into its chunk-local containers.
+  // Returns false, recording the failing line in the chunk, on a parse
+  // error.
+  bool ParseChunkRecords(ParseChunk *chunk);
+
+  // Splits memory_buffer at record boundaries into thread_count chunks,
+  // parses the chunks on that many threads, and merges the chunk-local
+  // results into this module's maps in chunk order.
+  bool LoadMapFromMemoryParallel(char *memory_buffer,
+                                 size_t map_buffer_length,
+                                 int thread_count);
+#endif  // _WIN32
+
   string name_;
+
+  // Whether FILE and source line records are parsed; see
+  // set_load_source_lines.
+  bool load_source_lines_;
+
   FileMap files_;
-  RangeMap< MemAddr, linked_ptr<Function> > functions_;
-  AddressMap< MemAddr, linked_ptr<PublicSymbol> > public_symbols_;
+  RangeMap<MemAddr, Function*> functions_;
+  AddressMap<MemAddr, PublicSymbol*> public_symbols_;
+
+  // The stores owning the objects the maps above point into; see
+  // RecordStore.  Records that fail to enter a map (for example a
+  // function whose range conflicts) simply stay here until unload.
+  std::vector<RecordStore*> record_stores_;
 
   // Each element in the array is a ContainedRangeMap for a type
   // listed in WindowsFrameInfoTypes. These are split by type because
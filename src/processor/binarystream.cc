@@ -29,6 +29,7 @@
 
 #include <arpa/inet.h>
 #include <limits.h>
+#include <string.h>
 
 #include <string>
 #include <vector>
@@ -37,7 +38,26 @@
 #include "processor/binarystream.h"
 
 namespace google_breakpad {
-using std::vector;
+
+void binarystream::read(char *out, size_t size) {
+  if (eof_)
+    return;
+  if (buffer_.size() - read_pos_ < size) {
+    eof_ = true;
+    return;
+  }
+  if (size)
+    memcpy(out, &buffer_[read_pos_], size);
+  read_pos_ += size;
+}
+
+void binarystream::write(const char *data, size_t size) {
+  if (write_pos_ + size > buffer_.size())
+    buffer_.resize(write_pos_ + size);
+  if (size)
+    memcpy(&buffer_[write_pos_], data, size);
+  write_pos_ += size;
+}
 
 binarystream &binarystream::operator>>(string &str) {
   uint16_t length;
@@ -48,21 +68,25 @@ binarystream &binarystream::operator>>(string &str) {
     str.clear();
     return *this;
   }
-  vector<char> buffer(length);
-  stream_.read(&buffer[0], length);
-  if (!eof())
-    str.assign(&buffer[0], length);
+  // Assign straight out of the buffer rather than staging the bytes
+  // through a scratch vector.
+  if (buffer_.size() - read_pos_ < length) {
+    eof_ = true;
+    return *this;
+  }
+  str.assign(&buffer_[read_pos_], length);
+  read_pos_ += length;
   return *this;
 }
 
 binarystream &binarystream::operator>>(uint8_t &u8) {
-  stream_.read((char *)&u8, 1);
+  read((char *)&u8, 1);
   return *this;
 }
 
 binarystream &binarystream::operator>>(uint16_t &u16) {
   uint16_t temp;
-  stream_.read((char *)&temp, 2);
+  read((char *)&temp, 2);
   if (!eof())
     u16 = ntohs(temp);
   return *this;
@@ -70,7 +94,7 @@ binarystream &binarystream::operator>>(uint16_t &u16) {
 
 binarystream &binarystream::operator>>(uint32_t &u32) {
   uint32_t temp;
-  stream_.read((char *)&temp, 4);
+  read((char *)&temp, 4);
   if (!eof())
     u32 = ntohl(temp);
   return *this;
@@ -88,28 +112,28 @@ binarystream &binarystream::operator<<(const string &str) {
   if (str.length() > USHRT_MAX) {
     // truncate to 16-bit length
     *this << static_cast<uint16_t>(USHRT_MAX);
-    stream_.write(str.c_str(), USHRT_MAX);
+    write(str.c_str(), USHRT_MAX);
   } else {
     *this << (uint16_t)(str.length() & 0xFFFF);
-    stream_.write(str.c_str(), str.length());
+    write(str.c_str(), str.length());
   }
   return *this;
 }
 
 binarystream &binarystream::operator<<(uint8_t u8) {
-  stream_.write((const char*)&u8, 1);
+  write((const char*)&u8, 1);
   return *this;
 }
 
 binarystream &binarystream::operator<<(uint16_t u16) {
   u16 = htons(u16);
-  stream_.write((const char*)&u16, 2);
+  write((const char*)&u16, 2);
   return *this;
 }
 
 binarystream &binarystream::operator<<(uint32_t u32) {
   u32 = htonl(u32);
-  stream_.write((const char*)&u32, 4);
+  write((const char*)&u32, 4);
   return *this;
 }
 
@@ -27,15 +27,20 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-// binarystream implements part of the std::iostream interface as a
-// wrapper around std::stringstream to allow reading and writing strings
-// and integers of known size.
+// binarystream implements part of the std::iostream interface over a
+// growable contiguous byte buffer to allow reading and writing strings
+// and integers of known size.  Marshalling through std::stringstream
+// copied every field twice -- once into the stream's buffer and again
+// out through str() -- which showed up when serialized streams are
+// shipped between services; the vector backing reads and writes fields
+// in place and can hand the finished buffer over without a copy.
 
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_BINARYSTREAM_H_
 #define GOOGLE_BREAKPAD_PROCESSOR_BINARYSTREAM_H_
 
-#include <sstream>
+#include <ios>
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
@@ -46,14 +51,18 @@ using std::ios;
 
 class binarystream {
  public:
+  // The openmode arguments are accepted for compatibility with the
+  // previous stringstream-backed implementation; the buffer is always
+  // readable and writable.
   explicit binarystream(ios_base::openmode which = ios_base::out|ios_base::in)
-    : stream_(which) {}
+    : read_pos_(0), write_pos_(0), eof_(false) {}
   explicit binarystream(const string &str,
                         ios_base::openmode which = ios_base::out|ios_base::in)
-    : stream_(str, which) {}
+    : buffer_(str.begin(), str.end()),
+      read_pos_(0), write_pos_(0), eof_(false) {}
   explicit binarystream(const char *str, size_t size,
                         ios_base::openmode which = ios_base::out|ios_base::in)
-    : stream_(string(str, size), which) {}
+    : buffer_(str, str + size), read_pos_(0), write_pos_(0), eof_(false) {}
 
   binarystream &operator>>(string &str);
   binarystream &operator>>(uint8_t &u8);
@@ -68,23 +77,56 @@ class binarystream {
   binarystream &operator<<(uint32_t u32);
   binarystream &operator<<(uint64_t u64);
 
-  // Forward a few methods directly from the stream object
-  bool eof() const { return stream_.eof(); }
-  void clear() { stream_.clear(); }
-  string str() const { return stream_.str(); }
-  void str(const string &s) { stream_.str(s); }
-    
+  // Copy size bytes from the stream into out, advancing the read
+  // position.  If fewer than size bytes remain, nothing is copied and
+  // the stream enters the eof state, as it does after a short
+  // stringstream read; once in that state reads do nothing until
+  // clear() or rewind() is called.
+  void read(char *out, size_t size);
+
+  // Append (or, after rewind, overwrite) size bytes at the write
+  // position.  The buffer grows as needed.
+  void write(const char *data, size_t size);
+
+  // Pre-size the backing buffer for a message whose length is known,
+  // so that writing it does not regrow the buffer.
+  void reserve(size_t size) { buffer_.reserve(size); }
+
+  // Swap the accumulated bytes into out without copying them and
+  // return the stream to its freshly-constructed state.  This is the
+  // cheap way to take the finished buffer off a stream that is done
+  // being written.
+  void release(std::vector<char> *out) {
+    out->clear();
+    out->swap(buffer_);
+    read_pos_ = 0;
+    write_pos_ = 0;
+    eof_ = false;
+  }
+
+  bool eof() const { return eof_; }
+  void clear() { eof_ = false; }
+  string str() const { return string(buffer_.begin(), buffer_.end()); }
+  void str(const string &s) {
+    buffer_.assign(s.begin(), s.end());
+    read_pos_ = 0;
+    write_pos_ = 0;
+  }
+
   // Seek both read and write pointers to the beginning of the stream.
   void rewind() {
-    stream_.seekg (0, ios::beg);
-    stream_.seekp (0, ios::beg);
-    // This is to clear all the error flags, since only the EOF flag is cleared
-    // with seekg().
-    stream_.clear();
+    read_pos_ = 0;
+    write_pos_ = 0;
+    // This also clears the error state, as the stringstream-backed
+    // implementation did.
+    eof_ = false;
   }
 
  private:
-  std::stringstream stream_;
+  std::vector<char> buffer_;
+  size_t read_pos_;
+  size_t write_pos_;
+  bool eof_;
 };
 
 }  // namespace google_breakpad
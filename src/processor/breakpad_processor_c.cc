@@ -0,0 +1,516 @@
+// Copyright (c) 2010 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// breakpad_processor_c.cc: Implementation of the C embedding API declared
+// in google_breakpad/processor/breakpad_processor_c.h.
+//
+// The wrapper types own the C++ objects they stand for.  Accessors that
+// return strings are backed either by the interned names the frames
+// already hold, or by copies cached on the bp_state when the underlying
+// C++ accessor returns by value (CodeModule's accessors, ProcessState's
+// crash fields), so every returned pointer stays valid for the state's
+// lifetime as the header promises.
+
+#include "google_breakpad/processor/breakpad_processor_c.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/call_stack.h"
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/code_modules.h"
+#include "google_breakpad/processor/minidump.h"
+#include "google_breakpad/processor/minidump_batch_processor.h"
+#include "google_breakpad/processor/minidump_processor.h"
+#include "google_breakpad/processor/process_state.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "processor/simple_symbol_supplier.h"
+
+namespace {
+
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::CallStack;
+using google_breakpad::CodeModule;
+using google_breakpad::CodeModules;
+using google_breakpad::Minidump;
+using google_breakpad::MinidumpBatchProcessor;
+using google_breakpad::MinidumpProcessor;
+using google_breakpad::ProcessResult;
+using google_breakpad::ProcessState;
+using google_breakpad::SimpleSymbolSupplier;
+using google_breakpad::StackFrame;
+using google_breakpad::StackFrameSymbolizer;
+
+// The C result enum mirrors ProcessResult value for value, so conversion
+// is a cast; this helper documents the one place it happens.
+bp_process_result ConvertResult(ProcessResult result) {
+  return static_cast<bp_process_result>(result);
+}
+
+}  // namespace
+
+// The long-lived context: supplier, resolver, symbolizer, processor.
+// All dumps processed through one bp_processor share the symbolizer's
+// caches.
+struct bp_processor {
+  explicit bp_processor(const char* symbol_path)
+      : supplier(symbol_path ? new SimpleSymbolSupplier(symbol_path) : NULL),
+        resolver(),
+        symbolizer(supplier, &resolver),
+        processor(&symbolizer, false) {}
+
+  ~bp_processor() {
+    delete supplier;
+  }
+
+  SimpleSymbolSupplier* supplier;
+  BasicSourceLineResolver resolver;
+  StackFrameSymbolizer symbolizer;
+  MinidumpProcessor processor;
+};
+
+// The C view of one processed dump.  Owns the ProcessState unless it was
+// produced by a batch (which keeps ownership of its states), and caches
+// the by-value strings and per-module records the accessors hand out.
+struct bp_state {
+  bp_state() : process_state(NULL), owned(false) {}
+
+  ~bp_state() {
+    if (owned)
+      delete process_state;
+  }
+
+  // Copies the by-value fields out of process_state so accessors can
+  // return stable const char* pointers.
+  void CacheStrings() {
+    crash_reason = process_state->crash_reason();
+    assertion = process_state->assertion();
+    os = process_state->system_info()->os;
+    os_version = process_state->system_info()->os_version;
+    cpu = process_state->system_info()->cpu;
+    cpu_info = process_state->system_info()->cpu_info;
+
+    const CodeModules* modules = process_state->modules();
+    if (modules) {
+      unsigned int count = modules->module_count();
+      for (unsigned int i = 0; i < count; ++i) {
+        const CodeModule* module = modules->GetModuleAtIndex(i);
+        ModuleInfo info;
+        info.code_file = module->code_file();
+        info.debug_file = module->debug_file();
+        info.debug_identifier = module->debug_identifier();
+        info.base_address = module->base_address();
+        info.size = module->size();
+        info.missing_symbols = false;
+        module_index_by_base[info.base_address] = module_info.size();
+        module_info.push_back(info);
+      }
+    }
+    const std::vector<const CodeModule*>* missing =
+        process_state->modules_without_symbols();
+    for (size_t i = 0; i < missing->size(); ++i) {
+      std::map<unsigned long long, size_t>::const_iterator entry =
+          module_index_by_base.find((*missing)[i]->base_address());
+      if (entry != module_index_by_base.end())
+        module_info[entry->second].missing_symbols = true;
+    }
+  }
+
+  // Returns the frame at [thread_index][frame_index], or NULL if either
+  // index is out of range.
+  const StackFrame* GetFrame(unsigned int thread_index,
+                             unsigned int frame_index) const {
+    const std::vector<CallStack*>* threads = process_state->threads();
+    if (thread_index >= threads->size())
+      return NULL;
+    const std::vector<StackFrame*>* frames =
+        (*threads)[thread_index]->frames();
+    if (frame_index >= frames->size())
+      return NULL;
+    return (*frames)[frame_index];
+  }
+
+  struct ModuleInfo {
+    string code_file;
+    string debug_file;
+    string debug_identifier;
+    unsigned long long base_address;
+    unsigned long long size;
+    bool missing_symbols;
+  };
+
+  ProcessState* process_state;
+  bool owned;
+
+  string crash_reason;
+  string assertion;
+  string os;
+  string os_version;
+  string cpu;
+  string cpu_info;
+
+  std::vector<ModuleInfo> module_info;
+
+  // Frames name their module by pointer; the accessors report an index.
+  // Bases are unique within one dump's module list, so they key the
+  // translation.
+  std::map<unsigned long long, size_t> module_index_by_base;
+};
+
+// A batch session: the underlying MinidumpBatchProcessor plus the lazily
+// built bp_state wrappers for the dumps it processed.
+struct bp_batch {
+  explicit bp_batch(bp_processor* set_processor)
+      : processor(set_processor),
+        batch(&set_processor->symbolizer, false) {}
+
+  ~bp_batch() {
+    for (size_t i = 0; i < states.size(); ++i)
+      delete states[i];
+  }
+
+  bp_processor* processor;
+  MinidumpBatchProcessor batch;
+
+  // states[i] wraps the batch's ProcessState for dump i; NULL until
+  // bp_batch_state builds it.  The wrappers never own the states.
+  std::vector<bp_state*> states;
+};
+
+extern "C" {
+
+bp_processor* bp_processor_create(const char* symbol_path) {
+  return new bp_processor(symbol_path);
+}
+
+void bp_processor_destroy(bp_processor* processor) {
+  delete processor;
+}
+
+void bp_processor_set_max_worker_threads(bp_processor* processor,
+                                         unsigned int max_worker_threads) {
+  if (processor)
+    processor->processor.set_max_worker_threads(max_worker_threads);
+}
+
+void bp_processor_set_time_budget_ms(bp_processor* processor,
+                                     unsigned int budget_ms) {
+  if (processor)
+    processor->processor.set_processing_time_budget_ms(budget_ms);
+}
+
+bp_process_result bp_processor_process_file(bp_processor* processor,
+                                            const char* minidump_file,
+                                            bp_state** state) {
+  if (!processor || !minidump_file || !state)
+    return BP_PROCESS_ERROR_INVALID_ARGUMENT;
+  *state = NULL;
+
+  bp_state* new_state = new bp_state();
+  new_state->process_state = new ProcessState();
+  new_state->owned = true;
+  ProcessResult result =
+      processor->processor.Process(minidump_file, new_state->process_state);
+  if (result != google_breakpad::PROCESS_OK) {
+    delete new_state;
+    return ConvertResult(result);
+  }
+  new_state->CacheStrings();
+  *state = new_state;
+  return BP_PROCESS_OK;
+}
+
+bp_process_result bp_processor_process_buffer(bp_processor* processor,
+                                              const void* data,
+                                              size_t size,
+                                              bp_state** state) {
+  if (!processor || !data || !state)
+    return BP_PROCESS_ERROR_INVALID_ARGUMENT;
+  *state = NULL;
+
+  Minidump dump(data, size);
+  bp_state* new_state = new bp_state();
+  new_state->process_state = new ProcessState();
+  new_state->owned = true;
+  ProcessResult result =
+      processor->processor.Process(&dump, new_state->process_state);
+  if (result != google_breakpad::PROCESS_OK) {
+    delete new_state;
+    return ConvertResult(result);
+  }
+  new_state->CacheStrings();
+  *state = new_state;
+  return BP_PROCESS_OK;
+}
+
+void bp_state_destroy(bp_state* state) {
+  delete state;
+}
+
+int bp_state_crashed(const bp_state* state) {
+  return state && state->process_state->crashed() ? 1 : 0;
+}
+
+const char* bp_state_crash_reason(const bp_state* state) {
+  return state ? state->crash_reason.c_str() : NULL;
+}
+
+unsigned long long bp_state_crash_address(const bp_state* state) {
+  return state ? state->process_state->crash_address() : 0;
+}
+
+const char* bp_state_assertion(const bp_state* state) {
+  return state ? state->assertion.c_str() : NULL;
+}
+
+int bp_state_requesting_thread(const bp_state* state) {
+  return state ? state->process_state->requesting_thread() : -1;
+}
+
+const char* bp_state_os(const bp_state* state) {
+  return state ? state->os.c_str() : NULL;
+}
+
+const char* bp_state_os_version(const bp_state* state) {
+  return state ? state->os_version.c_str() : NULL;
+}
+
+const char* bp_state_cpu(const bp_state* state) {
+  return state ? state->cpu.c_str() : NULL;
+}
+
+const char* bp_state_cpu_info(const bp_state* state) {
+  return state ? state->cpu_info.c_str() : NULL;
+}
+
+unsigned int bp_state_cpu_count(const bp_state* state) {
+  return state ? state->process_state->system_info()->cpu_count : 0;
+}
+
+unsigned int bp_state_thread_count(const bp_state* state) {
+  if (!state)
+    return 0;
+  return static_cast<unsigned int>(state->process_state->threads()->size());
+}
+
+unsigned int bp_state_frame_count(const bp_state* state,
+                                  unsigned int thread_index) {
+  if (!state)
+    return 0;
+  const std::vector<CallStack*>* threads = state->process_state->threads();
+  if (thread_index >= threads->size())
+    return 0;
+  return static_cast<unsigned int>((*threads)[thread_index]->frames()->size());
+}
+
+int bp_state_thread_truncated(const bp_state* state,
+                              unsigned int thread_index) {
+  if (!state)
+    return 0;
+  const std::vector<unsigned int>* truncated =
+      state->process_state->truncated_threads();
+  for (size_t i = 0; i < truncated->size(); ++i) {
+    if ((*truncated)[i] == thread_index)
+      return 1;
+  }
+  return 0;
+}
+
+unsigned long long bp_frame_instruction(const bp_state* state,
+                                        unsigned int thread_index,
+                                        unsigned int frame_index) {
+  const StackFrame* frame =
+      state ? state->GetFrame(thread_index, frame_index) : NULL;
+  return frame ? frame->instruction : 0;
+}
+
+const char* bp_frame_function_name(const bp_state* state,
+                                   unsigned int thread_index,
+                                   unsigned int frame_index) {
+  const StackFrame* frame =
+      state ? state->GetFrame(thread_index, frame_index) : NULL;
+  if (!frame || !frame->function_name)
+    return NULL;
+  return frame->function_name->c_str();
+}
+
+unsigned long long bp_frame_function_base(const bp_state* state,
+                                          unsigned int thread_index,
+                                          unsigned int frame_index) {
+  const StackFrame* frame =
+      state ? state->GetFrame(thread_index, frame_index) : NULL;
+  return frame ? frame->function_base : 0;
+}
+
+const char* bp_frame_source_file(const bp_state* state,
+                                 unsigned int thread_index,
+                                 unsigned int frame_index) {
+  const StackFrame* frame =
+      state ? state->GetFrame(thread_index, frame_index) : NULL;
+  if (!frame || !frame->source_file_name)
+    return NULL;
+  return frame->source_file_name->c_str();
+}
+
+int bp_frame_source_line(const bp_state* state,
+                         unsigned int thread_index,
+                         unsigned int frame_index) {
+  const StackFrame* frame =
+      state ? state->GetFrame(thread_index, frame_index) : NULL;
+  return frame ? frame->source_line : 0;
+}
+
+bp_frame_trust bp_frame_get_trust(const bp_state* state,
+                                  unsigned int thread_index,
+                                  unsigned int frame_index) {
+  const StackFrame* frame =
+      state ? state->GetFrame(thread_index, frame_index) : NULL;
+  if (!frame)
+    return BP_FRAME_TRUST_NONE;
+  return static_cast<bp_frame_trust>(frame->trust);
+}
+
+int bp_frame_module(const bp_state* state,
+                    unsigned int thread_index,
+                    unsigned int frame_index) {
+  const StackFrame* frame =
+      state ? state->GetFrame(thread_index, frame_index) : NULL;
+  if (!frame || !frame->module)
+    return -1;
+  std::map<unsigned long long, size_t>::const_iterator entry =
+      state->module_index_by_base.find(frame->module->base_address());
+  if (entry == state->module_index_by_base.end())
+    return -1;
+  return static_cast<int>(entry->second);
+}
+
+unsigned int bp_state_module_count(const bp_state* state) {
+  return state ? static_cast<unsigned int>(state->module_info.size()) : 0;
+}
+
+const char* bp_module_code_file(const bp_state* state,
+                                unsigned int module_index) {
+  if (!state || module_index >= state->module_info.size())
+    return NULL;
+  return state->module_info[module_index].code_file.c_str();
+}
+
+const char* bp_module_debug_file(const bp_state* state,
+                                 unsigned int module_index) {
+  if (!state || module_index >= state->module_info.size())
+    return NULL;
+  return state->module_info[module_index].debug_file.c_str();
+}
+
+const char* bp_module_debug_identifier(const bp_state* state,
+                                       unsigned int module_index) {
+  if (!state || module_index >= state->module_info.size())
+    return NULL;
+  return state->module_info[module_index].debug_identifier.c_str();
+}
+
+unsigned long long bp_module_base_address(const bp_state* state,
+                                          unsigned int module_index) {
+  if (!state || module_index >= state->module_info.size())
+    return 0;
+  return state->module_info[module_index].base_address;
+}
+
+unsigned long long bp_module_size(const bp_state* state,
+                                  unsigned int module_index) {
+  if (!state || module_index >= state->module_info.size())
+    return 0;
+  return state->module_info[module_index].size;
+}
+
+int bp_module_missing_symbols(const bp_state* state,
+                              unsigned int module_index) {
+  if (!state || module_index >= state->module_info.size())
+    return 0;
+  return state->module_info[module_index].missing_symbols ? 1 : 0;
+}
+
+bp_batch* bp_batch_create(bp_processor* processor) {
+  if (!processor)
+    return NULL;
+  return new bp_batch(processor);
+}
+
+void bp_batch_destroy(bp_batch* batch) {
+  delete batch;
+}
+
+void bp_batch_set_max_worker_threads(bp_batch* batch,
+                                     unsigned int max_worker_threads) {
+  if (batch)
+    batch->batch.set_max_worker_threads(max_worker_threads);
+}
+
+size_t bp_batch_add_file(bp_batch* batch, const char* minidump_file) {
+  if (!batch || !minidump_file)
+    return 0;
+  size_t index = batch->batch.AddMinidumpFile(minidump_file);
+  batch->states.resize(batch->batch.entry_count(), NULL);
+  return index;
+}
+
+size_t bp_batch_dump_count(const bp_batch* batch) {
+  return batch ? batch->batch.entry_count() : 0;
+}
+
+size_t bp_batch_process_all(bp_batch* batch) {
+  return batch ? batch->batch.ProcessAll() : 0;
+}
+
+bp_process_result bp_batch_result(const bp_batch* batch, size_t index) {
+  if (!batch || index >= batch->batch.entry_count())
+    return BP_PROCESS_ERROR_INVALID_ARGUMENT;
+  return ConvertResult(batch->batch.result(index));
+}
+
+bp_state* bp_batch_state(bp_batch* batch, size_t index) {
+  if (!batch || index >= batch->batch.entry_count())
+    return NULL;
+  if (batch->batch.result(index) != google_breakpad::PROCESS_OK)
+    return NULL;
+  if (!batch->states[index]) {
+    bp_state* state = new bp_state();
+    state->process_state = batch->batch.process_state(index);
+    state->owned = false;
+    state->CacheStrings();
+    batch->states[index] = state;
+  }
+  return batch->states[index];
+}
+
+}  // extern "C"
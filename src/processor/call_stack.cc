@@ -35,19 +35,34 @@
 
 #include "google_breakpad/processor/call_stack.h"
 #include "google_breakpad/processor/stack_frame.h"
+#include "processor/stack_frame_arena.h"
 
 namespace google_breakpad {
 
 CallStack::~CallStack() {
   Clear();
+  delete arena_;
 }
 
 void CallStack::Clear() {
+  // Frames are constructed in arena_, so run their destructors in place
+  // and then release the arena's storage all at once.
   for (vector<StackFrame *>::const_iterator iterator = frames_.begin();
        iterator != frames_.end();
        ++iterator) {
-    delete *iterator;
+    (*iterator)->~StackFrame();
   }
+  frames_.clear();
+  if (arena_) {
+    arena_->FreeAll();
+  }
+}
+
+StackFrameArena* CallStack::arena() {
+  if (!arena_) {
+    arena_ = new StackFrameArena();
+  }
+  return arena_;
 }
 
 }  // namespace google_breakpad
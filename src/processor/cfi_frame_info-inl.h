@@ -38,8 +38,37 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <utility>
+
 namespace google_breakpad {
 
+template <typename RegisterType, class RawContextType>
+void SimpleCFIWalker<RegisterType, RawContextType>::BuildBindingTables() {
+  names_.resize(map_size_);
+  sorted_order_.resize(map_size_);
+
+  std::vector<std::pair<string, size_t> > order(map_size_);
+  for (size_t i = 0; i < map_size_; i++) {
+    const RegisterSet &r = register_map_[i];
+    names_[i] = r.name;
+    order[i] = std::make_pair(names_[i], i);
+
+    Binding binding;
+    binding.index = i;
+    binding.primary = true;
+    bindings_[names_[i]] = binding;
+    if (r.alternate_name) {
+      binding.primary = false;
+      bindings_[r.alternate_name] = binding;
+    }
+  }
+
+  std::sort(order.begin(), order.end());
+  for (size_t i = 0; i < map_size_; i++)
+    sorted_order_[i] = order[i].second;
+}
+
 template <typename RegisterType, class RawContextType>
 bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
     const MemoryRegion &memory,
@@ -51,14 +80,19 @@ bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
   typedef CFIFrameInfo::RegisterValueMap<RegisterType> ValueMap;
   ValueMap callee_registers;
   ValueMap caller_registers;
-  // Just for brevity.
-  typename ValueMap::const_iterator caller_none = caller_registers.end();
 
   // Populate callee_registers with register values from callee_context.
+  // Visiting the registers in name order makes every insertion an
+  // append at the dictionary's end, using the keys precomputed by
+  // BuildBindingTables.
   for (size_t i = 0; i < map_size_; i++) {
-    const RegisterSet &r = register_map_[i];
-    if (callee_validity & r.validity_flag)
-      callee_registers[r.name] = callee_context.*r.context_member;
+    size_t index = sorted_order_[i];
+    const RegisterSet &r = register_map_[index];
+    if (callee_validity & r.validity_flag) {
+      callee_registers.insert(
+          callee_registers.end(),
+          std::make_pair(names_[index], callee_context.*r.context_member));
+    }
   }
 
   // Apply the rules, and see what register values they yield.
@@ -67,31 +101,38 @@ bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
     return false;
 
   // Populate *caller_context with the values the rules placed in
-  // caller_registers.
+  // caller_registers.  The rules typically produce only a handful of
+  // values (.cfa, .ra, and a rule or two), so walk those and bind each
+  // to its register through the precomputed table, rather than probing
+  // the dictionary once or twice for every architecture register.
   memset(caller_context, 0xda, sizeof(*caller_context));
   *caller_validity = 0;
-  for (size_t i = 0; i < map_size_; i++) {
-    const RegisterSet &r = register_map_[i];
-    typename ValueMap::const_iterator caller_entry;
-
-    // Did the rules provide a value for this register by its name?
-    caller_entry = caller_registers.find(r.name);
-    if (caller_entry != caller_none) {
+  int primary_validity = 0;
+  for (typename ValueMap::const_iterator caller_entry =
+           caller_registers.begin();
+       caller_entry != caller_registers.end();
+       ++caller_entry) {
+    typename BindingMap::const_iterator binding =
+        bindings_.find(caller_entry->first);
+    if (binding == bindings_.end())
+      continue;
+    const RegisterSet &r = register_map_[binding->second.index];
+    if (binding->second.primary) {
+      caller_context->*r.context_member = caller_entry->second;
+      *caller_validity |= r.validity_flag;
+      primary_validity |= r.validity_flag;
+    } else if ((primary_validity & r.validity_flag) == 0) {
+      // A value under the alternate name only counts when the rules
+      // provided none under the primary name.
       caller_context->*r.context_member = caller_entry->second;
       *caller_validity |= r.validity_flag;
-      continue;
     }
+  }
 
-    // Did the rules provide a value for this register under its
-    // alternate name?
-    if (r.alternate_name) {
-      caller_entry = caller_registers.find(r.alternate_name);
-      if (caller_entry != caller_none) {
-        caller_context->*r.context_member = caller_entry->second;
-        *caller_validity |= r.validity_flag;
-        continue;
-      }
-    }
+  for (size_t i = 0; i < map_size_; i++) {
+    const RegisterSet &r = register_map_[i];
+    if (*caller_validity & r.validity_flag)
+      continue;
 
     // Is this a callee-saves register? The walker assumes that these
     // still hold the caller's value if the CFI doesn't mention them.
@@ -105,7 +146,6 @@ bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
     if (r.callee_saves && (callee_validity & r.validity_flag) != 0) {
       caller_context->*r.context_member = callee_context.*r.context_member;
       *caller_validity |= r.validity_flag;
-      continue;
     }
 
     // Otherwise, the register's value is unknown.
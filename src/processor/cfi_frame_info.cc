@@ -47,40 +47,128 @@ namespace google_breakpad {
 #define strtok_r strtok_s
 #endif
 
+// static
+CompiledCFIRule* CompiledCFIRule::Compile(const string &expression) {
+  CompiledCFIRule *rule = new CompiledCFIRule();
+  rule->expression = expression;
+  rule->program = PostfixProgram::Compile(expression);
+
+  // Classify the common shapes: "REG", "N", "REG N +", "REG N -", and
+  // each of those followed by a dereference.  Anything else stays
+  // SHAPE_GENERAL and runs through the evaluator.
+  const std::vector<PostfixProgram::Instruction> &instructions =
+      rule->program->instructions();
+  size_t length = instructions.size();
+  bool dereference = false;
+  if (length >= 1 &&
+      instructions[length - 1].opcode == PostfixProgram::OP_DEREFERENCE) {
+    dereference = true;
+    --length;
+  }
+
+  bool recognized = false;
+  if (length == 1) {
+    if (instructions[0].opcode == PostfixProgram::OP_PUSH_IDENTIFIER) {
+      rule->base_register =
+          rule->program->identifier(instructions[0].identifier_index);
+      rule->offset = 0;
+      recognized = true;
+    } else if (instructions[0].opcode == PostfixProgram::OP_PUSH_LITERAL) {
+      // A bare literal; base_register stays empty.
+      rule->offset = static_cast<int64_t>(instructions[0].literal);
+      recognized = true;
+    }
+  } else if (length == 3 &&
+             instructions[0].opcode == PostfixProgram::OP_PUSH_IDENTIFIER &&
+             instructions[1].opcode == PostfixProgram::OP_PUSH_LITERAL &&
+             (instructions[2].opcode == PostfixProgram::OP_ADD ||
+              instructions[2].opcode == PostfixProgram::OP_SUBTRACT)) {
+    rule->base_register =
+        rule->program->identifier(instructions[0].identifier_index);
+    int64_t literal = static_cast<int64_t>(instructions[1].literal);
+    rule->offset =
+        instructions[2].opcode == PostfixProgram::OP_ADD ? literal : -literal;
+    recognized = true;
+  }
+
+  if (recognized) {
+    rule->shape = dereference ? SHAPE_REG_OFFSET_DEREF : SHAPE_REG_OFFSET;
+    // The fast shapes never run the program; drop it.
+    delete rule->program;
+    rule->program = NULL;
+  }
+
+  return rule;
+}
+
+template<typename V>
+bool CFIFrameInfo::EvaluateRule(const CompiledCFIRule &rule,
+                                const RegisterValueMap<V> &registers,
+                                const V *cfa,
+                                const MemoryRegion &memory,
+                                RegisterValueMap<V> *working,
+                                V *result) const {
+  if (rule.shape != CompiledCFIRule::SHAPE_GENERAL) {
+    // A register plus a constant offset, possibly dereferenced: no
+    // evaluator, and no copy of the register dictionary.
+    V base = V();
+    if (!rule.base_register.empty()) {
+      if (rule.base_register == ".cfa" && cfa) {
+        base = *cfa;
+      } else {
+        typename RegisterValueMap<V>::const_iterator it =
+            registers.find(rule.base_register);
+        if (it == registers.end())
+          return false;
+        base = it->second;
+      }
+    }
+    V value = base + static_cast<V>(rule.offset);
+    if (rule.shape == CompiledCFIRule::SHAPE_REG_OFFSET) {
+      *result = value;
+      return true;
+    }
+    return memory.GetMemoryAtAddress(value, result);
+  }
+
+  // The general case: execute the rule's compiled program against a
+  // copy of the register dictionary.
+  *working = registers;
+  if (cfa)
+    (*working)[".cfa"] = *cfa;
+  PostfixEvaluator<V> evaluator(working, &memory);
+  return evaluator.EvaluateProgramForValue(*rule.program, result);
+}
+
 template<typename V>
 bool CFIFrameInfo::FindCallerRegs(const RegisterValueMap<V> &registers,
                                   const MemoryRegion &memory,
                                   RegisterValueMap<V> *caller_registers) const {
   // If there are not rules for both .ra and .cfa in effect at this address,
   // don't use this CFI data for stack walking.
-  if (cfa_rule_.empty() || ra_rule_.empty())
+  if (!cfa_rule_ || !ra_rule_)
     return false;
 
   RegisterValueMap<V> working;
-  PostfixEvaluator<V> evaluator(&working, &memory);
 
   caller_registers->clear();
 
   // First, compute the CFA.
   V cfa;
-  working = registers;
-  if (!evaluator.EvaluateForValue(cfa_rule_, &cfa))
+  if (!EvaluateRule(*cfa_rule_, registers, static_cast<const V*>(NULL),
+                    memory, &working, &cfa))
     return false;
 
   // Then, compute the return address.
   V ra;
-  working = registers;
-  working[".cfa"] = cfa;
-  if (!evaluator.EvaluateForValue(ra_rule_, &ra))
+  if (!EvaluateRule(*ra_rule_, registers, &cfa, memory, &working, &ra))
     return false;
 
   // Now, compute values for all the registers register_rules_ mentions.
   for (RuleMap::const_iterator it = register_rules_.begin();
        it != register_rules_.end(); it++) {
     V value;
-    working = registers;
-    working[".cfa"] = cfa;
-    if (!evaluator.EvaluateForValue(it->second, &value))
+    if (!EvaluateRule(*it->second, registers, &cfa, memory, &working, &value))
       return false;
     (*caller_registers)[it->first] = value;
   }
@@ -104,20 +192,20 @@ template bool CFIFrameInfo::FindCallerRegs<uint64_t>(
 string CFIFrameInfo::Serialize() const {
   std::ostringstream stream;
 
-  if (!cfa_rule_.empty()) {
-    stream << ".cfa: " << cfa_rule_;
+  if (cfa_rule_) {
+    stream << ".cfa: " << cfa_rule_->expression;
   }
-  if (!ra_rule_.empty()) {
+  if (ra_rule_) {
     if (static_cast<std::streamoff>(stream.tellp()) != 0)
       stream << " ";
-    stream << ".ra: " << ra_rule_;
+    stream << ".ra: " << ra_rule_->expression;
   }
   for (RuleMap::const_iterator iter = register_rules_.begin();
        iter != register_rules_.end();
        ++iter) {
     if (static_cast<std::streamoff>(stream.tellp()) != 0)
       stream << " ";
-    stream << iter->first << ": " << iter->second;
+    stream << iter->first << ": " << iter->second->expression;
   }
 
   return stream.str();
@@ -170,17 +258,36 @@ bool CFIRuleParser::Report() {
   return true;
 }
 
+const CompiledCFIRule* CFIFrameInfoParseHandler::CompileRule(
+    const string &expression) {
+  CFIFrameInfo::RuleCache::iterator it = rule_cache_->find(expression);
+  if (it == rule_cache_->end()) {
+    it = rule_cache_->insert(std::make_pair(
+        expression, CompiledCFIRule::Compile(expression))).first;
+  }
+  return it->second;
+}
+
 void CFIFrameInfoParseHandler::CFARule(const string &expression) {
-  frame_info_->SetCFARule(expression);
+  if (rule_cache_)
+    frame_info_->SetCFARule(CompileRule(expression));
+  else
+    frame_info_->SetCFARule(expression);
 }
 
 void CFIFrameInfoParseHandler::RARule(const string &expression) {
-  frame_info_->SetRARule(expression);
+  if (rule_cache_)
+    frame_info_->SetRARule(CompileRule(expression));
+  else
+    frame_info_->SetRARule(expression);
 }
 
 void CFIFrameInfoParseHandler::RegisterRule(const string &name,
                                             const string &expression) {
-  frame_info_->SetRegisterRule(name, expression);
+  if (rule_cache_)
+    frame_info_->SetRegisterRule(name, CompileRule(expression));
+  else
+    frame_info_->SetRegisterRule(name, expression);
 }
 
 } // namespace google_breakpad
@@ -40,9 +40,11 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
+#include "processor/postfix_program.h"
 
 namespace google_breakpad {
 
@@ -50,6 +52,53 @@ using std::map;
 
 class MemoryRegion;
 
+// The compiled form of one STACK CFI rule expression.  Almost all rules
+// have the shape "REG" , "REG N +" , or "REG N + ^" (a register plus a
+// constant offset, optionally dereferenced); those are classified here
+// so FindCallerRegs can compute them directly, with no expression
+// evaluation and no register-dictionary copy.  Anything else keeps its
+// compiled PostfixProgram and runs through PostfixEvaluator.
+struct CompiledCFIRule {
+  enum Shape {
+    // Run program through PostfixEvaluator.
+    SHAPE_GENERAL = 0,
+    // base_register's value plus offset.  An empty base_register means
+    // a bare literal: the value is just offset.
+    SHAPE_REG_OFFSET,
+    // The memory word at base_register's value plus offset.
+    SHAPE_REG_OFFSET_DEREF
+  };
+
+  // Compiles expression, classifying its shape.  The caller owns the
+  // result.  Compilation cannot fail; unrecognized forms are
+  // SHAPE_GENERAL.
+  static CompiledCFIRule* Compile(const string &expression);
+
+  ~CompiledCFIRule() { delete program; }
+
+  // The original expression text, for Serialize.
+  string expression;
+
+  Shape shape;
+
+  // For the SHAPE_REG_OFFSET shapes: the register or pseudoregister
+  // whose value is the base, and the constant added to it.
+  string base_register;
+  int64_t offset;
+
+  // For SHAPE_GENERAL: the compiled program, owned.  NULL otherwise.
+  PostfixProgram *program;
+
+ private:
+  CompiledCFIRule()
+      : expression(), shape(SHAPE_GENERAL), base_register(), offset(0),
+        program(NULL) {}
+
+  // Disallow copy and assignment.
+  CompiledCFIRule(const CompiledCFIRule&);
+  void operator=(const CompiledCFIRule&);
+};
+
 // A set of rules for recovering the calling frame's registers'
 // values, when the PC is at a given address in the current frame's
 // function. See the description of 'STACK CFI' records at:
@@ -69,13 +118,56 @@ class CFIFrameInfo {
   template<typename ValueType> class RegisterValueMap: 
     public map<string, ValueType> { };
 
+  // A memo of compiled rule expressions, keyed by expression text.
+  // STACK CFI records repeat a small set of expressions, so callers
+  // that build many CFIFrameInfo objects (the resolvers) share one
+  // cache per module and compile each distinct expression only once.
+  // The cache's owner owns the rules; CFIFrameInfo objects built
+  // against the cache reference them without taking ownership, so they
+  // can be handed to other threads and destroyed there freely.
+  typedef map<string, CompiledCFIRule*> RuleCache;
+
+  CFIFrameInfo() : cfa_rule_(NULL), ra_rule_(NULL) {}
+  ~CFIFrameInfo() {
+    for (size_t index = 0; index < owned_rules_.size(); ++index)
+      delete owned_rules_[index];
+  }
+
+  // Drops every rule, returning this object to its freshly constructed
+  // state, so that it can be refilled for another instruction address.
+  void Clear() {
+    cfa_rule_ = NULL;
+    ra_rule_ = NULL;
+    register_rules_.clear();
+    for (size_t index = 0; index < owned_rules_.size(); ++index)
+      delete owned_rules_[index];
+    owned_rules_.clear();
+  }
+
   // Set the expression for computing a call frame address, return
   // address, or register's value. At least the CFA rule and the RA
-  // rule must be set before calling FindCallerRegs.
-  void SetCFARule(const string &expression) { cfa_rule_ = expression; }
-  void SetRARule(const string &expression)  { ra_rule_ = expression; }
+  // rule must be set before calling FindCallerRegs.  The string forms
+  // compile the expression, and the result is owned here; the
+  // compiled-rule forms reference an already compiled rule, typically
+  // from a RuleCache, which must outlive this object.
+  void SetCFARule(const string &expression) {
+    cfa_rule_ = Own(CompiledCFIRule::Compile(expression));
+  }
+  void SetRARule(const string &expression)  {
+    ra_rule_ = Own(CompiledCFIRule::Compile(expression));
+  }
   void SetRegisterRule(const string &register_name, const string &expression) {
-    register_rules_[register_name] = expression;
+    register_rules_[register_name] = Own(CompiledCFIRule::Compile(expression));
+  }
+  void SetCFARule(const CompiledCFIRule *rule) {
+    cfa_rule_ = rule;
+  }
+  void SetRARule(const CompiledCFIRule *rule) {
+    ra_rule_ = rule;
+  }
+  void SetRegisterRule(const string &register_name,
+                       const CompiledCFIRule *rule) {
+    register_rules_[register_name] = rule;
   }
 
   // Compute the values of the calling frame's registers, according to
@@ -106,32 +198,61 @@ class CFIFrameInfo {
 
  private:
 
-  // A map from register names onto evaluation rules. 
-  typedef map<string, string> RuleMap;
+  // A map from register names onto evaluation rules.
+  typedef map<string, const CompiledCFIRule*> RuleMap;
+
+  // Takes ownership of a rule this object compiled for itself, and
+  // returns it for storing in a rule member.
+  const CompiledCFIRule* Own(CompiledCFIRule *rule) {
+    owned_rules_.push_back(rule);
+    return rule;
+  }
+
+  // Computes the value of one compiled rule.  REGISTERS holds the
+  // current frame's known registers; CFA, if non-NULL, is the already
+  // computed call frame address.  WORKING is scratch space used only
+  // by SHAPE_GENERAL rules, which copy the register dictionary into it
+  // for the evaluator; the fast shapes read REGISTERS directly.
+  template<typename ValueType>
+  bool EvaluateRule(const CompiledCFIRule &rule,
+                    const RegisterValueMap<ValueType> &registers,
+                    const ValueType *cfa,
+                    const MemoryRegion &memory,
+                    RegisterValueMap<ValueType> *working,
+                    ValueType *result) const;
 
   // In this type, a "postfix expression" is an expression of the sort
   // interpreted by google_breakpad::PostfixEvaluator.
 
-  // A postfix expression for computing the current frame's CFA (call
+  // The compiled rule for computing the current frame's CFA (call
   // frame address). The CFA is a reference address for the frame that
-  // remains unchanged throughout the frame's lifetime. You should
-  // evaluate this expression with a dictionary initially populated
-  // with the values of the current frame's known registers.
-  string cfa_rule_;
-
-  // The following expressions should be evaluated with a dictionary
-  // initially populated with the values of the current frame's known
-  // registers, and with ".cfa" set to the result of evaluating the
-  // cfa_rule expression, above.
-
-  // A postfix expression for computing the current frame's return
-  // address. 
-  string ra_rule_;
-
-  // For a register named REG, rules[REG] is a postfix expression
-  // which leaves the value of REG in the calling frame on the top of
-  // the stack. You should evaluate this expression
+  // remains unchanged throughout the frame's lifetime. The rule is
+  // evaluated against the values of the current frame's known
+  // registers.  Not owned; see owned_rules_.
+  const CompiledCFIRule *cfa_rule_;
+
+  // The following rules are evaluated against the values of the
+  // current frame's known registers, with ".cfa" set to the result of
+  // evaluating the cfa_rule, above.
+
+  // The compiled rule for computing the current frame's return
+  // address.  Not owned; see owned_rules_.
+  const CompiledCFIRule *ra_rule_;
+
+  // For a register named REG, rules[REG] is a compiled rule whose
+  // value is REG's value in the calling frame.
   RuleMap register_rules_;
+
+  // Rules compiled by the string forms of the setters, owned here.
+  // Rules set from a RuleCache are owned by the cache instead, so two
+  // threads sharing a cache never touch each other's ownership state.
+  // A rule a setter replaces stays here until destruction; rule sets
+  // are small and short-lived, so the retention is immaterial.
+  std::vector<CompiledCFIRule*> owned_rules_;
+
+  // Disallow copy constructor and assignment operator.
+  CFIFrameInfo(const CFIFrameInfo&);
+  void operator=(const CFIFrameInfo&);
 };
 
 // A parser for STACK CFI-style rule sets.
@@ -181,14 +302,26 @@ class CFIFrameInfoParseHandler: public CFIRuleParser::Handler {
  public:
   // Populate FRAME_INFO with the results of parsing.
   CFIFrameInfoParseHandler(CFIFrameInfo *frame_info)
-      : frame_info_(frame_info) { }
+      : frame_info_(frame_info), rule_cache_(NULL) { }
+
+  // As above, but compile rule expressions through RULE_CACHE, so
+  // expressions already seen by the cache's owner are shared rather
+  // than recompiled.
+  CFIFrameInfoParseHandler(CFIFrameInfo *frame_info,
+                           CFIFrameInfo::RuleCache *rule_cache)
+      : frame_info_(frame_info), rule_cache_(rule_cache) { }
 
   void CFARule(const string &expression);
   void RARule(const string &expression);
   void RegisterRule(const string &name, const string &expression);
 
  private:
+  // Returns the compiled form of expression from rule_cache_, which
+  // must be set; the cache retains ownership.
+  const CompiledCFIRule* CompileRule(const string &expression);
+
   CFIFrameInfo *frame_info_;
+  CFIFrameInfo::RuleCache *rule_cache_;
 };
 
 // A utility class template for simple 'STACK CFI'-driven stack walkers.
@@ -239,9 +372,13 @@ class SimpleCFIWalker {
   // Create a simple CFI-based frame walker, given a description of the
   // architecture's register set. REGISTER_MAP is an array of
   // RegisterSet structures; MAP_SIZE is the number of elements in the
-  // array.
+  // array.  The constructor precomputes the binding tables
+  // FindCallerRegisters works from, so the per-frame recovery loop does
+  // no per-register dictionary probes.
   SimpleCFIWalker(const RegisterSet *register_map, size_t map_size)
-      : register_map_(register_map), map_size_(map_size) { }
+      : register_map_(register_map), map_size_(map_size) {
+    BuildBindingTables();
+  }
 
   // Compute the calling frame's raw context given the callee's raw
   // context.
@@ -264,8 +401,34 @@ class SimpleCFIWalker {
                            int *caller_validity) const;
 
  private:
+  // One entry of the name-to-register binding table: which register_map_
+  // entry a name denotes, and whether it is the register's primary name.
+  // When the rules produce a value under both names, the primary one
+  // wins.
+  struct Binding {
+    size_t index;
+    bool primary;
+  };
+  typedef map<string, Binding> BindingMap;
+
+  // Precomputes names_, sorted_order_ and bindings_ from register_map_.
+  void BuildBindingTables();
+
   const RegisterSet *register_map_;
   size_t map_size_;
+
+  // The register names as string objects, so the per-frame loops never
+  // construct keys from the character pointers in register_map_.
+  std::vector<string> names_;
+
+  // register_map_ indices ordered by register name.  Populating a
+  // register dictionary in this order makes every insertion an
+  // amortized-constant append.
+  std::vector<size_t> sorted_order_;
+
+  // Binds each register name, and alternate name, to its register_map_
+  // entry.
+  BindingMap bindings_;
 };
 
 }  // namespace google_breakpad
@@ -0,0 +1,150 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// compressed_symbol_file.cc: Support for symbol files stored compressed.
+//
+// See compressed_symbol_file.h for documentation.
+
+#include "processor/compressed_symbol_file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+static bool HasSuffix(const string &path, const char *suffix) {
+  size_t suffix_length = strlen(suffix);
+  return path.size() > suffix_length &&
+      path.compare(path.size() - suffix_length, suffix_length, suffix) == 0;
+}
+
+bool IsCompressedFile(const string &path) {
+  return HasSuffix(path, ".gz") || HasSuffix(path, ".zst");
+}
+
+bool IsCompressedSymbolFile(const string &path) {
+  return IsCompressedFile(path);
+}
+
+#ifndef _WIN32
+
+// Returns path wrapped in single quotes, with embedded single quotes
+// escaped, so it can be interpolated into a shell command line.
+static string ShellQuote(const string &path) {
+  string quoted = "'";
+  for (size_t index = 0; index < path.size(); ++index) {
+    if (path[index] == '\'') {
+      quoted.append("'\\''");
+    } else {
+      quoted.push_back(path[index]);
+    }
+  }
+  quoted.push_back('\'');
+  return quoted;
+}
+
+bool ReadCompressedFile(const string &path, string *contents) {
+  if (!contents) {
+    return false;
+  }
+  contents->clear();
+
+  const char *decompressor;
+  if (HasSuffix(path, ".gz")) {
+    decompressor = "gzip -dc";
+  } else if (HasSuffix(path, ".zst")) {
+    decompressor = "zstd -dcq";
+  } else {
+    return false;
+  }
+
+  string command = string(decompressor) + " < " + ShellQuote(path);
+  FILE *pipe = popen(command.c_str(), "r");
+  if (!pipe) {
+    BPLOG(ERROR) << "Could not start decompressor for " << path;
+    return false;
+  }
+
+  char chunk[65536];
+  size_t chunk_read;
+  while ((chunk_read = fread(chunk, 1, sizeof(chunk), pipe)) > 0) {
+    contents->append(chunk, chunk_read);
+  }
+
+  bool read_error = ferror(pipe) != 0;
+  int status = pclose(pipe);
+  if (read_error || status != 0) {
+    BPLOG(ERROR) << "Decompression of " << path << " failed, status " <<
+        status;
+    contents->clear();
+    return false;
+  }
+  return true;
+}
+
+#else  // _WIN32
+
+bool ReadCompressedFile(const string &path, string *contents) {
+  BPLOG(INFO) << "Compressed file " << path <<
+      " not supported on this platform";
+  return false;
+}
+
+#endif  // _WIN32
+
+bool ReadCompressedSymbolFile(const string &path, string *contents) {
+  return ReadCompressedFile(path, contents);
+}
+
+bool ReadCompressedSymbolFile(const string &path,
+                              char **symbol_data,
+                              size_t *size) {
+  if (!symbol_data) {
+    return false;
+  }
+
+  string contents;
+  if (!ReadCompressedSymbolFile(path, &contents)) {
+    return false;
+  }
+
+  // Allocate the parse buffer with a NUL terminator, matching
+  // SourceLineResolverBase::ReadSymbolFile.
+  *symbol_data = new char[contents.size() + 1];
+  memcpy(*symbol_data, contents.data(), contents.size());
+  (*symbol_data)[contents.size()] = '\0';
+  if (size) {
+    *size = contents.size();
+  }
+  return true;
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,81 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// compressed_symbol_file.h: Support for symbol files stored compressed.
+//
+// Symbol stores commonly keep .sym files gzipped (or zstd-compressed) at
+// rest.  These helpers let SimpleSymbolSupplier and the resolvers consume
+// a .sym.gz or .sym.zst file directly, decompressing it in a streaming
+// fashion straight into the parse buffer instead of round-tripping the
+// uncompressed text through a temporary file.
+//
+// Decompression is performed by piping the file through the system's
+// gzip or zstd tool, so no compression library is linked into the
+// processor; a missing tool simply makes the read fail.
+
+#ifndef PROCESSOR_COMPRESSED_SYMBOL_FILE_H__
+#define PROCESSOR_COMPRESSED_SYMBOL_FILE_H__
+
+#include <stddef.h>
+
+#include <string>
+
+#include "common/using_std_string.h"
+
+namespace google_breakpad {
+
+// Returns true if path names a compressed file that ReadCompressedFile
+// understands (".gz" or ".zst" suffix).
+bool IsCompressedFile(const string &path);
+
+// Decompresses the file at path into contents, which may be arbitrary
+// binary data.  Returns false if the file cannot be read, the
+// decompressor fails, or this platform has no decompression support.
+bool ReadCompressedFile(const string &path, string *contents);
+
+// Returns true if path names a compressed symbol file that
+// ReadCompressedSymbolFile understands (".gz" or ".zst" suffix).
+bool IsCompressedSymbolFile(const string &path);
+
+// Decompresses the file at path into contents.  Returns false if the
+// file cannot be read, the decompressor fails, or this platform has no
+// decompression support.
+bool ReadCompressedSymbolFile(const string &path, string *contents);
+
+// As above, but delivers the text in a NUL-terminated heap buffer
+// allocated with new char[], suitable for the in-place symbol parsers.
+// On success the caller owns *symbol_data; *size is the text length,
+// excluding the terminator.
+bool ReadCompressedSymbolFile(const string &path,
+                              char **symbol_data,
+                              size_t *size);
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_COMPRESSED_SYMBOL_FILE_H__
@@ -69,6 +69,11 @@ bool ContainedRangeMap<AddressType, EntryType>::StoreRange(
     return false;
   }
 
+  // Late store into a frozen map: rebuild the tree so the containment
+  // checks and insertion below work normally.
+  if (!flat_.empty())
+    Thaw();
+
   if (!map_)
     map_ = new AddressToRangeMap();
 
@@ -154,6 +159,33 @@ bool ContainedRangeMap<AddressType, EntryType>::RetrieveRange(
                              "|entry|";
   assert(entry);
 
+  if (!flat_.empty()) {
+    // Binary-search for the last range whose base address is at or below
+    // address.  If it does not contain address, the only other candidates
+    // are the ranges containing it, innermost first via the parent links.
+    size_t low = 0;
+    size_t high_index = flat_.size();
+    while (low < high_index) {
+      size_t mid = low + (high_index - low) / 2;
+      if (flat_[mid].base <= address) {
+        low = mid + 1;
+      } else {
+        high_index = mid;
+      }
+    }
+    if (low == 0)
+      return false;
+
+    int32_t index = static_cast<int32_t>(low - 1);
+    while (index != -1 && flat_[index].high < address)
+      index = flat_[index].parent;
+    if (index == -1)
+      return false;
+
+    *entry = flat_[index].entry;
+    return true;
+  }
+
   // If nothing was ever stored, then there's nothing to retrieve.
   if (!map_)
     return false;
@@ -188,6 +220,61 @@ void ContainedRangeMap<AddressType, EntryType>::Clear() {
     delete map_;
     map_ = NULL;
   }
+  flat_.clear();
+}
+
+
+template<typename AddressType, typename EntryType>
+void ContainedRangeMap<AddressType, EntryType>::Freeze() {
+  if (!map_ || !flat_.empty())
+    return;
+
+  FlatRangeVector flat;
+  FlattenInto(-1, &flat);
+
+  // The tree is no longer needed; free its nodes and per-node maps.
+  Clear();
+  flat_.swap(flat);
+}
+
+
+template<typename AddressType, typename EntryType>
+void ContainedRangeMap<AddressType, EntryType>::Thaw() {
+  if (flat_.empty())
+    return;
+
+  FlatRangeVector flat;
+  flat.swap(flat_);
+
+  // A containing range appears before the ranges it contains, so storing
+  // in order reproduces the original nesting.
+  for (size_t index = 0; index < flat.size(); ++index) {
+    const FlatRange &range = flat[index];
+    StoreRange(range.base, range.high - range.base + 1, range.entry);
+  }
+}
+
+
+template<typename AddressType, typename EntryType>
+void ContainedRangeMap<AddressType, EntryType>::FlattenInto(
+    int32_t parent_index, FlatRangeVector *flat) const {
+  if (!map_)
+    return;
+
+  for (MapConstIterator iterator = map_->begin();
+       iterator != map_->end();
+       ++iterator) {
+    const ContainedRangeMap *child = iterator->second;
+    FlatRange range;
+    range.base = child->base_;
+    range.high = iterator->first;
+    range.entry = child->entry_;
+    range.parent = parent_index;
+
+    int32_t child_index = static_cast<int32_t>(flat->size());
+    flat->push_back(range);
+    child->FlattenInto(child_index, flat);
+  }
 }
 
 
@@ -62,6 +62,9 @@
 
 
 #include <map>
+#include <vector>
+
+#include "google_breakpad/common/breakpad_types.h"
 
 
 namespace google_breakpad {
@@ -104,6 +107,17 @@ class ContainedRangeMap {
   // empty state when called on the root node.
   void Clear();
 
+  // Converts the tree to a flattened representation: a single array of
+  // ranges in preorder, each linked to its containing range by index.
+  // Lookups become a binary search plus a walk up the parent links, and
+  // the per-node maps and tree nodes are freed outright, so a frozen map
+  // is also far smaller.  Call on the root node once the map is fully
+  // built; storing into a frozen map rebuilds the tree first.
+  void Freeze();
+
+  // Reverses Freeze, rebuilding the tree from the flattened ranges.
+  void Thaw();
+
  private:
   friend class ContainedRangeMapSerializer<AddressType, EntryType>;
   friend class ModuleComparer;
@@ -137,10 +151,31 @@ class ContainedRangeMap {
   // ContainedRangeMap objects, and never on |this|.
   const EntryType entry_;
 
+  // One range in the flattened representation, linked to its containing
+  // range by index into the same array.
+  struct FlatRange {
+    AddressType base;
+    AddressType high;
+    EntryType entry;
+    int32_t parent;  // index of the containing range, or -1
+  };
+  typedef std::vector<FlatRange> FlatRangeVector;
+
+  // Appends this node's descendants to |flat| in preorder, with children
+  // visited in ascending address order.  parent_index is the index of
+  // this node's own FlatRange, or -1 for the root.
+  void FlattenInto(int32_t parent_index, FlatRangeVector *flat) const;
+
   // The map containing child ranges, keyed by each child range's high
   // address.  This is a pointer to avoid allocating map structures for
   // leaf nodes, where they are not needed.
   AddressToRangeMap *map_;
+
+  // The flattened representation.  Only meaningful on the root node, and
+  // non-empty only after Freeze.  Preorder with children in ascending
+  // address order makes this sorted by base address, with a containing
+  // range appearing before the ranges it contains.
+  FlatRangeVector flat_;
 };
 
 
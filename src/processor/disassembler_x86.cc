@@ -26,11 +26,23 @@
 
 #include "processor/disassembler_x86.h"
 
+#include <pthread.h>
 #include <string.h>
 #include <unistd.h>
 
 namespace google_breakpad {
 
+// libdisasm builds its instruction tables in x86_init, which is far more
+// expensive than decoding a crash's instruction window.  Initialize them
+// once for the life of the process, so the cost is not paid again by
+// every disassembler a multi-dump session creates, and so concurrently
+// created disassemblers do not race on the shared tables.
+static pthread_once_t libdisasm_init_control = PTHREAD_ONCE_INIT;
+
+static void InitializeLibdisasm() {
+  libdis::x86_init(libdis::opt_none, NULL, NULL);
+}
+
 DisassemblerX86::DisassemblerX86(const uint8_t *bytecode,
                                  uint32_t size,
                                  uint32_t virtual_address) :
@@ -44,17 +56,41 @@ DisassemblerX86::DisassemblerX86(const uint8_t *bytecode,
                                      pushed_bad_value_(false),
                                      end_of_block_(false),
                                      flags_(0) {
-  libdis::x86_init(libdis::opt_none, NULL, NULL);
+  pthread_once(&libdisasm_init_control, InitializeLibdisasm);
 }
 
 DisassemblerX86::~DisassemblerX86() {
   if (instr_valid_)
     libdis::x86_oplist_free(&current_instr_);
-
-  libdis::x86_cleanup();
 }
 
 uint32_t DisassemblerX86::NextInstruction() {
+  uint32_t instr_size = DecodeNextInstruction();
+  if (instr_size == 0 || !instr_valid_)
+    return 0;
+
+  AnalyzeCurrentInstruction();
+  return instr_size;
+}
+
+uint32_t DisassemblerX86::DisassembleWindow(libdis::x86_insn_t *instructions,
+                                            uint32_t max_instructions) {
+  uint32_t instruction_count = 0;
+  while (instruction_count < max_instructions && !end_of_block_) {
+    if (NextInstruction() == 0)
+      break;
+
+    // Record a copy of the decoded instruction, minus its operand list,
+    // which stays owned by the disassembler and is released when decoding
+    // moves past the instruction.
+    instructions[instruction_count] = current_instr_;
+    instructions[instruction_count].operands = NULL;
+    instruction_count++;
+  }
+  return instruction_count;
+}
+
+uint32_t DisassemblerX86::DecodeNextInstruction() {
   if (instr_valid_)
     libdis::x86_oplist_free(&current_instr_);
 
@@ -74,9 +110,10 @@ uint32_t DisassemblerX86::NextInstruction() {
   current_byte_offset_ += instr_size;
   current_inst_offset_++;
   instr_valid_ = libdis::x86_insn_is_valid(&current_instr_);
-  if (!instr_valid_)
-    return 0;
+  return instr_valid_ ? instr_size : 0;
+}
 
+void DisassemblerX86::AnalyzeCurrentInstruction() {
   if (current_instr_.type == libdis::insn_return)
     end_of_block_ = true;
   libdis::x86_op_t *src = libdis::x86_get_src_operand(&current_instr_);
@@ -206,8 +243,6 @@ uint32_t DisassemblerX86::NextInstruction() {
         break;
     }
   }
-
-  return instr_size;
 }
 
 bool DisassemblerX86::setBadRead() {
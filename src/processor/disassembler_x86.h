@@ -73,6 +73,20 @@ class DisassemblerX86 {
     // disassemble until the end of a region.
     uint32_t NextInstruction();
 
+    // Decodes up to max_instructions instructions from the current
+    // position into the caller's preallocated array in one pass,
+    // stopping early at the end of the region, at an instruction that
+    // cannot be decoded, or after a return instruction. Flags and
+    // tainted-register state advance exactly as if NextInstruction had
+    // been called in a loop, and the last decoded instruction remains
+    // current. The recorded copies do not carry operand lists - those
+    // stay owned by the disassembler and are released as decoding moves
+    // past each instruction - so only the fixed-size fields are
+    // meaningful. Returns the number of instructions decoded; a short
+    // count means the window is exhausted.
+    uint32_t DisassembleWindow(libdis::x86_insn_t *instructions,
+                               uint32_t max_instructions);
+
     // Indicates whether the current disassembled instruction was valid.
     bool currentInstructionValid() { return instr_valid_; }
 
@@ -102,6 +116,16 @@ class DisassemblerX86 {
     bool setBadWrite();
 
   protected:
+    // Decodes the instruction at the current offset, releasing the
+    // previous instruction's operand list, without performing any
+    // taint analysis.  Returns the decoded size in bytes, or 0 at the
+    // end of the region or on an undecodable instruction.
+    uint32_t DecodeNextInstruction();
+
+    // Applies the taint-tracking analysis to the current instruction,
+    // updating flags and the tainted-register state.
+    void AnalyzeCurrentInstruction();
+
     const uint8_t *bytecode_;
     uint32_t size_;
     uint32_t virtual_address_;
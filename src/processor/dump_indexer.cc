@@ -0,0 +1,428 @@
+// Copyright (c) 2010 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// dump_indexer.cc: Incremental catalog over a directory of minidumps.
+//
+// Fleet questions like "which dumps reference module X" or "which dumps
+// crashed in Y" are usually answered by re-processing every dump, which
+// walks and symbolizes thousands of stacks to read a few directory
+// entries each.  This tool instead keeps a catalog file: one pass over
+// the dump directory records each dump's crash signature, module list
+// with debug identifiers, thread count, and size, using only cheap
+// reads - Minidump::ScanModules for the module list, the exception
+// stream for the signature - and never walking a stack.  Re-running the
+// tool is incremental: dumps already cataloged with an unchanged size
+// and mtime are carried over without reopening them, so refreshing the
+// catalog after a day's intake touches only the new dumps.
+//
+// The catalog is a tab-separated text file, one DUMP line per dump
+// followed by one MOD line per module, so it is greppable as-is; the
+// query modes below cover the common questions.
+//
+// Usage: dump_indexer <catalog> <dump-directory>     rebuild/refresh
+//        dump_indexer <catalog> -m <substring>       dumps whose module
+//                                                    names match
+//        dump_indexer <catalog> -c <substring>       dumps whose crash
+//                                                    signature or
+//                                                    crashing module
+//                                                    matches
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/scoped_ptr.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/minidump.h"
+#include "google_breakpad/processor/minidump_processor.h"
+
+namespace {
+
+using google_breakpad::Minidump;
+using google_breakpad::MinidumpProcessor;
+using google_breakpad::MinidumpScannedModule;
+using std::map;
+using std::vector;
+
+const char kCatalogHeader[] = "# breakpad dump catalog v1";
+
+// Everything the catalog records about one dump.  The module fields are
+// parallel vectors, one entry per MOD line.
+struct DumpRecord {
+  DumpRecord()
+      : file_size(0), file_mtime(0), thread_count(0), crash_address(0) {}
+
+  uint64_t file_size;
+  uint64_t file_mtime;
+  uint32_t thread_count;
+  string crash_reason;      // empty if the dump has no exception stream
+  uint64_t crash_address;
+  string crash_module;      // code file containing crash_address
+  string fingerprint;       // MinidumpProcessor::GetCrashFingerprint
+
+  vector<MinidumpScannedModule> modules;
+};
+
+typedef map<string, DumpRecord> Catalog;
+
+// Splits line at tabs.  Fields in the catalog never contain tabs;
+// module paths with spaces are common, which is why the format is
+// tab-separated in the first place.
+void SplitFields(const string& line, vector<string>* fields) {
+  fields->clear();
+  size_t start = 0;
+  for (;;) {
+    size_t tab = line.find('\t', start);
+    if (tab == string::npos) {
+      fields->push_back(line.substr(start));
+      return;
+    }
+    fields->push_back(line.substr(start, tab - start));
+    start = tab + 1;
+  }
+}
+
+// Loads an existing catalog into |catalog|.  A missing file is an empty
+// catalog, not an error; a file that is not a catalog is.
+bool LoadCatalog(const string& path, Catalog* catalog) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) {
+    return true;
+  }
+
+  char line_buffer[8192];
+  bool saw_header = false;
+  DumpRecord* current = NULL;
+  vector<string> fields;
+  while (fgets(line_buffer, sizeof(line_buffer), file)) {
+    string line(line_buffer);
+    while (!line.empty() &&
+           (line[line.size() - 1] == '\n' || line[line.size() - 1] == '\r')) {
+      line.erase(line.size() - 1);
+    }
+    if (line.empty()) {
+      continue;
+    }
+    if (!saw_header) {
+      if (line != kCatalogHeader) {
+        fprintf(stderr, "dump_indexer: %s is not a dump catalog\n",
+                path.c_str());
+        fclose(file);
+        return false;
+      }
+      saw_header = true;
+      continue;
+    }
+
+    SplitFields(line, &fields);
+    if (fields[0] == "DUMP" && fields.size() == 9) {
+      DumpRecord record;
+      record.file_size = strtoull(fields[2].c_str(), NULL, 10);
+      record.file_mtime = strtoull(fields[3].c_str(), NULL, 10);
+      record.thread_count = strtoul(fields[4].c_str(), NULL, 10);
+      record.crash_reason = fields[5] == "-" ? "" : fields[5];
+      record.crash_address = strtoull(fields[6].c_str(), NULL, 16);
+      record.crash_module = fields[7] == "-" ? "" : fields[7];
+      record.fingerprint = fields[8] == "-" ? "" : fields[8];
+      current = &(*catalog)[fields[1]];
+      *current = record;
+    } else if (fields[0] == "MOD" && fields.size() == 6 && current) {
+      MinidumpScannedModule module;
+      module.code_file = fields[1];
+      module.debug_file = fields[2] == "-" ? "" : fields[2];
+      module.debug_identifier = fields[3] == "-" ? "" : fields[3];
+      module.base_of_image = strtoull(fields[4].c_str(), NULL, 16);
+      module.size_of_image = strtoull(fields[5].c_str(), NULL, 16);
+      current->modules.push_back(module);
+    }
+  }
+
+  fclose(file);
+  return true;
+}
+
+// Prints s, or "-" for an empty string, so every catalog line has a
+// fixed field count.
+const char* FieldOrDash(const string& s) {
+  return s.empty() ? "-" : s.c_str();
+}
+
+// Writes |catalog| to path via a temporary file, so an interrupted run
+// leaves the previous catalog intact.
+bool WriteCatalog(const string& path, const Catalog& catalog) {
+  string temp_path = path + ".tmp";
+  FILE* file = fopen(temp_path.c_str(), "w");
+  if (!file) {
+    fprintf(stderr, "dump_indexer: could not write %s\n", temp_path.c_str());
+    return false;
+  }
+
+  fprintf(file, "%s\n", kCatalogHeader);
+  for (Catalog::const_iterator entry = catalog.begin();
+       entry != catalog.end();
+       ++entry) {
+    const DumpRecord& record = entry->second;
+    fprintf(file, "DUMP\t%s\t%llu\t%llu\t%u\t%s\t%llx\t%s\t%s\n",
+            entry->first.c_str(),
+            (unsigned long long) record.file_size,
+            (unsigned long long) record.file_mtime,
+            record.thread_count,
+            FieldOrDash(record.crash_reason),
+            (unsigned long long) record.crash_address,
+            FieldOrDash(record.crash_module),
+            FieldOrDash(record.fingerprint));
+    for (size_t i = 0; i < record.modules.size(); i++) {
+      const MinidumpScannedModule& module = record.modules[i];
+      fprintf(file, "MOD\t%s\t%s\t%s\t%llx\t%llx\n",
+              module.code_file.c_str(),
+              FieldOrDash(module.debug_file),
+              FieldOrDash(module.debug_identifier),
+              (unsigned long long) module.base_of_image,
+              (unsigned long long) module.size_of_image);
+    }
+  }
+
+  bool ok = fclose(file) == 0;
+  if (ok && rename(temp_path.c_str(), path.c_str()) != 0) {
+    fprintf(stderr, "dump_indexer: could not replace %s\n", path.c_str());
+    ok = false;
+  }
+  return ok;
+}
+
+// Reads the thread count from the thread list stream's header without
+// building a MinidumpThreadList.
+uint32_t ReadThreadCount(Minidump* dump) {
+  uint32_t stream_length;
+  if (!dump->SeekToStreamType(MD_THREAD_LIST_STREAM, &stream_length) ||
+      stream_length < sizeof(uint32_t)) {
+    return 0;
+  }
+  uint32_t thread_count;
+  if (!dump->ReadBytes(&thread_count, sizeof(thread_count))) {
+    return 0;
+  }
+  if (dump->swap()) {
+    thread_count = ((thread_count >> 24) & 0xff) |
+                   ((thread_count >> 8) & 0xff00) |
+                   ((thread_count << 8) & 0xff0000) |
+                   (thread_count << 24);
+  }
+  return thread_count;
+}
+
+// Indexes the dump at path into record.  Only cheap reads: the header
+// and directory, the module list via ScanModules, the thread list's
+// count word, and the exception stream for the signature.  Returns
+// false if the file is not a readable minidump.
+bool IndexDump(const string& path, DumpRecord* record) {
+  Minidump dump(path);
+  if (!dump.Read()) {
+    return false;
+  }
+
+  record->thread_count = ReadThreadCount(&dump);
+
+  record->crash_address = 0;
+  record->crash_reason = MinidumpProcessor::GetCrashReason(
+      &dump, &record->crash_address);
+  MinidumpProcessor::GetCrashFingerprint(&dump, &record->fingerprint);
+
+  // The module list, and with it the module the faulting address lies
+  // in - the "crashed in Y" of corpus queries.
+  dump.ScanModules(true, &record->modules);
+  record->crash_module.clear();
+  if (record->crash_address) {
+    for (size_t i = 0; i < record->modules.size(); i++) {
+      const MinidumpScannedModule& module = record->modules[i];
+      if (record->crash_address >= module.base_of_image &&
+          record->crash_address - module.base_of_image <
+              module.size_of_image) {
+        record->crash_module = module.code_file;
+        break;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Refreshes catalog against the dumps in directory: carries over
+// entries whose size and mtime are unchanged, indexes new and changed
+// files, and drops entries for files no longer present.
+bool RefreshCatalog(const string& directory, Catalog* catalog) {
+  DIR* dir = opendir(directory.c_str());
+  if (!dir) {
+    fprintf(stderr, "dump_indexer: could not open directory %s\n",
+            directory.c_str());
+    return false;
+  }
+
+  Catalog refreshed;
+  int indexed = 0;
+  int carried = 0;
+  int skipped = 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    string path = directory + "/" + entry->d_name;
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+      continue;
+    }
+
+    Catalog::iterator existing = catalog->find(path);
+    if (existing != catalog->end() &&
+        existing->second.file_size ==
+            static_cast<uint64_t>(file_stat.st_size) &&
+        existing->second.file_mtime ==
+            static_cast<uint64_t>(file_stat.st_mtime)) {
+      refreshed[path] = existing->second;
+      carried++;
+      continue;
+    }
+
+    DumpRecord record;
+    record.file_size = file_stat.st_size;
+    record.file_mtime = file_stat.st_mtime;
+    if (!IndexDump(path, &record)) {
+      // Not a minidump (or truncated beyond reading); leave it out.
+      skipped++;
+      continue;
+    }
+    refreshed[path] = record;
+    indexed++;
+  }
+  closedir(dir);
+
+  catalog->swap(refreshed);
+  printf("dump_indexer: %d indexed, %d carried over, %d skipped, "
+         "%d total\n",
+         indexed, carried, skipped, static_cast<int>(catalog->size()));
+  return true;
+}
+
+// Prints the DUMP line of every catalog entry |matches| accepts.
+template<typename MatchFunction>
+int PrintMatches(const Catalog& catalog, MatchFunction matches) {
+  int match_count = 0;
+  for (Catalog::const_iterator entry = catalog.begin();
+       entry != catalog.end();
+       ++entry) {
+    if (matches(entry->second)) {
+      const DumpRecord& record = entry->second;
+      printf("%s\t%s\t%s\t%u threads\n",
+             entry->first.c_str(),
+             FieldOrDash(record.crash_reason),
+             FieldOrDash(record.crash_module),
+             record.thread_count);
+      match_count++;
+    }
+  }
+  return match_count;
+}
+
+// Query predicates for the -m and -c modes.
+struct MatchesModule {
+  explicit MatchesModule(const string& substring) : substring(substring) {}
+  bool operator()(const DumpRecord& record) const {
+    for (size_t i = 0; i < record.modules.size(); i++) {
+      if (record.modules[i].code_file.find(substring) != string::npos ||
+          record.modules[i].debug_file.find(substring) != string::npos) {
+        return true;
+      }
+    }
+    return false;
+  }
+  string substring;
+};
+
+struct MatchesCrash {
+  explicit MatchesCrash(const string& substring) : substring(substring) {}
+  bool operator()(const DumpRecord& record) const {
+    return record.crash_reason.find(substring) != string::npos ||
+           record.crash_module.find(substring) != string::npos;
+  }
+  string substring;
+};
+
+void Usage(const char* program_name) {
+  fprintf(stderr,
+          "usage: %s <catalog> <dump-directory>   refresh the catalog\n"
+          "       %s <catalog> -m <substring>     dumps referencing a "
+          "module\n"
+          "       %s <catalog> -c <substring>     dumps crashing with a "
+          "signature or in a module\n",
+          program_name, program_name, program_name);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3 && argc != 4) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  string catalog_path = argv[1];
+  Catalog catalog;
+  if (!LoadCatalog(catalog_path, &catalog)) {
+    return 1;
+  }
+
+  if (argc == 4 && strcmp(argv[2], "-m") == 0) {
+    int matched = PrintMatches(catalog, MatchesModule(argv[3]));
+    printf("dump_indexer: %d of %d dumps match\n",
+           matched, static_cast<int>(catalog.size()));
+    return 0;
+  }
+  if (argc == 4 && strcmp(argv[2], "-c") == 0) {
+    int matched = PrintMatches(catalog, MatchesCrash(argv[3]));
+    printf("dump_indexer: %d of %d dumps match\n",
+           matched, static_cast<int>(catalog.size()));
+    return 0;
+  }
+  if (argc != 3) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  if (!RefreshCatalog(argv[2], &catalog)) {
+    return 1;
+  }
+  return WriteCatalog(catalog_path, catalog) ? 0 : 1;
+}
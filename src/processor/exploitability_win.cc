@@ -69,6 +69,10 @@ static const size_t kHugeBump          = 90;
 // The maximum number of bytes to disassemble past the program counter.
 static const size_t kDisassembleBytesBeyondPC = 2048;
 
+// The number of instructions decoded per batch when scanning the code
+// beyond the faulting instruction.
+static const uint32_t kDisassembleBatchSize = 64;
+
 ExploitabilityWin::ExploitabilityWin(Minidump *dump,
                                      ProcessState *process_state)
     : Exploitability(dump, process_state) { }
@@ -241,11 +245,13 @@ ExploitabilityRating ExploitabilityWin::CheckPlatformExploitability() {
                 default:
                   break;
               }
-              // Loop the disassembler through the code and check if it
-              // IDed any interesting conditions in the near future.
-              // Multiple flags may be set so treat each equally.
-              while (disassembler.NextInstruction() &&
-                     disassembler.currentInstructionValid() &&
+              // Run the disassembler through the code in batches and
+              // check if it IDed any interesting conditions in the near
+              // future.  Multiple flags may be set so treat each equally.
+              libdis::x86_insn_t decoded[kDisassembleBatchSize];
+              while (disassembler.DisassembleWindow(
+                         decoded, kDisassembleBatchSize) ==
+                         kDisassembleBatchSize &&
                      !disassembler.endOfBlock())
                 continue;
               if (disassembler.flags() & DISX86_BAD_BRANCH_TARGET)
@@ -46,7 +46,9 @@
 
 #include "common/scoped_ptr.h"
 #include "common/using_std_string.h"
+#include "processor/logging.h"
 #include "processor/module_factory.h"
+#include "processor/serialized_module_format.h"
 
 using std::map;
 using std::make_pair;
@@ -60,6 +62,22 @@ bool FastSourceLineResolver::ShouldDeleteMemoryBufferAfterLoadModule() {
   return false;
 }
 
+bool FastSourceLineResolver::LoadModuleFromContainer(const CodeModule *module,
+                                                     const char *data,
+                                                     size_t size) {
+  const char *payload = NULL;
+  size_t payload_size = 0;
+  if (!ValidateSerializedModule(data, size, &payload, &payload_size)) {
+    BPLOG(ERROR) << "Invalid serialized module container for "
+                 << (module ? module->code_file() : "unknown module");
+    return false;
+  }
+  // LoadModuleUsingMapBuffer copies the payload into a buffer that this
+  // resolver owns for the module's lifetime; the container may go away.
+  string map_buffer(payload, payload_size);
+  return LoadModuleUsingMapBuffer(module, map_buffer);
+}
+
 void FastSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
   MemAddr address = frame->instruction - frame->module->base_address();
 
@@ -81,7 +99,7 @@ void FastSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
                                       &function_base, &function_size) &&
       address >= function_base && address - function_base < function_size) {
     func.get()->CopyFrom(func_ptr);
-    frame->function_name = func->name;
+    frame->SetFunctionName(func->name);
     frame->function_base = frame->module->base_address() + function_base;
 
     scoped_ptr<Line> line(new Line);
@@ -91,8 +109,8 @@ void FastSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
       line.get()->CopyFrom(line_ptr);
       FileMap::iterator it = files_.find(line->source_file_id);
       if (it != files_.end()) {
-        frame->source_file_name =
-            files_.find(line->source_file_id).GetValuePtr();
+        frame->SetSourceFileName(
+            files_.find(line->source_file_id).GetValuePtr());
       }
       frame->source_line = line->line;
       frame->source_line_base = frame->module->base_address() + line_base;
@@ -101,7 +119,7 @@ void FastSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
                                       public_symbol_ptr, &public_address) &&
              (!func_ptr || public_address > function_base)) {
     public_symbol.get()->CopyFrom(public_symbol_ptr);
-    frame->function_name = public_symbol->name;
+    frame->SetFunctionName(public_symbol->name);
     frame->function_base = frame->module->base_address() + public_address;
   }
 }
@@ -178,10 +196,10 @@ bool FastSourceLineResolver::Module::LoadMapFromMemory(char *mem_buffer) {
   return true;
 }
 
-WindowsFrameInfo *FastSourceLineResolver::Module::FindWindowsFrameInfo(
-    const StackFrame *frame) const {
+bool FastSourceLineResolver::Module::FindWindowsFrameInfo(
+    const StackFrame *frame, WindowsFrameInfo *result) const {
   MemAddr address = frame->instruction - frame->module->base_address();
-  scoped_ptr<WindowsFrameInfo> result(new WindowsFrameInfo());
+  result->Clear();
 
   // We only know about WindowsFrameInfo::STACK_INFO_FRAME_DATA and
   // WindowsFrameInfo::STACK_INFO_FPO. Prefer them in this order.
@@ -195,7 +213,7 @@ WindowsFrameInfo *FastSourceLineResolver::Module::FindWindowsFrameInfo(
       || (windows_frame_info_[WindowsFrameInfo::STACK_INFO_FPO]
           .RetrieveRange(address, frame_info_ptr))) {
     result->CopyFrom(CopyWFI(frame_info_ptr));
-    return result.release();
+    return true;
   }
 
   // Even without a relevant STACK line, many functions contain
@@ -205,34 +223,34 @@ WindowsFrameInfo *FastSourceLineResolver::Module::FindWindowsFrameInfo(
   // below. However, this does mean we need to check that ADDRESS
   // falls within the retrieved function's range; do the range
   // comparison in an overflow-friendly way.
-  scoped_ptr<Function> function(new Function);
+  Function function;
   const Function* function_ptr = 0;
   MemAddr function_base, function_size;
   if (functions_.RetrieveNearestRange(address, function_ptr,
                                       &function_base, &function_size) &&
       address >= function_base && address - function_base < function_size) {
-    function.get()->CopyFrom(function_ptr);
-    result->parameter_size = function->parameter_size;
+    function.CopyFrom(function_ptr);
+    result->parameter_size = function.parameter_size;
     result->valid |= WindowsFrameInfo::VALID_PARAMETER_SIZE;
-    return result.release();
+    return true;
   }
 
   // PUBLIC symbols might have a parameter size. Use the function we
   // found above to limit the range the public symbol covers.
-  scoped_ptr<PublicSymbol> public_symbol(new PublicSymbol);
+  PublicSymbol public_symbol;
   const PublicSymbol* public_symbol_ptr = 0;
   MemAddr public_address;
   if (public_symbols_.Retrieve(address, public_symbol_ptr, &public_address) &&
       (!function_ptr || public_address > function_base)) {
-    public_symbol.get()->CopyFrom(public_symbol_ptr);
-    result->parameter_size = public_symbol->parameter_size;
+    public_symbol.CopyFrom(public_symbol_ptr);
+    result->parameter_size = public_symbol.parameter_size;
   }
 
-  return NULL;
+  return false;
 }
 
-CFIFrameInfo *FastSourceLineResolver::Module::FindCFIFrameInfo(
-    const StackFrame *frame) const {
+bool FastSourceLineResolver::Module::FindCFIFrameInfo(
+    const StackFrame *frame, CFIFrameInfo *rules) const {
   MemAddr address = frame->instruction - frame->module->base_address();
   MemAddr initial_base, initial_size;
   const char* initial_rules = NULL;
@@ -243,14 +261,14 @@ CFIFrameInfo *FastSourceLineResolver::Module::FindCFIFrameInfo(
   // instruction address, applying delta rules.
   if (!cfi_initial_rules_.RetrieveRange(address, initial_rules,
                                         &initial_base, &initial_size)) {
-    return NULL;
+    return false;
   }
 
-  // Create a frame info structure, and populate it with the rules from
-  // the STACK CFI INIT record.
-  scoped_ptr<CFIFrameInfo> rules(new CFIFrameInfo());
-  if (!ParseCFIRuleSet(initial_rules, rules.get()))
-    return NULL;
+  // Populate the caller's frame info structure with the rules from the
+  // STACK CFI INIT record, dropping whatever an earlier lookup left in it.
+  rules->Clear();
+  if (!ParseCFIRuleSet(initial_rules, rules))
+    return false;
 
   // Find the first delta rule that falls within the initial rule's range.
   StaticMap<MemAddr, char>::iterator delta =
@@ -258,11 +276,11 @@ CFIFrameInfo *FastSourceLineResolver::Module::FindCFIFrameInfo(
 
   // Apply delta rules up to and including the frame's address.
   while (delta != cfi_delta_rules_.end() && delta.GetKey() <= address) {
-    ParseCFIRuleSet(delta.GetValuePtr(), rules.get());
+    ParseCFIRuleSet(delta.GetValuePtr(), rules);
     delta++;
   }
 
-  return rules.release();
+  return true;
 }
 
 }  // namespace google_breakpad
@@ -123,17 +123,17 @@ class FastSourceLineResolver::Module: public SourceLineResolverBase::Module {
   virtual bool LoadMapFromMemory(char *memory_buffer);
 
   // If Windows stack walking information is available covering ADDRESS,
-  // return a WindowsFrameInfo structure describing it. If the information
-  // is not available, returns NULL. A NULL return value does not indicate
-  // an error. The caller takes ownership of any returned WindowsFrameInfo
-  // object.
-  virtual WindowsFrameInfo *FindWindowsFrameInfo(const StackFrame *frame) const;
+  // fill the caller-provided *frame_info with it and return true. If
+  // the information is not available, return false; a false return
+  // does not indicate an error.
+  virtual bool FindWindowsFrameInfo(const StackFrame *frame,
+                                    WindowsFrameInfo *frame_info) const;
 
   // If CFI stack walking information is available covering ADDRESS,
-  // return a CFIFrameInfo structure describing it. If the information
-  // is not available, return NULL. The caller takes ownership of any
-  // returned CFIFrameInfo object.
-  virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) const;
+  // fill the caller-provided *frame_info with it and return true. If
+  // the information is not available, return false.
+  virtual bool FindCFIFrameInfo(const StackFrame *frame,
+                                CFIFrameInfo *frame_info) const;
 
   // Number of serialized map components of Module.
   static const int kNumberMaps_ = 5 + WindowsFrameInfo::STACK_INFO_LAST;
@@ -152,17 +152,17 @@ static bool VerifyRegisters(
 }
 
 static bool VerifyEmpty(const StackFrame &frame) {
-  if (frame.function_name.empty() &&
-      frame.source_file_name.empty() &&
+  if ((!frame.function_name || frame.function_name->empty()) &&
+      (!frame.source_file_name || frame.source_file_name->empty()) &&
       frame.source_line == 0)
     return true;
   return false;
 }
 
 static void ClearSourceLineInfo(StackFrame *frame) {
-  frame->function_name.clear();
+  frame->function_name = NULL;
   frame->module = NULL;
-  frame->source_file_name.clear();
+  frame->source_file_name = NULL;
   frame->source_line = 0;
 }
 
@@ -206,31 +206,32 @@ TEST_F(TestFastSourceLineResolver, TestLoadAndResolve) {
   ASSERT_TRUE(fast_resolver.HasModule(&module2));
 
   StackFrame frame;
-  scoped_ptr<WindowsFrameInfo> windows_frame_info;
-  scoped_ptr<CFIFrameInfo> cfi_frame_info;
+  WindowsFrameInfo windows_frame_info;
+  CFIFrameInfo cfi_frame_info;
   frame.instruction = 0x1000;
   frame.module = NULL;
   fast_resolver.FillSourceLineInfo(&frame);
   ASSERT_FALSE(frame.module);
-  ASSERT_TRUE(frame.function_name.empty());
+  ASSERT_TRUE(!frame.function_name || frame.function_name->empty());
   ASSERT_EQ(frame.function_base, 0U);
-  ASSERT_TRUE(frame.source_file_name.empty());
+  ASSERT_TRUE(!frame.source_file_name || frame.source_file_name->empty());
   ASSERT_EQ(frame.source_line, 0);
   ASSERT_EQ(frame.source_line_base, 0U);
 
   frame.module = &module1;
   fast_resolver.FillSourceLineInfo(&frame);
-  ASSERT_EQ(frame.function_name, "Function1_1");
+  ASSERT_TRUE(frame.function_name);
+  ASSERT_EQ(*frame.function_name, "Function1_1");
   ASSERT_TRUE(frame.module);
   ASSERT_EQ(frame.module->code_file(), "module1");
   ASSERT_EQ(frame.function_base, 0x1000U);
-  ASSERT_EQ(frame.source_file_name, "file1_1.cc");
+  ASSERT_TRUE(frame.source_file_name);
+  ASSERT_EQ(*frame.source_file_name, "file1_1.cc");
   ASSERT_EQ(frame.source_line, 44);
   ASSERT_EQ(frame.source_line_base, 0x1000U);
-  windows_frame_info.reset(fast_resolver.FindWindowsFrameInfo(&frame));
-  ASSERT_TRUE(windows_frame_info.get());
-  ASSERT_FALSE(windows_frame_info->allocates_base_pointer);
-  ASSERT_EQ(windows_frame_info->program_string,
+  ASSERT_TRUE(fast_resolver.FindWindowsFrameInfo(&frame, &windows_frame_info));
+  ASSERT_FALSE(windows_frame_info.allocates_base_pointer);
+  ASSERT_EQ(windows_frame_info.program_string,
             "$eip 4 + ^ = $esp $ebp 8 + = $ebp $ebp ^ =");
 
   ClearSourceLineInfo(&frame);
@@ -238,47 +239,43 @@ TEST_F(TestFastSourceLineResolver, TestLoadAndResolve) {
   frame.module = &module1;
   fast_resolver.FillSourceLineInfo(&frame);
   ASSERT_TRUE(VerifyEmpty(frame));
-  windows_frame_info.reset(fast_resolver.FindWindowsFrameInfo(&frame));
-  ASSERT_FALSE(windows_frame_info.get());
+  ASSERT_FALSE(fast_resolver.FindWindowsFrameInfo(&frame, &windows_frame_info));
 
   frame.instruction = 0x1280;
   fast_resolver.FillSourceLineInfo(&frame);
-  ASSERT_EQ(frame.function_name, "Function1_3");
-  ASSERT_TRUE(frame.source_file_name.empty());
+  ASSERT_TRUE(frame.function_name);
+  ASSERT_EQ(*frame.function_name, "Function1_3");
+  ASSERT_TRUE(!frame.source_file_name || frame.source_file_name->empty());
   ASSERT_EQ(frame.source_line, 0);
-  windows_frame_info.reset(fast_resolver.FindWindowsFrameInfo(&frame));
-  ASSERT_TRUE(windows_frame_info.get());
-  ASSERT_EQ(windows_frame_info->type_, WindowsFrameInfo::STACK_INFO_UNKNOWN);
-  ASSERT_FALSE(windows_frame_info->allocates_base_pointer);
-  ASSERT_TRUE(windows_frame_info->program_string.empty());
+  ASSERT_TRUE(fast_resolver.FindWindowsFrameInfo(&frame, &windows_frame_info));
+  ASSERT_EQ(windows_frame_info.type_, WindowsFrameInfo::STACK_INFO_UNKNOWN);
+  ASSERT_FALSE(windows_frame_info.allocates_base_pointer);
+  ASSERT_TRUE(windows_frame_info.program_string.empty());
 
   frame.instruction = 0x1380;
   fast_resolver.FillSourceLineInfo(&frame);
-  ASSERT_EQ(frame.function_name, "Function1_4");
-  ASSERT_TRUE(frame.source_file_name.empty());
+  ASSERT_TRUE(frame.function_name);
+  ASSERT_EQ(*frame.function_name, "Function1_4");
+  ASSERT_TRUE(!frame.source_file_name || frame.source_file_name->empty());
   ASSERT_EQ(frame.source_line, 0);
-  windows_frame_info.reset(fast_resolver.FindWindowsFrameInfo(&frame));
-  ASSERT_TRUE(windows_frame_info.get());
-  ASSERT_EQ(windows_frame_info->type_, WindowsFrameInfo::STACK_INFO_FRAME_DATA);
-  ASSERT_FALSE(windows_frame_info->allocates_base_pointer);
-  ASSERT_FALSE(windows_frame_info->program_string.empty());
+  ASSERT_TRUE(fast_resolver.FindWindowsFrameInfo(&frame, &windows_frame_info));
+  ASSERT_EQ(windows_frame_info.type_, WindowsFrameInfo::STACK_INFO_FRAME_DATA);
+  ASSERT_FALSE(windows_frame_info.allocates_base_pointer);
+  ASSERT_FALSE(windows_frame_info.program_string.empty());
 
   frame.instruction = 0x2000;
-  windows_frame_info.reset(fast_resolver.FindWindowsFrameInfo(&frame));
-  ASSERT_FALSE(windows_frame_info.get());
+  ASSERT_FALSE(fast_resolver.FindWindowsFrameInfo(&frame, &windows_frame_info));
 
   // module1 has STACK CFI records covering 3d40..3def;
   // module2 has STACK CFI records covering 3df0..3e9f;
   // check that FindCFIFrameInfo doesn't claim to find any outside those ranges.
   frame.instruction = 0x3d3f;
   frame.module = &module1;
-  cfi_frame_info.reset(fast_resolver.FindCFIFrameInfo(&frame));
-  ASSERT_FALSE(cfi_frame_info.get());
+  ASSERT_FALSE(fast_resolver.FindCFIFrameInfo(&frame, &cfi_frame_info));
 
   frame.instruction = 0x3e9f;
   frame.module = &module1;
-  cfi_frame_info.reset(fast_resolver.FindCFIFrameInfo(&frame));
-  ASSERT_FALSE(cfi_frame_info.get());
+  ASSERT_FALSE(fast_resolver.FindCFIFrameInfo(&frame, &cfi_frame_info));
 
   CFIFrameInfo::RegisterValueMap<uint32_t> current_registers;
   CFIFrameInfo::RegisterValueMap<uint32_t> caller_registers;
@@ -302,103 +299,96 @@ TEST_F(TestFastSourceLineResolver, TestLoadAndResolve) {
   current_registers["$ebx"] = 0x98ecadc3;
   current_registers["$esi"] = 0x878f7524;
   current_registers["$edi"] = 0x6312f9a5;
-  cfi_frame_info.reset(fast_resolver.FindCFIFrameInfo(&frame));
-  ASSERT_TRUE(cfi_frame_info.get());
-  ASSERT_TRUE(cfi_frame_info.get()
-              ->FindCallerRegs<uint32_t>(current_registers, memory,
-                                          &caller_registers));
+  ASSERT_TRUE(fast_resolver.FindCFIFrameInfo(&frame, &cfi_frame_info));
+  ASSERT_TRUE(cfi_frame_info.FindCallerRegs<uint32_t>(current_registers, memory,
+                                                      &caller_registers));
   ASSERT_TRUE(VerifyRegisters(__FILE__, __LINE__,
                               expected_caller_registers, caller_registers));
 
   frame.instruction = 0x3d41;
   current_registers["$esp"] = 0x10014;
-  cfi_frame_info.reset(fast_resolver.FindCFIFrameInfo(&frame));
-  ASSERT_TRUE(cfi_frame_info.get());
-  ASSERT_TRUE(cfi_frame_info.get()
-              ->FindCallerRegs<uint32_t>(current_registers, memory,
-                                          &caller_registers));
+  ASSERT_TRUE(fast_resolver.FindCFIFrameInfo(&frame, &cfi_frame_info));
+  ASSERT_TRUE(cfi_frame_info.FindCallerRegs<uint32_t>(current_registers, memory,
+                                                      &caller_registers));
   ASSERT_TRUE(VerifyRegisters(__FILE__, __LINE__,
                               expected_caller_registers, caller_registers));
 
   frame.instruction = 0x3d43;
   current_registers["$ebp"] = 0x10014;
-  cfi_frame_info.reset(fast_resolver.FindCFIFrameInfo(&frame));
-  ASSERT_TRUE(cfi_frame_info.get());
-  ASSERT_TRUE(cfi_frame_info.get()
-              ->FindCallerRegs<uint32_t>(current_registers, memory,
-                                          &caller_registers));
+  ASSERT_TRUE(fast_resolver.FindCFIFrameInfo(&frame, &cfi_frame_info));
+  ASSERT_TRUE(cfi_frame_info.FindCallerRegs<uint32_t>(current_registers, memory,
+                                                      &caller_registers));
   VerifyRegisters(__FILE__, __LINE__,
                   expected_caller_registers, caller_registers);
 
   frame.instruction = 0x3d54;
   current_registers["$ebx"] = 0x6864f054U;
-  cfi_frame_info.reset(fast_resolver.FindCFIFrameInfo(&frame));
-  ASSERT_TRUE(cfi_frame_info.get());
-  ASSERT_TRUE(cfi_frame_info.get()
-              ->FindCallerRegs<uint32_t>(current_registers, memory,
-                                          &caller_registers));
+  ASSERT_TRUE(fast_resolver.FindCFIFrameInfo(&frame, &cfi_frame_info));
+  ASSERT_TRUE(cfi_frame_info.FindCallerRegs<uint32_t>(current_registers, memory,
+                                                      &caller_registers));
   VerifyRegisters(__FILE__, __LINE__,
                   expected_caller_registers, caller_registers);
 
   frame.instruction = 0x3d5a;
   current_registers["$esi"] = 0x6285f79aU;
-  cfi_frame_info.reset(fast_resolver.FindCFIFrameInfo(&frame));
-  ASSERT_TRUE(cfi_frame_info.get());
-  ASSERT_TRUE(cfi_frame_info.get()
-              ->FindCallerRegs<uint32_t>(current_registers, memory,
-                                          &caller_registers));
+  ASSERT_TRUE(fast_resolver.FindCFIFrameInfo(&frame, &cfi_frame_info));
+  ASSERT_TRUE(cfi_frame_info.FindCallerRegs<uint32_t>(current_registers, memory,
+                                                      &caller_registers));
   VerifyRegisters(__FILE__, __LINE__,
                   expected_caller_registers, caller_registers);
 
   frame.instruction = 0x3d84;
   current_registers["$edi"] = 0x64061449U;
-  cfi_frame_info.reset(fast_resolver.FindCFIFrameInfo(&frame));
-  ASSERT_TRUE(cfi_frame_info.get());
-  ASSERT_TRUE(cfi_frame_info.get()
-              ->FindCallerRegs<uint32_t>(current_registers, memory,
-                                          &caller_registers));
+  ASSERT_TRUE(fast_resolver.FindCFIFrameInfo(&frame, &cfi_frame_info));
+  ASSERT_TRUE(cfi_frame_info.FindCallerRegs<uint32_t>(current_registers, memory,
+                                                      &caller_registers));
   VerifyRegisters(__FILE__, __LINE__,
                   expected_caller_registers, caller_registers);
 
   frame.instruction = 0x2900;
   frame.module = &module1;
   fast_resolver.FillSourceLineInfo(&frame);
-  ASSERT_EQ(frame.function_name, string("PublicSymbol"));
+  ASSERT_TRUE(frame.function_name);
+  ASSERT_EQ(*frame.function_name, string("PublicSymbol"));
 
   frame.instruction = 0x4000;
   frame.module = &module1;
   fast_resolver.FillSourceLineInfo(&frame);
-  ASSERT_EQ(frame.function_name, string("LargeFunction"));
+  ASSERT_TRUE(frame.function_name);
+  ASSERT_EQ(*frame.function_name, string("LargeFunction"));
 
   frame.instruction = 0x2181;
   frame.module = &module2;
   fast_resolver.FillSourceLineInfo(&frame);
-  ASSERT_EQ(frame.function_name, "Function2_2");
+  ASSERT_TRUE(frame.function_name);
+  ASSERT_EQ(*frame.function_name, "Function2_2");
   ASSERT_EQ(frame.function_base, 0x2170U);
   ASSERT_TRUE(frame.module);
   ASSERT_EQ(frame.module->code_file(), "module2");
-  ASSERT_EQ(frame.source_file_name, "file2_2.cc");
+  ASSERT_TRUE(frame.source_file_name);
+  ASSERT_EQ(*frame.source_file_name, "file2_2.cc");
   ASSERT_EQ(frame.source_line, 21);
   ASSERT_EQ(frame.source_line_base, 0x2180U);
-  windows_frame_info.reset(fast_resolver.FindWindowsFrameInfo(&frame));
-  ASSERT_TRUE(windows_frame_info.get());
-  ASSERT_EQ(windows_frame_info->type_, WindowsFrameInfo::STACK_INFO_FRAME_DATA);
-  ASSERT_EQ(windows_frame_info->prolog_size, 1U);
+  ASSERT_TRUE(fast_resolver.FindWindowsFrameInfo(&frame, &windows_frame_info));
+  ASSERT_EQ(windows_frame_info.type_, WindowsFrameInfo::STACK_INFO_FRAME_DATA);
+  ASSERT_EQ(windows_frame_info.prolog_size, 1U);
 
   frame.instruction = 0x216f;
   fast_resolver.FillSourceLineInfo(&frame);
-  ASSERT_EQ(frame.function_name, "Public2_1");
+  ASSERT_TRUE(frame.function_name);
+  ASSERT_EQ(*frame.function_name, "Public2_1");
 
   ClearSourceLineInfo(&frame);
   frame.instruction = 0x219f;
   frame.module = &module2;
   fast_resolver.FillSourceLineInfo(&frame);
-  ASSERT_TRUE(frame.function_name.empty());
+  ASSERT_TRUE(!frame.function_name || frame.function_name->empty());
 
   frame.instruction = 0x21a0;
   frame.module = &module2;
   fast_resolver.FillSourceLineInfo(&frame);
-  ASSERT_EQ(frame.function_name, "Public2_2");
+  ASSERT_TRUE(frame.function_name);
+  ASSERT_EQ(*frame.function_name, "Public2_2");
 }
 
 TEST_F(TestFastSourceLineResolver, TestInvalidLoads) {
@@ -0,0 +1,128 @@
+// Copyright (c) 2010 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// frame_chain_walker.h: Shared frame-pointer chain chasing for
+// architectures whose ABI links stack frames through a saved frame
+// base, with the return address at a fixed offset within the caller's
+// frame (ppc, sparc).  Centralizes the stack-bounds and bogus-address
+// validation the per-architecture walkers used to duplicate, fetches
+// the words of a link back to back so their cache misses overlap, and
+// issues a software prefetch for the following link so its dependent
+// load is already in flight by the time the next GetCallerFrame call
+// chases it.  On deep stacks the walk is bounded by these dependent
+// loads, one serialized miss per frame without the prefetch.
+
+#ifndef PROCESSOR_FRAME_CHAIN_WALKER_H__
+#define PROCESSOR_FRAME_CHAIN_WALKER_H__
+
+#include "google_breakpad/processor/memory_region.h"
+
+// Touches the cache line holding the word at |address| ahead of its use.
+#if defined(__GNUC__) || defined(__clang__)
+#define FRAME_CHAIN_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define FRAME_CHAIN_PREFETCH(address)
+#endif
+
+namespace google_breakpad {
+
+// WordType is the width of a stack word on the target architecture.
+template <typename WordType>
+class FrameChainWalker {
+ public:
+  explicit FrameChainWalker(MemoryRegion* memory) : memory_(memory) {}
+
+  // Chases one link of the frame chain.  |caller_frame_base| is the
+  // candidate base of the caller's frame and |callee_frame_base| the
+  // base of the frame below it; a caller frame must reside higher in
+  // memory than its callee frame, and anything else is an error or an
+  // indication that the end of the stack has been reached.
+  // |return_address_offset| locates the saved return address within the
+  // caller's frame and |next_link_offset| the word naming the following
+  // link of the chain (the frame base the next step will chase).
+  //
+  // On success, stores the saved return address in |*return_address|
+  // and the following link in |*next_link| (0 if that word could not be
+  // read), and returns true.  Returns false at the end of the chain:
+  // when the caller frame does not lie above its callee, or when the
+  // return address is unreadable, 0 or 1.  Mac OS X/Darwin gives 1 as
+  // the return address from the bottom-most frame in a stack (a
+  // thread's entry point); 0 or 1 would be bogus return addresses
+  // generally, so treating them as the end of the stack avoids a
+  // phantom frame.
+  bool ReadLink(uint64_t caller_frame_base,
+                uint64_t callee_frame_base,
+                uint64_t return_address_offset,
+                uint64_t next_link_offset,
+                WordType* return_address,
+                WordType* next_link) {
+    if (caller_frame_base <= callee_frame_base)
+      return false;
+
+    // Both words depend on the same just-computed frame base, so fetch
+    // them back to back: the second load overlaps the first's cache
+    // miss instead of waiting behind frame construction.
+    if (!memory_->GetMemoryAtAddress(
+            caller_frame_base + return_address_offset, return_address)) {
+      return false;
+    }
+    if (!memory_->GetMemoryAtAddress(caller_frame_base + next_link_offset,
+                                     next_link)) {
+      *next_link = 0;
+    }
+
+    if (*return_address <= 1)
+      return false;
+
+    // The words of the following link will be chased by the next step
+    // of the walk; start pulling their cache line in now, when the
+    // backing region can expose its bytes directly.  The untrusted
+    // *next_link value is only prefetched, never dereferenced, so a
+    // garbage link costs at most a wasted prefetch.
+    if (*next_link > caller_frame_base) {
+      uint64_t low = return_address_offset < next_link_offset ?
+          return_address_offset : next_link_offset;
+      uint64_t high = (return_address_offset > next_link_offset ?
+          return_address_offset : next_link_offset) + sizeof(WordType);
+      const uint8_t* bytes = memory_->GetMemorySpan(
+          *next_link + low, static_cast<size_t>(high - low));
+      if (bytes)
+        FRAME_CHAIN_PREFETCH(bytes);
+    }
+
+    return true;
+  }
+
+ private:
+  MemoryRegion* memory_;
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_FRAME_CHAIN_WALKER_H__
@@ -0,0 +1,518 @@
+// Copyright (c) 2010, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// http_symbol_supplier.cc: A SymbolSupplier that fetches symbol files
+// from an HTTP(S) symbol server into a local disk cache.
+//
+// See http_symbol_supplier.h for documentation.
+
+#include "processor/http_symbol_supplier.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "processor/logging.h"
+#ifndef _WIN32
+#include "third_party/curl/curl.h"
+#endif
+
+namespace google_breakpad {
+
+using std::vector;
+
+#ifndef _WIN32
+
+// The dlopened libcurl, along with the entry points the downloader
+// uses.  Mirrors the loader in common/linux/http_upload.cc; the
+// processor cannot use that one directly because it lives in the
+// Linux client library.
+struct HTTPSymbolSupplier::CurlLib {
+  void *handle;
+  CURLcode (*global_init)(long);
+  CURL *(*easy_init)(void);
+  CURLcode (*easy_setopt)(CURL *, CURLoption, ...);
+  CURLcode (*easy_perform)(CURL *);
+  CURLcode (*easy_getinfo)(CURL *, CURLINFO, ...);
+  const char *(*easy_strerror)(CURLcode);
+  void (*easy_cleanup)(CURL *);
+};
+
+namespace {
+
+// Callback streaming response data into the temporary cache file, so a
+// large symbol file is never held in memory whole.
+size_t WriteToFileCallback(void *ptr, size_t size, size_t nmemb,
+                           void *userp) {
+  if (!userp)
+    return 0;
+  return fwrite(ptr, size, nmemb, static_cast<FILE *>(userp));
+}
+
+// Creates every directory along path (a directory, not a file) that
+// does not already exist.  Returns false if a component cannot be
+// created.
+bool MakeDirectories(const string &path) {
+  for (string::size_type slash = path.find('/', 1);
+       ;
+       slash = path.find('/', slash + 1)) {
+    string component =
+        slash == string::npos ? path : path.substr(0, slash);
+    if (!component.empty() &&
+        mkdir(component.c_str(), 0755) != 0 && errno != EEXIST) {
+      BPLOG(ERROR) << "Could not create directory " << component;
+      return false;
+    }
+    if (slash == string::npos)
+      break;
+  }
+  return true;
+}
+
+// One cached file, as collected by CollectCacheFiles.
+struct CacheFile {
+  time_t mtime;
+  uint64_t size;
+  string path;
+
+  bool operator<(const CacheFile &other) const {
+    return mtime < other.mtime;
+  }
+};
+
+// Symbol caches are debug_file/identifier/name.sym; allow a little
+// slack beyond that before giving up on a wild directory tree.
+const int kMaxCacheDepth = 8;
+
+// Adds every regular file under directory to files, recursing at most
+// kMaxCacheDepth levels, and accumulates their sizes in total_size.
+void CollectCacheFiles(const string &directory,
+                       int depth,
+                       vector<CacheFile> *files,
+                       uint64_t *total_size) {
+  DIR *dir = opendir(directory.c_str());
+  if (!dir) {
+    return;
+  }
+
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+    string path = directory + "/" + entry->d_name;
+    struct stat sb;
+    if (stat(path.c_str(), &sb) != 0) {
+      continue;
+    }
+    if (S_ISDIR(sb.st_mode)) {
+      if (depth < kMaxCacheDepth) {
+        CollectCacheFiles(path, depth + 1, files, total_size);
+      }
+    } else if (S_ISREG(sb.st_mode)) {
+      CacheFile file;
+      file.mtime = sb.st_mtime;
+      file.size = sb.st_size;
+      file.path = path;
+      files->push_back(file);
+      *total_size += file.size;
+    }
+  }
+
+  closedir(dir);
+}
+
+}  // namespace
+
+#endif  // _WIN32
+
+HTTPSymbolSupplier::HTTPSymbolSupplier(const string &server_url,
+                                       const string &cache_path)
+    : SimpleSymbolSupplier(cache_path),
+      server_url_(server_url),
+      cache_path_(cache_path),
+      max_cache_size_(kDefaultMaxCacheSizeBytes),
+      revalidate_ttl_(kDefaultRevalidateTtlSeconds),
+      download_miss_ttl_(kDefaultDownloadMissTtlSeconds),
+      curl_(NULL),
+      curl_load_failed_(false) {
+  // The store-layout paths built below begin with a slash.
+  while (!server_url_.empty() &&
+         server_url_[server_url_.size() - 1] == '/') {
+    server_url_.erase(server_url_.size() - 1);
+  }
+#ifndef _WIN32
+  pthread_mutex_init(&http_lock_, NULL);
+  pthread_cond_init(&download_done_cond_, NULL);
+  MakeDirectories(cache_path_);
+#endif
+}
+
+HTTPSymbolSupplier::~HTTPSymbolSupplier() {
+  // Join the prefetch workers while this object is still an
+  // HTTPSymbolSupplier; they call the GetSymbolFile override and use
+  // the state torn down below.
+  FinishPrefetch();
+#ifndef _WIN32
+  if (curl_) {
+    dlclose(curl_->handle);
+    delete curl_;
+  }
+  pthread_cond_destroy(&download_done_cond_);
+  pthread_mutex_destroy(&http_lock_);
+#endif
+}
+
+#ifndef _WIN32
+
+bool HTTPSymbolSupplier::EnsureCurlLoaded() {
+  pthread_mutex_lock(&http_lock_);
+  if (curl_) {
+    pthread_mutex_unlock(&http_lock_);
+    return true;
+  }
+  if (curl_load_failed_) {
+    pthread_mutex_unlock(&http_lock_);
+    return false;
+  }
+
+  void *handle = dlopen("libcurl.so", RTLD_NOW);
+  if (!handle)
+    handle = dlopen("libcurl.so.4", RTLD_NOW);
+  if (!handle) {
+    // Debian gives libcurl a different name when it is built against GnuTLS
+    // instead of OpenSSL.
+    handle = dlopen("libcurl-gnutls.so.4", RTLD_NOW);
+  }
+  if (!handle)
+    handle = dlopen("libcurl.so.3", RTLD_NOW);
+  if (!handle) {
+    BPLOG(ERROR) << "Could not load libcurl; HTTPSymbolSupplier will only "
+                    "serve symbols already cached under " << cache_path_;
+    curl_load_failed_ = true;
+    pthread_mutex_unlock(&http_lock_);
+    return false;
+  }
+
+  CurlLib *lib = new CurlLib;
+  lib->handle = handle;
+  *(void**) (&lib->global_init) = dlsym(handle, "curl_global_init");
+  *(void**) (&lib->easy_init) = dlsym(handle, "curl_easy_init");
+  *(void**) (&lib->easy_setopt) = dlsym(handle, "curl_easy_setopt");
+  *(void**) (&lib->easy_perform) = dlsym(handle, "curl_easy_perform");
+  *(void**) (&lib->easy_getinfo) = dlsym(handle, "curl_easy_getinfo");
+  *(void**) (&lib->easy_strerror) = dlsym(handle, "curl_easy_strerror");
+  *(void**) (&lib->easy_cleanup) = dlsym(handle, "curl_easy_cleanup");
+
+  if (!lib->easy_init || !lib->easy_setopt ||
+      !lib->easy_perform || !lib->easy_cleanup) {
+    dlclose(handle);
+    delete lib;
+    curl_load_failed_ = true;
+    pthread_mutex_unlock(&http_lock_);
+    return false;
+  }
+
+  // curl_easy_init would do this lazily, but the global setup is not
+  // thread safe, and downloads run on the prefetch workers; do it once
+  // here, under the lock, before any worker can reach easy_perform.
+  if (lib->global_init)
+    (*lib->global_init)(CURL_GLOBAL_ALL);
+
+  curl_ = lib;
+  pthread_mutex_unlock(&http_lock_);
+  return true;
+}
+
+bool HTTPSymbolSupplier::DownloadToCache(const string &url,
+                                         const string &cache_file,
+                                         time_t if_modified_since,
+                                         bool *not_modified) {
+  *not_modified = false;
+  if (!EnsureCurlLoaded())
+    return false;
+
+  string::size_type slash = cache_file.rfind('/');
+  if (slash != string::npos &&
+      !MakeDirectories(cache_file.substr(0, slash))) {
+    return false;
+  }
+
+  // Download beside the destination and rename into place, so another
+  // processor sharing the cache never reads a partial file.
+  string temp_template = cache_file + ".tmp.XXXXXX";
+  vector<char> temp_path(temp_template.begin(), temp_template.end());
+  temp_path.push_back('\0');
+  int temp_fd = mkstemp(&temp_path[0]);
+  if (temp_fd == -1) {
+    BPLOG(ERROR) << "Could not create temporary file near " << cache_file;
+    return false;
+  }
+  FILE *temp_file = fdopen(temp_fd, "wb");
+  if (!temp_file) {
+    close(temp_fd);
+    remove(&temp_path[0]);
+    return false;
+  }
+
+  CURL *curl = (*curl_->easy_init)();
+  if (!curl) {
+    fclose(temp_file);
+    remove(&temp_path[0]);
+    return false;
+  }
+
+  (*curl_->easy_setopt)(curl, CURLOPT_URL, url.c_str());
+  (*curl_->easy_setopt)(curl, CURLOPT_USERAGENT, "Breakpad/1.0 (Linux)");
+  (*curl_->easy_setopt)(curl, CURLOPT_FOLLOWLOCATION, 1);
+  // Downloads run on prefetch worker threads; without NOSIGNAL, curl's
+  // SIGALRM-based resolver timeouts are not thread safe.
+  (*curl_->easy_setopt)(curl, CURLOPT_NOSIGNAL, 1);
+  (*curl_->easy_setopt)(curl, CURLOPT_CONNECTTIMEOUT, 10);
+  // Symbol files can be large, so no overall transfer timeout; give up
+  // instead if the transfer stalls below 100 bytes/s for a minute.
+  (*curl_->easy_setopt)(curl, CURLOPT_LOW_SPEED_LIMIT, 100);
+  (*curl_->easy_setopt)(curl, CURLOPT_LOW_SPEED_TIME, 60);
+  // Let the server compress on the wire; curl decodes transparently.
+  (*curl_->easy_setopt)(curl, CURLOPT_ENCODING, "");
+  (*curl_->easy_setopt)(curl, CURLOPT_FAILONERROR, 1);
+  (*curl_->easy_setopt)(curl, CURLOPT_WRITEFUNCTION, WriteToFileCallback);
+  (*curl_->easy_setopt)(curl, CURLOPT_WRITEDATA,
+                        static_cast<void *>(temp_file));
+  if (if_modified_since > 0) {
+    (*curl_->easy_setopt)(curl, CURLOPT_TIMECONDITION,
+                          CURL_TIMECOND_IFMODSINCE);
+    (*curl_->easy_setopt)(curl, CURLOPT_TIMEVALUE,
+                          static_cast<long>(if_modified_since));
+  }
+
+  CURLcode err_code = (*curl_->easy_perform)(curl);
+  long response_code = 0;
+  if (curl_->easy_getinfo)
+    (*curl_->easy_getinfo)(curl, CURLINFO_RESPONSE_CODE, &response_code);
+  (*curl_->easy_cleanup)(curl);
+  fclose(temp_file);
+
+  if (response_code == 304) {
+    // The server confirmed the cached copy is current.
+    remove(&temp_path[0]);
+    *not_modified = true;
+    return true;
+  }
+
+  if (err_code != CURLE_OK) {
+    BPLOG(INFO) << "Symbol download failed for " << url << ": " <<
+        (curl_->easy_strerror ? (*curl_->easy_strerror)(err_code) :
+                                "libcurl error");
+    remove(&temp_path[0]);
+    return false;
+  }
+
+  if (rename(&temp_path[0], cache_file.c_str()) != 0) {
+    BPLOG(ERROR) << "Could not move downloaded symbols into " << cache_file;
+    remove(&temp_path[0]);
+    return false;
+  }
+
+  BPLOG(INFO) << "Downloaded symbols from " << url;
+  return true;
+}
+
+bool HTTPSymbolSupplier::IsRecentDownloadMiss(const string &url) {
+  if (download_miss_ttl_ <= 0)
+    return false;
+
+  time_t now = time(NULL);
+  pthread_mutex_lock(&http_lock_);
+  std::map<string, time_t>::iterator miss = download_misses_.find(url);
+  bool fresh_miss = false;
+  if (miss != download_misses_.end()) {
+    if (now < miss->second) {
+      fresh_miss = true;
+    } else {
+      download_misses_.erase(miss);
+    }
+  }
+  pthread_mutex_unlock(&http_lock_);
+  return fresh_miss;
+}
+
+void HTTPSymbolSupplier::RecordDownloadMiss(const string &url) {
+  if (download_miss_ttl_ <= 0)
+    return;
+
+  pthread_mutex_lock(&http_lock_);
+  download_misses_[url] = time(NULL) + download_miss_ttl_;
+  pthread_mutex_unlock(&http_lock_);
+}
+
+void HTTPSymbolSupplier::PruneCache(const string &just_fetched) {
+  if (max_cache_size_ == 0)
+    return;
+
+  // One pruner at a time; concurrent workers finishing downloads
+  // together would otherwise walk and delete over each other.
+  pthread_mutex_lock(&http_lock_);
+
+  vector<CacheFile> files;
+  uint64_t total_size = 0;
+  CollectCacheFiles(cache_path_, 0, &files, &total_size);
+
+  if (total_size > max_cache_size_) {
+    // Oldest modification time first.  Downloads and revalidations
+    // refresh the time, so entries recently confirmed current are the
+    // last to go; this approximates LRU without a write per cache hit.
+    std::sort(files.begin(), files.end());
+    size_t evicted = 0;
+    for (size_t file_index = 0;
+         file_index < files.size() && total_size > max_cache_size_;
+         ++file_index) {
+      // Never evict the file this lookup just fetched, even if it is
+      // larger than the whole bound; the caller is about to read it.
+      if (files[file_index].path == just_fetched) {
+        continue;
+      }
+      if (remove(files[file_index].path.c_str()) == 0) {
+        total_size -= files[file_index].size;
+        ++evicted;
+      }
+    }
+    BPLOG(INFO) << "Pruned " << evicted << " symbol files from " <<
+        cache_path_;
+  }
+
+  pthread_mutex_unlock(&http_lock_);
+}
+
+#endif  // _WIN32
+
+SymbolSupplier::SymbolResult HTTPSymbolSupplier::GetSymbolFile(
+    const CodeModule *module,
+    const SystemInfo *system_info,
+    string *symbol_file) {
+  SymbolResult result = SimpleSymbolSupplier::GetSymbolFile(
+      module, system_info, symbol_file);
+
+#ifndef _WIN32
+  string cache_file = SymbolPathUnderRoot(module, cache_path_);
+  if (cache_file.empty()) {
+    return result;
+  }
+  string url = server_url_ + SymbolPathUnderRoot(module, "");
+
+  if (result == FOUND) {
+    // Warm hit.  Revalidate the file with a conditional request once it
+    // has gone unverified longer than the TTL; a hit on a compressed
+    // sibling (.sym.gz, .sym.zst) is someone else's file and is served
+    // as-is.
+    struct stat sb;
+    if (revalidate_ttl_ > 0 && *symbol_file == cache_file &&
+        stat(cache_file.c_str(), &sb) == 0 &&
+        time(NULL) - sb.st_mtime > revalidate_ttl_) {
+      bool not_modified = false;
+      if (DownloadToCache(url, cache_file, sb.st_mtime, &not_modified) &&
+          !not_modified) {
+        // The server had a newer file; it now sits at the same path.
+        PruneCache(cache_file);
+      } else {
+        // Confirmed current, or the server was unreachable: keep
+        // serving the cached copy, and push the next revalidation out
+        // a full TTL either way.
+        utime(cache_file.c_str(), NULL);
+      }
+    }
+    return result;
+  }
+
+  // Cache miss.  The negative cache may be remembering a probe that
+  // raced a concurrent download of the same module; trust a direct stat
+  // before going to the network.
+  struct stat sb;
+  if (stat(cache_file.c_str(), &sb) == 0) {
+    ForgetMissingSymbolFile(cache_file);
+    return SimpleSymbolSupplier::GetSymbolFile(module, system_info,
+                                               symbol_file);
+  }
+
+  if (IsRecentDownloadMiss(url)) {
+    return NOT_FOUND;
+  }
+
+  // One download per module at a time; see downloads_in_flight_.
+  pthread_mutex_lock(&http_lock_);
+  while (downloads_in_flight_.count(cache_file) != 0) {
+    pthread_cond_wait(&download_done_cond_, &http_lock_);
+  }
+  downloads_in_flight_.insert(cache_file);
+  pthread_mutex_unlock(&http_lock_);
+
+  if (stat(cache_file.c_str(), &sb) == 0) {
+    // Another thread downloaded the file while this one waited.
+    ForgetMissingSymbolFile(cache_file);
+    result = SimpleSymbolSupplier::GetSymbolFile(module, system_info,
+                                                 symbol_file);
+  } else {
+    bool not_modified = false;
+    if (DownloadToCache(url, cache_file, 0, &not_modified)) {
+      // The lookup above recorded the path as missing; the download
+      // just created it.
+      ForgetMissingSymbolFile(cache_file);
+      PruneCache(cache_file);
+      result = SimpleSymbolSupplier::GetSymbolFile(module, system_info,
+                                                   symbol_file);
+    } else {
+      RecordDownloadMiss(url);
+      result = NOT_FOUND;
+    }
+  }
+
+  pthread_mutex_lock(&http_lock_);
+  downloads_in_flight_.erase(cache_file);
+  pthread_cond_broadcast(&download_done_cond_);
+  pthread_mutex_unlock(&http_lock_);
+  return result;
+#else
+  return result;
+#endif  // _WIN32
+}
+
+}  // namespace google_breakpad
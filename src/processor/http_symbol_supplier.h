@@ -0,0 +1,186 @@
+// Copyright (c) 2010, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// http_symbol_supplier.h: A SymbolSupplier that fetches symbol files
+// from an HTTP(S) symbol server into a local disk cache.
+//
+// HTTPSymbolSupplier layers a symbol server in front of a
+// SimpleSymbolSupplier-style tree.  The cache directory uses the same
+// <debug_file>/<debug_identifier>/<debug_file>.sym layout as
+// SimpleSymbolSupplier, and the server is expected to serve those same
+// relative paths beneath its base URL, so any tree usable with
+// SimpleSymbolSupplier can be published as-is by a plain file server.
+//
+// Lookups consult the cache first: a module whose symbol file is
+// already cached costs exactly what a SimpleSymbolSupplier lookup
+// costs, with no network traffic.  On a cache miss the file is
+// downloaded to a temporary file and renamed into place, so processors
+// sharing a cache directory never observe a partial file.  Downloads
+// run on the symbol prefetch workers (PrefetchSymbolFiles), so the
+// modules of a dump are fetched a few at a time in parallel, and only
+// the modules a dump actually references are ever requested.
+//
+// A cached file older than revalidate_ttl is revalidated with a
+// conditional request (If-Modified-Since); a 304 response just
+// refreshes the file's timestamp.  Modules the server does not have
+// are remembered for download_miss_ttl so that a stream of dumps
+// referencing the same symbol-less modules does not re-query the
+// server for each dump.  When max_cache_size is nonzero, the cache is
+// pruned oldest-modification-first after a download to stay under the
+// bound; downloads and revalidations refresh the modification time, so
+// entries still in use tend to survive.
+//
+// Networking uses libcurl loaded with dlopen, in the same manner as
+// common/linux/http_upload.cc, so the processor library takes no
+// link-time libcurl dependency.  If libcurl is unavailable (or on
+// Windows, where nothing dlopens), the supplier degrades to a plain
+// SimpleSymbolSupplier over the cache directory.
+
+#ifndef PROCESSOR_HTTP_SYMBOL_SUPPLIER_H__
+#define PROCESSOR_HTTP_SYMBOL_SUPPLIER_H__
+
+#include <time.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+#include "processor/simple_symbol_supplier.h"
+
+namespace google_breakpad {
+
+class HTTPSymbolSupplier : public SimpleSymbolSupplier {
+ public:
+  // Creates a supplier fetching from server_url (e.g.
+  // "https://symbols.example.com/store"), caching under cache_path.
+  // The cache directory is created if it does not exist.
+  HTTPSymbolSupplier(const string &server_url, const string &cache_path);
+
+  virtual ~HTTPSymbolSupplier();
+
+  // The cache size bound, in bytes.  After a download pushes the cache
+  // over the bound, the oldest files are removed until it fits.  0
+  // disables pruning.  Default: 1 GiB.
+  void set_max_cache_size(uint64_t max_cache_size_bytes) {
+    max_cache_size_ = max_cache_size_bytes;
+  }
+  uint64_t max_cache_size() const { return max_cache_size_; }
+
+  // How long, in seconds, a cached symbol file is served without asking
+  // the server whether it changed.  0 trusts the cache forever.
+  // Default: one day.
+  void set_revalidate_ttl(long ttl_seconds) {
+    revalidate_ttl_ = ttl_seconds;
+  }
+  long revalidate_ttl() const { return revalidate_ttl_; }
+
+  // How long, in seconds, a failed download is remembered before the
+  // server is asked about that module again.  0 retries every lookup.
+  // Default: one hour.
+  void set_download_miss_ttl(long ttl_seconds) {
+    download_miss_ttl_ = ttl_seconds;
+  }
+  long download_miss_ttl() const { return download_miss_ttl_; }
+
+  // Downloads the module's symbol file into the cache if it is absent,
+  // revalidates it if it is stale, and defers to SimpleSymbolSupplier
+  // for the lookup itself.  Every lookup path funnels through this
+  // method, including the prefetch workers, which is what makes
+  // downloads for one dump concurrent.
+  virtual SymbolResult GetSymbolFile(const CodeModule *module,
+                                     const SystemInfo *system_info,
+                                     string *symbol_file);
+
+  // Unhide the two-result overload alongside the override above.
+  using SimpleSymbolSupplier::GetSymbolFile;
+
+ private:
+  static const uint64_t kDefaultMaxCacheSizeBytes =
+      1024ULL * 1024 * 1024;  // 1 GiB
+  static const long kDefaultRevalidateTtlSeconds = 24 * 60 * 60;
+  static const long kDefaultDownloadMissTtlSeconds = 60 * 60;
+
+  // The dlopened libcurl and the entry points the downloader uses;
+  // defined in the .cc file.
+  struct CurlLib;
+
+  // Loads libcurl on first use.  Returns false if it cannot be loaded,
+  // in which case the supplier serves only what is already cached.
+  bool EnsureCurlLoaded();
+
+  // Performs one GET of url into cache_file via a temporary file.  If
+  // if_modified_since is nonzero the request is conditional, and a 304
+  // response sets *not_modified without touching cache_file.  Returns
+  // false if the server has no such file or the transfer failed.
+  bool DownloadToCache(const string &url,
+                       const string &cache_file,
+                       time_t if_modified_since,
+                       bool *not_modified);
+
+  // The server-miss bookkeeping described at set_download_miss_ttl.
+  bool IsRecentDownloadMiss(const string &url);
+  void RecordDownloadMiss(const string &url);
+
+  // Removes the oldest cached files until the cache fits in
+  // max_cache_size_, sparing just_fetched, whose caller is about to
+  // read it.  No-op when the bound is 0.
+  void PruneCache(const string &just_fetched);
+
+  string server_url_;
+  string cache_path_;
+  uint64_t max_cache_size_;
+  long revalidate_ttl_;
+  long download_miss_ttl_;
+
+  // URLs recently requested and not delivered, mapped to the time at
+  // which they should be requested again.
+  std::map<string, time_t> download_misses_;
+
+  // Cache files currently being downloaded.  The stack walk's own
+  // lookup can race a prefetch worker for the same module; the loser
+  // waits on download_done_cond_ and then finds the winner's file on
+  // disk instead of downloading it a second time.
+  std::set<string> downloads_in_flight_;
+
+  CurlLib *curl_;
+  bool curl_load_failed_;
+
+#ifndef _WIN32
+  // Guards download_misses_, downloads_in_flight_, the lazy libcurl
+  // load, and cache pruning.
+  pthread_mutex_t http_lock_;
+  pthread_cond_t download_done_cond_;
+#endif
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_HTTP_SYMBOL_SUPPLIER_H__
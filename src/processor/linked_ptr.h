@@ -53,6 +53,8 @@
 #ifndef PROCESSOR_LINKED_PTR_H__
 #define PROCESSOR_LINKED_PTR_H__
 
+#include <stddef.h>
+
 namespace google_breakpad {
 
 // This is used internally by all instances of linked_ptr<>.  It needs to be
@@ -40,6 +40,7 @@
 #include <time.h>
 
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "processor/logging.h"
@@ -51,9 +52,69 @@
 
 namespace google_breakpad {
 
+// The runtime severity threshold consulted by the BPLOG macros through
+// LogStream::SeverityEnabled.
+static LogStream::Severity log_min_severity = LogStream::SEVERITY_INFO;
+
+// The optional postmortem ring.  Slots are preallocated so that writers
+// never allocate; a writer claims a slot by atomically incrementing
+// log_ring_sequence, so concurrent logging threads cannot contend on a
+// lock.  The sequence also tells readers how many messages have been
+// written in total.
+static const uint32_t kLogRingSlots = 256;        // must be a power of two
+static const size_t kLogRingSlotBytes = 256;
+static char log_ring[kLogRingSlots][kLogRingSlotBytes];
+static volatile uint32_t log_ring_sequence;
+static volatile bool log_ring_enabled;
+
+static void LogRingAppend(const string &message) {
+#ifndef _WIN32
+  uint32_t sequence = __sync_fetch_and_add(&log_ring_sequence, 1);
+#else
+  uint32_t sequence = log_ring_sequence++;
+#endif
+  char *slot = log_ring[sequence & (kLogRingSlots - 1)];
+  size_t length = message.size();
+  if (length > kLogRingSlotBytes - 1)
+    length = kLogRingSlotBytes - 1;
+  memcpy(slot, message.data(), length);
+  slot[length] = '\0';
+}
+
+void EnableLogRingBuffer() {
+  memset(log_ring, 0, sizeof(log_ring));
+  log_ring_sequence = 0;
+  log_ring_enabled = true;
+}
+
+void DisableLogRingBuffer() {
+  log_ring_enabled = false;
+}
+
+void GetLogRingBuffer(std::vector<string> *messages) {
+  assert(messages);
+  messages->clear();
+  uint32_t sequence = log_ring_sequence;
+  uint32_t first = sequence > kLogRingSlots ? sequence - kLogRingSlots : 0;
+  for (uint32_t index = first; index < sequence; ++index) {
+    const char *slot = log_ring[index & (kLogRingSlots - 1)];
+    messages->push_back(string(slot));
+  }
+}
+
+// static
+void LogStream::set_min_severity(Severity severity) {
+  log_min_severity = severity;
+}
+
+// static
+bool LogStream::SeverityEnabled(Severity severity) {
+  return severity >= log_min_severity;
+}
+
 LogStream::LogStream(std::ostream &stream, Severity severity,
                      const char *file, int line)
-    : stream_(stream) {
+    : stream_(stream), buffer_() {
   time_t clock;
   time(&clock);
   struct tm tm_struct;
@@ -75,12 +136,15 @@ LogStream::LogStream(std::ostream &stream, Severity severity,
       break;
   }
 
-  stream_ << time_string << ": " << PathnameStripper::File(file) << ":" <<
+  buffer_ << time_string << ": " << PathnameStripper::File(file) << ":" <<
              line << ": " << severity_string << ": ";
 }
 
 LogStream::~LogStream() {
-  stream_ << std::endl;
+  string message = buffer_.str();
+  if (log_ring_enabled)
+    LogRingAppend(message);
+  stream_ << message << std::endl;
 }
 
 string HexString(uint32_t number) {
@@ -52,13 +52,24 @@
 // BPLOG_INIT(&argc, &argv); before any logging can be performed; define
 // BPLOG_INIT appropriately if initialization is required.
 //
+// Messages below a severity threshold are discarded before any
+// formatting takes place.  The threshold can be set at runtime with
+// LogStream::set_min_severity, and a compile-time floor can be set by
+// defining BPLOG_MINIMUM_SEVERITY to one of the BPLOG_SEVERITY_* values
+// (-D), which folds lower-severity call sites away entirely.  For
+// production postmortem debugging, EnableLogRingBuffer captures the most
+// recent messages in a lock-free in-memory ring regardless of where the
+// streams point.
+//
 // Author: Mark Mentovai
 
 #ifndef PROCESSOR_LOGGING_H__
 #define PROCESSOR_LOGGING_H__
 
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
@@ -87,25 +98,57 @@ class LogStream {
 
   // Begin logging a message to the stream identified by |stream|, at the
   // indicated severity.  The file and line parameters should be set so as to
-  // identify the line of source code that is producing a message.
+  // identify the line of source code that is producing a message.  The
+  // message accumulates in an internal buffer and is emitted, with a
+  // trailing newline, by the destructor.
   LogStream(std::ostream &stream, Severity severity,
             const char *file, int line);
 
-  // Finish logging by printing a newline and flushing the output stream.
+  // Finish logging by writing the buffered message, followed by a
+  // newline, to the output stream, and to the ring buffer when one has
+  // been enabled.
   ~LogStream();
 
   template<typename T> std::ostream& operator<<(const T &t) {
-    return stream_ << t;
+    return buffer_ << t;
   }
 
+  // Sets the runtime severity threshold.  Messages below it are
+  // discarded by the BPLOG macros before any LogStream is constructed,
+  // so gated-out call sites cost one comparison and no formatting.  The
+  // default threshold, SEVERITY_INFO, lets everything through.
+  static void set_min_severity(Severity severity);
+
+  // Returns true if messages of the given severity pass the runtime
+  // threshold.  Used by the BPLOG macros; not normally called directly.
+  static bool SeverityEnabled(Severity severity);
+
  private:
   std::ostream &stream_;
 
+  // The message under construction, emitted by the destructor.
+  std::ostringstream buffer_;
+
   // Disallow copy constructor and assignment operator
   explicit LogStream(const LogStream &that);
   void operator=(const LogStream &that);
 };
 
+// An optional in-memory record of the most recent log messages, for
+// postmortem debugging in production where stderr is discarded.  While
+// enabled, every emitted message is also copied into a fixed-size ring
+// of preallocated slots; writers claim slots with a single atomic
+// increment, so concurrent logging threads never contend on a lock.
+// Messages longer than a slot are truncated.
+void EnableLogRingBuffer();
+void DisableLogRingBuffer();
+
+// Copies the ring's contents into messages, oldest first.  Intended for
+// a crash handler or error path; it reads the ring without synchronizing
+// with writers, so a message being written concurrently may appear
+// garbled, which is acceptable for its diagnostic purpose.
+void GetLogRingBuffer(std::vector<string> *messages);
+
 // This class is used to explicitly ignore values in the conditional logging
 // macros.  This avoids compiler warnings like "value computed is not used"
 // and "statement has no effect".
@@ -134,8 +177,43 @@ int ErrnoString(string *error_string);
 #define BPLOG_INIT(pargc, pargv)
 #endif  // BPLOG_INIT
 
+// Numeric severity levels for the compile-time floor.  Defining
+// BPLOG_MINIMUM_SEVERITY to one of these removes all lower-severity
+// call sites: their enabled conditions become the constant false, and
+// the unreached stream expressions fold away as dead code.
+#define BPLOG_SEVERITY_INFO 0
+#define BPLOG_SEVERITY_ERROR 1
+
+#ifndef BPLOG_MINIMUM_SEVERITY
+#define BPLOG_MINIMUM_SEVERITY BPLOG_SEVERITY_INFO
+#endif  // BPLOG_MINIMUM_SEVERITY
+
+// The per-severity enabled conditions, combining the compile-time floor
+// with the runtime threshold.  The runtime check is not reached when the
+// compile-time half is false.
+#ifndef BPLOG_INFO_ENABLED
+#define BPLOG_INFO_ENABLED \
+    (BPLOG_MINIMUM_SEVERITY <= BPLOG_SEVERITY_INFO && \
+     google_breakpad::LogStream::SeverityEnabled( \
+         google_breakpad::LogStream::SEVERITY_INFO))
+#endif  // BPLOG_INFO_ENABLED
+
+#ifndef BPLOG_ERROR_ENABLED
+#define BPLOG_ERROR_ENABLED \
+    (BPLOG_MINIMUM_SEVERITY <= BPLOG_SEVERITY_ERROR && \
+     google_breakpad::LogStream::SeverityEnabled( \
+         google_breakpad::LogStream::SEVERITY_ERROR))
+#endif  // BPLOG_ERROR_ENABLED
+
+// Evaluates stream - constructing the LogStream and formatting the
+// message - only when enabled is true, by hiding the whole expression
+// behind the unreached arm of a conditional.
+#define BPLOG_LAZY_STREAM(stream, enabled) \
+    !(enabled) ? (void) 0 : google_breakpad::LogMessageVoidify() & (stream)
+
 #ifndef BPLOG
-#define BPLOG(severity) BPLOG_ ## severity
+#define BPLOG(severity) \
+    BPLOG_LAZY_STREAM(BPLOG_ ## severity, BPLOG_ ## severity ## _ENABLED)
 #endif  // BPLOG
 
 #ifndef BPLOG_INFO
@@ -157,7 +235,6 @@ int ErrnoString(string *error_string);
 #endif  // BPLOG_ERROR
 
 #define BPLOG_IF(severity, condition) \
-    !(condition) ? (void) 0 : \
-                   google_breakpad::LogMessageVoidify() & BPLOG(severity)
+    !(condition) ? (void) 0 : BPLOG(severity)
 
 #endif  // PROCESSOR_LOGGING_H__
@@ -39,9 +39,11 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "processor/map_serializers.h"
 #include "processor/simple_serializer.h"
+#include "processor/static_map_compact.h"
 
 #include "processor/address_map-inl.h"
 #include "processor/range_map-inl.h"
@@ -58,11 +60,20 @@ size_t StdMapSerializer<Key, Value>::SizeOf(
   size_t header_size = (1 + m.size()) * sizeof(uint32_t);
   size += header_size;
 
+  std::vector<Key> keys;
+  keys.reserve(m.size());
+  size_t flat_keys_size = 0;
   typename std::map<Key, Value>::const_iterator iter;
   for (iter = m.begin(); iter != m.end(); ++iter) {
-    size += key_serializer_.SizeOf(iter->first);
+    keys.push_back(iter->first);
+    flat_keys_size += key_serializer_.SizeOf(iter->first);
     size += value_serializer_.SizeOf(iter->second);
   }
+  // Write() makes the same choice between the key layouts.
+  if (StaticMapCompactKeysWriter<Key>::ShouldCompact(keys, flat_keys_size))
+    size += StaticMapCompactKeysWriter<Key>::RegionSize(keys);
+  else
+    size += flat_keys_size;
   return size;
 }
 
@@ -75,22 +86,36 @@ char *StdMapSerializer<Key, Value>::Write(const std::map<Key, Value> &m,
   }
   char *start_address = dest;
 
+  std::vector<Key> keys;
+  keys.reserve(m.size());
+  typename std::map<Key, Value>::const_iterator iter;
+  for (iter = m.begin(); iter != m.end(); ++iter)
+    keys.push_back(iter->first);
+  bool compact = StaticMapCompactKeysWriter<Key>::ShouldCompact(
+      keys, sizeof(Key) * m.size());
+
   // Write header:
-  // Number of nodes.
-  dest = SimpleSerializer<uint32_t>::Write(m.size(), dest);
+  // Number of nodes, with the key-layout flag.
+  uint32_t node_count_word = static_cast<uint32_t>(m.size());
+  if (compact)
+    node_count_word |= kStaticMapCompactKeysFlag;
+  dest = SimpleSerializer<uint32_t>::Write(node_count_word, dest);
   // Nodes offsets.
   uint32_t *offsets = reinterpret_cast<uint32_t*>(dest);
   dest += sizeof(uint32_t) * m.size();
 
   char *key_address = dest;
-  dest += sizeof(Key) * m.size();
+  if (compact)
+    dest = StaticMapCompactKeysWriter<Key>::Write(keys, dest);
+  else
+    dest += sizeof(Key) * m.size();
 
   // Traverse map.
-  typename std::map<Key, Value>::const_iterator iter;
   int index = 0;
   for (iter = m.begin(); iter != m.end(); ++iter, ++index) {
     offsets[index] = static_cast<uint32_t>(dest - start_address);
-    key_address = key_serializer_.Write(iter->first, key_address);
+    if (!compact)
+      key_address = key_serializer_.Write(iter->first, key_address);
     dest = value_serializer_.Write(iter->second, dest);
   }
   return dest;
@@ -118,47 +143,79 @@ char *StdMapSerializer<Key, Value>::Serialize(
 template<typename Address, typename Entry>
 size_t RangeMapSerializer<Address, Entry>::SizeOf(
     const RangeMap<Address, Entry> &m) const {
+  // Serialization traverses the underlying tree; restore it if the map
+  // has been frozen into its flat form.
+  if (!m.flat_.empty())
+    const_cast<RangeMap<Address, Entry>&>(m).Thaw();
+
   size_t size = 0;
   size_t header_size = (1 + m.map_.size()) * sizeof(uint32_t);
   size += header_size;
 
+  std::vector<Address> keys;
+  keys.reserve(m.map_.size());
+  size_t flat_keys_size = 0;
   typename std::map<Address, Range>::const_iterator iter;
   for (iter = m.map_.begin(); iter != m.map_.end(); ++iter) {
     // Size of key (high address).
-    size += address_serializer_.SizeOf(iter->first);
+    keys.push_back(iter->first);
+    flat_keys_size += address_serializer_.SizeOf(iter->first);
     // Size of base (low address).
     size += address_serializer_.SizeOf(iter->second.base());
     // Size of entry.
     size += entry_serializer_.SizeOf(iter->second.entry());
   }
+  // Write() makes the same choice between the key layouts.
+  if (StaticMapCompactKeysWriter<Address>::ShouldCompact(keys,
+                                                         flat_keys_size))
+    size += StaticMapCompactKeysWriter<Address>::RegionSize(keys);
+  else
+    size += flat_keys_size;
   return size;
 }
 
 template<typename Address, typename Entry>
 char *RangeMapSerializer<Address, Entry>::Write(
     const RangeMap<Address, Entry> &m, char *dest) const {
+  if (!m.flat_.empty())
+    const_cast<RangeMap<Address, Entry>&>(m).Thaw();
+
   if (!dest) {
     BPLOG(ERROR) << "RangeMapSerializer failed: write to NULL address.";
     return NULL;
   }
   char *start_address = dest;
 
+  std::vector<Address> keys;
+  keys.reserve(m.map_.size());
+  typename std::map<Address, Range>::const_iterator iter;
+  for (iter = m.map_.begin(); iter != m.map_.end(); ++iter)
+    keys.push_back(iter->first);
+  bool compact = StaticMapCompactKeysWriter<Address>::ShouldCompact(
+      keys, sizeof(Address) * m.map_.size());
+
   // Write header:
-  // Number of nodes.
-  dest = SimpleSerializer<uint32_t>::Write(m.map_.size(), dest);
+  // Number of nodes, with the key-layout flag.
+  uint32_t node_count_word = static_cast<uint32_t>(m.map_.size());
+  if (compact)
+    node_count_word |= kStaticMapCompactKeysFlag;
+  dest = SimpleSerializer<uint32_t>::Write(node_count_word, dest);
   // Nodes offsets.
   uint32_t *offsets = reinterpret_cast<uint32_t*>(dest);
   dest += sizeof(uint32_t) * m.map_.size();
 
   char *key_address = dest;
-  dest += sizeof(Address) * m.map_.size();
+  if (compact)
+    dest = StaticMapCompactKeysWriter<Address>::Write(keys, dest);
+  else
+    dest += sizeof(Address) * m.map_.size();
 
   // Traverse map.
-  typename std::map<Address, Range>::const_iterator iter;
   int index = 0;
   for (iter = m.map_.begin(); iter != m.map_.end(); ++iter, ++index) {
     offsets[index] = static_cast<uint32_t>(dest - start_address);
-    key_address = address_serializer_.Write(iter->first, key_address);
+    if (!compact)
+      key_address = address_serializer_.Write(iter->first, key_address);
     dest = address_serializer_.Write(iter->second.base(), dest);
     dest = entry_serializer_.Write(iter->second.entry(), dest);
   }
@@ -189,6 +246,11 @@ char *RangeMapSerializer<Address, Entry>::Serialize(
 template<class AddrType, class EntryType>
 size_t ContainedRangeMapSerializer<AddrType, EntryType>::SizeOf(
     const ContainedRangeMap<AddrType, EntryType> *m) const {
+  // Serialization traverses the tree; rebuild it if the map has been
+  // frozen into its flattened form.
+  if (!m->flat_.empty())
+    const_cast<ContainedRangeMap<AddrType, EntryType>*>(m)->Thaw();
+
   size_t size = 0;
   size_t header_size = addr_serializer_.SizeOf(m->base_)
                        + entry_serializer_.SizeOf(m->entry_)
@@ -211,6 +273,9 @@ size_t ContainedRangeMapSerializer<AddrType, EntryType>::SizeOf(
 template<class AddrType, class EntryType>
 char *ContainedRangeMapSerializer<AddrType, EntryType>::Write(
     const ContainedRangeMap<AddrType, EntryType> *m, char *dest) const {
+  if (!m->flat_.empty())
+    const_cast<ContainedRangeMap<AddrType, EntryType>*>(m)->Thaw();
+
   if (!dest) {
     BPLOG(ERROR) << "StdMapSerializer failed: write to NULL address.";
     return NULL;
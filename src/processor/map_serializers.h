@@ -80,6 +80,10 @@ class AddressMapSerializer {
  public:
   // Calculate the memory size of serialized data.
   size_t SizeOf(const AddressMap<Addr, Entry> &m) const {
+    // Serialization traverses the underlying tree; restore it if the map
+    // has been frozen into its flat form.
+    if (!m.flat_.empty())
+      const_cast<AddressMap<Addr, Entry>&>(m).Thaw();
     return std_map_serializer_.SizeOf(m.map_);
   }
 
@@ -87,6 +91,8 @@ class AddressMapSerializer {
   // of data, i.e., return the address after the final byte of data.
   // NOTE: caller has to allocate enough memory before invoke Write() method.
   char* Write(const AddressMap<Addr, Entry> &m, char *dest) const {
+    if (!m.flat_.empty())
+      const_cast<AddressMap<Addr, Entry>&>(m).Thaw();
     return std_map_serializer_.Write(m.map_, dest);
   }
 
@@ -95,6 +101,8 @@ class AddressMapSerializer {
   // to the size of serialized data, i.e., SizeOf(m).
   // Caller has the ownership of memory allocated as "new char[]".
   char* Serialize(const AddressMap<Addr, Entry> &m, unsigned int *size) const {
+    if (!m.flat_.empty())
+      const_cast<AddressMap<Addr, Entry>&>(m).Thaw();
     return std_map_serializer_.Serialize(m.map_, size);
   }
 
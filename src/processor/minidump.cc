@@ -48,14 +48,19 @@
 #define PRIx32 "lx"
 #define snprintf _snprintf
 #else  // _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #define O_BINARY 0
 #endif  // _WIN32
 
+#include <algorithm>
 #include <fstream>
+#include <new>
 #include <iostream>
 #include <limits>
 #include <map>
+#include <new>
 #include <vector>
 
 #include "processor/range_map-inl.h"
@@ -63,6 +68,7 @@
 #include "common/scoped_ptr.h"
 #include "processor/basic_code_module.h"
 #include "processor/basic_code_modules.h"
+#include "processor/compressed_symbol_file.h"
 #include "processor/logging.h"
 
 
@@ -155,6 +161,12 @@ static inline void Swap(MDMemoryDescriptor* memory_descriptor) {
 }
 
 
+static inline void Swap(MDMemoryDescriptor64* memory_descriptor) {
+  Swap(&memory_descriptor->start_of_memory_range);
+  Swap(&memory_descriptor->data_size);
+}
+
+
 static inline void Swap(MDGUID* guid) {
   Swap(&guid->data1);
   Swap(&guid->data2);
@@ -177,8 +189,30 @@ static inline void Swap(MDGUID* guid) {
 // parameter, a converter that uses iconv would also need to take the host
 // CPU's endianness into consideration.  It doesn't seems worth the trouble
 // of making it a dependency when we don't care about anything but UTF-16.
-static string* UTF16ToUTF8(const vector<uint16_t>& in,
-                           bool                     swap) {
+// The swap argument is a template parameter so that the common
+// same-endian case compiles to a tight loop with no per-character
+// branching; UTF16ToUTF8 below selects the specialization once per call.
+// Returns the length of the leading run of plain-ASCII code units in
+// |string|.  The chunked loop OR-combines eight units per iteration,
+// which compilers turn into SIMD compares where available.
+static size_t UTF16ASCIIRunLength(const uint16_t* string, size_t length) {
+  size_t count = 0;
+  while (count + 8 <= length) {
+    uint16_t combined = 0;
+    for (int unit = 0; unit < 8; ++unit)
+      combined |= string[count + unit];
+    if (combined & 0xff80)
+      break;
+    count += 8;
+  }
+  while (count < length && (string[count] & 0xff80) == 0)
+    count++;
+  return count;
+}
+
+
+template<bool kSwap>
+static string* UTF16ToUTF8Internal(const vector<uint16_t>& in) {
   scoped_ptr<string> out(new string());
 
   // Set the string's initial capacity to the number of UTF-16 characters,
@@ -186,12 +220,24 @@ static string* UTF16ToUTF8(const vector<uint16_t>& in,
   // If the UTF-8 representation is longer, the string will grow dynamically.
   out->reserve(in.size());
 
-  for (vector<uint16_t>::const_iterator iterator = in.begin();
+  vector<uint16_t>::const_iterator iterator = in.begin();
+
+  // Module paths are overwhelmingly plain ASCII, where UTF-16 units map
+  // to single UTF-8 bytes; copy the leading ASCII run directly and let
+  // the general loop handle whatever follows.
+  if (!kSwap && !in.empty()) {
+    size_t ascii_length = UTF16ASCIIRunLength(&in[0], in.size());
+    for (size_t index = 0; index < ascii_length; ++index)
+      (*out) += static_cast<char>(in[index]);
+    iterator += ascii_length;
+  }
+
+  for (;
        iterator != in.end();
        ++iterator) {
     // Get a 16-bit value from the input
     uint16_t in_word = *iterator;
-    if (swap)
+    if (kSwap)
       Swap(&in_word);
 
     // Convert the input value (in_word) into a Unicode code point (unichar).
@@ -249,6 +295,11 @@ static string* UTF16ToUTF8(const vector<uint16_t>& in,
   return out.release();
 }
 
+static string* UTF16ToUTF8(const vector<uint16_t>& in,
+                           bool                     swap) {
+  return swap ? UTF16ToUTF8Internal<true>(in) : UTF16ToUTF8Internal<false>(in);
+}
+
 // Return the smaller of the number of code units in the UTF-16 string,
 // not including the terminating null word, or maxlen.
 static size_t UTF16codeunits(const uint16_t *string, size_t maxlen) {
@@ -308,8 +359,13 @@ bool MinidumpContext::Read(uint32_t expected_size) {
   if (expected_size == sizeof(MDRawContextAMD64)) {
     BPLOG(INFO) << "MinidumpContext: looks like AMD64 context";
 
-    scoped_ptr<MDRawContextAMD64> context_amd64(new MDRawContextAMD64());
-    if (!minidump_->ReadBytes(context_amd64.get(),
+    // Raw context blocks are carved from the dump's arena and released
+    // wholesale when the Minidump is destroyed; on a failed read the
+    // bytes simply stay in the arena until then.
+    MDRawContextAMD64* context_amd64 =
+        new (minidump_->AllocateBytes(sizeof(MDRawContextAMD64)))
+            MDRawContextAMD64();
+    if (!minidump_->ReadBytes(context_amd64,
                               sizeof(MDRawContextAMD64))) {
       BPLOG(ERROR) << "MinidumpContext could not read amd64 context";
       return false;
@@ -407,7 +463,7 @@ bool MinidumpContext::Read(uint32_t expected_size) {
 
     context_flags_ = context_amd64->context_flags;
 
-    context_.amd64 = context_amd64.release();
+    context_.amd64 = context_amd64;
   }
   else {
     uint32_t context_flags;
@@ -452,7 +508,9 @@ bool MinidumpContext::Read(uint32_t expected_size) {
           return false;
         }
 
-        scoped_ptr<MDRawContextX86> context_x86(new MDRawContextX86());
+        MDRawContextX86* context_x86 =
+            new (minidump_->AllocateBytes(sizeof(MDRawContextX86)))
+                MDRawContextX86();
 
         // Set the context_flags member, which has already been read, and
         // read the rest of the structure beginning with the first member
@@ -461,7 +519,7 @@ bool MinidumpContext::Read(uint32_t expected_size) {
 
         size_t flags_size = sizeof(context_x86->context_flags);
         uint8_t* context_after_flags =
-          reinterpret_cast<uint8_t*>(context_x86.get()) + flags_size;
+          reinterpret_cast<uint8_t*>(context_x86) + flags_size;
         if (!minidump_->ReadBytes(context_after_flags,
                                   sizeof(MDRawContextX86) - flags_size)) {
           BPLOG(ERROR) << "MinidumpContext could not read x86 context";
@@ -513,7 +571,7 @@ bool MinidumpContext::Read(uint32_t expected_size) {
           // does not need to be swapped.
         }
 
-        context_.x86 = context_x86.release();
+        context_.x86 = context_x86;
 
         break;
       }
@@ -525,7 +583,9 @@ bool MinidumpContext::Read(uint32_t expected_size) {
           return false;
         }
 
-        scoped_ptr<MDRawContextPPC> context_ppc(new MDRawContextPPC());
+        MDRawContextPPC* context_ppc =
+            new (minidump_->AllocateBytes(sizeof(MDRawContextPPC)))
+                MDRawContextPPC();
 
         // Set the context_flags member, which has already been read, and
         // read the rest of the structure beginning with the first member
@@ -534,7 +594,7 @@ bool MinidumpContext::Read(uint32_t expected_size) {
 
         size_t flags_size = sizeof(context_ppc->context_flags);
         uint8_t* context_after_flags =
-          reinterpret_cast<uint8_t*>(context_ppc.get()) + flags_size;
+          reinterpret_cast<uint8_t*>(context_ppc) + flags_size;
         if (!minidump_->ReadBytes(context_after_flags,
                                   sizeof(MDRawContextPPC) - flags_size)) {
           BPLOG(ERROR) << "MinidumpContext could not read ppc context";
@@ -589,7 +649,7 @@ bool MinidumpContext::Read(uint32_t expected_size) {
           Swap(&context_ppc->vector_save.save_vrvalid);
         }
 
-        context_.ppc = context_ppc.release();
+        context_.ppc = context_ppc;
 
         break;
       }
@@ -601,7 +661,9 @@ bool MinidumpContext::Read(uint32_t expected_size) {
           return false;
         }
 
-        scoped_ptr<MDRawContextSPARC> context_sparc(new MDRawContextSPARC());
+        MDRawContextSPARC* context_sparc =
+            new (minidump_->AllocateBytes(sizeof(MDRawContextSPARC)))
+                MDRawContextSPARC();
 
         // Set the context_flags member, which has already been read, and
         // read the rest of the structure beginning with the first member
@@ -610,7 +672,7 @@ bool MinidumpContext::Read(uint32_t expected_size) {
 
         size_t flags_size = sizeof(context_sparc->context_flags);
         uint8_t* context_after_flags =
-            reinterpret_cast<uint8_t*>(context_sparc.get()) + flags_size;
+            reinterpret_cast<uint8_t*>(context_sparc) + flags_size;
         if (!minidump_->ReadBytes(context_after_flags,
                                   sizeof(MDRawContextSPARC) - flags_size)) {
           BPLOG(ERROR) << "MinidumpContext could not read sparc context";
@@ -645,7 +707,7 @@ bool MinidumpContext::Read(uint32_t expected_size) {
           Swap(&context_sparc->float_save.filler);
           Swap(&context_sparc->float_save.fsr);
         }
-        context_.ctx_sparc = context_sparc.release();
+        context_.ctx_sparc = context_sparc;
 
         break;
       }
@@ -657,7 +719,9 @@ bool MinidumpContext::Read(uint32_t expected_size) {
           return false;
         }
 
-        scoped_ptr<MDRawContextARM> context_arm(new MDRawContextARM());
+        MDRawContextARM* context_arm =
+            new (minidump_->AllocateBytes(sizeof(MDRawContextARM)))
+                MDRawContextARM();
 
         // Set the context_flags member, which has already been read, and
         // read the rest of the structure beginning with the first member
@@ -666,7 +730,7 @@ bool MinidumpContext::Read(uint32_t expected_size) {
 
         size_t flags_size = sizeof(context_arm->context_flags);
         uint8_t* context_after_flags =
-            reinterpret_cast<uint8_t*>(context_arm.get()) + flags_size;
+            reinterpret_cast<uint8_t*>(context_arm) + flags_size;
         if (!minidump_->ReadBytes(context_after_flags,
                                   sizeof(MDRawContextARM) - flags_size)) {
           BPLOG(ERROR) << "MinidumpContext could not read arm context";
@@ -700,7 +764,7 @@ bool MinidumpContext::Read(uint32_t expected_size) {
             Swap(&context_arm->float_save.extra[fpe_index]);
           }
         }
-        context_.arm = context_arm.release();
+        context_.arm = context_arm;
 
         break;
       }
@@ -768,6 +832,41 @@ bool MinidumpContext::GetInstructionPointer(uint64_t* ip) const {
 }
 
 
+bool MinidumpContext::GetStackPointer(uint64_t* sp) const {
+  BPLOG_IF(ERROR, !sp) << "MinidumpContext::GetStackPointer requires |sp|";
+  assert(sp);
+  *sp = 0;
+
+  if (!valid_) {
+    BPLOG(ERROR) << "Invalid MinidumpContext for GetStackPointer";
+    return false;
+  }
+
+  switch (context_flags_ & MD_CONTEXT_CPU_MASK) {
+  case MD_CONTEXT_AMD64:
+    *sp = context_.amd64->rsp;
+    break;
+  case MD_CONTEXT_ARM:
+    *sp = context_.arm->iregs[MD_CONTEXT_ARM_REG_SP];
+    break;
+  case MD_CONTEXT_PPC:
+    *sp = context_.ppc->gpr[1];
+    break;
+  case MD_CONTEXT_SPARC:
+    *sp = context_.ctx_sparc->g_r[14];
+    break;
+  case MD_CONTEXT_X86:
+    *sp = context_.x86->esp;
+    break;
+  default:
+    // This should never happen.
+    BPLOG(ERROR) << "Unknown CPU architecture in GetStackPointer";
+    return false;
+  }
+  return true;
+}
+
+
 const MDRawContextX86* MinidumpContext::GetContextX86() const {
   if (GetContextCPU() != MD_CONTEXT_X86) {
     BPLOG(ERROR) << "MinidumpContext cannot get x86 context";
@@ -815,34 +914,8 @@ const MDRawContextARM* MinidumpContext::GetContextARM() const {
 }
 
 void MinidumpContext::FreeContext() {
-  switch (GetContextCPU()) {
-    case MD_CONTEXT_X86:
-      delete context_.x86;
-      break;
-
-    case MD_CONTEXT_PPC:
-      delete context_.ppc;
-      break;
-
-    case MD_CONTEXT_AMD64:
-      delete context_.amd64;
-      break;
-
-    case MD_CONTEXT_SPARC:
-      delete context_.ctx_sparc;
-      break;
-
-    case MD_CONTEXT_ARM:
-      delete context_.arm;
-      break;
-
-    default:
-      // There is no context record (valid_ is false) or there's a
-      // context record for an unknown CPU (shouldn't happen, only known
-      // records are stored by Read).
-      break;
-  }
-
+  // The raw context block, if any, is owned by the Minidump's arena and
+  // released wholesale when the dump closes; just detach from it.
   context_flags_ = 0;
   context_.base = NULL;
 }
@@ -1149,25 +1222,57 @@ void MinidumpContext::Print() {
 
 uint32_t MinidumpMemoryRegion::max_bytes_ = 1024 * 1024;  // 1MB
 
+uint32_t MinidumpMemoryRegion::max_print_bytes_ = 0;  // unlimited
+
 
 MinidumpMemoryRegion::MinidumpMemoryRegion(Minidump* minidump)
     : MinidumpObject(minidump),
-      descriptor_(NULL),
-      memory_(NULL) {
+      base_address_(0),
+      region_size_(0),
+      file_offset_(0),
+      memory_(NULL),
+      pages_(NULL),
+      mapped_memory_(NULL) {
 }
 
 
 MinidumpMemoryRegion::~MinidumpMemoryRegion() {
   delete memory_;
+  delete pages_;
 }
 
 
 void MinidumpMemoryRegion::SetDescriptor(MDMemoryDescriptor* descriptor) {
-  descriptor_ = descriptor;
-  valid_ = descriptor &&
-           descriptor_->memory.data_size <=
-               numeric_limits<uint64_t>::max() -
-               descriptor_->start_of_memory_range;
+  mapped_memory_ = NULL;
+  if (!descriptor) {
+    base_address_ = 0;
+    region_size_ = 0;
+    file_offset_ = 0;
+    valid_ = false;
+    return;
+  }
+  base_address_ = descriptor->start_of_memory_range;
+  region_size_ = descriptor->memory.data_size;
+  file_offset_ = descriptor->memory.rva;
+  valid_ = region_size_ <= numeric_limits<uint64_t>::max() - base_address_;
+}
+
+
+void MinidumpMemoryRegion::SetDescriptor64(
+    const MDMemoryDescriptor64* descriptor,
+    uint64_t file_offset) {
+  mapped_memory_ = NULL;
+  if (!descriptor) {
+    base_address_ = 0;
+    region_size_ = 0;
+    file_offset_ = 0;
+    valid_ = false;
+    return;
+  }
+  base_address_ = descriptor->start_of_memory_range;
+  region_size_ = descriptor->data_size;
+  file_offset_ = file_offset;
+  valid_ = region_size_ <= numeric_limits<uint64_t>::max() - base_address_;
 }
 
 
@@ -1177,28 +1282,50 @@ const uint8_t* MinidumpMemoryRegion::GetMemory() const {
     return NULL;
   }
 
+  if (mapped_memory_) {
+    return mapped_memory_;
+  }
+
   if (!memory_) {
-    if (descriptor_->memory.data_size == 0) {
+    if (region_size_ == 0) {
       BPLOG(ERROR) << "MinidumpMemoryRegion is empty";
       return NULL;
     }
 
-    if (!minidump_->SeekSet(descriptor_->memory.rva)) {
+    // If the minidump is backed by a memory mapping, hand out a pointer
+    // into the mapping rather than copying the region; this imposes no
+    // size limit, as nothing is read or copied.
+    if (region_size_ <= numeric_limits<size_t>::max()) {
+      mapped_memory_ = minidump_->GetMappedBytes(
+          static_cast<off_t>(file_offset_),
+          static_cast<size_t>(region_size_));
+      if (mapped_memory_) {
+        return mapped_memory_;
+      }
+    }
+
+    if (!minidump_->SeekSet(static_cast<off_t>(file_offset_))) {
       BPLOG(ERROR) << "MinidumpMemoryRegion could not seek to memory region";
       return NULL;
     }
 
-    if (descriptor_->memory.data_size > max_bytes_) {
-      BPLOG(ERROR) << "MinidumpMemoryRegion size " <<
-                      descriptor_->memory.data_size << " exceeds maximum " <<
-                      max_bytes_;
+    if (region_size_ > max_bytes_) {
+      BPLOG(ERROR) << "MinidumpMemoryRegion size " << region_size_ <<
+                      " exceeds maximum " << max_bytes_;
+      return NULL;
+    }
+
+    size_t region_size = static_cast<size_t>(region_size_);
+
+    if (!minidump_->AccountAllocation(region_size_)) {
+      BPLOG(ERROR) << "MinidumpMemoryRegion memory region exceeds the "
+                      "minidump's allocation budget";
       return NULL;
     }
 
-    scoped_ptr< vector<uint8_t> > memory(
-        new vector<uint8_t>(descriptor_->memory.data_size));
+    scoped_ptr< vector<uint8_t> > memory(new vector<uint8_t>(region_size));
 
-    if (!minidump_->ReadBytes(&(*memory)[0], descriptor_->memory.data_size)) {
+    if (!minidump_->ReadBytes(&(*memory)[0], region_size)) {
       BPLOG(ERROR) << "MinidumpMemoryRegion could not read memory region";
       return NULL;
     }
@@ -1216,7 +1343,7 @@ uint64_t MinidumpMemoryRegion::GetBase() const {
     return static_cast<uint64_t>(-1);
   }
 
-  return descriptor_->start_of_memory_range;
+  return base_address_;
 }
 
 
@@ -1226,13 +1353,72 @@ uint32_t MinidumpMemoryRegion::GetSize() const {
     return 0;
   }
 
-  return descriptor_->memory.data_size;
+  // Regions from a MD_MEMORY_64_LIST_STREAM can exceed the interface's
+  // 32-bit size; clamp rather than truncate.  Internal bounds checks
+  // use region_size_ directly.
+  if (region_size_ > numeric_limits<uint32_t>::max()) {
+    return numeric_limits<uint32_t>::max();
+  }
+
+  return static_cast<uint32_t>(region_size_);
 }
 
 
 void MinidumpMemoryRegion::FreeMemory() {
   delete memory_;
   memory_ = NULL;
+  delete pages_;
+  pages_ = NULL;
+}
+
+
+const uint8_t* MinidumpMemoryRegion::GetPageAtOffset(uint64_t offset,
+                                                     uint32_t size) const {
+  uint64_t page_index = offset / kPageSize;
+  uint32_t page_offset = static_cast<uint32_t>(offset % kPageSize);
+
+  // Requests that straddle a page boundary fall back to GetMemory.
+  if (page_offset + size > kPageSize) {
+    return NULL;
+  }
+
+  if (!pages_) {
+    pages_ = new map<uint64_t, vector<uint8_t> >();
+  }
+
+  map<uint64_t, vector<uint8_t> >::iterator page_iterator =
+      pages_->find(page_index);
+  if (page_iterator == pages_->end()) {
+    uint64_t page_start = page_index * kPageSize;
+    uint32_t page_size = kPageSize;
+    if (page_start + page_size > region_size_) {
+      page_size = static_cast<uint32_t>(region_size_ - page_start);
+    }
+
+    if (!minidump_->SeekSet(static_cast<off_t>(file_offset_ + page_start))) {
+      BPLOG(ERROR) << "MinidumpMemoryRegion could not seek to page " <<
+                      page_index;
+      return NULL;
+    }
+
+    if (!minidump_->AccountAllocation(page_size)) {
+      BPLOG(ERROR) << "MinidumpMemoryRegion page read exceeds the "
+                      "minidump's allocation budget";
+      return NULL;
+    }
+
+    vector<uint8_t>& page = (*pages_)[page_index];
+    page.resize(page_size);
+    if (!minidump_->ReadBytes(&page[0], page_size)) {
+      BPLOG(ERROR) << "MinidumpMemoryRegion could not read page " <<
+                      page_index;
+      pages_->erase(page_index);
+      return NULL;
+    }
+    return &page[page_offset];
+  }
+
+  return &page_iterator->second[page_offset];
 }
 
 
@@ -1251,27 +1437,38 @@ bool MinidumpMemoryRegion::GetMemoryAtAddressInternal(uint64_t address,
   }
 
   // Common failure case
-  if (address < descriptor_->start_of_memory_range ||
+  if (address < base_address_ ||
       sizeof(T) > numeric_limits<uint64_t>::max() - address ||
-      address + sizeof(T) > descriptor_->start_of_memory_range +
-                            descriptor_->memory.data_size) {
+      address + sizeof(T) > base_address_ + region_size_) {
     BPLOG(INFO) << "MinidumpMemoryRegion request out of range: " <<
                     HexString(address) << "+" << sizeof(T) << "/" <<
-                    HexString(descriptor_->start_of_memory_range) << "+" <<
-                    HexString(descriptor_->memory.data_size);
+                    HexString(base_address_) << "+" <<
+                    HexString(region_size_);
     return false;
   }
 
-  const uint8_t* memory = GetMemory();
+  uint64_t offset = address - base_address_;
+
+  const uint8_t* memory = NULL;
+  if (!memory_ && !mapped_memory_ && region_size_ > kPageSize) {
+    // The region is large and nothing has been cached yet: read only the
+    // page containing the requested value instead of the whole region.
+    // Full-memory dumps can carry very large regions, most of which are
+    // never touched by a stack walk.
+    memory = GetPageAtOffset(offset, sizeof(T));
+  }
   if (!memory) {
-    // GetMemory already logged a perfectly good message.
-    return false;
+    const uint8_t* region_memory = GetMemory();
+    if (!region_memory) {
+      // GetMemory already logged a perfectly good message.
+      return false;
+    }
+    memory = &region_memory[offset];
   }
 
   // If the CPU requires memory accesses to be aligned, this can crash.
   // x86 and ppc are able to cope, though.
-  *value = *reinterpret_cast<const T*>(
-      &memory[address - descriptor_->start_of_memory_range]);
+  *value = *reinterpret_cast<const T*>(memory);
 
   if (minidump_->swap())
     Swap(value);
@@ -1280,6 +1477,33 @@ bool MinidumpMemoryRegion::GetMemoryAtAddressInternal(uint64_t address,
 }
 
 
+const uint8_t* MinidumpMemoryRegion::GetMemorySpan(uint64_t address,
+                                                   size_t size) const {
+  if (!valid_) {
+    BPLOG(ERROR) << "Invalid MinidumpMemoryRegion for GetMemorySpan";
+    return NULL;
+  }
+
+  if (address < base_address_ ||
+      size > numeric_limits<uint64_t>::max() - address ||
+      address + size > base_address_ + region_size_) {
+    BPLOG(INFO) << "MinidumpMemoryRegion span request out of range: " <<
+                   HexString(address) << "+" << size << "/" <<
+                   HexString(base_address_) << "+" <<
+                   HexString(region_size_);
+    return NULL;
+  }
+
+  const uint8_t* memory = GetMemory();
+  if (!memory) {
+    // GetMemory already logged a perfectly good message.
+    return NULL;
+  }
+
+  return &memory[address - base_address_];
+}
+
+
 bool MinidumpMemoryRegion::GetMemoryAtAddress(uint64_t  address,
                                               uint8_t*  value) const {
   return GetMemoryAtAddressInternal(address, value);
@@ -1312,12 +1536,18 @@ void MinidumpMemoryRegion::Print() {
 
   const uint8_t* memory = GetMemory();
   if (memory) {
+    uint64_t print_length = region_size_;
+    if (max_print_bytes_ != 0 && print_length > max_print_bytes_)
+      print_length = max_print_bytes_;
     printf("0x");
-    for (unsigned int byte_index = 0;
-         byte_index < descriptor_->memory.data_size;
+    for (uint64_t byte_index = 0;
+         byte_index < print_length;
          byte_index++) {
       printf("%02x", memory[byte_index]);
     }
+    if (print_length < region_size_) {
+      printf("... (%" PRIu64 " more bytes)", region_size_ - print_length);
+    }
     printf("\n");
   } else {
     printf("No memory\n");
@@ -1340,7 +1570,7 @@ MinidumpThread::MinidumpThread(Minidump* minidump)
 
 MinidumpThread::~MinidumpThread() {
   delete memory_;
-  delete context_;
+  // context_, if set, lives in the Minidump's arena.
 }
 
 
@@ -1348,7 +1578,6 @@ bool MinidumpThread::Read() {
   // Invalidate cached data.
   delete memory_;
   memory_ = NULL;
-  delete context_;
   context_ = NULL;
 
   valid_ = false;
@@ -1408,14 +1637,20 @@ MinidumpContext* MinidumpThread::GetContext() {
       return NULL;
     }
 
-    scoped_ptr<MinidumpContext> context(new MinidumpContext(minidump_));
+    // The context object is carved from the dump's arena alongside its
+    // raw context block, so thread-heavy dumps don't pay per-thread heap
+    // allocations.  On a failed read the storage stays in the arena
+    // until the dump closes.
+    MinidumpContext* context =
+        new (minidump_->AllocateBytes(sizeof(MinidumpContext)))
+            MinidumpContext(minidump_);
 
     if (!context->Read(thread_.thread_context.data_size)) {
       BPLOG(ERROR) << "MinidumpThread cannot read context";
       return NULL;
     }
 
-    context_ = context.release();
+    context_ = context;
   }
 
   return context_;
@@ -1556,6 +1791,13 @@ bool MinidumpThreadList::Read(uint32_t expected_size) {
   }
 
   if (thread_count != 0) {
+    if (!minidump_->AccountAllocation(
+            static_cast<uint64_t>(thread_count) * sizeof(MinidumpThread))) {
+      BPLOG(ERROR) << "MinidumpThreadList count " << thread_count <<
+                      " exceeds the minidump's allocation budget";
+      return false;
+    }
+
     scoped_ptr<MinidumpThreads> threads(
         new MinidumpThreads(thread_count, MinidumpThread(minidump_)));
 
@@ -1764,6 +2006,38 @@ bool MinidumpModule::ReadAuxiliaryData() {
 }
 
 
+bool MinidumpModule::ReadLeanAuxiliaryData(bool read_cv_record) {
+  if (!module_valid_) {
+    BPLOG(ERROR) << "Invalid MinidumpModule for ReadLeanAuxiliaryData";
+    return false;
+  }
+
+  // Each module must have a name.
+  name_ = minidump_->ReadString(module_.module_name_rva);
+  if (!name_) {
+    BPLOG(ERROR) << "MinidumpModule could not read name";
+    return false;
+  }
+
+  valid_ = true;
+
+  if (read_cv_record) {
+    if (module_.cv_record.data_size && !GetCVRecord(NULL)) {
+      BPLOG(ERROR) << "MinidumpModule has no CodeView record, "
+                      "but one was expected";
+      return false;
+    }
+
+    // The miscellaneous debugging record is deliberately not fetched;
+    // debug_file and debug_identifier only consult it as a fallback when
+    // no usable CodeView record is present.
+    has_debug_info_ = true;
+  }
+
+  return true;
+}
+
+
 string MinidumpModule::code_file() const {
   if (!valid_) {
     BPLOG(ERROR) << "Invalid MinidumpModule for code_file";
@@ -2441,6 +2715,13 @@ bool MinidumpModuleList::Read(uint32_t expected_size) {
   }
 
   if (module_count != 0) {
+    if (!minidump_->AccountAllocation(
+            static_cast<uint64_t>(module_count) * sizeof(MinidumpModule))) {
+      BPLOG(ERROR) << "MinidumpModuleList count " << module_count <<
+                      " exceeds the minidump's allocation budget";
+      return false;
+    }
+
     scoped_ptr<MinidumpModules> modules(
         new MinidumpModules(module_count, MinidumpModule(minidump_)));
 
@@ -2501,6 +2782,10 @@ bool MinidumpModuleList::Read(uint32_t expected_size) {
       }
     }
 
+    // The module list never changes after a successful read; flatten the
+    // range map for query speed.
+    range_map_->Freeze();
+
     modules_ = modules.release();
   }
 
@@ -2616,31 +2901,153 @@ uint32_t MinidumpMemoryList::max_regions_ = 4096;
 
 MinidumpMemoryList::MinidumpMemoryList(Minidump* minidump)
     : MinidumpStream(minidump),
-      range_map_(new RangeMap<uint64_t, unsigned int>()),
+      intervals_(NULL),
+      is_memory64_(false),
       descriptors_(NULL),
+      descriptors64_(NULL),
+      regions_(NULL),
+      region_count_(0) {
+}
+
+
+MinidumpMemoryList::MinidumpMemoryList(Minidump* minidump, bool is_memory64)
+    : MinidumpStream(minidump),
+      intervals_(NULL),
+      is_memory64_(is_memory64),
+      descriptors_(NULL),
+      descriptors64_(NULL),
       regions_(NULL),
       region_count_(0) {
 }
 
 
 MinidumpMemoryList::~MinidumpMemoryList() {
-  delete range_map_;
+  delete intervals_;
   delete descriptors_;
+  delete descriptors64_;
   delete regions_;
 }
 
 
+// static
+bool MinidumpMemoryList::IntervalBeforeInterval(const MemoryInterval& left,
+                                                const MemoryInterval& right) {
+  if (left.base_address != right.base_address)
+    return left.base_address < right.base_address;
+  if (left.size != right.size)
+    return left.size > right.size;
+  return left.region_index < right.region_index;
+}
+
+
+// static
+bool MinidumpMemoryList::AddressBeforeInterval(
+    uint64_t address,
+    const MemoryInterval& interval) {
+  return address < interval.base_address;
+}
+
+
 bool MinidumpMemoryList::Read(uint32_t expected_size) {
   // Invalidate cached data.
   delete descriptors_;
   descriptors_ = NULL;
+  delete descriptors64_;
+  descriptors64_ = NULL;
   delete regions_;
   regions_ = NULL;
-  range_map_->Clear();
+  delete intervals_;
+  intervals_ = NULL;
   region_count_ = 0;
 
   valid_ = false;
 
+  uint32_t region_count = 0;
+  scoped_ptr<MemoryRegions> regions(new MemoryRegions());
+  if (is_memory64_) {
+    if (!ReadDescriptors64(expected_size, &region_count, regions.get())) {
+      return false;
+    }
+  } else {
+    if (!ReadDescriptors(expected_size, &region_count, regions.get())) {
+      return false;
+    }
+  }
+
+  if (region_count != 0) {
+    // Normalize the descriptors into a clean interval index.  Dumps from
+    // some Windows versions carry overlapping or duplicate descriptors,
+    // which a RangeMap would reject, failing address lookups - and with
+    // them stack scanning - on an otherwise usable dump.  Sort the
+    // candidate intervals, then sweep them in order: the portion of each
+    // interval not already covered by an earlier one becomes an index
+    // entry, so every byte is attributed to exactly one descriptor.
+    scoped_ptr<MemoryIntervals> candidates(new MemoryIntervals());
+    candidates->reserve(region_count);
+    for (unsigned int region_index = 0;
+         region_index < region_count;
+         ++region_index) {
+      MemoryInterval candidate;
+      if (is_memory64_) {
+        candidate.base_address =
+            (*descriptors64_)[region_index].start_of_memory_range;
+        candidate.size = (*descriptors64_)[region_index].data_size;
+      } else {
+        candidate.base_address =
+            (*descriptors_)[region_index].start_of_memory_range;
+        candidate.size = (*descriptors_)[region_index].memory.data_size;
+      }
+      candidate.region_index = region_index;
+      candidates->push_back(candidate);
+    }
+    std::sort(candidates->begin(), candidates->end(),
+              IntervalBeforeInterval);
+
+    scoped_ptr<MemoryIntervals> intervals(new MemoryIntervals());
+    intervals->reserve(region_count);
+    uint64_t covered_end = 0;
+    for (unsigned int candidate_index = 0;
+         candidate_index < region_count;
+         ++candidate_index) {
+      MemoryInterval interval = (*candidates)[candidate_index];
+      uint64_t interval_end = interval.base_address + interval.size;
+      if (!intervals->empty() && interval.base_address < covered_end) {
+        if (interval_end <= covered_end) {
+          // This descriptor is entirely shadowed by earlier ones:
+          // a duplicate, or a subset of a larger region.
+          BPLOG(INFO) << "MinidumpMemoryList dropping shadowed memory "
+                         "region " << interval.region_index << "/" <<
+                         region_count << ", " <<
+                         HexString(interval.base_address) << "+" <<
+                         HexString(interval.size);
+          continue;
+        }
+        BPLOG(INFO) << "MinidumpMemoryList trimming overlapping memory "
+                       "region " << interval.region_index << "/" <<
+                       region_count << ", " <<
+                       HexString(interval.base_address) << "+" <<
+                       HexString(interval.size);
+        interval.base_address = covered_end;
+        interval.size = interval_end - interval.base_address;
+      }
+      intervals->push_back(interval);
+      covered_end = interval_end;
+    }
+
+    regions_ = regions.release();
+    intervals_ = intervals.release();
+  }
+
+  region_count_ = region_count;
+
+  valid_ = true;
+  return true;
+}
+
+
+bool MinidumpMemoryList::ReadDescriptors(uint32_t expected_size,
+                                         uint32_t* region_count_out,
+                                         MemoryRegions* regions) {
   uint32_t region_count;
   if (expected_size < sizeof(region_count)) {
     BPLOG(ERROR) << "MinidumpMemoryList count size mismatch, " <<
@@ -2687,6 +3094,14 @@ bool MinidumpMemoryList::Read(uint32_t expected_size) {
   }
 
   if (region_count != 0) {
+    if (!minidump_->AccountAllocation(
+            static_cast<uint64_t>(region_count) *
+            (sizeof(MDMemoryDescriptor) + sizeof(MinidumpMemoryRegion)))) {
+      BPLOG(ERROR) << "MinidumpMemoryList count " << region_count <<
+                      " exceeds the minidump's allocation budget";
+      return false;
+    }
+
     scoped_ptr<MemoryDescriptors> descriptors(
         new MemoryDescriptors(region_count));
 
@@ -2698,8 +3113,7 @@ bool MinidumpMemoryList::Read(uint32_t expected_size) {
       return false;
     }
 
-    scoped_ptr<MemoryRegions> regions(
-        new MemoryRegions(region_count, MinidumpMemoryRegion(minidump_)));
+    regions->resize(region_count, MinidumpMemoryRegion(minidump_));
 
     for (unsigned int region_index = 0;
          region_index < region_count;
@@ -2722,83 +3136,194 @@ bool MinidumpMemoryList::Read(uint32_t expected_size) {
         return false;
       }
 
-      if (!range_map_->StoreRange(base_address, region_size, region_index)) {
-        BPLOG(ERROR) << "MinidumpMemoryList could not store memory region " <<
-                        region_index << "/" << region_count << ", " <<
-                        HexString(base_address) << "+" <<
-                        HexString(region_size);
-        return false;
-      }
-
       (*regions)[region_index].SetDescriptor(descriptor);
     }
 
     descriptors_ = descriptors.release();
-    regions_ = regions.release();
   }
 
-  region_count_ = region_count;
-
-  valid_ = true;
+  *region_count_out = region_count;
   return true;
 }
 
 
-MinidumpMemoryRegion* MinidumpMemoryList::GetMemoryRegionAtIndex(
-      unsigned int index) {
-  if (!valid_) {
-    BPLOG(ERROR) << "Invalid MinidumpMemoryList for GetMemoryRegionAtIndex";
-    return NULL;
+bool MinidumpMemoryList::ReadDescriptors64(uint32_t expected_size,
+                                           uint32_t* region_count_out,
+                                           MemoryRegions* regions) {
+  uint64_t region_count;
+  MDRVA64 base_rva;
+  if (expected_size < MDRawMemory64List_minsize) {
+    BPLOG(ERROR) << "MinidumpMemoryList memory64 header size mismatch, " <<
+                    expected_size << " < " << MDRawMemory64List_minsize;
+    return false;
   }
-
-  if (index >= region_count_) {
-    BPLOG(ERROR) << "MinidumpMemoryList index out of range: " <<
-                    index << "/" << region_count_;
-    return NULL;
+  if (!minidump_->ReadBytes(&region_count, sizeof(region_count)) ||
+      !minidump_->ReadBytes(&base_rva, sizeof(base_rva))) {
+    BPLOG(ERROR) << "MinidumpMemoryList could not read memory64 header";
+    return false;
   }
 
-  return &(*regions_)[index];
-}
-
-
-MinidumpMemoryRegion* MinidumpMemoryList::GetMemoryRegionForAddress(
-    uint64_t address) {
-  if (!valid_) {
-    BPLOG(ERROR) << "Invalid MinidumpMemoryList for GetMemoryRegionForAddress";
-    return NULL;
+  if (minidump_->swap()) {
+    Swap(&region_count);
+    Swap(&base_rva);
   }
 
-  unsigned int region_index;
-  if (!range_map_->RetrieveRange(address, &region_index, NULL, NULL)) {
-    BPLOG(INFO) << "MinidumpMemoryList has no memory region at " <<
-                   HexString(address);
-    return NULL;
+  if (region_count > max_regions_) {
+    BPLOG(ERROR) << "MinidumpMemoryList memory64 count " << region_count <<
+                    " exceeds maximum " << max_regions_;
+    return false;
   }
 
-  return GetMemoryRegionAtIndex(region_index);
-}
+  // The directory entry must cover at least the descriptor list; the
+  // regions' contents live in the contiguous payload at base_rva, which
+  // some writers count in the entry's size and some do not.
+  if (expected_size < MDRawMemory64List_minsize +
+                      region_count * sizeof(MDMemoryDescriptor64)) {
+    BPLOG(ERROR) << "MinidumpMemoryList memory64 size mismatch, " <<
+                    expected_size << " < " <<
+                    MDRawMemory64List_minsize +
+                        region_count * sizeof(MDMemoryDescriptor64);
+    return false;
+  }
 
+  if (region_count != 0) {
+    if (!minidump_->AccountAllocation(
+            region_count *
+            (sizeof(MDMemoryDescriptor64) + sizeof(MinidumpMemoryRegion)))) {
+      BPLOG(ERROR) << "MinidumpMemoryList memory64 count " << region_count <<
+                      " exceeds the minidump's allocation budget";
+      return false;
+    }
 
-void MinidumpMemoryList::Print() {
-  if (!valid_) {
-    BPLOG(ERROR) << "MinidumpMemoryList cannot print invalid data";
-    return;
-  }
+    scoped_ptr<MemoryDescriptors64> descriptors(
+        new MemoryDescriptors64(static_cast<size_t>(region_count)));
 
-  printf("MinidumpMemoryList\n");
-  printf("  region_count = %d\n", region_count_);
+    // Read the entire array in one fell swoop, instead of reading one entry
+    // at a time in the loop.
+    if (!minidump_->ReadBytes(
+            &(*descriptors)[0],
+            sizeof(MDMemoryDescriptor64) * static_cast<size_t>(region_count))) {
+      BPLOG(ERROR) << "MinidumpMemoryList could not read memory64 region "
+                      "list";
+      return false;
+    }
+
+    regions->resize(static_cast<size_t>(region_count),
+                    MinidumpMemoryRegion(minidump_));
+
+    // The payload is contiguous: region i's bytes start where region
+    // i-1's end, so each region's file offset is base_rva plus the sizes
+    // of the regions before it.  Only the offsets are computed here; the
+    // regions' contents are read on demand.
+    uint64_t file_offset = base_rva;
+    for (unsigned int region_index = 0;
+         region_index < region_count;
+         ++region_index) {
+      MDMemoryDescriptor64* descriptor = &(*descriptors)[region_index];
+
+      if (minidump_->swap())
+        Swap(descriptor);
+
+      uint64_t base_address = descriptor->start_of_memory_range;
+      uint64_t region_size = descriptor->data_size;
+
+      // Check for base + size overflow or undersize, and for the
+      // payload running off the end of any addressable file.
+      if (region_size == 0 ||
+          region_size > numeric_limits<uint64_t>::max() - base_address ||
+          region_size > numeric_limits<uint64_t>::max() - file_offset) {
+        BPLOG(ERROR) << "MinidumpMemoryList has a memory64 region "
+                        "problem, region " << region_index << "/" <<
+                        region_count << ", " << HexString(base_address) <<
+                        "+" << HexString(region_size);
+        return false;
+      }
+
+      (*regions)[region_index].SetDescriptor64(descriptor, file_offset);
+      file_offset += region_size;
+    }
+
+    descriptors64_ = descriptors.release();
+  }
+
+  *region_count_out = static_cast<uint32_t>(region_count);
+  return true;
+}
+
+
+MinidumpMemoryRegion* MinidumpMemoryList::GetMemoryRegionAtIndex(
+      unsigned int index) {
+  if (!valid_) {
+    BPLOG(ERROR) << "Invalid MinidumpMemoryList for GetMemoryRegionAtIndex";
+    return NULL;
+  }
+
+  if (index >= region_count_) {
+    BPLOG(ERROR) << "MinidumpMemoryList index out of range: " <<
+                    index << "/" << region_count_;
+    return NULL;
+  }
+
+  return &(*regions_)[index];
+}
+
+
+MinidumpMemoryRegion* MinidumpMemoryList::GetMemoryRegionForAddress(
+    uint64_t address) {
+  if (!valid_) {
+    BPLOG(ERROR) << "Invalid MinidumpMemoryList for GetMemoryRegionForAddress";
+    return NULL;
+  }
+
+  if (intervals_) {
+    // Find the last interval whose base address is not greater than
+    // address, then check whether it reaches address.
+    MemoryIntervals::const_iterator iterator =
+        std::upper_bound(intervals_->begin(), intervals_->end(),
+                         address, AddressBeforeInterval);
+    if (iterator != intervals_->begin()) {
+      --iterator;
+      if (address - iterator->base_address < iterator->size) {
+        return GetMemoryRegionAtIndex(iterator->region_index);
+      }
+    }
+  }
+
+  BPLOG(INFO) << "MinidumpMemoryList has no memory region at " <<
+                 HexString(address);
+  return NULL;
+}
+
+
+void MinidumpMemoryList::Print() {
+  if (!valid_) {
+    BPLOG(ERROR) << "MinidumpMemoryList cannot print invalid data";
+    return;
+  }
+
+  printf("MinidumpMemoryList\n");
+  printf("  region_count = %d\n", region_count_);
   printf("\n");
 
   for (unsigned int region_index = 0;
        region_index < region_count_;
        ++region_index) {
-    MDMemoryDescriptor* descriptor = &(*descriptors_)[region_index];
     printf("region[%d]\n", region_index);
-    printf("MDMemoryDescriptor\n");
-    printf("  start_of_memory_range = 0x%" PRIx64 "\n",
-           descriptor->start_of_memory_range);
-    printf("  memory.data_size      = 0x%x\n", descriptor->memory.data_size);
-    printf("  memory.rva            = 0x%x\n", descriptor->memory.rva);
+    if (is_memory64_) {
+      MDMemoryDescriptor64* descriptor = &(*descriptors64_)[region_index];
+      printf("MDMemoryDescriptor64\n");
+      printf("  start_of_memory_range = 0x%" PRIx64 "\n",
+             descriptor->start_of_memory_range);
+      printf("  data_size             = 0x%" PRIx64 "\n",
+             descriptor->data_size);
+    } else {
+      MDMemoryDescriptor* descriptor = &(*descriptors_)[region_index];
+      printf("MDMemoryDescriptor\n");
+      printf("  start_of_memory_range = 0x%" PRIx64 "\n",
+             descriptor->start_of_memory_range);
+      printf("  memory.data_size      = 0x%x\n", descriptor->memory.data_size);
+      printf("  memory.rva            = 0x%x\n", descriptor->memory.rva);
+    }
     MinidumpMemoryRegion* region = GetMemoryRegionAtIndex(region_index);
     if (region) {
       printf("Memory\n");
@@ -2811,6 +3336,16 @@ void MinidumpMemoryList::Print() {
 }
 
 
+//
+// MinidumpMemory64List
+//
+
+
+MinidumpMemory64List::MinidumpMemory64List(Minidump* minidump)
+    : MinidumpMemoryList(minidump, true) {
+}
+
+
 //
 // MinidumpException
 //
@@ -2824,13 +3359,12 @@ MinidumpException::MinidumpException(Minidump* minidump)
 
 
 MinidumpException::~MinidumpException() {
-  delete context_;
+  // context_, if set, lives in the Minidump's arena.
 }
 
 
 bool MinidumpException::Read(uint32_t expected_size) {
   // Invalidate cached data.
-  delete context_;
   context_ = NULL;
 
   valid_ = false;
@@ -2898,7 +3432,9 @@ MinidumpContext* MinidumpException::GetContext() {
       return NULL;
     }
 
-    scoped_ptr<MinidumpContext> context(new MinidumpContext(minidump_));
+    MinidumpContext* context =
+        new (minidump_->AllocateBytes(sizeof(MinidumpContext)))
+            MinidumpContext(minidump_);
 
     // Don't log as an error if we can still fall back on the thread's context
     // (which must be possible if we got this far.)
@@ -2907,7 +3443,7 @@ MinidumpContext* MinidumpException::GetContext() {
       return NULL;
     }
 
-    context_ = context.release();
+    context_ = context;
   }
 
   return context_;
@@ -3786,8 +4322,20 @@ Minidump::Minidump(const string& path)
       stream_map_(new MinidumpStreamMap()),
       path_(path),
       stream_(NULL),
+      mapped_base_(NULL),
+      mapped_size_(0),
+      mapped_position_(0),
+      decompressed_(NULL),
+      mapped_owned_(false),
+      arena_blocks_(),
+      arena_next_(NULL),
+      arena_remaining_(0),
+      use_mmap_(false),
+      allocation_budget_(0),
+      allocated_bytes_(0),
       swap_(false),
       valid_(false) {
+  InitializeReadState();
 }
 
 Minidump::Minidump(istream& stream)
@@ -3796,24 +4344,116 @@ Minidump::Minidump(istream& stream)
       stream_map_(new MinidumpStreamMap()),
       path_(),
       stream_(&stream),
+      mapped_base_(NULL),
+      mapped_size_(0),
+      mapped_position_(0),
+      decompressed_(NULL),
+      mapped_owned_(false),
+      arena_blocks_(),
+      arena_next_(NULL),
+      arena_remaining_(0),
+      use_mmap_(false),
+      allocation_budget_(0),
+      allocated_bytes_(0),
+      swap_(false),
+      valid_(false) {
+  InitializeReadState();
+}
+
+Minidump::Minidump(const void* buffer, size_t size)
+    : header_(),
+      directory_(NULL),
+      stream_map_(new MinidumpStreamMap()),
+      path_(),
+      stream_(NULL),
+      mapped_base_(static_cast<const uint8_t*>(buffer)),
+      mapped_size_(size),
+      mapped_position_(0),
+      decompressed_(NULL),
+      mapped_owned_(false),
+      arena_blocks_(),
+      arena_next_(NULL),
+      arena_remaining_(0),
+      use_mmap_(false),
+      allocation_budget_(0),
+      allocated_bytes_(0),
       swap_(false),
       valid_(false) {
+  InitializeReadState();
+}
+
+void Minidump::InitializeReadState() {
+#ifndef _WIN32
+  cursor_key_valid_ = pthread_key_create(&cursor_key_, NULL) == 0;
+
+  // stream_lock_ must be recursive: GetStream holds it while a stream
+  // reads itself, and reading a thread context consults the system
+  // info stream through another GetStream call.
+  pthread_mutexattr_t attributes;
+  pthread_mutexattr_init(&attributes);
+  pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&stream_lock_, &attributes);
+  pthread_mutexattr_destroy(&attributes);
+
+  pthread_mutex_init(&arena_lock_, NULL);
+#endif  // _WIN32
 }
 
 Minidump::~Minidump() {
-  if (stream_) {
+  if (stream_ || mapped_base_) {
     BPLOG(INFO) << "Minidump closing minidump";
   }
   if (!path_.empty()) {
     delete stream_;
   }
+#ifndef _WIN32
+  if (mapped_base_ && mapped_owned_) {
+    munmap(const_cast<uint8_t*>(mapped_base_), mapped_size_);
+  }
+#endif  // _WIN32
+  delete decompressed_;
   delete directory_;
   delete stream_map_;
+  for (unsigned int block_index = 0;
+       block_index < arena_blocks_.size();
+       ++block_index) {
+    delete[] arena_blocks_[block_index];
+  }
+#ifndef _WIN32
+  if (cursor_key_valid_) {
+    pthread_key_delete(cursor_key_);
+  }
+  pthread_mutex_destroy(&stream_lock_);
+  pthread_mutex_destroy(&arena_lock_);
+#endif  // _WIN32
+}
+
+off_t Minidump::cursor_position() const {
+#ifndef _WIN32
+  if (cursor_key_valid_) {
+    uintptr_t biased =
+        reinterpret_cast<uintptr_t>(pthread_getspecific(cursor_key_));
+    return biased ? static_cast<off_t>(biased - 1) : 0;
+  }
+#endif  // _WIN32
+  return mapped_position_;
+}
+
+void Minidump::set_cursor_position(off_t position) {
+#ifndef _WIN32
+  if (cursor_key_valid_) {
+    pthread_setspecific(
+        cursor_key_,
+        reinterpret_cast<void*>(static_cast<uintptr_t>(position) + 1));
+    return;
+  }
+#endif  // _WIN32
+  mapped_position_ = position;
 }
 
 
 bool Minidump::Open() {
-  if (stream_ != NULL) {
+  if (stream_ != NULL || mapped_base_ != NULL) {
     BPLOG(INFO) << "Minidump reopening minidump " << path_;
 
     // The file is already open.  Seek to the beginning, which is the position
@@ -3821,6 +4461,52 @@ bool Minidump::Open() {
     return SeekSet(0);
   }
 
+  // A .dmp.gz or .dmp.zst processes directly: decompress the whole file
+  // into memory and read it through the memory-backed path.  Seeking in
+  // a compressed stream is impractical, so the stream and mmap paths do
+  // not apply.
+  if (IsCompressedFile(path_)) {
+    scoped_ptr<string> contents(new string());
+    if (!ReadCompressedFile(path_, contents.get())) {
+      BPLOG(ERROR) << "Minidump could not decompress minidump " << path_;
+      return false;
+    }
+    decompressed_ = contents.release();
+    mapped_base_ = reinterpret_cast<const uint8_t*>(decompressed_->data());
+    mapped_size_ = decompressed_->size();
+    mapped_position_ = 0;
+    BPLOG(INFO) << "Minidump decompressed minidump " << path_;
+    return true;
+  }
+
+#ifndef _WIN32
+  if (use_mmap_) {
+    // Map the entire file read-only.  On failure, fall through to the
+    // istream path below so that minidumps on filesystems that don't
+    // support mmap can still be read.
+    int fd = open(path_.c_str(), O_RDONLY | O_BINARY);
+    if (fd != -1) {
+      struct stat stat_buf;
+      if (fstat(fd, &stat_buf) == 0 && stat_buf.st_size > 0) {
+        void* mapping = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_PRIVATE,
+                             fd, 0);
+        if (mapping != MAP_FAILED) {
+          mapped_base_ = static_cast<const uint8_t*>(mapping);
+          mapped_size_ = stat_buf.st_size;
+          mapped_position_ = 0;
+          mapped_owned_ = true;
+          close(fd);
+          BPLOG(INFO) << "Minidump mapped minidump " << path_;
+          return true;
+        }
+      }
+      close(fd);
+    }
+    BPLOG(INFO) << "Minidump could not map minidump " << path_ <<
+                   ", falling back to stream I/O";
+  }
+#endif  // _WIN32
+
   stream_ = new ifstream(path_.c_str(), std::ios::in | std::ios::binary);
   if (!stream_ || !stream_->good()) {
     string error_string;
@@ -3834,6 +4520,27 @@ bool Minidump::Open() {
   return true;
 }
 
+off_t Minidump::DumpSize() {
+  if (mapped_base_) {
+    return mapped_size_;
+  }
+  if (!stream_) {
+    return -1;
+  }
+  off_t saved_position = stream_->tellg();
+  if (saved_position == -1) {
+    return -1;
+  }
+  stream_->seekg(0, std::ios_base::end);
+  off_t size = stream_->tellg();
+  stream_->seekg(saved_position, std::ios_base::beg);
+  if (!stream_->good()) {
+    return -1;
+  }
+  return size;
+}
+
+
 bool Minidump::GetContextCPUFlagsFromSystemInfo(uint32_t *context_cpu_flags) {
   // Initialize output parameters
   *context_cpu_flags = 0;
@@ -3974,7 +4681,22 @@ bool Minidump::Read() {
     return false;
   }
 
+  // Determine the dump's total size, so that each directory entry's
+  // location can be bounds-checked up front.  Rejecting a malformed
+  // directory here costs microseconds; failing deep inside an individual
+  // stream's Read method happens only after allocation and parsing work,
+  // and bogus length fields checked against a bogus stream size can
+  // cause very large allocations before the failure surfaces.
+  off_t dump_size = DumpSize();
+
   if (header_.stream_count != 0) {
+    if (!AccountAllocation(static_cast<uint64_t>(header_.stream_count) *
+                           sizeof(MDRawDirectory))) {
+      BPLOG(ERROR) << "Minidump stream count " << header_.stream_count <<
+                      " exceeds the minidump's allocation budget";
+      return false;
+    }
+
     scoped_ptr<MinidumpDirectoryEntries> directory(
         new MinidumpDirectoryEntries(header_.stream_count));
 
@@ -3996,6 +4718,20 @@ bool Minidump::Read() {
         Swap(&directory_entry->location);
       }
 
+      if (dump_size != -1 &&
+          (directory_entry->location.rva >
+               static_cast<uint64_t>(dump_size) ||
+           directory_entry->location.data_size >
+               static_cast<uint64_t>(dump_size) -
+                   directory_entry->location.rva)) {
+        BPLOG(ERROR) << "Minidump stream " << stream_index << "/" <<
+                        header_.stream_count << " location out of range: " <<
+                        HexString(directory_entry->location.rva) << "+" <<
+                        directory_entry->location.data_size << "/" <<
+                        dump_size;
+        return false;
+      }
+
       // Initialize the stream_map_ map, which speeds locating a stream by
       // type.
       unsigned int stream_type = directory_entry->stream_type;
@@ -4003,6 +4739,7 @@ bool Minidump::Read() {
         case MD_THREAD_LIST_STREAM:
         case MD_MODULE_LIST_STREAM:
         case MD_MEMORY_LIST_STREAM:
+        case MD_MEMORY_64_LIST_STREAM:
         case MD_EXCEPTION_STREAM:
         case MD_SYSTEM_INFO_STREAM:
         case MD_MISC_INFO_STREAM:
@@ -4033,6 +4770,105 @@ bool Minidump::Read() {
 }
 
 
+void Minidump::Prefetch() {
+  if (!valid_ || !directory_) {
+    return;
+  }
+
+  // The streams MinidumpProcessor reads during ordinary processing.
+  static const uint32_t kPrefetchStreamTypes[] = {
+    MD_THREAD_LIST_STREAM,
+    MD_MODULE_LIST_STREAM,
+    MD_MEMORY_LIST_STREAM,
+    MD_EXCEPTION_STREAM,
+    MD_SYSTEM_INFO_STREAM,
+    MD_MISC_INFO_STREAM,
+    MD_BREAKPAD_INFO_STREAM
+  };
+
+  vector<MDLocationDescriptor> locations;
+  for (size_t type_index = 0;
+       type_index < sizeof(kPrefetchStreamTypes) / sizeof(uint32_t);
+       ++type_index) {
+    MinidumpStreamMap::const_iterator iterator =
+        stream_map_->find(kPrefetchStreamTypes[type_index]);
+    if (iterator == stream_map_->end()) {
+      continue;
+    }
+    const MDRawDirectory& entry =
+        (*directory_)[iterator->second.stream_index];
+    if (entry.location.data_size != 0) {
+      locations.push_back(entry.location);
+    }
+  }
+  if (locations.empty()) {
+    return;
+  }
+
+#ifndef _WIN32
+  if (mapped_base_) {
+    for (size_t location_index = 0;
+         location_index < locations.size();
+         ++location_index) {
+      const MDLocationDescriptor& location = locations[location_index];
+      if (location.rva > mapped_size_ ||
+          location.data_size > mapped_size_ - location.rva) {
+        continue;
+      }
+      // madvise operates on page-aligned addresses.
+      size_t page_mask = getpagesize() - 1;
+      uintptr_t start =
+          reinterpret_cast<uintptr_t>(mapped_base_ + location.rva) &
+          ~static_cast<uintptr_t>(page_mask);
+      size_t length =
+          (reinterpret_cast<uintptr_t>(mapped_base_ + location.rva) - start) +
+          location.data_size;
+      madvise(reinterpret_cast<void*>(start), length, MADV_WILLNEED);
+    }
+    return;
+  }
+#endif  // _WIN32
+
+  off_t saved_position = Tell();
+  if (saved_position == -1) {
+    return;
+  }
+
+  // Read through each stream's extent in file-offset order.  The data is
+  // discarded; the point is to pull it into the operating system's cache
+  // with sequential I/O before the per-stream Read methods issue their
+  // scattered small reads.
+  vector<uint64_t> offsets;
+  for (size_t location_index = 0;
+       location_index < locations.size();
+       ++location_index) {
+    offsets.push_back((static_cast<uint64_t>(locations[location_index].rva)
+                       << 32) | locations[location_index].data_size);
+  }
+  std::sort(offsets.begin(), offsets.end());
+
+  uint8_t buffer[16384];
+  for (size_t offset_index = 0; offset_index < offsets.size();
+       ++offset_index) {
+    uint32_t rva = static_cast<uint32_t>(offsets[offset_index] >> 32);
+    uint32_t remaining = static_cast<uint32_t>(offsets[offset_index]);
+    if (!SeekSet(rva)) {
+      break;
+    }
+    while (remaining > 0) {
+      size_t read_size = remaining < sizeof(buffer) ?
+          remaining : sizeof(buffer);
+      if (!ReadBytes(buffer, read_size)) {
+        break;
+      }
+      remaining -= read_size;
+    }
+  }
+
+  SeekSet(saved_position);
+}
+
+
 MinidumpThreadList* Minidump::GetThreadList() {
   MinidumpThreadList* thread_list;
   return GetStream(&thread_list);
@@ -4046,6 +4882,14 @@ MinidumpModuleList* Minidump::GetModuleList() {
 
 
 MinidumpMemoryList* Minidump::GetMemoryList() {
+  // Full-memory dumps from 64-bit Windows carry their memory regions in
+  // a MEMORY_64_LIST_STREAM.  Prefer it when present: a 32-bit list in
+  // the same dump describes at most a subset of the same memory.
+  if (valid_ &&
+      stream_map_->find(MD_MEMORY_64_LIST_STREAM) != stream_map_->end()) {
+    MinidumpMemory64List* memory64_list;
+    return GetStream(&memory64_list);
+  }
   MinidumpMemoryList* memory_list;
   return GetStream(&memory_list);
 }
@@ -4056,6 +4900,93 @@ MinidumpException* Minidump::GetException() {
   return GetStream(&exception);
 }
 
+//
+// MinidumpIPTrace
+//
+
+
+MinidumpIPTrace::MinidumpIPTrace(Minidump* minidump)
+    : MinidumpStream(minidump),
+      ip_trace_(),
+      ips_() {
+}
+
+
+bool MinidumpIPTrace::Read(uint32_t expected_size) {
+  valid_ = false;
+  ips_.clear();
+
+  if (expected_size < sizeof(ip_trace_)) {
+    BPLOG(ERROR) << "MinidumpIPTrace size mismatch, " << expected_size <<
+                    " < " << sizeof(ip_trace_);
+    return false;
+  }
+
+  if (!minidump_->ReadBytes(&ip_trace_, sizeof(ip_trace_))) {
+    BPLOG(ERROR) << "MinidumpIPTrace cannot read IP trace header";
+    return false;
+  }
+
+  if (minidump_->swap()) {
+    Swap(&ip_trace_.thread_id);
+    Swap(&ip_trace_.ip_count);
+  }
+
+  if (expected_size != sizeof(ip_trace_) +
+                       ip_trace_.ip_count * sizeof(uint64_t)) {
+    BPLOG(ERROR) << "MinidumpIPTrace size mismatch, " << expected_size <<
+                    " != " << sizeof(ip_trace_) +
+                              ip_trace_.ip_count * sizeof(uint64_t);
+    return false;
+  }
+
+  if (ip_trace_.ip_count == 0) {
+    BPLOG(ERROR) << "MinidumpIPTrace has no instruction pointers";
+    return false;
+  }
+
+  if (!minidump_->AccountAllocation(
+          static_cast<uint64_t>(ip_trace_.ip_count) * sizeof(uint64_t))) {
+    BPLOG(ERROR) << "MinidumpIPTrace instruction pointer count " <<
+                    ip_trace_.ip_count <<
+                    " exceeds the minidump's allocation budget";
+    return false;
+  }
+
+  ips_.resize(ip_trace_.ip_count);
+  if (!minidump_->ReadBytes(&ips_[0],
+                            ip_trace_.ip_count * sizeof(uint64_t))) {
+    BPLOG(ERROR) << "MinidumpIPTrace cannot read instruction pointers";
+    return false;
+  }
+
+  if (minidump_->swap()) {
+    for (uint32_t ip_index = 0; ip_index < ip_trace_.ip_count; ++ip_index) {
+      Swap(&ips_[ip_index]);
+    }
+  }
+
+  valid_ = true;
+  return true;
+}
+
+
+void MinidumpIPTrace::Print() {
+  if (!valid_) {
+    BPLOG(ERROR) << "MinidumpIPTrace cannot print invalid data";
+    return;
+  }
+
+  printf("MDRawIPTrace\n");
+  printf("  thread_id = 0x%x\n", ip_trace_.thread_id);
+  printf("  ip_count  = %d\n", ip_trace_.ip_count);
+  for (uint32_t ip_index = 0; ip_index < ip_trace_.ip_count; ++ip_index) {
+    printf("  ips[%2d]   = 0x%" PRIx64 "\n", ip_index, ips_[ip_index]);
+  }
+  printf("\n");
+}
+
+
 MinidumpAssertion* Minidump::GetAssertion() {
   MinidumpAssertion* assertion;
   return GetStream(&assertion);
@@ -4079,12 +5010,63 @@ MinidumpBreakpadInfo* Minidump::GetBreakpadInfo() {
   return GetStream(&breakpad_info);
 }
 
+MinidumpIPTrace* Minidump::GetIPTrace() {
+  MinidumpIPTrace* ip_trace;
+  return GetStream(&ip_trace);
+}
+
 MinidumpMemoryInfoList* Minidump::GetMemoryInfoList() {
   MinidumpMemoryInfoList* memory_info_list;
   return GetStream(&memory_info_list);
 }
 
 
+bool Minidump::RegisterStreamParser(uint32_t stream_type,
+                                    StreamFactory factory) {
+  if (!factory) {
+    BPLOG(ERROR) << "RegisterStreamParser requires a factory for stream "
+                    "type " << stream_type;
+    return false;
+  }
+
+  // The built-in types already have parsers, and the typed Get* methods
+  // downcast the stream cache's slot for their type on the assumption
+  // that nothing else can populate it.
+  switch (stream_type) {
+    case MD_THREAD_LIST_STREAM:
+    case MD_MODULE_LIST_STREAM:
+    case MD_MEMORY_LIST_STREAM:
+    case MD_MEMORY_64_LIST_STREAM:
+    case MD_EXCEPTION_STREAM:
+    case MD_SYSTEM_INFO_STREAM:
+    case MD_MISC_INFO_STREAM:
+    case MD_BREAKPAD_INFO_STREAM:
+    case MD_ASSERTION_INFO_STREAM:
+    case MD_MEMORY_INFO_LIST_STREAM:
+    case MD_IP_TRACE_STREAM:
+      BPLOG(ERROR) << "RegisterStreamParser cannot replace the built-in "
+                      "parser for stream type " << stream_type;
+      return false;
+  }
+
+  registered_stream_parsers_[stream_type] = factory;
+  return true;
+}
+
+
+MinidumpStream* Minidump::GetRegisteredStream(uint32_t stream_type) {
+  map<uint32_t, StreamFactory>::const_iterator parser =
+      registered_stream_parsers_.find(stream_type);
+  if (parser == registered_stream_parsers_.end()) {
+    BPLOG(ERROR) << "GetRegisteredStream has no parser for stream type " <<
+                    stream_type;
+    return NULL;
+  }
+
+  return GetCachedStream(stream_type, parser->second);
+}
+
+
 void Minidump::Print() {
   if (!valid_) {
     BPLOG(ERROR) << "Minidump cannot print invalid data";
@@ -4129,7 +5111,9 @@ void Minidump::Print() {
        iterator != stream_map_->end();
        ++iterator) {
     uint32_t stream_type = iterator->first;
-    MinidumpStreamInfo info = iterator->second;
+    // By reference: a MinidumpStreamInfo copy would delete the cached
+    // stream object when it went out of scope.
+    const MinidumpStreamInfo& info = iterator->second;
     printf("  stream type 0x%x at index %d\n", stream_type, info.stream_index);
   }
   printf("\n");
@@ -4156,6 +5140,18 @@ const MDRawDirectory* Minidump::GetDirectoryEntryAtIndex(unsigned int index)
 bool Minidump::ReadBytes(void* bytes, size_t count) {
   // Can't check valid_ because Read needs to call this method before
   // validity can be determined.
+  if (mapped_base_) {
+    off_t position = cursor_position();
+    if (count > mapped_size_ ||
+        static_cast<size_t>(position) > mapped_size_ - count) {
+      BPLOG(ERROR) << "ReadBytes: read " <<
+                      (mapped_size_ - position) << "/" << count;
+      return false;
+    }
+    memcpy(bytes, mapped_base_ + position, count);
+    set_cursor_position(position + count);
+    return true;
+  }
   if (!stream_) {
     return false;
   }
@@ -4178,6 +5174,14 @@ bool Minidump::ReadBytes(void* bytes, size_t count) {
 bool Minidump::SeekSet(off_t offset) {
   // Can't check valid_ because Read needs to call this method before
   // validity can be determined.
+  if (mapped_base_) {
+    if (offset < 0 || static_cast<size_t>(offset) > mapped_size_) {
+      BPLOG(ERROR) << "SeekSet: offset " << offset << " out of range";
+      return false;
+    }
+    set_cursor_position(offset);
+    return true;
+  }
   if (!stream_) {
     return false;
   }
@@ -4192,7 +5196,13 @@ bool Minidump::SeekSet(off_t offset) {
 }
 
 off_t Minidump::Tell() {
-  if (!valid_ || !stream_) {
+  if (!valid_) {
+    return (off_t)-1;
+  }
+  if (mapped_base_) {
+    return cursor_position();
+  }
+  if (!stream_) {
     return (off_t)-1;
   }
 
@@ -4200,6 +5210,78 @@ off_t Minidump::Tell() {
 }
 
 
+// The granularity of arena growth in Minidump::AllocateBytes.  Large
+// enough that even a thread-heavy dump's contexts fit in a handful of
+// blocks.
+static const size_t kMinidumpArenaBlockSize = 16384;
+
+
+void* Minidump::AllocateBytes(size_t size) {
+  // Keep every allocation 8-byte aligned, which satisfies the MDRaw*
+  // structures; the blocks themselves come from new[] and are at least
+  // that strictly aligned.
+  size = (size + 7) & ~static_cast<size_t>(7);
+
+#ifndef _WIN32
+  pthread_mutex_lock(&arena_lock_);
+#endif
+  if (size > arena_remaining_) {
+    size_t block_size = kMinidumpArenaBlockSize;
+    if (size > block_size)
+      block_size = size;
+    uint8_t* block = new uint8_t[block_size];
+    arena_blocks_.push_back(block);
+    arena_next_ = block;
+    arena_remaining_ = block_size;
+  }
+
+  void* storage = arena_next_;
+  arena_next_ += size;
+  arena_remaining_ -= size;
+#ifndef _WIN32
+  pthread_mutex_unlock(&arena_lock_);
+#endif
+  return storage;
+}
+
+
+bool Minidump::AccountAllocation(uint64_t bytes) {
+  if (allocation_budget_ == 0)
+    return true;
+
+#ifndef _WIN32
+  pthread_mutex_lock(&arena_lock_);
+#endif
+  bool within_budget = bytes <= allocation_budget_ &&
+                       allocated_bytes_ <= allocation_budget_ - bytes;
+  if (within_budget)
+    allocated_bytes_ += bytes;
+#ifndef _WIN32
+  pthread_mutex_unlock(&arena_lock_);
+#endif
+
+  BPLOG_IF(ERROR, !within_budget) << "Minidump allocation of " << bytes <<
+                                     " bytes would exceed budget of " <<
+                                     allocation_budget_ << " (" <<
+                                     allocated_bytes_ << " already charged)";
+  return within_budget;
+}
+
+
+const uint8_t* Minidump::GetMappedBytes(off_t offset, size_t count) const {
+  if (!mapped_base_) {
+    return NULL;
+  }
+  if (offset < 0 || count > mapped_size_ ||
+      static_cast<size_t>(offset) > mapped_size_ - count) {
+    BPLOG(INFO) << "GetMappedBytes request out of range: " <<
+                   offset << "+" << count << "/" << mapped_size_;
+    return NULL;
+  }
+  return mapped_base_ + offset;
+}
+
+
 string* Minidump::ReadString(off_t offset) {
   if (!valid_) {
     BPLOG(ERROR) << "Invalid Minidump for ReadString";
@@ -4233,6 +5315,13 @@ string* Minidump::ReadString(off_t offset) {
     return NULL;
   }
 
+  if (!AccountAllocation(bytes)) {
+    BPLOG(ERROR) << "ReadString string length " << utf16_words <<
+                    " exceeds the minidump's allocation budget at offset " <<
+                    offset;
+    return NULL;
+  }
+
   vector<uint16_t> string_utf16(utf16_words);
 
   if (utf16_words) {
@@ -4266,7 +5355,10 @@ bool Minidump::SeekToStreamType(uint32_t  stream_type,
     return false;
   }
 
-  MinidumpStreamInfo info = iterator->second;
+  // By reference: a MinidumpStreamInfo copy would delete the cached
+  // stream object when it went out of scope, leaving the stream map
+  // holding a dangling pointer.
+  const MinidumpStreamInfo& info = iterator->second;
   if (info.stream_index >= header_.stream_count) {
     BPLOG(ERROR) << "SeekToStreamType: type " << stream_type <<
                     " out of range: " <<
@@ -4287,6 +5379,125 @@ bool Minidump::SeekToStreamType(uint32_t  stream_type,
 }
 
 
+bool Minidump::ScanModules(bool read_cv_records,
+                           vector<MinidumpScannedModule>* modules) {
+  BPLOG_IF(ERROR, !modules) << "Minidump::ScanModules requires |modules|";
+  assert(modules);
+  modules->clear();
+
+  if (!valid_) {
+    BPLOG(ERROR) << "Invalid Minidump for ScanModules";
+    return false;
+  }
+
+  uint32_t expected_size;
+  if (!SeekToStreamType(MD_MODULE_LIST_STREAM, &expected_size)) {
+    BPLOG(INFO) << "ScanModules found no module list stream";
+    return false;
+  }
+
+  // The stream layout checks below mirror MinidumpModuleList::Read.
+  uint32_t module_count;
+  if (expected_size < sizeof(module_count)) {
+    BPLOG(ERROR) << "ScanModules count size mismatch, " <<
+                    expected_size << " < " << sizeof(module_count);
+    return false;
+  }
+  if (!ReadBytes(&module_count, sizeof(module_count))) {
+    BPLOG(ERROR) << "ScanModules could not read module count";
+    return false;
+  }
+
+  if (swap_)
+    Swap(&module_count);
+
+  if (module_count > numeric_limits<uint32_t>::max() / MD_MODULE_SIZE) {
+    BPLOG(ERROR) << "ScanModules module count " << module_count <<
+                    " would cause multiplication overflow";
+    return false;
+  }
+
+  if (expected_size != sizeof(module_count) +
+                       module_count * MD_MODULE_SIZE) {
+    // may be padded with 4 bytes on 64bit ABIs for alignment
+    if (expected_size == sizeof(module_count) + 4 +
+                         module_count * MD_MODULE_SIZE) {
+      uint32_t useless;
+      if (!ReadBytes(&useless, 4)) {
+        BPLOG(ERROR) << "ScanModules cannot read modulelist padded bytes";
+        return false;
+      }
+    } else {
+      BPLOG(ERROR) << "ScanModules size mismatch, " << expected_size <<
+                      " != " << sizeof(module_count) +
+                      module_count * MD_MODULE_SIZE;
+      return false;
+    }
+  }
+
+  if (module_count > MinidumpModuleList::max_modules()) {
+    BPLOG(ERROR) << "ScanModules count " << module_count <<
+                    " exceeds maximum " << MinidumpModuleList::max_modules();
+    return false;
+  }
+
+  modules->reserve(module_count);
+
+  if (module_count != 0) {
+    // Decode the contiguous MDRawModule array in one sequential pass,
+    // deferring the name and CodeView reads - which seek around - to a
+    // second pass, as MinidumpModuleList::Read does.  The scratch
+    // MinidumpModule objects only live for the duration of the scan;
+    // callers get plain structs.
+    vector<MinidumpModule> scratch(module_count, MinidumpModule(this));
+
+    for (uint32_t module_index = 0;
+         module_index < module_count;
+         ++module_index) {
+      // Assume that the file offset is correct after the last read.
+      if (!scratch[module_index].Read()) {
+        BPLOG(ERROR) << "ScanModules could not read module " <<
+                        module_index << "/" << module_count;
+        return false;
+      }
+    }
+
+    for (uint32_t module_index = 0;
+         module_index < module_count;
+         ++module_index) {
+      MinidumpModule* module = &scratch[module_index];
+
+      // As in MinidumpModuleList::Read, a module whose debugging record
+      // can't be handled is still usable if its name was read.
+      if (!module->ReadLeanAuxiliaryData(read_cv_records) &&
+          !module->valid()) {
+        BPLOG(ERROR) << "ScanModules could not read module name for "
+                        "module " << module_index << "/" << module_count;
+        return false;
+      }
+
+      MinidumpScannedModule scanned;
+      scanned.base_of_image = module->base_address();
+      scanned.size_of_image = module->size();
+      scanned.code_file = module->code_file();
+      if (read_cv_records) {
+        scanned.debug_file = module->debug_file();
+        scanned.debug_identifier = module->debug_identifier();
+      }
+      modules->push_back(scanned);
+    }
+  }
+
+  return true;
+}
+
+
+template<typename T>
+MinidumpStream* Minidump::AllocateStream(Minidump* minidump) {
+  return new T(minidump);
+}
+
+
 template<typename T>
 T* Minidump::GetStream(T** stream) {
   // stream is a garbage parameter that's present only to account for C++'s
@@ -4297,17 +5508,37 @@ T* Minidump::GetStream(T** stream) {
   BPLOG_IF(ERROR, !stream) << "Minidump::GetStream type " << stream_type <<
                               " requires |stream|";
   assert(stream);
-  *stream = NULL;
 
+  // This cast is safe because the cache slot for a built-in stream type
+  // is only ever populated with a T: RegisterStreamParser refuses to
+  // install a factory for the types handled here.
+  *stream = static_cast<T*>(GetCachedStream(stream_type,
+                                            &Minidump::AllocateStream<T>));
+  return *stream;
+}
+
+
+MinidumpStream* Minidump::GetCachedStream(uint32_t stream_type,
+                                          StreamFactory factory) {
   if (!valid_) {
     BPLOG(ERROR) << "Invalid Minidump for GetStream type " << stream_type;
     return NULL;
   }
 
+  // Concurrent readers of a memory-backed dump may request streams at
+  // the same time; hold stream_lock_ so only one of them populates the
+  // cache entry and the others wait for (and then share) its result.
+#ifndef _WIN32
+  pthread_mutex_lock(&stream_lock_);
+#endif
+
   MinidumpStreamMap::iterator iterator = stream_map_->find(stream_type);
   if (iterator == stream_map_->end()) {
     // This stream type didn't exist in the directory.
     BPLOG(INFO) << "GetStream: type " << stream_type << " not present";
+#ifndef _WIN32
+    pthread_mutex_unlock(&stream_lock_);
+#endif
     return NULL;
   }
 
@@ -4315,28 +5546,45 @@ T* Minidump::GetStream(T** stream) {
   MinidumpStreamInfo* info = &iterator->second;
 
   if (info->stream) {
-    // This cast is safe because info.stream is only populated by this
-    // method, and there is a direct correlation between T and stream_type.
-    *stream = static_cast<T*>(info->stream);
-    return *stream;
+#ifndef _WIN32
+    pthread_mutex_unlock(&stream_lock_);
+#endif
+    return info->stream;
   }
 
   uint32_t stream_length;
   if (!SeekToStreamType(stream_type, &stream_length)) {
     BPLOG(ERROR) << "GetStream could not seek to stream type " << stream_type;
+#ifndef _WIN32
+    pthread_mutex_unlock(&stream_lock_);
+#endif
     return NULL;
   }
 
-  scoped_ptr<T> new_stream(new T(this));
+  scoped_ptr<MinidumpStream> new_stream(factory(this));
+
+  if (!new_stream.get()) {
+    BPLOG(ERROR) << "GetStream factory produced no object for stream type " <<
+                    stream_type;
+#ifndef _WIN32
+    pthread_mutex_unlock(&stream_lock_);
+#endif
+    return NULL;
+  }
 
   if (!new_stream->Read(stream_length)) {
     BPLOG(ERROR) << "GetStream could not read stream type " << stream_type;
+#ifndef _WIN32
+    pthread_mutex_unlock(&stream_lock_);
+#endif
     return NULL;
   }
 
-  *stream = new_stream.release();
-  info->stream = *stream;
-  return *stream;
+  info->stream = new_stream.release();
+#ifndef _WIN32
+  pthread_mutex_unlock(&stream_lock_);
+#endif
+  return info->stream;
 }
 
 
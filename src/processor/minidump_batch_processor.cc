@@ -0,0 +1,398 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_batch_processor.cc: Implementation of MinidumpBatchProcessor.
+//
+// See minidump_batch_processor.h for documentation.
+
+#include "google_breakpad/processor/minidump_batch_processor.h"
+
+#include <assert.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#endif
+
+#include <map>
+
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/minidump.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+// State shared by the workers of one ProcessAll call.  Workers claim
+// unprocessed entries under lock, and process each with their own
+// MinidumpProcessor against the session's shared symbolizer.
+struct MinidumpBatchProcessor::WorkPool {
+#ifndef _WIN32
+  pthread_mutex_t lock;
+#endif
+  size_t next_entry;
+  std::vector<Entry*>* entries;
+  StackFrameSymbolizer* frame_symbolizer;
+  bool enable_exploitability;
+  // Number of NUMA nodes the session's workers are spread over; 1
+  // unless the session is numa_aware on a multi-node Linux machine.
+  unsigned int node_count;
+#if defined(__linux__)
+  // Per-node CPU sets workers pin themselves to, node_count entries,
+  // or NULL when node_count is 1.
+  const std::vector<cpu_set_t>* node_cpus;
+#endif
+};
+
+// The per-thread argument of WorkerMain: the shared pool plus the NUMA
+// node this worker serves.
+struct MinidumpBatchProcessor::WorkerArg {
+  WorkPool* pool;
+  unsigned int node;
+};
+
+#if defined(__linux__)
+// Fills in one CPU set per NUMA node the kernel exposes under
+// /sys/devices/system/node, and returns the node count.  A machine
+// without the sysfs nodes (or with one node) reports no useful
+// topology and the session runs as if numa_aware were off.
+static size_t ReadNodeCpuSets(std::vector<cpu_set_t>* sets) {
+  sets->clear();
+  for (int node = 0; ; ++node) {
+    char path[64];
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/node/node%d/cpulist", node);
+    FILE* file = fopen(path, "r");
+    if (!file) {
+      break;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    char list[512];
+    if (fgets(list, sizeof(list), file)) {
+      // The cpulist is comma-separated CPU ranges, e.g. "0-7,16-23".
+      char* cursor = list;
+      while (*cursor && *cursor != '\n') {
+        long first = strtol(cursor, &cursor, 10);
+        long last = first;
+        if (*cursor == '-') {
+          last = strtol(cursor + 1, &cursor, 10);
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+          CPU_SET(cpu, &set);
+        }
+        if (*cursor != ',') {
+          break;
+        }
+        ++cursor;
+      }
+    }
+    fclose(file);
+    sets->push_back(set);
+  }
+  return sets->size();
+}
+
+// Fingerprints a dump by the code files of its module list, so dumps
+// of the same program land in the same node bucket without being fully
+// processed.  Reading the directory and module list touches only a few
+// KB of the file.  Unreadable dumps all fingerprint to zero and share
+// a bucket; they will fail identically during processing.
+static uint64_t ModuleListSignature(const string& minidump_file) {
+  Minidump dump(minidump_file);
+  if (!dump.Read()) {
+    return 0;
+  }
+  MinidumpModuleList* modules = dump.GetModuleList();
+  if (!modules) {
+    return 0;
+  }
+  uint64_t hash = 14695981039346656037ull;  // FNV-1a
+  for (unsigned int sequence = 0;
+       sequence < modules->module_count();
+       ++sequence) {
+    const MinidumpModule* module = modules->GetModuleAtSequence(sequence);
+    if (!module) {
+      continue;
+    }
+    const string code_file = module->code_file();
+    for (size_t index = 0; index < code_file.size(); ++index) {
+      hash ^= static_cast<uint8_t>(code_file[index]);
+      hash *= 1099511628211ull;
+    }
+    hash ^= static_cast<uint8_t>('\0');
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+#endif  // __linux__
+
+MinidumpBatchProcessor::MinidumpBatchProcessor(
+    StackFrameSymbolizer* frame_symbolizer,
+    bool enable_exploitability)
+    : frame_symbolizer_(frame_symbolizer),
+      enable_exploitability_(enable_exploitability),
+      max_worker_threads_(1),
+      numa_aware_(false),
+      entries_(),
+      intern_pool_() {
+  assert(frame_symbolizer_);
+}
+
+MinidumpBatchProcessor::~MinidumpBatchProcessor() {
+  for (size_t index = 0; index < entries_.size(); ++index) {
+    delete entries_[index];
+  }
+}
+
+size_t MinidumpBatchProcessor::AddMinidumpFile(const string& minidump_file) {
+  entries_.push_back(new Entry(minidump_file));
+  return entries_.size() - 1;
+}
+
+// static
+MinidumpBatchProcessor::Entry* MinidumpBatchProcessor::ClaimEntry(
+    WorkPool* pool, unsigned int node) {
+#ifndef _WIN32
+  pthread_mutex_lock(&pool->lock);
+#endif
+  Entry* entry = NULL;
+  if (pool->node_count <= 1) {
+    // Single node: every entry is equally good, so a cursor claims
+    // each entry exactly once without scanning.
+    while (pool->next_entry < pool->entries->size()) {
+      Entry* candidate = (*pool->entries)[pool->next_entry++];
+      if (!candidate->processed) {
+        entry = candidate;
+        break;
+      }
+    }
+  } else {
+    // Prefer entries dispatched to this worker's node; when the node's
+    // share is exhausted, steal from the other nodes rather than leave
+    // the worker idle for the tail of the batch.
+    for (int stealing = 0; stealing <= 1 && !entry; ++stealing) {
+      for (size_t index = 0; index < pool->entries->size(); ++index) {
+        Entry* candidate = (*pool->entries)[index];
+        if (candidate->processed || candidate->claimed) {
+          continue;
+        }
+        if (!stealing && candidate->preferred_node != node) {
+          continue;
+        }
+        entry = candidate;
+        break;
+      }
+    }
+    if (entry) {
+      entry->claimed = true;
+    }
+  }
+#ifndef _WIN32
+  pthread_mutex_unlock(&pool->lock);
+#endif
+  return entry;
+}
+
+// static
+void MinidumpBatchProcessor::ProcessEntries(WorkPool* pool,
+                                            unsigned int node) {
+  // One processor per worker: the processor itself is cheap, and every
+  // processor shares the session's symbolizer, so module loads are
+  // deduplicated across all dumps in the batch.
+  MinidumpProcessor processor(pool->frame_symbolizer,
+                              pool->enable_exploitability);
+  processor.set_reset_symbolizer_per_dump(false);
+
+  Entry* entry;
+  while ((entry = ClaimEntry(pool, node)) != NULL) {
+    entry->result = processor.Process(entry->minidump_file,
+                                      &entry->process_state);
+    entry->processed = true;
+  }
+}
+
+#ifndef _WIN32
+// static
+void* MinidumpBatchProcessor::WorkerMain(void* arg) {
+  WorkerArg* worker = static_cast<WorkerArg*>(arg);
+#if defined(__linux__)
+  if (worker->pool->node_count > 1) {
+    // Best effort: an affinity failure costs locality, not
+    // correctness.
+    sched_setaffinity(0, sizeof(cpu_set_t),
+                      &(*worker->pool->node_cpus)[worker->node]);
+  }
+#endif
+  ProcessEntries(worker->pool, worker->node);
+  return NULL;
+}
+#endif  // _WIN32
+
+void MinidumpBatchProcessor::AssignPreferredNodes(unsigned int node_count) {
+#if defined(__linux__)
+  // One node per distinct module list, assigned round-robin as new
+  // fingerprints appear, so every group's modules are fetched, parsed
+  // and first touched - hence allocated - on the node that will keep
+  // symbolizing against them.
+  std::map<uint64_t, unsigned int> node_by_signature;
+  unsigned int next_node = 0;
+  for (size_t index = 0; index < entries_.size(); ++index) {
+    Entry* entry = entries_[index];
+    if (entry->processed) {
+      continue;
+    }
+    const uint64_t signature = ModuleListSignature(entry->minidump_file);
+    std::map<uint64_t, unsigned int>::iterator found =
+        node_by_signature.find(signature);
+    if (found == node_by_signature.end()) {
+      found = node_by_signature.insert(
+          std::make_pair(signature, next_node)).first;
+      next_node = (next_node + 1) % node_count;
+    }
+    entry->preferred_node = found->second;
+  }
+#endif  // __linux__
+}
+
+size_t MinidumpBatchProcessor::ProcessAll() {
+  // Reset the symbolizer's missing-symbol memo once for the whole
+  // batch: a symbol file absent when the batch was assembled is absent
+  // for all of its dumps.  Workers must not reset it per dump while
+  // other workers are symbolizing.
+  frame_symbolizer_->Reset();
+
+  // All frames in the batch intern their strings in the session's pool;
+  // a per-dump pool cannot be used once dumps run concurrently.
+  frame_symbolizer_->set_session_intern_pool(&intern_pool_);
+
+  WorkPool pool;
+  pool.next_entry = 0;
+  pool.entries = &entries_;
+  pool.frame_symbolizer = frame_symbolizer_;
+  pool.enable_exploitability = enable_exploitability_;
+  pool.node_count = 1;
+#if defined(__linux__)
+  pool.node_cpus = NULL;
+#endif
+
+  size_t pending = 0;
+  for (size_t index = 0; index < entries_.size(); ++index) {
+    if (!entries_[index]->processed) {
+      ++pending;
+    }
+  }
+
+#ifndef _WIN32
+  pthread_mutex_init(&pool.lock, NULL);
+
+  unsigned int worker_count = max_worker_threads_;
+  if (worker_count > pending) {
+    worker_count = static_cast<unsigned int>(pending);
+  }
+
+#if defined(__linux__)
+  std::vector<cpu_set_t> node_cpus;
+  if (numa_aware_ && worker_count > 1 && ReadNodeCpuSets(&node_cpus) > 1) {
+    pool.node_count = static_cast<unsigned int>(node_cpus.size());
+    pool.node_cpus = &node_cpus;
+    AssignPreferredNodes(pool.node_count);
+  }
+#endif
+
+  // The calling thread processes dumps too, so only worker_count - 1
+  // extra threads are started; if none can be started this degrades to
+  // the serial path.
+  unsigned int started = 0;
+  std::vector<pthread_t> workers;
+  std::vector<WorkerArg> worker_args;
+  if (worker_count > 1) {
+    workers.resize(worker_count - 1);
+    worker_args.resize(worker_count - 1);
+    while (started < worker_count - 1) {
+      worker_args[started].pool = &pool;
+      // The calling thread serves node 0; extra workers cycle through
+      // the remaining nodes first so every node gets a worker before
+      // any node gets two.
+      worker_args[started].node = (started + 1) % pool.node_count;
+      if (pthread_create(&workers[started], NULL, WorkerMain,
+                         &worker_args[started]) != 0) {
+        BPLOG(ERROR) << "Failed to create batch worker thread";
+        break;
+      }
+      ++started;
+    }
+  }
+
+#if defined(__linux__)
+  // The calling thread works node 0; its affinity is restored after
+  // the batch so the session does not leak a pinning the caller never
+  // asked to keep.
+  cpu_set_t caller_cpus;
+  bool restore_caller_cpus = false;
+  if (pool.node_count > 1 &&
+      sched_getaffinity(0, sizeof(caller_cpus), &caller_cpus) == 0 &&
+      sched_setaffinity(0, sizeof(cpu_set_t), &node_cpus[0]) == 0) {
+    restore_caller_cpus = true;
+  }
+#endif
+
+  ProcessEntries(&pool, 0);
+
+  for (unsigned int worker_index = 0; worker_index < started; ++worker_index) {
+    pthread_join(workers[worker_index], NULL);
+  }
+
+#if defined(__linux__)
+  if (restore_caller_cpus) {
+    sched_setaffinity(0, sizeof(caller_cpus), &caller_cpus);
+  }
+#endif
+
+  pthread_mutex_destroy(&pool.lock);
+#else
+  ProcessEntries(&pool, 0);
+#endif  // _WIN32
+
+  frame_symbolizer_->set_session_intern_pool(NULL);
+
+  size_t succeeded = 0;
+  for (size_t index = 0; index < entries_.size(); ++index) {
+    if (entries_[index]->processed && entries_[index]->result == PROCESS_OK) {
+      ++succeeded;
+    }
+  }
+  return succeeded;
+}
+
+}  // namespace google_breakpad
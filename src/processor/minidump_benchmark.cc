@@ -0,0 +1,331 @@
+// Copyright (c) 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_benchmark.cc: Measure MinidumpProcessor performance on
+// synthetic minidumps.
+//
+// This harness fabricates a corpus of in-memory minidumps with
+// SynthMinidump - sweeping thread count, stack depth, module count and
+// raw memory payload - and repeatedly processes each one, reporting
+// throughput, mean and p99 latency, and the process's peak resident set
+// size.  Because the dumps are synthesized, results are exactly
+// reproducible from one build to the next, which makes the numbers
+// suitable for catching performance regressions at review time.
+//
+// The synthetic stacks are chains of x86 frame pointers, so the walker
+// exercises the traditional ebp-based unwind on every frame; no symbols
+// are supplied, keeping the measurement about the processor itself
+// rather than symbol file I/O.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "common/scoped_ptr.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/minidump.h"
+#include "google_breakpad/processor/minidump_processor.h"
+#include "google_breakpad/processor/process_state.h"
+#include "processor/logging.h"
+#include "processor/synth_minidump.h"
+
+namespace {
+
+using std::vector;
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::Minidump;
+using google_breakpad::MinidumpProcessor;
+using google_breakpad::ProcessState;
+using google_breakpad::scoped_ptr;
+using google_breakpad::SynthMinidump::Context;
+using google_breakpad::SynthMinidump::Dump;
+using google_breakpad::SynthMinidump::Memory;
+using google_breakpad::SynthMinidump::Module;
+using google_breakpad::SynthMinidump::String;
+using google_breakpad::SynthMinidump::SystemInfo;
+using google_breakpad::SynthMinidump::Thread;
+using google_breakpad::test_assembler::kLittleEndian;
+
+// One point in the parameter sweep.
+struct BenchmarkConfig {
+  unsigned int thread_count;
+  unsigned int stack_depth;
+  unsigned int module_count;
+  unsigned int extra_memory_kb;  // simulates full-memory dump payload
+};
+
+// The default corpus, from a dump smaller than anything seen in
+// production up to one larger than the common case in every dimension.
+const BenchmarkConfig kDefaultCorpus[] = {
+  {  1,  16,   4,    0 },
+  {  8,  32,  32,    0 },
+  { 32,  64, 128,    0 },
+  {  8,  32,  32, 1024 },
+  { 64, 128, 256, 4096 },
+};
+
+// Synthetic address space layout.  Modules are spaced widely enough
+// that no sweep configuration overlaps them, and stacks likewise.
+const uint64_t kModuleBaseAddress = 0x40000000;
+const uint64_t kModuleSpacing = 0x100000;
+const uint32_t kModuleSize = 0x10000;
+const uint64_t kStackBaseAddress = 0x20000000;
+const uint64_t kStackSpacing = 0x10000;
+const uint64_t kExtraMemoryAddress = 0x60000000;
+
+static uint64_t NowMicroseconds() {
+#ifndef _WIN32
+  struct timeval time_now;
+  gettimeofday(&time_now, NULL);
+  return static_cast<uint64_t>(time_now.tv_sec) * 1000000 + time_now.tv_usec;
+#else
+  return 0;
+#endif
+}
+
+// Returns the peak resident set size of this process in kilobytes, or 0
+// where the measurement is unavailable.
+static uint64_t PeakResidentKB() {
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    return static_cast<uint64_t>(usage.ru_maxrss);
+  }
+#endif
+  return 0;
+}
+
+// Builds a synthetic x86 minidump for the given configuration and
+// returns its bytes in contents.  Each thread's stack is a chain of
+// stack_depth frame-pointer frames whose return addresses rotate
+// through the module list, terminated by a zero saved ebp.
+static bool BuildDump(const BenchmarkConfig &config, string *contents) {
+  Dump dump(0, kLittleEndian);
+
+  // Sections are cited by the dump until Finish, so they are owned here
+  // and freed only after GetContents.
+  vector<google_breakpad::SynthMinidump::Section*> sections;
+
+  String *csd_version = new String(dump, SystemInfo::windows_x86_csd_version);
+  SystemInfo *system_info =
+      new SystemInfo(dump, SystemInfo::windows_x86, *csd_version);
+  dump.Add(system_info);
+  dump.Add(csd_version);
+  sections.push_back(csd_version);
+  sections.push_back(system_info);
+
+  for (unsigned int module_index = 0;
+       module_index < config.module_count;
+       ++module_index) {
+    char name_buffer[32];
+    snprintf(name_buffer, sizeof(name_buffer), "module_%u.dll", module_index);
+    String *name = new String(dump, name_buffer);
+    Module *module = new Module(
+        dump,
+        kModuleBaseAddress + module_index * kModuleSpacing,
+        kModuleSize,
+        *name);
+    dump.Add(name);
+    dump.Add(module);
+    sections.push_back(name);
+    sections.push_back(module);
+  }
+
+  for (unsigned int thread_index = 0;
+       thread_index < config.thread_count;
+       ++thread_index) {
+    uint64_t stack_base = kStackBaseAddress + thread_index * kStackSpacing;
+    Memory *stack = new Memory(dump, stack_base);
+    for (unsigned int frame = 0; frame < config.stack_depth; ++frame) {
+      uint64_t frame_address = stack_base + frame * 8;
+      bool last_frame = frame + 1 == config.stack_depth;
+      // Saved ebp links to the next frame; the return address lands in
+      // the text of one of the synthesized modules.
+      stack->D32(last_frame ? 0 : static_cast<uint32_t>(frame_address + 8));
+      stack->D32(last_frame ? 0 : static_cast<uint32_t>(
+          kModuleBaseAddress +
+          (frame % config.module_count) * kModuleSpacing +
+          0x1000 + frame * 16));
+    }
+
+    MDRawContextX86 raw_context;
+    memset(&raw_context, 0, sizeof(raw_context));
+    raw_context.context_flags = MD_CONTEXT_X86_FULL;
+    raw_context.eip = static_cast<uint32_t>(kModuleBaseAddress + 0x1000);
+    raw_context.esp = static_cast<uint32_t>(stack_base);
+    raw_context.ebp = static_cast<uint32_t>(stack_base);
+    Context *context = new Context(dump, raw_context);
+
+    Thread *thread = new Thread(dump, 0x1000 + thread_index, *stack, *context);
+    dump.Add(stack);
+    dump.Add(context);
+    dump.Add(thread);
+    sections.push_back(stack);
+    sections.push_back(context);
+    sections.push_back(thread);
+  }
+
+  if (config.extra_memory_kb) {
+    Memory *extra = new Memory(dump, kExtraMemoryAddress);
+    extra->Append(config.extra_memory_kb * 1024, 0xab);
+    dump.Add(extra);
+    sections.push_back(extra);
+  }
+
+  dump.Finish();
+  bool ok = dump.GetContents(contents);
+
+  for (size_t index = 0; index < sections.size(); ++index) {
+    delete sections[index];
+  }
+  return ok;
+}
+
+// Processes the dump in contents iteration_count times and prints one
+// result line for the configuration.  Returns false if any iteration
+// fails to process.
+static bool RunConfiguration(const BenchmarkConfig &config,
+                             unsigned int iteration_count,
+                             unsigned int worker_threads) {
+  string contents;
+  if (!BuildDump(config, &contents)) {
+    fprintf(stderr, "minidump_benchmark: could not synthesize dump "
+            "(threads=%u depth=%u modules=%u extra_kb=%u)\n",
+            config.thread_count, config.stack_depth, config.module_count,
+            config.extra_memory_kb);
+    return false;
+  }
+
+  // One resolver and processor serve every iteration, as a long-lived
+  // processing service would; the resolver stays empty because no
+  // symbol supplier is configured.
+  BasicSourceLineResolver resolver;
+  MinidumpProcessor processor(NULL, &resolver);
+  processor.set_max_worker_threads(worker_threads);
+
+  vector<uint64_t> latencies_us;
+  latencies_us.reserve(iteration_count);
+  uint64_t total_frames = 0;
+
+  for (unsigned int iteration = 0; iteration < iteration_count; ++iteration) {
+    Minidump minidump(contents.data(), contents.size());
+    ProcessState process_state;
+    uint64_t start_us = NowMicroseconds();
+    if (!minidump.Read() ||
+        processor.Process(&minidump, &process_state) !=
+            google_breakpad::PROCESS_OK) {
+      fprintf(stderr, "minidump_benchmark: processing failed "
+              "(threads=%u depth=%u modules=%u extra_kb=%u)\n",
+              config.thread_count, config.stack_depth, config.module_count,
+              config.extra_memory_kb);
+      return false;
+    }
+    latencies_us.push_back(NowMicroseconds() - start_us);
+    total_frames += process_state.processing_stats()->total_frames;
+  }
+
+  std::sort(latencies_us.begin(), latencies_us.end());
+  uint64_t total_us = 0;
+  for (size_t index = 0; index < latencies_us.size(); ++index) {
+    total_us += latencies_us[index];
+  }
+  uint64_t mean_us = total_us / latencies_us.size();
+  uint64_t p99_us = latencies_us[latencies_us.size() * 99 / 100];
+  double throughput =
+      total_us ? latencies_us.size() * 1e6 / total_us : 0;
+
+  printf("threads=%-3u depth=%-4u modules=%-4u extra_kb=%-5u "
+         "size_kb=%-6u frames=%-8" PRIu64 " %8.1f dumps/s  "
+         "mean %" PRIu64 " us  p99 %" PRIu64 " us  peak RSS %" PRIu64 " KB\n",
+         config.thread_count, config.stack_depth, config.module_count,
+         config.extra_memory_kb,
+         static_cast<unsigned int>(contents.size() / 1024),
+         total_frames / iteration_count,
+         throughput, mean_us, p99_us, PeakResidentKB());
+  return true;
+}
+
+static void usage(const char *program_name) {
+  fprintf(stderr, "usage: %s [-i iterations] [-w worker_threads]\n"
+          "    -i  iterations per configuration (default 50)\n"
+          "    -w  stack-walking worker threads (default 1)\n",
+          program_name);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  BPLOG_INIT(&argc, &argv);
+
+  // The benchmark's per-dump INFO logging would dominate the run.
+  google_breakpad::LogStream::set_min_severity(
+      google_breakpad::LogStream::SEVERITY_ERROR);
+
+  unsigned int iteration_count = 50;
+  unsigned int worker_threads = 1;
+
+  int argument_index = 1;
+  while (argument_index < argc) {
+    if (strcmp(argv[argument_index], "-i") == 0 &&
+        argument_index + 1 < argc) {
+      iteration_count = atoi(argv[++argument_index]);
+    } else if (strcmp(argv[argument_index], "-w") == 0 &&
+               argument_index + 1 < argc) {
+      worker_threads = atoi(argv[++argument_index]);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+    ++argument_index;
+  }
+  if (iteration_count == 0 || worker_threads == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  size_t config_count = sizeof(kDefaultCorpus) / sizeof(kDefaultCorpus[0]);
+  for (size_t config_index = 0; config_index < config_count; ++config_index) {
+    if (!RunConfiguration(kDefaultCorpus[config_index], iteration_count,
+                          worker_threads)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -33,8 +33,12 @@
 // Author: Mark Mentovai
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <set>
+#include <string>
+
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/minidump.h"
 #include "processor/logging.h"
@@ -42,6 +46,7 @@
 namespace {
 
 using google_breakpad::Minidump;
+using google_breakpad::MinidumpMemoryRegion;
 using google_breakpad::MinidumpThreadList;
 using google_breakpad::MinidumpModuleList;
 using google_breakpad::MinidumpMemoryInfoList;
@@ -52,6 +57,41 @@ using google_breakpad::MinidumpSystemInfo;
 using google_breakpad::MinidumpMiscInfo;
 using google_breakpad::MinidumpBreakpadInfo;
 
+// The stream names accepted by -x, each covering one of the Print
+// blocks below.  The raw MD_LINUX_* text streams are grouped under
+// "linux".
+static const char *const kStreamNames[] = {
+  "thread-list",
+  "module-list",
+  "memory-list",
+  "exception",
+  "assertion",
+  "system-info",
+  "misc-info",
+  "breakpad-info",
+  "memory-info-list",
+  "linux",
+};
+
+// What PrintMinidumpDump prints.  The defaults reproduce the
+// traditional output: every stream, every byte of every memory region.
+struct Options {
+  Options() : summary_only(false), stream_filter() {}
+
+  // Print only the minidump header and stream directory.
+  bool summary_only;
+
+  // When non-empty, print only the named streams.
+  std::set<std::string> stream_filter;
+};
+
+// Returns true if the stream named |name| should be printed under
+// |options|.
+static bool StreamSelected(const Options &options, const char *name) {
+  return options.stream_filter.empty() ||
+         options.stream_filter.count(name) != 0;
+}
+
 static void DumpRawStream(Minidump *minidump,
                           uint32_t stream_type,
                           const char *stream_name,
@@ -91,7 +131,8 @@ static void DumpRawStream(Minidump *minidump,
   printf("\n\n");
 }
 
-static bool PrintMinidumpDump(const char *minidump_file) {
+static bool PrintMinidumpDump(const char *minidump_file,
+                              const Options &options) {
   Minidump minidump(minidump_file);
   if (!minidump.Read()) {
     BPLOG(ERROR) << "minidump.Read() failed";
@@ -99,115 +140,195 @@ static bool PrintMinidumpDump(const char *minidump_file) {
   }
   minidump.Print();
 
+  // The header and stream directory printed above are all a summary
+  // asks for; no stream contents are read at all.
+  if (options.summary_only) {
+    return true;
+  }
+
   int errors = 0;
 
-  MinidumpThreadList *thread_list = minidump.GetThreadList();
-  if (!thread_list) {
-    ++errors;
-    BPLOG(ERROR) << "minidump.GetThreadList() failed";
-  } else {
-    thread_list->Print();
-  }
-
-  MinidumpModuleList *module_list = minidump.GetModuleList();
-  if (!module_list) {
-    ++errors;
-    BPLOG(ERROR) << "minidump.GetModuleList() failed";
-  } else {
-    module_list->Print();
-  }
-
-  MinidumpMemoryList *memory_list = minidump.GetMemoryList();
-  if (!memory_list) {
-    ++errors;
-    BPLOG(ERROR) << "minidump.GetMemoryList() failed";
-  } else {
-    memory_list->Print();
-  }
-
-  MinidumpException *exception = minidump.GetException();
-  if (!exception) {
-    BPLOG(INFO) << "minidump.GetException() failed";
-  } else {
-    exception->Print();
-  }
-
-  MinidumpAssertion *assertion = minidump.GetAssertion();
-  if (!assertion) {
-    BPLOG(INFO) << "minidump.GetAssertion() failed";
-  } else {
-    assertion->Print();
-  }
-
-  MinidumpSystemInfo *system_info = minidump.GetSystemInfo();
-  if (!system_info) {
-    ++errors;
-    BPLOG(ERROR) << "minidump.GetSystemInfo() failed";
-  } else {
-    system_info->Print();
-  }
-
-  MinidumpMiscInfo *misc_info = minidump.GetMiscInfo();
-  if (!misc_info) {
-    ++errors;
-    BPLOG(ERROR) << "minidump.GetMiscInfo() failed";
-  } else {
-    misc_info->Print();
-  }
-
-  MinidumpBreakpadInfo *breakpad_info = minidump.GetBreakpadInfo();
-  if (!breakpad_info) {
-    // Breakpad info is optional, so don't treat this as an error.
-    BPLOG(INFO) << "minidump.GetBreakpadInfo() failed";
-  } else {
-    breakpad_info->Print();
-  }
-
-  MinidumpMemoryInfoList *memory_info_list = minidump.GetMemoryInfoList();
-  if (!memory_info_list) {
-    ++errors;
-    BPLOG(ERROR) << "minidump.GetMemoryInfoList() failed";
-  } else {
-    memory_info_list->Print();
-  }
-
-  DumpRawStream(&minidump,
-                MD_LINUX_CMD_LINE,
-                "MD_LINUX_CMD_LINE",
-                &errors);
-  DumpRawStream(&minidump,
-                MD_LINUX_ENVIRON,
-                "MD_LINUX_ENVIRON",
-                &errors);
-  DumpRawStream(&minidump,
-                MD_LINUX_LSB_RELEASE,
-                "MD_LINUX_LSB_RELEASE",
-                &errors);
-  DumpRawStream(&minidump,
-                MD_LINUX_PROC_STATUS,
-                "MD_LINUX_PROC_STATUS",
-                &errors);
-  DumpRawStream(&minidump,
-                MD_LINUX_CPU_INFO,
-                "MD_LINUX_CPU_INFO",
-                &errors);
-  DumpRawStream(&minidump,
-                MD_LINUX_MAPS,
-                "MD_LINUX_MAPS",
-                &errors);
+  if (StreamSelected(options, "thread-list")) {
+    MinidumpThreadList *thread_list = minidump.GetThreadList();
+    if (!thread_list) {
+      ++errors;
+      BPLOG(ERROR) << "minidump.GetThreadList() failed";
+    } else {
+      thread_list->Print();
+    }
+  }
+
+  if (StreamSelected(options, "module-list")) {
+    MinidumpModuleList *module_list = minidump.GetModuleList();
+    if (!module_list) {
+      ++errors;
+      BPLOG(ERROR) << "minidump.GetModuleList() failed";
+    } else {
+      module_list->Print();
+    }
+  }
+
+  if (StreamSelected(options, "memory-list")) {
+    MinidumpMemoryList *memory_list = minidump.GetMemoryList();
+    if (!memory_list) {
+      ++errors;
+      BPLOG(ERROR) << "minidump.GetMemoryList() failed";
+    } else {
+      memory_list->Print();
+    }
+  }
+
+  if (StreamSelected(options, "exception")) {
+    MinidumpException *exception = minidump.GetException();
+    if (!exception) {
+      BPLOG(INFO) << "minidump.GetException() failed";
+    } else {
+      exception->Print();
+    }
+  }
+
+  if (StreamSelected(options, "assertion")) {
+    MinidumpAssertion *assertion = minidump.GetAssertion();
+    if (!assertion) {
+      BPLOG(INFO) << "minidump.GetAssertion() failed";
+    } else {
+      assertion->Print();
+    }
+  }
+
+  if (StreamSelected(options, "system-info")) {
+    MinidumpSystemInfo *system_info = minidump.GetSystemInfo();
+    if (!system_info) {
+      ++errors;
+      BPLOG(ERROR) << "minidump.GetSystemInfo() failed";
+    } else {
+      system_info->Print();
+    }
+  }
+
+  if (StreamSelected(options, "misc-info")) {
+    MinidumpMiscInfo *misc_info = minidump.GetMiscInfo();
+    if (!misc_info) {
+      ++errors;
+      BPLOG(ERROR) << "minidump.GetMiscInfo() failed";
+    } else {
+      misc_info->Print();
+    }
+  }
+
+  if (StreamSelected(options, "breakpad-info")) {
+    MinidumpBreakpadInfo *breakpad_info = minidump.GetBreakpadInfo();
+    if (!breakpad_info) {
+      // Breakpad info is optional, so don't treat this as an error.
+      BPLOG(INFO) << "minidump.GetBreakpadInfo() failed";
+    } else {
+      breakpad_info->Print();
+    }
+  }
+
+  if (StreamSelected(options, "memory-info-list")) {
+    MinidumpMemoryInfoList *memory_info_list = minidump.GetMemoryInfoList();
+    if (!memory_info_list) {
+      ++errors;
+      BPLOG(ERROR) << "minidump.GetMemoryInfoList() failed";
+    } else {
+      memory_info_list->Print();
+    }
+  }
+
+  if (StreamSelected(options, "linux")) {
+    DumpRawStream(&minidump,
+                  MD_LINUX_CMD_LINE,
+                  "MD_LINUX_CMD_LINE",
+                  &errors);
+    DumpRawStream(&minidump,
+                  MD_LINUX_ENVIRON,
+                  "MD_LINUX_ENVIRON",
+                  &errors);
+    DumpRawStream(&minidump,
+                  MD_LINUX_LSB_RELEASE,
+                  "MD_LINUX_LSB_RELEASE",
+                  &errors);
+    DumpRawStream(&minidump,
+                  MD_LINUX_PROC_STATUS,
+                  "MD_LINUX_PROC_STATUS",
+                  &errors);
+    DumpRawStream(&minidump,
+                  MD_LINUX_CPU_INFO,
+                  "MD_LINUX_CPU_INFO",
+                  &errors);
+    DumpRawStream(&minidump,
+                  MD_LINUX_MAPS,
+                  "MD_LINUX_MAPS",
+                  &errors);
+  }
 
   return errors == 0;
 }
 
 }  // namespace
 
+static void usage(const char *program_name) {
+  fprintf(stderr,
+          "usage: %s [-s] [-x <stream,...>] [-b <max-bytes>] <file>\n"
+          "    -s : Print only the minidump header and stream directory\n"
+          "    -x : Print only the named streams.  Known names:\n"
+          "         thread-list, module-list, memory-list, exception,\n"
+          "         assertion, system-info, misc-info, breakpad-info,\n"
+          "         memory-info-list, linux\n"
+          "    -b : Hex-dump at most <max-bytes> of each memory region\n",
+          program_name);
+}
+
 int main(int argc, char **argv) {
   BPLOG_INIT(&argc, &argv);
 
-  if (argc != 2) {
-    fprintf(stderr, "usage: %s <file>\n", argv[0]);
+  Options options;
+
+  int argi = 1;
+  while (argi < argc && argv[argi][0] == '-') {
+    if (strcmp(argv[argi], "-s") == 0) {
+      options.summary_only = true;
+    } else if (strcmp(argv[argi], "-x") == 0 && argi + 1 < argc) {
+      // Split the comma-separated list, validating each name so a typo
+      // doesn't silently print nothing.
+      const char *name = argv[++argi];
+      while (*name) {
+        const char *end = strchr(name, ',');
+        std::string stream_name =
+            end ? std::string(name, end - name) : std::string(name);
+        bool known = false;
+        for (size_t i = 0;
+             i < sizeof(kStreamNames) / sizeof(kStreamNames[0]);
+             ++i) {
+          if (stream_name == kStreamNames[i]) {
+            known = true;
+            break;
+          }
+        }
+        if (!known) {
+          fprintf(stderr, "%s: unknown stream \"%s\"\n",
+                  argv[0], stream_name.c_str());
+          usage(argv[0]);
+          return 1;
+        }
+        options.stream_filter.insert(stream_name);
+        name = end ? end + 1 : name + stream_name.size();
+      }
+    } else if (strcmp(argv[argi], "-b") == 0 && argi + 1 < argc) {
+      MinidumpMemoryRegion::set_max_print_bytes(strtoul(argv[++argi],
+                                                        NULL, 10));
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+    ++argi;
+  }
+
+  if (argi + 1 != argc) {
+    usage(argv[0]);
     return 1;
   }
 
-  return PrintMinidumpDump(argv[1]) ? 0 : 1;
+  return PrintMinidumpDump(argv[argi], options) ? 0 : 1;
 }
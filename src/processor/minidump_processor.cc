@@ -30,15 +30,27 @@
 #include "google_breakpad/processor/minidump_processor.h"
 
 #include <assert.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <sys/time.h>
+#endif
 #include <stdio.h>
+#include <string.h>
+
+#include <map>
 
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/call_stack.h"
 #include "google_breakpad/processor/minidump.h"
 #include "google_breakpad/processor/process_state.h"
 #include "google_breakpad/processor/exploitability.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/stack_frame_cpu.h"
 #include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "google_breakpad/processor/stackwalker.h"
 #include "processor/logging.h"
+#include "processor/stack_frame_arena.h"
+#include "processor/stackwalker_arm.h"
 #include "processor/stackwalker_x86.h"
 
 namespace google_breakpad {
@@ -47,7 +59,13 @@ MinidumpProcessor::MinidumpProcessor(SymbolSupplier *supplier,
                                      SourceLineResolverInterface *resolver)
     : frame_symbolizer_(new StackFrameSymbolizer(supplier, resolver)),
       own_frame_symbolizer_(true),
-      enable_exploitability_(false) {
+      enable_exploitability_(false),
+      max_worker_threads_(1),
+      reset_symbolizer_per_dump_(true),
+      processing_time_budget_ms_(0),
+      scan_word_limit_(0),
+      scan_telemetry_(new StackScanTelemetry()),
+      prologue_layout_cache_(new PrologueLayoutCache()) {
 }
 
 MinidumpProcessor::MinidumpProcessor(SymbolSupplier *supplier,
@@ -55,19 +73,325 @@ MinidumpProcessor::MinidumpProcessor(SymbolSupplier *supplier,
                                      bool enable_exploitability)
     : frame_symbolizer_(new StackFrameSymbolizer(supplier, resolver)),
       own_frame_symbolizer_(true),
-      enable_exploitability_(enable_exploitability) {
+      enable_exploitability_(enable_exploitability),
+      max_worker_threads_(1),
+      reset_symbolizer_per_dump_(true),
+      processing_time_budget_ms_(0),
+      scan_word_limit_(0),
+      scan_telemetry_(new StackScanTelemetry()),
+      prologue_layout_cache_(new PrologueLayoutCache()) {
 }
 
 MinidumpProcessor::MinidumpProcessor(StackFrameSymbolizer *frame_symbolizer,
                                      bool enable_exploitability)
     : frame_symbolizer_(frame_symbolizer),
       own_frame_symbolizer_(false),
-      enable_exploitability_(enable_exploitability) {
+      enable_exploitability_(enable_exploitability),
+      max_worker_threads_(1),
+      reset_symbolizer_per_dump_(true),
+      processing_time_budget_ms_(0),
+      scan_word_limit_(0),
+      scan_telemetry_(new StackScanTelemetry()),
+      prologue_layout_cache_(new PrologueLayoutCache()) {
   assert(frame_symbolizer_);
 }
 
 MinidumpProcessor::~MinidumpProcessor() {
   if (own_frame_symbolizer_) delete frame_symbolizer_;
+  delete scan_telemetry_;
+  delete prologue_layout_cache_;
+}
+
+// Returns the wall clock in microseconds for the walk deadline; 0
+// where no cheap clock is available, which disables the budget.
+static uint64_t NowMicroseconds() {
+#ifndef _WIN32
+  struct timeval time_now;
+  gettimeofday(&time_now, NULL);
+  return static_cast<uint64_t>(time_now.tv_sec) * 1000000 + time_now.tv_usec;
+#else
+  return 0;
+#endif
+}
+
+// Identifies the walk-relevant state of a gathered thread: where it is
+// executing, where its stack is, and what the stack holds.  Threads of a
+// pool parked on the same wait produce byte-identical stacks; their walks
+// would repeat the same work, so Process walks one representative per
+// fingerprint and shares the resulting CallStack.
+struct ThreadStackFingerprint {
+  uint64_t instruction_pointer;
+  uint64_t stack_pointer;
+  uint64_t memory_base;
+  uint32_t memory_size;
+  uint64_t memory_hash;
+
+  bool operator<(const ThreadStackFingerprint& other) const {
+    if (instruction_pointer != other.instruction_pointer)
+      return instruction_pointer < other.instruction_pointer;
+    if (stack_pointer != other.stack_pointer)
+      return stack_pointer < other.stack_pointer;
+    if (memory_base != other.memory_base)
+      return memory_base < other.memory_base;
+    if (memory_size != other.memory_size)
+      return memory_size < other.memory_size;
+    return memory_hash < other.memory_hash;
+  }
+};
+
+// 64-bit FNV-1a over the stack bytes.  Collisions are guarded against by
+// an exact comparison before two threads are considered identical.
+static uint64_t HashStackBytes(const uint8_t* data, uint32_t size) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint32_t index = 0; index < size; ++index) {
+    hash ^= data[index];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+#ifndef _WIN32
+// The queue between the two stages of a pipelined walk.  Walkers defer
+// per-frame source line fills (see Stackwalker::set_defer_source_lines)
+// and push each finished CallStack here; a dedicated worker pops stacks
+// and resolves their frames in one batch sweep each, so symbol lookups
+// run concurrently with the unwinding of the remaining threads instead
+// of stalling it.
+struct SymbolizePipeline {
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  vector<CallStack*> queue;
+  bool closed;
+  StackFrameSymbolizer* frame_symbolizer;
+};
+
+static void EnqueueForSymbolization(SymbolizePipeline* pipeline,
+                                    CallStack* stack) {
+  pthread_mutex_lock(&pipeline->lock);
+  pipeline->queue.push_back(stack);
+  pthread_cond_signal(&pipeline->ready);
+  pthread_mutex_unlock(&pipeline->lock);
+}
+
+static void* SymbolizeWorker(void* arg) {
+  SymbolizePipeline* pipeline = static_cast<SymbolizePipeline*>(arg);
+  for (;;) {
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->queue.empty() && !pipeline->closed) {
+      pthread_cond_wait(&pipeline->ready, &pipeline->lock);
+    }
+    if (pipeline->queue.empty()) {
+      pthread_mutex_unlock(&pipeline->lock);
+      return NULL;
+    }
+    CallStack* stack = pipeline->queue.back();
+    pipeline->queue.pop_back();
+    pthread_mutex_unlock(&pipeline->lock);
+
+    vector<StackFrame*> frames(*stack->frames());
+    pipeline->frame_symbolizer->FillSourceLineInfoBatch(&frames);
+  }
+}
+
+// Per-dump state shared by the stack-walking worker threads started by
+// MinidumpProcessor::Process when max_worker_threads is greater than 1.
+// Workers claim entries of walk_slots from next_slot under lock, walk the
+// thread occupying the claimed slot, and deposit the resulting CallStack
+// back into the slot, so that results retain original thread order.
+struct StackwalkWorkPool {
+  pthread_mutex_t lock;
+  unsigned int next_slot;
+  unsigned int slot_count;
+  const unsigned int* walk_slots;
+  const SystemInfo* system_info;
+  const CodeModules* modules;
+  StackFrameSymbolizer* frame_symbolizer;
+  MinidumpContext* const* contexts;
+  MinidumpMemoryRegion* const* memories;
+  const string* thread_strings;
+  CallStack** stacks;
+  vector<const CodeModule*>* modules_without_symbols;
+  char* interrupted;
+  char* truncated;
+  uint64_t walk_deadline_us;
+  int scan_word_limit;
+  StackScanTelemetry* scan_telemetry;
+  PrologueLayoutCache* prologue_layout_cache;
+  SymbolizePipeline* symbolize_pipeline;
+};
+
+static void* StackwalkWorker(void* arg) {
+  StackwalkWorkPool* pool = static_cast<StackwalkWorkPool*>(arg);
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    unsigned int list_index = pool->next_slot++;
+    pthread_mutex_unlock(&pool->lock);
+    if (list_index >= pool->slot_count) {
+      return NULL;
+    }
+    unsigned int slot = pool->walk_slots[list_index];
+
+    scoped_ptr<Stackwalker> stackwalker(
+        Stackwalker::StackwalkerForCPU(pool->system_info,
+                                       pool->contexts[slot],
+                                       pool->memories[slot],
+                                       pool->modules,
+                                       pool->frame_symbolizer));
+
+    scoped_ptr<CallStack> stack(new CallStack());
+    if (stackwalker.get()) {
+      stackwalker->set_walk_deadline_us(pool->walk_deadline_us);
+      stackwalker->set_scan_word_limit(pool->scan_word_limit);
+      stackwalker->set_scan_telemetry(pool->scan_telemetry);
+      // Workers get the layout cache but not the dump's memory list:
+      // reading code regions goes through Minidump I/O, which is not
+      // safe off the dump's own thread.
+      stackwalker->set_prologue_layout_cache(pool->prologue_layout_cache);
+      if (pool->symbolize_pipeline) {
+        stackwalker->set_defer_source_lines(true);
+      }
+      if (!stackwalker->Walk(stack.get(),
+                             &pool->modules_without_symbols[slot])) {
+        BPLOG(INFO) << "Stackwalker interrupt (missing symbols?) at " <<
+            pool->thread_strings[slot];
+        pool->interrupted[slot] = 1;
+      }
+      if (stackwalker->walk_truncated()) {
+        pool->truncated[slot] = 1;
+      }
+    } else {
+      BPLOG(ERROR) << "No stackwalker for " << pool->thread_strings[slot];
+    }
+    pool->stacks[slot] = stack.release();
+    if (pool->symbolize_pipeline) {
+      EnqueueForSymbolization(pool->symbolize_pipeline, pool->stacks[slot]);
+    }
+  }
+}
+
+// The exploitability engine's inputs - the exception record, its context
+// and raw memory regions - are independent of the walk output, so the
+// rating is computed on this worker while the stacks are walked.  The
+// worker is the only consumer of Minidump I/O while it runs: the walking
+// passes read only stack memory cached up front by the gathering pass.
+struct ExploitabilityWork {
+  Exploitability* engine;
+  ExploitabilityRating rating;
+};
+
+static void* ExploitabilityWorker(void* arg) {
+  ExploitabilityWork* work = static_cast<ExploitabilityWork*>(arg);
+  work->rating = work->engine->CheckExploitability();
+  return NULL;
+}
+#endif  // _WIN32
+
+CallStack* MinidumpProcessor::BuildStackFromIPTrace(
+    Minidump* dump,
+    uint32_t thread_id,
+    MinidumpContext* context,
+    ProcessState* process_state) {
+  MinidumpIPTrace* trace = dump->GetIPTrace();
+  if (!trace || !trace->ips()) {
+    return NULL;
+  }
+  if (trace->thread_id() != thread_id) {
+    BPLOG(INFO) << "IP trace belongs to thread " <<
+        HexString(trace->thread_id()) << ", not requesting thread " <<
+        HexString(thread_id) << "; walking instead";
+    return NULL;
+  }
+
+  // The trace must begin at the faulting instruction pointer, or it was
+  // captured from a different state than the one being processed.
+  const vector<uint64_t>& ips = *trace->ips();
+  uint64_t instruction_pointer = 0;
+  if (!context ||
+      !context->GetInstructionPointer(&instruction_pointer) ||
+      ips[0] != instruction_pointer) {
+    BPLOG(INFO) << "IP trace does not start at the exception context's "
+                   "instruction pointer; walking instead";
+    return NULL;
+  }
+
+  // Trust the chain only when every entry lands inside a known module;
+  // a chain that ran through a corrupt frame pointer rarely does.
+  // Return addresses point just past their call instruction, so later
+  // entries are tested at address - 1, as the stackwalkers do.
+  for (size_t ip_index = 0; ip_index < ips.size(); ++ip_index) {
+    uint64_t address = ips[ip_index] - (ip_index ? 1 : 0);
+    if (!process_state->modules_ ||
+        !process_state->modules_->GetModuleForAddress(address)) {
+      BPLOG(INFO) << "IP trace entry " << ip_index << " (" <<
+          HexString(ips[ip_index]) << ") is outside every known module; "
+          "walking instead";
+      return NULL;
+    }
+  }
+
+  // Consumers downcast frames based on the dump's CPU, so build the
+  // matching frame type.  Only the x86 family writes this stream.
+  const string& cpu = process_state->system_info()->cpu;
+  if (cpu != "x86" && cpu != "amd64") {
+    BPLOG(INFO) << "IP trace present but cpu is " << cpu <<
+        "; walking instead";
+    return NULL;
+  }
+
+  // Frames live in the stack's arena, as the stackwalkers' do; CallStack's
+  // destructor runs their destructors in place.
+  scoped_ptr<CallStack> stack(new CallStack());
+  StackFrameArena* arena = stack->arena();
+  for (size_t ip_index = 0; ip_index < ips.size(); ++ip_index) {
+    StackFrame* frame;
+    if (cpu == "x86") {
+      StackFrameX86* frame_x86 = arena->New<StackFrameX86>();
+      if (ip_index == 0 && context->GetContextX86()) {
+        frame_x86->context = *context->GetContextX86();
+        frame_x86->context_validity = StackFrameX86::CONTEXT_VALID_ALL;
+      } else {
+        frame_x86->context.eip = static_cast<uint32_t>(ips[ip_index]);
+        frame_x86->context_validity = StackFrameX86::CONTEXT_VALID_EIP;
+      }
+      frame = frame_x86;
+    } else {
+      StackFrameAMD64* frame_amd64 = arena->New<StackFrameAMD64>();
+      if (ip_index == 0 && context->GetContextAMD64()) {
+        frame_amd64->context = *context->GetContextAMD64();
+        frame_amd64->context_validity = StackFrameAMD64::CONTEXT_VALID_ALL;
+      } else {
+        frame_amd64->context.rip = ips[ip_index];
+        frame_amd64->context_validity = StackFrameAMD64::CONTEXT_VALID_RIP;
+      }
+      frame = frame_amd64;
+    }
+
+    frame->trust = ip_index == 0 ? StackFrame::FRAME_TRUST_CONTEXT
+                                 : StackFrame::FRAME_TRUST_FP;
+    frame->instruction = ips[ip_index] - (ip_index ? 1 : 0);
+    stack->frames_.push_back(frame);
+  }
+
+  // The walk has been replaced by pure symbol lookups.
+  vector<StackFrame*> frames(stack->frames_);
+  frame_symbolizer_->FillSourceLineInfoBatch(&frames);
+  for (size_t ip_index = 0; ip_index < frames.size(); ++ip_index) {
+    if (!frames[ip_index]->module) {
+      // The batch fill only serves modules that are already loaded;
+      // load and fill this frame's module the ordinary way.
+      StackFrameSymbolizer::SymbolizerResult symbolizer_result =
+          frame_symbolizer_->FillSourceLineInfo(process_state->modules_,
+                                                process_state->system_info(),
+                                                frames[ip_index]);
+      if (symbolizer_result == StackFrameSymbolizer::kInterrupt) {
+        return NULL;
+      }
+    }
+  }
+
+  BPLOG(INFO) << "Built requesting thread's stack from its IP trace (" <<
+      ips.size() << " frames)";
+  return stack.release();
 }
 
 ProcessResult MinidumpProcessor::Process(
@@ -77,6 +401,16 @@ ProcessResult MinidumpProcessor::Process(
 
   process_state->Clear();
 
+  // Timings for process_state->processing_stats_ are deltas against this
+  // mark and the snapshots below; all of them stay zero where no cheap
+  // clock is available (Windows).
+  uint64_t parse_start_us = NowMicroseconds();
+
+  // Frames symbolized for this dump intern their name strings in the
+  // state that will own the frames.
+  frame_symbolizer_->set_intern_pool(process_state->intern_pool());
+  frame_symbolizer_->set_resolve_source_lines(profile_.resolve_source_lines);
+
   const MDRawHeader *header = dump->header();
   if (!header) {
     BPLOG(ERROR) << "Minidump " << dump->path() << " has no header";
@@ -84,6 +418,10 @@ ProcessResult MinidumpProcessor::Process(
   }
   process_state->time_date_stamp_ = header->time_date_stamp;
 
+  // Hint that the streams read below will be needed, so a cold-cache
+  // dump is pulled in with sequential I/O up front.
+  dump->Prefetch();
+
   bool has_cpu_info = GetCPUInfo(dump, &process_state->system_info_);
   bool has_os_info = GetOSInfo(dump, &process_state->system_info_);
 
@@ -109,13 +447,17 @@ ProcessResult MinidumpProcessor::Process(
   }
 
   // This will just return an empty string if it doesn't exist.
-  process_state->assertion_ = GetAssertion(dump);
+  if (profile_.read_assertion)
+    process_state->assertion_ = GetAssertion(dump);
 
   MinidumpModuleList *module_list = dump->GetModuleList();
 
-  // Put a copy of the module list into ProcessState object.  This is not
-  // necessarily a MinidumpModuleList, but it adheres to the CodeModules
-  // interface, which is all that ProcessState needs to expose.
+  // Put a snapshot of the module list into the ProcessState object.  This
+  // is not necessarily a MinidumpModuleList, but it adheres to the
+  // CodeModules interface, which is all that ProcessState needs to expose.
+  // The snapshot is immutable, and every later Copy() of it - by callers
+  // keeping module lists beyond the ProcessState, or by batch sessions -
+  // shares its contents instead of duplicating each module.
   if (module_list)
     process_state->modules_ = module_list->Copy();
 
@@ -139,8 +481,42 @@ ProcessResult MinidumpProcessor::Process(
   bool found_requesting_thread = false;
   unsigned int thread_count = threads->thread_count();
 
-  // Reset frame_symbolizer_ at the beginning of stackwalk for each minidump.
-  frame_symbolizer_->Reset();
+  // Exploitability defaults to EXPLOITABILITY_NOT_ANALYZED.  If a run was
+  // requested, build the engine now: its inputs (the exception record and
+  // raw memory regions) do not depend on the walk output, so the rating
+  // can be computed concurrently with the walk below.
+  process_state->exploitability_ = EXPLOITABILITY_NOT_ANALYZED;
+  scoped_ptr<Exploitability> exploitability;
+  bool exploitability_pending = false;
+  if (enable_exploitability_ && profile_.check_exploitability) {
+    exploitability.reset(
+        Exploitability::ExploitabilityForPlatform(dump, process_state));
+    if (exploitability.get()) {
+      exploitability_pending = true;
+    } else {
+      // The engine will be null if the platform is not supported.
+      process_state->exploitability_ = EXPLOITABILITY_ERR_NOENGINE;
+    }
+  }
+
+  // Reset frame_symbolizer_ at the beginning of stackwalk for each minidump,
+  // unless a batch session resets it once for all of its dumps instead.
+  if (reset_symbolizer_per_dump_)
+    frame_symbolizer_->Reset();
+
+  // Let the symbol supplier start fetching every module's symbols now,
+  // so its I/O overlaps with gathering and walking instead of stalling
+  // the first frame that touches each module.
+  frame_symbolizer_->PrefetchSymbolFiles(process_state->modules_,
+                                         process_state->system_info());
+
+  // First pass: gather each thread's context and stack memory.  This is
+  // done serially on the calling thread, because Minidump I/O is not safe
+  // for concurrent use.  Each gathered thread occupies one slot in these
+  // vectors, in original thread order.
+  vector<MinidumpContext*> contexts;
+  vector<MinidumpMemoryRegion*> memories;
+  vector<string> thread_strings;
 
   for (unsigned int thread_index = 0;
        thread_index < thread_count;
@@ -182,14 +558,14 @@ ProcessResult MinidumpProcessor::Process(
         return PROCESS_ERROR_DUPLICATE_REQUESTING_THREADS;
       }
 
-      // Use processed_state->threads_.size() instead of thread_index.
-      // thread_index points to the thread index in the minidump, which
-      // might be greater than the thread index in the threads vector if
-      // any of the minidump's threads are skipped and not placed into the
-      // processed threads vector.  The thread vector's current size will
-      // be the index of the current thread when it's pushed into the
-      // vector.
-      process_state->requesting_thread_ = process_state->threads_.size();
+      // Use the number of threads gathered so far instead of
+      // thread_index.  thread_index points to the thread index in the
+      // minidump, which might be greater than the thread index in the
+      // threads vector if any of the minidump's threads are skipped and
+      // not placed into the processed threads vector.  The number of
+      // slots gathered so far will be the index of the current thread
+      // when its stack is pushed into the vector.
+      process_state->requesting_thread_ = contexts.size();
 
       found_requesting_thread = true;
 
@@ -205,42 +581,416 @@ ProcessResult MinidumpProcessor::Process(
       }
     }
 
+    // In crashing-thread-only mode, only the requesting thread occupies
+    // a slot; the requesting-thread bookkeeping above has already run,
+    // so it lands at index 0 of the processed threads vector.
+    if (profile_.crashing_thread_only && has_requesting_thread &&
+        thread_id != requesting_thread_id) {
+      continue;
+    }
+
     MinidumpMemoryRegion *thread_memory = thread->GetMemory();
     if (!thread_memory) {
       BPLOG(ERROR) << "No memory region for " << thread_string;
+    } else if (max_worker_threads_ > 1 || exploitability_pending) {
+      // Cache the stack memory now, so that the concurrent walking pass
+      // below - or a serial walk overlapped with the exploitability
+      // worker - only reads data already in memory and never touches
+      // Minidump I/O.
+      thread_memory->GetMemory();
     }
 
-    // Use process_state->modules_ instead of module_list, because the
-    // |modules| argument will be used to populate the |module| fields in
-    // the returned StackFrame objects, which will be placed into the
-    // returned ProcessState object.  module_list's lifetime is only as
-    // long as the Minidump object: it will be deleted when this function
-    // returns.  process_state->modules_ is owned by the ProcessState object
-    // (just like the StackFrame objects), and is much more suitable for this
-    // task.
-    scoped_ptr<Stackwalker> stackwalker(
-        Stackwalker::StackwalkerForCPU(process_state->system_info(),
-                                       context,
-                                       thread_memory,
-                                       process_state->modules_,
-                                       frame_symbolizer_));
+    contexts.push_back(context);
+    memories.push_back(thread_memory);
+    thread_strings.push_back(thread_string);
+  }
 
-    scoped_ptr<CallStack> stack(new CallStack());
-    if (stackwalker.get()) {
-      if (!stackwalker->Walk(stack.get(),
-                             &process_state->modules_without_symbols_)) {
-        BPLOG(INFO) << "Stackwalker interrupt (missing symbols?) at "
-                    << thread_string;
-        interrupted = true;
+  // Fingerprint the gathered threads, so that pool threads parked on the
+  // same wait with byte-identical stacks are walked and symbolized only
+  // once.  walk_source maps every slot to the slot whose walk result it
+  // will share - itself, unless an earlier thread has the same
+  // fingerprint and the same stack bytes - and walk_slots lists the
+  // representatives, in slot order.  This still runs on the calling
+  // thread, because hashing a stack reads it through Minidump I/O.
+  unsigned int gathered_count = contexts.size();
+  vector<unsigned int> walk_source(gathered_count);
+  vector<unsigned int> walk_slots;
+  walk_slots.reserve(gathered_count);
+  std::map<ThreadStackFingerprint, unsigned int> representatives;
+  for (unsigned int slot = 0; slot < gathered_count; ++slot) {
+    walk_source[slot] = slot;
+
+    ThreadStackFingerprint fingerprint;
+    const uint8_t* stack_bytes = NULL;
+    if (contexts[slot] && memories[slot] &&
+        contexts[slot]->GetInstructionPointer(
+            &fingerprint.instruction_pointer) &&
+        contexts[slot]->GetStackPointer(&fingerprint.stack_pointer)) {
+      stack_bytes = memories[slot]->GetMemory();
+    }
+    if (stack_bytes) {
+      fingerprint.memory_base = memories[slot]->GetBase();
+      fingerprint.memory_size = memories[slot]->GetSize();
+      fingerprint.memory_hash = HashStackBytes(stack_bytes,
+                                               fingerprint.memory_size);
+      std::map<ThreadStackFingerprint, unsigned int>::const_iterator
+          representative = representatives.find(fingerprint);
+      if (representative == representatives.end()) {
+        representatives.insert(std::make_pair(fingerprint, slot));
+      } else {
+        // The hash matched; make sure the stacks really are identical
+        // before sharing a walk result.
+        const uint8_t* representative_bytes =
+            memories[representative->second]->GetMemory();
+        if (representative_bytes &&
+            memcmp(representative_bytes, stack_bytes,
+                   fingerprint.memory_size) == 0) {
+          BPLOG(INFO) << "Thread " << thread_strings[slot] <<
+              " has the same stack as " <<
+              thread_strings[representative->second] <<
+              ", sharing its walk";
+          walk_source[slot] = representative->second;
+          continue;
+        }
+      }
+    }
+    walk_slots.push_back(slot);
+  }
+
+  // The gathering pass above is the dump-parsing phase; the walking
+  // passes below operate on data already in memory.  The symbolizer's
+  // counters are cumulative across dumps, so this dump's share of its
+  // work is measured as the delta over a snapshot taken here.
+  StackFrameSymbolizer::SessionStats symbol_stats_before =
+      frame_symbolizer_->session_stats();
+  uint64_t walk_start_us = NowMicroseconds();
+  if (walk_start_us) {
+    process_state->processing_stats_.dump_parse_time_us =
+        walk_start_us - parse_start_us;
+  }
+
+  // Second pass: walk the stack of each gathered thread, either serially
+  // or on a pool of worker threads.  Use process_state->modules_ instead
+  // of module_list, because the |modules| argument will be used to
+  // populate the |module| fields in the returned StackFrame objects,
+  // which will be placed into the returned ProcessState object.
+  // module_list's lifetime is only as long as the Minidump object: it
+  // will be deleted when this function returns.  process_state->modules_
+  // is owned by the ProcessState object (just like the StackFrame
+  // objects), and is much more suitable for this task.
+  unsigned int walk_count = contexts.size();
+  vector<CallStack*> stacks(walk_count, static_cast<CallStack*>(NULL));
+  vector<char> slot_truncated(walk_count, 0);
+
+  // When the profile trusts the dump's client-captured IP trace, try to
+  // build the requesting thread's stack straight from it; on success
+  // that slot needs no walking at all, and processing the crash costs
+  // only the symbol lookups.
+  if (profile_.trust_ip_trace && found_requesting_thread &&
+      process_state->crashed_) {
+    unsigned int trace_slot = process_state->requesting_thread_;
+    CallStack* trace_stack = BuildStackFromIPTrace(dump,
+                                                   requesting_thread_id,
+                                                   contexts[trace_slot],
+                                                   process_state);
+    if (trace_stack) {
+      stacks[trace_slot] = trace_stack;
+      if (walk_source[trace_slot] == trace_slot) {
+        for (vector<unsigned int>::iterator slot_iter = walk_slots.begin();
+             slot_iter != walk_slots.end(); ++slot_iter) {
+          if (*slot_iter == trace_slot) {
+            walk_slots.erase(slot_iter);
+            break;
+          }
+        }
+      } else {
+        // The slot was sharing another thread's walk; it has its own
+        // stack now, so detach it before the sharing pass below.
+        walk_source[trace_slot] = trace_slot;
       }
+    }
+  }
+
+  // If a time budget was set, convert it to an absolute deadline now, so
+  // that every walker - concurrent or serial - stops at the same wall-clock
+  // moment.  A zero clock (Windows) leaves the budget disabled.
+  uint64_t walk_deadline_us = 0;
+  if (processing_time_budget_ms_) {
+    uint64_t now_us = NowMicroseconds();
+    if (now_us) {
+      walk_deadline_us = now_us + processing_time_budget_ms_ * 1000;
+    }
+  }
+
+  bool walked_concurrently = false;
+#ifndef _WIN32
+  // Pipeline the symbolization stage when there is more than one stack
+  // to walk: walkers load each module's symbols but defer the per-frame
+  // name and line fills, and the worker started here resolves each
+  // finished stack while the remaining ones unwind, overlapping symbol
+  // lookups with the unwind computation.  With a single stack there is
+  // nothing to overlap, so frames are filled inline as before.
+  SymbolizePipeline symbolize_pipeline;
+  pthread_t symbolize_thread;
+  bool pipeline_active = false;
+  if (profile_.resolve_source_lines && walk_slots.size() > 1) {
+    pthread_mutex_init(&symbolize_pipeline.lock, NULL);
+    pthread_cond_init(&symbolize_pipeline.ready, NULL);
+    symbolize_pipeline.closed = false;
+    symbolize_pipeline.frame_symbolizer = frame_symbolizer_;
+    if (pthread_create(&symbolize_thread, NULL, SymbolizeWorker,
+                       &symbolize_pipeline) == 0) {
+      pipeline_active = true;
+    } else {
+      BPLOG(ERROR) << "Could not create symbolization worker for " <<
+          dump->path();
+      pthread_cond_destroy(&symbolize_pipeline.ready);
+      pthread_mutex_destroy(&symbolize_pipeline.lock);
+    }
+  }
+
+  // Start the exploitability rating on its own worker so that enabling it
+  // does not add tail latency after the walk.  If the worker cannot be
+  // created, the rating runs serially after the walk as before.
+  ExploitabilityWork exploitability_work;
+  pthread_t exploitability_thread;
+  bool exploitability_running = false;
+  if (exploitability_pending) {
+    exploitability_work.engine = exploitability.get();
+    exploitability_work.rating = EXPLOITABILITY_ERR_PROCESSING;
+    if (pthread_create(&exploitability_thread, NULL, ExploitabilityWorker,
+                       &exploitability_work) == 0) {
+      exploitability_running = true;
+      exploitability_pending = false;
     } else {
-      // Threads with missing CPU contexts will hit this, but
-      // don't abort processing the rest of the dump just for
-      // one bad thread.
-      BPLOG(ERROR) << "No stackwalker for " << thread_string;
+      BPLOG(ERROR) << "Could not create exploitability worker for " <<
+          dump->path();
+    }
+  }
+
+  if (max_worker_threads_ > 1 && walk_slots.size() > 1) {
+    vector< vector<const CodeModule*> > slot_modules_without_symbols(
+        walk_count);
+    vector<char> slot_interrupted(walk_count, 0);
+
+    StackwalkWorkPool pool;
+    pthread_mutex_init(&pool.lock, NULL);
+    pool.next_slot = 0;
+    pool.slot_count = walk_slots.size();
+    pool.walk_slots = &walk_slots[0];
+    pool.system_info = process_state->system_info();
+    pool.modules = process_state->modules_;
+    pool.frame_symbolizer = frame_symbolizer_;
+    pool.contexts = &contexts[0];
+    pool.memories = &memories[0];
+    pool.thread_strings = &thread_strings[0];
+    pool.stacks = &stacks[0];
+    pool.modules_without_symbols = &slot_modules_without_symbols[0];
+    pool.interrupted = &slot_interrupted[0];
+    pool.truncated = &slot_truncated[0];
+    pool.walk_deadline_us = walk_deadline_us;
+    pool.scan_word_limit = scan_word_limit_;
+    pool.scan_telemetry = scan_telemetry_;
+    pool.prologue_layout_cache = prologue_layout_cache_;
+    pool.symbolize_pipeline = pipeline_active ? &symbolize_pipeline : NULL;
+
+    unsigned int worker_count = max_worker_threads_;
+    if (worker_count > walk_slots.size()) {
+      worker_count = walk_slots.size();
+    }
+
+    vector<pthread_t> workers(worker_count);
+    unsigned int started = 0;
+    while (started < worker_count) {
+      if (pthread_create(&workers[started], NULL, StackwalkWorker,
+                         &pool) != 0) {
+        BPLOG(ERROR) << "Could not create stackwalk worker " << started <<
+            "/" << worker_count << " for " << dump->path();
+        break;
+      }
+      ++started;
+    }
+
+    if (started > 0) {
+      // Even if fewer workers started than requested, the started workers
+      // drain every slot; only a complete failure falls back to the
+      // serial path below.
+      for (unsigned int worker_index = 0;
+           worker_index < started;
+           ++worker_index) {
+        pthread_join(workers[worker_index], NULL);
+      }
+
+      for (unsigned int slot = 0; slot < walk_count; ++slot) {
+        if (slot_interrupted[slot]) {
+          interrupted = true;
+        }
+        // Merge each worker's modules-without-symbols list, keeping the
+        // merged list free of duplicates as Stackwalker::Walk does.
+        vector<const CodeModule*>::const_iterator module_iter;
+        for (module_iter = slot_modules_without_symbols[slot].begin();
+             module_iter != slot_modules_without_symbols[slot].end();
+             ++module_iter) {
+          vector<const CodeModule*>::const_iterator found_iter;
+          bool found = false;
+          for (found_iter = process_state->modules_without_symbols_.begin();
+               found_iter != process_state->modules_without_symbols_.end();
+               ++found_iter) {
+            if (*found_iter == *module_iter) {
+              found = true;
+              break;
+            }
+          }
+          if (!found) {
+            process_state->modules_without_symbols_.push_back(*module_iter);
+          }
+        }
+      }
+      walked_concurrently = true;
+    }
+    pthread_mutex_destroy(&pool.lock);
+  }
+#endif  // _WIN32
+
+  if (!walked_concurrently) {
+    for (size_t list_index = 0; list_index < walk_slots.size();
+         ++list_index) {
+      unsigned int slot = walk_slots[list_index];
+      scoped_ptr<Stackwalker> stackwalker(
+          Stackwalker::StackwalkerForCPU(process_state->system_info(),
+                                         contexts[slot],
+                                         memories[slot],
+                                         process_state->modules_,
+                                         frame_symbolizer_));
+
+      scoped_ptr<CallStack> stack(new CallStack());
+      if (stackwalker.get()) {
+        stackwalker->set_walk_deadline_us(walk_deadline_us);
+        stackwalker->set_scan_word_limit(scan_word_limit_);
+        stackwalker->set_scan_telemetry(scan_telemetry_);
+        // This serial walk runs on the thread that owns the dump, so
+        // the walker may read the captured code regions for prologue
+        // analysis; the concurrent path above must leave this unset.
+        stackwalker->set_instruction_memory(dump->GetMemoryList());
+        stackwalker->set_prologue_layout_cache(prologue_layout_cache_);
+#ifndef _WIN32
+        if (pipeline_active) {
+          stackwalker->set_defer_source_lines(true);
+        }
+#endif
+        if (!stackwalker->Walk(stack.get(),
+                               &process_state->modules_without_symbols_)) {
+          BPLOG(INFO) << "Stackwalker interrupt (missing symbols?) at "
+                      << thread_strings[slot];
+          interrupted = true;
+        }
+        if (stackwalker->walk_truncated()) {
+          slot_truncated[slot] = true;
+        }
+      } else {
+        // Threads with missing CPU contexts will hit this, but
+        // don't abort processing the rest of the dump just for
+        // one bad thread.
+        BPLOG(ERROR) << "No stackwalker for " << thread_strings[slot];
+      }
+      stacks[slot] = stack.release();
+#ifndef _WIN32
+      if (pipeline_active) {
+        EnqueueForSymbolization(&symbolize_pipeline, stacks[slot]);
+      }
+#endif
+    }
+  }
+
+#ifndef _WIN32
+  // Close the pipeline and wait for the symbolization stage to finish
+  // the remaining stacks.
+  if (pipeline_active) {
+    pthread_mutex_lock(&symbolize_pipeline.lock);
+    symbolize_pipeline.closed = true;
+    pthread_cond_broadcast(&symbolize_pipeline.ready);
+    pthread_mutex_unlock(&symbolize_pipeline.lock);
+    pthread_join(symbolize_thread, NULL);
+    pthread_cond_destroy(&symbolize_pipeline.ready);
+    pthread_mutex_destroy(&symbolize_pipeline.lock);
+  }
+#endif  // _WIN32
+
+  // Give every deduplicated thread its representative's CallStack.  The
+  // pointer is shared, not copied; ProcessState deletes each distinct
+  // stack once.
+  for (unsigned int slot = 0; slot < walk_count; ++slot) {
+    unsigned int source = walk_source[slot];
+    if (source != slot) {
+      stacks[slot] = stacks[source];
+      slot_truncated[slot] = slot_truncated[source];
+    }
+  }
+
+  // Deposit the results into the ProcessState in original thread order.
+  for (unsigned int slot = 0; slot < walk_count; ++slot) {
+    process_state->threads_.push_back(stacks[slot]);
+    process_state->thread_memory_regions_.push_back(memories[slot]);
+    if (slot_truncated[slot]) {
+      process_state->truncated_threads_.push_back(slot);
+    }
+  }
+
+#ifndef _WIN32
+  // Collect the concurrently computed rating before any return below, so
+  // the worker never outlives the engine it references.
+  if (exploitability_running) {
+    pthread_join(exploitability_thread, NULL);
+    process_state->exploitability_ = exploitability_work.rating;
+  }
+#endif  // _WIN32
+
+  // Fill in the per-dump timings and counters.  This happens before the
+  // interrupted return below, so a partially processed state still
+  // carries the numbers for the work that was done.
+  ProcessingStats *stats = &process_state->processing_stats_;
+  uint64_t walk_end_us = NowMicroseconds();
+  if (walk_end_us) {
+    stats->walk_time_us = walk_end_us - walk_start_us;
+  }
+
+  StackFrameSymbolizer::SessionStats symbol_stats_after =
+      frame_symbolizer_->session_stats();
+  stats->symbol_fetch_time_us =
+      symbol_stats_after.fetch_time_us - symbol_stats_before.fetch_time_us;
+  stats->symbol_parse_time_us =
+      symbol_stats_after.parse_time_us - symbol_stats_before.parse_time_us;
+  stats->modules_loaded =
+      symbol_stats_after.modules_loaded - symbol_stats_before.modules_loaded;
+  stats->symbol_cache_hits =
+      symbol_stats_after.module_hits - symbol_stats_before.module_hits;
+
+  // Resolution proper is the symbolizer's fill time net of the fetching
+  // and parsing carved out above.
+  uint64_t fill_time_us =
+      symbol_stats_after.fill_time_us - symbol_stats_before.fill_time_us;
+  uint64_t symbol_time_us =
+      stats->symbol_fetch_time_us + stats->symbol_parse_time_us;
+  stats->resolve_time_us =
+      fill_time_us > symbol_time_us ? fill_time_us - symbol_time_us : 0;
+
+  // Tally how each deposited frame was recovered.
+  for (unsigned int slot = 0; slot < walk_count; ++slot) {
+    const vector<StackFrame*> *frames = process_state->threads_[slot]->frames();
+    stats->total_frames += frames->size();
+    for (size_t frame_index = 0; frame_index < frames->size(); ++frame_index) {
+      switch ((*frames)[frame_index]->trust) {
+        case StackFrame::FRAME_TRUST_CFI:
+          ++stats->cfi_frames;
+          break;
+        case StackFrame::FRAME_TRUST_SCAN:
+        case StackFrame::FRAME_TRUST_CFI_SCAN:
+          ++stats->scan_frames;
+          break;
+        default:
+          break;
+      }
     }
-    process_state->threads_.push_back(stack.release());
-    process_state->thread_memory_regions_.push_back(thread_memory);
   }
 
   if (interrupted) {
@@ -257,20 +1007,9 @@ ProcessResult MinidumpProcessor::Process(
     process_state->requesting_thread_ = -1;
   }
 
-  // Exploitability defaults to EXPLOITABILITY_NOT_ANALYZED
-  process_state->exploitability_ = EXPLOITABILITY_NOT_ANALYZED;
-
-  // If an exploitability run was requested we perform the platform specific
-  // rating.
-  if (enable_exploitability_) {
-    scoped_ptr<Exploitability> exploitability(
-        Exploitability::ExploitabilityForPlatform(dump, process_state));
-    // The engine will be null if the platform is not supported
-    if (exploitability != NULL) {
-      process_state->exploitability_ = exploitability->CheckExploitability();
-    } else {
-      process_state->exploitability_ = EXPLOITABILITY_ERR_NOENGINE;
-    }
+  // If the rating was not computed concurrently above, perform it here.
+  if (exploitability_pending) {
+    process_state->exploitability_ = exploitability->CheckExploitability();
   }
 
   BPLOG(INFO) << "Processed " << dump->path();
@@ -1211,4 +1950,71 @@ string MinidumpProcessor::GetAssertion(Minidump *dump) {
   return assertion_string;
 }
 
+// 64-bit FNV-1a over the canonical signature text.  Any stable hash
+// would do; FNV keeps the fingerprint dependency-free.
+static uint64_t FingerprintHash(const string &text) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t index = 0; index < text.size(); ++index) {
+    hash ^= static_cast<uint8_t>(text[index]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// static
+bool MinidumpProcessor::GetCrashFingerprint(Minidump *dump,
+                                            string *fingerprint) {
+  assert(dump);
+  assert(fingerprint);
+
+  MinidumpException *exception = dump->GetException();
+  if (!exception)
+    return false;
+
+  const MDRawExceptionStream *raw_exception = exception->exception();
+  if (!raw_exception)
+    return false;
+
+  // Prefer the exception record's code address; fall back on the
+  // crashing thread's instruction pointer when the record carries none.
+  uint64_t instruction = raw_exception->exception_record.exception_address;
+  if (!instruction) {
+    MinidumpContext *context = exception->GetContext();
+    uint64_t context_instruction = 0;
+    if (context && context->GetInstructionPointer(&context_instruction))
+      instruction = context_instruction;
+  }
+
+  // Build the canonical signature text.  The faulting instruction is
+  // expressed relative to the module containing it, identified by its
+  // debug file and identifier, so address space layout does not perturb
+  // the signature; an instruction outside every module keeps its
+  // absolute address, which is the most distinctive datum available.
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%08x/%08x/",
+           raw_exception->exception_record.exception_code,
+           raw_exception->exception_record.exception_flags);
+  string canonical = buffer;
+
+  MinidumpModuleList *module_list = dump->GetModuleList();
+  const CodeModule *module =
+      module_list ? module_list->GetModuleForAddress(instruction) : NULL;
+  if (module) {
+    snprintf(buffer, sizeof(buffer), "+0x%llx",
+             static_cast<unsigned long long>(
+                 instruction - module->base_address()));
+    canonical += module->debug_file() + "/" + module->debug_identifier() +
+        buffer;
+  } else {
+    snprintf(buffer, sizeof(buffer), "@0x%llx",
+             static_cast<unsigned long long>(instruction));
+    canonical += buffer;
+  }
+
+  snprintf(buffer, sizeof(buffer), "%016llx",
+           static_cast<unsigned long long>(FingerprintHash(canonical)));
+  *fingerprint = buffer;
+  return true;
+}
+
 }  // namespace google_breakpad
@@ -388,24 +388,30 @@ TEST_F(MinidumpProcessorTest, TestBasicProcessing) {
   ASSERT_TRUE(stack->frames()->at(0)->module);
   ASSERT_EQ(stack->frames()->at(0)->module->base_address(), 0x400000U);
   ASSERT_EQ(stack->frames()->at(0)->module->code_file(), "c:\\test_app.exe");
-  ASSERT_EQ(stack->frames()->at(0)->function_name,
+  ASSERT_TRUE(stack->frames()->at(0)->function_name);
+  ASSERT_EQ(*stack->frames()->at(0)->function_name,
             "`anonymous namespace'::CrashFunction");
-  ASSERT_EQ(stack->frames()->at(0)->source_file_name, "c:\\test_app.cc");
+  ASSERT_TRUE(stack->frames()->at(0)->source_file_name);
+  ASSERT_EQ(*stack->frames()->at(0)->source_file_name, "c:\\test_app.cc");
   ASSERT_EQ(stack->frames()->at(0)->source_line, 58);
 
   ASSERT_TRUE(stack->frames()->at(1)->module);
   ASSERT_EQ(stack->frames()->at(1)->module->base_address(), 0x400000U);
   ASSERT_EQ(stack->frames()->at(1)->module->code_file(), "c:\\test_app.exe");
-  ASSERT_EQ(stack->frames()->at(1)->function_name, "main");
-  ASSERT_EQ(stack->frames()->at(1)->source_file_name, "c:\\test_app.cc");
+  ASSERT_TRUE(stack->frames()->at(1)->function_name);
+  ASSERT_EQ(*stack->frames()->at(1)->function_name, "main");
+  ASSERT_TRUE(stack->frames()->at(1)->source_file_name);
+  ASSERT_EQ(*stack->frames()->at(1)->source_file_name, "c:\\test_app.cc");
   ASSERT_EQ(stack->frames()->at(1)->source_line, 65);
 
   // This comes from the CRT
   ASSERT_TRUE(stack->frames()->at(2)->module);
   ASSERT_EQ(stack->frames()->at(2)->module->base_address(), 0x400000U);
   ASSERT_EQ(stack->frames()->at(2)->module->code_file(), "c:\\test_app.exe");
-  ASSERT_EQ(stack->frames()->at(2)->function_name, "__tmainCRTStartup");
-  ASSERT_EQ(stack->frames()->at(2)->source_file_name,
+  ASSERT_TRUE(stack->frames()->at(2)->function_name);
+  ASSERT_EQ(*stack->frames()->at(2)->function_name, "__tmainCRTStartup");
+  ASSERT_TRUE(stack->frames()->at(2)->source_file_name);
+  ASSERT_EQ(*stack->frames()->at(2)->source_file_name,
             "f:\\sp\\vctools\\crt_bld\\self_x86\\crt\\src\\crt0.c");
   ASSERT_EQ(stack->frames()->at(2)->source_line, 327);
 
@@ -414,8 +420,8 @@ TEST_F(MinidumpProcessorTest, TestBasicProcessing) {
   ASSERT_EQ(stack->frames()->at(3)->module->base_address(), 0x7c800000U);
   ASSERT_EQ(stack->frames()->at(3)->module->code_file(),
             "C:\\WINDOWS\\system32\\kernel32.dll");
-  ASSERT_TRUE(stack->frames()->at(3)->function_name.empty());
-  ASSERT_TRUE(stack->frames()->at(3)->source_file_name.empty());
+  ASSERT_FALSE(stack->frames()->at(3)->function_name);
+  ASSERT_FALSE(stack->frames()->at(3)->source_file_name);
   ASSERT_EQ(stack->frames()->at(3)->source_line, 0);
 
   ASSERT_EQ(state.modules()->module_count(), 13U);
@@ -0,0 +1,499 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_scrub.cc: Streaming single-pass minidump scrubber.
+//
+// Privacy rules can require stripping environment blocks, command
+// lines, and selected memory ranges from dumps before they leave the
+// ingestion tier.  Fully parsing a dump and re-serializing it costs
+// two passes and rebuilds every stream; this tool instead reads only
+// the header, the stream directory, and - when memory ranges are to be
+// zeroed - the memory list, turns the requested transforms into a list
+// of byte-range patches, and then copies input to output in one
+// sequential pass, applying the patches as the data streams through.
+// Nothing moves: a dropped stream keeps its bytes' positions (the
+// payload is zeroed and its directory entry marked unused), a
+// truncated stream keeps its rva (the tail is zeroed and the directory
+// size reduced), so every other offset in the file stays valid and the
+// copy runs at disk speed.
+//
+// Usage: minidump_scrub [options] <input-dump> <output-dump>
+//   -d <stream>     drop the stream: payload zeroed, directory entry
+//                   marked unused.  <stream> is a type number (decimal
+//                   or 0x-hex) or one of: environ, cmdline, auxv,
+//                   maps, proc-status.  May be repeated.
+//   -t <stream>:<len>  truncate the stream's payload to <len> bytes,
+//                   zeroing the tail.  May be repeated.
+//   -z <addr>:<len> zero captured memory overlapping the address range
+//                   [addr, addr+len).  May be repeated.
+//
+// Byte-swapped dumps (taken on a machine of the opposite endianness)
+// are refused rather than scrubbed incorrectly.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "google_breakpad/common/minidump_format.h"
+
+namespace {
+
+using std::string;
+using std::vector;
+
+// One byte range to alter during the copy.  Empty |bytes| means
+// zero-fill; otherwise |bytes| replaces the range (used for the
+// patched directory).
+struct Patch {
+  uint64_t offset;
+  uint64_t length;
+  vector<uint8_t> bytes;
+};
+
+bool PatchOrder(const Patch& a, const Patch& b) {
+  return a.offset < b.offset;
+}
+
+// A memory range to zero, given on the command line as <addr>:<len>.
+struct ZeroRange {
+  uint64_t address;
+  uint64_t length;
+};
+
+// A stream to truncate, given on the command line as <stream>:<len>.
+struct Truncation {
+  uint32_t stream_type;
+  uint32_t length;
+};
+
+// Maps the stream names accepted by -d and -t to their type numbers.
+struct StreamName {
+  const char* name;
+  uint32_t stream_type;
+};
+
+const StreamName kStreamNames[] = {
+  { "environ",     MD_LINUX_ENVIRON },
+  { "cmdline",     MD_LINUX_CMD_LINE },
+  { "auxv",        MD_LINUX_AUXV },
+  { "maps",        MD_LINUX_MAPS },
+  { "proc-status", MD_LINUX_PROC_STATUS },
+};
+
+// Parses a stream type: a name from kStreamNames or a decimal or
+// 0x-hex number.  Returns false if |argument| is neither.
+bool ParseStreamType(const char* argument, uint32_t* stream_type) {
+  for (size_t i = 0; i < sizeof(kStreamNames) / sizeof(kStreamNames[0]); ++i) {
+    if (strcmp(argument, kStreamNames[i].name) == 0) {
+      *stream_type = kStreamNames[i].stream_type;
+      return true;
+    }
+  }
+  char* end = NULL;
+  unsigned long long value = strtoull(argument, &end, 0);
+  if (end == argument || *end != '\0')
+    return false;
+  *stream_type = static_cast<uint32_t>(value);
+  return true;
+}
+
+// Parses "<number>:<number>" with either part decimal or 0x-hex.
+bool ParsePair(const char* argument, uint64_t* first, uint64_t* second) {
+  const char* colon = strchr(argument, ':');
+  if (!colon)
+    return false;
+  string first_text(argument, colon - argument);
+  char* end = NULL;
+  *first = strtoull(first_text.c_str(), &end, 0);
+  if (end == first_text.c_str() || *end != '\0')
+    return false;
+  *second = strtoull(colon + 1, &end, 0);
+  if (end == colon + 1 || *end != '\0')
+    return false;
+  return true;
+}
+
+// Reads |length| bytes at |offset|; returns false on a short read.
+bool ReadAt(FILE* file, uint64_t offset, void* buffer, size_t length) {
+  if (fseek(file, static_cast<long>(offset), SEEK_SET) != 0)
+    return false;
+  return fread(buffer, 1, length, file) == length;
+}
+
+// Adds a zero-fill patch for [offset, offset + length), clipped to the
+// file so a malformed directory cannot direct a patch past the end.
+void AddZeroPatch(uint64_t offset, uint64_t length, uint64_t file_size,
+                  vector<Patch>* patches) {
+  if (offset >= file_size)
+    return;
+  if (length > file_size - offset)
+    length = file_size - offset;
+  if (length == 0)
+    return;
+  Patch patch;
+  patch.offset = offset;
+  patch.length = length;
+  patches->push_back(patch);
+}
+
+// Turns the -z ranges into zero patches over the captured memory they
+// overlap, using the dump's memory list (and, for full-memory dumps,
+// its 64-bit memory list, whose ranges are laid out contiguously from
+// the list's base_rva).  Returns the number of bytes to be zeroed.
+uint64_t PatchMemoryRanges(FILE* file,
+                           const vector<MDRawDirectory>& directory,
+                           const vector<ZeroRange>& ranges,
+                           uint64_t file_size,
+                           vector<Patch>* patches) {
+  uint64_t zeroed_bytes = 0;
+  for (size_t entry_index = 0; entry_index < directory.size();
+       ++entry_index) {
+    const MDRawDirectory& entry = directory[entry_index];
+    if (entry.stream_type == MD_MEMORY_LIST_STREAM) {
+      uint32_t range_count = 0;
+      if (!ReadAt(file, entry.location.rva,
+                  &range_count, sizeof(range_count)))
+        continue;
+      for (uint32_t i = 0; i < range_count; ++i) {
+        MDMemoryDescriptor descriptor;
+        if (!ReadAt(file,
+                    entry.location.rva + sizeof(range_count) +
+                        static_cast<uint64_t>(i) * sizeof(descriptor),
+                    &descriptor, sizeof(descriptor)))
+          break;
+        for (size_t r = 0; r < ranges.size(); ++r) {
+          uint64_t overlap_start =
+              std::max(ranges[r].address, descriptor.start_of_memory_range);
+          uint64_t overlap_end =
+              std::min(ranges[r].address + ranges[r].length,
+                       descriptor.start_of_memory_range +
+                           descriptor.memory.data_size);
+          if (overlap_start >= overlap_end)
+            continue;
+          AddZeroPatch(descriptor.memory.rva +
+                           (overlap_start -
+                            descriptor.start_of_memory_range),
+                       overlap_end - overlap_start, file_size, patches);
+          zeroed_bytes += overlap_end - overlap_start;
+        }
+      }
+    } else if (entry.stream_type == MD_MEMORY_64_LIST_STREAM) {
+      uint64_t range_count = 0;
+      uint64_t base_rva = 0;
+      if (!ReadAt(file, entry.location.rva,
+                  &range_count, sizeof(range_count)) ||
+          !ReadAt(file, entry.location.rva + sizeof(range_count),
+                  &base_rva, sizeof(base_rva)))
+        continue;
+      uint64_t range_rva = base_rva;
+      for (uint64_t i = 0; i < range_count; ++i) {
+        MDMemoryDescriptor64 descriptor;
+        if (!ReadAt(file,
+                    entry.location.rva + sizeof(range_count) +
+                        sizeof(base_rva) + i * sizeof(descriptor),
+                    &descriptor, sizeof(descriptor)))
+          break;
+        for (size_t r = 0; r < ranges.size(); ++r) {
+          uint64_t overlap_start =
+              std::max(ranges[r].address, descriptor.start_of_memory_range);
+          uint64_t overlap_end =
+              std::min(ranges[r].address + ranges[r].length,
+                       descriptor.start_of_memory_range +
+                           descriptor.data_size);
+          if (overlap_start >= overlap_end)
+            continue;
+          AddZeroPatch(range_rva +
+                           (overlap_start -
+                            descriptor.start_of_memory_range),
+                       overlap_end - overlap_start, file_size, patches);
+          zeroed_bytes += overlap_end - overlap_start;
+        }
+        range_rva += descriptor.data_size;
+      }
+    }
+  }
+  return zeroed_bytes;
+}
+
+// Copies |input| to |output| in one sequential pass, applying
+// |patches| (sorted by offset) as their ranges stream through the
+// copy buffer.
+bool CopyWithPatches(FILE* input, FILE* output, uint64_t file_size,
+                     const vector<Patch>& patches) {
+  if (fseek(input, 0, SEEK_SET) != 0)
+    return false;
+
+  const size_t kBufferSize = 1 << 20;
+  vector<uint8_t> buffer(kBufferSize);
+  uint64_t offset = 0;
+  size_t next_patch = 0;
+
+  while (offset < file_size) {
+    size_t chunk = kBufferSize;
+    if (chunk > file_size - offset)
+      chunk = static_cast<size_t>(file_size - offset);
+    if (fread(&buffer[0], 1, chunk, input) != chunk)
+      return false;
+
+    // Patches already wholly behind the window stay behind it, so the
+    // scan resumes where the previous buffer left it.
+    for (size_t p = next_patch; p < patches.size(); ++p) {
+      const Patch& patch = patches[p];
+      if (patch.offset + patch.length <= offset) {
+        next_patch = p + 1;
+        continue;
+      }
+      if (patch.offset >= offset + chunk)
+        break;
+      uint64_t patch_start = std::max(patch.offset, offset);
+      uint64_t patch_end = std::min(patch.offset + patch.length,
+                                    offset + chunk);
+      uint8_t* window = &buffer[static_cast<size_t>(patch_start - offset)];
+      size_t span = static_cast<size_t>(patch_end - patch_start);
+      if (patch.bytes.empty()) {
+        memset(window, 0, span);
+      } else {
+        memcpy(window, &patch.bytes[patch_start - patch.offset], span);
+      }
+    }
+
+    if (fwrite(&buffer[0], 1, chunk, output) != chunk)
+      return false;
+    offset += chunk;
+  }
+  return true;
+}
+
+void Usage(const char* program_name) {
+  fprintf(stderr,
+          "Usage: %s [options] <input-dump> <output-dump>\n"
+          "Copy a minidump, scrubbing it in one sequential pass.\n"
+          "  -d <stream>      drop the stream: payload zeroed, directory\n"
+          "                   entry marked unused.  <stream> is a type\n"
+          "                   number (decimal or 0x-hex) or one of:\n"
+          "                   environ, cmdline, auxv, maps, proc-status\n"
+          "  -t <stream>:<len> truncate the stream's payload to <len>\n"
+          "                   bytes, zeroing the tail\n"
+          "  -z <addr>:<len>  zero captured memory overlapping the\n"
+          "                   address range [addr, addr+len)\n"
+          "All options may be repeated.\n",
+          program_name);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  vector<uint32_t> drop_types;
+  vector<Truncation> truncations;
+  vector<ZeroRange> zero_ranges;
+
+  int argi = 1;
+  for (; argi < argc && argv[argi][0] == '-'; ++argi) {
+    if (argi + 1 >= argc) {
+      Usage(argv[0]);
+      return 1;
+    }
+    const char* option = argv[argi];
+    const char* value = argv[++argi];
+    if (strcmp(option, "-d") == 0) {
+      uint32_t stream_type;
+      if (!ParseStreamType(value, &stream_type)) {
+        fprintf(stderr, "%s: unrecognized stream '%s'\n", argv[0], value);
+        return 1;
+      }
+      drop_types.push_back(stream_type);
+    } else if (strcmp(option, "-t") == 0) {
+      const char* colon = strchr(value, ':');
+      uint64_t length;
+      uint32_t stream_type;
+      char* end = NULL;
+      if (!colon ||
+          !ParseStreamType(string(value, colon - value).c_str(),
+                           &stream_type) ||
+          (length = strtoull(colon + 1, &end, 0), end == colon + 1) ||
+          *end != '\0') {
+        fprintf(stderr, "%s: bad truncation '%s'\n", argv[0], value);
+        return 1;
+      }
+      Truncation truncation;
+      truncation.stream_type = stream_type;
+      truncation.length = static_cast<uint32_t>(length);
+      truncations.push_back(truncation);
+    } else if (strcmp(option, "-z") == 0) {
+      ZeroRange range;
+      if (!ParsePair(value, &range.address, &range.length)) {
+        fprintf(stderr, "%s: bad memory range '%s'\n", argv[0], value);
+        return 1;
+      }
+      zero_ranges.push_back(range);
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (argc - argi != 2) {
+    Usage(argv[0]);
+    return 1;
+  }
+  const char* input_path = argv[argi];
+  const char* output_path = argv[argi + 1];
+
+  FILE* input = fopen(input_path, "rb");
+  if (!input) {
+    fprintf(stderr, "%s: cannot open %s\n", argv[0], input_path);
+    return 1;
+  }
+
+  if (fseek(input, 0, SEEK_END) != 0) {
+    fprintf(stderr, "%s: cannot seek %s\n", argv[0], input_path);
+    fclose(input);
+    return 1;
+  }
+  const uint64_t file_size = static_cast<uint64_t>(ftell(input));
+
+  MDRawHeader header;
+  if (!ReadAt(input, 0, &header, sizeof(header))) {
+    fprintf(stderr, "%s: %s is too short for a minidump header\n",
+            argv[0], input_path);
+    fclose(input);
+    return 1;
+  }
+  if (header.signature != MD_HEADER_SIGNATURE) {
+    // A byte-swapped signature means a cross-endian dump; scrubbing one
+    // would patch the wrong byte ranges.
+    fprintf(stderr, "%s: %s is not a minidump%s\n", argv[0], input_path,
+            header.signature == 0x4d444d50 ? " of this endianness" : "");
+    fclose(input);
+    return 1;
+  }
+
+  vector<MDRawDirectory> directory(header.stream_count);
+  if (header.stream_count == 0 ||
+      !ReadAt(input, header.stream_directory_rva, &directory[0],
+              header.stream_count * sizeof(MDRawDirectory))) {
+    fprintf(stderr, "%s: cannot read the stream directory of %s\n",
+            argv[0], input_path);
+    fclose(input);
+    return 1;
+  }
+
+  vector<Patch> patches;
+
+  // Drops and truncations patch the directory in place; the payload
+  // bytes are zeroed where they lie so no other offset moves.
+  bool directory_changed = false;
+  for (size_t d = 0; d < drop_types.size(); ++d) {
+    bool found = false;
+    for (size_t entry_index = 0; entry_index < directory.size();
+         ++entry_index) {
+      MDRawDirectory& entry = directory[entry_index];
+      if (entry.stream_type != drop_types[d])
+        continue;
+      found = true;
+      AddZeroPatch(entry.location.rva, entry.location.data_size,
+                   file_size, &patches);
+      printf("dropped stream 0x%x (%u bytes zeroed)\n",
+             entry.stream_type, entry.location.data_size);
+      entry.stream_type = MD_UNUSED_STREAM;
+      entry.location.data_size = 0;
+      entry.location.rva = 0;
+      directory_changed = true;
+    }
+    if (!found)
+      fprintf(stderr, "warning: no stream of type 0x%x to drop\n",
+              drop_types[d]);
+  }
+  for (size_t t = 0; t < truncations.size(); ++t) {
+    bool found = false;
+    for (size_t entry_index = 0; entry_index < directory.size();
+         ++entry_index) {
+      MDRawDirectory& entry = directory[entry_index];
+      if (entry.stream_type != truncations[t].stream_type ||
+          entry.location.data_size <= truncations[t].length)
+        continue;
+      found = true;
+      AddZeroPatch(entry.location.rva + truncations[t].length,
+                   entry.location.data_size - truncations[t].length,
+                   file_size, &patches);
+      printf("truncated stream 0x%x from %u to %u bytes\n",
+             entry.stream_type, entry.location.data_size,
+             truncations[t].length);
+      entry.location.data_size = truncations[t].length;
+      directory_changed = true;
+    }
+    if (!found)
+      fprintf(stderr,
+              "warning: no stream of type 0x%x longer than %u to truncate\n",
+              truncations[t].stream_type, truncations[t].length);
+  }
+
+  if (!zero_ranges.empty()) {
+    uint64_t zeroed_bytes = PatchMemoryRanges(input, directory, zero_ranges,
+                                              file_size, &patches);
+    printf("zeroed %llu bytes of captured memory\n",
+           static_cast<unsigned long long>(zeroed_bytes));
+  }
+
+  if (directory_changed) {
+    Patch patch;
+    patch.offset = header.stream_directory_rva;
+    patch.length = directory.size() * sizeof(MDRawDirectory);
+    patch.bytes.resize(static_cast<size_t>(patch.length));
+    memcpy(&patch.bytes[0], &directory[0],
+           static_cast<size_t>(patch.length));
+    patches.push_back(patch);
+  }
+
+  std::sort(patches.begin(), patches.end(), PatchOrder);
+
+  FILE* output = fopen(output_path, "wb");
+  if (!output) {
+    fprintf(stderr, "%s: cannot create %s\n", argv[0], output_path);
+    fclose(input);
+    return 1;
+  }
+
+  bool copied = CopyWithPatches(input, output, file_size, patches);
+  fclose(input);
+  if (fclose(output) != 0)
+    copied = false;
+  if (!copied) {
+    fprintf(stderr, "%s: writing %s failed\n", argv[0], output_path);
+    remove(output_path);
+    return 1;
+  }
+
+  printf("wrote %s (%llu bytes)\n", output_path,
+         static_cast<unsigned long long>(file_size));
+  return 0;
+}
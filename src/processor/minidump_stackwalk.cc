@@ -46,9 +46,11 @@
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/code_modules.h"
 #include "google_breakpad/processor/minidump.h"
+#include "google_breakpad/processor/minidump_batch_processor.h"
 #include "google_breakpad/processor/minidump_processor.h"
 #include "google_breakpad/processor/process_state.h"
 #include "google_breakpad/processor/stack_frame_cpu.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
 #include "processor/logging.h"
 #include "processor/pathname_stripper.h"
 #include "processor/simple_symbol_supplier.h"
@@ -60,6 +62,7 @@ using google_breakpad::BasicSourceLineResolver;
 using google_breakpad::CallStack;
 using google_breakpad::CodeModule;
 using google_breakpad::CodeModules;
+using google_breakpad::MinidumpBatchProcessor;
 using google_breakpad::MinidumpModule;
 using google_breakpad::MinidumpProcessor;
 using google_breakpad::PathnameStripper;
@@ -67,6 +70,7 @@ using google_breakpad::ProcessState;
 using google_breakpad::scoped_ptr;
 using google_breakpad::SimpleSymbolSupplier;
 using google_breakpad::StackFrame;
+using google_breakpad::StackFrameSymbolizer;
 using google_breakpad::StackFramePPC;
 using google_breakpad::StackFrameSPARC;
 using google_breakpad::StackFrameX86;
@@ -76,6 +80,14 @@ using google_breakpad::StackFrameARM;
 // Separator character for machine readable output.
 static const char kOutputSeparator = '|';
 
+// How a processed dump is printed: the human-readable report, the
+// pipe-delimited machine-readable rows, or line-delimited JSON records.
+enum OutputFormat {
+  OUTPUT_HUMAN_READABLE,
+  OUTPUT_MACHINE_READABLE,
+  OUTPUT_JSON
+};
+
 // PrintRegister prints a register's name and value to stdout.  It will
 // print four registers on a line.  For the first register in a set,
 // pass 0 for |start_col|.  For registers in a set, pass the most recent
@@ -148,10 +160,10 @@ static void PrintStack(const CallStack *stack, const string &cpu) {
 
     if (frame->module) {
       printf("%s", PathnameStripper::File(frame->module->code_file()).c_str());
-      if (!frame->function_name.empty()) {
-        printf("!%s", frame->function_name.c_str());
-        if (!frame->source_file_name.empty()) {
-          string source_file = PathnameStripper::File(frame->source_file_name);
+      if (frame->function_name && !frame->function_name->empty()) {
+        printf("!%s", frame->function_name->c_str());
+        if (frame->source_file_name && !frame->source_file_name->empty()) {
+          string source_file = PathnameStripper::File(*frame->source_file_name);
           printf(" [%s : %d + 0x%" PRIx64 "]",
                  source_file.c_str(),
                  frame->source_line,
@@ -294,13 +306,13 @@ static void PrintStackMachineReadable(int thread_num, const CallStack *stack) {
       assert(!frame->module->code_file().empty());
       printf("%s", StripSeparator(PathnameStripper::File(
                      frame->module->code_file())).c_str());
-      if (!frame->function_name.empty()) {
+      if (frame->function_name && !frame->function_name->empty()) {
         printf("%c%s", kOutputSeparator,
-               StripSeparator(frame->function_name).c_str());
-        if (!frame->source_file_name.empty()) {
+               StripSeparator(*frame->function_name).c_str());
+        if (frame->source_file_name && !frame->source_file_name->empty()) {
           printf("%c%s%c%d%c0x%" PRIx64,
                  kOutputSeparator,
-                 StripSeparator(frame->source_file_name).c_str(),
+                 StripSeparator(*frame->source_file_name).c_str(),
                  kOutputSeparator,
                  frame->source_line,
                  kOutputSeparator,
@@ -557,6 +569,232 @@ static void PrintProcessStateMachineReadable(const ProcessState& process_state)
   }
 }
 
+// Line-delimited JSON output (-J).
+//
+// One self-contained JSON object per line, in dump order: a "system"
+// record, a "crash" record, one "module" record per loaded module, and
+// one "frame" record per stack frame, carrying the same fields as the
+// machine-readable rows above but without the lossy separator
+// stripping.  Records are appended to a process-wide buffer and handed
+// to the OS in large writes, so emitting a frame costs a string append
+// rather than a formatted printf plus a write per field.
+
+static string json_buffer;
+static const size_t kJsonFlushThreshold = 64 * 1024;
+
+// Hands the buffered records to stdout.  Called when the buffer grows
+// past kJsonFlushThreshold and at the end of each dump, so a consumer
+// reading a pipe never waits on a partially buffered dump.
+static void JsonFlush() {
+  if (!json_buffer.empty()) {
+    fwrite(json_buffer.data(), 1, json_buffer.size(), stdout);
+    json_buffer.clear();
+  }
+}
+
+// Appends |value| to the buffer as a quoted JSON string, escaping
+// quotes, backslashes and control characters.
+static void JsonAppendString(const string &value) {
+  json_buffer += '"';
+  for (string::size_type i = 0; i < value.size(); ++i) {
+    unsigned char c = value[i];
+    if (c == '"' || c == '\\') {
+      json_buffer += '\\';
+      json_buffer += c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      json_buffer += escaped;
+    } else {
+      json_buffer += c;
+    }
+  }
+  json_buffer += '"';
+}
+
+static void JsonBeginRecord(const char *record_type) {
+  json_buffer += "{\"type\":\"";
+  json_buffer += record_type;
+  json_buffer += '"';
+}
+
+static void JsonEndRecord() {
+  json_buffer += "}\n";
+  if (json_buffer.size() >= kJsonFlushThreshold)
+    JsonFlush();
+}
+
+static void JsonField(const char *name, const string &value) {
+  json_buffer += ",\"";
+  json_buffer += name;
+  json_buffer += "\":";
+  JsonAppendString(value);
+}
+
+static void JsonFieldInt(const char *name, int64_t value) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%" PRId64, value);
+  json_buffer += ",\"";
+  json_buffer += name;
+  json_buffer += "\":";
+  json_buffer += buffer;
+}
+
+// Addresses and offsets are emitted as "0x..." strings: JSON numbers
+// are doubles to many consumers, which would silently round 64-bit
+// addresses.
+static void JsonFieldHex(const char *name, uint64_t value) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "0x%" PRIx64, value);
+  JsonField(name, buffer);
+}
+
+static void JsonFieldBool(const char *name, bool value) {
+  json_buffer += ",\"";
+  json_buffer += name;
+  json_buffer += "\":";
+  json_buffer += value ? "true" : "false";
+}
+
+// PrintStackJson emits one "frame" record per frame of |stack|.  The
+// module, function, file, line and offset fields follow the same
+// availability rules as PrintStackMachineReadable; absent fields are
+// omitted rather than printed empty.
+static void PrintStackJson(int thread_num, const CallStack *stack) {
+  int frame_count = stack->frames()->size();
+  for (int frame_index = 0; frame_index < frame_count; ++frame_index) {
+    const StackFrame *frame = stack->frames()->at(frame_index);
+    uint64_t instruction_address = frame->ReturnAddress();
+
+    JsonBeginRecord("frame");
+    JsonFieldInt("thread", thread_num);
+    JsonFieldInt("frame", frame_index);
+    JsonField("trust", frame->trust_description());
+    if (frame->module) {
+      assert(!frame->module->code_file().empty());
+      JsonField("module", PathnameStripper::File(frame->module->code_file()));
+      if (frame->function_name && !frame->function_name->empty()) {
+        JsonField("function", *frame->function_name);
+        if (frame->source_file_name && !frame->source_file_name->empty()) {
+          JsonField("file", *frame->source_file_name);
+          JsonFieldInt("line", frame->source_line);
+          JsonFieldHex("offset",
+                       instruction_address - frame->source_line_base);
+        } else {
+          JsonFieldHex("offset", instruction_address - frame->function_base);
+        }
+      } else {
+        JsonFieldHex("offset",
+                     instruction_address - frame->module->base_address());
+      }
+    } else {
+      JsonFieldHex("offset", instruction_address);
+    }
+    JsonEndRecord();
+  }
+}
+
+// PrintModulesJson emits one "module" record per loaded module.
+// |modules_without_symbols| should contain the list of modules that
+// were confirmed to be missing their symbols during the stack walk.
+static void PrintModulesJson(
+    const CodeModules *modules,
+    const vector<const CodeModule*> *modules_without_symbols) {
+  if (!modules)
+    return;
+
+  uint64_t main_address = 0;
+  const CodeModule *main_module = modules->GetMainModule();
+  if (main_module) {
+    main_address = main_module->base_address();
+  }
+
+  unsigned int module_count = modules->module_count();
+  for (unsigned int module_sequence = 0;
+       module_sequence < module_count;
+       ++module_sequence) {
+    const CodeModule *module = modules->GetModuleAtSequence(module_sequence);
+    uint64_t base_address = module->base_address();
+    JsonBeginRecord("module");
+    JsonField("filename", PathnameStripper::File(module->code_file()));
+    JsonField("version", module->version());
+    JsonField("debug_file", PathnameStripper::File(module->debug_file()));
+    JsonField("debug_id", module->debug_identifier());
+    JsonFieldHex("base", base_address);
+    JsonFieldHex("end", base_address + module->size() - 1);
+    JsonFieldBool("main",
+                  main_module != NULL && base_address == main_address);
+    JsonFieldBool("missing_symbols",
+                  ContainsModule(modules_without_symbols, module));
+    JsonEndRecord();
+  }
+}
+
+static void PrintProcessStateJson(const ProcessState& process_state) {
+  JsonBeginRecord("system");
+  JsonField("os", process_state.system_info()->os);
+  JsonField("os_version", process_state.system_info()->os_version);
+  JsonField("cpu", process_state.system_info()->cpu);
+  JsonField("cpu_info", process_state.system_info()->cpu_info);
+  JsonFieldInt("cpu_count", process_state.system_info()->cpu_count);
+  JsonEndRecord();
+
+  int requesting_thread = process_state.requesting_thread();
+
+  JsonBeginRecord("crash");
+  JsonFieldBool("crashed", process_state.crashed());
+  if (process_state.crashed()) {
+    JsonField("reason", process_state.crash_reason());
+    JsonFieldHex("address", process_state.crash_address());
+  }
+  string assertion = process_state.assertion();
+  if (!assertion.empty()) {
+    JsonField("assertion", assertion);
+  }
+  if (requesting_thread != -1) {
+    JsonFieldInt("requesting_thread", requesting_thread);
+  }
+  JsonEndRecord();
+
+  PrintModulesJson(process_state.modules(),
+                   process_state.modules_without_symbols());
+
+  // If the thread that requested the dump is known, print it first.
+  if (requesting_thread != -1) {
+    PrintStackJson(requesting_thread,
+                   process_state.threads()->at(requesting_thread));
+  }
+
+  // Print all of the threads in the dump.
+  int thread_count = process_state.threads()->size();
+  for (int thread_index = 0; thread_index < thread_count; ++thread_index) {
+    if (thread_index != requesting_thread) {
+      // Don't print the crash thread again, it was already printed.
+      PrintStackJson(thread_index,
+                     process_state.threads()->at(thread_index));
+    }
+  }
+
+  JsonFlush();
+}
+
+// Prints |process_state| in the requested |format|.
+static void PrintProcessStateInFormat(const ProcessState& process_state,
+                                      OutputFormat format) {
+  switch (format) {
+    case OUTPUT_MACHINE_READABLE:
+      PrintProcessStateMachineReadable(process_state);
+      break;
+    case OUTPUT_JSON:
+      PrintProcessStateJson(process_state);
+      break;
+    case OUTPUT_HUMAN_READABLE:
+    default:
+      PrintProcessState(process_state);
+      break;
+  }
+}
+
 // Processes |minidump_file| using MinidumpProcessor.  |symbol_path|, if
 // non-empty, is the base directory of a symbol storage area, laid out in
 // the format required by SimpleSymbolSupplier.  If such a storage area
@@ -569,7 +807,7 @@ static void PrintProcessStateMachineReadable(const ProcessState& process_state)
 // is printed to stdout.
 static bool PrintMinidumpProcess(const string &minidump_file,
                                  const vector<string> &symbol_paths,
-                                 bool machine_readable) {
+                                 OutputFormat format) {
   scoped_ptr<SimpleSymbolSupplier> symbol_supplier;
   if (!symbol_paths.empty()) {
     // TODO(mmentovai): check existence of symbol_path if specified?
@@ -587,58 +825,162 @@ static bool PrintMinidumpProcess(const string &minidump_file,
     return false;
   }
 
-  if (machine_readable) {
-    PrintProcessStateMachineReadable(process_state);
-  } else {
-    PrintProcessState(process_state);
-  }
+  PrintProcessStateInFormat(process_state, format);
 
   return true;
 }
 
+// The number of dumps handed to one MinidumpBatchProcessor session
+// before their results are printed and the session discarded.  Bounds
+// how many ProcessStates are held in memory at once while still giving
+// a worker pool enough dumps to keep every thread busy.  Symbols loaded
+// into the resolver persist across sessions.
+static const size_t kBatchChunkSize = 64;
+
+// Processes minidump paths read from stdin, one per line, until EOF.
+// Unlike PrintMinidumpProcess, which builds a fresh supplier and
+// resolver per dump, this keeps one SimpleSymbolSupplier and
+// BasicSourceLineResolver warm for the whole run, so a symbol file
+// parsed for one dump serves every later dump that references the same
+// module.  Up to |worker_threads| dumps are processed concurrently.
+// Each dump's output is preceded by a line naming the dump and its
+// outcome, so downstream consumers can split the stream.  Returns the
+// number of dumps that failed to process.
+static int PrintMinidumpsFromStdin(const vector<string> &symbol_paths,
+                                   OutputFormat format,
+                                   unsigned int worker_threads) {
+  scoped_ptr<SimpleSymbolSupplier> symbol_supplier;
+  if (!symbol_paths.empty()) {
+    symbol_supplier.reset(new SimpleSymbolSupplier(symbol_paths));
+  }
+
+  BasicSourceLineResolver resolver;
+  StackFrameSymbolizer symbolizer(symbol_supplier.get(), &resolver);
+
+  int failures = 0;
+  bool eof = false;
+  while (!eof) {
+    MinidumpBatchProcessor batch(&symbolizer,
+                                 false /* enable_exploitability */);
+    batch.set_max_worker_threads(worker_threads);
+
+    char line[4096];
+    while (batch.entry_count() < kBatchChunkSize) {
+      if (!fgets(line, sizeof(line), stdin)) {
+        eof = true;
+        break;
+      }
+      size_t length = strlen(line);
+      while (length > 0 &&
+             (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+        line[--length] = '\0';
+      }
+      if (length > 0) {
+        batch.AddMinidumpFile(line);
+      }
+    }
+
+    if (batch.entry_count() == 0) {
+      continue;
+    }
+    batch.ProcessAll();
+
+    for (size_t i = 0; i < batch.entry_count(); ++i) {
+      const string &minidump_file = batch.minidump_file(i);
+      bool ok = batch.result(i) == google_breakpad::PROCESS_OK;
+      switch (format) {
+        case OUTPUT_MACHINE_READABLE:
+          printf("Dump%c%s%c%s\n", kOutputSeparator,
+                 StripSeparator(minidump_file).c_str(), kOutputSeparator,
+                 ok ? "OK" : "ERROR");
+          break;
+        case OUTPUT_JSON:
+          JsonBeginRecord("dump");
+          JsonField("path", minidump_file);
+          JsonFieldBool("ok", ok);
+          JsonEndRecord();
+          break;
+        case OUTPUT_HUMAN_READABLE:
+        default:
+          printf("Minidump: %s\n\n", minidump_file.c_str());
+          break;
+      }
+      if (ok) {
+        PrintProcessStateInFormat(*batch.process_state(i), format);
+        if (format != OUTPUT_JSON)
+          printf("\n");
+      } else {
+        BPLOG(ERROR) << "MinidumpProcessor::Process failed for "
+                     << minidump_file;
+        ++failures;
+      }
+      // Let a driver reading our output through a pipe see each dump's
+      // result as soon as it is printed.
+      JsonFlush();
+      fflush(stdout);
+    }
+  }
+
+  return failures;
+}
+
 }  // namespace
 
 static void usage(const char *program_name) {
-  fprintf(stderr, "usage: %s [-m] <minidump-file> [symbol-path ...]\n"
-          "    -m : Output in machine-readable format\n",
+  fprintf(stderr, "usage: %s [-m|-J] [-j <threads>] <minidump-file|-> "
+          "[symbol-path ...]\n"
+          "    -m : Output in machine-readable format\n"
+          "    -J : Output line-delimited JSON, one record per line\n"
+          "    -j : With '-', process up to <threads> dumps concurrently\n"
+          "    -  : Read minidump paths from stdin, one per line, and\n"
+          "         process them all, reusing loaded symbol files across\n"
+          "         dumps\n",
           program_name);
 }
 
 int main(int argc, char **argv) {
   BPLOG_INIT(&argc, &argv);
 
-  if (argc < 2) {
-    usage(argv[0]);
-    return 1;
-  }
-
-  const char *minidump_file;
-  bool machine_readable;
-  int symbol_path_arg;
-
-  if (strcmp(argv[1], "-m") == 0) {
-    if (argc < 3) {
+  OutputFormat format = OUTPUT_HUMAN_READABLE;
+  int worker_threads = 1;
+
+  int argi = 1;
+  while (argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0') {
+    if (strcmp(argv[argi], "-m") == 0) {
+      format = OUTPUT_MACHINE_READABLE;
+    } else if (strcmp(argv[argi], "-J") == 0) {
+      format = OUTPUT_JSON;
+    } else if (strcmp(argv[argi], "-j") == 0 && argi + 1 < argc) {
+      worker_threads = atoi(argv[++argi]);
+      if (worker_threads < 1) {
+        usage(argv[0]);
+        return 1;
+      }
+    } else {
       usage(argv[0]);
       return 1;
     }
+    ++argi;
+  }
 
-    machine_readable = true;
-    minidump_file = argv[2];
-    symbol_path_arg = 3;
-  } else {
-    machine_readable = false;
-    minidump_file = argv[1];
-    symbol_path_arg = 2;
+  if (argi >= argc) {
+    usage(argv[0]);
+    return 1;
   }
+  const char *minidump_file = argv[argi++];
 
   // extra arguments are symbol paths
   std::vector<string> symbol_paths;
-  if (argc > symbol_path_arg) {
-    for (int argi = symbol_path_arg; argi < argc; ++argi)
-      symbol_paths.push_back(argv[argi]);
+  for (; argi < argc; ++argi)
+    symbol_paths.push_back(argv[argi]);
+
+  if (strcmp(minidump_file, "-") == 0) {
+    return PrintMinidumpsFromStdin(symbol_paths,
+                                   format,
+                                   worker_threads) == 0 ? 0 : 1;
   }
 
   return PrintMinidumpProcess(minidump_file,
                               symbol_paths,
-                              machine_readable) ? 0 : 1;
+                              format) ? 0 : 1;
 }
@@ -32,6 +32,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <sstream>
 #include <stdlib.h>
 #include <string>
@@ -62,6 +63,7 @@ using google_breakpad::SynthMinidump::Context;
 using google_breakpad::SynthMinidump::Dump;
 using google_breakpad::SynthMinidump::Exception;
 using google_breakpad::SynthMinidump::Memory;
+using google_breakpad::SynthMinidump::Memory64List;
 using google_breakpad::SynthMinidump::Module;
 using google_breakpad::SynthMinidump::Stream;
 using google_breakpad::SynthMinidump::String;
@@ -71,9 +73,39 @@ using google_breakpad::test_assembler::kBigEndian;
 using google_breakpad::test_assembler::kLittleEndian;
 using std::ifstream;
 using std::istringstream;
+using std::numeric_limits;
 using std::vector;
 using ::testing::Return;
 
+// A minimal MinidumpStream subclass of the kind an embedder would hand
+// to Minidump::RegisterStreamParser: it just slurps its stream's bytes.
+class TestRegisteredStream : public google_breakpad::MinidumpStream {
+ public:
+  static google_breakpad::MinidumpStream* Create(Minidump* minidump) {
+    return new TestRegisteredStream(minidump);
+  }
+
+  const string& contents() const { return contents_; }
+
+ protected:
+  bool Read(uint32_t expected_size) {
+    valid_ = false;
+    contents_.resize(expected_size);
+    if (expected_size != 0 &&
+        !minidump_->ReadBytes(&contents_[0], expected_size)) {
+      return false;
+    }
+    valid_ = true;
+    return true;
+  }
+
+ private:
+  explicit TestRegisteredStream(Minidump* minidump)
+      : MinidumpStream(minidump) { }
+
+  string contents_;
+};
+
 class MinidumpTest : public ::testing::Test {
 public:
   void SetUp() {
@@ -177,6 +209,65 @@ TEST(Dump, OneStream) {
   EXPECT_FALSE(minidump.GetBreakpadInfo());
 }
 
+TEST(Dump, RegisterStreamParser) {
+  Dump dump(0, kLittleEndian);
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+
+  // A parser is mandatory.
+  EXPECT_FALSE(minidump.RegisterStreamParser(0x4abc0001U, NULL));
+
+  // The built-in types keep their built-in parsers.
+  EXPECT_FALSE(minidump.RegisterStreamParser(MD_THREAD_LIST_STREAM,
+                                             TestRegisteredStream::Create));
+  EXPECT_FALSE(minidump.RegisterStreamParser(MD_MEMORY_LIST_STREAM,
+                                             TestRegisteredStream::Create));
+
+  EXPECT_TRUE(minidump.RegisterStreamParser(0x4abc0001U,
+                                            TestRegisteredStream::Create));
+}
+
+TEST(Dump, GetRegisteredStream) {
+  const uint32_t kStreamType = 0xfbb7fa2bU;
+  Dump dump(0, kLittleEndian);
+  Stream stream(dump, kStreamType);
+  stream.Append("stream contents");
+  dump.Add(&stream);
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+
+  // No parser has been registered for the stream's type yet.
+  EXPECT_FALSE(minidump.GetRegisteredStream(kStreamType));
+
+  ASSERT_TRUE(minidump.RegisterStreamParser(kStreamType,
+                                            TestRegisteredStream::Create));
+  ASSERT_TRUE(minidump.RegisterStreamParser(0x4abc0002U,
+                                            TestRegisteredStream::Create));
+
+  // A registered parser doesn't help when its stream is absent from the
+  // dump.
+  EXPECT_FALSE(minidump.GetRegisteredStream(0x4abc0002U));
+
+  google_breakpad::MinidumpStream* parsed =
+      minidump.GetRegisteredStream(kStreamType);
+  ASSERT_TRUE(parsed != NULL);
+  EXPECT_EQ(string("stream contents"),
+            static_cast<TestRegisteredStream*>(parsed)->contents());
+
+  // Later calls return the same object from the stream cache.
+  EXPECT_EQ(parsed, minidump.GetRegisteredStream(kStreamType));
+}
+
 TEST(Dump, OneMemory) {
   Dump dump(0, kBigEndian);
   Memory memory(dump, 0x309d68010bd21b2cULL);
@@ -206,6 +297,226 @@ TEST(Dump, OneMemory) {
   ASSERT_TRUE(memcmp("memory contents", region1_bytes, 15) == 0);
 }
 
+TEST(Dump, MemoryListOverlapping) {
+  Dump dump(0, kLittleEndian);
+  Memory first(dump, 0x1000);
+  first.Append(string(16, 'a'));
+  // The second descriptor's first 8 bytes restate memory the first one
+  // already covers, as dumps from some Windows versions do.
+  Memory second(dump, 0x1008);
+  second.Append(string(16, 'b'));
+  dump.Add(&first);
+  dump.Add(&second);
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+
+  MinidumpMemoryList *memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(memory_list != NULL);
+
+  // Normalization affects only address lookup; the descriptors
+  // themselves are retained as written.
+  ASSERT_EQ(2U, memory_list->region_count());
+  EXPECT_EQ(0x1000U, memory_list->GetMemoryRegionAtIndex(0)->GetBase());
+  EXPECT_EQ(0x1008U, memory_list->GetMemoryRegionAtIndex(1)->GetBase());
+
+  // The overlapped bytes belong to the first descriptor; the second is
+  // trimmed to the portion only it covers.
+  EXPECT_EQ(memory_list->GetMemoryRegionAtIndex(0),
+            memory_list->GetMemoryRegionForAddress(0x100c));
+  EXPECT_EQ(memory_list->GetMemoryRegionAtIndex(1),
+            memory_list->GetMemoryRegionForAddress(0x1012));
+  EXPECT_FALSE(memory_list->GetMemoryRegionForAddress(0x1018));
+  EXPECT_FALSE(memory_list->GetMemoryRegionForAddress(0xfff));
+}
+
+TEST(Dump, MemoryListNested) {
+  Dump dump(0, kLittleEndian);
+  // A descriptor lying entirely within a larger one, and an exact
+  // duplicate of the larger one.  Only the larger descriptor should
+  // ever satisfy an address lookup, regardless of list order.
+  Memory nested(dump, 0x2008);
+  nested.Append(string(8, 'n'));
+  Memory large(dump, 0x2000);
+  large.Append(string(32, 'l'));
+  Memory duplicate(dump, 0x2000);
+  duplicate.Append(string(32, 'd'));
+  dump.Add(&nested);
+  dump.Add(&large);
+  dump.Add(&duplicate);
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+
+  MinidumpMemoryList *memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(memory_list != NULL);
+  ASSERT_EQ(3U, memory_list->region_count());
+
+  MinidumpMemoryRegion *large_region =
+      memory_list->GetMemoryRegionAtIndex(1);
+  ASSERT_TRUE(large_region != NULL);
+  EXPECT_EQ(0x2000U, large_region->GetBase());
+  EXPECT_EQ(32U, large_region->GetSize());
+  EXPECT_EQ(large_region, memory_list->GetMemoryRegionForAddress(0x2000));
+  EXPECT_EQ(large_region, memory_list->GetMemoryRegionForAddress(0x2008));
+  EXPECT_EQ(large_region, memory_list->GetMemoryRegionForAddress(0x201f));
+  EXPECT_FALSE(memory_list->GetMemoryRegionForAddress(0x2020));
+}
+
+TEST(Dump, OneMemory64List) {
+  Dump dump(0, kBigEndian);
+  Memory64List memory64_list(dump);
+  Memory first(dump, 0x309d68010bd21b2cULL);
+  first.Append("first contents");
+  Memory second(dump, 0x46b6d8a173057ac4ULL);
+  second.Append("second region's contents");
+  Memory third(dump, 0xea5c9d940eb33cf8ULL);
+  third.Append("third");
+  memory64_list.Add(&first);
+  memory64_list.Add(&second);
+  memory64_list.Add(&third);
+  dump.Add(&memory64_list);
+  dump.Add(memory64_list.payload());
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+  ASSERT_EQ(1U, minidump.GetDirectoryEntryCount());
+
+  const MDRawDirectory *dir = minidump.GetDirectoryEntryAtIndex(0);
+  ASSERT_TRUE(dir != NULL);
+  EXPECT_EQ((uint32_t) MD_MEMORY_64_LIST_STREAM, dir->stream_type);
+
+  MinidumpMemoryList *memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(memory_list != NULL);
+  ASSERT_EQ(3U, memory_list->region_count());
+
+  // The descriptors carry no per-region location: each region's file
+  // offset is the stream's base_rva plus the sizes of the regions
+  // before it.  Reading back the right bytes for the second and third
+  // regions means that accumulation worked.
+  MinidumpMemoryRegion *region1 = memory_list->GetMemoryRegionAtIndex(0);
+  ASSERT_TRUE(region1 != NULL);
+  EXPECT_EQ(0x309d68010bd21b2cULL, region1->GetBase());
+  ASSERT_EQ(14U, region1->GetSize());
+  const uint8_t *region1_bytes = region1->GetMemory();
+  ASSERT_TRUE(region1_bytes != NULL);
+  EXPECT_TRUE(memcmp("first contents", region1_bytes, 14) == 0);
+
+  MinidumpMemoryRegion *region2 = memory_list->GetMemoryRegionAtIndex(1);
+  ASSERT_TRUE(region2 != NULL);
+  EXPECT_EQ(0x46b6d8a173057ac4ULL, region2->GetBase());
+  ASSERT_EQ(24U, region2->GetSize());
+  const uint8_t *region2_bytes = region2->GetMemory();
+  ASSERT_TRUE(region2_bytes != NULL);
+  EXPECT_TRUE(memcmp("second region's contents", region2_bytes, 24) == 0);
+
+  MinidumpMemoryRegion *region3 = memory_list->GetMemoryRegionAtIndex(2);
+  ASSERT_TRUE(region3 != NULL);
+  EXPECT_EQ(0xea5c9d940eb33cf8ULL, region3->GetBase());
+  ASSERT_EQ(5U, region3->GetSize());
+  const uint8_t *region3_bytes = region3->GetMemory();
+  ASSERT_TRUE(region3_bytes != NULL);
+  EXPECT_TRUE(memcmp("third", region3_bytes, 5) == 0);
+
+  // Address lookup should work across the list, too.
+  EXPECT_EQ(region2, memory_list->GetMemoryRegionForAddress(
+      0x46b6d8a173057ac4ULL + 10));
+}
+
+TEST(Dump, Memory64ListZeroSizeRegion) {
+  Dump dump(0, kLittleEndian);
+  Memory64List memory64_list(dump);
+  memory64_list.AddRawDescriptor(0x309d68010bd21b2cULL, 0);
+  dump.Add(&memory64_list);
+  dump.Add(memory64_list.payload());
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+  EXPECT_FALSE(minidump.GetMemoryList());
+}
+
+TEST(Dump, Memory64ListBaseAddressOverflow) {
+  Dump dump(0, kLittleEndian);
+  Memory64List memory64_list(dump);
+  // base + size wraps around the 64-bit address space.
+  memory64_list.AddRawDescriptor(0xffffffffffffff00ULL, 0x200);
+  dump.Add(&memory64_list);
+  dump.Add(memory64_list.payload());
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+  EXPECT_FALSE(minidump.GetMemoryList());
+}
+
+TEST(Dump, Memory64ListFileOffsetOverflow) {
+  Dump dump(0, kLittleEndian);
+  Memory64List memory64_list(dump);
+  // The base address itself tolerates this size, but base_rva plus the
+  // size wraps around any addressable file offset.
+  memory64_list.AddRawDescriptor(0, 0xffffffffffffffffULL);
+  dump.Add(&memory64_list);
+  dump.Add(memory64_list.payload());
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+  EXPECT_FALSE(minidump.GetMemoryList());
+}
+
+TEST(Dump, Memory64ListHugeRegion) {
+  Dump dump(0, kLittleEndian);
+  Memory64List memory64_list(dump);
+  // A well-formed descriptor for more memory than the dump holds ---
+  // 5GB, exceeding even GetSize's 32-bit interface.
+  const uint64_t kRegionSize = 0x140000000ULL;
+  memory64_list.AddRawDescriptor(0x1000, kRegionSize);
+  dump.Add(&memory64_list);
+  dump.Add(memory64_list.payload());
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+
+  // The descriptor itself is acceptable...
+  MinidumpMemoryList *memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(memory_list != NULL);
+  ASSERT_EQ(1U, memory_list->region_count());
+  MinidumpMemoryRegion *region1 = memory_list->GetMemoryRegionAtIndex(0);
+  ASSERT_TRUE(region1 != NULL);
+  EXPECT_EQ(0x1000U, region1->GetBase());
+  EXPECT_EQ(numeric_limits<uint32_t>::max(), region1->GetSize());
+
+  // ...but GetMemory refuses to materialize a region larger than
+  // max_bytes from a stream-backed dump.
+  EXPECT_TRUE(region1->GetMemory() == NULL);
+}
+
 // One thread --- and its requisite entourage.
 TEST(Dump, OneThread) {
   Dump dump(0, kLittleEndian);
@@ -0,0 +1,73 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// module_blob_store.h: The interface shared by stores of serialized
+// symbol modules (the container format produced by
+// ModuleSerializer::SerializeToContainer).  SerializedModuleCache keeps
+// blobs on disk; SharedModuleStore keeps them in POSIX shared memory.
+// ModuleSerializer::ConvertOneModuleCached works against this interface,
+// so processors choose a backing without caring which.
+//
+// A store owns the blob memory it hands to a resolver, and
+// FastSourceLineResolver keeps pointers into a loaded module's buffer,
+// so a store must outlive any resolver modules loaded from it.
+
+#ifndef PROCESSOR_MODULE_BLOB_STORE_H__
+#define PROCESSOR_MODULE_BLOB_STORE_H__
+
+#include <stddef.h>
+
+namespace google_breakpad {
+
+class CodeModule;
+class FastSourceLineResolver;
+
+class ModuleBlobStore {
+ public:
+  virtual ~ModuleBlobStore() {}
+
+  // Makes the stored serialized blob for module, if one exists,
+  // available in memory and loads it into fast_resolver.  Returns false
+  // if the module is not stored or the blob could not be loaded; a
+  // false return is the normal miss case, not an error.
+  virtual bool Load(const CodeModule *module,
+                    FastSourceLineResolver *fast_resolver) = 0;
+
+  // Stores size bytes of serialized module data for module.  data must
+  // be a container produced by ModuleSerializer::SerializeToContainer;
+  // Load validates the container before using a stored blob.  Returns
+  // false if the module has no usable key or the store fails.
+  virtual bool Store(const CodeModule *module,
+                     const char *data,
+                     size_t size) = 0;
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_MODULE_BLOB_STORE_H__
@@ -34,10 +34,16 @@
 
 #include "processor/module_comparer.h"
 
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common/scoped_ptr.h"
+#include "google_breakpad/processor/stack_frame.h"
 #include "processor/basic_code_module.h"
 #include "processor/logging.h"
 
@@ -52,6 +58,18 @@
 
 namespace google_breakpad {
 
+// Returns the wall clock in microseconds, or 0 where no cheap clock is
+// available (Windows), which zeroes the benchmark timings.
+static uint64_t NowMicroseconds() {
+#ifndef _WIN32
+  struct timeval time_now;
+  gettimeofday(&time_now, NULL);
+  return static_cast<uint64_t>(time_now.tv_sec) * 1000000 + time_now.tv_usec;
+#else
+  return 0;
+#endif
+}
+
 bool ModuleComparer::Compare(const string &symbol_data) {
   scoped_ptr<BasicModule> basic_module(new BasicModule("test_module"));
   scoped_ptr<FastModule> fast_module(new FastModule("test_module"));
@@ -79,6 +97,68 @@ bool ModuleComparer::Compare(const string &symbol_data) {
   return true;
 }
 
+bool ModuleComparer::Benchmark(const string &symbol_data,
+                               const std::vector<MemAddr> &address_trace,
+                               unsigned int trace_passes,
+                               BenchmarkResult *result) {
+  scoped_ptr<BasicModule> basic_module(new BasicModule("benchmark_module"));
+  scoped_ptr<FastModule> fast_module(new FastModule("benchmark_module"));
+
+  result->symbol_bytes = symbol_data.size();
+
+  // Parse the text symbol data into the basic module.
+  scoped_array<char> buffer(new char[symbol_data.size() + 1]);
+  strcpy(buffer.get(), symbol_data.c_str());
+  uint64_t start_time_us = NowMicroseconds();
+  ASSERT_TRUE(basic_module->LoadMapFromMemory(buffer.get()));
+  result->parse_time_us = NowMicroseconds() - start_time_us;
+  buffer.reset();
+
+  // Serialize the basic module.
+  unsigned int serialized_size = 0;
+  start_time_us = NowMicroseconds();
+  scoped_array<char> serialized_data(
+      serializer_.Serialize(*(basic_module.get()), &serialized_size));
+  result->serialize_time_us = NowMicroseconds() - start_time_us;
+  ASSERT_TRUE(serialized_data.get());
+  result->serialized_bytes = serialized_size;
+
+  // Load the fast module from the serialized data.
+  start_time_us = NowMicroseconds();
+  ASSERT_TRUE(fast_module->LoadMapFromMemory(serialized_data.get()));
+  result->fast_load_time_us = NowMicroseconds() - start_time_us;
+
+  // Replay the address trace against each module.  One frame is reused
+  // throughout so the loop times lookups, not frame construction.  The
+  // lookups subtract the module's base address, so a zero-based module
+  // makes the trace addresses module-relative, as symbol files are.
+  result->trace_lookups =
+      static_cast<uint64_t>(address_trace.size()) * trace_passes;
+
+  BasicCodeModule code_module(0, 0, "benchmark_module", "", "", "", "");
+  StackFrame frame;
+  frame.module = &code_module;
+  start_time_us = NowMicroseconds();
+  for (unsigned int pass = 0; pass < trace_passes; ++pass) {
+    for (size_t i = 0; i < address_trace.size(); ++i) {
+      frame.instruction = address_trace[i];
+      basic_module->LookupAddress(&frame);
+    }
+  }
+  result->basic_lookup_time_us = NowMicroseconds() - start_time_us;
+
+  start_time_us = NowMicroseconds();
+  for (unsigned int pass = 0; pass < trace_passes; ++pass) {
+    for (size_t i = 0; i < address_trace.size(); ++i) {
+      frame.instruction = address_trace[i];
+      fast_module->LookupAddress(&frame);
+    }
+  }
+  result->fast_lookup_time_us = NowMicroseconds() - start_time_us;
+
+  return true;
+}
+
 // Traversal the content of module and do comparison
 bool ModuleComparer::CompareModule(const BasicModule *basic_module,
                                   const FastModule *fast_module) const {
@@ -103,7 +183,7 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
 
   // Compare functions_:
   {
-    RangeMap<MemAddr, linked_ptr<BasicFunc> >::MapConstIterator iter1;
+    RangeMap<MemAddr, BasicFunc*>::MapConstIterator iter1;
     StaticRangeMap<MemAddr, FastFunc>::MapConstIterator iter2;
     iter1 = basic_module->functions_.map_.begin();
     iter2 = fast_module->functions_.map_.begin();
@@ -112,7 +192,7 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       ASSERT_TRUE(iter1->second.base() == iter2.GetValuePtr()->base());
       ASSERT_TRUE(CompareFunction(
-          iter1->second.entry().get(), iter2.GetValuePtr()->entryptr()));
+          iter1->second.entry(), iter2.GetValuePtr()->entryptr()));
       ++iter1;
       ++iter2;
     }
@@ -122,7 +202,7 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
 
   // Compare public_symbols_:
   {
-    AddressMap<MemAddr, linked_ptr<BasicPubSymbol> >::MapConstIterator iter1;
+    AddressMap<MemAddr, BasicPubSymbol*>::MapConstIterator iter1;
     StaticAddressMap<MemAddr, FastPubSymbol>::MapConstIterator iter2;
     iter1 = basic_module->public_symbols_.map_.begin();
     iter2 = fast_module->public_symbols_.map_.begin();
@@ -130,7 +210,7 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
           && iter2 != fast_module->public_symbols_.map_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       ASSERT_TRUE(ComparePubSymbol(
-          iter1->second.get(), iter2.GetValuePtr()));
+          iter1->second, iter2.GetValuePtr()));
       ++iter1;
       ++iter2;
     }
@@ -193,7 +273,7 @@ bool ModuleComparer::CompareFunction(const BasicFunc *basic_func,
   ASSERT_TRUE(basic_func->size == fast_func->size);
 
   // compare range map of lines:
-  RangeMap<MemAddr, linked_ptr<BasicLine> >::MapConstIterator iter1;
+  RangeMap<MemAddr, BasicLine*>::MapConstIterator iter1;
   StaticRangeMap<MemAddr, FastLine>::MapConstIterator iter2;
   iter1 = basic_func->lines.map_.begin();
   iter2 = fast_func->lines.map_.begin();
@@ -201,7 +281,7 @@ bool ModuleComparer::CompareFunction(const BasicFunc *basic_func,
       && iter2 != fast_func->lines.map_.end()) {
     ASSERT_TRUE(iter1->first == iter2.GetKey());
     ASSERT_TRUE(iter1->second.base() == iter2.GetValuePtr()->base());
-    ASSERT_TRUE(CompareLine(iter1->second.entry().get(),
+    ASSERT_TRUE(CompareLine(iter1->second.entry(),
                             iter2.GetValuePtr()->entryptr()));
     ++iter1;
     ++iter2;
@@ -42,6 +42,7 @@
 #define PROCESSOR_MODULE_COMPARER_H__
 
 #include <string>
+#include <vector>
 
 #include "processor/basic_source_line_resolver_types.h"
 #include "processor/fast_source_line_resolver_types.h"
@@ -52,6 +53,38 @@ namespace google_breakpad {
 
 class ModuleComparer {
  public:
+  // Timings and sizes measured by Benchmark for one module.  Times are
+  // wall-clock microseconds; zero on platforms without a cheap clock.
+  struct BenchmarkResult {
+    BenchmarkResult()
+        : symbol_bytes(0),
+          serialized_bytes(0),
+          parse_time_us(0),
+          serialize_time_us(0),
+          fast_load_time_us(0),
+          trace_lookups(0),
+          basic_lookup_time_us(0),
+          fast_lookup_time_us(0) {}
+
+    // Size of the text symbol data, and of the serialized form - which
+    // is also the fast resolver's resident footprint for the module,
+    // since it resolves directly out of that buffer.
+    size_t symbol_bytes;
+    size_t serialized_bytes;
+
+    // Text parse into the basic module, basic module serialization, and
+    // fast module load of the serialized data.
+    uint64_t parse_time_us;
+    uint64_t serialize_time_us;
+    uint64_t fast_load_time_us;
+
+    // Address lookups timed against each module (the whole trace,
+    // trace_passes times), and the total time each took.
+    uint64_t trace_lookups;
+    uint64_t basic_lookup_time_us;
+    uint64_t fast_lookup_time_us;
+  };
+
   ModuleComparer(): fast_resolver_(new FastSourceLineResolver),
                    basic_resolver_(new BasicSourceLineResolver) { }
   ~ModuleComparer() {
@@ -66,6 +99,17 @@ class ModuleComparer {
   // return true if both modules contain exactly same data.
   bool Compare(const string &symbol_data);
 
+  // Loads symbol_data the same way Compare does, but times each stage
+  // and then replays address_trace against both modules trace_passes
+  // times, filling *result with the measurements.  The trace should be
+  // recorded from production lookups (or sampled from the module's own
+  // functions) so the throughput numbers reflect real access patterns.
+  // Returns false if any stage fails.
+  bool Benchmark(const string &symbol_data,
+                 const std::vector<MemAddr> &address_trace,
+                 unsigned int trace_passes,
+                 BenchmarkResult *result);
+
  private:
   typedef BasicSourceLineResolver::Module BasicModule;
   typedef FastSourceLineResolver::Module FastModule;
@@ -35,19 +35,243 @@
 
 #include "processor/module_serializer.h"
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
 #include <map>
 #include <string>
+#include <vector>
 
+#include "common/scoped_ptr.h"
 #include "processor/basic_code_module.h"
+#include "processor/contained_range_map-inl.h"
 #include "processor/logging.h"
+#include "processor/module_blob_store.h"
+#include "processor/serialized_module_format.h"
+#include "processor/static_map_compact.h"
+#include "processor/tokenize.h"
 
 namespace google_breakpad {
 
 // Definition of static member variable in SimplerSerializer<Funcion>, which
 // is declared in file "simple_serializer-inl.h"
-RangeMapSerializer< MemAddr, linked_ptr<BasicSourceLineResolver::Line> >
+RangeMapSerializer<MemAddr, BasicSourceLineResolver::Line*>
 SimpleSerializer<BasicSourceLineResolver::Function>::range_map_serializer_;
 
+namespace {
+
+// Emits one serialized StaticMap section - the layout StdMapSerializer,
+// RangeMapSerializer and AddressMapSerializer produce from the
+// resolver's trees - directly from records appended as they are parsed
+// out of symbol text.  Each record becomes one node: StartNode records
+// its key, and the value's bytes follow through the Append methods.
+// Records usually arrive already in key order, in which case Finish and
+// WriteSection amount to one pass over the accumulated bytes; stragglers
+// cost a stable sort of the key table, never a tree.
+template<typename Key>
+class StaticMapSectionBuilder {
+ public:
+  // What Finish does with nodes sharing one key, matching the container
+  // the section stands in for: an AddressMap rejects the whole load on
+  // a duplicate, std::map::insert keeps the first arrival, operator[]
+  // assignment keeps the last.
+  enum DuplicatePolicy {
+    DUPLICATES_REJECT,
+    DUPLICATES_KEEP_FIRST,
+    DUPLICATES_KEEP_LAST
+  };
+
+  // is_range_map selects RangeMapSerializer's layout checks: keys are
+  // range high addresses, every value leads with the range's base, and
+  // ranges may not overlap.
+  StaticMapSectionBuilder(DuplicatePolicy policy, bool is_range_map)
+      : policy_(policy), is_range_map_(is_range_map), sorted_(true) {}
+
+  // Starts the node stored under key.
+  void StartNode(Key key) {
+    if (!keys_.empty() && key <= keys_.back())
+      sorted_ = false;
+    keys_.push_back(key);
+    offsets_.push_back(static_cast<uint32_t>(values_.size()));
+  }
+
+  // Append the current node's value, in the byte layout the section's
+  // SimpleSerializer would write.
+  void AppendBytes(const void *data, size_t data_size) {
+    values_.append(static_cast<const char*>(data), data_size);
+  }
+
+  template<typename ValueType>
+  void AppendScalar(const ValueType &item) {
+    char buffer[sizeof(ValueType)];
+    SimpleSerializer<ValueType>::Write(item, buffer);
+    values_.append(buffer, sizeof(ValueType));
+  }
+
+  void AppendString(const char *str) {
+    values_.append(str, strlen(str) + 1);
+  }
+
+  // Orders the nodes for emission and applies the duplicate policy.
+  // Returns false when sorting alone cannot reproduce what the tree
+  // would have held - a duplicate key under DUPLICATES_REJECT, or
+  // overlapping ranges, whose drop-the-later-arrival semantics depend
+  // on insertion order - so the caller can fall back to the trees.
+  bool Finish() {
+    const size_t count = keys_.size();
+    std::vector<uint32_t> order(count);
+    for (size_t index = 0; index < count; ++index)
+      order[index] = static_cast<uint32_t>(index);
+    if (!sorted_)
+      std::stable_sort(order.begin(), order.end(), OrderByKey(&keys_));
+
+    final_order_.reserve(count);
+    sorted_keys_.reserve(count);
+    for (size_t position = 0; position < count; ++position) {
+      const uint32_t index = order[position];
+      const Key key = keys_[index];
+      if (!sorted_keys_.empty() && key == sorted_keys_.back()) {
+        if (policy_ == DUPLICATES_REJECT)
+          return false;
+        // The stable sort keeps equal keys in arrival order, so the
+        // node already in place is the first arrival.
+        if (policy_ == DUPLICATES_KEEP_LAST)
+          final_order_.back() = index;
+        continue;
+      }
+      if (is_range_map_ && !sorted_keys_.empty() &&
+          NodeBase(index) <= sorted_keys_.back())
+        return false;
+      final_order_.push_back(index);
+      sorted_keys_.push_back(key);
+    }
+    return true;
+  }
+
+  // The section's serialized size.  Only valid after Finish().
+  size_t SectionSize() const {
+    size_t size = sizeof(uint32_t)  // node-count word
+                  + sorted_keys_.size() * sizeof(uint32_t);  // offsets
+    if (KeysCompact())
+      size += StaticMapCompactKeysWriter<Key>::RegionSize(sorted_keys_);
+    else
+      size += sorted_keys_.size() * sizeof(Key);
+    for (size_t position = 0; position < final_order_.size(); ++position)
+      size += NodeLength(final_order_[position]);
+    return size;
+  }
+
+  // Writes the section to dest, which must have SectionSize() bytes,
+  // and returns the address past its final byte.  Only valid after
+  // Finish().
+  char* WriteSection(char *dest) const {
+    char *start_address = dest;
+    const size_t count = sorted_keys_.size();
+    uint32_t node_count_word = static_cast<uint32_t>(count);
+    const bool compact = KeysCompact();
+    if (compact)
+      node_count_word |= kStaticMapCompactKeysFlag;
+    dest = SimpleSerializer<uint32_t>::Write(node_count_word, dest);
+    uint32_t *section_offsets = reinterpret_cast<uint32_t*>(dest);
+    dest += sizeof(uint32_t) * count;
+    if (compact) {
+      dest = StaticMapCompactKeysWriter<Key>::Write(sorted_keys_, dest);
+    } else {
+      for (size_t position = 0; position < count; ++position)
+        dest = SimpleSerializer<Key>::Write(sorted_keys_[position], dest);
+    }
+    for (size_t position = 0; position < count; ++position) {
+      const uint32_t index = final_order_[position];
+      section_offsets[position] = static_cast<uint32_t>(dest - start_address);
+      const size_t length = NodeLength(index);
+      memcpy(dest, values_.data() + offsets_[index], length);
+      dest += length;
+    }
+    return dest;
+  }
+
+ private:
+  struct OrderByKey {
+    explicit OrderByKey(const std::vector<Key> *set_keys) : keys(set_keys) {}
+    bool operator()(uint32_t left, uint32_t right) const {
+      return (*keys)[left] < (*keys)[right];
+    }
+    const std::vector<Key> *keys;
+  };
+
+  // Bytes of the node's value; node values sit back to back in
+  // arrival order.
+  size_t NodeLength(uint32_t index) const {
+    const size_t end = (static_cast<size_t>(index) + 1 < offsets_.size()) ?
+        offsets_[index + 1] : values_.size();
+    return end - offsets_[index];
+  }
+
+  // For range-map sections, the base address every value leads with.
+  Key NodeBase(uint32_t index) const {
+    Key base;
+    memcpy(&base, values_.data() + offsets_[index], sizeof(Key));
+    return base;
+  }
+
+  bool KeysCompact() const {
+    return StaticMapCompactKeysWriter<Key>::ShouldCompact(
+        sorted_keys_, sorted_keys_.size() * sizeof(Key));
+  }
+
+  const DuplicatePolicy policy_;
+  const bool is_range_map_;
+
+  // Whether the keys have arrived in strictly ascending order so far.
+  bool sorted_;
+
+  // Per node, in arrival order: its key and its value's start in
+  // values_.
+  std::vector<Key> keys_;
+  std::vector<uint32_t> offsets_;
+  string values_;
+
+  // Filled by Finish: arrival indices of the surviving nodes in key
+  // order, and their keys, ascending.
+  std::vector<uint32_t> final_order_;
+  std::vector<Key> sorted_keys_;
+};
+
+// Appends the FUNC record whose lines have been accumulated in lines as
+// one node of the functions section: the range's base, the function
+// fields, then the lines sub-map in RangeMapSerializer's layout, built
+// via submap_scratch.  Returns false when the lines cannot be emitted
+// faithfully (see StaticMapSectionBuilder::Finish).
+bool AppendFunctionNode(const string &name,
+                        MemAddr address,
+                        MemAddr function_size,
+                        int32_t parameter_size,
+                        StaticMapSectionBuilder<MemAddr> *lines,
+                        StaticMapSectionBuilder<MemAddr> *functions,
+                        string *submap_scratch) {
+  if (!lines->Finish())
+    return false;
+  const size_t submap_size = lines->SectionSize();
+  submap_scratch->resize(submap_size);
+  lines->WriteSection(&(*submap_scratch)[0]);
+
+  functions->StartNode(address + function_size - 1);
+  functions->AppendScalar(address);  // the range's base
+  functions->AppendString(name.c_str());
+  functions->AppendScalar(address);
+  functions->AppendScalar(function_size);
+  functions->AppendScalar(parameter_size);
+  functions->AppendBytes(submap_scratch->data(), submap_size);
+  return true;
+}
+
+}  // namespace
+
 size_t ModuleSerializer::SizeOf(const BasicSourceLineResolver::Module &module) {
   size_t total_size_alloc_ = 0;
 
@@ -94,29 +318,152 @@ char *ModuleSerializer::Write(const BasicSourceLineResolver::Module &module,
   return dest;
 }
 
+char* ModuleSerializer::SerializeSection(
+    const BasicSourceLineResolver::Module &module,
+    int map_index,
+    unsigned int *size) {
+  const int wfi_base_index = 3;
+  const int cfi_init_rules_index =
+      wfi_base_index + WindowsFrameInfo::STACK_INFO_LAST;
+
+  if (map_index == 0)
+    return files_serializer_.Serialize(module.files_, size);
+  if (map_index == 1)
+    return functions_serializer_.Serialize(module.functions_, size);
+  if (map_index == 2)
+    return pubsym_serializer_.Serialize(module.public_symbols_, size);
+  if (map_index < cfi_init_rules_index)
+    return wfi_serializer_.Serialize(
+        &(module.windows_frame_info_[map_index - wfi_base_index]), size);
+  if (map_index == cfi_init_rules_index)
+    return cfi_init_rules_serializer_.Serialize(module.cfi_initial_rules_,
+                                                size);
+  return cfi_delta_rules_serializer_.Serialize(module.cfi_delta_rules_, size);
+}
+
+#ifndef _WIN32
+// The work shared by Serialize's section workers.  Workers claim map
+// section indices from next_section under lock; the sections cover
+// disjoint maps, so they serialize concurrently without further
+// coordination.
+struct SectionWorkPool {
+  pthread_mutex_t lock;
+  int next_section;
+  int section_count;
+  ModuleSerializer* serializer;
+  // Really a const BasicSourceLineResolver::Module*; that type is
+  // private to its resolver, so only ModuleSerializer members (which
+  // the resolver befriends) may name it.
+  const void* module;
+  char** section_data;
+  uint32_t* section_sizes;
+};
+
+// static
+void* ModuleSerializer::SerializeSectionWorker(void* arg) {
+  SectionWorkPool* pool = static_cast<SectionWorkPool*>(arg);
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    int section = pool->next_section++;
+    pthread_mutex_unlock(&pool->lock);
+    if (section >= pool->section_count) {
+      return NULL;
+    }
+    const BasicSourceLineResolver::Module* module =
+        static_cast<const BasicSourceLineResolver::Module*>(pool->module);
+    unsigned int section_size = 0;
+    pool->section_data[section] =
+        pool->serializer->SerializeSection(*module, section, &section_size);
+    pool->section_sizes[section] = section_size;
+  }
+}
+#endif  // _WIN32
+
 char* ModuleSerializer::Serialize(
     const BasicSourceLineResolver::Module &module, unsigned int *size) {
-  // Compute size of memory to allocate.
-  unsigned int size_to_alloc = SizeOf(module);
+  // Serialize each map section into its own buffer, sizing and writing
+  // one map while it is hot in cache, rather than running a SizeOf pass
+  // over every map and then a second Write pass over them all.  The
+  // sections are independent, so they can also go to worker threads.
+  char* section_data[kNumberMaps_];
+  for (int i = 0; i < kNumberMaps_; ++i)
+    section_data[i] = NULL;
 
-  // Allocate memory for serialized data.
-  char *serialized_data = new char[size_to_alloc];
+  bool serialized_concurrently = false;
+#ifndef _WIN32
+  if (max_worker_threads_ > 1) {
+    SectionWorkPool pool;
+    pthread_mutex_init(&pool.lock, NULL);
+    pool.next_section = 0;
+    pool.section_count = kNumberMaps_;
+    pool.serializer = this;
+    pool.module = &module;
+    pool.section_data = section_data;
+    pool.section_sizes = map_sizes_;
+
+    unsigned int worker_count = max_worker_threads_;
+    if (worker_count > static_cast<unsigned int>(kNumberMaps_)) {
+      worker_count = kNumberMaps_;
+    }
+
+    std::vector<pthread_t> workers(worker_count);
+    unsigned int started = 0;
+    while (started < worker_count) {
+      if (pthread_create(&workers[started], NULL, SerializeSectionWorker,
+                         &pool) != 0) {
+        break;
+      }
+      ++started;
+    }
+    for (unsigned int i = 0; i < started; ++i) {
+      pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+    // Even a single started worker drains every section; only a total
+    // failure to spawn falls back to the serial loop below.
+    serialized_concurrently = started > 0;
+  }
+#endif  // _WIN32
+
+  if (!serialized_concurrently) {
+    for (int i = 0; i < kNumberMaps_; ++i) {
+      unsigned int section_size = 0;
+      section_data[i] = SerializeSection(module, i, &section_size);
+      map_sizes_[i] = section_size;
+    }
+  }
+
+  bool failed = false;
+  size_t table_size = kNumberMaps_ * sizeof(uint32_t);
+  // Header table, sections, and one null terminator for C-string copy
+  // safety, as before.
+  unsigned int size_to_alloc = static_cast<unsigned int>(table_size) + 1;
+  for (int i = 0; i < kNumberMaps_; ++i) {
+    if (!section_data[i])
+      failed = true;
+    size_to_alloc += map_sizes_[i];
+  }
+
+  char *serialized_data = failed ? NULL : new char[size_to_alloc];
   if (!serialized_data) {
-    BPLOG(ERROR) << "ModuleSerializer: memory allocation failed, "
+    BPLOG(ERROR) << "ModuleSerializer: serialization failed, "
                  << "size to alloc: " << size_to_alloc;
+    for (int i = 0; i < kNumberMaps_; ++i)
+      delete [] section_data[i];
     if (size) *size = 0;
     return NULL;
   }
 
-  // Write serialized data to allocated memory chunk.
-  char *end_address = Write(module, serialized_data);
-  // Verify the allocated memory size is equal to the size of data been written.
-  unsigned int size_written =
-      static_cast<unsigned int>(end_address - serialized_data);
-  if (size_to_alloc != size_written) {
-    BPLOG(ERROR) << "size_to_alloc differs from size_written: "
-                   << size_to_alloc << " vs " << size_written;
+  // Assemble the final buffer: now that every section's size is known,
+  // the section-size table leads, followed by the sections in order.
+  memcpy(serialized_data, map_sizes_, table_size);
+  char *dest = serialized_data + table_size;
+  for (int i = 0; i < kNumberMaps_; ++i) {
+    memcpy(dest, section_data[i], map_sizes_[i]);
+    dest += map_sizes_[i];
+    delete [] section_data[i];
   }
+  *dest = 0;
 
   // Set size and return the start address of memory chunk.
   if (size)
@@ -124,10 +471,58 @@ char* ModuleSerializer::Serialize(
   return serialized_data;
 }
 
+char* ModuleSerializer::SerializeToContainer(
+    const BasicSourceLineResolver::Module &module, unsigned int *size) {
+  unsigned int payload_size = 0;
+  scoped_array<char> payload(Serialize(module, &payload_size));
+  if (!payload.get()) {
+    if (size) *size = 0;
+    return NULL;
+  }
+  return WrapPayloadInContainer(payload.get(), payload_size, size);
+}
+
+char* ModuleSerializer::WrapPayloadInContainer(const char *payload,
+                                               unsigned int payload_size,
+                                               unsigned int *size) {
+  size_t table_size = kNumberMaps_ * sizeof(uint32_t);
+  unsigned int container_size =
+      sizeof(SerializedModuleHeader) + table_size + payload_size;
+  char *container = new char[container_size];
+
+  // Section offsets are relative to the start of the payload, which
+  // leads with its own table of section sizes.
+  uint32_t section_offsets[kNumberMaps_];
+  uint32_t offset = kNumberMaps_ * sizeof(uint32_t);
+  for (int32_t map_index = 0; map_index < kNumberMaps_; ++map_index) {
+    section_offsets[map_index] = offset;
+    offset += map_sizes_[map_index];
+  }
+
+  char *section_table = container + sizeof(SerializedModuleHeader);
+  memcpy(section_table, section_offsets, table_size);
+  memcpy(section_table + table_size, payload, payload_size);
+
+  SerializedModuleHeader header;
+  header.magic = kSerializedModuleMagic;
+  header.version = kSerializedModuleVersion;
+  header.endianness = SerializedModuleHostEndianness();
+  header.address_size = sizeof(MemAddr);
+  header.section_count = kNumberMaps_;
+  header.data_size = payload_size;
+  header.checksum =
+      SerializedModuleChecksum(section_table, table_size + payload_size);
+  memcpy(container, &header, sizeof(header));
+
+  if (size)
+    *size = container_size;
+  return container;
+}
+
 bool ModuleSerializer::SerializeModuleAndLoadIntoFastResolver(
     const BasicSourceLineResolver::ModuleMap::const_iterator &iter,
     FastSourceLineResolver *fast_resolver) {
-  BPLOG(INFO) << "Converting symbol " << iter->first.c_str();
+  BPLOG(INFO) << "Converting symbol " << iter->first.code_file;
 
   // Cast SourceLineResolverBase::Module* to BasicSourceLineResolver::Module*.
   BasicSourceLineResolver::Module* basic_module =
@@ -148,7 +543,7 @@ bool ModuleSerializer::SerializeModuleAndLoadIntoFastResolver(
   symbol_data.reset();
 
   scoped_ptr<CodeModule> code_module(
-      new BasicCodeModule(0, 0, iter->first, "", "", "", ""));
+      new BasicCodeModule(0, 0, iter->first.code_file, "", "", "", ""));
 
   return fast_resolver->LoadModuleUsingMapBuffer(code_module.get(),
                                                  symbol_data_string);
@@ -177,15 +572,300 @@ bool ModuleSerializer::ConvertOneModule(
     return false;
 
   BasicSourceLineResolver::ModuleMap::const_iterator iter;
-  iter = basic_resolver->modules_->find(moduleid);
+  iter = basic_resolver->modules_->find(
+      BasicSourceLineResolver::ModuleKey(moduleid));
   if (iter == basic_resolver->modules_->end())
     return false;
 
   return SerializeModuleAndLoadIntoFastResolver(iter, fast_resolver);
 }
 
+bool ModuleSerializer::ConvertOneModuleCached(
+    const CodeModule *code_module,
+    const BasicSourceLineResolver *basic_resolver,
+    FastSourceLineResolver *fast_resolver,
+    ModuleBlobStore *store) {
+  // Check for NULL pointer.
+  if (!code_module || !fast_resolver)
+    return false;
+
+  if (store && store->Load(code_module, fast_resolver)) {
+    BPLOG(INFO) << "Loaded cached serialized symbols for "
+                << code_module->code_file();
+    return true;
+  }
+
+  if (!basic_resolver)
+    return false;
+
+  BasicSourceLineResolver::ModuleMap::const_iterator iter;
+  iter = basic_resolver->modules_->find(
+      BasicSourceLineResolver::ModuleKey(code_module));
+  if (iter == basic_resolver->modules_->end())
+    return false;
+
+  // Cast SourceLineResolverBase::Module* to BasicSourceLineResolver::Module*.
+  BasicSourceLineResolver::Module* basic_module =
+      dynamic_cast<BasicSourceLineResolver::Module*>(iter->second);
+
+  unsigned int container_size = 0;
+  scoped_array<char> container(SerializeToContainer(*basic_module,
+                                                    &container_size));
+  if (!container.get()) {
+    BPLOG(ERROR) << "Serialization failed for module: " << basic_module->name_;
+    return false;
+  }
+
+  if (store && store->Store(code_module, container.get(), container_size)) {
+    // Load from the freshly stored blob, so this process shares its
+    // mapping with later ones through the page cache.
+    if (store->Load(code_module, fast_resolver))
+      return true;
+  }
+
+  // The store couldn't be used; fall back to loading the in-memory copy
+  // of the container's payload.
+  const char *payload = NULL;
+  size_t payload_size = 0;
+  if (!ValidateSerializedModule(container.get(), container_size,
+                                &payload, &payload_size)) {
+    return false;
+  }
+  string symbol_data_string(payload, payload_size);
+  container.reset();
+  return fast_resolver->LoadModuleUsingMapBuffer(code_module,
+                                                 symbol_data_string);
+}
+
+char* ModuleSerializer::SerializeSymbolTextOnePass(const string &symbol_data,
+                                                   unsigned int *size) {
+  typedef StaticMapSectionBuilder<MemAddr> AddressSectionBuilder;
+
+  // Tokenizing mutates the text, so work on a copy, as
+  // BasicSourceLineResolver::Module::LoadMapFromMemory does.
+  scoped_array<char> buffer(new char[symbol_data.size() + 1]);
+  strcpy(buffer.get(), symbol_data.c_str());
+  size_t buffer_length = strlen(buffer.get());
+  if (buffer_length && buffer.get()[buffer_length - 1] == '\n')
+    buffer.get()[buffer_length - 1] = '\0';
+
+  StaticMapSectionBuilder<int> files(
+      StaticMapSectionBuilder<int>::DUPLICATES_KEEP_FIRST, false);
+  AddressSectionBuilder functions(
+      AddressSectionBuilder::DUPLICATES_REJECT, true);
+  AddressSectionBuilder publics(
+      AddressSectionBuilder::DUPLICATES_REJECT, false);
+  // STACK WIN ranges genuinely nest, so they go through a real
+  // ContainedRangeMap and the regular serializer below; their counts
+  // are dwarfed by line records.
+  ContainedRangeMap<MemAddr, linked_ptr<WindowsFrameInfo> >
+      windows_frame_info[WindowsFrameInfo::STACK_INFO_LAST];
+  AddressSectionBuilder cfi_initial_rules(
+      AddressSectionBuilder::DUPLICATES_REJECT, true);
+  AddressSectionBuilder cfi_delta_rules(
+      AddressSectionBuilder::DUPLICATES_KEEP_LAST, false);
+
+  // The FUNC record whose lines are being accumulated.  in_function
+  // distinguishes "no FUNC yet" (a line record is then an error) from a
+  // FUNC whose invalid range was dropped - its lines still parse but
+  // are discarded, mirroring the tree path's unchecked StoreRange.
+  bool in_function = false;
+  bool keep_function = false;
+  string function_name;
+  MemAddr function_address = 0;
+  MemAddr function_size = 0;
+  int32_t function_parameter_size = 0;
+  scoped_ptr<AddressSectionBuilder> lines;
+  string submap_scratch;
+
+  char *save_ptr;
+  char *record = strtok_r(buffer.get(), "\r\n", &save_ptr);
+  while (record != NULL) {
+    if (strncmp(record, "FILE ", 5) == 0) {
+      char *tokens[2];
+      if (!TokenizeInPlace(record + 5, 2, tokens))
+        return NULL;
+      int index = atoi(tokens[0]);
+      if (index < 0)
+        return NULL;
+      files.StartNode(index);
+      files.AppendString(tokens[1]);
+    } else if (strncmp(record, "STACK ", 6) == 0) {
+      char *stack_info_line = record + 6;
+      while (*stack_info_line == ' ')
+        stack_info_line++;
+      const char *platform = stack_info_line;
+      while (!strchr(" \r\n", *stack_info_line))
+        stack_info_line++;
+      *stack_info_line++ = '\0';
+      if (strcmp(platform, "WIN") == 0) {
+        int type = 0;
+        uint64_t rva, code_size;
+        linked_ptr<WindowsFrameInfo> frame_info(
+            WindowsFrameInfo::ParseFromString(stack_info_line, type, rva,
+                                              code_size));
+        if (frame_info == NULL)
+          return NULL;
+        // Store failures are ignored, as in Module::ParseStackInfo.
+        windows_frame_info[type].StoreRange(rva, code_size, frame_info);
+      } else if (strcmp(platform, "CFI") == 0) {
+        char *cursor;
+        char *init_or_address = strtok_r(stack_info_line, " \r\n", &cursor);
+        if (!init_or_address)
+          return NULL;
+        if (strcmp(init_or_address, "INIT") == 0) {
+          char *address_field = strtok_r(NULL, " \r\n", &cursor);
+          if (!address_field) return NULL;
+          char *size_field = strtok_r(NULL, " \r\n", &cursor);
+          if (!size_field) return NULL;
+          char *initial_rules = strtok_r(NULL, "\r\n", &cursor);
+          if (!initial_rules) return NULL;
+          MemAddr address = strtoul(address_field, NULL, 16);
+          MemAddr cfi_size = strtoul(size_field, NULL, 16);
+          // Degenerate ranges are silently dropped, as StoreRange does.
+          if (cfi_size > 0 && address + cfi_size - 1 >= address) {
+            cfi_initial_rules.StartNode(address + cfi_size - 1);
+            cfi_initial_rules.AppendScalar(address);  // the range's base
+            cfi_initial_rules.AppendString(initial_rules);
+          }
+        } else {
+          char *delta_rules = strtok_r(NULL, "\r\n", &cursor);
+          if (!delta_rules) return NULL;
+          MemAddr address = strtoul(init_or_address, NULL, 16);
+          cfi_delta_rules.StartNode(address);
+          cfi_delta_rules.AppendString(delta_rules);
+        }
+      } else {
+        return NULL;
+      }
+    } else if (strncmp(record, "FUNC ", 5) == 0) {
+      if (in_function && keep_function &&
+          !AppendFunctionNode(function_name, function_address, function_size,
+                              function_parameter_size, lines.get(),
+                              &functions, &submap_scratch))
+        return NULL;
+      char *tokens[4];
+      if (!TokenizeInPlace(record + 5, 4, tokens))
+        return NULL;
+      function_address = strtoull(tokens[0], NULL, 16);
+      function_size = strtoull(tokens[1], NULL, 16);
+      function_parameter_size = strtoull(tokens[2], NULL, 16);
+      function_name = tokens[3];
+      in_function = true;
+      keep_function =
+          function_size > 0 &&
+          function_address + function_size - 1 >= function_address;
+      lines.reset(new AddressSectionBuilder(
+          AddressSectionBuilder::DUPLICATES_REJECT, true));
+    } else if (strncmp(record, "PUBLIC ", 7) == 0) {
+      if (in_function && keep_function &&
+          !AppendFunctionNode(function_name, function_address, function_size,
+                              function_parameter_size, lines.get(),
+                              &functions, &submap_scratch))
+        return NULL;
+      // Public symbols don't carry line records.
+      in_function = false;
+      char *tokens[3];
+      if (!TokenizeInPlace(record + 7, 3, tokens))
+        return NULL;
+      MemAddr address = strtoull(tokens[0], NULL, 16);
+      int32_t parameter_size = strtoull(tokens[1], NULL, 16);
+      // Accept but drop address-zero symbols, as
+      // Module::ParsePublicSymbolRecord does.
+      if (address != 0) {
+        publics.StartNode(address);
+        publics.AppendString(tokens[2]);
+        publics.AppendScalar(address);
+        publics.AppendScalar(parameter_size);
+      }
+    } else if (strncmp(record, "MODULE ", 7) == 0) {
+      // Ignored, as in the tree path.
+    } else if (strncmp(record, "INFO ", 5) == 0) {
+      // Ignored as well.
+    } else {
+      // A source line record.
+      if (!in_function)
+        return NULL;
+      char *tokens[4];
+      if (!TokenizeInPlace(record, 4, tokens))
+        return NULL;
+      MemAddr address = strtoull(tokens[0], NULL, 16);
+      MemAddr line_size = strtoull(tokens[1], NULL, 16);
+      int32_t line_number = atoi(tokens[2]);
+      int32_t source_file = atoi(tokens[3]);
+      if (line_number <= 0)
+        return NULL;
+      if (keep_function && line_size > 0 &&
+          address + line_size - 1 >= address) {
+        lines->StartNode(address + line_size - 1);
+        lines->AppendScalar(address);  // the range's base
+        lines->AppendScalar(address);
+        lines->AppendScalar(line_size);
+        lines->AppendScalar(source_file);
+        lines->AppendScalar(line_number);
+      }
+    }
+    record = strtok_r(NULL, "\r\n", &save_ptr);
+  }
+  if (in_function && keep_function &&
+      !AppendFunctionNode(function_name, function_address, function_size,
+                          function_parameter_size, lines.get(),
+                          &functions, &submap_scratch))
+    return NULL;
+  buffer.reset(NULL);
+
+  if (!files.Finish() || !functions.Finish() || !publics.Finish() ||
+      !cfi_initial_rules.Finish() || !cfi_delta_rules.Finish())
+    return NULL;
+
+  // Assemble the buffer Serialize produces: the section-size table,
+  // the sections in order, and a null terminator.
+  int map_index = 0;
+  map_sizes_[map_index++] = static_cast<uint32_t>(files.SectionSize());
+  map_sizes_[map_index++] = static_cast<uint32_t>(functions.SectionSize());
+  map_sizes_[map_index++] = static_cast<uint32_t>(publics.SectionSize());
+  for (int i = 0; i < WindowsFrameInfo::STACK_INFO_LAST; ++i)
+    map_sizes_[map_index++] =
+        static_cast<uint32_t>(wfi_serializer_.SizeOf(&windows_frame_info[i]));
+  map_sizes_[map_index++] =
+      static_cast<uint32_t>(cfi_initial_rules.SectionSize());
+  map_sizes_[map_index++] =
+      static_cast<uint32_t>(cfi_delta_rules.SectionSize());
+
+  size_t table_size = kNumberMaps_ * sizeof(uint32_t);
+  unsigned int size_to_alloc = static_cast<unsigned int>(table_size) + 1;
+  for (int i = 0; i < kNumberMaps_; ++i)
+    size_to_alloc += map_sizes_[i];
+
+  char *serialized_data = new char[size_to_alloc];
+  memcpy(serialized_data, map_sizes_, table_size);
+  char *dest = serialized_data + table_size;
+  dest = files.WriteSection(dest);
+  dest = functions.WriteSection(dest);
+  dest = publics.WriteSection(dest);
+  for (int i = 0; i < WindowsFrameInfo::STACK_INFO_LAST; ++i)
+    dest = wfi_serializer_.Write(&windows_frame_info[i], dest);
+  dest = cfi_initial_rules.WriteSection(dest);
+  dest = cfi_delta_rules.WriteSection(dest);
+  *dest = 0;
+
+  if (size)
+    *size = size_to_alloc;
+  return serialized_data;
+}
+
 char* ModuleSerializer::SerializeSymbolFileData(
     const string &symbol_data, unsigned int *size) {
+  // One streaming pass converts well-formed symbol text without ever
+  // building the resolver's lookup trees; input it cannot reproduce
+  // faithfully falls through to the parse-then-serialize path below,
+  // which handles anything LoadMapFromMemory does.
+  char *serialized_data = SerializeSymbolTextOnePass(symbol_data, size);
+  if (serialized_data)
+    return serialized_data;
+  BPLOG(INFO) << "One-pass symbol conversion not applicable, "
+              << "falling back to parse and serialize";
+
   scoped_ptr<BasicSourceLineResolver::Module> module(
       new BasicSourceLineResolver::Module("no name"));
   scoped_array<char> buffer(new char[symbol_data.size() + 1]);
@@ -197,4 +877,16 @@ char* ModuleSerializer::SerializeSymbolFileData(
   return Serialize(*(module.get()), size);
 }
 
+char* ModuleSerializer::SerializeSymbolFileDataToContainer(
+    const string &symbol_data, unsigned int *size) {
+  unsigned int payload_size = 0;
+  scoped_array<char> payload(SerializeSymbolFileData(symbol_data,
+                                                     &payload_size));
+  if (!payload.get()) {
+    if (size) *size = 0;
+    return NULL;
+  }
+  return WrapPayloadInContainer(payload.get(), payload_size, size);
+}
+
 }  // namespace google_breakpad
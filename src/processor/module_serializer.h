@@ -51,6 +51,8 @@
 
 namespace google_breakpad {
 
+class ModuleBlobStore;
+
 // ModuleSerializer serializes a loaded BasicSourceLineResolver::Module into a
 // chunk of memory data. ModuleSerializer also provides interface to compute
 // memory size of the serialized data, write serialized data directly into
@@ -59,6 +61,19 @@ namespace google_breakpad {
 // FastSourceLineResolver::Module.
 class ModuleSerializer {
  public:
+  ModuleSerializer() : max_worker_threads_(1) {}
+
+  // Sets the maximum number of worker threads Serialize may use to
+  // serialize the module's independent map sections (files, functions,
+  // publics, Windows frame info, CFI) concurrently.  The sections touch
+  // disjoint data, so for Chrome-scale modules this cuts serialization
+  // wall time to roughly the largest single section's.  The default of
+  // 1 keeps everything on the calling thread.  No effect on Windows,
+  // where the worker implementation is not available.
+  void set_max_worker_threads(unsigned int max_worker_threads) {
+    max_worker_threads_ = max_worker_threads;
+  }
+
   // Compute the size of memory required to serialize a module.  Return the
   // total size needed for serialization.
   size_t SizeOf(const BasicSourceLineResolver::Module &module);
@@ -75,12 +90,30 @@ class ModuleSerializer {
   char* Serialize(const BasicSourceLineResolver::Module &module,
                   unsigned int *size = NULL);
 
+  // Serializes a module into the self-describing container format
+  // declared in processor/serialized_module_format.h: a checksummed
+  // header and per-section offset table followed by the serialized
+  // payload.  If size != NULL, *size is set to the container size.
+  // Caller takes ownership of the returned memory (allocated on heap),
+  // and owner should call delete [] to free the memory after use.
+  char* SerializeToContainer(const BasicSourceLineResolver::Module &module,
+                             unsigned int *size = NULL);
+
   // Given the string format symbol_data, produces a chunk of serialized data.
   // Caller takes ownership of the serialized data (on heap), and owner should
   // call delete [] to free the memory after use.
   char* SerializeSymbolFileData(const string &symbol_data,
                                 unsigned int *size = NULL);
 
+  // Like SerializeSymbolFileData, but wraps the serialized data in the
+  // self-describing container format, as SerializeToContainer does.
+  // This is how dump_syms emits native symbol files that
+  // FastSourceLineResolver::LoadModuleFromContainer loads without
+  // parsing.  Caller takes ownership of the returned memory (allocated
+  // on heap), and owner should call delete [] to free it after use.
+  char* SerializeSymbolFileDataToContainer(const string &symbol_data,
+                                           unsigned int *size = NULL);
+
   // Serializes one loaded module with given moduleid in the basic source line
   // resolver, and loads the serialized data into the fast source line resolver.
   // Return false if the basic source line doesn't have a module with the given
@@ -94,6 +127,19 @@ class ModuleSerializer {
   void ConvertAllModules(const BasicSourceLineResolver *basic_resolver,
                          FastSourceLineResolver *fast_resolver);
 
+  // Like ConvertOneModule, but consults store first: a stored blob for
+  // code_module is mapped into fast_resolver with no serialization or
+  // parsing at all.  On a store miss, the module is looked up in
+  // basic_resolver by code_module->code_file(), serialized, stored in
+  // store under its debug file and identifier, and loaded into
+  // fast_resolver.  store may be any ModuleBlobStore backing
+  // (SerializedModuleCache on disk, SharedModuleStore in shared memory)
+  // or NULL, in which case this behaves like ConvertOneModule.
+  bool ConvertOneModuleCached(const CodeModule *code_module,
+                              const BasicSourceLineResolver *basic_resolver,
+                              FastSourceLineResolver *fast_resolver,
+                              ModuleBlobStore *store);
+
  private:
   // Convenient type names.
   typedef BasicSourceLineResolver::Line Line;
@@ -105,6 +151,39 @@ class ModuleSerializer {
       const BasicSourceLineResolver::ModuleMap::const_iterator &iter,
       FastSourceLineResolver *fast_resolver);
 
+  // Serializes the single map section map_index of module into its own
+  // buffer, sizing and writing that one map back to back, and returns
+  // the buffer with *size set to its length.  Returns NULL on failure.
+  // Caller owns the returned memory (allocated as "new char[]").  Used
+  // by Serialize, directly and from its worker threads.
+  char* SerializeSection(const BasicSourceLineResolver::Module &module,
+                         int map_index,
+                         unsigned int *size);
+
+  // Entry point for Serialize's section worker threads; arg is the
+  // SectionWorkPool the workers share.
+  static void* SerializeSectionWorker(void* arg);
+
+  // Parses symbol text straight into the serialized flat layout,
+  // without ever building the resolver's RangeMap/AddressMap trees.
+  // Symbol files arrive with their records mostly in address order, so
+  // each map section can be emitted in one streaming pass; the peak
+  // memory held is the serialized output itself plus the section key
+  // tables.  Returns NULL - leaving the caller to fall back to the
+  // parse-then-serialize path - for input the streaming pass cannot
+  // reproduce faithfully: malformed records, or overlapping ranges,
+  // whose drop-the-later-arrival semantics need the trees.  Sets
+  // map_sizes_ as Serialize does.  Caller owns the returned memory.
+  char* SerializeSymbolTextOnePass(const string &symbol_data,
+                                   unsigned int *size);
+
+  // Wraps an already-serialized payload in the self-describing
+  // container format of SerializeToContainer.  map_sizes_ must still
+  // describe the payload's sections.  Caller owns the returned memory.
+  char* WrapPayloadInContainer(const char *payload,
+                               unsigned int payload_size,
+                               unsigned int *size);
+
   // Number of Maps that Module class contains.
   static const int32_t kNumberMaps_ =
       FastSourceLineResolver::Module::kNumberMaps_;
@@ -112,10 +191,14 @@ class ModuleSerializer {
   // Memory sizes required to serialize map components in Module.
   uint32_t map_sizes_[kNumberMaps_];
 
+  // Upper bound on the worker threads Serialize fans sections out to.
+  // See set_max_worker_threads.
+  unsigned int max_worker_threads_;
+
   // Serializers for each individual map component in Module class.
   StdMapSerializer<int, string> files_serializer_;
-  RangeMapSerializer<MemAddr, linked_ptr<Function> > functions_serializer_;
-  AddressMapSerializer<MemAddr, linked_ptr<PublicSymbol> > pubsym_serializer_;
+  RangeMapSerializer<MemAddr, Function*> functions_serializer_;
+  AddressMapSerializer<MemAddr, PublicSymbol*> pubsym_serializer_;
   ContainedRangeMapSerializer<MemAddr,
                               linked_ptr<WindowsFrameInfo> > wfi_serializer_;
   RangeMapSerializer<MemAddr, string> cfi_init_rules_serializer_;
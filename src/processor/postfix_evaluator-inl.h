@@ -47,6 +47,7 @@
 
 #include "google_breakpad/processor/memory_region.h"
 #include "processor/logging.h"
+#include "processor/postfix_program.h"
 
 namespace google_breakpad {
 
@@ -66,8 +67,8 @@ class AutoStackClearer {
 };
 
 
-template<typename ValueType>
-bool PostfixEvaluator<ValueType>::EvaluateToken(
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::EvaluateToken(
     const string &token,
     const string &expression,
     DictionaryValidityType *assigned) {
@@ -201,8 +202,8 @@ bool PostfixEvaluator<ValueType>::EvaluateToken(
   return true;
 }
 
-template<typename ValueType>
-bool PostfixEvaluator<ValueType>::EvaluateInternal(
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::EvaluateInternal(
     const string &expression,
     DictionaryValidityType *assigned) {
   // Tokenize, splitting on whitespace.
@@ -230,8 +231,8 @@ bool PostfixEvaluator<ValueType>::EvaluateInternal(
   return true;
 }
 
-template<typename ValueType>
-bool PostfixEvaluator<ValueType>::Evaluate(const string &expression,
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::Evaluate(const string &expression,
                                            DictionaryValidityType *assigned) {
   // Ensure that the stack is cleared before returning.
   AutoStackClearer clearer(&stack_);
@@ -249,8 +250,8 @@ bool PostfixEvaluator<ValueType>::Evaluate(const string &expression,
   return false;
 }
 
-template<typename ValueType>
-bool PostfixEvaluator<ValueType>::EvaluateForValue(const string &expression,
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::EvaluateForValue(const string &expression,
                                                    ValueType *result) {
   // Ensure that the stack is cleared before returning.
   AutoStackClearer clearer(&stack_);
@@ -268,9 +269,207 @@ bool PostfixEvaluator<ValueType>::EvaluateForValue(const string &expression,
   return PopValue(result);
 }
 
-template<typename ValueType>
-typename PostfixEvaluator<ValueType>::PopResult
-PostfixEvaluator<ValueType>::PopValueOrIdentifier(
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::EvaluateProgramInternal(
+    const PostfixProgram &program,
+    DictionaryValidityType *assigned,
+    vector<ProgramStackEntry> *entry_stack) {
+  const std::vector<PostfixProgram::Instruction> &instructions =
+      program.instructions();
+
+  for (size_t program_counter = 0;
+       program_counter < instructions.size();
+       ++program_counter) {
+    const PostfixProgram::Instruction &instruction =
+        instructions[program_counter];
+    ProgramStackEntry entry;
+    entry.value = ValueType();
+    entry.identifier_index = -1;
+
+    switch (instruction.opcode) {
+      case PostfixProgram::OP_PUSH_LITERAL:
+        entry.value = static_cast<ValueType>(instruction.literal);
+        entry_stack->push_back(entry);
+        break;
+
+      case PostfixProgram::OP_PUSH_IDENTIFIER:
+        entry.identifier_index = instruction.identifier_index;
+        entry_stack->push_back(entry);
+        break;
+
+      case PostfixProgram::OP_DEREFERENCE: {
+        // ^ for unary dereference.  Can't dereference without memory.
+        if (!memory_) {
+          BPLOG(ERROR) << "Attempt to dereference without memory";
+          return false;
+        }
+
+        ValueType address;
+        if (!PopProgramValue(program, entry_stack, &address)) {
+          BPLOG(ERROR) << "Could not pop value to dereference";
+          return false;
+        }
+
+        ValueType value;
+        if (!memory_->GetMemoryAtAddress(address, &value)) {
+          BPLOG(ERROR) << "Could not dereference memory at address " <<
+                          HexString(address);
+          return false;
+        }
+
+        entry.value = value;
+        entry_stack->push_back(entry);
+        break;
+      }
+
+      case PostfixProgram::OP_ASSIGN: {
+        ValueType value;
+        if (!PopProgramValue(program, entry_stack, &value)) {
+          BPLOG(INFO) << "Could not pop value to assign";
+          return false;
+        }
+
+        // Assignment is only meaningful when assigning into an
+        // identifier.  The identifier must name a variable, not a
+        // constant.  Variables begin with '$'.
+        if (entry_stack->empty() ||
+            entry_stack->back().identifier_index < 0) {
+          BPLOG(ERROR) << "An identifier is needed to assign " <<
+                          HexString(value);
+          return false;
+        }
+        const string &identifier =
+            program.identifier(entry_stack->back().identifier_index);
+        entry_stack->pop_back();
+        if (identifier.empty() || identifier[0] != '$') {
+          BPLOG(ERROR) << "Can't assign " << HexString(value) << " to " <<
+                          identifier;
+          return false;
+        }
+
+        (*dictionary_)[identifier] = value;
+        if (assigned)
+          (*assigned)[identifier] = true;
+        break;
+      }
+
+      default: {
+        // A binary operation.
+        ValueType operand1 = ValueType();
+        ValueType operand2 = ValueType();
+        if (!PopProgramValue(program, entry_stack, &operand2) ||
+            !PopProgramValue(program, entry_stack, &operand1)) {
+          BPLOG(ERROR) << "Could not pop two values for binary operation";
+          return false;
+        }
+
+        ValueType result;
+        switch (instruction.opcode) {
+          case PostfixProgram::OP_ADD:
+            result = operand1 + operand2;
+            break;
+          case PostfixProgram::OP_SUBTRACT:
+            result = operand1 - operand2;
+            break;
+          case PostfixProgram::OP_MULTIPLY:
+            result = operand1 * operand2;
+            break;
+          case PostfixProgram::OP_QUOTIENT:
+            result = operand1 / operand2;
+            break;
+          case PostfixProgram::OP_MODULUS:
+            result = operand1 % operand2;
+            break;
+          case PostfixProgram::OP_ALIGN:
+            result =
+                operand1 & (static_cast<ValueType>(-1) ^ (operand2 - 1));
+            break;
+          default:
+            // This will not happen: every other opcode is handled by an
+            // explicit case above.
+            BPLOG(ERROR) << "Not reached!";
+            return false;
+        }
+
+        entry.value = result;
+        entry_stack->push_back(entry);
+        break;
+      }
+    }
+  }
+
+  return true;
+}
+
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::PopProgramValue(
+    const PostfixProgram &program,
+    vector<ProgramStackEntry> *entry_stack,
+    ValueType *value) {
+  if (entry_stack->empty())
+    return false;
+
+  ProgramStackEntry entry = entry_stack->back();
+  entry_stack->pop_back();
+
+  if (entry.identifier_index < 0) {
+    *value = entry.value;
+    return true;
+  }
+
+  // An identifier: resolve it through the dictionary, as PopValue does.
+  const string &identifier = program.identifier(entry.identifier_index);
+  typename DictionaryType::const_iterator iterator =
+      dictionary_->find(identifier);
+  if (iterator == dictionary_->end()) {
+    // The identifier wasn't found in the dictionary.  Don't imply any
+    // default value, just fail.
+    BPLOG(INFO) << "Identifier " << identifier << " not in dictionary";
+    return false;
+  }
+
+  *value = iterator->second;
+  return true;
+}
+
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::EvaluateProgram(
+    const PostfixProgram &program,
+    DictionaryValidityType *assigned) {
+  vector<ProgramStackEntry> entry_stack;
+  if (!EvaluateProgramInternal(program, assigned, &entry_stack))
+    return false;
+
+  // If there's anything left on the stack, it indicates incomplete
+  // execution.  This is a failure case.  If the stack is empty,
+  // evaluation was complete and successful.
+  if (entry_stack.empty())
+    return true;
+
+  BPLOG(ERROR) << "Incomplete execution of compiled program";
+  return false;
+}
+
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::EvaluateProgramForValue(
+    const PostfixProgram &program,
+    ValueType *result) {
+  vector<ProgramStackEntry> entry_stack;
+  if (!EvaluateProgramInternal(program, NULL, &entry_stack))
+    return false;
+
+  // A successful execution should leave exactly one value on the stack.
+  if (entry_stack.size() != 1) {
+    BPLOG(ERROR) << "Compiled program yielded bad number of results";
+    return false;
+  }
+
+  return PopProgramValue(program, &entry_stack, result);
+}
+
+template<typename ValueType, typename Dictionary, typename Validity>
+typename PostfixEvaluator<ValueType, Dictionary, Validity>::PopResult
+PostfixEvaluator<ValueType, Dictionary, Validity>::PopValueOrIdentifier(
     ValueType *value, string *identifier) {
   // There needs to be at least one element on the stack to pop.
   if (!stack_.size())
@@ -313,8 +512,8 @@ PostfixEvaluator<ValueType>::PopValueOrIdentifier(
 }
 
 
-template<typename ValueType>
-bool PostfixEvaluator<ValueType>::PopValue(ValueType *value) {
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::PopValue(ValueType *value) {
   ValueType literal = ValueType();
   string token;
   PopResult result;
@@ -342,15 +541,15 @@ bool PostfixEvaluator<ValueType>::PopValue(ValueType *value) {
 }
 
 
-template<typename ValueType>
-bool PostfixEvaluator<ValueType>::PopValues(ValueType *value1,
+template<typename ValueType, typename Dictionary, typename Validity>
+bool PostfixEvaluator<ValueType, Dictionary, Validity>::PopValues(ValueType *value1,
                                             ValueType *value2) {
   return PopValue(value2) && PopValue(value1);
 }
 
 
-template<typename ValueType>
-void PostfixEvaluator<ValueType>::PushValue(const ValueType &value) {
+template<typename ValueType, typename Dictionary, typename Validity>
+void PostfixEvaluator<ValueType, Dictionary, Validity>::PushValue(const ValueType &value) {
   ostringstream token_stream;
   token_stream << value;
   stack_.push_back(token_stream.str());
@@ -51,7 +51,9 @@
 // allow any operand to be either a literal value, constant, or variable.
 // Assignment (=) of any type of operand into a variable is also supported.
 //
-// The dictionary is provided as a map with string keys.  Keys beginning
+// The dictionary type is a template parameter defaulting to a map with
+// string keys; RegisterDictionary (register_dictionary.h) is a drop-in
+// replacement that avoids heap allocation.  Keys beginning
 // with the '$' character are treated as variables.  All other keys are
 // treated as constants.  Any results must be assigned into variables in the
 // dictionary.  These variables do not need to exist prior to calling
@@ -75,6 +77,7 @@
 #include <vector>
 
 #include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
 
 namespace google_breakpad {
 
@@ -82,12 +85,15 @@ using std::map;
 using std::vector;
 
 class MemoryRegion;
+class PostfixProgram;
 
-template<typename ValueType>
+template<typename ValueType,
+         typename Dictionary = map<string, ValueType>,
+         typename Validity = map<string, bool> >
 class PostfixEvaluator {
  public:
-  typedef map<string, ValueType> DictionaryType;
-  typedef map<string, bool> DictionaryValidityType;
+  typedef Dictionary DictionaryType;
+  typedef Validity DictionaryValidityType;
 
   // Create a PostfixEvaluator object that may be used (with Evaluate) on
   // one or more expressions.  PostfixEvaluator does not take ownership of
@@ -113,6 +119,15 @@ class PostfixEvaluator {
   // Otherwise, return false.
   bool EvaluateForValue(const string &expression, ValueType *result);
 
+  // Like Evaluate and EvaluateForValue, but executing a compiled
+  // PostfixProgram instead of parsing an expression string.  A program
+  // compiled once (see PostfixProgram::Compile) can be executed per
+  // frame with no string parsing at all.
+  bool EvaluateProgram(const PostfixProgram &program,
+                       DictionaryValidityType *assigned);
+  bool EvaluateProgramForValue(const PostfixProgram &program,
+                               ValueType *result);
+
   DictionaryType* dictionary() const { return dictionary_; }
 
   // Reset the dictionary.  PostfixEvaluator does not take ownership.
@@ -158,6 +173,29 @@ class PostfixEvaluator {
                      const string &expression,
                      DictionaryValidityType *assigned);
 
+  // One entry on the typed stack used when executing a compiled
+  // program.  identifier_index is -1 for a plain value, or the index of
+  // an identifier in the program being executed, resolved against the
+  // dictionary when popped.
+  struct ProgramStackEntry {
+    ValueType value;
+    int32_t identifier_index;
+  };
+
+  // Executes program against entry_stack, updating *assigned if it is
+  // non-zero.  Returns true if every instruction executes successfully;
+  // does not require the stack to end up empty.
+  bool EvaluateProgramInternal(const PostfixProgram &program,
+                               DictionaryValidityType *assigned,
+                               vector<ProgramStackEntry> *entry_stack);
+
+  // Pops the top entry of entry_stack, resolving an identifier entry
+  // through the dictionary.  Returns false if the stack is empty or the
+  // identifier is not in the dictionary.
+  bool PopProgramValue(const PostfixProgram &program,
+                       vector<ProgramStackEntry> *entry_stack,
+                       ValueType *value);
+
   // The dictionary mapping constant and variable identifiers (strings) to
   // values.  Keys beginning with '$' are treated as variable names, and
   // PostfixEvaluator is free to create and modify these keys.  Weak pointer.
@@ -0,0 +1,222 @@
+// -*- mode: C++ -*-
+
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// postfix_program.h: The compiled form of a postfix "program string".
+//
+// PostfixEvaluator interprets program strings such as those found in
+// STACK WIN records.  Compiling a string once into a PostfixProgram - a
+// flat array of opcodes with literals already converted and identifiers
+// interned - lets the evaluator execute it for every frame without any
+// string tokenizing or stream parsing.  See PostfixEvaluator's
+// EvaluateProgram.
+//
+// Tokens are classified exactly as the string evaluator classifies them:
+// single-character operators, decimal literals (with optional leading
+// '-'), and everything else as identifiers.  An assignment operator
+// smashed against its following token ("=$ebp") compiles to an
+// assignment followed by that token, matching the string evaluator's
+// handling of MSVS 2010 LTO output.
+
+#ifndef PROCESSOR_POSTFIX_PROGRAM_H__
+#define PROCESSOR_POSTFIX_PROGRAM_H__
+
+#include <ctype.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+#ifdef _WIN32
+#define strtoull _strtoui64
+#endif
+
+class PostfixProgram {
+ public:
+  enum Opcode {
+    OP_PUSH_LITERAL = 0,  // push Instruction::literal
+    OP_PUSH_IDENTIFIER,   // push the identifier at identifier_index
+    OP_ADD,
+    OP_SUBTRACT,
+    OP_MULTIPLY,
+    OP_QUOTIENT,
+    OP_MODULUS,
+    OP_ALIGN,
+    OP_DEREFERENCE,
+    OP_ASSIGN
+  };
+
+  struct Instruction {
+    Opcode opcode;
+    uint64_t literal;          // only for OP_PUSH_LITERAL
+    int32_t identifier_index;  // only for OP_PUSH_IDENTIFIER
+  };
+
+  // Compiles expression, a whitespace-delimited postfix program string.
+  // Compilation cannot fail: any token that is not an operator or a
+  // literal is an identifier, resolved against the evaluator's
+  // dictionary at execution time.  The caller owns the result.
+  static PostfixProgram* Compile(const string &expression);
+
+  const std::vector<Instruction>& instructions() const {
+    return instructions_;
+  }
+
+  const string& identifier(int32_t index) const {
+    return identifiers_[index];
+  }
+
+ private:
+  // Appends the instruction for a single token.
+  void CompileToken(const string &token);
+
+  // Returns the index of token in identifiers_, adding it if needed.
+  // Program strings reference few distinct identifiers, so a linear
+  // scan is fine.
+  int32_t InternIdentifier(const string &token);
+
+  std::vector<Instruction> instructions_;
+  std::vector<string> identifiers_;
+};
+
+// A shared, lazily filled slot for the compiled form of one program
+// string.  WindowsFrameInfo entries hand out copies of themselves per
+// frame; copies share the original's cache through a linked_ptr, so a
+// program compiled for one frame is reused by every later frame that
+// hits the same record.
+struct PostfixProgramCache {
+  PostfixProgramCache() : program(NULL) {}
+  ~PostfixProgramCache() { delete program; }
+
+  // The compiled program, owned; NULL until first compiled.
+  PostfixProgram *program;
+
+ private:
+  // Disallow copy and assignment.
+  PostfixProgramCache(const PostfixProgramCache&);
+  void operator=(const PostfixProgramCache&);
+};
+
+inline int32_t PostfixProgram::InternIdentifier(const string &token) {
+  for (size_t index = 0; index < identifiers_.size(); ++index) {
+    if (identifiers_[index] == token) {
+      return static_cast<int32_t>(index);
+    }
+  }
+  identifiers_.push_back(token);
+  return static_cast<int32_t>(identifiers_.size() - 1);
+}
+
+inline void PostfixProgram::CompileToken(const string &token) {
+  Instruction instruction;
+  instruction.literal = 0;
+  instruction.identifier_index = -1;
+
+  if (token == "+") {
+    instruction.opcode = OP_ADD;
+  } else if (token == "-") {
+    instruction.opcode = OP_SUBTRACT;
+  } else if (token == "*") {
+    instruction.opcode = OP_MULTIPLY;
+  } else if (token == "/") {
+    instruction.opcode = OP_QUOTIENT;
+  } else if (token == "%") {
+    instruction.opcode = OP_MODULUS;
+  } else if (token == "@") {
+    instruction.opcode = OP_ALIGN;
+  } else if (token == "^") {
+    instruction.opcode = OP_DEREFERENCE;
+  } else if (token == "=") {
+    instruction.opcode = OP_ASSIGN;
+  } else {
+    // A literal is an optional '-' followed entirely by decimal digits,
+    // as the string evaluator's stream extraction would accept; anything
+    // else is an identifier.
+    const char *digits = token.c_str();
+    bool negative = false;
+    if (*digits == '-') {
+      negative = true;
+      ++digits;
+    }
+    char *end = NULL;
+    uint64_t value = strtoull(digits, &end, 10);
+    if (isdigit(static_cast<unsigned char>(*digits)) && end && *end == '\0') {
+      instruction.opcode = OP_PUSH_LITERAL;
+      instruction.literal = negative ? static_cast<uint64_t>(0) - value
+                                     : value;
+    } else {
+      instruction.opcode = OP_PUSH_IDENTIFIER;
+      instruction.identifier_index = InternIdentifier(token);
+    }
+  }
+
+  instructions_.push_back(instruction);
+}
+
+// static
+inline PostfixProgram* PostfixProgram::Compile(const string &expression) {
+  PostfixProgram *program = new PostfixProgram();
+
+  static const char kWhitespace[] = " \t\r\n";
+  size_t position = 0;
+  while (position < expression.size()) {
+    size_t token_start = expression.find_first_not_of(kWhitespace, position);
+    if (token_start == string::npos) {
+      break;
+    }
+    size_t token_end = expression.find_first_of(kWhitespace, token_start);
+    if (token_end == string::npos) {
+      token_end = expression.size();
+    }
+    string token = expression.substr(token_start, token_end - token_start);
+
+    // As in the string evaluator: an assignment operator smashed up
+    // against the next token is an assignment followed by that token.
+    if (token.size() > 1 && token[0] == '=') {
+      program->CompileToken("=");
+      program->CompileToken(token.substr(1));
+    } else {
+      program->CompileToken(token);
+    }
+
+    position = token_end;
+  }
+
+  return program;
+}
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_POSTFIX_PROGRAM_H__
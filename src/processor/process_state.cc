@@ -33,6 +33,8 @@
 //
 // Author: Mark Mentovai
 
+#include <algorithm>
+
 #include "google_breakpad/processor/process_state.h"
 #include "google_breakpad/processor/call_stack.h"
 #include "google_breakpad/processor/code_modules.h"
@@ -50,18 +52,52 @@ void ProcessState::Clear() {
   crash_address_ = 0;
   assertion_.clear();
   requesting_thread_ = -1;
-  for (vector<CallStack *>::const_iterator iterator = threads_.begin();
-       iterator != threads_.end();
-       ++iterator) {
-    delete *iterator;
+  // Threads with identical stacks may share one CallStack (see
+  // MinidumpProcessor::Process), so delete each distinct stack once.
+  for (size_t thread_index = 0;
+       thread_index < threads_.size();
+       ++thread_index) {
+    bool shared = false;
+    for (size_t earlier_index = 0; earlier_index < thread_index;
+         ++earlier_index) {
+      if (threads_[earlier_index] == threads_[thread_index]) {
+        shared = true;
+        break;
+      }
+    }
+    if (!shared)
+      delete threads_[thread_index];
   }
   threads_.clear();
   system_info_.Clear();
+  intern_pool_.Clear();
   // modules_without_symbols_ DOES NOT owns the underlying CodeModule pointers.
   // Just clear the vector.
   modules_without_symbols_.clear();
+  truncated_threads_.clear();
+  processing_stats_.Clear();
   delete modules_;
   modules_ = NULL;
 }
 
+void ProcessState::Swap(ProcessState* other) {
+  std::swap(time_date_stamp_, other->time_date_stamp_);
+  std::swap(crashed_, other->crashed_);
+  crash_reason_.swap(other->crash_reason_);
+  std::swap(crash_address_, other->crash_address_);
+  assertion_.swap(other->assertion_);
+  std::swap(requesting_thread_, other->requesting_thread_);
+  threads_.swap(other->threads_);
+  thread_memory_regions_.swap(other->thread_memory_regions_);
+  system_info_.Swap(&other->system_info_);
+  // The frames in threads_ point at strings owned by the pool, so the
+  // pool must travel with the stacks.
+  intern_pool_.Swap(&other->intern_pool_);
+  std::swap(modules_, other->modules_);
+  modules_without_symbols_.swap(other->modules_without_symbols_);
+  truncated_threads_.swap(other->truncated_threads_);
+  std::swap(exploitability_, other->exploitability_);
+  std::swap(processing_stats_, other->processing_stats_);
+}
+
 }  // namespace google_breakpad
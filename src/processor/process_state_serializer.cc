@@ -0,0 +1,402 @@
+// Copyright (c) 2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// process_state_serializer.cc: Binary serialization of ProcessState.
+//
+// See process_state_serializer.h for documentation.
+
+#include "processor/process_state_serializer.h"
+
+#include <assert.h>
+
+#include <vector>
+
+#include "google_breakpad/processor/call_stack.h"
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/code_modules.h"
+#include "google_breakpad/processor/process_state.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "processor/basic_code_module.h"
+#include "processor/basic_code_modules.h"
+#include "processor/binarystream.h"
+#include "processor/logging.h"
+#include "processor/stack_frame_arena.h"
+
+namespace google_breakpad {
+
+using std::vector;
+
+// Serialized blobs open with this magic number and a format version.
+// The version is bumped whenever the layout changes; readers reject
+// versions they do not understand rather than guessing.
+static const uint32_t kProcessStateMagic = 0x42505053;  // 'BPPS'
+static const uint8_t kProcessStateVersion = 1;
+
+// Written in place of a module index when a frame or list entry does not
+// reference any module.
+static const uint32_t kNoModuleIndex = 0xffffffff;
+
+namespace {
+
+// A CodeModules view over module records decoded from a blob, ordered as
+// they were written.  It exists only long enough to build the
+// BasicCodeModules instance that the deserialized state will own, so
+// only the methods that BasicCodeModules' constructor uses are
+// meaningful.
+class DecodedCodeModules : public CodeModules {
+ public:
+  DecodedCodeModules(const vector<const CodeModule*> *modules,
+                     uint32_t main_module_index)
+      : modules_(modules), main_module_index_(main_module_index) {}
+
+  virtual unsigned int module_count() const { return modules_->size(); }
+
+  virtual const CodeModule* GetModuleForAddress(uint64_t address) const {
+    return NULL;
+  }
+
+  virtual const CodeModule* GetMainModule() const {
+    if (main_module_index_ >= modules_->size())
+      return NULL;
+    return (*modules_)[main_module_index_];
+  }
+
+  virtual const CodeModule* GetModuleAtSequence(unsigned int sequence) const {
+    return NULL;
+  }
+
+  virtual const CodeModule* GetModuleAtIndex(unsigned int index) const {
+    if (index >= modules_->size())
+      return NULL;
+    return (*modules_)[index];
+  }
+
+  virtual const CodeModules* Copy() const { return NULL; }
+
+ private:
+  const vector<const CodeModule*> *modules_;
+  uint32_t main_module_index_;
+};
+
+}  // namespace
+
+// Returns the position of module within modules' GetModuleAtIndex order,
+// or kNoModuleIndex if module is NULL or not present.
+static uint32_t ModuleIndex(const CodeModules *modules,
+                            const CodeModule *module) {
+  if (!modules || !module)
+    return kNoModuleIndex;
+  unsigned int count = modules->module_count();
+  for (unsigned int index = 0; index < count; ++index) {
+    if (modules->GetModuleAtIndex(index) == module)
+      return index;
+  }
+  return kNoModuleIndex;
+}
+
+// static
+bool ProcessStateSerializer::Serialize(const ProcessState &state,
+                                       string *data) {
+  assert(data);
+
+  binarystream stream;
+  stream << kProcessStateMagic << kProcessStateVersion;
+
+  stream << state.time_date_stamp();
+  stream << static_cast<uint8_t>(state.crashed() ? 1 : 0);
+  stream << state.crash_reason();
+  stream << state.crash_address();
+  stream << state.assertion();
+  stream << static_cast<uint32_t>(state.requesting_thread());
+
+  const SystemInfo *system_info = state.system_info();
+  stream << system_info->os << system_info->os_short
+         << system_info->os_version << system_info->cpu
+         << system_info->cpu_info
+         << static_cast<uint32_t>(system_info->cpu_count);
+
+  stream << static_cast<uint8_t>(state.exploitability());
+
+  // Module records, in GetModuleAtIndex order.  Frames and the
+  // modules-without-symbols list reference modules by position in this
+  // order.
+  const CodeModules *modules = state.modules();
+  uint32_t module_count = modules ? modules->module_count() : 0;
+  const CodeModule *main_module = modules ? modules->GetMainModule() : NULL;
+  uint32_t main_module_index = kNoModuleIndex;
+  stream << module_count;
+  for (uint32_t index = 0; index < module_count; ++index) {
+    const CodeModule *module = modules->GetModuleAtIndex(index);
+    if (module == main_module)
+      main_module_index = index;
+    stream << module->base_address() << module->size()
+           << module->code_file() << module->code_identifier()
+           << module->debug_file() << module->debug_identifier()
+           << module->version();
+  }
+  stream << main_module_index;
+
+  const vector<const CodeModule*> *modules_without_symbols =
+      state.modules_without_symbols();
+  vector<uint32_t> missing_indices;
+  for (vector<const CodeModule*>::const_iterator iterator =
+           modules_without_symbols->begin();
+       iterator != modules_without_symbols->end();
+       ++iterator) {
+    uint32_t index = ModuleIndex(modules, *iterator);
+    if (index != kNoModuleIndex)
+      missing_indices.push_back(index);
+  }
+  stream << static_cast<uint32_t>(missing_indices.size());
+  for (size_t entry = 0; entry < missing_indices.size(); ++entry)
+    stream << missing_indices[entry];
+
+  const vector<unsigned int> *truncated_threads = state.truncated_threads();
+  stream << static_cast<uint32_t>(truncated_threads->size());
+  for (size_t entry = 0; entry < truncated_threads->size(); ++entry)
+    stream << static_cast<uint32_t>((*truncated_threads)[entry]);
+
+  const vector<CallStack*> *threads = state.threads();
+  stream << static_cast<uint32_t>(threads->size());
+  for (size_t thread_index = 0;
+       thread_index < threads->size();
+       ++thread_index) {
+    const vector<StackFrame*> *frames = (*threads)[thread_index]->frames();
+    stream << static_cast<uint32_t>(frames->size());
+    for (size_t frame_index = 0;
+         frame_index < frames->size();
+         ++frame_index) {
+      const StackFrame *frame = (*frames)[frame_index];
+      stream << frame->instruction;
+      stream << ModuleIndex(modules, frame->module);
+      stream << static_cast<uint8_t>(frame->function_name ? 1 : 0);
+      if (frame->function_name)
+        stream << *frame->function_name;
+      stream << frame->function_base;
+      stream << static_cast<uint8_t>(frame->source_file_name ? 1 : 0);
+      if (frame->source_file_name)
+        stream << *frame->source_file_name;
+      stream << static_cast<uint32_t>(frame->source_line);
+      stream << frame->source_line_base;
+      stream << static_cast<uint8_t>(frame->trust);
+    }
+  }
+
+  *data = stream.str();
+  return true;
+}
+
+// static
+bool ProcessStateSerializer::Deserialize(const string &data,
+                                         ProcessState *state) {
+  assert(state);
+
+  state->Clear();
+
+  binarystream stream(data);
+
+  uint32_t magic = 0;
+  uint8_t version = 0;
+  stream >> magic >> version;
+  if (stream.eof() || magic != kProcessStateMagic) {
+    BPLOG(ERROR) << "ProcessState blob has bad magic number";
+    return false;
+  }
+  if (version != kProcessStateVersion) {
+    BPLOG(ERROR) << "ProcessState blob has unrecognized version " <<
+        static_cast<unsigned int>(version);
+    return false;
+  }
+
+  uint8_t crashed = 0;
+  uint32_t requesting_thread = kNoModuleIndex;
+  stream >> state->time_date_stamp_ >> crashed >> state->crash_reason_ >>
+      state->crash_address_ >> state->assertion_ >> requesting_thread;
+  state->crashed_ = crashed != 0;
+  state->requesting_thread_ = static_cast<int>(requesting_thread);
+
+  uint32_t cpu_count = 0;
+  stream >> state->system_info_.os >> state->system_info_.os_short >>
+      state->system_info_.os_version >> state->system_info_.cpu >>
+      state->system_info_.cpu_info >> cpu_count;
+  state->system_info_.cpu_count = static_cast<int>(cpu_count);
+
+  uint8_t exploitability = 0;
+  stream >> exploitability;
+  if (stream.eof() || exploitability > EXPLOITABILITY_ERR_PROCESSING) {
+    BPLOG(ERROR) << "ProcessState blob truncated in crash information";
+    state->Clear();
+    return false;
+  }
+  state->exploitability_ =
+      static_cast<ExploitabilityRating>(exploitability);
+
+  // Decode the module records and rebuild a BasicCodeModules from them.
+  // The decoded records' base addresses are kept so that module
+  // references read below can be resolved to the modules the state owns,
+  // whose GetModuleAtIndex order need not match the serialized order.
+  uint32_t module_count = 0;
+  stream >> module_count;
+  vector<const CodeModule*> decoded_modules;
+  vector<uint64_t> module_bases;
+  bool modules_valid = !stream.eof();
+  for (uint32_t index = 0; modules_valid && index < module_count; ++index) {
+    uint64_t base_address = 0;
+    uint64_t size = 0;
+    string code_file;
+    string code_identifier;
+    string debug_file;
+    string debug_identifier;
+    string module_version;
+    stream >> base_address >> size >> code_file >> code_identifier >>
+        debug_file >> debug_identifier >> module_version;
+    if (stream.eof()) {
+      modules_valid = false;
+      break;
+    }
+    decoded_modules.push_back(new BasicCodeModule(base_address, size,
+                                                  code_file, code_identifier,
+                                                  debug_file,
+                                                  debug_identifier,
+                                                  module_version));
+    module_bases.push_back(base_address);
+  }
+
+  uint32_t main_module_index = kNoModuleIndex;
+  stream >> main_module_index;
+
+  if (modules_valid && !stream.eof()) {
+    DecodedCodeModules decoded_view(&decoded_modules, main_module_index);
+    state->modules_ = new BasicCodeModules(&decoded_view);
+  }
+  for (size_t index = 0; index < decoded_modules.size(); ++index)
+    delete decoded_modules[index];
+  if (!modules_valid || stream.eof()) {
+    BPLOG(ERROR) << "ProcessState blob truncated in module list";
+    state->Clear();
+    return false;
+  }
+
+  // Module references are resolved through the rebuilt range map by base
+  // address.  An unresolvable reference (a module BasicCodeModules could
+  // not store) becomes NULL, matching a module that was never seen.
+  uint32_t missing_count = 0;
+  stream >> missing_count;
+  for (uint32_t entry = 0; entry < missing_count; ++entry) {
+    uint32_t index = 0;
+    stream >> index;
+    if (stream.eof())
+      break;
+    if (index < module_bases.size()) {
+      const CodeModule *module =
+          state->modules_->GetModuleForAddress(module_bases[index]);
+      if (module)
+        state->modules_without_symbols_.push_back(module);
+    }
+  }
+
+  uint32_t truncated_count = 0;
+  stream >> truncated_count;
+  for (uint32_t entry = 0; entry < truncated_count; ++entry) {
+    uint32_t thread_index = 0;
+    stream >> thread_index;
+    if (stream.eof())
+      break;
+    state->truncated_threads_.push_back(thread_index);
+  }
+
+  uint32_t thread_count = 0;
+  stream >> thread_count;
+  if (stream.eof()) {
+    BPLOG(ERROR) << "ProcessState blob truncated before thread list";
+    state->Clear();
+    return false;
+  }
+  for (uint32_t thread_index = 0;
+       thread_index < thread_count;
+       ++thread_index) {
+    CallStack *stack = new CallStack();
+    state->threads_.push_back(stack);
+    // Stack memory is not carried by the serialized form.
+    state->thread_memory_regions_.push_back(NULL);
+
+    uint32_t frame_count = 0;
+    stream >> frame_count;
+    for (uint32_t frame_index = 0;
+         frame_index < frame_count;
+         ++frame_index) {
+      uint64_t instruction = 0;
+      uint32_t module_index = kNoModuleIndex;
+      uint8_t has_function_name = 0;
+      string function_name;
+      uint64_t function_base = 0;
+      uint8_t has_source_file_name = 0;
+      string source_file_name;
+      uint32_t source_line = 0;
+      uint64_t source_line_base = 0;
+      uint8_t trust = 0;
+      stream >> instruction >> module_index >> has_function_name;
+      if (has_function_name)
+        stream >> function_name;
+      stream >> function_base >> has_source_file_name;
+      if (has_source_file_name)
+        stream >> source_file_name;
+      stream >> source_line >> source_line_base >> trust;
+      if (stream.eof() || trust > StackFrame::FRAME_TRUST_CONTEXT) {
+        BPLOG(ERROR) << "ProcessState blob truncated in thread " <<
+            thread_index;
+        state->Clear();
+        return false;
+      }
+
+      // Frames are built in the stack's arena, as the stackwalkers build
+      // them, and intern their name strings in the state's pool.
+      StackFrame *frame = stack->arena()->New<StackFrame>();
+      stack->frames_.push_back(frame);
+      frame->intern_pool = state->intern_pool();
+      frame->instruction = instruction;
+      if (module_index < module_bases.size()) {
+        frame->module =
+            state->modules_->GetModuleForAddress(module_bases[module_index]);
+      }
+      if (has_function_name)
+        frame->SetFunctionName(function_name);
+      frame->function_base = function_base;
+      if (has_source_file_name)
+        frame->SetSourceFileName(source_file_name);
+      frame->source_line = static_cast<int>(source_line);
+      frame->source_line_base = source_line_base;
+      frame->trust = static_cast<StackFrame::FrameTrust>(trust);
+    }
+  }
+
+  return true;
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,71 @@
+// Copyright (c) 2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// process_state_serializer.h: ProcessStateSerializer converts a fully
+// digested ProcessState into a compact binary blob and reconstructs a
+// ProcessState from such a blob.  This lets a processing pipeline cache
+// results keyed by dump identity, so that re-examining a crash loads the
+// processed form directly instead of re-walking the minidump.
+//
+// The serialized form covers the crash information, system information,
+// module list, per-thread call stacks with their symbolized frames, the
+// modules-without-symbols and truncated-thread lists, and the
+// exploitability rating.  Two things are deliberately not representable
+// outside the minidump and are dropped: thread stack memory (a
+// deserialized state's thread_memory_regions() entries are NULL) and the
+// CPU-specific register contents of each frame (deserialized frames are
+// plain StackFrame records, which is all that report formatting needs).
+
+#ifndef PROCESSOR_PROCESS_STATE_SERIALIZER_H__
+#define PROCESSOR_PROCESS_STATE_SERIALIZER_H__
+
+#include <string>
+
+#include "common/using_std_string.h"
+
+namespace google_breakpad {
+
+class ProcessState;
+
+class ProcessStateSerializer {
+ public:
+  // Serializes state into a compact binary blob, replacing the previous
+  // contents of |data|.  Returns true on success.
+  static bool Serialize(const ProcessState &state, string *data);
+
+  // Rebuilds state from a blob produced by Serialize, replacing the
+  // previous contents of |state|.  Returns false, leaving |state|
+  // cleared, if the blob is truncated, corrupt, or of an unrecognized
+  // version.
+  static bool Deserialize(const string &data, ProcessState *state);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_PROCESS_STATE_SERIALIZER_H__
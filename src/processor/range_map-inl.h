@@ -52,6 +52,11 @@ bool RangeMap<AddressType, EntryType>::StoreRange(const AddressType &base,
                                                   const EntryType &entry) {
   AddressType high = base + size - 1;
 
+  // Late store into a frozen map: restore the tree representation so the
+  // overlap checks and insertion below work normally.
+  if (!flat_.empty())
+    Thaw();
+
   // Check for undersize or overflow.
   if (size <= 0 || high < base) {
     // The processor will hit this case too frequently with common symbol
@@ -111,6 +116,35 @@ bool RangeMap<AddressType, EntryType>::RetrieveRange(
   BPLOG_IF(ERROR, !entry) << "RangeMap::RetrieveRange requires |entry|";
   assert(entry);
 
+  if (!flat_.empty()) {
+    // Binary-search for the first range whose high address is not below
+    // address, as lower_bound would in tree form.
+    size_t low = 0;
+    size_t high = flat_.size();
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      if (flat_[mid].first < address) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    if (low == flat_.size())
+      return false;
+
+    const std::pair<AddressType, Range> &range = flat_[low];
+    if (address < range.second.base())
+      return false;
+
+    *entry = range.second.entry();
+    if (entry_base)
+      *entry_base = range.second.base();
+    if (entry_size)
+      *entry_size = range.first - range.second.base() + 1;
+
+    return true;
+  }
+
   MapConstIterator iterator = map_.lower_bound(address);
   if (iterator == map_.end())
     return false;
@@ -144,8 +178,34 @@ bool RangeMap<AddressType, EntryType>::RetrieveNearestRange(
   if (RetrieveRange(address, entry, entry_base, entry_size))
     return true;
 
-  // upper_bound gives the first element whose key is greater than address,
-  // but we want the first element whose key is less than or equal to address.
+  // We want the last element whose key is less than or equal to address:
+  // the nearest range below address, since RetrieveRange has already
+  // ruled out a range containing it.
+  if (!flat_.empty()) {
+    size_t low = 0;
+    size_t high = flat_.size();
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      if (flat_[mid].first <= address) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    if (low == 0)
+      return false;
+
+    const std::pair<AddressType, Range> &range = flat_[low - 1];
+    *entry = range.second.entry();
+    if (entry_base)
+      *entry_base = range.second.base();
+    if (entry_size)
+      *entry_size = range.first - range.second.base() + 1;
+
+    return true;
+  }
+
+  // upper_bound gives the first element whose key is greater than address.
   // Decrement the iterator to get there, but not if the upper_bound already
   // points to the beginning of the map - in that case, address is lower than
   // the lowest stored key, so return false.
@@ -176,6 +236,17 @@ bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
     return false;
   }
 
+  if (!flat_.empty()) {
+    const std::pair<AddressType, Range> &range = flat_[index];
+    *entry = range.second.entry();
+    if (entry_base)
+      *entry_base = range.second.base();
+    if (entry_size)
+      *entry_size = range.first - range.second.base() + 1;
+
+    return true;
+  }
+
   // Walk through the map.  Although it's ordered, it's not a vector, so it
   // can't be addressed directly by index.
   MapConstIterator iterator = map_.begin();
@@ -194,13 +265,38 @@ bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
 
 template<typename AddressType, typename EntryType>
 int RangeMap<AddressType, EntryType>::GetCount() const {
-  return map_.size();
+  return map_.size() + flat_.size();
 }
 
 
 template<typename AddressType, typename EntryType>
 void RangeMap<AddressType, EntryType>::Clear() {
   map_.clear();
+  flat_.clear();
+}
+
+
+template<typename AddressType, typename EntryType>
+void RangeMap<AddressType, EntryType>::Freeze() {
+  if (map_.empty())
+    return;
+
+  flat_.reserve(map_.size());
+  for (MapConstIterator iterator = map_.begin();
+       iterator != map_.end();
+       ++iterator) {
+    flat_.push_back(*iterator);
+  }
+  map_.clear();
+}
+
+
+template<typename AddressType, typename EntryType>
+void RangeMap<AddressType, EntryType>::Thaw() {
+  for (size_t index = 0; index < flat_.size(); ++index) {
+    map_.insert(flat_[index]);
+  }
+  flat_.clear();
 }
 
 
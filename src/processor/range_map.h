@@ -42,6 +42,8 @@
 
 
 #include <map>
+#include <utility>
+#include <vector>
 
 
 namespace google_breakpad {
@@ -94,6 +96,16 @@ class RangeMap {
   // initially created.
   void Clear();
 
+  // Converts the map to a flat sorted-vector representation, queried by
+  // binary search over contiguous memory instead of a tree descent.  Call
+  // once the map is fully built; RangeMaps are built once and queried for
+  // every frame, so lookups are the case worth optimizing.  Storing into
+  // a frozen map folds it back into tree form first.
+  void Freeze();
+
+  // Reverses Freeze, restoring the tree representation.
+  void Thaw();
+
  private:
   // Friend declarations.
   friend class ModuleComparer;
@@ -121,8 +133,15 @@ class RangeMap {
   typedef typename AddressToRangeMap::const_iterator MapConstIterator;
   typedef typename AddressToRangeMap::value_type MapValue;
 
-  // Maps the high address of each range to a EntryType.
+  typedef std::vector<std::pair<AddressType, Range> > FlatRangeVector;
+
+  // Maps the high address of each range to a EntryType.  Empty when the
+  // map is frozen.
   AddressToRangeMap map_;
+
+  // The frozen representation: the same (high address, range) pairs in
+  // ascending key order.  Non-empty only after Freeze.
+  FlatRangeVector flat_;
 };
 
 
@@ -0,0 +1,126 @@
+// -*- mode: C++ -*-
+
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// register_dictionary.h: A fixed-capacity register dictionary for
+// per-frame expression evaluation.
+//
+// PostfixEvaluator's default dictionary is a map keyed by strings like
+// "$esp", which allocates a tree node for every register of every frame
+// walked.  RegisterDictionary implements the subset of the map interface
+// the evaluator and the stackwalkers use - operator[], find, begin, end,
+// clear - on top of an inline array of fixed-size slots, so a dictionary
+// that lives on the walker's stack does no heap allocation at all.
+//
+// Program strings name only a small bounded set of identifiers (machine
+// registers plus a few .-prefixed constants and temporaries), so the
+// table is sized generously for that set and searched linearly.  A
+// pathological expression that exceeds the capacity, or an identifier
+// longer than a slot's key field, is logged and evaluated through a
+// scratch slot; such expressions fail the walker's validity checks just
+// as other malformed program strings do.
+
+#ifndef PROCESSOR_REGISTER_DICTIONARY_H__
+#define PROCESSOR_REGISTER_DICTIONARY_H__
+
+#include <stddef.h>
+#include <string.h>
+
+#include <string>
+
+#include "common/using_std_string.h"
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+template<typename ValueType>
+class RegisterDictionary {
+ public:
+  // The longest identifier a slot can hold.  ".cbCalleeParams" is the
+  // longest identifier the stackwalkers themselves use.
+  static const size_t kMaxKeyLength = 31;
+
+  // The number of slots.  The x86 walker seeds about a dozen entries and
+  // program strings add a handful of temporaries.
+  static const size_t kCapacity = 64;
+
+  // Named |first| and |second| so iterators read like map iterators.
+  struct Entry {
+    char first[kMaxKeyLength + 1];
+    ValueType second;
+  };
+
+  typedef const Entry* const_iterator;
+
+  RegisterDictionary() : size_(0) {}
+
+  void clear() { size_ = 0; }
+
+  const_iterator begin() const { return entries_; }
+  const_iterator end() const { return entries_ + size_; }
+
+  const_iterator find(const string &key) const {
+    for (size_t index = 0; index < size_; ++index) {
+      if (key == entries_[index].first)
+        return entries_ + index;
+    }
+    return end();
+  }
+
+  // As with map, references a value-initialized entry if key is not
+  // already present.
+  ValueType& operator[](const string &key) {
+    for (size_t index = 0; index < size_; ++index) {
+      if (key == entries_[index].first)
+        return entries_[index].second;
+    }
+    if (size_ == kCapacity || key.size() > kMaxKeyLength) {
+      BPLOG(ERROR) << "RegisterDictionary cannot store \"" << key << "\"";
+      scratch_.second = ValueType();
+      return scratch_.second;
+    }
+    Entry *entry = &entries_[size_++];
+    memcpy(entry->first, key.data(), key.size());
+    entry->first[key.size()] = '\0';
+    entry->second = ValueType();
+    return entry->second;
+  }
+
+ private:
+  Entry entries_[kCapacity];
+  size_t size_;
+
+  // Absorbs stores that the table cannot hold.
+  Entry scratch_;
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_REGISTER_DICTIONARY_H__
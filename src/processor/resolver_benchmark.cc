@@ -0,0 +1,238 @@
+// Copyright (c) 2010 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// resolver_benchmark.cc: A/B benchmark of the basic and fast source line
+// resolvers on a real symbol file.
+//
+// For each symbol file given, the harness verifies through ModuleComparer
+// that both resolvers agree on the data, then reports parse time,
+// serialize time, resident bytes, and lookup throughput over an address
+// trace.  The trace can be recorded from production (one address per
+// line, hex or decimal); without one, the harness samples addresses from
+// the module's own FUNC records, which exercises the same lookup paths
+// with a uniform access pattern.  Use the numbers to choose a resolver
+// configuration per tier instead of instrumenting by hand.
+//
+// Usage: resolver_benchmark [-t trace-file] [-p passes] <symbol-file> ...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "processor/module_comparer.h"
+
+namespace {
+
+using google_breakpad::MemAddr;
+using google_breakpad::ModuleComparer;
+using std::vector;
+
+// Reads the entire file at path into contents.  Returns false on any
+// I/O failure.
+bool ReadFileToString(const char *path, string *contents) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  contents->clear();
+  char buffer[65536];
+  size_t bytes_read;
+  while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents->append(buffer, bytes_read);
+  }
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+// Parses a recorded address trace: one address per line, hex (0x...) or
+// decimal.  Blank lines and lines starting with '#' are skipped.
+bool ReadAddressTrace(const char *path, vector<MemAddr> *trace) {
+  string contents;
+  if (!ReadFileToString(path, &contents)) {
+    return false;
+  }
+  const char *position = contents.c_str();
+  while (*position) {
+    const char *line_end = strchr(position, '\n');
+    if (!line_end) {
+      line_end = position + strlen(position);
+    }
+    if (*position != '#' && *position != '\n' && *position != '\r') {
+      char *parse_end = NULL;
+      MemAddr address = strtoull(position, &parse_end, 0);
+      if (parse_end != position) {
+        trace->push_back(address);
+      }
+    }
+    position = *line_end ? line_end + 1 : line_end;
+  }
+  return !trace->empty();
+}
+
+// Builds a fallback trace from the module's own FUNC records: each
+// function's entry address plus a point in its middle, so both exact
+// and nearest-range lookups are exercised.
+void SampleTraceFromSymbols(const string &symbol_data,
+                            vector<MemAddr> *trace) {
+  const char *position = symbol_data.c_str();
+  while ((position = strstr(position, "FUNC ")) != NULL) {
+    if (position != symbol_data.c_str() && position[-1] != '\n') {
+      position += 5;
+      continue;
+    }
+    char *parse_end = NULL;
+    MemAddr address = strtoull(position + 5, &parse_end, 16);
+    MemAddr size = parse_end ? strtoull(parse_end, NULL, 16) : 0;
+    trace->push_back(address);
+    if (size > 2) {
+      trace->push_back(address + size / 2);
+    }
+    position += 5;
+  }
+}
+
+void Usage(const char *program_name) {
+  fprintf(stderr,
+          "usage: %s [-t trace-file] [-p passes] <symbol-file> ...\n"
+          "  -t  replay the recorded address trace (one address per\n"
+          "      line, hex or decimal) instead of sampling addresses\n"
+          "      from each module's FUNC records\n"
+          "  -p  number of passes over the trace per resolver\n"
+          "      (default sized for roughly one million lookups)\n",
+          program_name);
+}
+
+// Benchmarks one symbol file and prints its report.  Returns false if
+// loading, equivalence checking, or measurement fails.
+bool BenchmarkSymbolFile(const char *path,
+                         const vector<MemAddr> &recorded_trace,
+                         unsigned int requested_passes) {
+  string symbol_data;
+  if (!ReadFileToString(path, &symbol_data)) {
+    fprintf(stderr, "resolver_benchmark: cannot read %s\n", path);
+    return false;
+  }
+
+  vector<MemAddr> trace = recorded_trace;
+  const char *trace_origin = "recorded";
+  if (trace.empty()) {
+    SampleTraceFromSymbols(symbol_data, &trace);
+    trace_origin = "sampled from FUNC records";
+  }
+  if (trace.empty()) {
+    fprintf(stderr, "resolver_benchmark: no addresses to replay for %s\n",
+            path);
+    return false;
+  }
+
+  unsigned int passes = requested_passes;
+  if (passes == 0) {
+    passes = static_cast<unsigned int>(1000000 / trace.size());
+    if (passes == 0) {
+      passes = 1;
+    }
+  }
+
+  ModuleComparer comparer;
+  bool equivalent = comparer.Compare(symbol_data);
+
+  ModuleComparer::BenchmarkResult result;
+  if (!comparer.Benchmark(symbol_data, trace, passes, &result)) {
+    fprintf(stderr, "resolver_benchmark: measurement failed for %s\n", path);
+    return false;
+  }
+
+  printf("%s\n", path);
+  printf("  equivalence:     %s\n", equivalent ? "OK" : "MISMATCH");
+  printf("  symbol text:     %lu bytes\n",
+         static_cast<unsigned long>(result.symbol_bytes));
+  printf("  serialized:      %lu bytes (%.1f%% of text, resident for "
+         "fast resolver)\n",
+         static_cast<unsigned long>(result.serialized_bytes),
+         result.symbol_bytes
+             ? 100.0 * result.serialized_bytes / result.symbol_bytes
+             : 0.0);
+  printf("  parse:           %.3f ms\n", result.parse_time_us / 1000.0);
+  printf("  serialize:       %.3f ms\n", result.serialize_time_us / 1000.0);
+  printf("  fast load:       %.3f ms\n", result.fast_load_time_us / 1000.0);
+  printf("  trace:           %lu addresses (%s), %u passes\n",
+         static_cast<unsigned long>(trace.size()), trace_origin, passes);
+  if (result.basic_lookup_time_us && result.fast_lookup_time_us) {
+    printf("  basic lookups:   %.0f per second\n",
+           result.trace_lookups * 1000000.0 / result.basic_lookup_time_us);
+    printf("  fast lookups:    %.0f per second\n",
+           result.trace_lookups * 1000000.0 / result.fast_lookup_time_us);
+  } else {
+    printf("  lookups:         timings unavailable on this platform\n");
+  }
+  return equivalent;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *trace_path = NULL;
+  unsigned int passes = 0;
+
+  int argi = 1;
+  while (argi < argc && argv[argi][0] == '-') {
+    if (!strcmp(argv[argi], "-t") && argi + 1 < argc) {
+      trace_path = argv[++argi];
+    } else if (!strcmp(argv[argi], "-p") && argi + 1 < argc) {
+      passes = static_cast<unsigned int>(atoi(argv[++argi]));
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+    ++argi;
+  }
+  if (argi >= argc) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  vector<MemAddr> recorded_trace;
+  if (trace_path && !ReadAddressTrace(trace_path, &recorded_trace)) {
+    fprintf(stderr, "resolver_benchmark: cannot read trace %s\n", trace_path);
+    return 1;
+  }
+
+  bool all_ok = true;
+  for (; argi < argc; ++argi) {
+    if (!BenchmarkSymbolFile(argv[argi], recorded_trace, passes)) {
+      all_ok = false;
+    }
+  }
+  return all_ok ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// serialized_module_cache.cc: SerializedModuleCache implementation.
+//
+// See serialized_module_cache.h for documentation.
+
+#include "processor/serialized_module_cache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/fast_source_line_resolver.h"
+#include "processor/logging.h"
+#include "processor/serialized_module_format.h"
+
+namespace google_breakpad {
+
+SerializedModuleCache::SerializedModuleCache(const string &cache_directory)
+    : cache_directory_(cache_directory), blobs_() {
+}
+
+SerializedModuleCache::~SerializedModuleCache() {
+  for (vector<MappedBlob>::iterator iterator = blobs_.begin();
+       iterator != blobs_.end();
+       ++iterator) {
+#ifndef _WIN32
+    if (iterator->mapped) {
+      munmap(iterator->data, iterator->size);
+      continue;
+    }
+#endif  // _WIN32
+    delete [] iterator->data;
+  }
+}
+
+string SerializedModuleCache::CachePathForModule(
+    const CodeModule *module) const {
+  if (!module) {
+    return "";
+  }
+
+  string debug_file = module->debug_file();
+  string debug_identifier = module->debug_identifier();
+  if (debug_file.empty() || debug_identifier.empty()) {
+    return "";
+  }
+
+  // Reduce the debug file to its base name: it may be recorded in the
+  // dump with either style of path separator.
+  size_t slash = debug_file.find_last_of("/\\");
+  if (slash != string::npos) {
+    debug_file.erase(0, slash + 1);
+  }
+  if (debug_file.empty()) {
+    return "";
+  }
+
+  return cache_directory_ + "/" + debug_file + "-" + debug_identifier +
+         ".symc";
+}
+
+bool SerializedModuleCache::Load(const CodeModule *module,
+                                 FastSourceLineResolver *fast_resolver) {
+  if (!fast_resolver) {
+    return false;
+  }
+
+  string path = CachePathForModule(module);
+  if (path.empty()) {
+    return false;
+  }
+
+  MappedBlob blob;
+  blob.data = NULL;
+  blob.size = 0;
+  blob.mapped = false;
+
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) == -1 || stat_buf.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+  blob.size = stat_buf.st_size;
+
+  void *mapping = mmap(NULL, blob.size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    BPLOG(ERROR) << "SerializedModuleCache could not map " << path;
+    return false;
+  }
+  blob.data = static_cast<char*>(mapping);
+  blob.mapped = true;
+#else  // _WIN32
+  // No mmap; read the blob into a heap buffer.  Parsing is still
+  // skipped, which is most of the win.
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  if (fseek(file, 0, SEEK_END) != 0) {
+    fclose(file);
+    return false;
+  }
+  long file_size = ftell(file);
+  if (file_size <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+    fclose(file);
+    return false;
+  }
+  blob.size = file_size;
+  blob.data = new char[blob.size];
+  if (fread(blob.data, 1, blob.size, file) != blob.size) {
+    fclose(file);
+    delete [] blob.data;
+    return false;
+  }
+  fclose(file);
+#endif  // _WIN32
+
+  // Validate the container before interpreting any of it: the blob may
+  // have been written by another machine, truncated by a crashed
+  // writer, or predate the current format version.
+  const char *payload = NULL;
+  size_t payload_size = 0;
+  if (!ValidateSerializedModule(blob.data, blob.size,
+                                &payload, &payload_size)) {
+    BPLOG(INFO) << "SerializedModuleCache rejecting blob " << path;
+#ifndef _WIN32
+    if (blob.mapped) {
+      munmap(blob.data, blob.size);
+    } else {
+      delete [] blob.data;
+    }
+#else
+    delete [] blob.data;
+#endif  // _WIN32
+    return false;
+  }
+
+  if (!fast_resolver->LoadModuleUsingMemoryBuffer(
+          module, const_cast<char*>(payload))) {
+#ifndef _WIN32
+    if (blob.mapped) {
+      munmap(blob.data, blob.size);
+    } else {
+      delete [] blob.data;
+    }
+#else
+    delete [] blob.data;
+#endif  // _WIN32
+    return false;
+  }
+
+  // The resolver holds pointers into the blob; keep it alive until this
+  // cache is destroyed.
+  blobs_.push_back(blob);
+  return true;
+}
+
+bool SerializedModuleCache::Store(const CodeModule *module,
+                                  const char *data,
+                                  size_t size) {
+  if (!data || size == 0) {
+    return false;
+  }
+
+  string path = CachePathForModule(module);
+  if (path.empty()) {
+    return false;
+  }
+
+  // Write to a temporary file and rename into place so a concurrent
+  // reader never maps a half-written blob.
+  char temporary_suffix[32];
+  snprintf(temporary_suffix, sizeof(temporary_suffix), ".tmp.%lu",
+           static_cast<unsigned long>(
+#ifndef _WIN32
+               getpid()
+#else
+               0
+#endif  // _WIN32
+           ));
+  string temporary_path = path + temporary_suffix;
+
+  FILE *file = fopen(temporary_path.c_str(), "wb");
+  if (!file) {
+    BPLOG(ERROR) << "SerializedModuleCache could not create " <<
+        temporary_path;
+    return false;
+  }
+  if (fwrite(data, 1, size, file) != size) {
+    BPLOG(ERROR) << "SerializedModuleCache could not write " <<
+        temporary_path;
+    fclose(file);
+    remove(temporary_path.c_str());
+    return false;
+  }
+  if (fclose(file) != 0) {
+    remove(temporary_path.c_str());
+    return false;
+  }
+
+  if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+    BPLOG(ERROR) << "SerializedModuleCache could not rename " <<
+        temporary_path << " to " << path;
+    remove(temporary_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,107 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// serialized_module_cache.h: SerializedModuleCache stores the serialized
+// form of symbol modules (the format produced by ModuleSerializer and
+// consumed by FastSourceLineResolver) on disk, keyed by a module's debug
+// file and debug identifier.  A module that has been cached once can be
+// loaded into a FastSourceLineResolver by mapping the blob directly, with
+// no symbol parsing at all; concurrent processes mapping the same blob
+// share it through the page cache.
+//
+// The cache owns the mappings it creates, and FastSourceLineResolver
+// keeps pointers into a loaded module's buffer, so a SerializedModuleCache
+// must outlive any resolver modules loaded from it.
+
+#ifndef PROCESSOR_SERIALIZED_MODULE_CACHE_H__
+#define PROCESSOR_SERIALIZED_MODULE_CACHE_H__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "processor/module_blob_store.h"
+
+namespace google_breakpad {
+
+using std::vector;
+
+class CodeModule;
+class FastSourceLineResolver;
+
+class SerializedModuleCache : public ModuleBlobStore {
+ public:
+  // Creates a cache rooted at cache_directory, which must already exist.
+  explicit SerializedModuleCache(const string &cache_directory);
+
+  // Unmaps (or frees) every blob loaded by Load.  Resolver modules
+  // loaded from this cache must already be unloaded.
+  virtual ~SerializedModuleCache();
+
+  // Maps the cached serialized blob for module, if one exists, and loads
+  // it into fast_resolver.  Returns false if the module is not cached or
+  // the blob could not be loaded; a false return is the normal cache-miss
+  // case, not an error.
+  virtual bool Load(const CodeModule *module,
+                    FastSourceLineResolver *fast_resolver);
+
+  // Stores size bytes of serialized module data for module.  data must
+  // be a container produced by ModuleSerializer::SerializeToContainer;
+  // Load validates the container before using a stored blob.  The blob
+  // is written to a temporary file and renamed into place, so concurrent
+  // readers and writers only ever observe complete blobs.  Returns false
+  // if the module has no usable cache key or the write fails.
+  virtual bool Store(const CodeModule *module, const char *data, size_t size);
+
+ private:
+  // Returns the cache file path for module, or the empty string if the
+  // module's debug file or debug identifier is empty.
+  string CachePathForModule(const CodeModule *module) const;
+
+  string cache_directory_;
+
+  // Blobs handed out to a resolver, released in the destructor.  On
+  // platforms without mmap these are heap buffers instead of mappings.
+  struct MappedBlob {
+    char *data;
+    size_t size;
+    bool mapped;
+  };
+  vector<MappedBlob> blobs_;
+
+  // Disallow copy and assignment.
+  SerializedModuleCache(const SerializedModuleCache&);
+  void operator=(const SerializedModuleCache&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_SERIALIZED_MODULE_CACHE_H__
@@ -0,0 +1,143 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// serialized_module_format.cc: serialized module container validation.
+//
+// See serialized_module_format.h for documentation.
+
+#include "processor/serialized_module_format.h"
+
+#include <string.h>
+
+#include "google_breakpad/processor/source_line_resolver_interface.h"
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+uint32_t SerializedModuleChecksum(const char *data, size_t size) {
+  static uint32_t crc_table[256];
+  static bool crc_table_built = false;
+
+  if (!crc_table_built) {
+    for (uint32_t index = 0; index < 256; ++index) {
+      uint32_t entry = index;
+      for (int bit = 0; bit < 8; ++bit) {
+        entry = (entry >> 1) ^ ((entry & 1) ? 0xedb88320u : 0);
+      }
+      crc_table[index] = entry;
+    }
+    crc_table_built = true;
+  }
+
+  uint32_t crc = 0xffffffffu;
+  for (size_t index = 0; index < size; ++index) {
+    crc = (crc >> 8) ^
+        crc_table[(crc ^ static_cast<uint8_t>(data[index])) & 0xff];
+  }
+  return crc ^ 0xffffffffu;
+}
+
+uint8_t SerializedModuleHostEndianness() {
+  const uint16_t probe = 1;
+  return *reinterpret_cast<const uint8_t*>(&probe) == 1 ?
+      kSerializedModuleLittleEndian : kSerializedModuleBigEndian;
+}
+
+bool ValidateSerializedModule(const char *data,
+                              size_t size,
+                              const char **payload,
+                              size_t *payload_size) {
+  if (!data || size < sizeof(SerializedModuleHeader)) {
+    BPLOG(INFO) << "Serialized module container too small: " << size;
+    return false;
+  }
+
+  SerializedModuleHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  if (header.magic != kSerializedModuleMagic) {
+    BPLOG(INFO) << "Serialized module container has bad magic";
+    return false;
+  }
+  if (header.version != kSerializedModuleVersion) {
+    BPLOG(INFO) << "Serialized module container version " << header.version <<
+        " not readable by version " << kSerializedModuleVersion;
+    return false;
+  }
+  if (header.endianness != SerializedModuleHostEndianness() ||
+      header.address_size != sizeof(SourceLineResolverInterface::MemAddr)) {
+    BPLOG(INFO) << "Serialized module container written by an "
+                   "incompatible machine";
+    return false;
+  }
+  if (header.section_count == 0) {
+    BPLOG(INFO) << "Serialized module container has no sections";
+    return false;
+  }
+
+  size_t table_size = header.section_count * sizeof(uint32_t);
+  if (size < sizeof(header) + table_size ||
+      size - sizeof(header) - table_size < header.data_size) {
+    BPLOG(INFO) << "Serialized module container truncated: " << size;
+    return false;
+  }
+
+  const char *checked_region = data + sizeof(header);
+  size_t checked_size = table_size + header.data_size;
+  uint32_t checksum = SerializedModuleChecksum(checked_region, checked_size);
+  if (checksum != header.checksum) {
+    BPLOG(ERROR) << "Serialized module container checksum mismatch";
+    return false;
+  }
+
+  // Each section must lie within the payload.
+  const char *section_table = data + sizeof(header);
+  for (uint16_t section_index = 0;
+       section_index < header.section_count;
+       ++section_index) {
+    uint32_t offset;
+    memcpy(&offset, section_table + section_index * sizeof(uint32_t),
+           sizeof(offset));
+    if (offset > header.data_size) {
+      BPLOG(ERROR) << "Serialized module section " << section_index <<
+          " out of bounds";
+      return false;
+    }
+  }
+
+  if (payload) {
+    *payload = data + sizeof(header) + table_size;
+  }
+  if (payload_size) {
+    *payload_size = header.data_size;
+  }
+  return true;
+}
+
+}  // namespace google_breakpad
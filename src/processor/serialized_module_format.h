@@ -0,0 +1,93 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// serialized_module_format.h: The container format for serialized symbol
+// modules, as written by ModuleSerializer::SerializeToContainer and
+// stored by SerializedModuleCache.
+//
+// A container is a SerializedModuleHeader, immediately followed by a
+// table of section_count uint32_t offsets (each section's position
+// relative to the start of the payload), immediately followed by the
+// payload: the raw serialized module bytes FastSourceLineResolver
+// consumes.  The checksum covers the section table and the payload, so
+// a truncated or corrupted blob shipped between machines is rejected
+// before any of it is interpreted.  The endianness and address-size
+// tags reject blobs produced by an incompatible writer; the payload is
+// not byte-swapped on read.
+
+#ifndef PROCESSOR_SERIALIZED_MODULE_FORMAT_H__
+#define PROCESSOR_SERIALIZED_MODULE_FORMAT_H__
+
+#include <stddef.h>
+
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+// 'B' 'P' 'S' 'M' when read as bytes on a little-endian machine.
+static const uint32_t kSerializedModuleMagic = 0x4d535042;
+
+// Bump this whenever the payload byte layout produced by the map
+// serializers changes.
+// Version 2: StaticMap keys may use the delta-encoded compact layout
+// described in static_map_compact.h.
+static const uint32_t kSerializedModuleVersion = 2;
+
+// Values for SerializedModuleHeader::endianness.
+static const uint8_t kSerializedModuleLittleEndian = 1;
+static const uint8_t kSerializedModuleBigEndian = 2;
+
+struct SerializedModuleHeader {
+  uint32_t magic;          // kSerializedModuleMagic
+  uint32_t version;        // kSerializedModuleVersion
+  uint8_t  endianness;     // kSerializedModule{Little,Big}Endian
+  uint8_t  address_size;   // sizeof(MemAddr) in the payload
+  uint16_t section_count;  // entries in the section offset table
+  uint32_t data_size;      // payload bytes after the section table
+  uint32_t checksum;       // CRC-32 of the section table and payload
+};
+
+// Returns the CRC-32 (polynomial 0xedb88320) of size bytes at data.
+uint32_t SerializedModuleChecksum(const char *data, size_t size);
+
+// Returns the endianness tag describing this machine.
+uint8_t SerializedModuleHostEndianness();
+
+// Checks that size bytes at data form a complete container this reader
+// can consume: magic, version, endianness, address size, extents, and
+// checksum.  On success returns true and sets *payload and
+// *payload_size to the serialized module bytes within the container.
+bool ValidateSerializedModule(const char *data,
+                              size_t size,
+                              const char **payload,
+                              size_t *payload_size);
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_SERIALIZED_MODULE_FORMAT_H__
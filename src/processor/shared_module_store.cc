@@ -0,0 +1,237 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// shared_module_store.cc: SharedModuleStore implementation.
+//
+// See shared_module_store.h for documentation.
+
+#include "processor/shared_module_store.h"
+
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/fast_source_line_resolver.h"
+#include "processor/logging.h"
+#include "processor/serialized_module_format.h"
+
+namespace google_breakpad {
+
+SharedModuleStore::SharedModuleStore(const string &name_prefix)
+    : name_prefix_(name_prefix), attachments_() {
+}
+
+SharedModuleStore::~SharedModuleStore() {
+#ifndef _WIN32
+  for (vector<Attachment>::iterator iterator = attachments_.begin();
+       iterator != attachments_.end();
+       ++iterator) {
+    munmap(iterator->data, iterator->size);
+  }
+#endif  // _WIN32
+}
+
+string SharedModuleStore::SegmentNameForModule(
+    const CodeModule *module) const {
+  if (!module) {
+    return "";
+  }
+
+  string debug_file = module->debug_file();
+  string debug_identifier = module->debug_identifier();
+  if (debug_file.empty() || debug_identifier.empty()) {
+    return "";
+  }
+
+  // Reduce the debug file to its base name: it may be recorded in the
+  // dump with either style of path separator.
+  size_t slash = debug_file.find_last_of("/\\");
+  if (slash != string::npos) {
+    debug_file.erase(0, slash + 1);
+  }
+  if (debug_file.empty()) {
+    return "";
+  }
+
+  // A POSIX shared-memory object name may contain no slash beyond the
+  // leading one; replace anything questionable while we're at it.
+  string name = name_prefix_ + "-" + debug_file + "-" + debug_identifier;
+  for (size_t index = 1; index < name.size(); ++index) {
+    char character = name[index];
+    bool safe = (character >= 'a' && character <= 'z') ||
+                (character >= 'A' && character <= 'Z') ||
+                (character >= '0' && character <= '9') ||
+                character == '.' || character == '_' || character == '-';
+    if (!safe) {
+      name[index] = '_';
+    }
+  }
+  return name;
+}
+
+bool SharedModuleStore::Load(const CodeModule *module,
+                             FastSourceLineResolver *fast_resolver) {
+  if (!fast_resolver) {
+    return false;
+  }
+
+  string name = SegmentNameForModule(module);
+  if (name.empty()) {
+    return false;
+  }
+
+#ifndef _WIN32
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd == -1) {
+    return false;
+  }
+
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) == -1 || stat_buf.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+
+  Attachment attachment;
+  attachment.size = stat_buf.st_size;
+
+  // MAP_SHARED, read-only: every process attaching this segment
+  // resolves from the same physical pages.
+  void *mapping = mmap(NULL, attachment.size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    BPLOG(ERROR) << "SharedModuleStore could not map " << name;
+    return false;
+  }
+  attachment.data = static_cast<char*>(mapping);
+
+  // Validate the container before interpreting any of it: the segment
+  // may still be mid-publish, in which case the header's checksum does
+  // not cover a complete blob yet and this is a miss, not an error.
+  const char *payload = NULL;
+  size_t payload_size = 0;
+  if (!ValidateSerializedModule(attachment.data, attachment.size,
+                                &payload, &payload_size)) {
+    BPLOG(INFO) << "SharedModuleStore rejecting segment " << name;
+    munmap(attachment.data, attachment.size);
+    return false;
+  }
+
+  if (!fast_resolver->LoadModuleUsingMemoryBuffer(
+          module, const_cast<char*>(payload))) {
+    munmap(attachment.data, attachment.size);
+    return false;
+  }
+
+  // The resolver holds pointers into the mapping; keep it attached
+  // until this store is destroyed.
+  attachments_.push_back(attachment);
+  return true;
+#else  // _WIN32
+  // POSIX shared memory is unavailable; every lookup is a miss.
+  return false;
+#endif  // _WIN32
+}
+
+bool SharedModuleStore::Store(const CodeModule *module,
+                              const char *data,
+                              size_t size) {
+  if (!data || size <= sizeof(SerializedModuleHeader)) {
+    return false;
+  }
+
+  string name = SegmentNameForModule(module);
+  if (name.empty()) {
+    return false;
+  }
+
+#ifndef _WIN32
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd == -1) {
+    if (errno == EEXIST) {
+      // Another publisher got here first; its segment is as good as
+      // ours would have been.
+      return true;
+    }
+    BPLOG(ERROR) << "SharedModuleStore could not create " << name;
+    return false;
+  }
+
+  if (ftruncate(fd, size) == -1) {
+    BPLOG(ERROR) << "SharedModuleStore could not size " << name;
+    close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    BPLOG(ERROR) << "SharedModuleStore could not map " << name;
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  // Write the payload before the header.  A reader that attaches
+  // mid-publish sees a header that fails validation (the segment starts
+  // zero-filled, and the checksum covers the payload) and treats the
+  // segment as a miss until the header lands.
+  char *destination = static_cast<char*>(mapping);
+  memcpy(destination + sizeof(SerializedModuleHeader),
+         data + sizeof(SerializedModuleHeader),
+         size - sizeof(SerializedModuleHeader));
+  memcpy(destination, data, sizeof(SerializedModuleHeader));
+
+  munmap(mapping, size);
+  return true;
+#else  // _WIN32
+  return false;
+#endif  // _WIN32
+}
+
+bool SharedModuleStore::Unpublish(const CodeModule *module) {
+  string name = SegmentNameForModule(module);
+  if (name.empty()) {
+    return false;
+  }
+
+#ifndef _WIN32
+  return shm_unlink(name.c_str()) == 0;
+#else  // _WIN32
+  return false;
+#endif  // _WIN32
+}
+
+}  // namespace google_breakpad
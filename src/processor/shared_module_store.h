@@ -0,0 +1,124 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// shared_module_store.h: SharedModuleStore keeps serialized symbol
+// modules (the container format produced by ModuleSerializer) in POSIX
+// shared-memory segments, one segment per module, keyed by the module's
+// debug file and debug identifier.  Processors attach read-only with a
+// MAP_SHARED mapping and resolve through the StaticMap structures in
+// place, so when many stackwalk workers on one machine load the same
+// hot module, there is one physical copy of its symbol data.
+//
+// A segment is published once, by symbol_daemon or by the first
+// processor to serialize the module: Store creates the segment with
+// O_EXCL, writes the payload before the container header, and treats an
+// already-existing segment as published.  A reader racing a writer sees
+// a header whose checksum does not yet cover a complete blob, rejects
+// it, and reports a miss.  Segments persist until Unpublish (or a
+// reboot) even with no process attached, so the publisher does not need
+// to stay resident for workers to share its work.
+//
+// The store owns the attachments it creates, and FastSourceLineResolver
+// keeps pointers into a loaded module's mapping, so a SharedModuleStore
+// must outlive any resolver modules loaded from it.
+
+#ifndef PROCESSOR_SHARED_MODULE_STORE_H__
+#define PROCESSOR_SHARED_MODULE_STORE_H__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "processor/module_blob_store.h"
+
+namespace google_breakpad {
+
+using std::vector;
+
+class CodeModule;
+class FastSourceLineResolver;
+
+class SharedModuleStore : public ModuleBlobStore {
+ public:
+  // Creates a store whose segments are named beneath name_prefix, which
+  // must begin with '/' and contain no other slashes (POSIX shared
+  // memory object naming).  Every process on the machine constructing a
+  // store with the same prefix shares the same segments.
+  explicit SharedModuleStore(const string &name_prefix);
+
+  // Detaches every mapping created by Load.  The segments themselves
+  // remain published.  Resolver modules loaded from this store must
+  // already be unloaded.
+  virtual ~SharedModuleStore();
+
+  // Attaches the published segment for module, if one exists, and loads
+  // it into fast_resolver.  The mapping is read-only and MAP_SHARED, so
+  // every attached process resolves from the same physical pages.
+  // Returns false if no segment is published or the blob is invalid; a
+  // false return is the normal miss case, not an error.
+  virtual bool Load(const CodeModule *module,
+                    FastSourceLineResolver *fast_resolver);
+
+  // Publishes size bytes of serialized module data for module.  data
+  // must be a container produced by ModuleSerializer::SerializeToContainer.
+  // If a segment for module already exists it is left untouched and the
+  // call succeeds, so concurrent publishers are harmless.  Returns
+  // false if the module has no usable key or the segment cannot be
+  // created and filled.
+  virtual bool Store(const CodeModule *module, const char *data, size_t size);
+
+  // Removes module's published segment.  Processes already attached
+  // keep their mappings; new Load calls miss.  Returns false if no such
+  // segment was published.
+  bool Unpublish(const CodeModule *module);
+
+ private:
+  // Returns the shared-memory object name for module, or the empty
+  // string if the module's debug file or debug identifier is empty.
+  string SegmentNameForModule(const CodeModule *module) const;
+
+  string name_prefix_;
+
+  // Mappings handed out to a resolver, detached in the destructor.
+  struct Attachment {
+    char *data;
+    size_t size;
+  };
+  vector<Attachment> attachments_;
+
+  // Disallow copy and assignment.
+  SharedModuleStore(const SharedModuleStore&);
+  void operator=(const SharedModuleStore&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_SHARED_MODULE_STORE_H__
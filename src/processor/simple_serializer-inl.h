@@ -159,19 +159,21 @@ class SimpleSerializer<WindowsFrameInfo> {
   }
 };
 
-// Specializations of SimpleSerializer: Linked_ptr version of
-// Line, Function, PublicSymbol, WindowsFrameInfo.
+// Specializations of SimpleSerializer: plain pointer version of Line,
+// Function, and PublicSymbol, as stored in BasicSourceLineResolver's
+// lookup maps (the objects themselves live in the module's record
+// store), and linked_ptr version of WindowsFrameInfo.
 template<>
-class SimpleSerializer< linked_ptr<BasicSourceLineResolver::Line> > {
+class SimpleSerializer<BasicSourceLineResolver::Line*> {
   typedef BasicSourceLineResolver::Line Line;
  public:
-  static size_t SizeOf(const linked_ptr<Line> &lineptr) {
-    if (lineptr.get() == NULL) return 0;
-    return SimpleSerializer<Line>::SizeOf(*(lineptr.get()));
+  static size_t SizeOf(const Line *lineptr) {
+    if (lineptr == NULL) return 0;
+    return SimpleSerializer<Line>::SizeOf(*lineptr);
   }
-  static char *Write(const linked_ptr<Line> &lineptr, char *dest) {
-    if (lineptr.get())
-      dest = SimpleSerializer<Line>::Write(*(lineptr.get()), dest);
+  static char *Write(const Line *lineptr, char *dest) {
+    if (lineptr)
+      dest = SimpleSerializer<Line>::Write(*lineptr, dest);
     return dest;
   }
 };
@@ -202,36 +204,36 @@ class SimpleSerializer<BasicSourceLineResolver::Function> {
   }
  private:
   // This static member is defined in module_serializer.cc.
-  static RangeMapSerializer< MemAddr, linked_ptr<Line> > range_map_serializer_;
+  static RangeMapSerializer<MemAddr, Line*> range_map_serializer_;
 };
 
 template<>
-class SimpleSerializer< linked_ptr<BasicSourceLineResolver::Function> > {
+class SimpleSerializer<BasicSourceLineResolver::Function*> {
   typedef BasicSourceLineResolver::Function Function;
  public:
-  static size_t SizeOf(const linked_ptr<Function> &func) {
-    if (!func.get()) return 0;
-    return SimpleSerializer<Function>::SizeOf(*(func.get()));
+  static size_t SizeOf(const Function *func) {
+    if (!func) return 0;
+    return SimpleSerializer<Function>::SizeOf(*func);
   }
 
-  static char *Write(const linked_ptr<Function> &func, char *dest) {
-    if (func.get())
-      dest = SimpleSerializer<Function>::Write(*(func.get()), dest);
+  static char *Write(const Function *func, char *dest) {
+    if (func)
+      dest = SimpleSerializer<Function>::Write(*func, dest);
     return dest;
   }
 };
 
 template<>
-class SimpleSerializer< linked_ptr<BasicSourceLineResolver::PublicSymbol> > {
+class SimpleSerializer<BasicSourceLineResolver::PublicSymbol*> {
   typedef BasicSourceLineResolver::PublicSymbol PublicSymbol;
  public:
-  static size_t SizeOf(const linked_ptr<PublicSymbol> &pubsymbol) {
-    if (pubsymbol.get() == NULL) return 0;
-    return SimpleSerializer<PublicSymbol>::SizeOf(*(pubsymbol.get()));
+  static size_t SizeOf(const PublicSymbol *pubsymbol) {
+    if (pubsymbol == NULL) return 0;
+    return SimpleSerializer<PublicSymbol>::SizeOf(*pubsymbol);
   }
-  static char *Write(const linked_ptr<PublicSymbol> &pubsymbol, char *dest) {
-    if (pubsymbol.get())
-      dest = SimpleSerializer<PublicSymbol>::Write(*(pubsymbol.get()), dest);
+  static char *Write(const PublicSymbol *pubsymbol, char *dest) {
+    if (pubsymbol)
+      dest = SimpleSerializer<PublicSymbol>::Write(*pubsymbol, dest);
     return dest;
   }
 };
@@ -36,9 +36,16 @@
 #include "processor/simple_symbol_supplier.h"
 
 #include <assert.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #include <algorithm>
 #include <iostream>
@@ -46,7 +53,9 @@
 
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/code_modules.h"
 #include "google_breakpad/processor/system_info.h"
+#include "processor/compressed_symbol_file.h"
 #include "processor/logging.h"
 #include "processor/pathname_stripper.h"
 
@@ -57,6 +66,326 @@ static bool file_exists(const string &file_name) {
   return stat(file_name.c_str(), &sb) == 0;
 }
 
+#ifndef _WIN32
+// Symbol stores are debug_file/identifier/name.sym; allow a little slack
+// beyond that before giving up on a wild directory tree.
+static const int kMaxIndexDepth = 8;
+
+// Adds every regular file under directory to index, recursing at most
+// kMaxIndexDepth levels.
+static void IndexDirectory(const string &directory,
+                           int depth,
+                           std::set<string> *index) {
+  DIR *dir = opendir(directory.c_str());
+  if (!dir) {
+    return;
+  }
+
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+    string path = directory + "/" + entry->d_name;
+    struct stat sb;
+    if (stat(path.c_str(), &sb) != 0) {
+      continue;
+    }
+    if (S_ISDIR(sb.st_mode)) {
+      if (depth < kMaxIndexDepth) {
+        IndexDirectory(path, depth + 1, index);
+      }
+    } else if (S_ISREG(sb.st_mode)) {
+      index->insert(path);
+    }
+  }
+
+  closedir(dir);
+}
+#endif  // _WIN32
+
+bool SimpleSymbolSupplier::BuildIndex() {
+#ifdef _WIN32
+  return false;
+#else
+  symbol_index_.clear();
+  for (unsigned int path_index = 0; path_index < paths_.size(); ++path_index) {
+    IndexDirectory(paths_[path_index], 0, &symbol_index_);
+  }
+  index_built_ = true;
+  BPLOG(INFO) << "Indexed " << symbol_index_.size() << " symbol files in " <<
+      paths_.size() << " root paths";
+  return true;
+#endif  // _WIN32
+}
+
+bool SimpleSymbolSupplier::SymbolFileExists(const string &path) {
+  // A path present in the index exists; no metadata I/O needed.
+  if (index_built_ && symbol_index_.find(path) != symbol_index_.end()) {
+    return true;
+  }
+
+  time_t now = time(NULL);
+  if (negative_cache_ttl_ > 0) {
+#ifndef _WIN32
+    pthread_mutex_lock(&lock_);
+#endif
+    map<string, time_t>::iterator miss = negative_cache_.find(path);
+    bool fresh_miss = false;
+    if (miss != negative_cache_.end()) {
+      if (now < miss->second) {
+        fresh_miss = true;
+      } else {
+        negative_cache_.erase(miss);
+      }
+    }
+#ifndef _WIN32
+    pthread_mutex_unlock(&lock_);
+#endif
+    if (fresh_miss) {
+      return false;
+    }
+  }
+
+  // Not in the index (or no index): probe the filesystem, which also
+  // finds symbol files uploaded after the index was built.  A miss is
+  // remembered so the next dumps referencing this module don't restat.
+  bool exists = file_exists(path);
+  if (!exists && negative_cache_ttl_ > 0) {
+#ifndef _WIN32
+    pthread_mutex_lock(&lock_);
+#endif
+    negative_cache_[path] = now + negative_cache_ttl_;
+#ifndef _WIN32
+    pthread_mutex_unlock(&lock_);
+#endif
+  }
+  return exists;
+}
+
+SimpleSymbolSupplier::~SimpleSymbolSupplier() {
+  FinishPrefetch();
+
+  // Release any symbol data the owner never freed.
+  for (std::multimap<string, HeapBuffer>::iterator buffer =
+           memory_buffers_.begin();
+       buffer != memory_buffers_.end();
+       ++buffer) {
+    delete [] buffer->second.data;
+  }
+#ifndef _WIN32
+  for (std::multimap<string, MappedBuffer>::iterator mapped =
+           mapped_buffers_.begin();
+       mapped != mapped_buffers_.end();
+       ++mapped) {
+    munmap(mapped->second.data, mapped->second.size);
+  }
+
+  pthread_cond_destroy(&read_done_cond_);
+  pthread_cond_destroy(&prefetch_done_cond_);
+  pthread_mutex_destroy(&lock_);
+#endif
+
+  // Shared buffers are owned by their consumers' references, which must
+  // all have been released by now; a surviving entry means a consumer
+  // will Release into a destroyed supplier.
+  BPLOG_IF(ERROR, !shared_buffers_.empty()) << "SimpleSymbolSupplier "
+      "destroyed with " << shared_buffers_.size() <<
+      " shared symbol buffers still referenced";
+}
+
+#ifndef _WIN32
+bool SimpleSymbolSupplier::MmapSymbolFile(const string &path,
+                                          const string &code_file,
+                                          char **symbol_data) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) == -1) {
+    close(fd);
+    return false;
+  }
+  size_t size = stat_buf.st_size;
+
+  // The parser needs a NUL terminator after the text.  When the file
+  // ends mid-page the rest of the final mapped page reads as zero; a
+  // file that exactly fills its last page has no such slot, so fall
+  // back to the heap for that (rare) case.
+  if (size == 0 || size % getpagesize() == 0) {
+    close(fd);
+    return false;
+  }
+
+  // PROT_WRITE with MAP_PRIVATE: the symbol parser NUL-terminates
+  // tokens in place, dirtying pages copy-on-write, while untouched
+  // pages remain backed by the file.
+  void *mapping =
+      mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  madvise(mapping, size, MADV_SEQUENTIAL);
+
+  MappedBuffer buffer;
+  buffer.data = static_cast<char*>(mapping);
+  buffer.size = size;
+  buffer.owner = pthread_self();
+  pthread_mutex_lock(&lock_);
+  mapped_buffers_.insert(make_pair(code_file, buffer));
+  pthread_mutex_unlock(&lock_);
+
+  *symbol_data = buffer.data;
+  return true;
+}
+#endif  // _WIN32
+
+#ifndef _WIN32
+// The number of concurrent symbol reads.  Network symbol stores serve a
+// few parallel readers well; going wider mostly queues on the store.
+static const size_t kPrefetchThreadCount = 4;
+
+// Worker-pool state for one prefetch batch.  Workers claim modules from
+// the list under claim_lock and publish results into the supplier's
+// prefetched_ map.  The pool owns copies of the modules and system info
+// it was given: the originals belong to the ProcessState being built,
+// and the caller may destroy that state before the workers drain.
+struct SimpleSymbolSupplier::PrefetchPool {
+  pthread_mutex_t claim_lock;
+  vector<const CodeModule*> modules;
+  size_t next_module;
+  SystemInfo system_info;
+  SimpleSymbolSupplier *supplier;
+  vector<pthread_t> threads;
+
+  ~PrefetchPool() {
+    for (size_t module_index = 0; module_index < modules.size();
+         ++module_index) {
+      delete modules[module_index];
+    }
+  }
+};
+
+// static
+void* SimpleSymbolSupplier::PrefetchWorker(void *arg) {
+  PrefetchPool *pool = static_cast<PrefetchPool*>(arg);
+  SimpleSymbolSupplier *supplier = pool->supplier;
+
+  for (;;) {
+    pthread_mutex_lock(&pool->claim_lock);
+    if (pool->next_module >= pool->modules.size()) {
+      pthread_mutex_unlock(&pool->claim_lock);
+      break;
+    }
+    const CodeModule *module = pool->modules[pool->next_module++];
+    pthread_mutex_unlock(&pool->claim_lock);
+
+    string symbol_file;
+    string symbol_data;
+    SymbolResult result = supplier->FetchSymbolFile(module,
+                                                    &pool->system_info,
+                                                    &symbol_file,
+                                                    &symbol_data);
+
+    pthread_mutex_lock(&supplier->lock_);
+    map<string, PrefetchEntry>::iterator entry =
+        supplier->prefetched_.find(module->code_file());
+    if (entry != supplier->prefetched_.end()) {
+      entry->second.result = result;
+      entry->second.symbol_file.swap(symbol_file);
+      entry->second.symbol_data.swap(symbol_data);
+      entry->second.completed = true;
+    }
+    pthread_cond_broadcast(&supplier->prefetch_done_cond_);
+    pthread_mutex_unlock(&supplier->lock_);
+  }
+  return NULL;
+}
+#endif  // _WIN32
+
+void SimpleSymbolSupplier::PrefetchSymbolFiles(const CodeModules *modules,
+                                               const SystemInfo *system_info) {
+#ifndef _WIN32
+  if (!modules) {
+    return;
+  }
+
+  // Join any previous batch and discard its unconsumed results: the
+  // same code file may resolve to different symbols in the next dump.
+  FinishPrefetch();
+  pthread_mutex_lock(&lock_);
+  prefetched_.clear();
+  pthread_mutex_unlock(&lock_);
+
+  PrefetchPool *pool = new PrefetchPool;
+  pthread_mutex_init(&pool->claim_lock, NULL);
+  pool->next_module = 0;
+  if (system_info) {
+    pool->system_info = *system_info;
+  }
+  pool->supplier = this;
+
+  unsigned int module_count = modules->module_count();
+  pthread_mutex_lock(&lock_);
+  for (unsigned int module_index = 0;
+       module_index < module_count;
+       ++module_index) {
+    const CodeModule *module = modules->GetModuleAtIndex(module_index);
+    if (!module) {
+      continue;
+    }
+    prefetched_[module->code_file()] = PrefetchEntry();
+    pool->modules.push_back(module->Copy());
+  }
+  pthread_mutex_unlock(&lock_);
+
+  if (pool->modules.empty()) {
+    pthread_mutex_destroy(&pool->claim_lock);
+    delete pool;
+    return;
+  }
+
+  size_t thread_count = pool->modules.size() < kPrefetchThreadCount ?
+      pool->modules.size() : kPrefetchThreadCount;
+  pool->threads.resize(thread_count);
+  size_t threads_started = 0;
+  for (size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+    if (pthread_create(&pool->threads[threads_started], NULL,
+                       PrefetchWorker, pool) == 0) {
+      ++threads_started;
+    }
+  }
+  pool->threads.resize(threads_started);
+
+  if (threads_started == 0) {
+    // No workers could be created; complete the entries on this thread
+    // so no GetSymbolFile call waits forever.
+    PrefetchWorker(pool);
+  }
+
+  prefetch_pool_ = pool;
+#endif  // _WIN32
+}
+
+void SimpleSymbolSupplier::FinishPrefetch() {
+#ifndef _WIN32
+  if (!prefetch_pool_) {
+    return;
+  }
+  for (size_t thread_index = 0;
+       thread_index < prefetch_pool_->threads.size();
+       ++thread_index) {
+    pthread_join(prefetch_pool_->threads[thread_index], NULL);
+  }
+  pthread_mutex_destroy(&prefetch_pool_->claim_lock);
+  delete prefetch_pool_;
+  prefetch_pool_ = NULL;
+#endif  // _WIN32
+}
+
 SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFile(
     const CodeModule *module, const SystemInfo *system_info,
     string *symbol_file) {
@@ -84,13 +413,50 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFile(
   assert(symbol_data);
   symbol_data->clear();
 
-  SymbolSupplier::SymbolResult s = GetSymbolFile(module, system_info, symbol_file);
+#ifndef _WIN32
+  if (module) {
+    // Consume the prefetched result if this module was in a batch,
+    // waiting for its worker if the read is still in flight.
+    pthread_mutex_lock(&lock_);
+    map<string, PrefetchEntry>::iterator entry =
+        prefetched_.find(module->code_file());
+    if (entry != prefetched_.end()) {
+      while (!entry->second.completed) {
+        pthread_cond_wait(&prefetch_done_cond_, &lock_);
+      }
+      SymbolResult result = entry->second.result;
+      *symbol_file = entry->second.symbol_file;
+      symbol_data->swap(entry->second.symbol_data);
+      prefetched_.erase(entry);
+      pthread_mutex_unlock(&lock_);
+      return result;
+    }
+    pthread_mutex_unlock(&lock_);
+  }
+#endif  // _WIN32
+
+  return FetchSymbolFile(module, system_info, symbol_file, symbol_data);
+}
+
+SymbolSupplier::SymbolResult SimpleSymbolSupplier::FetchSymbolFile(
+    const CodeModule *module,
+    const SystemInfo *system_info,
+    string *symbol_file,
+    string *symbol_data) {
+  SymbolSupplier::SymbolResult s = GetSymbolFile(module, system_info,
+                                                 symbol_file);
 
   if (s == FOUND) {
-    std::ifstream in(symbol_file->c_str());
-    std::getline(in, *symbol_data, string::traits_type::to_char_type(
-                     string::traits_type::eof()));
-    in.close();
+    if (IsCompressedSymbolFile(*symbol_file)) {
+      if (!ReadCompressedSymbolFile(*symbol_file, symbol_data)) {
+        return NOT_FOUND;
+      }
+    } else {
+      std::ifstream in(symbol_file->c_str());
+      std::getline(in, *symbol_data, string::traits_type::to_char_type(
+                       string::traits_type::eof()));
+      in.close();
+    }
   }
   return s;
 }
@@ -102,6 +468,60 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetCStringSymbolData(
     char **symbol_data) {
   assert(symbol_data);
 
+#ifndef _WIN32
+  // Single-flight the read per module: when several symbolizers share
+  // this supplier and hit the same cold module at once, the first
+  // caller reads the file and the rest read behind it from the page
+  // cache instead of issuing the same large read in parallel.
+  string code_file = module ? module->code_file() : string();
+  pthread_mutex_lock(&lock_);
+  while (reads_in_flight_.find(code_file) != reads_in_flight_.end()) {
+    pthread_cond_wait(&read_done_cond_, &lock_);
+  }
+  reads_in_flight_.insert(code_file);
+  pthread_mutex_unlock(&lock_);
+
+  SymbolResult result =
+      ReadCStringSymbolData(module, system_info, symbol_file, symbol_data);
+
+  pthread_mutex_lock(&lock_);
+  reads_in_flight_.erase(code_file);
+  pthread_cond_broadcast(&read_done_cond_);
+  pthread_mutex_unlock(&lock_);
+  return result;
+#else
+  return ReadCStringSymbolData(module, system_info, symbol_file, symbol_data);
+#endif  // _WIN32
+}
+
+SymbolSupplier::SymbolResult SimpleSymbolSupplier::ReadCStringSymbolData(
+    const CodeModule *module,
+    const SystemInfo *system_info,
+    string *symbol_file,
+    char **symbol_data) {
+#ifndef _WIN32
+  // Prefer handing out a mapping of the symbol file: no copy, and the
+  // pages are shared with other processes working from the same store.
+  // A file not on disk is not necessarily absent: the read below
+  // consults prefetched results and FetchSymbolFile, either of which
+  // a subclass may satisfy from somewhere other than the local tree.
+  SymbolSupplier::SymbolResult result =
+      GetSymbolFile(module, system_info, symbol_file);
+  if (result == INTERRUPT) {
+    return result;
+  }
+  if (result == FOUND &&
+      !IsCompressedSymbolFile(*symbol_file) &&
+      MmapSymbolFile(*symbol_file, module->code_file(), symbol_data)) {
+    // Drop any prefetched copy of this module's data; the mapping
+    // supersedes it.
+    pthread_mutex_lock(&lock_);
+    prefetched_.erase(module->code_file());
+    pthread_mutex_unlock(&lock_);
+    return FOUND;
+  }
+#endif  // _WIN32
+
   string symbol_data_string;
   SymbolSupplier::SymbolResult s =
       GetSymbolFile(module, system_info, symbol_file, &symbol_data_string);
@@ -115,7 +535,16 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetCStringSymbolData(
     }
     memcpy(*symbol_data, symbol_data_string.c_str(), size - 1);
     (*symbol_data)[size - 1] = '\0';
-    memory_buffers_.insert(make_pair(module->code_file(), *symbol_data));
+    HeapBuffer buffer;
+    buffer.data = *symbol_data;
+#ifndef _WIN32
+    buffer.owner = pthread_self();
+    pthread_mutex_lock(&lock_);
+#endif
+    memory_buffers_.insert(make_pair(module->code_file(), buffer));
+#ifndef _WIN32
+    pthread_mutex_unlock(&lock_);
+#endif
   }
   return s;
 }
@@ -126,26 +555,179 @@ void SimpleSymbolSupplier::FreeSymbolData(const CodeModule *module) {
     return;
   }
 
-  map<string, char *>::iterator it = memory_buffers_.find(module->code_file());
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+
+  // Several callers may hold buffers for the same module; free the
+  // calling thread's own buffer, since another thread may still be
+  // parsing the one it was handed.  Fall back to any entry for frees
+  // issued from a different thread than the lookup.
+  typedef std::multimap<string, MappedBuffer>::iterator MappedIterator;
+  std::pair<MappedIterator, MappedIterator> mapped_range =
+      mapped_buffers_.equal_range(module->code_file());
+  if (mapped_range.first != mapped_range.second) {
+    MappedIterator mapped = mapped_range.first;
+    for (MappedIterator candidate = mapped_range.first;
+         candidate != mapped_range.second;
+         ++candidate) {
+      if (pthread_equal(candidate->second.owner, pthread_self())) {
+        mapped = candidate;
+        break;
+      }
+    }
+    munmap(mapped->second.data, mapped->second.size);
+    mapped_buffers_.erase(mapped);
+    pthread_mutex_unlock(&lock_);
+    return;
+  }
+
+  typedef std::multimap<string, HeapBuffer>::iterator HeapIterator;
+  std::pair<HeapIterator, HeapIterator> heap_range =
+      memory_buffers_.equal_range(module->code_file());
+  if (heap_range.first != heap_range.second) {
+    HeapIterator heap = heap_range.first;
+    for (HeapIterator candidate = heap_range.first;
+         candidate != heap_range.second;
+         ++candidate) {
+      if (pthread_equal(candidate->second.owner, pthread_self())) {
+        heap = candidate;
+        break;
+      }
+    }
+    delete [] heap->second.data;
+    memory_buffers_.erase(heap);
+    pthread_mutex_unlock(&lock_);
+    return;
+  }
+  pthread_mutex_unlock(&lock_);
+
+  BPLOG(INFO) << "Cannot find symbol data buffer for module "
+              << module->code_file();
+#else  // _WIN32
+  std::multimap<string, HeapBuffer>::iterator it =
+      memory_buffers_.find(module->code_file());
   if (it == memory_buffers_.end()) {
     BPLOG(INFO) << "Cannot find symbol data buffer for module "
                 << module->code_file();
     return;
   }
-  delete [] it->second;
+  delete [] it->second.data;
   memory_buffers_.erase(it);
+#endif  // _WIN32
 }
 
-SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFileAtPathFromRoot(
-    const CodeModule *module, const SystemInfo *system_info,
-    const string &root_path, string *symbol_file) {
-  BPLOG_IF(ERROR, !symbol_file) << "SimpleSymbolSupplier::GetSymbolFileAtPath "
-                                   "requires |symbol_file|";
-  assert(symbol_file);
-  symbol_file->clear();
+void SimpleSymbolSupplier::SharedBuffer::AddRef() {
+#ifndef _WIN32
+  pthread_mutex_lock(&supplier_->lock_);
+#endif
+  TakeRef();
+#ifndef _WIN32
+  pthread_mutex_unlock(&supplier_->lock_);
+#endif
+}
 
-  if (!module)
+void SimpleSymbolSupplier::SharedBuffer::Release() {
+  // Dropping the count and erasing the cache entry happen under the
+  // same lock GetSharedSymbolData takes to look the entry up, so no
+  // lookup can hand out a reference to a buffer that is about to be
+  // deleted.
+  SimpleSymbolSupplier *supplier = supplier_;
+#ifndef _WIN32
+  pthread_mutex_lock(&supplier->lock_);
+#endif
+  bool last_reference = DropRef() == 0;
+  if (last_reference) {
+    supplier->shared_buffers_.erase(key_);
+  }
+#ifndef _WIN32
+  pthread_mutex_unlock(&supplier->lock_);
+#endif
+  if (last_reference) {
+    delete this;
+  }
+}
+
+SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSharedSymbolData(
+    const CodeModule *module,
+    const SystemInfo *system_info,
+    string *symbol_file,
+    SymbolDataBuffer **symbol_data) {
+  assert(symbol_data);
+  *symbol_data = NULL;
+  if (!module) {
     return NOT_FOUND;
+  }
+  const string code_file = module->code_file();
+
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  for (;;) {
+    // Serve the buffer an earlier consumer is still holding, if any.
+    map<string, SharedBuffer*>::iterator cached =
+        shared_buffers_.find(code_file);
+    if (cached != shared_buffers_.end()) {
+      cached->second->TakeRef();
+      *symbol_file = cached->second->symbol_file_;
+      *symbol_data = cached->second;
+#ifndef _WIN32
+      pthread_mutex_unlock(&lock_);
+#endif
+      return FOUND;
+    }
+#ifndef _WIN32
+    // Single-flight the read per module, as GetCStringSymbolData does;
+    // a waiter rechecks the cache once the reader finishes, so only one
+    // buffer is ever created per miss.
+    if (reads_in_flight_.find(code_file) == reads_in_flight_.end()) {
+      break;
+    }
+    pthread_cond_wait(&read_done_cond_, &lock_);
+#else
+    break;
+#endif
+  }
+  reads_in_flight_.insert(code_file);
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+
+  string symbol_data_string;
+  SymbolResult result =
+      GetSymbolFile(module, system_info, symbol_file, &symbol_data_string);
+
+  SharedBuffer *buffer = NULL;
+  if (result == FOUND) {
+    size_t size = symbol_data_string.size();
+    char *data = new char[size + 1];
+    // Can't use strcpy, as the data may contain '\0's before the end.
+    memcpy(data, symbol_data_string.c_str(), size);
+    data[size] = '\0';
+    buffer = new SharedBuffer(data, size, this, code_file);
+    buffer->symbol_file_ = *symbol_file;
+  }
+
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  reads_in_flight_.erase(code_file);
+  if (buffer) {
+    shared_buffers_[code_file] = buffer;
+  }
+#ifndef _WIN32
+  pthread_cond_broadcast(&read_done_cond_);
+  pthread_mutex_unlock(&lock_);
+#endif
+
+  *symbol_data = buffer;
+  return result;
+}
+
+// static
+string SimpleSymbolSupplier::SymbolPathUnderRoot(const CodeModule *module,
+                                                 const string &root_path) {
+  if (!module)
+    return string();
 
   // Start with the base path.
   string path = root_path;
@@ -157,7 +739,7 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFileAtPathFromRoot(
     BPLOG(ERROR) << "Can't construct symbol file path without debug_file "
                     "(code_file = " <<
                     PathnameStripper::File(module->code_file()) << ")";
-    return NOT_FOUND;
+    return string();
   }
   path.append(debug_file_name);
 
@@ -169,7 +751,7 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFileAtPathFromRoot(
                     "(code_file = " <<
                     PathnameStripper::File(module->code_file()) <<
                     ", debug_file = " << debug_file_name << ")";
-    return NOT_FOUND;
+    return string();
   }
   path.append(identifier);
 
@@ -188,10 +770,42 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFileAtPathFromRoot(
     path.append(debug_file_name);
   }
   path.append(".sym");
+  return path;
+}
+
+void SimpleSymbolSupplier::ForgetMissingSymbolFile(const string &path) {
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  negative_cache_.erase(path);
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+}
 
-  if (!file_exists(path)) {
-    BPLOG(INFO) << "No symbol file at " << path;
+SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFileAtPathFromRoot(
+    const CodeModule *module, const SystemInfo *system_info,
+    const string &root_path, string *symbol_file) {
+  BPLOG_IF(ERROR, !symbol_file) << "SimpleSymbolSupplier::GetSymbolFileAtPath "
+                                   "requires |symbol_file|";
+  assert(symbol_file);
+  symbol_file->clear();
+
+  string path = SymbolPathUnderRoot(module, root_path);
+  if (path.empty())
     return NOT_FOUND;
+
+  // The store may keep the file compressed at rest; prefer the plain
+  // file, then fall back to a compressed sibling.
+  if (!SymbolFileExists(path)) {
+    if (SymbolFileExists(path + ".gz")) {
+      path.append(".gz");
+    } else if (SymbolFileExists(path + ".zst")) {
+      path.append(".zst");
+    } else {
+      BPLOG(INFO) << "No symbol file at " << path;
+      return NOT_FOUND;
+    }
   }
 
   *symbol_file = path;
@@ -76,11 +76,18 @@
 #ifndef PROCESSOR_SIMPLE_SYMBOL_SUPPLIER_H__
 #define PROCESSOR_SIMPLE_SYMBOL_SUPPLIER_H__
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#include <time.h>
+
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "common/using_std_string.h"
+#include "google_breakpad/processor/symbol_data_buffer.h"
 #include "google_breakpad/processor/symbol_supplier.h"
 
 namespace google_breakpad {
@@ -94,13 +101,42 @@ class SimpleSymbolSupplier : public SymbolSupplier {
  public:
   // Creates a new SimpleSymbolSupplier, using path as the root path where
   // symbols are stored.
-  explicit SimpleSymbolSupplier(const string &path) : paths_(1, path) {}
+  explicit SimpleSymbolSupplier(const string &path)
+      : paths_(1, path),
+        index_built_(false),
+        negative_cache_ttl_(kDefaultNegativeCacheTtlSeconds),
+        prefetch_pool_(NULL) {
+#ifndef _WIN32
+    pthread_mutex_init(&lock_, NULL);
+    pthread_cond_init(&prefetch_done_cond_, NULL);
+    pthread_cond_init(&read_done_cond_, NULL);
+#endif
+  }
 
   // Creates a new SimpleSymbolSupplier, using paths as a list of root
   // paths where symbols may be stored.
-  explicit SimpleSymbolSupplier(const vector<string> &paths) : paths_(paths) {}
+  explicit SimpleSymbolSupplier(const vector<string> &paths)
+      : paths_(paths),
+        index_built_(false),
+        negative_cache_ttl_(kDefaultNegativeCacheTtlSeconds),
+        prefetch_pool_(NULL) {
+#ifndef _WIN32
+    pthread_mutex_init(&lock_, NULL);
+    pthread_cond_init(&prefetch_done_cond_, NULL);
+    pthread_cond_init(&read_done_cond_, NULL);
+#endif
+  }
+
+  virtual ~SimpleSymbolSupplier();
 
-  virtual ~SimpleSymbolSupplier() {}
+  // Begins reading every module's symbol file on background threads.
+  // A later GetSymbolFile call for a prefetched module waits for and
+  // consumes the prefetched result, so symbol I/O overlaps with the
+  // stack walk instead of serializing with it.  Leftover results from a
+  // previous batch are discarded.  Call BuildIndex, if desired, before
+  // the first prefetch.  No-op where threads are unavailable.
+  virtual void PrefetchSymbolFiles(const CodeModules *modules,
+                                   const SystemInfo *system_info);
 
   // Returns the path to the symbol file for the given module.  See the
   // description above.
@@ -115,6 +151,11 @@ class SimpleSymbolSupplier : public SymbolSupplier {
 
   // Allocates data buffer on heap and writes symbol data into buffer.
   // Symbol supplier ALWAYS takes ownership of the data buffer.
+  // Concurrent calls for the same module are single-flighted: the first
+  // caller performs the read and later callers wait for it to finish
+  // before reading, so several symbolizers sharing this supplier don't
+  // gang up on one cold symbol file.  Each caller still receives its
+  // own buffer, paired with its own FreeSymbolData call.
   virtual SymbolResult GetCStringSymbolData(const CodeModule *module,
                                             const SystemInfo *system_info,
                                             string *symbol_file,
@@ -123,15 +164,196 @@ class SimpleSymbolSupplier : public SymbolSupplier {
   // Free the data buffer allocated in the above GetCStringSymbolData();
   virtual void FreeSymbolData(const CodeModule *module);
 
+  // SimpleSymbolSupplier hands out reference-counted buffers; see
+  // GetSharedSymbolData.
+  virtual bool SupportsSharedSymbolData() const { return true; }
+
+  // Returns the module's symbol data as a shared, reference-counted
+  // buffer.  Concurrent and repeated requests for the same module are
+  // served from one physical buffer for as long as any consumer still
+  // holds a reference; once the last reference is released, the buffer
+  // frees itself and the next request re-reads the file.  The returned
+  // reference belongs to the caller, who must treat the bytes as
+  // read-only and call Release - not FreeSymbolData - when done.  All
+  // consumers must release their references before the supplier is
+  // destroyed.
+  virtual SymbolResult GetSharedSymbolData(const CodeModule *module,
+                                           const SystemInfo *system_info,
+                                           string *symbol_file,
+                                           SymbolDataBuffer **symbol_data);
+
+  // Enumerates the directory trees under the configured root paths once
+  // and remembers every file found, so that symbol lookups are answered
+  // from memory instead of per-module stat calls.  The index is a
+  // snapshot: symbol files added later are still found, but only via a
+  // stat throttled by the negative cache.  Call again to refresh.
+  // Returns false on platforms without directory enumeration support.
+  bool BuildIndex();
+
+  // Sets how long, in seconds, a missing symbol file's path is
+  // remembered before it is probed again.  Repeated dumps referencing
+  // the same symbol-less OS modules otherwise restat the same paths for
+  // every dump.  0 disables the negative cache.
+  void set_negative_cache_ttl(long ttl_seconds) {
+    negative_cache_ttl_ = ttl_seconds;
+  }
+  long negative_cache_ttl() const { return negative_cache_ttl_; }
+
  protected:
   SymbolResult GetSymbolFileAtPathFromRoot(const CodeModule *module,
                                            const SystemInfo *system_info,
                                            const string &root_path,
                                            string *symbol_file);
 
+  // Returns the store-layout path for module's symbol file beneath
+  // root_path: <root_path>/<debug_file>/<debug_identifier>/<name>.sym.
+  // Returns the empty string if the module lacks the fields needed to
+  // construct the path.
+  static string SymbolPathUnderRoot(const CodeModule *module,
+                                    const string &root_path);
+
+  // Drops path from the negative cache.  For subclasses that create a
+  // symbol file at a path an earlier lookup probed and found missing.
+  void ForgetMissingSymbolFile(const string &path);
+
+  // Joins any in-flight prefetch workers.  A subclass overriding
+  // GetSymbolFile must call this from its destructor, before tearing
+  // down any state its override uses: by the time the base destructor
+  // joins the workers, the subclass no longer exists.
+  void FinishPrefetch();
+
  private:
-  map<string, char *> memory_buffers_;
+  // By default a missing symbol file is trusted to stay missing for
+  // five minutes.
+  static const long kDefaultNegativeCacheTtlSeconds = 300;
+
+  // Returns true if a symbol file exists at path, consulting the index
+  // and the negative cache before falling back to stat.
+  bool SymbolFileExists(const string &path);
+
+  // The locate-and-read work behind the two-result GetSymbolFile,
+  // callable from prefetch workers without re-entering the prefetch
+  // bookkeeping.  The locate step goes through the virtual
+  // single-result GetSymbolFile, so a subclass that populates the tree
+  // on demand (HTTPSymbolSupplier) has its downloads run on the
+  // prefetch workers, several modules at a time.
+  SymbolResult FetchSymbolFile(const CodeModule *module,
+                               const SystemInfo *system_info,
+                               string *symbol_file,
+                               string *symbol_data);
+
+  // The locate-map-or-read work behind GetCStringSymbolData, run by one
+  // caller at a time per module.
+  SymbolResult ReadCStringSymbolData(const CodeModule *module,
+                                     const SystemInfo *system_info,
+                                     string *symbol_file,
+                                     char **symbol_data);
+
+  // A SymbolDataBuffer whose reference count is guarded by the
+  // supplier's lock_, which also guards shared_buffers_: a cache lookup
+  // therefore cannot revive a buffer whose last reference is being
+  // dropped.  An entry removes itself from shared_buffers_ when its
+  // count reaches zero.
+  class SharedBuffer : public SymbolDataBuffer {
+   public:
+    SharedBuffer(char *data, size_t size, SimpleSymbolSupplier *supplier,
+                 const string &key)
+        : SymbolDataBuffer(data, size), supplier_(supplier), key_(key) {}
+    virtual void AddRef();
+    virtual void Release();
+
+   private:
+    friend class SimpleSymbolSupplier;
+    SimpleSymbolSupplier *supplier_;
+    string key_;
+    // The path the data was read from, reported on cache hits.
+    string symbol_file_;
+  };
+
+  // One module's prefetched (or in-flight) symbol lookup.
+  struct PrefetchEntry {
+    PrefetchEntry() : completed(false), result(NOT_FOUND) {}
+    bool completed;
+    SymbolResult result;
+    string symbol_file;
+    string symbol_data;
+  };
+
+  // Worker-pool state for one prefetch batch; defined in the .cc file.
+  struct PrefetchPool;
+  static void* PrefetchWorker(void *arg);
+
+#ifndef _WIN32
+  // Maps the symbol file at path copy-on-write and records the mapping
+  // under code_file for FreeSymbolData.  Returns false if the file
+  // cannot be mapped with a guaranteed NUL terminator, in which case
+  // the caller falls back to a heap buffer.
+  bool MmapSymbolFile(const string &path,
+                      const string &code_file,
+                      char **symbol_data);
+#endif
+
+  // Symbol data handed out by GetCStringSymbolData, keyed by code file.
+  // Multimaps because concurrent symbolizers sharing this supplier may
+  // each hold a buffer for the same module (each caller gets a private
+  // buffer: the parser tokenizes it in place, so buffers cannot be
+  // shared).  The owner thread lets FreeSymbolData release the
+  // caller's own buffer rather than another thread's.
+  struct HeapBuffer {
+    char *data;
+#ifndef _WIN32
+    pthread_t owner;
+#endif
+  };
+  std::multimap<string, HeapBuffer> memory_buffers_;
+
+  // Symbol data delivered as file mappings rather than heap buffers.
+  // Pages the parser doesn't write stay shared with other processes
+  // mapping the same file and are reclaimable under memory pressure.
+  struct MappedBuffer {
+    char *data;
+    size_t size;
+#ifndef _WIN32
+    pthread_t owner;
+#endif
+  };
+  std::multimap<string, MappedBuffer> mapped_buffers_;
+
+  // Live shared buffers keyed by code file.  The supplier does not own
+  // these: each is kept alive by its consumers' references and erases
+  // itself on its final Release.
+  map<string, SharedBuffer*> shared_buffers_;
+
   vector<string> paths_;
+
+  // Every file under paths_ as of the last BuildIndex call.
+  std::set<string> symbol_index_;
+  bool index_built_;
+
+  // Paths recently determined not to exist, mapped to the time at which
+  // they should be probed again.
+  map<string, time_t> negative_cache_;
+  long negative_cache_ttl_;
+
+  // Prefetched results keyed by code file, and the workers filling them.
+  map<string, PrefetchEntry> prefetched_;
+  PrefetchPool *prefetch_pool_;
+
+  // Code files whose symbol data is currently being read by a
+  // GetCStringSymbolData caller.  Later callers for the same module
+  // wait on read_done_cond_ and then read behind the first caller,
+  // against a warm page cache.
+  std::set<string> reads_in_flight_;
+
+#ifndef _WIN32
+  // Guards negative_cache_, prefetched_, reads_in_flight_, and
+  // shared_buffers_ along with the buffers' reference counts;
+  // prefetch_done_cond_ is signaled as each prefetched module
+  // completes.
+  pthread_mutex_t lock_;
+  pthread_cond_t prefetch_done_cond_;
+  pthread_cond_t read_done_cond_;
+#endif
 };
 
 }  // namespace google_breakpad
@@ -38,10 +38,14 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <map>
 #include <utility>
+#include <vector>
 
+#include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/source_line_resolver_base.h"
+#include "processor/compressed_symbol_file.h"
 #include "processor/source_line_resolver_base_types.h"
 #include "processor/module_factory.h"
 
@@ -50,10 +54,56 @@ using std::make_pair;
 
 namespace google_breakpad {
 
+namespace {
+
+// Advances *counter and returns the new value, without a lock where
+// atomic builtins are available.  Elsewhere concurrent lookups are not
+// offered (see SupportsConcurrentLookups), so a plain increment does.
+uint64_t AtomicIncrement(uint64_t *counter) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __sync_add_and_fetch(counter, 1);
+#else
+  return ++*counter;
+#endif
+}
+
+}  // namespace
+
+SourceLineResolverBase::ModuleKey::ModuleKey(const string &code_file_arg)
+    : hash(CodeModule::HashCodeFilePath(code_file_arg)),
+      code_file(code_file_arg) {
+}
+
+SourceLineResolverBase::ModuleKey::ModuleKey(const CodeModule *module)
+    : hash(module->code_file_hash()),
+      code_file(module->code_file()) {
+}
+
+bool SourceLineResolverBase::ModuleKey::operator<(
+    const ModuleKey &other) const {
+  if (hash != other.hash)
+    return hash < other.hash;
+  return strcmp(code_file.c_str(), other.code_file.c_str()) < 0;
+}
+
+bool SourceLineResolverBase::ModuleKey::operator==(
+    const ModuleKey &other) const {
+  return hash == other.hash && code_file == other.code_file;
+}
+
 SourceLineResolverBase::SourceLineResolverBase(
     ModuleFactory *module_factory)
   : modules_(new ModuleMap),
     memory_buffers_(new MemoryMap),
+    shared_buffers_(new SharedBufferMap),
+    max_loaded_bytes_(0),
+    loaded_bytes_(0),
+    resolution_hit_count_(0),
+    eviction_count_(0),
+    lru_clock_(0),
+    module_sizes_(new UsageMap),
+    last_used_(new UsageMap),
+    load_source_lines_(true),
     module_factory_(module_factory) {
 }
 
@@ -74,9 +124,126 @@ SourceLineResolverBase::~SourceLineResolverBase() {
   // Delete the map of memory buffers.
   delete memory_buffers_;
 
+  // Release the references held on shared buffers; each buffer frees
+  // itself once its last holder lets go.
+  SharedBufferMap::iterator shared_iter = shared_buffers_->begin();
+  for (; shared_iter != shared_buffers_->end(); ++shared_iter) {
+    shared_iter->second->Release();
+  }
+  delete shared_buffers_;
+
+  delete module_sizes_;
+  delete last_used_;
+
   delete module_factory_;
 }
 
+void SourceLineResolverBase::set_load_source_lines(bool load_source_lines) {
+  load_source_lines_ = load_source_lines;
+}
+
+bool SourceLineResolverBase::load_source_lines() const {
+  return load_source_lines_;
+}
+
+void SourceLineResolverBase::set_max_loaded_bytes(uint64_t max_loaded_bytes) {
+  max_loaded_bytes_ = max_loaded_bytes;
+  EvictOverBudget(ModuleKey());
+}
+
+uint64_t SourceLineResolverBase::max_loaded_bytes() const {
+  return max_loaded_bytes_;
+}
+
+uint64_t SourceLineResolverBase::loaded_bytes() const {
+  return loaded_bytes_;
+}
+
+uint64_t SourceLineResolverBase::resolution_hit_count() const {
+  return resolution_hit_count_;
+}
+
+uint64_t SourceLineResolverBase::eviction_count() const {
+  return eviction_count_;
+}
+
+void SourceLineResolverBase::RecordModuleLoad(const ModuleKey &key,
+                                              uint64_t size) {
+  (*module_sizes_)[key] = size;
+  (*last_used_)[key] = ++lru_clock_;
+  loaded_bytes_ += size;
+  EvictOverBudget(key);
+}
+
+void SourceLineResolverBase::NoteModuleUsed(const ModuleKey &key) {
+  // Lookups may run concurrently (see SupportsConcurrentLookups), so
+  // the counters advance atomically.  The find does not mutate the map
+  // - only loads and unloads do, and those are exclusive - and two
+  // threads racing to store a stamp both store valid stamps.
+  AtomicIncrement(&resolution_hit_count_);
+  UsageMap::iterator used = last_used_->find(key);
+  if (used != last_used_->end()) {
+    used->second = AtomicIncrement(&lru_clock_);
+  }
+}
+
+void SourceLineResolverBase::EvictOverBudget(const ModuleKey &protected_key) {
+  if (max_loaded_bytes_ == 0) {
+    return;
+  }
+
+  while (loaded_bytes_ > max_loaded_bytes_) {
+    // Find the least-recently-resolved module that still has a loaded
+    // Module object and isn't the one being protected.  The module count
+    // is small enough that a linear scan is fine.
+    UsageMap::iterator victim = last_used_->end();
+    for (UsageMap::iterator candidate = last_used_->begin();
+         candidate != last_used_->end();
+         ++candidate) {
+      if (candidate->first == protected_key ||
+          modules_->find(candidate->first) == modules_->end()) {
+        continue;
+      }
+      if (victim == last_used_->end() ||
+          candidate->second < victim->second) {
+        victim = candidate;
+      }
+    }
+    if (victim == last_used_->end()) {
+      break;
+    }
+
+    const ModuleKey victim_key = victim->first;
+    BPLOG(INFO) << "Evicting symbols for module " << victim_key.code_file <<
+        " to stay within " << max_loaded_bytes_ << " bytes";
+
+    ModuleMap::iterator mod_iter = modules_->find(victim_key);
+    delete mod_iter->second;
+    modules_->erase(mod_iter);
+
+    MemoryMap::iterator buffer_iter = memory_buffers_->find(victim_key);
+    if (buffer_iter != memory_buffers_->end()) {
+      delete [] buffer_iter->second;
+      memory_buffers_->erase(buffer_iter);
+    }
+
+    SharedBufferMap::iterator shared_iter = shared_buffers_->find(victim_key);
+    if (shared_iter != shared_buffers_->end()) {
+      shared_iter->second->Release();
+      shared_buffers_->erase(shared_iter);
+    }
+
+    UsageMap::iterator size_iter = module_sizes_->find(victim_key);
+    if (size_iter != module_sizes_->end()) {
+      loaded_bytes_ -= size_iter->second;
+      module_sizes_->erase(size_iter);
+    }
+    last_used_->erase(victim_key);
+
+    ++eviction_count_;
+  }
+}
+
 bool SourceLineResolverBase::ReadSymbolFile(char **symbol_data,
                                             const string &map_file) {
   if (symbol_data == NULL) {
@@ -84,6 +251,12 @@ bool SourceLineResolverBase::ReadSymbolFile(char **symbol_data,
     return false;
   }
 
+  // A compressed symbol file is streamed through a decompressor
+  // straight into the parse buffer.
+  if (IsCompressedSymbolFile(map_file)) {
+    return ReadCompressedSymbolFile(map_file, symbol_data, NULL);
+  }
+
   struct stat buf;
   int error_code = stat(map_file.c_str(), &buf);
   if (error_code == -1) {
@@ -143,8 +316,10 @@ bool SourceLineResolverBase::LoadModule(const CodeModule *module,
   if (module == NULL)
     return false;
 
+  const ModuleKey key(module);
+
   // Make sure we don't already have a module with the given name.
-  if (modules_->find(module->code_file()) != modules_->end()) {
+  if (modules_->find(key) != modules_->end()) {
     BPLOG(INFO) << "Symbols for module " << module->code_file()
                 << " already loaded";
     return false;
@@ -163,11 +338,20 @@ bool SourceLineResolverBase::LoadModule(const CodeModule *module,
 
   if (load_result && !ShouldDeleteMemoryBufferAfterLoadModule()) {
     // memory_buffer has to stay alive as long as the module.
-    memory_buffers_->insert(make_pair(module->code_file(), memory_buffer));
+    memory_buffers_->insert(make_pair(key, memory_buffer));
   } else {
     delete [] memory_buffer;
   }
 
+  if (load_result) {
+    struct stat buf;
+    uint64_t symbol_bytes = 0;
+    if (stat(map_file.c_str(), &buf) == 0) {
+      symbol_bytes = buf.st_size;
+    }
+    RecordModuleLoad(key, symbol_bytes);
+  }
+
   return load_result;
 }
 
@@ -176,8 +360,10 @@ bool SourceLineResolverBase::LoadModuleUsingMapBuffer(
   if (module == NULL)
     return false;
 
+  const ModuleKey key(module);
+
   // Make sure we don't already have a module with the given name.
-  if (modules_->find(module->code_file()) != modules_->end()) {
+  if (modules_->find(key) != modules_->end()) {
     BPLOG(INFO) << "Symbols for module " << module->code_file()
                 << " already loaded";
     return false;
@@ -197,11 +383,15 @@ bool SourceLineResolverBase::LoadModuleUsingMapBuffer(
 
   if (load_result && !ShouldDeleteMemoryBufferAfterLoadModule()) {
     // memory_buffer has to stay alive as long as the module.
-    memory_buffers_->insert(make_pair(module->code_file(), memory_buffer));
+    memory_buffers_->insert(make_pair(key, memory_buffer));
   } else {
     delete [] memory_buffer;
   }
 
+  if (load_result) {
+    RecordModuleLoad(key, map_buffer.size());
+  }
+
   return load_result;
 }
 
@@ -210,8 +400,10 @@ bool SourceLineResolverBase::LoadModuleUsingMemoryBuffer(
   if (!module)
     return false;
 
+  const ModuleKey key(module);
+
   // Make sure we don't already have a module with the given name.
-  if (modules_->find(module->code_file()) != modules_->end()) {
+  if (modules_->find(key) != modules_->end()) {
     BPLOG(INFO) << "Symbols for module " << module->code_file()
                 << " already loaded";
     return false;
@@ -221,6 +413,7 @@ bool SourceLineResolverBase::LoadModuleUsingMemoryBuffer(
              << " from memory buffer";
 
   Module *basic_module = module_factory_->CreateModule(module->code_file());
+  basic_module->set_load_source_lines(load_source_lines_);
 
   // Ownership of memory is NOT transfered to Module::LoadMapFromMemory().
   if (!basic_module->LoadMapFromMemory(memory_buffer)) {
@@ -228,10 +421,39 @@ bool SourceLineResolverBase::LoadModuleUsingMemoryBuffer(
     return false;
   }
 
-  modules_->insert(make_pair(module->code_file(), basic_module));
+  modules_->insert(make_pair(key, basic_module));
   return true;
 }
 
+bool SourceLineResolverBase::LoadModuleUsingSharedBuffer(
+    const CodeModule *module, SymbolDataBuffer *symbol_data) {
+  if (!module)
+    return false;
+
+  if (ShouldDeleteMemoryBufferAfterLoadModule()) {
+    // The parser modifies its input (see BasicSourceLineResolver), but
+    // a shared buffer is immutable, so work on a private copy.
+    return LoadModuleUsingMapBuffer(
+        module, string(symbol_data->data(), symbol_data->size()));
+  }
+
+  // The concrete resolver reads the buffer in place without modifying
+  // it and keeps pointers into it (see FastSourceLineResolver), so hold
+  // a reference instead of copying; the const_cast is safe because the
+  // bytes are never written.
+  bool load_result = LoadModuleUsingMemoryBuffer(
+      module, const_cast<char*>(symbol_data->data()));
+
+  if (load_result) {
+    const ModuleKey key(module);
+    symbol_data->AddRef();
+    shared_buffers_->insert(make_pair(key, symbol_data));
+    RecordModuleLoad(key, symbol_data->size());
+  }
+
+  return load_result;
+}
+
 bool SourceLineResolverBase::ShouldDeleteMemoryBufferAfterLoadModule() {
   return true;
 }
@@ -240,72 +462,139 @@ void SourceLineResolverBase::UnloadModule(const CodeModule *code_module) {
   if (!code_module)
     return;
 
-  ModuleMap::iterator mod_iter = modules_->find(code_module->code_file());
+  const ModuleKey key(code_module);
+
+  ModuleMap::iterator mod_iter = modules_->find(key);
   if (mod_iter != modules_->end()) {
     Module *symbol_module = mod_iter->second;
     delete symbol_module;
     modules_->erase(mod_iter);
   }
 
+  UsageMap::iterator size_iter = module_sizes_->find(key);
+  if (size_iter != module_sizes_->end()) {
+    loaded_bytes_ -= size_iter->second;
+    module_sizes_->erase(size_iter);
+  }
+  last_used_->erase(key);
+
   if (ShouldDeleteMemoryBufferAfterLoadModule()) {
     // No-op.  Because we never store any memory buffers.
   } else {
     // There may be a buffer stored locally, we need to find and delete it.
-    MemoryMap::iterator iter = memory_buffers_->find(code_module->code_file());
+    MemoryMap::iterator iter = memory_buffers_->find(key);
     if (iter != memory_buffers_->end()) {
       delete [] iter->second;
       memory_buffers_->erase(iter);
     }
+    // Or the module may have been backed by a shared buffer.
+    SharedBufferMap::iterator shared_iter = shared_buffers_->find(key);
+    if (shared_iter != shared_buffers_->end()) {
+      shared_iter->second->Release();
+      shared_buffers_->erase(shared_iter);
+    }
   }
 }
 
 bool SourceLineResolverBase::HasModule(const CodeModule *module) {
   if (!module)
     return false;
-  return modules_->find(module->code_file()) != modules_->end();
+  return modules_->find(ModuleKey(module)) != modules_->end();
 }
 
 void SourceLineResolverBase::FillSourceLineInfo(StackFrame *frame) {
   if (frame->module) {
-    ModuleMap::const_iterator it = modules_->find(frame->module->code_file());
+    ModuleMap::const_iterator it = modules_->find(ModuleKey(frame->module));
     if (it != modules_->end()) {
+      NoteModuleUsed(it->first);
       it->second->LookupAddress(frame);
     }
   }
 }
 
-WindowsFrameInfo *SourceLineResolverBase::FindWindowsFrameInfo(
-    const StackFrame *frame) {
-  if (frame->module) {
-    ModuleMap::const_iterator it = modules_->find(frame->module->code_file());
-    if (it != modules_->end()) {
-      return it->second->FindWindowsFrameInfo(frame);
+// Orders frames for FillSourceLineInfoBatch: group frames of the same
+// module together (module pointers within one dump's module list are
+// valid for comparison), and within a module, put addresses in
+// ascending order.
+static bool FrameAddressLessThan(const StackFrame *frame1,
+                                 const StackFrame *frame2) {
+  if (frame1->module != frame2->module)
+    return frame1->module < frame2->module;
+  return frame1->instruction < frame2->instruction;
+}
+
+void SourceLineResolverBase::FillSourceLineInfoBatch(
+    std::vector<StackFrame*> *frames) {
+  // Sort a copy of the frame list so that each module's symbols are
+  // located just once, and so that each module's addresses are resolved
+  // in ascending order: successive lookups then descend largely the
+  // same portions of the function and line structures, turning random
+  // probes into a cache-friendly sweep per module.  The caller's list
+  // keeps its original order.
+  std::vector<StackFrame*> sorted_frames(*frames);
+  std::sort(sorted_frames.begin(), sorted_frames.end(), FrameAddressLessThan);
+
+  const CodeModule *current_module = NULL;
+  Module *symbol_module = NULL;
+  for (size_t frame_index = 0;
+       frame_index < sorted_frames.size();
+       ++frame_index) {
+    StackFrame *frame = sorted_frames[frame_index];
+    if (!frame->module)
+      continue;
+    if (frame->module != current_module) {
+      current_module = frame->module;
+      symbol_module = NULL;
+      ModuleMap::const_iterator it =
+          modules_->find(ModuleKey(frame->module));
+      if (it != modules_->end()) {
+        NoteModuleUsed(it->first);
+        symbol_module = it->second;
+      }
     }
+    if (symbol_module)
+      symbol_module->LookupAddress(frame);
   }
-  return NULL;
 }
 
-CFIFrameInfo *SourceLineResolverBase::FindCFIFrameInfo(
-    const StackFrame *frame) {
+bool SourceLineResolverBase::FindWindowsFrameInfo(
+    const StackFrame *frame, WindowsFrameInfo *frame_info) {
   if (frame->module) {
-    ModuleMap::const_iterator it = modules_->find(frame->module->code_file());
+    ModuleMap::const_iterator it = modules_->find(ModuleKey(frame->module));
     if (it != modules_->end()) {
-      return it->second->FindCFIFrameInfo(frame);
+      NoteModuleUsed(it->first);
+      return it->second->FindWindowsFrameInfo(frame, frame_info);
     }
   }
-  return NULL;
+  return false;
 }
 
-bool SourceLineResolverBase::CompareString::operator()(
-    const string &s1, const string &s2) const {
-  return strcmp(s1.c_str(), s2.c_str()) < 0;
+bool SourceLineResolverBase::FindCFIFrameInfo(
+    const StackFrame *frame, CFIFrameInfo *frame_info) {
+  if (frame->module) {
+    ModuleMap::const_iterator it = modules_->find(ModuleKey(frame->module));
+    if (it != modules_->end()) {
+      NoteModuleUsed(it->first);
+      return it->second->FindCFIFrameInfo(frame, frame_info);
+    }
+  }
+  return false;
 }
 
 bool SourceLineResolverBase::Module::ParseCFIRuleSet(
     const string &rule_set, CFIFrameInfo *frame_info) const {
-  CFIFrameInfoParseHandler handler(frame_info);
+  CFIFrameInfoParseHandler handler(frame_info, &compiled_cfi_rules_);
   CFIRuleParser parser(&handler);
-  return parser.Parse(rule_set);
+  // The handler fills the shared compiled-rule memo, so concurrent
+  // lookups must take turns here; frame_info itself is caller-local.
+#ifndef _WIN32
+  pthread_mutex_lock(&memo_lock_);
+#endif
+  bool result = parser.Parse(rule_set);
+#ifndef _WIN32
+  pthread_mutex_unlock(&memo_lock_);
+#endif
+  return result;
 }
 
 }  // namespace google_breakpad
@@ -39,6 +39,9 @@
 // Author: Siyang Xie (lambxsy@google.com)
 
 #include <stdio.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #include <map>
 #include <string>
@@ -117,32 +120,63 @@ struct SourceLineResolverBase::PublicSymbol {
 
 class SourceLineResolverBase::Module {
  public:
-  virtual ~Module() { };
+  Module() {
+#ifndef _WIN32
+    pthread_mutex_init(&memo_lock_, NULL);
+#endif
+  }
+  virtual ~Module() {
+    for (CFIFrameInfo::RuleCache::iterator it = compiled_cfi_rules_.begin();
+         it != compiled_cfi_rules_.end(); ++it) {
+      delete it->second;
+    }
+#ifndef _WIN32
+    pthread_mutex_destroy(&memo_lock_);
+#endif
+  }
   // Loads a map from the given buffer in char* type.
   // Does NOT take ownership of memory_buffer (the caller, source line resolver,
   // is the owner of memory_buffer).
   virtual bool LoadMapFromMemory(char *memory_buffer) = 0;
 
+  // Tells the module whether LoadMapFromMemory should parse FILE and
+  // source line records.  Modules that don't parse symbol text ignore
+  // this.
+  virtual void set_load_source_lines(bool load_source_lines) { }
+
   // Looks up the given relative address, and fills the StackFrame struct
   // with the result.
   virtual void LookupAddress(StackFrame *frame) const = 0;
 
   // If Windows stack walking information is available covering ADDRESS,
-  // return a WindowsFrameInfo structure describing it. If the information
-  // is not available, returns NULL. A NULL return value does not indicate
-  // an error. The caller takes ownership of any returned WindowsFrameInfo
-  // object.
-  virtual WindowsFrameInfo *
-  FindWindowsFrameInfo(const StackFrame *frame) const = 0;
+  // fill *frame_info with it and return true. If the information is
+  // not available, return false, leaving *frame_info in an unspecified
+  // state; a false return does not indicate an error. The caller
+  // provides the structure, so one object can serve many lookups.
+  virtual bool FindWindowsFrameInfo(const StackFrame *frame,
+                                    WindowsFrameInfo *frame_info) const = 0;
 
   // If CFI stack walking information is available covering ADDRESS,
-  // return a CFIFrameInfo structure describing it. If the information
-  // is not available, return NULL. The caller takes ownership of any
-  // returned CFIFrameInfo object.
-  virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) const = 0;
+  // fill *frame_info with it and return true. If the information is
+  // not available, return false, leaving *frame_info in an unspecified
+  // state. The caller provides the structure, as above.
+  virtual bool FindCFIFrameInfo(const StackFrame *frame,
+                                CFIFrameInfo *frame_info) const = 0;
  protected:
   virtual bool ParseCFIRuleSet(const string &rule_set,
                                CFIFrameInfo *frame_info) const;
+
+  // Compiled CFI rule expressions, owned and shared by every
+  // CFIFrameInfo this module builds; each distinct expression is
+  // compiled once.  Filled lazily by ParseCFIRuleSet under memo_lock_.
+  mutable CFIFrameInfo::RuleCache compiled_cfi_rules_;
+
+#ifndef _WIN32
+  // Serializes the lazy fill of compiled_cfi_rules_, so that lookups on
+  // this module may otherwise run concurrently.  On Windows, where the
+  // processor has no concurrent callers, locking is omitted.
+  mutable pthread_mutex_t memo_lock_;
+#endif
 };
 
 }  // namespace google_breakpad
@@ -0,0 +1,164 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// stack_frame_arena.h: A chunked arena for StackFrame objects.
+//
+// Every frame produced during a stack walk was formerly an individual
+// heap allocation, freed one-by-one in CallStack::Clear.  With deep
+// stacks across many threads, the allocator traffic is significant.
+// StackFrameArena carves frame storage out of large chunks instead.
+// Frames constructed in the arena must have their destructors run
+// individually (StackFrame owns std::strings), but their storage is
+// reclaimed wholesale by FreeAll.
+
+#ifndef PROCESSOR_STACK_FRAME_ARENA_H__
+#define PROCESSOR_STACK_FRAME_ARENA_H__
+
+#include <stddef.h>
+
+#include <new>
+
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+class StackFrameArena {
+ public:
+  StackFrameArena() : chunks_(NULL) {}
+
+  ~StackFrameArena() { FreeAll(); }
+
+  // Returns size bytes of storage, carved out of the current chunk when
+  // possible.  The storage is aligned suitably for any StackFrame type
+  // and remains valid until FreeAll is called.
+  void* Allocate(size_t size) {
+    size = (size + kAlignment - 1) & ~(kAlignment - 1);
+    if (!chunks_ || chunks_->used + size > chunks_->capacity) {
+      size_t capacity = kChunkSize;
+      if (size > capacity) {
+        capacity = size;
+      }
+      Chunk* chunk =
+          static_cast<Chunk*>(operator new(sizeof(Chunk) + capacity));
+      chunk->next = chunks_;
+      chunk->used = 0;
+      chunk->capacity = capacity;
+      chunks_ = chunk;
+    }
+    void* result = reinterpret_cast<uint8_t*>(chunks_ + 1) + chunks_->used;
+    chunks_->used += size;
+    return result;
+  }
+
+  // Default-constructs a FrameType in the arena.  The caller is
+  // responsible for running the frame's destructor before FreeAll.
+  template<typename FrameType>
+  FrameType* New() {
+    return new (Allocate(sizeof(FrameType))) FrameType();
+  }
+
+  // Releases every chunk at once.  Objects constructed in the arena must
+  // already have been destroyed.
+  void FreeAll() {
+    while (chunks_) {
+      Chunk* chunk = chunks_;
+      chunks_ = chunk->next;
+      operator delete(chunk);
+    }
+  }
+
+ private:
+  // Chunk headers are followed immediately by their storage.  sizeof(Chunk)
+  // is a multiple of kAlignment, so carved-out storage stays aligned.
+  struct Chunk {
+    Chunk* next;
+    size_t used;
+    size_t capacity;
+  };
+
+  // StackFrame types contain nothing with stricter alignment than a
+  // uint64_t or a pointer.
+  static const size_t kAlignment = 8;
+
+  // The default capacity of a chunk, not counting its header.  Large
+  // enough for dozens of frames; oversized requests get a dedicated
+  // chunk.
+  static const size_t kChunkSize = 16384;
+
+  Chunk* chunks_;
+
+  // Disallow copy and assignment.
+  StackFrameArena(const StackFrameArena&);
+  void operator=(const StackFrameArena&);
+};
+
+// Scoped holder for an arena-allocated stack frame.  Works like
+// scoped_ptr, except that a frame still held at destruction has its
+// destructor run in place; its storage belongs to the arena and is
+// reclaimed by StackFrameArena::FreeAll.
+template<typename FrameType>
+class ScopedArenaFrame {
+ public:
+  explicit ScopedArenaFrame(FrameType* frame = NULL) : frame_(frame) {}
+
+  ~ScopedArenaFrame() {
+    if (frame_) {
+      frame_->~FrameType();
+    }
+  }
+
+  void reset(FrameType* frame) {
+    if (frame_ && frame_ != frame) {
+      frame_->~FrameType();
+    }
+    frame_ = frame;
+  }
+
+  FrameType* get() const { return frame_; }
+
+  FrameType* release() {
+    FrameType* frame = frame_;
+    frame_ = NULL;
+    return frame;
+  }
+
+  FrameType* operator->() const { return frame_; }
+  FrameType& operator*() const { return *frame_; }
+
+ private:
+  FrameType* frame_;
+
+  // Disallow copy and assignment.
+  ScopedArenaFrame(const ScopedArenaFrame&);
+  void operator=(const ScopedArenaFrame&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_STACK_FRAME_ARENA_H__
@@ -35,6 +35,9 @@
 #include "google_breakpad/processor/stack_frame_symbolizer.h"
 
 #include <assert.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
 
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/code_module.h"
@@ -48,65 +51,279 @@
 
 namespace google_breakpad {
 
+namespace {
+
+// Returns a monotonic-enough wall clock in microseconds for the load
+// timer; 0 where no cheap clock is available.
+uint64_t NowMicroseconds() {
+#ifndef _WIN32
+  struct timeval time_now;
+  gettimeofday(&time_now, NULL);
+  return static_cast<uint64_t>(time_now.tv_sec) * 1000000 + time_now.tv_usec;
+#else
+  return 0;
+#endif
+}
+
+// Advances *counter and returns the new value, without a lock where
+// atomic builtins are available; counters may be advanced while lock_
+// is held shared.
+uint64_t AtomicIncrement(uint64_t* counter) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __sync_add_and_fetch(counter, 1);
+#else
+  return ++*counter;
+#endif
+}
+
+// As AtomicIncrement, for adding an arbitrary amount.
+void AtomicAdd(uint64_t* counter, uint64_t amount) {
+#if defined(__GNUC__) || defined(__clang__)
+  __sync_add_and_fetch(counter, amount);
+#else
+  *counter += amount;
+#endif
+}
+
+// Adds the elapsed time of its scope to a counter on destruction.  Used
+// to meter FillSourceLineInfo, which has several return paths.
+class ScopedTimeAccumulator {
+ public:
+  explicit ScopedTimeAccumulator(uint64_t* total)
+      : total_(total), start_(NowMicroseconds()) {}
+  ~ScopedTimeAccumulator() {
+    if (start_) {
+      AtomicAdd(total_, NowMicroseconds() - start_);
+    }
+  }
+ private:
+  uint64_t* total_;
+  uint64_t start_;
+};
+
+}  // namespace
+
+#ifndef _WIN32
+namespace {
+
+// Scoped holders for StackFrameSymbolizer::lock_.  On Windows, where
+// the processor has no concurrent callers, locking is omitted entirely.
+class AutoReadLock {
+ public:
+  explicit AutoReadLock(pthread_rwlock_t* lock) : lock_(lock) {
+    pthread_rwlock_rdlock(lock_);
+  }
+  ~AutoReadLock() { pthread_rwlock_unlock(lock_); }
+ private:
+  pthread_rwlock_t* lock_;
+};
+
+class AutoWriteLock {
+ public:
+  explicit AutoWriteLock(pthread_rwlock_t* lock) : lock_(lock) {
+    pthread_rwlock_wrlock(lock_);
+  }
+  ~AutoWriteLock() { pthread_rwlock_unlock(lock_); }
+ private:
+  pthread_rwlock_t* lock_;
+};
+
+}  // namespace
+#endif  // _WIN32
+
 StackFrameSymbolizer::StackFrameSymbolizer(
     SymbolSupplier* supplier,
     SourceLineResolverInterface* resolver) : supplier_(supplier),
-                                             resolver_(resolver) { }
+                                             resolver_(resolver),
+                                             intern_pool_(NULL),
+                                             session_intern_pool_(NULL),
+                                             unwind_strategy_hints_(NULL),
+                                             resolve_source_lines_(true),
+                                             predictive_prefetch_(false) {
+#ifndef _WIN32
+  pthread_rwlock_init(&lock_, NULL);
+  pthread_mutex_init(&history_mutex_, NULL);
+  prefetch_thread_running_ = false;
+#endif
+}
+
+StackFrameSymbolizer::~StackFrameSymbolizer() {
+#ifndef _WIN32
+  JoinPrefetchWorker();
+  pthread_mutex_destroy(&history_mutex_);
+  pthread_rwlock_destroy(&lock_);
+#endif
+}
+
+void StackFrameSymbolizer::Reset() {
+#ifndef _WIN32
+  // A live prefetch worker would race the missing-symbol clear below
+  // and could load modules attributed to the wrong dump.
+  JoinPrefetchWorker();
+  pthread_mutex_lock(&history_mutex_);
+  // Fold the touched set of the dump just finished into the history:
+  // every touched module becomes a predictor of the others.
+  for (std::set<string>::const_iterator first = touched_this_dump_.begin();
+       first != touched_this_dump_.end(); ++first) {
+    std::set<string>& companions = companion_history_[*first];
+    for (std::set<string>::const_iterator second = touched_this_dump_.begin();
+         second != touched_this_dump_.end(); ++second) {
+      if (*second != *first)
+        companions.insert(*second);
+    }
+  }
+  touched_this_dump_.clear();
+  pthread_mutex_unlock(&history_mutex_);
+#endif
+  no_symbol_modules_.clear();
+}
+
+void StackFrameSymbolizer::PrefetchSymbolFiles(const CodeModules* modules,
+                                               const SystemInfo* system_info) {
+  if (supplier_ && modules) {
+    supplier_->PrefetchSymbolFiles(modules, system_info);
+  }
+}
+
+bool StackFrameSymbolizer::ResolveFromLoadedModule(
+    StackFrame* frame,
+    const CodeModule* module,
+    bool resolve_lines,
+    SymbolizerResult* symbolizer_result) {
+  // If module is known to have missing symbol file, return.
+  if (no_symbol_modules_.find(module->code_file()) !=
+      no_symbol_modules_.end()) {
+    AtomicIncrement(&stats_.module_misses);
+    *symbolizer_result = kError;
+    return true;
+  }
+
+  // If module is already loaded, go ahead to fill source line info and return.
+  if (resolver_->HasModule(frame->module)) {
+    AtomicIncrement(&stats_.module_hits);
+    if (resolve_lines)
+      resolver_->FillSourceLineInfo(frame);
+    *symbolizer_result = kNoError;
+    return true;
+  }
+
+  return false;
+}
 
 StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
     const CodeModules* modules,
     const SystemInfo* system_info,
     StackFrame* frame) {
+  return FillSourceLineInfoInternal(modules, system_info, frame,
+                                    resolve_source_lines_);
+}
+
+StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::LoadFrameSymbols(
+    const CodeModules* modules,
+    const SystemInfo* system_info,
+    StackFrame* frame) {
+  return FillSourceLineInfoInternal(modules, system_info, frame, false);
+}
+
+StackFrameSymbolizer::SymbolizerResult
+StackFrameSymbolizer::FillSourceLineInfoInternal(
+    const CodeModules* modules,
+    const SystemInfo* system_info,
+    StackFrame* frame,
+    bool resolve_lines) {
   assert(frame);
 
+  ScopedTimeAccumulator fill_timer(&stats_.fill_time_us);
+
+  // Let the resolver intern name strings instead of copying them into
+  // the frame.  The pool does its own locking.
+  frame->intern_pool =
+      session_intern_pool_ ? session_intern_pool_ : intern_pool_;
+
   if (!modules) return kError;
   const CodeModule* module = modules->GetModuleForAddress(frame->instruction);
   if (!module) return kError;
   frame->module = module;
 
   if (!resolver_) return kError;  // no resolver.
-  // If module is known to have missing symbol file, return.
-  if (no_symbol_modules_.find(module->code_file()) !=
-      no_symbol_modules_.end()) {
-    return kError;
-  }
 
-  // If module is already loaded, go ahead to fill source line info and return.
-  if (resolver_->HasModule(frame->module)) {
-    resolver_->FillSourceLineInfo(frame);
-    return kNoError;
+#ifndef _WIN32
+  if (predictive_prefetch_ && supplier_)
+    RecordModuleTouch(module, modules, system_info);
+#endif
+
+  SymbolizerResult result = kError;
+#ifndef _WIN32
+  if (resolver_->SupportsConcurrentLookups()) {
+    // Hot path: a module that is already loaded can be consulted under
+    // the shared lock, concurrently with other worker threads.
+    AutoReadLock read_lock(&lock_);
+    if (ResolveFromLoadedModule(frame, module, resolve_lines, &result))
+      return result;
   }
+  AutoWriteLock write_lock(&lock_);
+  // The module was not loaded when the shared lock was held, but
+  // another thread may have loaded it - or found its symbols missing -
+  // before the exclusive lock was granted, so check again.
+#endif
+  if (ResolveFromLoadedModule(frame, module, resolve_lines, &result))
+    return result;
 
   // Module needs to fetch symbol file. First check to see if supplier exists.
   if (!supplier_) {
     return kError;
   }
 
-  // Start fetching symbol from supplier.
+  // Start fetching symbol from supplier.  Prefer the shared-buffer path
+  // when the supplier offers it: one physical buffer then backs every
+  // resolver that keeps this module's symbol data, instead of each
+  // holding a private copy.
   string symbol_file;
   char* symbol_data = NULL;
-  SymbolSupplier::SymbolResult symbol_result = supplier_->GetCStringSymbolData(
-      module, system_info, &symbol_file, &symbol_data);
+  SymbolDataBuffer* shared_data = NULL;
+  bool use_shared_data = supplier_->SupportsSharedSymbolData();
+  uint64_t load_start = NowMicroseconds();
+  SymbolSupplier::SymbolResult symbol_result = use_shared_data ?
+      supplier_->GetSharedSymbolData(module, system_info, &symbol_file,
+                                     &shared_data) :
+      supplier_->GetCStringSymbolData(module, system_info, &symbol_file,
+                                      &symbol_data);
+  uint64_t fetch_end = NowMicroseconds();
+  stats_.fetch_time_us += fetch_end - load_start;
 
   switch (symbol_result) {
     case SymbolSupplier::FOUND: {
-      bool load_success = resolver_->LoadModuleUsingMemoryBuffer(frame->module,
-                                                                 symbol_data);
-      if (resolver_->ShouldDeleteMemoryBufferAfterLoadModule()) {
-        supplier_->FreeSymbolData(module);
+      bool load_success;
+      if (use_shared_data) {
+        load_success = resolver_->LoadModuleUsingSharedBuffer(frame->module,
+                                                              shared_data);
+        // The resolver took its own reference if it kept the buffer.
+        shared_data->Release();
+      } else {
+        load_success = resolver_->LoadModuleUsingMemoryBuffer(frame->module,
+                                                              symbol_data);
+        if (resolver_->ShouldDeleteMemoryBufferAfterLoadModule()) {
+          supplier_->FreeSymbolData(module);
+        }
       }
+      stats_.parse_time_us += NowMicroseconds() - fetch_end;
+      stats_.load_time_us += NowMicroseconds() - load_start;
 
       if (load_success) {
-        resolver_->FillSourceLineInfo(frame);
+        ++stats_.modules_loaded;
+        if (resolve_lines)
+          resolver_->FillSourceLineInfo(frame);
         return kNoError;
       } else {
         BPLOG(ERROR) << "Failed to load symbol file in resolver.";
+        ++stats_.module_misses;
         no_symbol_modules_.insert(module->code_file());
         return kError;
       }
     }
 
     case SymbolSupplier::NOT_FOUND:
+      ++stats_.module_misses;
       no_symbol_modules_.insert(module->code_file());
       return kError;
 
@@ -120,14 +337,215 @@ StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
   return kError;
 }
 
-WindowsFrameInfo* StackFrameSymbolizer::FindWindowsFrameInfo(
-    const StackFrame* frame) {
-  return resolver_ ? resolver_->FindWindowsFrameInfo(frame) : NULL;
+#ifndef _WIN32
+namespace {
+
+// Everything the predictive prefetch worker needs, copied so the job
+// depends on nothing owned by the dump that spawned it.
+struct PredictedPrefetchJob {
+  PredictedPrefetchJob() : symbolizer(NULL) {}
+  ~PredictedPrefetchJob() {
+    for (size_t i = 0; i < modules.size(); ++i)
+      delete modules[i];
+  }
+  StackFrameSymbolizer* symbolizer;
+  std::vector<const CodeModule*> modules;  // owned copies
+  SystemInfo system_info;
+};
+
+}  // namespace
+
+void StackFrameSymbolizer::RecordModuleTouch(const CodeModule* module,
+                                             const CodeModules* modules,
+                                             const SystemInfo* system_info) {
+  bool first_touch;
+  std::set<string> predicted;
+  pthread_mutex_lock(&history_mutex_);
+  first_touch = touched_this_dump_.empty();
+  touched_this_dump_.insert(module->code_file());
+  if (first_touch) {
+    std::map<string, std::set<string> >::const_iterator history =
+        companion_history_.find(module->code_file());
+    if (history != companion_history_.end())
+      predicted = history->second;
+  }
+  pthread_mutex_unlock(&history_mutex_);
+
+  // Only the touch that found the set empty spawns the worker, so one
+  // dump starts at most one, even when walker threads race here.
+  if (!first_touch || predicted.empty())
+    return;
+
+  // The previous dump's worker was joined at Reset(); this is only a
+  // safety net against callers that skip Reset() between dumps.
+  JoinPrefetchWorker();
+
+  scoped_ptr<PredictedPrefetchJob> job(new PredictedPrefetchJob);
+  job->symbolizer = this;
+  if (system_info)
+    job->system_info = *system_info;
+  for (unsigned int i = 0; i < modules->module_count(); ++i) {
+    const CodeModule* candidate = modules->GetModuleAtIndex(i);
+    if (candidate && candidate != module &&
+        predicted.find(candidate->code_file()) != predicted.end()) {
+      job->modules.push_back(candidate->Copy());
+    }
+  }
+  if (job->modules.empty())
+    return;
+
+  if (pthread_create(&prefetch_thread_, NULL, PredictivePrefetchWorker,
+                     job.get()) == 0) {
+    prefetch_thread_running_ = true;
+    job.release();
+  }
 }
 
-CFIFrameInfo* StackFrameSymbolizer::FindCFIFrameInfo(
-    const StackFrame* frame) {
-  return resolver_ ? resolver_->FindCFIFrameInfo(frame) : NULL;
+// static
+void* StackFrameSymbolizer::PredictivePrefetchWorker(void* arg) {
+  scoped_ptr<PredictedPrefetchJob> job(
+      reinterpret_cast<PredictedPrefetchJob*>(arg));
+  for (size_t i = 0; i < job->modules.size(); ++i)
+    job->symbolizer->PrefetchOneModule(job->modules[i], &job->system_info);
+  return NULL;
+}
+
+void StackFrameSymbolizer::PrefetchOneModule(const CodeModule* module,
+                                             const SystemInfo* system_info) {
+  {
+    // Skip modules a frame has already faulted in or found missing.
+    AutoWriteLock check_lock(&lock_);
+    if (no_symbol_modules_.find(module->code_file()) !=
+            no_symbol_modules_.end() ||
+        resolver_->HasModule(module)) {
+      return;
+    }
+  }
+
+  // Fetch outside lock_, so walkers resolving frames from loaded
+  // modules are not blocked behind the prefetch I/O.  A frame touching
+  // this module meanwhile fetches it too; the load below detects that
+  // and discards this copy.
+  string symbol_file;
+  char* symbol_data = NULL;
+  SymbolDataBuffer* shared_data = NULL;
+  bool use_shared_data = supplier_->SupportsSharedSymbolData();
+  uint64_t load_start = NowMicroseconds();
+  SymbolSupplier::SymbolResult symbol_result = use_shared_data ?
+      supplier_->GetSharedSymbolData(module, system_info, &symbol_file,
+                                     &shared_data) :
+      supplier_->GetCStringSymbolData(module, system_info, &symbol_file,
+                                      &symbol_data);
+  uint64_t fetch_end = NowMicroseconds();
+
+  AutoWriteLock write_lock(&lock_);
+  stats_.fetch_time_us += fetch_end - load_start;
+
+  if (symbol_result != SymbolSupplier::FOUND) {
+    // Memoize a definite miss so frames skip their own fetch; INTERRUPT
+    // is left for the walker's own fetch to see.  module_misses counts
+    // frame fills, so it does not move here.
+    if (symbol_result == SymbolSupplier::NOT_FOUND)
+      no_symbol_modules_.insert(module->code_file());
+    return;
+  }
+
+  if (resolver_->HasModule(module)) {
+    // A frame won the race during the fetch; drop this copy.
+    if (use_shared_data) {
+      shared_data->Release();
+    } else {
+      supplier_->FreeSymbolData(module);
+    }
+    return;
+  }
+
+  bool load_success;
+  if (use_shared_data) {
+    load_success = resolver_->LoadModuleUsingSharedBuffer(module, shared_data);
+    shared_data->Release();
+  } else {
+    load_success = resolver_->LoadModuleUsingMemoryBuffer(module, symbol_data);
+    if (resolver_->ShouldDeleteMemoryBufferAfterLoadModule()) {
+      supplier_->FreeSymbolData(module);
+    }
+  }
+  stats_.parse_time_us += NowMicroseconds() - fetch_end;
+  stats_.load_time_us += NowMicroseconds() - load_start;
+
+  if (load_success) {
+    ++stats_.modules_loaded;
+  } else {
+    BPLOG(ERROR) << "Failed to load prefetched symbol file in resolver.";
+    no_symbol_modules_.insert(module->code_file());
+  }
+}
+
+void StackFrameSymbolizer::JoinPrefetchWorker() {
+  if (prefetch_thread_running_) {
+    pthread_join(prefetch_thread_, NULL);
+    prefetch_thread_running_ = false;
+  }
+}
+#endif  // _WIN32
+
+void StackFrameSymbolizer::FillSourceLineInfoBatch(
+    std::vector<StackFrame*>* frames) {
+  if (!resolver_ || !frames || frames->empty()) return;
+
+  ScopedTimeAccumulator fill_timer(&stats_.fill_time_us);
+
+  // As in FillSourceLineInfo, let the resolver intern name strings
+  // instead of copying them into each frame.
+  StringInternPool* intern_pool =
+      session_intern_pool_ ? session_intern_pool_ : intern_pool_;
+  for (size_t frame_index = 0; frame_index < frames->size(); ++frame_index)
+    (*frames)[frame_index]->intern_pool = intern_pool;
+
+#ifndef _WIN32
+  if (resolver_->SupportsConcurrentLookups()) {
+    AutoReadLock read_lock(&lock_);
+    resolver_->FillSourceLineInfoBatch(frames);
+    return;
+  }
+  AutoWriteLock write_lock(&lock_);
+#endif
+  resolver_->FillSourceLineInfoBatch(frames);
+}
+
+StackFrameSymbolizer::SessionStats StackFrameSymbolizer::session_stats() {
+#ifndef _WIN32
+  // The exclusive side keeps the snapshot consistent with in-flight
+  // atomic increments on the shared side.
+  AutoWriteLock write_lock(&lock_);
+#endif
+  return stats_;
+}
+
+bool StackFrameSymbolizer::FindWindowsFrameInfo(
+    const StackFrame* frame, WindowsFrameInfo* frame_info) {
+  if (!resolver_) return false;
+#ifndef _WIN32
+  if (resolver_->SupportsConcurrentLookups()) {
+    AutoReadLock read_lock(&lock_);
+    return resolver_->FindWindowsFrameInfo(frame, frame_info);
+  }
+  AutoWriteLock write_lock(&lock_);
+#endif
+  return resolver_->FindWindowsFrameInfo(frame, frame_info);
+}
+
+bool StackFrameSymbolizer::FindCFIFrameInfo(
+    const StackFrame* frame, CFIFrameInfo* frame_info) {
+  if (!resolver_) return false;
+#ifndef _WIN32
+  if (resolver_->SupportsConcurrentLookups()) {
+    AutoReadLock read_lock(&lock_);
+    return resolver_->FindCFIFrameInfo(frame, frame_info);
+  }
+  AutoWriteLock write_lock(&lock_);
+#endif
+  return resolver_->FindCFIFrameInfo(frame, frame_info);
 }
 
 }  // namespace google_breakpad
@@ -36,6 +36,16 @@
 #include "google_breakpad/processor/stackwalker.h"
 
 #include <assert.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_2__
+#include <smmintrin.h>
+#endif
 
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/call_stack.h"
@@ -47,6 +57,7 @@
 #include "google_breakpad/processor/system_info.h"
 #include "processor/linked_ptr.h"
 #include "processor/logging.h"
+#include "processor/stack_frame_arena.h"
 #include "processor/stackwalker_ppc.h"
 #include "processor/stackwalker_sparc.h"
 #include "processor/stackwalker_x86.h"
@@ -55,9 +66,136 @@
 
 namespace google_breakpad {
 
+namespace {
+
+// Returns the wall clock in microseconds for deadline checks; 0 where
+// no cheap clock is available, which disables deadlines.
+uint64_t NowMicroseconds() {
+#ifndef _WIN32
+  struct timeval time_now;
+  gettimeofday(&time_now, NULL);
+  return static_cast<uint64_t>(time_now.tv_sec) * 1000000 + time_now.tv_usec;
+#else
+  return 0;
+#endif
+}
+
+}  // namespace
+
 const int Stackwalker::kRASearchWords = 30;
 uint32_t Stackwalker::max_frames_ = 1024;
 
+// How many CFI or scan outcomes a module must accumulate before its scan
+// window departs from the default, and the factor by which the window
+// narrows or widens once it does.
+static const uint64_t kScanTelemetryMinSamples = 8;
+static const int kScanWindowFactor = 4;
+
+StackScanTelemetry::StackScanTelemetry() {
+#ifndef _WIN32
+  pthread_mutex_init(&lock_, NULL);
+#endif
+}
+
+StackScanTelemetry::~StackScanTelemetry() {
+#ifndef _WIN32
+  pthread_mutex_destroy(&lock_);
+#endif
+}
+
+StackScanTelemetry::ModuleStats* StackScanTelemetry::StatsForModule(
+    const CodeModule* module) {
+  const string &code_file = module->code_file();
+  StatsMap::iterator it = stats_.find(code_file);
+  if (it == stats_.end()) {
+    it = stats_.insert(std::make_pair(code_file, ModuleStats())).first;
+    it->second.code_file = code_file;
+  }
+  return &it->second;
+}
+
+void StackScanTelemetry::RecordCFIResult(const CodeModule* module, bool hit) {
+  if (!module)
+    return;
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  ModuleStats* stats = StatsForModule(module);
+  if (hit) {
+    ++stats->cfi_hits;
+  } else {
+    ++stats->cfi_misses;
+  }
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+}
+
+void StackScanTelemetry::RecordScanResult(const CodeModule* module,
+                                          bool success) {
+  if (!module)
+    return;
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  ModuleStats* stats = StatsForModule(module);
+  ++stats->scan_attempts;
+  if (success)
+    ++stats->scan_successes;
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+}
+
+int StackScanTelemetry::ScanWindow(const CodeModule* module,
+                                   int default_words) {
+  if (!module)
+    return default_words;
+
+  int window = default_words;
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  ModuleStats* stats = StatsForModule(module);
+  uint64_t samples = stats->cfi_hits + stats->cfi_misses +
+                     stats->scan_attempts;
+  if (samples >= kScanTelemetryMinSamples) {
+    if (stats->scan_attempts >= kScanTelemetryMinSamples &&
+        stats->scan_successes * 2 >= stats->scan_attempts) {
+      // Scans below this module's frames usually find the caller; give
+      // them room.  set_scan_word_limit still caps the examined depth.
+      window = default_words * kScanWindowFactor;
+    } else if (stats->cfi_hits >= stats->cfi_misses * 2 &&
+               stats->scan_successes * 2 < stats->scan_attempts) {
+      // CFI carries this module and scanning rarely helps; when a scan
+      // does run here it is almost always walking garbage, so keep it
+      // shallow.
+      window = default_words / kScanWindowFactor;
+      if (window < 1)
+        window = 1;
+    }
+  }
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+  return window;
+}
+
+void StackScanTelemetry::GetStats(vector<ModuleStats>* stats) {
+  stats->clear();
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  for (StatsMap::const_iterator it = stats_.begin();
+       it != stats_.end();
+       ++it) {
+    stats->push_back(it->second);
+  }
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+}
+
 Stackwalker::Stackwalker(const SystemInfo* system_info,
                          MemoryRegion* memory,
                          const CodeModules* modules,
@@ -65,8 +203,111 @@ Stackwalker::Stackwalker(const SystemInfo* system_info,
     : system_info_(system_info),
       memory_(memory),
       modules_(modules),
-      frame_symbolizer_(frame_symbolizer) {
+      modules_lowest_address_(0),
+      modules_highest_address_(0),
+      scan_word_limit_(0),
+      walk_deadline_us_(0),
+      scan_telemetry_(NULL),
+      instruction_memory_(NULL),
+      prologue_layout_cache_(NULL),
+      walk_truncated_(false),
+      defer_source_lines_(false),
+      frame_symbolizer_(frame_symbolizer),
+      frame_arena_(NULL) {
   assert(frame_symbolizer_);
+
+  // Cache the overall address range spanned by the module list.  Scanned
+  // stack words outside this range cannot be instruction pointers and are
+  // rejected without consulting the module map.
+  if (modules_ && modules_->module_count() > 0) {
+    uint64_t lowest = static_cast<uint64_t>(-1);
+    uint64_t highest = 0;
+    for (unsigned int sequence = 0;
+         sequence < modules_->module_count();
+         ++sequence) {
+      const CodeModule* module = modules_->GetModuleAtSequence(sequence);
+      if (!module)
+        continue;
+      if (module->base_address() < lowest)
+        lowest = module->base_address();
+      if (module->base_address() + module->size() > highest)
+        highest = module->base_address() + module->size();
+    }
+    if (lowest < highest) {
+      modules_lowest_address_ = lowest;
+      modules_highest_address_ = highest;
+    }
+  }
+}
+
+
+// static
+unsigned int Stackwalker::WordsInRange(const uint32_t* words, int count,
+                                       uint64_t low, uint64_t high) {
+  if (low >= high || low > static_cast<uint64_t>(0xffffffffu))
+    return 0;
+  uint32_t low32 = static_cast<uint32_t>(low);
+  // An inclusive upper bound keeps the comparison within 32 bits.
+  uint32_t high32 = high > static_cast<uint64_t>(0xffffffffu) ?
+      0xffffffffu : static_cast<uint32_t>(high - 1);
+
+  unsigned int mask = 0;
+  int index = 0;
+#ifdef __SSE2__
+  // SSE2 compares are signed, so bias words and bounds by 2^31.
+  const __m128i bias = _mm_set1_epi32(static_cast<int32_t>(0x80000000u));
+  const __m128i vlow =
+      _mm_set1_epi32(static_cast<int32_t>(low32 ^ 0x80000000u));
+  const __m128i vhigh =
+      _mm_set1_epi32(static_cast<int32_t>(high32 ^ 0x80000000u));
+  for (; index + 4 <= count; index += 4) {
+    __m128i vwords = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + index)),
+        bias);
+    __m128i out_of_range = _mm_or_si128(_mm_cmplt_epi32(vwords, vlow),
+                                        _mm_cmpgt_epi32(vwords, vhigh));
+    unsigned int out_bits = _mm_movemask_ps(_mm_castsi128_ps(out_of_range));
+    mask |= (~out_bits & 0xfu) << index;
+  }
+#endif  // __SSE2__
+  for (; index < count; ++index) {
+    if (words[index] >= low32 && words[index] <= high32)
+      mask |= 1u << index;
+  }
+  return mask;
+}
+
+
+// static
+unsigned int Stackwalker::WordsInRange(const uint64_t* words, int count,
+                                       uint64_t low, uint64_t high) {
+  if (low >= high)
+    return 0;
+  uint64_t high_inclusive = high - 1;
+
+  unsigned int mask = 0;
+  int index = 0;
+#ifdef __SSE4_2__
+  // 64-bit packed compares need SSE4.2; they are signed, so bias words
+  // and bounds by 2^63.
+  const __m128i bias = _mm_set1_epi64x(static_cast<int64_t>(1) << 63);
+  const __m128i vlow = _mm_xor_si128(_mm_set1_epi64x(low), bias);
+  const __m128i vhigh = _mm_xor_si128(_mm_set1_epi64x(high_inclusive), bias);
+  for (; index + 2 <= count; index += 2) {
+    __m128i vwords = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + index)),
+        bias);
+    __m128i out_of_range = _mm_or_si128(_mm_cmpgt_epi64(vlow, vwords),
+                                        _mm_cmpgt_epi64(vwords, vhigh));
+    unsigned int out_bits = _mm_movemask_pd(_mm_castsi128_pd(out_of_range));
+    mask |= (~out_bits & 0x3u) << index;
+  }
+#endif  // __SSE4_2__
+  for (; index < count; ++index) {
+    if (words[index] >= low && words[index] <= high_inclusive)
+      mask |= 1u << index;
+  }
+  return mask;
 }
 
 
@@ -80,21 +321,34 @@ bool Stackwalker::Walk(CallStack* stack,
                                             << "|modules_without_symbols|";
   assert(modules_without_symbols);
 
+  walk_truncated_ = false;
+
+  // Frames are allocated from the CallStack's arena for the duration of
+  // this walk.
+  frame_arena_ = stack->arena();
+
   // Begin with the context frame, and keep getting callers until there are
   // no more.
 
-  // Take ownership of the pointer returned by GetContextFrame.
-  scoped_ptr<StackFrame> frame(GetContextFrame());
+  // Take ownership of the pointer returned by GetContextFrame.  A frame
+  // abandoned by the holder is destroyed in place; its storage belongs to
+  // the arena.
+  ScopedArenaFrame<StackFrame> frame(GetContextFrame());
 
   while (frame.get()) {
     // frame already contains a good frame with properly set instruction and
     // frame_pointer fields.  The frame structure comes from either the
     // context frame (above) or a caller frame (below).
 
-    // Resolve the module information, if a module map was provided.
+    // Resolve the module information, if a module map was provided.  In
+    // deferred mode only the module's symbols are loaded; the frame's
+    // names and lines are filled by a batch pass after the walk.
     StackFrameSymbolizer::SymbolizerResult symbolizer_result =
-        frame_symbolizer_->FillSourceLineInfo(modules_, system_info_,
-                                             frame.get());
+        defer_source_lines_ ?
+            frame_symbolizer_->LoadFrameSymbols(modules_, system_info_,
+                                                frame.get()) :
+            frame_symbolizer_->FillSourceLineInfo(modules_, system_info_,
+                                                  frame.get());
     if (symbolizer_result == StackFrameSymbolizer::kInterrupt) {
       BPLOG(INFO) << "Stack walk is interrupted.";
       return false;
@@ -126,6 +380,18 @@ bool Stackwalker::Walk(CallStack* stack,
     stack->frames_.push_back(frame.release());
     if (stack->frames_.size() > max_frames_) {
       BPLOG(ERROR) << "The stack is over " << max_frames_ << " frames.";
+      walk_truncated_ = true;
+      break;
+    }
+
+    // A walk past its deadline keeps what it has; the caller reports
+    // the stack as truncated rather than letting a pathological thread
+    // pin the worker.  The context frame is always included, since the
+    // first check happens after it is pushed.
+    if (walk_deadline_us_ && NowMicroseconds() >= walk_deadline_us_) {
+      BPLOG(INFO) << "Deadline reached after " << stack->frames_.size() <<
+          " frames; truncating walk.";
+      walk_truncated_ = true;
       break;
     }
 
@@ -217,7 +483,7 @@ bool Stackwalker::InstructionAddressSeemsValid(uint64_t address) {
     return true;
   }
 
-  return !frame.function_name.empty();
+  return frame.function_name && !frame.function_name->empty();
 }
 
 }  // namespace google_breakpad
@@ -42,6 +42,7 @@
 #include "google_breakpad/processor/stack_frame_cpu.h"
 #include "processor/cfi_frame_info.h"
 #include "processor/logging.h"
+#include "processor/stack_frame_arena.h"
 #include "processor/stackwalker_amd64.h"
 
 namespace google_breakpad {
@@ -113,7 +114,7 @@ StackFrame* StackwalkerAMD64::GetContextFrame() {
     return NULL;
   }
 
-  StackFrameAMD64* frame = new StackFrameAMD64();
+  StackFrameAMD64* frame = frame_arena_->New<StackFrameAMD64>();
 
   // The instruction pointer is stored directly in a register, so pull it
   // straight out of the CPU context structure.
@@ -130,7 +131,7 @@ StackFrameAMD64* StackwalkerAMD64::GetCallerByCFIFrameInfo(
     CFIFrameInfo* cfi_frame_info) {
   StackFrameAMD64* last_frame = static_cast<StackFrameAMD64*>(frames.back());
 
-  scoped_ptr<StackFrameAMD64> frame(new StackFrameAMD64());
+  ScopedArenaFrame<StackFrameAMD64> frame(frame_arena_->New<StackFrameAMD64>());
   if (!cfi_walker_
       .FindCallerRegisters(*memory_, *cfi_frame_info,
                            last_frame->context, last_frame->context_validity,
@@ -148,19 +149,20 @@ StackFrameAMD64* StackwalkerAMD64::GetCallerByCFIFrameInfo(
 }
 
 StackFrameAMD64* StackwalkerAMD64::GetCallerByStackScan(
-    const vector<StackFrame*> &frames) {
+    const vector<StackFrame*> &frames, int search_words) {
   StackFrameAMD64* last_frame = static_cast<StackFrameAMD64*>(frames.back());
   uint64_t last_rsp = last_frame->context.rsp;
   uint64_t caller_rip_address, caller_rip;
 
-  if (!ScanForReturnAddress(last_rsp, &caller_rip_address, &caller_rip)) {
+  if (!ScanForReturnAddress(last_rsp, &caller_rip_address, &caller_rip,
+                            search_words)) {
     // No plausible return address was found.
     return NULL;
   }
 
   // Create a new stack frame (ownership will be transferred to the caller)
   // and fill it in.
-  StackFrameAMD64* frame = new StackFrameAMD64();
+  StackFrameAMD64* frame = frame_arena_->New<StackFrameAMD64>();
 
   frame->trust = StackFrame::FRAME_TRUST_SCAN;
   frame->context = last_frame->context;
@@ -204,18 +206,34 @@ StackFrame* StackwalkerAMD64::GetCallerFrame(const CallStack* stack) {
 
   const vector<StackFrame*> &frames = *stack->frames();
   StackFrameAMD64* last_frame = static_cast<StackFrameAMD64*>(frames.back());
-  scoped_ptr<StackFrameAMD64> new_frame;
-
-  // If we have DWARF CFI information, use it.
-  scoped_ptr<CFIFrameInfo> cfi_frame_info(
-      frame_symbolizer_->FindCFIFrameInfo(last_frame));
-  if (cfi_frame_info.get())
-    new_frame.reset(GetCallerByCFIFrameInfo(frames, cfi_frame_info.get()));
-
-  // If CFI failed, or there wasn't CFI available, fall back
-  // to stack scanning.
+  ScopedArenaFrame<StackFrameAMD64> new_frame;
+
+  // If we have DWARF CFI information, use it.  The rule set lives on
+  // the stack; the resolver fills it in place, so no frame info object
+  // is allocated per frame.
+  CFIFrameInfo cfi_frame_info;
+  if (frame_symbolizer_->FindCFIFrameInfo(last_frame, &cfi_frame_info))
+    new_frame.reset(GetCallerByCFIFrameInfo(frames, &cfi_frame_info));
+
+  // Let the session's telemetry see whether CFI carried this module's
+  // frame; a missing CFI entry counts as a miss, since it forces the
+  // scan below just the same as a failed CFI walk.
+  if (scan_telemetry_)
+    scan_telemetry_->RecordCFIResult(last_frame->module,
+                                     new_frame.get() != NULL);
+
+  // If CFI failed, or there wasn't CFI available, fall back to stack
+  // scanning, over a window sized by how this module's frames have
+  // unwound so far in this session.
   if (!new_frame.get()) {
-    new_frame.reset(GetCallerByStackScan(frames));
+    int search_words = kRASearchWords;
+    if (scan_telemetry_)
+      search_words = scan_telemetry_->ScanWindow(last_frame->module,
+                                                 kRASearchWords);
+    new_frame.reset(GetCallerByStackScan(frames, search_words));
+    if (scan_telemetry_)
+      scan_telemetry_->RecordScanResult(last_frame->module,
+                                        new_frame.get() != NULL);
   }
 
   // If nothing worked, tell the caller.
@@ -77,9 +77,11 @@ class StackwalkerAMD64 : public Stackwalker {
   StackFrameAMD64* GetCallerByCFIFrameInfo(const vector<StackFrame*> &frames,
                                            CFIFrameInfo* cfi_frame_info);
 
-  // Scan the stack for plausible return addresses. The caller takes ownership
-  // of the returned frame. Return NULL on failure.
-  StackFrameAMD64* GetCallerByStackScan(const vector<StackFrame*> &frames);
+  // Scan up to search_words words of the stack for plausible return
+  // addresses. The caller takes ownership of the returned frame. Return
+  // NULL on failure.
+  StackFrameAMD64* GetCallerByStackScan(const vector<StackFrame*> &frames,
+                                        int search_words);
 
   // Stores the CPU context corresponding to the innermost stack frame to
   // be returned by GetContextFrame.
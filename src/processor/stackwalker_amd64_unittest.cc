@@ -328,7 +328,8 @@ TEST_F(GetCallerFrame, ScanWithFunctionSymbols) {
   StackFrameAMD64 *frame0 = static_cast<StackFrameAMD64 *>(frames->at(0));
   EXPECT_EQ(StackFrame::FRAME_TRUST_CONTEXT, frame0->trust);
   ASSERT_EQ(StackFrameAMD64::CONTEXT_VALID_ALL, frame0->context_validity);
-  EXPECT_EQ("platypus", frame0->function_name);
+  ASSERT_TRUE(frame0->function_name);
+  EXPECT_EQ("platypus", *frame0->function_name);
   EXPECT_EQ(0x40000000c0000100ULL, frame0->function_base);
 
   StackFrameAMD64 *frame1 = static_cast<StackFrameAMD64 *>(frames->at(1));
@@ -340,7 +341,8 @@ TEST_F(GetCallerFrame, ScanWithFunctionSymbols) {
   EXPECT_EQ(return_address, frame1->context.rip);
   EXPECT_EQ(frame1_sp.Value(), frame1->context.rsp);
   EXPECT_EQ(frame1_rbp.Value(), frame1->context.rbp);
-  EXPECT_EQ("echidna", frame1->function_name);
+  ASSERT_TRUE(frame1->function_name);
+  EXPECT_EQ("echidna", *frame1->function_name);
   EXPECT_EQ(0x50000000b0000100ULL, frame1->function_base);
 }
 
@@ -396,7 +398,8 @@ TEST_F(GetCallerFrame, CallerPushedRBP) {
   EXPECT_EQ(StackFrame::FRAME_TRUST_CONTEXT, frame0->trust);
   ASSERT_EQ(StackFrameAMD64::CONTEXT_VALID_ALL, frame0->context_validity);
   EXPECT_EQ(frame0_rbp.Value(), frame0->context.rbp);
-  EXPECT_EQ("sasquatch", frame0->function_name);
+  ASSERT_TRUE(frame0->function_name);
+  EXPECT_EQ("sasquatch", *frame0->function_name);
   EXPECT_EQ(0x40000000c0000100ULL, frame0->function_base);
 
   StackFrameAMD64 *frame1 = static_cast<StackFrameAMD64 *>(frames->at(1));
@@ -408,7 +411,8 @@ TEST_F(GetCallerFrame, CallerPushedRBP) {
   EXPECT_EQ(return_address, frame1->context.rip);
   EXPECT_EQ(frame1_sp.Value(), frame1->context.rsp);
   EXPECT_EQ(frame1_rbp.Value(), frame1->context.rbp);
-  EXPECT_EQ("yeti", frame1->function_name);
+  ASSERT_TRUE(frame1->function_name);
+  EXPECT_EQ("yeti", *frame1->function_name);
   EXPECT_EQ(0x50000000b0000100ULL, frame1->function_base);
 }
 
@@ -473,7 +477,8 @@ struct CFIFixture: public StackwalkerAMD64Fixture {
     StackFrameAMD64 *frame0 = static_cast<StackFrameAMD64 *>(frames->at(0));
     EXPECT_EQ(StackFrame::FRAME_TRUST_CONTEXT, frame0->trust);
     ASSERT_EQ(StackFrameAMD64::CONTEXT_VALID_ALL, frame0->context_validity);
-    EXPECT_EQ("enchiridion", frame0->function_name);
+    ASSERT_TRUE(frame0->function_name);
+    EXPECT_EQ("enchiridion", *frame0->function_name);
     EXPECT_EQ(0x40000000c0004000ULL, frame0->function_base);
 
     StackFrameAMD64 *frame1 = static_cast<StackFrameAMD64 *>(frames->at(1));
@@ -495,7 +500,8 @@ struct CFIFixture: public StackwalkerAMD64Fixture {
     EXPECT_EQ(expected.r13, frame1->context.r13);
     EXPECT_EQ(expected.r14, frame1->context.r14);
     EXPECT_EQ(expected.r15, frame1->context.r15);
-    EXPECT_EQ("epictetus", frame1->function_name);
+    ASSERT_TRUE(frame1->function_name);
+    EXPECT_EQ("epictetus", *frame1->function_name);
   }
 
   // The values we expect to find for the caller's registers.
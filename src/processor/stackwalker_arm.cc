@@ -38,14 +38,67 @@
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/call_stack.h"
 #include "google_breakpad/processor/memory_region.h"
+#include "google_breakpad/processor/minidump.h"
 #include "google_breakpad/processor/source_line_resolver_interface.h"
 #include "google_breakpad/processor/stack_frame_cpu.h"
 #include "processor/cfi_frame_info.h"
 #include "processor/logging.h"
+#include "processor/stack_frame_arena.h"
 #include "processor/stackwalker_arm.h"
 
 namespace google_breakpad {
 
+// How far GetCallerByPrologueAnalysis will scan backwards from the
+// program counter looking for a function's opening push {..., lr} when
+// symbols did not provide the entry address.  Minidumps capture only a
+// small window of code around each thread's program counter, so reads
+// past the captured region stop the scan well before this limit.
+static const uint32_t kMaxEntryScanBytes = 1024;
+
+// The longest instruction sequence GetCallerByPrologueAnalysis will
+// decode at a function's entry.  Prologues that interleave other work
+// beyond this point are abandoned in favor of stack scanning.
+static const int kMaxPrologueInstructions = 16;
+
+PrologueLayoutCache::PrologueLayoutCache() {
+#ifndef _WIN32
+  pthread_mutex_init(&lock_, NULL);
+#endif
+}
+
+PrologueLayoutCache::~PrologueLayoutCache() {
+#ifndef _WIN32
+  pthread_mutex_destroy(&lock_);
+#endif
+}
+
+bool PrologueLayoutCache::Lookup(uint64_t entry_address,
+                                 PrologueFrameLayout* layout) {
+  bool found = false;
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  LayoutMap::const_iterator iterator = layouts_.find(entry_address);
+  if (iterator != layouts_.end()) {
+    *layout = iterator->second;
+    found = true;
+  }
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+  return found;
+}
+
+void PrologueLayoutCache::Store(uint64_t entry_address,
+                                const PrologueFrameLayout& layout) {
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  layouts_[entry_address] = layout;
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+}
 
 StackwalkerARM::StackwalkerARM(const SystemInfo* system_info,
                                const MDRawContextARM* context,
@@ -64,7 +117,7 @@ StackFrame* StackwalkerARM::GetContextFrame() {
     return NULL;
   }
 
-  StackFrameARM* frame = new StackFrameARM();
+  StackFrameARM* frame = frame_arena_->New<StackFrameARM>();
 
   // The instruction pointer is stored directly in a register (r15), so pull it
   // straight out of the CPU context structure.
@@ -102,7 +155,7 @@ StackFrameARM* StackwalkerARM::GetCallerByCFIFrameInfo(
     return NULL;
 
   // Construct a new stack frame given the values the CFI recovered.
-  scoped_ptr<StackFrameARM> frame(new StackFrameARM());
+  ScopedArenaFrame<StackFrameARM> frame(frame_arena_->New<StackFrameARM>());
   for (int i = 0; register_names[i]; i++) {
     CFIFrameInfo::RegisterValueMap<uint32_t>::iterator entry =
       caller_registers.find(register_names[i]);
@@ -160,6 +213,153 @@ StackFrameARM* StackwalkerARM::GetCallerByCFIFrameInfo(
   return frame.release();
 }
 
+bool StackwalkerARM::ReadCodeWord(uint32_t address, uint32_t* word) {
+  if (!instruction_memory_)
+    return false;
+  MinidumpMemoryRegion* region =
+      instruction_memory_->GetMemoryRegionForAddress(address);
+  return region && region->GetMemoryAtAddress(address, word);
+}
+
+uint32_t StackwalkerARM::FindFunctionEntry(const StackFrameARM* frame) {
+  if (frame->function_base)
+    return static_cast<uint32_t>(frame->function_base);
+
+  // Without symbols to locate the function, scan backwards from the
+  // program counter for the push {..., lr} that opens almost every
+  // nonleaf ARM prologue.  The edge of the captured code region bounds
+  // the scan.
+  uint32_t address = static_cast<uint32_t>(frame->instruction) & ~3u;
+  for (uint32_t offset = 0; offset <= kMaxEntryScanBytes; offset += 4) {
+    uint32_t instruction;
+    if (!ReadCodeWord(address - offset, &instruction))
+      return 0;
+    if ((instruction & 0xffff4000) == 0xe92d4000)
+      return address - offset;
+  }
+  return 0;
+}
+
+StackFrameARM* StackwalkerARM::GetCallerByPrologueAnalysis(
+    const vector<StackFrame*> &frames) {
+  StackFrameARM* last_frame = static_cast<StackFrameARM*>(frames.back());
+
+  if (!instruction_memory_)
+    return NULL;
+
+  // The decoder below understands ARM encodings only; leave Thumb code
+  // to the scanner.
+  if (last_frame->context.cpsr & 0x20)
+    return NULL;
+
+  uint32_t entry = FindFunctionEntry(last_frame);
+  if (!entry)
+    return NULL;
+
+  PrologueFrameLayout layout;
+  if (!prologue_layout_cache_ ||
+      !prologue_layout_cache_->Lookup(entry, &layout)) {
+    // Decode the prologue: a run of push {reglist} and sub sp, sp, #imm
+    // instructions starting at the function's entry.  Stop at the first
+    // instruction that is neither, and at the program counter so a
+    // thread suspended mid-prologue is not credited with stack it has
+    // not moved yet.
+    uint32_t program_counter = static_cast<uint32_t>(last_frame->instruction)
+                               & ~3u;
+    uint32_t depth = 0;  // Bytes the prologue has claimed below entry SP.
+    int32_t slot_depths[16];  // Depth of each register's slot, -1 if unsaved.
+    for (int i = 0; i < 16; ++i)
+      slot_depths[i] = -1;
+
+    uint32_t address = entry;
+    for (int count = 0;
+         count < kMaxPrologueInstructions && address < program_counter;
+         ++count, address += 4) {
+      uint32_t instruction;
+      if (!ReadCodeWord(address, &instruction))
+        break;
+      if ((instruction & 0xffff0000) == 0xe92d0000) {
+        // push {reglist}: registers are stored in ascending numerical
+        // order starting at the lowest address.
+        uint32_t register_list = instruction & 0xffff;
+        int pushed = 0;
+        for (int r = 0; r < 16; ++r)
+          if (register_list & (1 << r))
+            ++pushed;
+        int slot = 0;
+        for (int r = 0; r < 16; ++r) {
+          if (register_list & (1 << r)) {
+            slot_depths[r] = depth + 4 * (pushed - slot);
+            ++slot;
+          }
+        }
+        depth += 4 * pushed;
+      } else if ((instruction & 0xfffff000) == 0xe24dd000) {
+        // sub sp, sp, #imm: the immediate is an 8-bit value rotated
+        // right by twice the 4-bit rotation field.
+        uint32_t immediate = instruction & 0xff;
+        uint32_t rotation = 2 * ((instruction >> 8) & 0xf);
+        if (rotation)
+          immediate = (immediate >> rotation) | (immediate << (32 - rotation));
+        depth += immediate;
+      } else {
+        break;
+      }
+    }
+
+    // Re-express the slots as offsets above the post-prologue stack
+    // pointer, which is where the suspended callee's SP points.
+    layout.frame_bytes = depth;
+    for (int r = 0; r < 16; ++r)
+      if (slot_depths[r] >= 0)
+        layout.register_offsets[r] = depth - slot_depths[r];
+    if (prologue_layout_cache_)
+      prologue_layout_cache_->Store(entry, layout);
+  }
+
+  // Without a saved return address the layout locates no caller.  A
+  // failed analysis caches this way too, so later frames in the same
+  // function fail without re-decoding.
+  if (layout.register_offsets[MD_CONTEXT_ARM_REG_LR] < 0)
+    return NULL;
+
+  uint32_t callee_sp = last_frame->context.iregs[MD_CONTEXT_ARM_REG_SP];
+  uint32_t caller_pc;
+  if (!memory_->GetMemoryAtAddress(
+          callee_sp + layout.register_offsets[MD_CONTEXT_ARM_REG_LR],
+          &caller_pc))
+    return NULL;
+  if (caller_pc == 0 || (modules_ && !modules_->IsTextAddress(caller_pc)))
+    return NULL;
+
+  // Create a new stack frame (ownership will be transferred to the caller)
+  // and fill it in.
+  ScopedArenaFrame<StackFrameARM> frame(frame_arena_->New<StackFrameARM>());
+
+  frame->trust = StackFrame::FRAME_TRUST_FP;
+  frame->context = last_frame->context;
+  frame->context.iregs[MD_CONTEXT_ARM_REG_PC] = caller_pc;
+  frame->context.iregs[MD_CONTEXT_ARM_REG_SP] =
+      callee_sp + layout.frame_bytes;
+  frame->context_validity = StackFrameARM::CONTEXT_VALID_PC |
+                            StackFrameARM::CONTEXT_VALID_SP;
+
+  // Restore the callee-saved registers the prologue spilled, so CFI for
+  // frames further up the stack has them to work with.
+  for (int r = 4; r <= 11; ++r) {
+    if (layout.register_offsets[r] < 0)
+      continue;
+    uint32_t value;
+    if (memory_->GetMemoryAtAddress(callee_sp + layout.register_offsets[r],
+                                    &value)) {
+      frame->context.iregs[r] = value;
+      frame->context_validity |= StackFrameARM::RegisterValidFlag(r);
+    }
+  }
+
+  return frame.release();
+}
+
 StackFrameARM* StackwalkerARM::GetCallerByStackScan(
     const vector<StackFrame*> &frames) {
   StackFrameARM* last_frame = static_cast<StackFrameARM*>(frames.back());
@@ -185,7 +385,7 @@ StackFrameARM* StackwalkerARM::GetCallerByStackScan(
 
   // Create a new stack frame (ownership will be transferred to the caller)
   // and fill it in.
-  StackFrameARM* frame = new StackFrameARM();
+  StackFrameARM* frame = frame_arena_->New<StackFrameARM>();
 
   frame->trust = StackFrame::FRAME_TRUST_SCAN;
   frame->context = last_frame->context;
@@ -227,7 +427,7 @@ StackFrameARM* StackwalkerARM::GetCallerByFramePointer(
 
   // Create a new stack frame (ownership will be transferred to the caller)
   // and fill it in.
-  StackFrameARM* frame = new StackFrameARM();
+  StackFrameARM* frame = frame_arena_->New<StackFrameARM>();
 
   frame->trust = StackFrame::FRAME_TRUST_FP;
   frame->context = last_frame->context;
@@ -251,19 +451,25 @@ StackFrame* StackwalkerARM::GetCallerFrame(const CallStack* stack) {
 
   const vector<StackFrame*> &frames = *stack->frames();
   StackFrameARM* last_frame = static_cast<StackFrameARM*>(frames.back());
-  scoped_ptr<StackFrameARM> frame;
+  ScopedArenaFrame<StackFrameARM> frame;
 
   // See if there is DWARF call frame information covering this address.
-  scoped_ptr<CFIFrameInfo> cfi_frame_info(
-      frame_symbolizer_->FindCFIFrameInfo(last_frame));
-  if (cfi_frame_info.get())
-    frame.reset(GetCallerByCFIFrameInfo(frames, cfi_frame_info.get()));
+  // The rule set lives on the stack; the resolver fills it in place, so
+  // no frame info object is allocated per frame.
+  CFIFrameInfo cfi_frame_info;
+  if (frame_symbolizer_->FindCFIFrameInfo(last_frame, &cfi_frame_info))
+    frame.reset(GetCallerByCFIFrameInfo(frames, &cfi_frame_info));
 
   // If CFI failed, or there wasn't CFI available, fall back
   // to frame pointer, if this is configured.
   if (fp_register_ >= 0 && !frame.get())
     frame.reset(GetCallerByFramePointer(frames));
 
+  // Next, try deriving the callee's frame layout from its prologue
+  // instructions, when the dump captured them.
+  if (!frame.get())
+    frame.reset(GetCallerByPrologueAnalysis(frames));
+
   // If everuthing failed, fall back to stack scanning.
   if (!frame.get())
     frame.reset(GetCallerByStackScan(frames));
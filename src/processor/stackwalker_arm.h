@@ -40,14 +40,73 @@
 #ifndef PROCESSOR_STACKWALKER_ARM_H__
 #define PROCESSOR_STACKWALKER_ARM_H__
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include <map>
+
 #include "google_breakpad/common/breakpad_types.h"
 #include "google_breakpad/common/minidump_format.h"
 #include "google_breakpad/processor/stackwalker.h"
+#include "google_breakpad/processor/stack_frame_cpu.h"
 
 namespace google_breakpad {
 
 class CodeModules;
 
+// The stack frame layout an ARM function's prologue establishes: how far
+// the prologue moves the stack pointer, and where within that frame each
+// register it pushes is stored.  Derived by decoding the push and
+// sub-sp instructions at the function's entry point; see
+// StackwalkerARM::GetCallerByPrologueAnalysis.
+struct PrologueFrameLayout {
+  PrologueFrameLayout() : frame_bytes(0) {
+    for (int i = 0; i < 16; ++i)
+      register_offsets[i] = -1;
+  }
+
+  // Total bytes the prologue subtracts from the stack pointer.
+  uint32_t frame_bytes;
+
+  // For each register r0-r15, the byte offset above the post-prologue
+  // stack pointer at which the prologue stored the register, or -1 if
+  // the prologue does not store it.
+  int32_t register_offsets[16];
+};
+
+// A cache of prologue-derived frame layouts, keyed by function entry
+// address.  A processing session shares one cache across its walkers, so
+// a function analyzed for one thread or dump is served from the cache
+// for every later frame that lands in it.  Thread safe; entries are
+// never evicted, which is fine for the small hot-function sets a batch
+// of dumps from one build produces.
+class PrologueLayoutCache {
+ public:
+  PrologueLayoutCache();
+  ~PrologueLayoutCache();
+
+  // If a layout for the function entered at entry_address is cached,
+  // copies it to *layout and returns true.  A cached layout may be the
+  // empty "analysis failed" layout; callers treat that the same as a
+  // fresh failed analysis, just without re-decoding the prologue.
+  bool Lookup(uint64_t entry_address, PrologueFrameLayout* layout);
+
+  // Records the layout derived for the function entered at
+  // entry_address.
+  void Store(uint64_t entry_address, const PrologueFrameLayout& layout);
+
+ private:
+  typedef std::map<uint64_t, PrologueFrameLayout> LayoutMap;
+
+  LayoutMap layouts_;
+
+#ifndef _WIN32
+  // Guards layouts_ against concurrent walk workers.
+  pthread_mutex_t lock_;
+#endif
+};
+
 class StackwalkerARM : public Stackwalker {
  public:
   // context is an arm context object that gives access to arm-specific
@@ -81,6 +140,26 @@ class StackwalkerARM : public Stackwalker {
   // Return NULL on failure.
   StackFrameARM* GetCallerByFramePointer(const vector<StackFrame*> &frames);
 
+  // Decode the push and sub-sp instructions at the callee's entry point
+  // to learn its frame layout, and recover the caller from the saved
+  // registers that layout locates.  Instruction bytes come from the
+  // dump's memory list (see Stackwalker::set_instruction_memory), so
+  // this only helps on dumps that capture code around the program
+  // counter, and only for ARM-mode code.  Much cheaper and more accurate
+  // than scanning when CFI and frame pointers are absent.  The caller
+  // takes ownership of the returned frame.  Return NULL on failure.
+  StackFrameARM* GetCallerByPrologueAnalysis(const vector<StackFrame*> &frames);
+
+  // Find the entry address of the function containing address, either
+  // from the frame's resolved function_base or by scanning backwards
+  // for a push {..., lr} prologue instruction.  Returns 0 on failure.
+  uint32_t FindFunctionEntry(const StackFrameARM* frame);
+
+  // Read one ARM instruction word from the dump's captured code regions.
+  // Returns false if no instruction memory is wired up or the address
+  // was not captured.
+  bool ReadCodeWord(uint32_t address, uint32_t* word);
+
   // Scan the stack for plausible return addresses. The caller takes ownership
   // of the returned frame. Return NULL on failure.
   StackFrameARM* GetCallerByStackScan(const vector<StackFrame*> &frames);
@@ -306,7 +306,8 @@ TEST_F(GetCallerFrame, ScanWithFunctionSymbols) {
   EXPECT_EQ(StackFrame::FRAME_TRUST_CONTEXT, frame0->trust);
   ASSERT_EQ(StackFrameARM::CONTEXT_VALID_ALL, frame0->context_validity);
   EXPECT_EQ(0, memcmp(&raw_context, &frame0->context, sizeof(raw_context)));
-  EXPECT_EQ("monotreme", frame0->function_name);
+  ASSERT_TRUE(frame0->function_name);
+  EXPECT_EQ("monotreme", *frame0->function_name);
   EXPECT_EQ(0x40000100U, frame0->function_base);
 
   StackFrameARM *frame1 = static_cast<StackFrameARM *>(frames->at(1));
@@ -316,7 +317,8 @@ TEST_F(GetCallerFrame, ScanWithFunctionSymbols) {
             frame1->context_validity);
   EXPECT_EQ(return_address, frame1->context.iregs[MD_CONTEXT_ARM_REG_PC]);
   EXPECT_EQ(frame1_sp.Value(), frame1->context.iregs[MD_CONTEXT_ARM_REG_SP]);
-  EXPECT_EQ("marsupial", frame1->function_name);
+  ASSERT_TRUE(frame1->function_name);
+  EXPECT_EQ("marsupial", *frame1->function_name);
   EXPECT_EQ(0x50000100U, frame1->function_base);
 }
 
@@ -480,7 +482,8 @@ struct CFIFixture: public StackwalkerARMFixture {
     StackFrameARM *frame0 = static_cast<StackFrameARM *>(frames->at(0));
     EXPECT_EQ(StackFrame::FRAME_TRUST_CONTEXT, frame0->trust);
     ASSERT_EQ(context_frame_validity, frame0->context_validity);
-    EXPECT_EQ("enchiridion", frame0->function_name);
+    ASSERT_TRUE(frame0->function_name);
+    EXPECT_EQ("enchiridion", *frame0->function_name);
     EXPECT_EQ(0x40004000U, frame0->function_base);
 
     StackFrameARM *frame1 = static_cast<StackFrameARM *>(frames->at(1));
@@ -514,7 +517,8 @@ struct CFIFixture: public StackwalkerARMFixture {
               frame1->context.iregs[MD_CONTEXT_ARM_REG_PC]);
     EXPECT_EQ(expected.iregs[MD_CONTEXT_ARM_REG_PC],
               frame1->instruction + 2);
-    EXPECT_EQ("epictetus", frame1->function_name);
+    ASSERT_TRUE(frame1->function_name);
+    EXPECT_EQ("epictetus", *frame1->function_name);
   }
 
   // The values we expect to find for the caller's registers.
@@ -857,7 +861,8 @@ TEST_F(GetFramesByFramePointer, FramePointerAndCFI) {
   EXPECT_EQ(frame1_sp.Value(), frame1->context.iregs[MD_CONTEXT_ARM_REG_SP]);
   EXPECT_EQ(frame2_fp.Value(),
             frame1->context.iregs[MD_CONTEXT_ARM_REG_IOS_FP]);
-  EXPECT_EQ("enchiridion", frame1->function_name);
+  ASSERT_TRUE(frame1->function_name);
+  EXPECT_EQ("enchiridion", *frame1->function_name);
   EXPECT_EQ(0x40004000U, frame1->function_base);
 
 
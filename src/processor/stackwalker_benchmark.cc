@@ -0,0 +1,531 @@
+// Copyright (c) 2010 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// stackwalker_benchmark.cc: Per-architecture stackwalker performance
+// harness over recorded fixtures.
+//
+// stackwalker_selftest walks the live host stack as a correctness check,
+// but gives no repeatable performance numbers and only exercises the
+// host CPU's walker.  This harness instead replays fixed fixtures - a
+// captured context, the stack memory it points into, and the frame info
+// the symbolizer would supply - through the ordinary Walk/GetCallerFrame
+// path, and reports frames per second for each case:
+//
+//   amd64-cfi  StackwalkerAMD64 driven by STACK CFI records
+//   x86-fpo    StackwalkerX86 driven by STACK WIN FPO records
+//   x86-scan   StackwalkerX86 with no frame info, stack scanning only
+//   arm-cfi    StackwalkerARM driven by STACK CFI records
+//
+// The fixtures are synthesized deterministically at startup, so numbers
+// are comparable across runs and machines, and each unwind strategy is
+// measurable in isolation: an optimization to CFI rule evaluation shows
+// up in the *-cfi rows, one to scanning in x86-scan, without the two
+// drowning each other out as they do in whole-dump timings.  Symbols are
+// parsed once before timing begins; the loop measures walking only.
+//
+// Usage: stackwalker_benchmark [-p passes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/minidump_format.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/call_stack.h"
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/code_modules.h"
+#include "google_breakpad/processor/memory_region.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "google_breakpad/processor/symbol_supplier.h"
+#include "google_breakpad/processor/system_info.h"
+#include "processor/stackwalker_amd64.h"
+#include "processor/stackwalker_arm.h"
+#include "processor/stackwalker_x86.h"
+
+namespace {
+
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::CallStack;
+using google_breakpad::CodeModule;
+using google_breakpad::CodeModules;
+using google_breakpad::MemoryRegion;
+using google_breakpad::StackFrameSymbolizer;
+using google_breakpad::StackwalkerAMD64;
+using google_breakpad::StackwalkerARM;
+using google_breakpad::StackwalkerX86;
+using google_breakpad::SymbolSupplier;
+using google_breakpad::SystemInfo;
+using std::vector;
+
+// Where the fixture module and stack live in the synthetic address
+// space, and how the module's text is carved into functions.
+const uint64_t kModuleBase = 0x40000000;
+const uint64_t kModuleSize = 0x100000;
+const uint64_t kFunctionSize = 0x1000;
+const uint64_t kStackBase = 0x80000000;
+
+// How many caller frames each fixture's stack records.
+const int kFrameDepth = 60;
+
+static uint64_t NowMicroseconds() {
+  struct timeval time_now;
+  gettimeofday(&time_now, NULL);
+  return static_cast<uint64_t>(time_now.tv_sec) * 1000000 + time_now.tv_usec;
+}
+
+// The entry address of the fixture's function_index'th function; return
+// addresses in the fixtures point a little past these.
+static uint64_t FunctionAddress(int function_index) {
+  return kModuleBase + kFunctionSize * (function_index + 1);
+}
+
+// A memory region over a byte string, as a thread's captured stack.
+class FixtureMemoryRegion : public MemoryRegion {
+ public:
+  FixtureMemoryRegion() : base_address_(0) {}
+
+  void Init(uint64_t base_address, const string& contents) {
+    base_address_ = base_address;
+    contents_ = contents;
+  }
+
+  uint64_t GetBase() const { return base_address_; }
+  uint32_t GetSize() const { return contents_.size(); }
+
+  bool GetMemoryAtAddress(uint64_t address, uint8_t* value) const {
+    return GetMemoryLittleEndian(address, value);
+  }
+  bool GetMemoryAtAddress(uint64_t address, uint16_t* value) const {
+    return GetMemoryLittleEndian(address, value);
+  }
+  bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const {
+    return GetMemoryLittleEndian(address, value);
+  }
+  bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const {
+    return GetMemoryLittleEndian(address, value);
+  }
+
+ private:
+  template<typename ValueType>
+  bool GetMemoryLittleEndian(uint64_t address, ValueType* value) const {
+    if (address < base_address_ ||
+        address - base_address_ + sizeof(ValueType) > contents_.size())
+      return false;
+    ValueType assembled = 0;
+    size_t start = address - base_address_;
+    for (size_t i = sizeof(ValueType); i > 0; i--)
+      assembled = (assembled << 8) |
+                  static_cast<unsigned char>(contents_[start + i - 1]);
+    *value = assembled;
+    return true;
+  }
+
+  uint64_t base_address_;
+  string contents_;
+};
+
+// The fixture module: one code module covering the addresses the
+// contexts and return addresses point into.
+class FixtureCodeModule : public CodeModule {
+ public:
+  uint64_t base_address() const { return kModuleBase; }
+  uint64_t size() const { return kModuleSize; }
+  string code_file() const { return "bench_module"; }
+  string code_identifier() const { return "bench_module"; }
+  string debug_file() const { return "bench_module"; }
+  string debug_identifier() const { return "000000000000000000000000000000000"; }
+  string version() const { return ""; }
+  const CodeModule* Copy() const { abort(); }
+};
+
+class FixtureCodeModules : public CodeModules {
+ public:
+  unsigned int module_count() const { return 1; }
+  const CodeModule* GetModuleForAddress(uint64_t address) const {
+    if (address >= kModuleBase && address - kModuleBase < kModuleSize)
+      return &module_;
+    return NULL;
+  }
+  const CodeModule* GetMainModule() const { return &module_; }
+  const CodeModule* GetModuleAtSequence(unsigned int sequence) const {
+    return sequence == 0 ? &module_ : NULL;
+  }
+  const CodeModule* GetModuleAtIndex(unsigned int index) const {
+    return index == 0 ? &module_ : NULL;
+  }
+  const CodeModules* Copy() const { abort(); }
+
+ private:
+  FixtureCodeModule module_;
+};
+
+// Serves a fixture's symbol text from memory.  An empty text means the
+// fixture walks without symbols (the scanning case).
+class FixtureSymbolSupplier : public SymbolSupplier {
+ public:
+  explicit FixtureSymbolSupplier(const string& symbol_text)
+      : symbol_text_(symbol_text) {}
+
+  virtual SymbolResult GetSymbolFile(const CodeModule* module,
+                                     const SystemInfo* system_info,
+                                     string* symbol_file) {
+    return symbol_text_.empty() ? NOT_FOUND : FOUND;
+  }
+
+  virtual SymbolResult GetSymbolFile(const CodeModule* module,
+                                     const SystemInfo* system_info,
+                                     string* symbol_file,
+                                     string* symbol_data) {
+    if (symbol_text_.empty())
+      return NOT_FOUND;
+    if (symbol_data)
+      *symbol_data = symbol_text_;
+    return FOUND;
+  }
+
+  virtual SymbolResult GetCStringSymbolData(const CodeModule* module,
+                                            const SystemInfo* system_info,
+                                            string* symbol_file,
+                                            char** symbol_data) {
+    if (symbol_text_.empty())
+      return NOT_FOUND;
+    *symbol_data = new char[symbol_text_.size() + 1];
+    memcpy(*symbol_data, symbol_text_.c_str(), symbol_text_.size() + 1);
+    buffers_.push_back(*symbol_data);
+    return FOUND;
+  }
+
+  virtual void FreeSymbolData(const CodeModule* module) {}
+
+  virtual ~FixtureSymbolSupplier() {
+    for (size_t i = 0; i < buffers_.size(); i++)
+      delete[] buffers_[i];
+  }
+
+ private:
+  string symbol_text_;
+  vector<char*> buffers_;
+};
+
+// Appends value little-endian to stack.
+static void AppendValue32(string* stack, uint32_t value) {
+  for (int i = 0; i < 4; i++)
+    stack->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+static void AppendValue64(string* stack, uint64_t value) {
+  for (int i = 0; i < 8; i++)
+    stack->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+// One recorded fixture: the architecture, the captured context, the
+// stack memory it points into, and the module's frame info.
+struct Fixture {
+  const char* name;
+  string cpu;             // SystemInfo::cpu
+  string symbol_text;     // empty for symbol-less fixtures
+  string stack;           // contents at kStackBase
+  MDRawContextAMD64 context_amd64;
+  MDRawContextX86 context_x86;
+  MDRawContextARM context_arm;
+};
+
+// amd64-cfi: every function carries the common prologue-complete CFI
+// rule - the CFA 16 bytes above %rsp, the return address 8 below the
+// CFA - and the stack is a run of 16-byte frames with the return
+// address in the upper half.  The outermost frame's rule recovers a
+// zero return address, ending the walk the way compiler-emitted CFI
+// for a thread entry point does.
+static void BuildAMD64CFIFixture(Fixture* fixture) {
+  fixture->name = "amd64-cfi";
+  fixture->cpu = "amd64";
+
+  char line[128];
+  for (int i = 0; i <= kFrameDepth; i++) {
+    uint64_t offset = FunctionAddress(i) - kModuleBase;
+    snprintf(line, sizeof(line), "FUNC %llx %llx 0 func_%d\n",
+             (unsigned long long) offset, (unsigned long long) kFunctionSize,
+             i);
+    fixture->symbol_text.append(line);
+    if (i < kFrameDepth) {
+      snprintf(line, sizeof(line),
+               "STACK CFI INIT %llx %llx .cfa: $rsp 16 + .ra: .cfa 8 - ^\n",
+               (unsigned long long) offset,
+               (unsigned long long) kFunctionSize);
+    } else {
+      snprintf(line, sizeof(line),
+               "STACK CFI INIT %llx %llx .cfa: $rsp 16 + .ra: 0\n",
+               (unsigned long long) offset,
+               (unsigned long long) kFunctionSize);
+    }
+    fixture->symbol_text.append(line);
+  }
+
+  for (int i = 0; i < kFrameDepth; i++) {
+    AppendValue64(&fixture->stack, 0);  // spilled locals
+    AppendValue64(&fixture->stack, FunctionAddress(i + 1) + 0x20);
+  }
+
+  memset(&fixture->context_amd64, 0, sizeof(fixture->context_amd64));
+  fixture->context_amd64.context_flags = MD_CONTEXT_AMD64_FULL;
+  fixture->context_amd64.rip = FunctionAddress(0) + 0x20;
+  fixture->context_amd64.rsp = kStackBase;
+  fixture->context_amd64.rbp = 0;
+}
+
+// x86-fpo: every function carries a "STACK WIN 0" FPO record - 8 bytes
+// of locals, 4 of saved registers, 4 of parameters and no base pointer -
+// so the walker reconstructs each 20-byte frame from typed frame data
+// without a program string.
+static void BuildX86FPOFixture(Fixture* fixture) {
+  fixture->name = "x86-fpo";
+  fixture->cpu = "x86";
+
+  char line[128];
+  for (int i = 0; i <= kFrameDepth; i++) {
+    uint64_t offset = FunctionAddress(i) - kModuleBase;
+    snprintf(line, sizeof(line), "FUNC %llx %llx 4 func_%d\n",
+             (unsigned long long) offset, (unsigned long long) kFunctionSize,
+             i);
+    fixture->symbol_text.append(line);
+    snprintf(line, sizeof(line), "STACK WIN 0 %llx %llx 0 0 4 4 8 0 0 0\n",
+             (unsigned long long) offset, (unsigned long long) kFunctionSize);
+    fixture->symbol_text.append(line);
+  }
+
+  for (int i = 0; i < kFrameDepth; i++) {
+    AppendValue32(&fixture->stack, 0);  // locals
+    AppendValue32(&fixture->stack, 0);
+    AppendValue32(&fixture->stack, 0);  // saved register
+    AppendValue32(&fixture->stack,
+                  static_cast<uint32_t>(FunctionAddress(i + 1)) + 0x20);
+    AppendValue32(&fixture->stack, 0);  // parameter
+  }
+  // A zeroed terminator frame, so unwinding the outermost function
+  // recovers a null return address instead of running off the stack.
+  for (int word = 0; word < 5; word++)
+    AppendValue32(&fixture->stack, 0);
+
+  memset(&fixture->context_x86, 0, sizeof(fixture->context_x86));
+  fixture->context_x86.context_flags = MD_CONTEXT_X86_FULL;
+  fixture->context_x86.eip = static_cast<uint32_t>(FunctionAddress(0)) + 0x20;
+  fixture->context_x86.esp = static_cast<uint32_t>(kStackBase);
+  fixture->context_x86.ebp = 0;
+}
+
+// x86-scan: no symbols at all, so every caller frame comes from
+// scanning the stack for words that land in the module.  One plausible
+// return address every eight words, with junk between, approximates a
+// frame-pointer-omitting stack with spilled data.
+static void BuildX86ScanFixture(Fixture* fixture) {
+  fixture->name = "x86-scan";
+  fixture->cpu = "x86";
+
+  for (int i = 0; i < kFrameDepth; i++) {
+    for (int word = 0; word < 7; word++)
+      AppendValue32(&fixture->stack, 0x00000100 + word);
+    AppendValue32(&fixture->stack,
+                  static_cast<uint32_t>(FunctionAddress(i + 1)) + 0x20);
+  }
+
+  memset(&fixture->context_x86, 0, sizeof(fixture->context_x86));
+  fixture->context_x86.context_flags = MD_CONTEXT_X86_FULL;
+  fixture->context_x86.eip = static_cast<uint32_t>(FunctionAddress(0)) + 0x20;
+  fixture->context_x86.esp = static_cast<uint32_t>(kStackBase);
+  fixture->context_x86.ebp = 0;
+}
+
+// arm-cfi: the 32-bit analogue of amd64-cfi - the CFA 16 bytes above
+// sp, the return address 4 below the CFA, 16-byte frames.
+static void BuildARMCFIFixture(Fixture* fixture) {
+  fixture->name = "arm-cfi";
+  fixture->cpu = "arm";
+
+  char line[128];
+  for (int i = 0; i <= kFrameDepth; i++) {
+    uint64_t offset = FunctionAddress(i) - kModuleBase;
+    snprintf(line, sizeof(line), "FUNC %llx %llx 0 func_%d\n",
+             (unsigned long long) offset, (unsigned long long) kFunctionSize,
+             i);
+    fixture->symbol_text.append(line);
+    if (i < kFrameDepth) {
+      snprintf(line, sizeof(line),
+               "STACK CFI INIT %llx %llx .cfa: sp 16 + .ra: .cfa 4 - ^\n",
+               (unsigned long long) offset,
+               (unsigned long long) kFunctionSize);
+    } else {
+      snprintf(line, sizeof(line),
+               "STACK CFI INIT %llx %llx .cfa: sp 16 + .ra: 0\n",
+               (unsigned long long) offset,
+               (unsigned long long) kFunctionSize);
+    }
+    fixture->symbol_text.append(line);
+  }
+
+  for (int i = 0; i < kFrameDepth; i++) {
+    AppendValue32(&fixture->stack, 0);
+    AppendValue32(&fixture->stack, 0);
+    AppendValue32(&fixture->stack, 0);
+    AppendValue32(&fixture->stack,
+                  static_cast<uint32_t>(FunctionAddress(i + 1)) + 0x20);
+  }
+
+  memset(&fixture->context_arm, 0, sizeof(fixture->context_arm));
+  fixture->context_arm.context_flags = MD_CONTEXT_ARM_FULL;
+  fixture->context_arm.iregs[MD_CONTEXT_ARM_REG_SP] =
+      static_cast<uint32_t>(kStackBase);
+  fixture->context_arm.iregs[MD_CONTEXT_ARM_REG_PC] =
+      static_cast<uint32_t>(FunctionAddress(0)) + 0x20;
+}
+
+// Constructs a walker for fixture on the given per-run state.  The
+// walkers are cheap to construct; the cost measured is Walk.
+static google_breakpad::Stackwalker* NewWalker(
+    const Fixture& fixture,
+    const SystemInfo* system_info,
+    FixtureMemoryRegion* memory,
+    const CodeModules* modules,
+    StackFrameSymbolizer* symbolizer) {
+  if (fixture.cpu == "amd64") {
+    return new StackwalkerAMD64(system_info, &fixture.context_amd64, memory,
+                                modules, symbolizer);
+  }
+  if (fixture.cpu == "arm") {
+    return new StackwalkerARM(system_info, &fixture.context_arm, -1, memory,
+                              modules, symbolizer);
+  }
+  return new StackwalkerX86(system_info, &fixture.context_x86, memory,
+                            modules, symbolizer);
+}
+
+// Replays fixture passes times and prints its row.  Returns false if
+// the fixture does not walk at all, which would make its numbers
+// meaningless.
+static bool RunFixture(const Fixture& fixture, int passes) {
+  SystemInfo system_info;
+  system_info.cpu = fixture.cpu;
+
+  FixtureMemoryRegion memory;
+  memory.Init(kStackBase, fixture.stack);
+
+  FixtureCodeModules modules;
+  FixtureSymbolSupplier supplier(fixture.symbol_text);
+  BasicSourceLineResolver resolver;
+  StackFrameSymbolizer symbolizer(&supplier, &resolver);
+
+  google_breakpad::Stackwalker* walker;
+  vector<const CodeModule*> modules_without_symbols;
+
+  // Untimed warm-up pass: loads and parses the symbol text, and
+  // reports how deep the fixture walks.
+  size_t frames_per_walk;
+  {
+    walker = NewWalker(fixture, &system_info, &memory, &modules, &symbolizer);
+    CallStack stack;
+    walker->Walk(&stack, &modules_without_symbols);
+    frames_per_walk = stack.frames()->size();
+    delete walker;
+  }
+  if (frames_per_walk < 2) {
+    fprintf(stderr, "stackwalker_benchmark: fixture %s found no caller "
+            "frames\n", fixture.name);
+    return false;
+  }
+
+  uint64_t start_us = NowMicroseconds();
+  uint64_t total_frames = 0;
+  for (int pass = 0; pass < passes; pass++) {
+    walker = NewWalker(fixture, &system_info, &memory, &modules, &symbolizer);
+    CallStack stack;
+    modules_without_symbols.clear();
+    walker->Walk(&stack, &modules_without_symbols);
+    total_frames += stack.frames()->size();
+    delete walker;
+  }
+  uint64_t elapsed_us = NowMicroseconds() - start_us;
+  if (elapsed_us == 0)
+    elapsed_us = 1;
+
+  printf("%-10s frames/walk=%-3u walks=%-6d elapsed_ms=%-7.1f "
+         "frames/s=%-9.0f us/frame=%.3f\n",
+         fixture.name,
+         static_cast<unsigned int>(frames_per_walk),
+         passes,
+         elapsed_us / 1000.0,
+         total_frames * 1000000.0 / elapsed_us,
+         static_cast<double>(elapsed_us) / total_frames);
+  return true;
+}
+
+static void Usage(const char* program_name) {
+  fprintf(stderr, "usage: %s [-p passes]\n"
+          "  -p  walks to time per fixture (default 5000)\n",
+          program_name);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int passes = 5000;
+
+  for (int argi = 1; argi < argc; argi++) {
+    if (strcmp(argv[argi], "-p") == 0 && argi + 1 < argc) {
+      passes = atoi(argv[++argi]);
+      if (passes <= 0) {
+        Usage(argv[0]);
+        return 1;
+      }
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+
+  Fixture amd64_cfi;
+  BuildAMD64CFIFixture(&amd64_cfi);
+  Fixture x86_fpo;
+  BuildX86FPOFixture(&x86_fpo);
+  Fixture x86_scan;
+  BuildX86ScanFixture(&x86_scan);
+  Fixture arm_cfi;
+  BuildARMCFIFixture(&arm_cfi);
+
+  bool ok = true;
+  ok &= RunFixture(amd64_cfi, passes);
+  ok &= RunFixture(x86_fpo, passes);
+  ok &= RunFixture(x86_scan, passes);
+  ok &= RunFixture(arm_cfi, passes);
+
+  return ok ? 0 : 1;
+}
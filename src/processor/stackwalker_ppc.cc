@@ -34,6 +34,8 @@
 // Author: Mark Mentovai
 
 
+#include "processor/frame_chain_walker.h"
+#include "processor/stack_frame_arena.h"
 #include "processor/stackwalker_ppc.h"
 #include "google_breakpad/processor/call_stack.h"
 #include "google_breakpad/processor/memory_region.h"
@@ -68,7 +70,7 @@ StackFrame* StackwalkerPPC::GetContextFrame() {
     return NULL;
   }
 
-  StackFramePPC* frame = new StackFramePPC();
+  StackFramePPC* frame = frame_arena_->New<StackFramePPC>();
 
   // The instruction pointer is stored directly in a register, so pull it
   // straight out of the CPU context structure.
@@ -99,28 +101,28 @@ StackFrame* StackwalkerPPC::GetCallerFrame(const CallStack* stack) {
   StackFramePPC* last_frame = static_cast<StackFramePPC*>(
       stack->frames()->back());
 
-  // A caller frame must reside higher in memory than its callee frames.
-  // Anything else is an error, or an indication that we've reached the
-  // end of the stack.
+  // The chain link stored at 0(%r1) names the caller's frame, with the
+  // saved return address at 8 bytes into that frame.  FrameChainWalker
+  // validates the link against the callee's frame (including the 0-or-1
+  // bogus return addresses Mac OS X/Darwin leaves at a thread's entry
+  // point) and prefetches the following link's cache line.
   uint32_t stack_pointer;
   if (!memory_->GetMemoryAtAddress(last_frame->context.gpr[1],
-                                   &stack_pointer) ||
-      stack_pointer <= last_frame->context.gpr[1]) {
+                                   &stack_pointer)) {
     return NULL;
   }
 
-  // Mac OS X/Darwin gives 1 as the return address from the bottom-most
-  // frame in a stack (a thread's entry point).  I haven't found any
-  // documentation on this, but 0 or 1 would be bogus return addresses,
-  // so check for them here and return false (end of stack) when they're
-  // hit to avoid having a phantom frame.
   uint32_t instruction;
-  if (!memory_->GetMemoryAtAddress(stack_pointer + 8, &instruction) ||
-      instruction <= 1) {
+  uint32_t next_stack_pointer;
+  FrameChainWalker<uint32_t> walker(memory_);
+  if (!walker.ReadLink(stack_pointer, last_frame->context.gpr[1],
+                       8,  // saved return address, at 8(%r1)
+                       0,  // the caller's own saved %r1, at 0(%r1)
+                       &instruction, &next_stack_pointer)) {
     return NULL;
   }
 
-  StackFramePPC* frame = new StackFramePPC();
+  StackFramePPC* frame = frame_arena_->New<StackFramePPC>();
 
   frame->context = last_frame->context;
   frame->context.srr0 = instruction;
@@ -37,7 +37,9 @@
 #include "google_breakpad/processor/call_stack.h"
 #include "google_breakpad/processor/memory_region.h"
 #include "google_breakpad/processor/stack_frame_cpu.h"
+#include "processor/frame_chain_walker.h"
 #include "processor/logging.h"
+#include "processor/stack_frame_arena.h"
 #include "processor/stackwalker_sparc.h"
 
 namespace google_breakpad {
@@ -59,7 +61,7 @@ StackFrame* StackwalkerSPARC::GetContextFrame() {
     return NULL;
   }
 
-  StackFrameSPARC* frame = new StackFrameSPARC();
+  StackFrameSPARC* frame = frame_arena_->New<StackFrameSPARC>();
 
   // The instruction pointer is stored directly in a register, so pull it
   // straight out of the CPU context structure.
@@ -90,27 +92,24 @@ StackFrame* StackwalkerSPARC::GetCallerFrame(const CallStack* stack) {
   // %pc_new = *(%fp_old + 32 + 32 - 4) + 8
   // which is callee's %i7 plus 8
 
-  // A caller frame must reside higher in memory than its callee frames.
-  // Anything else is an error, or an indication that we've reached the
-  // end of the stack.
+  // The callee's %fp names the caller's frame, with the register save
+  // area at its base.  FrameChainWalker validates the link against the
+  // callee's frame (including bogus 0-or-1 return addresses) and
+  // prefetches the following link's cache line.
   uint64_t stack_pointer = last_frame->context.g_r[30];
-  if (stack_pointer <= last_frame->context.g_r[14]) {
-    return NULL;
-  }
 
   uint32_t instruction;
-  if (!memory_->GetMemoryAtAddress(stack_pointer + 60,
-                     &instruction) || instruction <= 1) {
-    return NULL;
-  }
-
   uint32_t stack_base;
-  if (!memory_->GetMemoryAtAddress(stack_pointer + 56,
-                     &stack_base) || stack_base <= 1) {
+  FrameChainWalker<uint32_t> walker(memory_);
+  if (!walker.ReadLink(stack_pointer, last_frame->context.g_r[14],
+                       60,  // the callee's %i7: the saved return address
+                       56,  // the callee's %i6: the caller's frame pointer
+                       &instruction, &stack_base) ||
+      stack_base <= 1) {
     return NULL;
   }
 
-  StackFrameSPARC* frame = new StackFrameSPARC();
+  StackFrameSPARC* frame = frame_arena_->New<StackFrameSPARC>();
 
   frame->context = last_frame->context;
   frame->context.g_r[14] = stack_pointer;
@@ -44,7 +44,10 @@
 #include "google_breakpad/processor/stack_frame_cpu.h"
 #include "processor/logging.h"
 #include "processor/postfix_evaluator-inl.h"
+#include "processor/register_dictionary.h"
+#include "processor/stack_frame_arena.h"
 #include "processor/stackwalker_x86.h"
+#include "processor/unwind_strategy_hints.h"
 #include "processor/windows_frame_info.h"
 #include "processor/cfi_frame_info.h"
 
@@ -85,6 +88,8 @@ StackwalkerX86::StackwalkerX86(const SystemInfo* system_info,
                                StackFrameSymbolizer* resolver_helper)
     : Stackwalker(system_info, memory, modules, resolver_helper),
       context_(context),
+      allocates_base_pointer_program_(),
+      no_base_pointer_program_(),
       cfi_walker_(cfi_register_map_,
                   (sizeof(cfi_register_map_) / sizeof(cfi_register_map_[0]))) {
   if (memory_ && memory_->GetBase() + memory_->GetSize() - 1 > 0xffffffff) {
@@ -118,7 +123,7 @@ StackFrame* StackwalkerX86::GetContextFrame() {
     return NULL;
   }
 
-  StackFrameX86* frame = new StackFrameX86();
+  StackFrameX86* frame = frame_arena_->New<StackFrameX86>();
 
   // The instruction pointer is stored directly in a register, so pull it
   // straight out of the CPU context structure.
@@ -197,7 +202,7 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
   // Set up the dictionary for the PostfixEvaluator.  %ebp and %esp are used
   // in each program string, and their previous values are known, so set them
   // here.
-  PostfixEvaluator<uint32_t>::DictionaryType dictionary;
+  RegisterDictionary<uint32_t> dictionary;
   // Provide the current register values.
   dictionary["$ebp"] = last_frame->context.ebp;
   dictionary["$esp"] = last_frame->context.esp;
@@ -250,6 +255,7 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
   // scanned for these values. The results of program string evaluation
   // will be used to determine whether to scan for better values.
   string program_string;
+  const PostfixProgram *program = NULL;
   bool recover_ebp = true;
 
   trust = StackFrame::FRAME_TRUST_CFI;
@@ -260,6 +266,18 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     // parameters.  In some cases, particularly with program strings that use
     // .raSearchStart, the stack may need to be scanned afterward.
     program_string = last_frame_info->program_string;
+    program = last_frame_info->program;
+    if (!program && last_frame_info->program_cache.get()) {
+      // The resolver points program at the compiled form when the
+      // record is retrieved; this is a backstop for frame info that
+      // arrived some other way.  The cache here is this frame's own,
+      // so the lazy fill is thread-safe.
+      if (!last_frame_info->program_cache->program) {
+        last_frame_info->program_cache->program =
+            PostfixProgram::Compile(program_string);
+      }
+      program = last_frame_info->program_cache->program;
+    }
   } else if (last_frame_info->allocates_base_pointer) {
     // The function corresponding to the last frame doesn't use the frame
     // pointer for conventional purposes, but it does allocate a new
@@ -299,6 +317,11 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     program_string = "$eip .raSearchStart ^ = "
         "$ebp $esp .cbCalleeParams + .cbSavedRegs + 8 - ^ = "
         "$esp .raSearchStart 4 + =";
+    if (!allocates_base_pointer_program_.get()) {
+      allocates_base_pointer_program_.reset(
+          PostfixProgram::Compile(program_string));
+    }
+    program = allocates_base_pointer_program_.get();
   } else {
     // The function corresponding to the last frame doesn't use %ebp at
     // all.  The callee frame is located relative to %esp.
@@ -321,15 +344,22 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     // %ebp_new = %ebp_old
     program_string = "$eip .raSearchStart ^ = "
         "$esp .raSearchStart 4 + =";
+    if (!no_base_pointer_program_.get()) {
+      no_base_pointer_program_.reset(PostfixProgram::Compile(program_string));
+    }
+    program = no_base_pointer_program_.get();
     recover_ebp = false;
   }
 
   // Now crank it out, making sure that the program string set at least the
   // two required variables.
-  PostfixEvaluator<uint32_t> evaluator =
-      PostfixEvaluator<uint32_t>(&dictionary, memory_);
-  PostfixEvaluator<uint32_t>::DictionaryValidityType dictionary_validity;
-  if (!evaluator.Evaluate(program_string, &dictionary_validity) ||
+  PostfixEvaluator<uint32_t, RegisterDictionary<uint32_t>,
+                   RegisterDictionary<bool> > evaluator(&dictionary, memory_);
+  RegisterDictionary<bool> dictionary_validity;
+  bool evaluated = program ?
+      evaluator.EvaluateProgram(*program, &dictionary_validity) :
+      evaluator.Evaluate(program_string, &dictionary_validity);
+  if (!evaluated ||
       dictionary_validity.find("$eip") == dictionary_validity.end() ||
       dictionary_validity.find("$esp") == dictionary_validity.end()) {
     // Program string evaluation failed. It may be that %eip is not somewhere
@@ -377,7 +407,7 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     // an independent execute privilege on memory pages.
 
     uint32_t eip = dictionary["$eip"];
-    if (modules_ && !modules_->GetModuleForAddress(eip)) {
+    if (modules_ && !modules_->IsTextAddress(eip)) {
       // The instruction pointer at .raSearchStart was invalid, so start
       // looking one 32-bit word above that location.
       uint32_t location_start = dictionary[".raSearchStart"] + 4;
@@ -435,7 +465,7 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
 
   // Create a new stack frame (ownership will be transferred to the caller)
   // and fill it in.
-  StackFrameX86* frame = new StackFrameX86();
+  StackFrameX86* frame = frame_arena_->New<StackFrameX86>();
 
   frame->trust = trust;
   frame->context = last_frame->context;
@@ -470,7 +500,7 @@ StackFrameX86* StackwalkerX86::GetCallerByCFIFrameInfo(
   StackFrameX86* last_frame = static_cast<StackFrameX86*>(frames.back());
   last_frame->cfi_frame_info = cfi_frame_info;
 
-  scoped_ptr<StackFrameX86> frame(new StackFrameX86());
+  ScopedArenaFrame<StackFrameX86> frame(frame_arena_->New<StackFrameX86>());
   if (!cfi_walker_
       .FindCallerRegisters(*memory_, *cfi_frame_info,
                            last_frame->context, last_frame->context_validity,
@@ -548,7 +578,7 @@ StackFrameX86* StackwalkerX86::GetCallerByEBPAtBase(
 
   // Create a new stack frame (ownership will be transferred to the caller)
   // and fill it in.
-  StackFrameX86* frame = new StackFrameX86();
+  StackFrameX86* frame = frame_arena_->New<StackFrameX86>();
 
   frame->trust = trust;
   frame->context = last_frame->context;
@@ -570,25 +600,64 @@ StackFrame* StackwalkerX86::GetCallerFrame(const CallStack* stack) {
 
   const vector<StackFrame*> &frames = *stack->frames();
   StackFrameX86* last_frame = static_cast<StackFrameX86*>(frames.back());
-  scoped_ptr<StackFrameX86> new_frame;
+  ScopedArenaFrame<StackFrameX86> new_frame;
+
+  // The hint store, when the session has one, knows which strategies
+  // have historically paid off for last_frame's module, and lets us
+  // skip frame-info lookups that it has seen fail many times without a
+  // single success.
+  UnwindStrategyHints* hints = frame_symbolizer_->unwind_strategy_hints();
+  const CodeModule* module = last_frame->module;
 
   // If the resolver has Windows stack walking information, use that.
-  WindowsFrameInfo* windows_frame_info
-      = frame_symbolizer_->FindWindowsFrameInfo(last_frame);
-  if (windows_frame_info)
-    new_frame.reset(GetCallerByWindowsFrameInfo(frames, windows_frame_info));
+  // The scratch object a successful lookup fills is attached to
+  // last_frame, which owns its frame info; a failed lookup's stays
+  // here for the next frame, so misses cost no allocation.
+  if (!hints || hints->ShouldTry(
+          module, UnwindStrategyHints::STRATEGY_WINDOWS_FRAME_INFO)) {
+    if (!windows_frame_info_scratch_.get())
+      windows_frame_info_scratch_.reset(new WindowsFrameInfo());
+    if (frame_symbolizer_->FindWindowsFrameInfo(
+            last_frame, windows_frame_info_scratch_.get())) {
+      new_frame.reset(GetCallerByWindowsFrameInfo(
+          frames, windows_frame_info_scratch_.release()));
+    }
+    if (hints) {
+      hints->RecordAttempt(module,
+                           UnwindStrategyHints::STRATEGY_WINDOWS_FRAME_INFO,
+                           new_frame.get() != NULL);
+    }
+  }
 
   // If the resolver has DWARF CFI information, use that.
-  if (!new_frame.get()) {
-    CFIFrameInfo* cfi_frame_info =
-        frame_symbolizer_->FindCFIFrameInfo(last_frame);
-    if (cfi_frame_info)
-      new_frame.reset(GetCallerByCFIFrameInfo(frames, cfi_frame_info));
+  if (!new_frame.get() &&
+      (!hints || hints->ShouldTry(module, UnwindStrategyHints::STRATEGY_CFI))) {
+    if (!cfi_frame_info_scratch_.get())
+      cfi_frame_info_scratch_.reset(new CFIFrameInfo());
+    if (frame_symbolizer_->FindCFIFrameInfo(last_frame,
+                                            cfi_frame_info_scratch_.get())) {
+      new_frame.reset(GetCallerByCFIFrameInfo(
+          frames, cfi_frame_info_scratch_.release()));
+    }
+    if (hints) {
+      hints->RecordAttempt(module, UnwindStrategyHints::STRATEGY_CFI,
+                           new_frame.get() != NULL);
+    }
   }
 
   // Otherwise, hope that the program was using a traditional frame structure.
-  if (!new_frame.get())
+  if (!new_frame.get()) {
     new_frame.reset(GetCallerByEBPAtBase(frames));
+    if (hints) {
+      // GetCallerByEBPAtBase falls back to scanning internally; credit
+      // whichever of the two the produced frame's trust names.
+      UnwindStrategyHints::Strategy strategy =
+          new_frame.get() && new_frame->trust == StackFrame::FRAME_TRUST_SCAN ?
+              UnwindStrategyHints::STRATEGY_SCAN :
+              UnwindStrategyHints::STRATEGY_EBP_CHAIN;
+      hints->RecordAttempt(module, strategy, new_frame.get() != NULL);
+    }
+  }
 
   // If nothing worked, tell the caller.
   if (!new_frame.get())
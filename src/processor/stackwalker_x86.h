@@ -47,6 +47,9 @@
 #include "google_breakpad/processor/stackwalker.h"
 #include "google_breakpad/processor/stack_frame_cpu.h"
 #include "processor/cfi_frame_info.h"
+#include "processor/postfix_program.h"
+#include "processor/windows_frame_info.h"
+#include "common/scoped_ptr.h"
 
 namespace google_breakpad {
 
@@ -100,6 +103,20 @@ class StackwalkerX86 : public Stackwalker {
   // be returned by GetContextFrame.
   const MDRawContextX86* context_;
 
+  // Compiled forms of the two synthesized program strings used when a
+  // STACK WIN record has no program string of its own, compiled on
+  // first use and reused for every later frame this walker processes.
+  scoped_ptr<PostfixProgram> allocates_base_pointer_program_;
+  scoped_ptr<PostfixProgram> no_base_pointer_program_;
+
+  // Frame info objects the resolver's lookups fill in, allocated
+  // lazily.  A failed lookup leaves its object here to be reused by the
+  // next frame, so the common lookup miss costs no allocation; a
+  // successful lookup's object is handed to the frame, which keeps its
+  // frame info (see StackFrameX86), and is replaced on the next lookup.
+  scoped_ptr<WindowsFrameInfo> windows_frame_info_scratch_;
+  scoped_ptr<CFIFrameInfo> cfi_frame_info_scratch_;
+
   // Our register map, for cfi_walker_.
   static const CFIWalker::RegisterSet cfi_register_map_[];
 
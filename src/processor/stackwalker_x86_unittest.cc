@@ -608,7 +608,8 @@ TEST_F(GetCallerFrame, WindowsFrameDataParameterSize) {
     EXPECT_EQ(frame0_esp.Value(), frame0->context.esp);
     EXPECT_EQ(frame0_ebp.Value(), frame0->context.ebp);
     EXPECT_EQ(&module1, frame0->module);
-    EXPECT_EQ("module1::wheedle", frame0->function_name);
+    ASSERT_TRUE(frame0->function_name);
+    EXPECT_EQ("module1::wheedle", *frame0->function_name);
     EXPECT_EQ(0x40001000U, frame0->function_base);
     // The FUNC record for module1::wheedle should have produced a
     // WindowsFrameInfo structure with only the parameter size valid.
@@ -632,7 +633,8 @@ TEST_F(GetCallerFrame, WindowsFrameDataParameterSize) {
     EXPECT_EQ(frame1_esp.Value(), frame1->context.esp);
     EXPECT_EQ(0x6fa902e0U, frame1->context.ebp);
     EXPECT_EQ(&module2, frame1->module);
-    EXPECT_EQ("module2::whine", frame1->function_name);
+    ASSERT_TRUE(frame1->function_name);
+    EXPECT_EQ("module2::whine", *frame1->function_name);
     EXPECT_EQ(0x5000aa85U, frame1->function_base);
     ASSERT_TRUE(frame1->windows_frame_info != NULL);
     EXPECT_EQ(WindowsFrameInfo::VALID_ALL, frame1->windows_frame_info->valid);
@@ -861,7 +863,8 @@ TEST_F(GetCallerFrame, WindowsFPOUnchangedEBP) {
     EXPECT_EQ(frame0_esp.Value(), frame0->context.esp);
     EXPECT_EQ(frame1_ebp.Value(), frame0->context.ebp); // unchanged from caller
     EXPECT_EQ(&module1, frame0->module);
-    EXPECT_EQ("module1::discombobulated", frame0->function_name);
+    ASSERT_TRUE(frame0->function_name);
+    EXPECT_EQ("module1::discombobulated", *frame0->function_name);
     EXPECT_EQ(0x4000e8a8U, frame0->function_base);
     // The STACK WIN record for module1::discombobulated should have
     // produced a fully populated WindowsFrameInfo structure.
@@ -884,7 +887,7 @@ TEST_F(GetCallerFrame, WindowsFPOUnchangedEBP) {
     EXPECT_EQ(frame1_esp.Value(), frame1->context.esp);
     EXPECT_EQ(frame1_ebp.Value(), frame1->context.ebp);
     EXPECT_EQ(&module1, frame1->module);
-    EXPECT_EQ("", frame1->function_name);
+    EXPECT_FALSE(frame1->function_name);
     EXPECT_EQ(NULL, frame1->windows_frame_info);
   }
 }
@@ -940,7 +943,8 @@ TEST_F(GetCallerFrame, WindowsFPOUsedEBP) {
     EXPECT_EQ(frame0_esp.Value(), frame0->context.esp);
     EXPECT_EQ(0xecbdd1a5, frame0->context.ebp);
     EXPECT_EQ(&module1, frame0->module);
-    EXPECT_EQ("module1::RaisedByTheAliens", frame0->function_name);
+    ASSERT_TRUE(frame0->function_name);
+    EXPECT_EQ("module1::RaisedByTheAliens", *frame0->function_name);
     EXPECT_EQ(0x40009aa8U, frame0->function_base);
     // The STACK WIN record for module1::RaisedByTheAliens should have
     // produced a fully populated WindowsFrameInfo structure.
@@ -964,7 +968,7 @@ TEST_F(GetCallerFrame, WindowsFPOUsedEBP) {
     EXPECT_EQ(frame1_esp.Value(), frame1->context.esp);
     EXPECT_EQ(frame1_ebp.Value(), frame1->context.ebp);
     EXPECT_EQ(&module1, frame1->module);
-    EXPECT_EQ("", frame1->function_name);
+    EXPECT_FALSE(frame1->function_name);
     EXPECT_EQ(NULL, frame1->windows_frame_info);
   }
 }
@@ -1081,7 +1085,8 @@ TEST_F(GetCallerFrame, WindowsFPOSystemCall) {
     EXPECT_EQ(frame0_esp.Value(), frame0->context.esp);
     EXPECT_EQ(frame1_ebp.Value(), frame0->context.ebp);
     EXPECT_EQ(&module3, frame0->module);
-    EXPECT_EQ("ZwWaitForSingleObject", frame0->function_name);
+    ASSERT_TRUE(frame0->function_name);
+    EXPECT_EQ("ZwWaitForSingleObject", *frame0->function_name);
     // The STACK WIN record for module3!ZwWaitForSingleObject should have
     // produced a fully populated WindowsFrameInfo structure.
     ASSERT_TRUE(frame0->windows_frame_info != NULL);
@@ -1104,7 +1109,8 @@ TEST_F(GetCallerFrame, WindowsFPOSystemCall) {
     EXPECT_EQ(frame1_esp.Value(), frame1->context.esp);
     EXPECT_EQ(frame1_ebp.Value(), frame1->context.ebp);
     EXPECT_EQ(&module4, frame1->module);
-    EXPECT_EQ("WaitForSingleObjectEx", frame1->function_name);
+    ASSERT_TRUE(frame1->function_name);
+    EXPECT_EQ("WaitForSingleObjectEx", *frame1->function_name);
     // The STACK WIN record for module4!WaitForSingleObjectEx should have
     // produced a fully populated WindowsFrameInfo structure.
     ASSERT_TRUE(frame1->windows_frame_info != NULL);
@@ -1291,7 +1297,8 @@ TEST_F(GetCallerFrame, ReturnAddressIsNotInKnownModule) {
     EXPECT_EQ(frame0_esp.Value(), frame0->context.esp);
     EXPECT_EQ(frame0_ebp.Value(), frame0->context.ebp);
     EXPECT_EQ(&msvcrt_dll, frame0->module);
-    EXPECT_EQ("wcsstr", frame0->function_name);
+    ASSERT_TRUE(frame0->function_name);
+    EXPECT_EQ("wcsstr", *frame0->function_name);
     ASSERT_TRUE(frame0->windows_frame_info != NULL);
     EXPECT_EQ(WindowsFrameInfo::VALID_ALL, frame0->windows_frame_info->valid);
     EXPECT_EQ(WindowsFrameInfo::STACK_INFO_FRAME_DATA,
@@ -1316,7 +1323,8 @@ TEST_F(GetCallerFrame, ReturnAddressIsNotInKnownModule) {
     // frame 1 was skipped, so intead of frame1_ebp compare with frame2_ebp.
     EXPECT_EQ(frame2_ebp.Value(), frame1->context.ebp);
     EXPECT_EQ(&kernel32_dll, frame1->module);
-    EXPECT_EQ("FindNextFileW", frame1->function_name);
+    ASSERT_TRUE(frame1->function_name);
+    EXPECT_EQ("FindNextFileW", *frame1->function_name);
     ASSERT_TRUE(frame1->windows_frame_info != NULL);
     EXPECT_EQ(WindowsFrameInfo::VALID_ALL, frame1->windows_frame_info->valid);
     EXPECT_EQ(WindowsFrameInfo::STACK_INFO_FRAME_DATA,
@@ -1340,7 +1348,8 @@ TEST_F(GetCallerFrame, ReturnAddressIsNotInKnownModule) {
     // frame 1 was skipped, so intead of frame2_ebp compare with frame3_ebp.
     EXPECT_EQ(frame3_ebp.Value(), frame2->context.ebp);
     EXPECT_EQ(&chrome_dll, frame2->module);
-    EXPECT_EQ("file_util::FileEnumerator::Next()", frame2->function_name);
+    ASSERT_TRUE(frame2->function_name);
+    EXPECT_EQ("file_util::FileEnumerator::Next()", *frame2->function_name);
     ASSERT_TRUE(frame2->windows_frame_info != NULL);
     EXPECT_EQ(WindowsFrameInfo::VALID_ALL, frame2->windows_frame_info->valid);
     EXPECT_EQ(WindowsFrameInfo::STACK_INFO_FRAME_DATA,
@@ -1414,7 +1423,8 @@ struct CFIFixture: public StackwalkerX86Fixture {
       StackFrameX86 *frame0 = static_cast<StackFrameX86 *>(frames->at(0));
       EXPECT_EQ(StackFrame::FRAME_TRUST_CONTEXT, frame0->trust);
       ASSERT_EQ(StackFrameX86::CONTEXT_VALID_ALL, frame0->context_validity);
-      EXPECT_EQ("enchiridion", frame0->function_name);
+      ASSERT_TRUE(frame0->function_name);
+      EXPECT_EQ("enchiridion", *frame0->function_name);
       EXPECT_EQ(0x40004000U, frame0->function_base);
       ASSERT_TRUE(frame0->windows_frame_info != NULL);
       ASSERT_EQ(WindowsFrameInfo::VALID_PARAMETER_SIZE,
@@ -1438,7 +1448,8 @@ struct CFIFixture: public StackwalkerX86Fixture {
       EXPECT_EQ(expected.ebx, frame1->context.ebx);
       EXPECT_EQ(expected.esi, frame1->context.esi);
       EXPECT_EQ(expected.edi, frame1->context.edi);
-      EXPECT_EQ("epictetus", frame1->function_name);
+      ASSERT_TRUE(frame1->function_name);
+      EXPECT_EQ("epictetus", *frame1->function_name);
     }
   }
 
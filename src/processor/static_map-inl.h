@@ -40,20 +40,40 @@
 #include "processor/static_map_iterator-inl.h"
 #include "processor/logging.h"
 
+// Touches the cache line holding the key at |address| ahead of its use.
+// The searches below prefetch both possible next probes while the current
+// comparison's line is still being fetched, roughly halving the number of
+// serialized cache misses on large key arrays.
+#if defined(__GNUC__) || defined(__clang__)
+#define STATIC_MAP_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define STATIC_MAP_PREFETCH(address)
+#endif
+
 namespace google_breakpad {
 
 template<typename Key, typename Value, typename Compare>
 StaticMap<Key, Value, Compare>::StaticMap(const char* raw_data)
     : raw_data_(raw_data),
       compare_() {
-  // First 4 Bytes store the number of nodes.
-  num_nodes_ = *(reinterpret_cast<const uint32_t*>(raw_data_));
+  // First 4 Bytes store the number of nodes, with the top bit flagging
+  // the compact key encoding.
+  uint32_t node_count_word = *(reinterpret_cast<const uint32_t*>(raw_data_));
+  compact_ = (node_count_word & kStaticMapCompactKeysFlag) != 0;
+  num_nodes_ = static_cast<int32_t>(node_count_word
+                                    & ~kStaticMapCompactKeysFlag);
 
   offsets_ = reinterpret_cast<const uint32_t*>(
       raw_data_ + sizeof(num_nodes_));
 
-  keys_ = reinterpret_cast<const Key*>(
-      raw_data_ + (1 + num_nodes_) * sizeof(uint32_t));
+  if (compact_) {
+    keys_ = NULL;
+    compact_keys_.Reset(raw_data_ + (1 + num_nodes_) * sizeof(uint32_t),
+                        num_nodes_);
+  } else {
+    keys_ = reinterpret_cast<const Key*>(
+        raw_data_ + (1 + num_nodes_) * sizeof(uint32_t));
+  }
 }
 
 // find(), lower_bound() and upper_bound() implement binary search algorithm.
@@ -66,6 +86,8 @@ StaticMap<Key, Value, Compare>::find(const Key &key) const {
   int compare_result;
   while (begin < end) {
     middle = begin + (end - begin) / 2;
+    PrefetchKeyAtIndex(begin + (middle - begin) / 2);
+    PrefetchKeyAtIndex(middle + (end - middle) / 2);
     compare_result = compare_(key, GetKeyAtIndex(middle));
     if (compare_result == 0)
       return IteratorAtIndex(middle);
@@ -87,6 +109,8 @@ StaticMap<Key, Value, Compare>::lower_bound(const Key &key) const {
   int comp_result;
   while (begin < end) {
     middle = begin + (end - begin) / 2;
+    PrefetchKeyAtIndex(begin + (middle - begin) / 2);
+    PrefetchKeyAtIndex(middle + (end - middle) / 2);
     comp_result = compare_(key, GetKeyAtIndex(middle));
     if (comp_result == 0)
       return IteratorAtIndex(middle);
@@ -108,6 +132,8 @@ StaticMap<Key, Value, Compare>::upper_bound(const Key &key) const {
   int compare_result;
   while (begin < end) {
     middle = begin + (end - begin) / 2;
+    PrefetchKeyAtIndex(begin + (middle - begin) / 2);
+    PrefetchKeyAtIndex(middle + (end - middle) / 2);
     compare_result = compare_(key, GetKeyAtIndex(middle));
     if (compare_result == 0)
       return IteratorAtIndex(middle + 1);
@@ -124,7 +150,9 @@ template<typename Key, typename Value, typename Compare>
 bool StaticMap<Key, Value, Compare>::ValidateInMemoryStructure() const {
   // check the number of nodes is non-negative:
   if (!raw_data_) return false;
-  int32_t num_nodes = *(reinterpret_cast<const int32_t*>(raw_data_));
+  uint32_t node_count_word = *(reinterpret_cast<const uint32_t*>(raw_data_));
+  int32_t num_nodes = static_cast<int32_t>(node_count_word
+                                           & ~kStaticMapCompactKeysFlag);
   if (num_nodes < 0) {
     BPLOG(INFO) << "StaticMap check failed: negative number of nodes";
     return false;
@@ -132,16 +160,33 @@ bool StaticMap<Key, Value, Compare>::ValidateInMemoryStructure() const {
 
   int node_index = 0;
   if (num_nodes_) {
-    uint64_t first_offset = sizeof(int32_t) * (num_nodes_ + 1)
-                           + sizeof(Key) * num_nodes_;
-    // Num_nodes_ is too large.
-    if (first_offset > 0xffffffffUL) {
-      BPLOG(INFO) << "StaticMap check failed: size exceeds limit";
-      return false;
-    }
-    if (offsets_[node_index] != static_cast<uint32_t>(first_offset)) {
-      BPLOG(INFO) << "StaticMap check failed: first node offset is incorrect";
-      return false;
+    uint64_t header_size = sizeof(int32_t) * (num_nodes_ + 1);
+    if (compact_) {
+      // The compact key region's size is implied by where the first
+      // value starts; validate the region against that.
+      if (offsets_[node_index] <= header_size
+          || offsets_[node_index] > 0xffffffffUL) {
+        BPLOG(INFO) << "StaticMap check failed: first node offset is "
+                       "incorrect";
+        return false;
+      }
+      if (!compact_keys_.Validate(
+              static_cast<size_t>(offsets_[node_index] - header_size))) {
+        BPLOG(INFO) << "StaticMap check failed: bad compact key region";
+        return false;
+      }
+    } else {
+      uint64_t first_offset = header_size + sizeof(Key) * num_nodes_;
+      // Num_nodes_ is too large.
+      if (first_offset > 0xffffffffUL) {
+        BPLOG(INFO) << "StaticMap check failed: size exceeds limit";
+        return false;
+      }
+      if (offsets_[node_index] != static_cast<uint32_t>(first_offset)) {
+        BPLOG(INFO) << "StaticMap check failed: first node offset is "
+                       "incorrect";
+        return false;
+      }
     }
   }
 
@@ -168,9 +213,22 @@ const Key StaticMap<Key, Value, Compare>::GetKeyAtIndex(int index) const {
     // Key type is required to be primitive type.  Return 0 if index is invalid.
     return 0;
   }
+  if (compact_)
+    return compact_keys_.KeyAtIndex(index);
   return keys_[index];
 }
 
+template<typename Key, typename Value, typename Compare>
+void StaticMap<Key, Value, Compare>::PrefetchKeyAtIndex(int index) const {
+  if (compact_) {
+    // Decoding the key starts from its block's full-width anchor; the
+    // delta bytes follow in adjacent lines.
+    STATIC_MAP_PREFETCH(&compact_keys_.AnchorForIndex(index));
+  } else {
+    STATIC_MAP_PREFETCH(&keys_[index]);
+  }
+}
+
 }  // namespace google_breakpad
 
 #endif  // PROCESSOR_STATIC_MAP_INL_H__
@@ -34,7 +34,8 @@
 //
 // The chunk of memory should contain data with pre-defined pattern:
 // **************** header ***************
-// uint32 (4 bytes): number of nodes
+// uint32 (4 bytes): number of nodes; the top bit is
+//                   kStaticMapCompactKeysFlag (see below)
 // uint32 (4 bytes): address offset of node1's mapped_value
 // uint32 (4 bytes): address offset of node2's mapped_value
 // ...
@@ -55,6 +56,12 @@
 // REQUIREMENT: Key type MUST be primitive type or pointers so that:
 // X = sizeof(typename Key);
 //
+// When the number-of-nodes word has kStaticMapCompactKeysFlag set, the
+// key array above is replaced by the delta-encoded compact key region
+// described in static_map_compact.h; the header and value array are
+// unchanged.  The serializers choose that form when it is smaller, so
+// large sorted address maps do not spend 8 bytes per key.
+//
 // Note: since address offset is stored as uint32, user should keep in mind that
 // StaticMap only supports up to 4GB size of memory data.
 
@@ -64,6 +71,7 @@
 #ifndef PROCESSOR_STATIC_MAP_H__
 #define PROCESSOR_STATIC_MAP_H__
 
+#include "processor/static_map_compact.h"
 #include "processor/static_map_iterator-inl.h"
 
 namespace google_breakpad {
@@ -88,6 +96,8 @@ class StaticMap {
   StaticMap() : raw_data_(0),
                 num_nodes_(0),
                 offsets_(0),
+                keys_(0),
+                compact_(false),
                 compare_() { }
 
   explicit StaticMap(const char* raw_data);
@@ -122,6 +132,9 @@ class StaticMap {
  private:
   const Key GetKeyAtIndex(int i) const;
 
+  // Touches the cache line that a later GetKeyAtIndex(index) will read.
+  void PrefetchKeyAtIndex(int index) const;
+
   // Start address of a raw memory chunk with serialized data.
   const char* raw_data_;
 
@@ -133,9 +146,15 @@ class StaticMap {
   // address_of_i-th_node_value = raw_data_ + offsets_[i]
   const uint32_t* offsets_;
 
-  // keys_[i] = key of i_th node
+  // keys_[i] = key of i_th node.  NULL when the keys are stored
+  // compactly; see compact_keys_.
   const Key* keys_;
 
+  // Whether the serialized data carries kStaticMapCompactKeysFlag, in
+  // which case compact_keys_ decodes keys in place of keys_.
+  bool compact_;
+  StaticMapCompactKeys<Key> compact_keys_;
+
   Compare compare_;
 };
 
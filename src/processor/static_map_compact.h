@@ -0,0 +1,267 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// static_map_compact.h: the compact key encoding shared by StaticMap and
+// the map serializers.
+//
+// A serialized StaticMap normally stores its sorted keys as a full-width
+// array, which for 8-byte addresses dominates the size of serialized
+// symbol modules.  Since the keys are sorted, consecutive keys are
+// usually close together, and the differences compress well.  When the
+// node-count word of a serialized map has kStaticMapCompactKeysFlag set,
+// the key array is replaced by a compact key region:
+//
+// uint32 (4 bytes): number of key blocks B,
+//                   == ceil(node count / kStaticMapCompactBlockSize)
+// Key array (B * sizeof(Key) bytes): anchors; the full-width first key
+//                   of each block
+// uint32 array (B * 4 bytes): byte offset of each block's delta stream,
+//                   relative to the start of the delta area that
+//                   immediately follows this array
+// delta area:       per block, one LEB128 varint per remaining key in
+//                   the block, each the difference from the previous key
+//
+// Lookups binary-search exactly as before through
+// StaticMap::GetKeyAtIndex(): reading key i decodes at most
+// kStaticMapCompactBlockSize - 1 small varints after one anchor load, so
+// the extra work per probe is a few additions on bytes already brought
+// into cache by the anchor.  Differences are computed modulo 2**64, so
+// any key order round-trips; the serializers only choose the compact
+// form when it is measurably smaller than the flat array, which in
+// practice means sorted numeric keys.
+//
+// The mapped-value offset array and the value region are unchanged.
+
+#ifndef PROCESSOR_STATIC_MAP_COMPACT_H__
+#define PROCESSOR_STATIC_MAP_COMPACT_H__
+
+#include <vector>
+
+#include "google_breakpad/common/breakpad_types.h"
+#include "processor/simple_serializer.h"
+
+namespace google_breakpad {
+
+// Set in a serialized StaticMap's node-count word when its keys are
+// stored in the compact encoding.  The count itself is limited to 4GB
+// worth of nodes, so the top bit is always clear in the flat layout.
+static const uint32_t kStaticMapCompactKeysFlag = 0x80000000U;
+
+// Number of keys covered by one full-width anchor.
+static const int32_t kStaticMapCompactBlockSize = 16;
+
+// Read-side view of a compact key region.  StaticMap and
+// StaticMapIterator each hold one, Reset() against the key region of a
+// serialized map whose node-count word carries kStaticMapCompactKeysFlag.
+template<typename Key>
+class StaticMapCompactKeys {
+ public:
+  StaticMapCompactKeys() : region_(NULL),
+                           num_nodes_(0),
+                           num_blocks_(0),
+                           anchors_(NULL),
+                           stream_offsets_(NULL),
+                           deltas_(NULL) { }
+
+  // Points this view at the compact key region starting at |region|,
+  // describing |num_nodes| keys.  Only computes addresses; nothing is
+  // read through |region|, which with a corrupt node-count word can
+  // point far outside the serialized map.  The block count is fully
+  // determined by the node count, so the copy stored in the region is
+  // not needed here; Validate() checks that the two agree.
+  void Reset(const char* region, int32_t num_nodes) {
+    region_ = region;
+    num_nodes_ = num_nodes;
+    num_blocks_ = num_nodes > 0
+        ? (static_cast<uint32_t>(num_nodes) + kStaticMapCompactBlockSize - 1)
+            / kStaticMapCompactBlockSize
+        : 0;
+    anchors_ = reinterpret_cast<const Key*>(region + sizeof(uint32_t));
+    stream_offsets_ = reinterpret_cast<const uint32_t*>(
+        region + sizeof(uint32_t) + num_blocks_ * sizeof(Key));
+    deltas_ = reinterpret_cast<const uint8_t*>(stream_offsets_ + num_blocks_);
+  }
+
+  // Decodes and returns the key at |index|.  The caller is responsible
+  // for range checking, as with a flat key array.
+  Key KeyAtIndex(int index) const {
+    const int block = index / kStaticMapCompactBlockSize;
+    const int position = index % kStaticMapCompactBlockSize;
+    uint64_t key = static_cast<uint64_t>(anchors_[block]);
+    const uint8_t* stream = deltas_ + stream_offsets_[block];
+    for (int entry = 0; entry < position; ++entry) {
+      uint64_t delta = 0;
+      int shift = 0;
+      uint8_t byte;
+      do {
+        byte = *stream++;
+        delta |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        shift += 7;
+      } while (byte & 0x80);
+      key += delta;
+    }
+    return static_cast<Key>(key);
+  }
+
+  // Returns the anchor that decoding the key at |index| starts from,
+  // for callers that want to prefetch ahead of KeyAtIndex().
+  const Key& AnchorForIndex(int index) const {
+    return anchors_[index / kStaticMapCompactBlockSize];
+  }
+
+  // Checks that a region of |region_size| bytes is structurally sound:
+  // the stored block count matches the node count, the arrays fit, the
+  // stream offsets are exactly the byte positions the streams occupy,
+  // and no delta stream runs off the end of the region.  Key ordering
+  // is the caller's check, via StaticMap::ValidateInMemoryStructure().
+  bool Validate(size_t region_size) const {
+    if (region_size < sizeof(uint32_t))
+      return false;
+    if (*(reinterpret_cast<const uint32_t*>(region_)) != num_blocks_)
+      return false;
+    const size_t header_size = sizeof(uint32_t)
+        + num_blocks_ * (sizeof(Key) + sizeof(uint32_t));
+    if (header_size > region_size)
+      return false;
+    const size_t delta_area_size = region_size - header_size;
+    size_t stream_position = 0;
+    for (uint32_t block = 0; block < num_blocks_; ++block) {
+      if (stream_offsets_[block] != stream_position)
+        return false;
+      int keys_in_block = num_nodes_ - block * kStaticMapCompactBlockSize;
+      if (keys_in_block > kStaticMapCompactBlockSize)
+        keys_in_block = kStaticMapCompactBlockSize;
+      for (int entry = 1; entry < keys_in_block; ++entry) {
+        // Walk one varint, bounds checking each byte.
+        do {
+          if (stream_position >= delta_area_size)
+            return false;
+        } while (deltas_[stream_position++] & 0x80);
+      }
+    }
+    return stream_position == delta_area_size;
+  }
+
+ private:
+  const char* region_;
+  int32_t num_nodes_;
+  uint32_t num_blocks_;
+  const Key* anchors_;
+  const uint32_t* stream_offsets_;
+  const uint8_t* deltas_;
+};
+
+// Write-side encoder, used by the map serializers.  Stateless; the
+// serializers collect the map's keys in order and ask whether the
+// compact form pays for itself before committing to it in both SizeOf()
+// and Write().
+template<typename Key>
+class StaticMapCompactKeysWriter {
+ public:
+  // Returns the exact byte size of the compact key region for |keys|.
+  static size_t RegionSize(const std::vector<Key>& keys) {
+    const size_t num_blocks = NumBlocks(keys.size());
+    size_t size = sizeof(uint32_t)
+        + num_blocks * (sizeof(Key) + sizeof(uint32_t));
+    for (size_t index = 0; index < keys.size(); ++index) {
+      if (index % kStaticMapCompactBlockSize != 0)
+        size += VarintSize(Delta(keys[index - 1], keys[index]));
+    }
+    return size;
+  }
+
+  // Returns true if |keys| should be written compactly rather than as a
+  // flat array of |flat_size| bytes.  Tiny maps stay flat: the block
+  // header would cost more than it saves, and their key arrays are a
+  // rounding error in the serialized module.
+  static bool ShouldCompact(const std::vector<Key>& keys, size_t flat_size) {
+    if (keys.size() < 2 * static_cast<size_t>(kStaticMapCompactBlockSize))
+      return false;
+    return RegionSize(keys) < flat_size;
+  }
+
+  // Writes the compact key region for |keys| at |dest| and returns the
+  // address past its final byte.
+  static char* Write(const std::vector<Key>& keys, char* dest) {
+    const size_t num_blocks = NumBlocks(keys.size());
+    dest = SimpleSerializer<uint32_t>::Write(
+        static_cast<uint32_t>(num_blocks), dest);
+    Key* anchors = reinterpret_cast<Key*>(dest);
+    dest += num_blocks * sizeof(Key);
+    uint32_t* stream_offsets = reinterpret_cast<uint32_t*>(dest);
+    dest += num_blocks * sizeof(uint32_t);
+
+    const char* delta_area = dest;
+    for (size_t index = 0; index < keys.size(); ++index) {
+      if (index % kStaticMapCompactBlockSize == 0) {
+        const size_t block = index / kStaticMapCompactBlockSize;
+        anchors[block] = keys[index];
+        stream_offsets[block] = static_cast<uint32_t>(dest - delta_area);
+      } else {
+        dest = WriteVarint(Delta(keys[index - 1], keys[index]), dest);
+      }
+    }
+    return dest;
+  }
+
+ private:
+  static size_t NumBlocks(size_t num_keys) {
+    return (num_keys + kStaticMapCompactBlockSize - 1)
+        / kStaticMapCompactBlockSize;
+  }
+
+  // Difference between consecutive keys, modulo 2**64.  Wrapping keeps
+  // the round trip exact for any key values, including signed keys that
+  // cross zero.
+  static uint64_t Delta(const Key& previous, const Key& current) {
+    return static_cast<uint64_t>(current) - static_cast<uint64_t>(previous);
+  }
+
+  static size_t VarintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+      value >>= 7;
+      ++size;
+    }
+    return size;
+  }
+
+  static char* WriteVarint(uint64_t value, char* dest) {
+    while (value >= 0x80) {
+      *dest++ = static_cast<char>((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+    *dest++ = static_cast<char>(value);
+    return dest;
+  }
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_STATIC_MAP_COMPACT_H__
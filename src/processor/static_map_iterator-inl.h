@@ -47,10 +47,19 @@ StaticMapIterator<Key, Value, Compare>::StaticMapIterator(const char* base,
       index_(index), base_(base) {
   // See static_map.h for documentation on
   // bytes format of serialized StaticMap data.
-  num_nodes_ = *(reinterpret_cast<const int32_t*>(base_));
+  uint32_t node_count_word = *(reinterpret_cast<const uint32_t*>(base_));
+  compact_ = (node_count_word & kStaticMapCompactKeysFlag) != 0;
+  num_nodes_ = static_cast<int32_t>(node_count_word
+                                    & ~kStaticMapCompactKeysFlag);
   offsets_ = reinterpret_cast<const uint32_t*>(base_ + sizeof(num_nodes_));
-  keys_ = reinterpret_cast<const Key*>(
-      base_ + (1 + num_nodes_) * sizeof(num_nodes_));
+  if (compact_) {
+    keys_ = NULL;
+    compact_keys_.Reset(base_ + (1 + num_nodes_) * sizeof(num_nodes_),
+                        num_nodes_);
+  } else {
+    keys_ = reinterpret_cast<const Key*>(
+        base_ + (1 + num_nodes_) * sizeof(num_nodes_));
+  }
 }
 
 // Increment & Decrement operators:
@@ -108,6 +117,12 @@ const Key* StaticMapIterator<Key, Value, Compare>::GetKeyPtr() const {
     BPLOG(ERROR) << "call GetKeyPtr() on invalid iterator";
     return NULL;
   }
+  if (compact_) {
+    // A compactly stored key has no full-width form in the map data;
+    // decode it and point at the iterator's own copy.
+    decoded_key_ = compact_keys_.KeyAtIndex(index_);
+    return &decoded_key_;
+  }
   return &(keys_[index_]);
 }
 
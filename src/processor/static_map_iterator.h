@@ -40,6 +40,7 @@
 #define PROCESSOR_STATIC_MAP_ITERATOR_H__
 
 #include "google_breakpad/common/breakpad_types.h"
+#include "processor/static_map_compact.h"
 
 namespace google_breakpad {
 
@@ -52,7 +53,7 @@ template<typename Key, typename Value, typename Compare>
 class StaticMapIterator {
  public:
   // Constructors.
-  StaticMapIterator(): index_(-1), base_(NULL) { }
+  StaticMapIterator(): index_(-1), base_(NULL), compact_(false) { }
 
   // Increment & Decrement operators:
   StaticMapIterator& operator++();
@@ -103,8 +104,18 @@ class StaticMapIterator {
   // address_of_i-th_node_value = base_ + offsets_[i]
   const uint32_t* offsets_;
 
-  // keys_[i] = key of i_th node.
+  // keys_[i] = key of i_th node.  NULL when the map stores its keys
+  // compactly; see compact_keys_.
   const Key* keys_;
+
+  // Whether the serialized data carries kStaticMapCompactKeysFlag, in
+  // which case compact_keys_ decodes keys in place of keys_.
+  bool compact_;
+  StaticMapCompactKeys<Key> compact_keys_;
+
+  // Holds the decoded key that GetKeyPtr() points at when the keys are
+  // stored compactly and have no full-width form in the map itself.
+  mutable Key decoded_key_;
 };
 
 }  // namespace google_breakpad
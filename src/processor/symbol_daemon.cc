@@ -0,0 +1,279 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbol_daemon.cc: Publishes symbol files into shared memory for the
+// processors on a machine to share.
+//
+// Each symbol file given is parsed once, serialized with
+// ModuleSerializer, and published as a SharedModuleStore segment keyed
+// by the MODULE record's debug file and identifier.  A fleet of
+// minidump_stackwalk workers attaching the same store then resolves hot
+// modules from one physical copy of the symbol data instead of each
+// parsing and holding its own.  Segments persist after this tool exits
+// (until reboot or -u), so the default mode publishes and returns; -o
+// keeps the process resident as the segments' owner and unpublishes
+// them on SIGINT or SIGTERM, for setups that tie segment lifetime to a
+// supervised daemon.
+//
+// Usage: symbol_daemon [-n name-prefix] [-u | -o] <symbol-file> ...
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/fast_source_line_resolver.h"
+#include "processor/basic_code_module.h"
+#include "processor/module_serializer.h"
+#include "processor/shared_module_store.h"
+
+namespace {
+
+using google_breakpad::BasicCodeModule;
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::FastSourceLineResolver;
+using google_breakpad::ModuleSerializer;
+using google_breakpad::SharedModuleStore;
+using std::vector;
+
+const char kDefaultNamePrefix[] = "/breakpad-symbols";
+
+// The identity a symbol file declares in its MODULE record.
+struct ModuleKey {
+  string debug_file;
+  string debug_identifier;
+};
+
+volatile sig_atomic_t g_shutdown = 0;
+
+void ShutdownHandler(int) {
+  g_shutdown = 1;
+}
+
+// Reads the entire file at path into contents.  Returns false on any
+// I/O failure.
+bool ReadFileToString(const char *path, string *contents) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  contents->clear();
+  char buffer[65536];
+  size_t bytes_read;
+  while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents->append(buffer, bytes_read);
+  }
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+// Parses the MODULE record that leads a symbol file:
+// "MODULE <os> <cpu> <debug_identifier> <debug_file>".
+bool ParseModuleRecord(const string &symbol_data, ModuleKey *key) {
+  if (symbol_data.compare(0, 7, "MODULE ") != 0) {
+    return false;
+  }
+  size_t line_end = symbol_data.find('\n');
+  if (line_end == string::npos) {
+    line_end = symbol_data.size();
+  }
+  string line = symbol_data.substr(7, line_end - 7);
+  if (!line.empty() && line[line.size() - 1] == '\r') {
+    line.erase(line.size() - 1);
+  }
+
+  // Skip the os and cpu fields; the debug file is everything after the
+  // identifier, as module names may contain spaces.
+  size_t cpu_start = line.find(' ');
+  if (cpu_start == string::npos) {
+    return false;
+  }
+  size_t id_start = line.find(' ', cpu_start + 1);
+  if (id_start == string::npos) {
+    return false;
+  }
+  size_t file_start = line.find(' ', id_start + 1);
+  if (file_start == string::npos) {
+    return false;
+  }
+
+  key->debug_identifier = line.substr(id_start + 1,
+                                      file_start - (id_start + 1));
+  key->debug_file = line.substr(file_start + 1);
+  return !key->debug_identifier.empty() && !key->debug_file.empty();
+}
+
+// Parses, serializes, and publishes one symbol file.  On success
+// appends its key to published, for -o mode's eventual unpublish.
+bool PublishSymbolFile(const char *path,
+                       SharedModuleStore *store,
+                       vector<ModuleKey> *published) {
+  string symbol_data;
+  if (!ReadFileToString(path, &symbol_data)) {
+    fprintf(stderr, "symbol_daemon: cannot read %s\n", path);
+    return false;
+  }
+
+  ModuleKey key;
+  if (!ParseModuleRecord(symbol_data, &key)) {
+    fprintf(stderr, "symbol_daemon: %s has no usable MODULE record\n", path);
+    return false;
+  }
+  BasicCodeModule module(0, 0, key.debug_file, "",
+                         key.debug_file, key.debug_identifier, "");
+
+  // ConvertOneModuleCached consults the store first, so republishing an
+  // already-published module costs an attach, not a parse.
+  BasicSourceLineResolver basic_resolver;
+  FastSourceLineResolver fast_resolver;
+  ModuleSerializer serializer;
+  if (!basic_resolver.LoadModuleUsingMapBuffer(&module, symbol_data)) {
+    fprintf(stderr, "symbol_daemon: cannot parse %s\n", path);
+    return false;
+  }
+  if (!serializer.ConvertOneModuleCached(&module, &basic_resolver,
+                                         &fast_resolver, store)) {
+    fprintf(stderr, "symbol_daemon: cannot publish %s\n", path);
+    return false;
+  }
+  fast_resolver.UnloadModule(&module);
+
+  printf("symbol_daemon: published %s %s\n",
+         key.debug_file.c_str(), key.debug_identifier.c_str());
+  published->push_back(key);
+  return true;
+}
+
+// Removes the segment named by one symbol file's MODULE record.
+bool UnpublishSymbolFile(const char *path, SharedModuleStore *store) {
+  string symbol_data;
+  if (!ReadFileToString(path, &symbol_data)) {
+    fprintf(stderr, "symbol_daemon: cannot read %s\n", path);
+    return false;
+  }
+
+  ModuleKey key;
+  if (!ParseModuleRecord(symbol_data, &key)) {
+    fprintf(stderr, "symbol_daemon: %s has no usable MODULE record\n", path);
+    return false;
+  }
+  BasicCodeModule module(0, 0, key.debug_file, "",
+                         key.debug_file, key.debug_identifier, "");
+
+  if (!store->Unpublish(&module)) {
+    fprintf(stderr, "symbol_daemon: %s %s was not published\n",
+            key.debug_file.c_str(), key.debug_identifier.c_str());
+    return false;
+  }
+  printf("symbol_daemon: unpublished %s %s\n",
+         key.debug_file.c_str(), key.debug_identifier.c_str());
+  return true;
+}
+
+void Usage(const char *program_name) {
+  fprintf(stderr,
+          "usage: %s [-n name-prefix] [-u | -o] <symbol-file> ...\n"
+          "  -n  shared-memory name prefix (default %s);\n"
+          "      processors must attach with the same prefix\n"
+          "  -u  unpublish the segments for the given symbol files\n"
+          "      instead of publishing them\n"
+          "  -o  stay resident as the segments' owner and unpublish\n"
+          "      them on SIGINT or SIGTERM; by default segments\n"
+          "      persist after this tool exits\n",
+          program_name, kDefaultNamePrefix);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  string name_prefix = kDefaultNamePrefix;
+  bool unpublish = false;
+  bool own = false;
+
+  int argi = 1;
+  while (argi < argc && argv[argi][0] == '-') {
+    if (!strcmp(argv[argi], "-n") && argi + 1 < argc) {
+      name_prefix = argv[++argi];
+    } else if (!strcmp(argv[argi], "-u")) {
+      unpublish = true;
+    } else if (!strcmp(argv[argi], "-o")) {
+      own = true;
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+    ++argi;
+  }
+  if (argi >= argc || (unpublish && own)) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  SharedModuleStore store(name_prefix);
+  vector<ModuleKey> published;
+
+  bool all_ok = true;
+  for (; argi < argc; ++argi) {
+    if (unpublish) {
+      if (!UnpublishSymbolFile(argv[argi], &store)) {
+        all_ok = false;
+      }
+    } else if (!PublishSymbolFile(argv[argi], &store, &published)) {
+      all_ok = false;
+    }
+  }
+
+  if (own && !published.empty()) {
+    signal(SIGINT, ShutdownHandler);
+    signal(SIGTERM, ShutdownHandler);
+    printf("symbol_daemon: owning %lu segments until SIGINT or SIGTERM\n",
+           static_cast<unsigned long>(published.size()));
+    while (!g_shutdown) {
+      pause();
+    }
+    for (vector<ModuleKey>::const_iterator iterator = published.begin();
+         iterator != published.end();
+         ++iterator) {
+      BasicCodeModule module(0, 0, iterator->debug_file, "",
+                             iterator->debug_file,
+                             iterator->debug_identifier, "");
+      store.Unpublish(&module);
+    }
+    printf("symbol_daemon: unpublished %lu segments\n",
+           static_cast<unsigned long>(published.size()));
+  }
+
+  return all_ok ? 0 : 1;
+}
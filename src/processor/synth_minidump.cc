@@ -41,10 +41,7 @@ Section::Section(const Dump &dump)
   : test_assembler::Section(dump.endianness()) { }
 
 void Section::CiteLocationIn(test_assembler::Section *section) const {
-  if (this)
-    (*section).D32(size_).D32(file_offset_);
-  else
-    (*section).D32(0).D32(0);
+  (*section).D32(size_).D32(file_offset_);
 }
 
 void Stream::CiteStreamIn(test_assembler::Section *section) const {
@@ -123,6 +120,32 @@ void Memory::CiteMemoryIn(test_assembler::Section *section) const {
   CiteLocationIn(section);
 }
 
+void Memory::CiteMemory64In(test_assembler::Section *section) const {
+  section->D64(address_);
+  section->D64(size_);
+}
+
+Memory64List::Memory64List(const Dump &dump)
+    : Stream(dump, MD_MEMORY_64_LIST_STREAM),
+      payload_(dump, &base_rva_),
+      count_(0) {
+  D64(count_label_);
+  D64(base_rva_);
+}
+
+void Memory64List::Add(Memory *range) {
+  range->CiteMemory64In(this);
+  payload_.Add(range);
+  count_++;
+}
+
+void Memory64List::AddRawDescriptor(uint64_t start_of_memory_range,
+                                    uint64_t data_size) {
+  D64(start_of_memory_range);
+  D64(data_size);
+  count_++;
+}
+
 Context::Context(const Dump &dump, const MDRawContextX86 &context)
   : Section(dump) {
   // The caller should have properly set the CPU type flag.
@@ -233,8 +256,14 @@ Module::Module(const Dump &dump,
   D32(version_info.file_subtype);
   D32(version_info.file_date_hi);
   D32(version_info.file_date_lo);
-  cv_record->CiteLocationIn(this);
-  misc_record->CiteLocationIn(this);
+  if (cv_record)
+    cv_record->CiteLocationIn(this);
+  else
+    D32(0).D32(0);
+  if (misc_record)
+    misc_record->CiteLocationIn(this);
+  else
+    D32(0).D32(0);
   D64(0).D64(0);
 }
 
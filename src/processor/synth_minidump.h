@@ -138,13 +138,11 @@ class Section: public test_assembler::Section {
   explicit Section(const Dump &dump);
 
   // Append an MDLocationDescriptor referring to this section to SECTION.
-  // If 'this' is NULL, append a descriptor with a zero length and MDRVA.
-  //
-  // (I couldn't find the language in the C++ standard that says that
-  // invoking member functions of a NULL pointer to a class type is
-  // bad, if such language exists. Having this function handle NULL
-  // 'this' is convenient, but if it causes trouble, it's not hard to
-  // do differently.)
+  // Callers with an optional section (like Module's cv_record) must
+  // check for NULL themselves and append a zero length and MDRVA in
+  // that case; this used to be handled here by testing 'this' against
+  // NULL, but optimizing compilers delete that test as undefined
+  // behavior.
   void CiteLocationIn(test_assembler::Section *section) const;
 
   // Note that this section's contents are complete, and that it has
@@ -217,6 +215,11 @@ class Memory: public Section {
   // Append an MDMemoryDescriptor referring to this memory range to SECTION.
   void CiteMemoryIn(test_assembler::Section *section) const;
 
+  // Append an MDMemoryDescriptor64 referring to this memory range to
+  // SECTION.  Such descriptors carry no location; the range's contents
+  // must be placed in a MEMORY_64_LIST_STREAM's payload.
+  void CiteMemory64In(test_assembler::Section *section) const;
+
  private:
   // The process address from which these memory contents were taken.
   // Shouldn't this be a Label?
@@ -310,6 +313,78 @@ class List: public Stream {
   Label count_label_;
 };
 
+// A MEMORY_64_LIST_STREAM: a 64-bit region count and base_rva followed
+// by MDMemoryDescriptor64s, the format full-memory dumps from 64-bit
+// Windows use.  The descriptors carry no per-region location; the
+// regions' contents are concatenated, in descriptor order, in a
+// separate payload section that base_rva points to.  'Add' regions
+// here, then 'Add' this stream and its payload() to the dump --- the
+// payload's placement defines base_rva, so it may go anywhere:
+//
+//    Memory64List memory64_list(dump);
+//    Memory stack(dump, 0x569eb0a9);
+//    ... build contents of stack ...
+//    memory64_list.Add(&stack);
+//    dump.Add(&memory64_list);
+//    dump.Add(memory64_list.payload());
+//
+// Do not 'Add' the regions to the dump themselves: the payload carries
+// their contents, and Dump::Add(Memory *) would also cite them in the
+// 32-bit memory list.
+class Memory64List: public Stream {
+ public:
+  explicit Memory64List(const Dump &dump);
+
+  // Add RANGE to this list: append a descriptor for it to the stream,
+  // and its contents to the payload.
+  void Add(Memory *range);
+
+  // Append a descriptor with the given values and no corresponding
+  // payload bytes, for building descriptor lists the reader should
+  // reject.
+  void AddRawDescriptor(uint64_t start_of_memory_range, uint64_t data_size);
+
+  // The concatenation of the 'Add'ed regions' contents.  The caller
+  // must 'Add' this to the dump, even when it is empty, to place it
+  // and thereby define the stream's base_rva.
+  SynthMinidump::Section *payload() { return &payload_; }
+
+  // Finish up the contents of this section, mark it as having been
+  // placed at OFFSET.
+  virtual void Finish(const Label &offset) {
+    Stream::Finish(offset);
+    count_label_ = count_;
+  }
+
+ private:
+  // The payload section; placing it defines the base_rva it is handed.
+  class Payload: public SynthMinidump::Section {
+   public:
+    Payload(const Dump &dump, Label *base_rva)
+        : Section(dump), base_rva_(base_rva) { }
+
+    // Append RANGE's contents, telling it its position within this
+    // section's eventual place in the file.
+    void Add(Memory *range) {
+      range->Finish(file_offset_ + Size());
+      Append(*range);
+    }
+
+    virtual void Finish(const Label &offset) {
+      Section::Finish(offset);
+      *base_rva_ = offset;
+    }
+
+   private:
+    Label *base_rva_;
+  };
+
+  Payload payload_;
+  size_t count_;
+  Label count_label_;
+  Label base_rva_;
+};
+
 class Dump: public test_assembler::Section {
  public:
 
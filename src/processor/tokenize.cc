@@ -28,6 +28,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <string>
 #include <vector>
@@ -71,6 +74,72 @@ bool Tokenize(char *line,
   return tokens->size() == static_cast<unsigned int>(max_tokens);
 }
 
+// Returns the first space, CR, or LF in [position, end), or end if
+// there is none, comparing 16 bytes at a time where SSE2 is available.
+static char* FindDelimiter(char *position, char *end) {
+#ifdef __SSE2__
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  while (position + 16 <= end) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+    __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                                _mm_or_si128(_mm_cmpeq_epi8(chunk, cr),
+                                             _mm_cmpeq_epi8(chunk, lf)));
+    unsigned int hit_bits = _mm_movemask_epi8(hits);
+    if (hit_bits) {
+      return position + __builtin_ctz(hit_bits);
+    }
+    position += 16;
+  }
+#endif  // __SSE2__
+  while (position < end &&
+         *position != ' ' && *position != '\r' && *position != '\n') {
+    ++position;
+  }
+  return position;
+}
+
+bool TokenizeInPlace(char *line, int max_tokens, char **tokens) {
+  char *end = line + strlen(line);
+  char *position = line;
+  int token_count = 0;
+
+  while (token_count < max_tokens) {
+    while (position < end &&
+           (*position == ' ' || *position == '\r' || *position == '\n')) {
+      ++position;
+    }
+    if (position >= end) {
+      break;
+    }
+    tokens[token_count++] = position;
+
+    if (token_count == max_tokens) {
+      // The final token takes the remainder of the line; only trailing
+      // newline characters are trimmed.  Function and symbol names may
+      // contain embedded spaces.
+      char *token_end = end;
+      while (token_end > position &&
+             (token_end[-1] == '\r' || token_end[-1] == '\n')) {
+        --token_end;
+      }
+      *token_end = '\0';
+      break;
+    }
+
+    char *delimiter = FindDelimiter(position, end);
+    if (delimiter >= end) {
+      break;
+    }
+    *delimiter = '\0';
+    position = delimiter + 1;
+  }
+
+  return token_count == max_tokens;
+}
+
 void StringToVector(const string &str, vector<char> &vec) {
   vec.resize(str.length() + 1);
   std::copy(str.begin(), str.end(),
@@ -54,6 +54,16 @@ bool Tokenize(char *line,
               const char *separators,
               int max_tokens,
               std::vector<char*> *tokens);
+
+// Like Tokenize with separators " \r\n", but scans for delimiters with
+// SIMD compares where available and writes the token pointers into
+// tokens, a caller-provided array of at least max_tokens elements, so
+// per-line calls allocate nothing.  Runs of separators are skipped; the
+// final token takes the remainder of the line (it may contain embedded
+// spaces), trimmed of any trailing newline characters.  This modifies
+// line as a side effect.  Returns true if exactly max_tokens tokens are
+// found.
+bool TokenizeInPlace(char *line, int max_tokens, char **tokens);
 // For convenience, since you need a char* to pass to Tokenize.
 // You can call StringToVector on a string, and use &vec[0].
 void StringToVector(const string &str, std::vector<char> &vec);
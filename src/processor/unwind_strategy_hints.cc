@@ -0,0 +1,192 @@
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// unwind_strategy_hints.cc: Per-module unwind strategy hint store.
+//
+// See unwind_strategy_hints.h for documentation.
+
+#include "processor/unwind_strategy_hints.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "google_breakpad/processor/code_module.h"
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+// The first line of a saved hint store: a tag and a format version.
+static const char kHintFileHeader[] = "UNWIND_HINTS 1";
+
+UnwindStrategyHints::ModuleHints::ModuleHints() {
+  for (int strategy = 0; strategy < STRATEGY_COUNT; ++strategy) {
+    attempts[strategy] = 0;
+    successes[strategy] = 0;
+  }
+}
+
+UnwindStrategyHints::UnwindStrategyHints() : hints_() {
+#ifndef _WIN32
+  pthread_mutex_init(&lock_, NULL);
+#endif
+}
+
+UnwindStrategyHints::~UnwindStrategyHints() {
+#ifndef _WIN32
+  pthread_mutex_destroy(&lock_);
+#endif
+}
+
+void UnwindStrategyHints::RecordAttempt(const CodeModule* module,
+                                        Strategy strategy,
+                                        bool success) {
+  string key = KeyForModule(module);
+  if (key.empty())
+    return;
+
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  ModuleHints& module_hints = hints_[key];
+  ++module_hints.attempts[strategy];
+  if (success)
+    ++module_hints.successes[strategy];
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+}
+
+bool UnwindStrategyHints::ShouldTry(const CodeModule* module,
+                                    Strategy strategy) {
+  string key = KeyForModule(module);
+  if (key.empty())
+    return true;
+
+  bool should_try = true;
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  std::map<string, ModuleHints>::const_iterator iterator = hints_.find(key);
+  if (iterator != hints_.end()) {
+    const ModuleHints& module_hints = iterator->second;
+    should_try = module_hints.successes[strategy] != 0 ||
+                 module_hints.attempts[strategy] < kMinAttemptsToSkip;
+  }
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+
+  return should_try;
+}
+
+bool UnwindStrategyHints::Save(const string& path) {
+  std::ofstream file(path.c_str());
+  if (!file.good()) {
+    BPLOG(ERROR) << "UnwindStrategyHints could not write " << path;
+    return false;
+  }
+
+  file << kHintFileHeader << "\n";
+
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  for (std::map<string, ModuleHints>::const_iterator iterator =
+           hints_.begin();
+       iterator != hints_.end();
+       ++iterator) {
+    file << iterator->first;
+    for (int strategy = 0; strategy < STRATEGY_COUNT; ++strategy) {
+      file << " " << iterator->second.attempts[strategy] <<
+              " " << iterator->second.successes[strategy];
+    }
+    file << "\n";
+  }
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+
+  file.close();
+  return file.good();
+}
+
+bool UnwindStrategyHints::Load(const string& path) {
+  std::ifstream file(path.c_str());
+  if (!file.good()) {
+    BPLOG(INFO) << "UnwindStrategyHints could not read " << path;
+    return false;
+  }
+
+  string line;
+  if (!std::getline(file, line) || line != kHintFileHeader) {
+    BPLOG(ERROR) << "UnwindStrategyHints found bad header in " << path;
+    return false;
+  }
+
+#ifndef _WIN32
+  pthread_mutex_lock(&lock_);
+#endif
+  while (std::getline(file, line)) {
+    if (line.empty())
+      continue;
+
+    std::istringstream stream(line);
+    string key;
+    ModuleHints parsed;
+    stream >> key;
+    for (int strategy = 0; strategy < STRATEGY_COUNT; ++strategy) {
+      stream >> parsed.attempts[strategy] >> parsed.successes[strategy];
+    }
+    if (stream.fail() || key.empty()) {
+      BPLOG(ERROR) << "UnwindStrategyHints found bad line in " << path <<
+                      ": " << line;
+      continue;
+    }
+
+    ModuleHints& module_hints = hints_[key];
+    for (int strategy = 0; strategy < STRATEGY_COUNT; ++strategy) {
+      module_hints.attempts[strategy] += parsed.attempts[strategy];
+      module_hints.successes[strategy] += parsed.successes[strategy];
+    }
+  }
+#ifndef _WIN32
+  pthread_mutex_unlock(&lock_);
+#endif
+
+  return true;
+}
+
+// static
+string UnwindStrategyHints::KeyForModule(const CodeModule* module) {
+  if (!module)
+    return string();
+  return module->debug_identifier();
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,136 @@
+// -*- mode: c++ -*-
+
+// Copyright (c) 2013 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// unwind_strategy_hints.h: UnwindStrategyHints remembers, per module,
+// which unwind strategies pay off.
+//
+// For a given module version the winning strategy in the x86 stack
+// walker (Windows frame info vs DWARF CFI vs %ebp chain vs scanning) is
+// highly stable, yet every dump rediscovers it frame by frame.  A batch
+// session can share one UnwindStrategyHints across dumps through its
+// StackFrameSymbolizer (see set_unwind_strategy_hints): the walker
+// records each attempt's outcome here and, once a lookup-backed
+// strategy has accumulated many attempts against a module without a
+// single success, skips that lookup for the module's frames on later
+// dumps.  The store can be saved to and reloaded from a text file,
+// carrying what was learned across sessions.
+
+#ifndef PROCESSOR_UNWIND_STRATEGY_HINTS_H__
+#define PROCESSOR_UNWIND_STRATEGY_HINTS_H__
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include <map>
+#include <string>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+class CodeModule;
+
+class UnwindStrategyHints {
+ public:
+  enum Strategy {
+    STRATEGY_WINDOWS_FRAME_INFO = 0,
+    STRATEGY_CFI,
+    STRATEGY_EBP_CHAIN,
+    STRATEGY_SCAN,
+
+    // Not a strategy; the number of strategies above.
+    STRATEGY_COUNT
+  };
+
+  UnwindStrategyHints();
+  ~UnwindStrategyHints();
+
+  // Records one attempt at strategy for module's frames, and whether it
+  // produced a caller frame.  Modules without a debug identifier cannot
+  // be keyed and are not recorded; module may be NULL for frames
+  // outside any known module, which are not recorded either.  Thread
+  // safe against concurrent RecordAttempt and ShouldTry calls, so
+  // walkers on several worker threads may share one store.
+  void RecordAttempt(const CodeModule* module,
+                     Strategy strategy,
+                     bool success);
+
+  // Returns false if enough attempts at strategy have been recorded
+  // against module, none of them successful, that further attempts are
+  // considered doomed and worth skipping.  Returns true for NULL and
+  // unknown modules.
+  bool ShouldTry(const CodeModule* module, Strategy strategy);
+
+  // Writes the store to path as text, one module per line, replacing
+  // any existing file.  Returns false if the file cannot be written.
+  bool Save(const string& path);
+
+  // Merges the counts saved at path into this store, adding them to
+  // anything already recorded.  Returns false if the file cannot be
+  // read or is not a hint store.
+  bool Load(const string& path);
+
+ private:
+  // Per-module attempt and success counts, indexed by Strategy.
+  struct ModuleHints {
+    ModuleHints();
+
+    uint64_t attempts[STRATEGY_COUNT];
+    uint64_t successes[STRATEGY_COUNT];
+  };
+
+  // Failed attempts at a strategy before ShouldTry reports it as
+  // doomed.  High enough that one unlucky stack cannot blacklist a
+  // strategy, low enough to save most of the lookups on an FPO-heavy
+  // module during a large batch.
+  static const uint64_t kMinAttemptsToSkip = 64;
+
+  // Returns the key hints for module are stored under - its debug
+  // identifier - or the empty string if the module cannot be keyed.
+  static string KeyForModule(const CodeModule* module);
+
+  std::map<string, ModuleHints> hints_;
+
+#ifndef _WIN32
+  // Serializes access to hints_ across walker threads.
+  pthread_mutex_t lock_;
+#endif
+
+  // Disallow unwanted copy ctor and assignment operator.
+  UnwindStrategyHints(const UnwindStrategyHints&);
+  void operator=(const UnwindStrategyHints&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_UNWIND_STRATEGY_HINTS_H__
@@ -46,7 +46,9 @@
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
+#include "processor/linked_ptr.h"
 #include "processor/logging.h"
+#include "processor/postfix_program.h"
 #include "processor/tokenize.h"
 
 namespace google_breakpad {
@@ -86,7 +88,9 @@ struct WindowsFrameInfo {
                      local_size(0),
                      max_stack_size(0),
                      allocates_base_pointer(0),
-                     program_string() {}
+                     program_string(),
+                     program(NULL),
+                     program_cache() {}
 
   WindowsFrameInfo(StackInfoTypes type,
                  uint32_t set_prolog_size,
@@ -106,7 +110,11 @@ struct WindowsFrameInfo {
         local_size(set_local_size),
         max_stack_size(set_max_stack_size),
         allocates_base_pointer(set_allocates_base_pointer),
-        program_string(set_program_string) {}
+        program_string(set_program_string),
+        program(NULL),
+        program_cache(set_program_string.empty() ?
+                          static_cast<PostfixProgramCache*>(NULL) :
+                          new PostfixProgramCache()) {}
 
   // Parse a textual serialization of a WindowsFrameInfo object from
   // a string. Returns NULL if parsing fails, or a new object
@@ -171,14 +179,25 @@ struct WindowsFrameInfo {
     max_stack_size = that.max_stack_size;
     allocates_base_pointer = that.allocates_base_pointer;
     program_string = that.program_string;
+    program = that.program;
+    program_cache = that.program_cache;
   }
 
   // Clears the WindowsFrameInfo object so that users will see it as though
-  // it contains no information.
+  // it contains no information, as if it were freshly constructed.
   void Clear() {
     type_ = STACK_INFO_UNKNOWN;
     valid = VALID_NONE;
+    prolog_size = 0;
+    epilog_size = 0;
+    parameter_size = 0;
+    saved_register_size = 0;
+    local_size = 0;
+    max_stack_size = 0;
+    allocates_base_pointer = 0;
     program_string.erase();
+    program = NULL;
+    program_cache = linked_ptr<PostfixProgramCache>();
   }
 
   StackInfoTypes type_;
@@ -201,6 +220,21 @@ struct WindowsFrameInfo {
   // If program_string is empty, use allocates_base_pointer.
   bool allocates_base_pointer;
   string program_string;
+
+  // The compiled form of program_string, not owned, or NULL.  A
+  // resolver sets this on entries it returns, pointing at the compiled
+  // program its module owns; it stays valid while that module is
+  // loaded.  Unlike program_cache, a plain pointer is safe to carry to
+  // another thread, so this is how compiled programs cross the
+  // symbolizer's lock.
+  const PostfixProgram *program;
+
+  // The lazily compiled form of program_string, shared among copies of
+  // this entry so each program string is compiled at most once.  NULL
+  // when there is no program string.  Sharing through a linked_ptr is
+  // not thread-safe, so entries a resolver returns detach from the
+  // cache and use program, above, instead.  See PostfixProgramCache.
+  linked_ptr<PostfixProgramCache> program_cache;
 };
 
 }  // namespace google_breakpad
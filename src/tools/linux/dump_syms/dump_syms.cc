@@ -27,49 +27,399 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <dirent.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "common/linux/dump_symbols.h"
+#include "common/scoped_ptr.h"
+#include "processor/module_serializer.h"
 
+using google_breakpad::ModuleSerializer;
+using google_breakpad::ReadModuleIdentifier;
 using google_breakpad::WriteSymbolFile;
+using google_breakpad::WriteSymbolFileStreaming;
+using google_breakpad::scoped_array;
 
 int usage(const char* self) {
   fprintf(stderr, "Usage: %s [OPTION] <binary-with-debugging-info> "
+          "[directories-for-debug-file]\n", self);
+  fprintf(stderr, "       %s [OPTION] -m <manifest-or-directory> "
           "[directories-for-debug-file]\n\n", self);
   fprintf(stderr, "Options:\n");
-  fprintf(stderr, "  -c    Do not generate CFI section\n");
+  fprintf(stderr, "  -c         Do not generate CFI section\n");
+  fprintf(stderr, "  -s         Stream records out as they are read, "
+          "bounding memory use\n");
+  fprintf(stderr, "  -b         Write the serialized binary symbol format "
+          "that the processor's fast\n");
+  fprintf(stderr, "             resolver loads without parsing, instead of "
+          "symbol text. Output files\n");
+  fprintf(stderr, "             are named <basename>.symc. "
+          "Incompatible with -s.\n");
+  fprintf(stderr, "  -m <path>  Convert several binaries in one run: "
+          "<path> is a file listing one\n");
+  fprintf(stderr, "             binary per line, or a directory whose "
+          "regular files are the binaries.\n");
+  fprintf(stderr, "             Each binary's output goes to "
+          "<output-dir>/<basename>.sym.\n");
+  fprintf(stderr, "  -o <dir>   Output directory for -m "
+          "(default: current directory)\n");
+  fprintf(stderr, "  -j <n>     Number of worker threads for -m "
+          "(default: number of CPUs)\n");
+  fprintf(stderr, "  -C <dir>   Cache converted symbol files in <dir>, "
+          "keyed by debug identifier;\n");
+  fprintf(stderr, "             emit the cached copy instead of parsing "
+          "when the binary is unchanged.\n");
   return 1;
 }
 
+namespace {
+
+// The list of binaries still to be converted in batch (-m) mode,
+// shared by the worker threads, along with the settings that apply to
+// every conversion. Workers synchronize only to claim the next binary
+// and to record failures; each conversion writes to its own file.
+struct ConversionQueue {
+  std::vector<string> binaries;
+  std::vector<string> debug_dirs;
+  string output_dir;
+  string cache_dir;  // empty when caching is disabled
+  SymbolData symbol_data;
+  bool streaming;
+  bool binary_format;
+
+  // Index of the next unclaimed entry of |binaries| and whether any
+  // conversion has failed so far, both guarded by |mutex|.
+  size_t next_binary;
+  bool any_failed;
+  pthread_mutex_t mutex;
+};
+
+// Return PATH with any leading directory components removed.
+string BaseName(const string& path) {
+  string::size_type slash = path.rfind('/');
+  return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+// Append the contents of PATH to STREAM. Return true on success.
+bool AppendFileContents(const string& path, std::ostream& stream) {
+  std::ifstream file(path.c_str());
+  if (!file.is_open())
+    return false;
+  stream << file.rdbuf();
+  return !stream.fail();
+}
+
+// Write BINARY's symbols to STREAM as a serialized module container
+// (see processor/serialized_module_format.h), which the processor's
+// FastSourceLineResolver loads without parsing. The symbol data is
+// rendered to text in memory and serialized through ModuleSerializer,
+// so the container's byte layout has a single owner; the text never
+// touches disk and is never parsed again downstream. Return true on
+// success.
+bool WriteBinarySymbolFile(const string& binary,
+                           const std::vector<string>& debug_dirs,
+                           SymbolData symbol_data,
+                           std::ostream& stream) {
+  std::ostringstream text_stream;
+  if (!WriteSymbolFile(binary, debug_dirs, symbol_data, text_stream))
+    return false;
+
+  ModuleSerializer serializer;
+  unsigned int container_size = 0;
+  scoped_array<char> container(
+      serializer.SerializeSymbolFileDataToContainer(text_stream.str(),
+                                                    &container_size));
+  if (!container.get())
+    return false;
+  stream.write(container.get(), container_size);
+  return !stream.fail();
+}
+
+// Write BINARY's symbols to SYM_STREAM in the format selected by
+// BINARY_FORMAT and STREAMING. Return true on success.
+bool WriteSymbolData(const string& binary,
+                     const std::vector<string>& debug_dirs,
+                     SymbolData symbol_data,
+                     bool streaming,
+                     bool binary_format,
+                     std::ostream& sym_stream) {
+  if (binary_format)
+    return WriteBinarySymbolFile(binary, debug_dirs, symbol_data, sym_stream);
+  return streaming ?
+      WriteSymbolFileStreaming(binary, debug_dirs, symbol_data, sym_stream) :
+      WriteSymbolFile(binary, debug_dirs, symbol_data, sym_stream);
+}
+
+// Return the output extension for the selected format.
+const char* SymbolFileExtension(bool binary_format) {
+  return binary_format ? ".symc" : ".sym";
+}
+
+// Write BINARY's symbol file to SYM_STREAM, reusing the copy cached in
+// CACHE_DIR if BINARY's debug identifier has not changed since it was
+// made. On a miss, convert into the cache first --- via a temporary
+// file published with rename(), so concurrent workers never see a
+// partial entry --- and then emit the new copy. Return true on success.
+bool ConvertBinaryWithCache(const string& binary,
+                            const std::vector<string>& debug_dirs,
+                            SymbolData symbol_data,
+                            bool streaming,
+                            bool binary_format,
+                            const string& cache_dir,
+                            std::ostream& sym_stream) {
+  string identifier;
+  if (!ReadModuleIdentifier(binary, &identifier))
+    return false;
+
+  // The extension keeps text and binary entries for one identifier from
+  // satisfying each other's lookups.
+  string cached =
+      cache_dir + "/" + identifier + SymbolFileExtension(binary_format);
+  if (AppendFileContents(cached, sym_stream))
+    return true;
+
+  std::vector<char> temp_path(cached.begin(), cached.end());
+  const char suffix[] = ".XXXXXX";
+  temp_path.insert(temp_path.end(), suffix, suffix + sizeof(suffix));
+  int temp_fd = mkstemp(&temp_path[0]);
+  if (temp_fd < 0) {
+    fprintf(stderr, "Failed to create cache entry in '%s'.\n",
+            cache_dir.c_str());
+    return false;
+  }
+  close(temp_fd);
+
+  {
+    std::ios_base::openmode mode = std::ios_base::out | std::ios_base::trunc;
+    if (binary_format)
+      mode |= std::ios_base::binary;
+    std::ofstream temp_stream(&temp_path[0], mode);
+    bool result = WriteSymbolData(binary, debug_dirs, symbol_data,
+                                  streaming, binary_format, temp_stream);
+    if (!result || temp_stream.fail()) {
+      unlink(&temp_path[0]);
+      return false;
+    }
+  }
+  if (rename(&temp_path[0], cached.c_str()) != 0) {
+    unlink(&temp_path[0]);
+    return false;
+  }
+
+  return AppendFileContents(cached, sym_stream);
+}
+
+// Convert BINARY according to QUEUE's settings, writing the symbol
+// file to QUEUE->output_dir. Return true on success.
+bool ConvertBinary(const ConversionQueue* queue, const string& binary) {
+  string sym_path = queue->output_dir + "/" + BaseName(binary)
+      + SymbolFileExtension(queue->binary_format);
+  std::ios_base::openmode mode = std::ios_base::out | std::ios_base::trunc;
+  if (queue->binary_format)
+    mode |= std::ios_base::binary;
+  std::ofstream sym_stream(sym_path.c_str(), mode);
+  if (!sym_stream.is_open()) {
+    fprintf(stderr, "Failed to open output file '%s'.\n", sym_path.c_str());
+    return false;
+  }
+  bool result = !queue->cache_dir.empty() ?
+      ConvertBinaryWithCache(binary, queue->debug_dirs, queue->symbol_data,
+                             queue->streaming, queue->binary_format,
+                             queue->cache_dir, sym_stream) :
+      WriteSymbolData(binary, queue->debug_dirs, queue->symbol_data,
+                      queue->streaming, queue->binary_format, sym_stream);
+  if (!result)
+    fprintf(stderr, "Failed to write symbol file for '%s'.\n",
+            binary.c_str());
+  return result;
+}
+
+void* ConversionWorkerMain(void* arg) {
+  ConversionQueue* queue = static_cast<ConversionQueue*>(arg);
+  while (true) {
+    pthread_mutex_lock(&queue->mutex);
+    const size_t index = queue->next_binary++;
+    pthread_mutex_unlock(&queue->mutex);
+    if (index >= queue->binaries.size())
+      return NULL;
+
+    if (!ConvertBinary(queue, queue->binaries[index])) {
+      pthread_mutex_lock(&queue->mutex);
+      queue->any_failed = true;
+      pthread_mutex_unlock(&queue->mutex);
+    }
+  }
+}
+
+// Fill BINARIES with the binaries named by PATH: the regular files of
+// PATH if it is a directory, or the nonblank lines of PATH otherwise.
+// Return true on success.
+bool CollectBinaries(const string& path, std::vector<string>* binaries) {
+  struct stat path_stat;
+  if (stat(path.c_str(), &path_stat) != 0) {
+    fprintf(stderr, "Could not stat '%s'.\n", path.c_str());
+    return false;
+  }
+
+  if (S_ISDIR(path_stat.st_mode)) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+      fprintf(stderr, "Could not read directory '%s'.\n", path.c_str());
+      return false;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+      string entry_path = path + "/" + entry->d_name;
+      struct stat entry_stat;
+      if (stat(entry_path.c_str(), &entry_stat) == 0 &&
+          S_ISREG(entry_stat.st_mode))
+        binaries->push_back(entry_path);
+    }
+    closedir(dir);
+    return true;
+  }
+
+  std::ifstream manifest(path.c_str());
+  if (!manifest.is_open()) {
+    fprintf(stderr, "Could not read manifest '%s'.\n", path.c_str());
+    return false;
+  }
+  string line;
+  while (std::getline(manifest, line)) {
+    if (!line.empty())
+      binaries->push_back(line);
+  }
+  return true;
+}
+
+// Convert every binary named by MANIFEST on a pool of NUM_THREADS
+// worker threads. Return true if every conversion succeeded.
+bool ConvertManifest(const string& manifest,
+                     const std::vector<string>& debug_dirs,
+                     const string& output_dir,
+                     const string& cache_dir,
+                     SymbolData symbol_data,
+                     bool streaming,
+                     bool binary_format,
+                     long num_threads) {
+  ConversionQueue queue;
+  if (!CollectBinaries(manifest, &queue.binaries))
+    return false;
+  if (queue.binaries.empty()) {
+    fprintf(stderr, "No binaries to convert in '%s'.\n", manifest.c_str());
+    return false;
+  }
+  queue.debug_dirs = debug_dirs;
+  queue.output_dir = output_dir;
+  queue.cache_dir = cache_dir;
+  queue.symbol_data = symbol_data;
+  queue.streaming = streaming;
+  queue.binary_format = binary_format;
+  queue.next_binary = 0;
+  queue.any_failed = false;
+  pthread_mutex_init(&queue.mutex, NULL);
+
+  if (num_threads <= 0)
+    num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_threads > static_cast<long>(queue.binaries.size()))
+    num_threads = queue.binaries.size();
+
+  // The main thread works the queue alongside num_threads - 1 helpers,
+  // so a failed pthread_create just means less parallelism.
+  std::vector<pthread_t> threads;
+  for (long i = 1; i < num_threads; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, ConversionWorkerMain, &queue))
+      break;
+    threads.push_back(thread);
+  }
+  ConversionWorkerMain(&queue);
+  for (size_t i = 0; i < threads.size(); i++)
+    pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&queue.mutex);
+
+  return !queue.any_failed;
+}
+
+}  // namespace
+
 int main(int argc, char **argv) {
-  if (argc < 2 || argc > 4)
+  if (argc < 2)
     return usage(argv[0]);
 
   bool cfi = true;
+  bool streaming = false;
+  bool binary_format = false;
+  string manifest;
+  string output_dir = ".";
+  string cache_dir;
+  long num_threads = 0;
   int binary_index = 1;
-  if (strcmp("-c", argv[1]) == 0) {
-    cfi = false;
+  while (binary_index < argc && argv[binary_index][0] == '-') {
+    if (strcmp("-c", argv[binary_index]) == 0)
+      cfi = false;
+    else if (strcmp("-s", argv[binary_index]) == 0)
+      streaming = true;
+    else if (strcmp("-b", argv[binary_index]) == 0)
+      binary_format = true;
+    else if (strcmp("-m", argv[binary_index]) == 0 &&
+             binary_index + 1 < argc)
+      manifest = argv[++binary_index];
+    else if (strcmp("-o", argv[binary_index]) == 0 &&
+             binary_index + 1 < argc)
+      output_dir = argv[++binary_index];
+    else if (strcmp("-j", argv[binary_index]) == 0 &&
+             binary_index + 1 < argc)
+      num_threads = atol(argv[++binary_index]);
+    else if (strcmp("-C", argv[binary_index]) == 0 &&
+             binary_index + 1 < argc)
+      cache_dir = argv[++binary_index];
+    else
+      return usage(argv[0]);
     ++binary_index;
   }
-  if (!cfi && argc == 2)
+  // Serializing needs the whole module in memory, which is exactly what
+  // streaming mode exists to avoid.
+  if (binary_format && streaming)
+    return usage(argv[0]);
+  // In batch mode, all remaining arguments are debug directories; in
+  // single-binary mode, the first names the binary itself.
+  if (binary_index >= argc && manifest.empty())
     return usage(argv[0]);
 
-  const char *binary;
+  const char *binary = NULL;
   std::vector<string> debug_dirs;
-  binary = argv[binary_index];
-  for (int debug_dir_index = binary_index + 1;
+  if (manifest.empty())
+    binary = argv[binary_index++];
+  for (int debug_dir_index = binary_index;
        debug_dir_index < argc;
        ++debug_dir_index) {
     debug_dirs.push_back(argv[debug_dir_index]);
   }
 
   SymbolData symbol_data = cfi ? ALL_SYMBOL_DATA : NO_CFI;
-  if (!WriteSymbolFile(binary, debug_dirs, symbol_data, std::cout)) {
+
+  if (!manifest.empty())
+    return ConvertManifest(manifest, debug_dirs, output_dir, cache_dir,
+                           symbol_data, streaming, binary_format,
+                           num_threads) ? 0 : 1;
+
+  bool result = !cache_dir.empty() ?
+      ConvertBinaryWithCache(binary, debug_dirs, symbol_data, streaming,
+                             binary_format, cache_dir, std::cout) :
+      WriteSymbolData(binary, debug_dirs, symbol_data, streaming,
+                      binary_format, std::cout);
+  if (!result) {
     fprintf(stderr, "Failed to write symbol file.\n");
     return 1;
   }
@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/user.h>
 #include <unistd.h>
 
@@ -87,6 +88,10 @@ using google_breakpad::MinidumpMemoryRange;
 static const MDRVA kInvalidMDRVA = static_cast<MDRVA>(-1);
 static bool verbose;
 
+// Whether the output is a regular file that zero ranges can be seeked
+// over, producing a sparse core.
+static bool out_seekable;
+
 static int usage(const char* argv0) {
   fprintf(stderr, "Usage: %s [-v] <minidump file>\n", argv0);
   return 1;
@@ -113,6 +118,27 @@ writea(int fd, const void* idata, size_t length) {
   return true;
 }
 
+// Emit |length| zero bytes on fd. On seekable output the range is
+// seeked over instead of written, leaving a hole in the core; the file
+// is extended to its final size at the end of main. Pipes get explicit
+// zeros. Return true iff successful.
+static bool
+writez(int fd, size_t length) {
+  if (!length)
+    return true;
+  if (out_seekable)
+    return lseek(fd, length, SEEK_CUR) != (off_t)-1;
+
+  static const char zeros[4096] = { 0 };
+  while (length) {
+    size_t chunk = length > sizeof(zeros) ? sizeof(zeros) : length;
+    if (!writea(fd, zeros, chunk))
+      return false;
+    length -= chunk;
+  }
+  return true;
+}
+
 /* Dynamically determines the byte sex of the system. Returns non-zero
  * for big-endian machines.
  */
@@ -186,13 +212,31 @@ struct CrashedProcess {
       : permissions(0xFFFFFFFF),
         start_address(0),
         end_address(0),
-        offset(0) {
+        offset(0),
+        borrowed_data(NULL),
+        borrowed_length(0),
+        leading_zeros(0),
+        trailing_zeros(0) {
     }
 
     uint32_t permissions;
     uint64_t start_address, end_address, offset;
     std::string filename;
+
+    // Contents written for this mapping, either borrowed from the
+    // memory-mapped minidump (borrowed_data/borrowed_length) or owned
+    // by the mapping (data, for synthesized contents such as the link
+    // map). Borrowing keeps large regions from being copied into
+    // memory before they are streamed out. At most one of the two is
+    // set.
     std::string data;
+    const uint8_t* borrowed_data;
+    size_t borrowed_length;
+
+    // Zero bytes emitted before and after the contents to keep the
+    // segment page-aligned; the writer emits them as holes.
+    size_t leading_zeros;
+    size_t trailing_zeros;
   };
   std::map<uint64_t, Mapping> mappings;
 
@@ -800,9 +844,25 @@ ParseModuleStream(CrashedProcess* crashinfo, const MinidumpMemoryRange& range,
   }
 }
 
+// Returns the number of bytes the given mapping contributes to the
+// core file, including the page-alignment zeros around its contents.
+static size_t
+MappingFileSize(const CrashedProcess::Mapping& mapping) {
+  return mapping.leading_zeros +
+         (mapping.borrowed_data ? mapping.borrowed_length
+                                : mapping.data.size()) +
+         mapping.trailing_zeros;
+}
+
+// Attach |length| bytes at |data| to the mapping containing |addr|. If
+// |copy_data| is set the bytes are copied into the mapping (for
+// synthesized buffers that do not outlive their scope); otherwise the
+// mapping just borrows the pointer, which must stay valid until the
+// core has been written - in practice, a range of the memory-mapped
+// minidump.
 static void
-AddDataToMapping(CrashedProcess* crashinfo, const std::string& data,
-                 uintptr_t addr) {
+AddDataToMapping(CrashedProcess* crashinfo, const uint8_t* data,
+                 size_t length, bool copy_data, uintptr_t addr) {
   for (std::map<uint64_t, CrashedProcess::Mapping>::iterator
          iter = crashinfo->mappings.begin();
        iter != crashinfo->mappings.end();
@@ -832,8 +892,17 @@ AddDataToMapping(CrashedProcess* crashinfo, const std::string& data,
       // file. But it is OK if the mapping itself extends past the end of
       // the data.
       mapping.start_address = addr & ~4095;
-      mapping.data.assign(addr & 4095, 0).append(data);
-      mapping.data.append(-mapping.data.size() & 4095, 0);
+      mapping.leading_zeros = addr & 4095;
+      if (copy_data) {
+        mapping.data.assign(reinterpret_cast<const char*>(data), length);
+        mapping.borrowed_data = NULL;
+        mapping.borrowed_length = 0;
+      } else {
+        mapping.data.clear();
+        mapping.borrowed_data = data;
+        mapping.borrowed_length = length;
+      }
+      mapping.trailing_zeros = -(mapping.leading_zeros + length) & 4095;
       crashinfo->mappings[mapping.start_address] = mapping;
       return;
     }
@@ -843,9 +912,15 @@ AddDataToMapping(CrashedProcess* crashinfo, const std::string& data,
   mapping.permissions = PF_R | PF_W;
   mapping.start_address = addr & ~4095;
   mapping.end_address =
-    (addr + data.size() + 4095) & ~4095;
-  mapping.data.assign(addr & 4095, 0).append(data);
-  mapping.data.append(-mapping.data.size() & 4095, 0);
+    (addr + length + 4095) & ~4095;
+  mapping.leading_zeros = addr & 4095;
+  if (copy_data) {
+    mapping.data.assign(reinterpret_cast<const char*>(data), length);
+  } else {
+    mapping.borrowed_data = data;
+    mapping.borrowed_length = length;
+  }
+  mapping.trailing_zeros = -(mapping.leading_zeros + length) & 4095;
   crashinfo->mappings[mapping.start_address] = mapping;
 }
 
@@ -853,12 +928,13 @@ static void
 AugmentMappings(CrashedProcess* crashinfo,
                 const MinidumpMemoryRange& full_file) {
   // For each thread, find the memory mapping that matches the thread's stack.
-  // Then adjust the mapping to include the stack dump.
+  // Then adjust the mapping to include the stack dump. The stack bytes
+  // live in the memory-mapped minidump, so the mapping borrows them
+  // rather than copying.
   for (unsigned i = 0; i < crashinfo->threads.size(); ++i) {
     const CrashedProcess::Thread& thread = crashinfo->threads[i];
-    AddDataToMapping(crashinfo,
-                     std::string((char *)thread.stack, thread.stack_length),
-                     thread.stack_addr);
+    AddDataToMapping(crashinfo, thread.stack, thread.stack_length,
+                     false /* copy_data */, thread.stack_addr);
   }
 
   // Create a new link map with information about DSOs. We move this map to
@@ -906,7 +982,8 @@ AugmentMappings(CrashedProcess* crashinfo,
     data.append(filename);
     data.append(8 - (filename.size() & 7), 0);
   }
-  AddDataToMapping(crashinfo, data, start_addr);
+  AddDataToMapping(crashinfo, reinterpret_cast<const uint8_t*>(data.data()),
+                   data.size(), true /* copy_data */, start_addr);
 
   // Map the page containing the _DYNAMIC array
   if (!crashinfo->dynamic_data.empty()) {
@@ -932,8 +1009,11 @@ AugmentMappings(CrashedProcess* crashinfo,
         goto no_dt_debug;
       }
     }
-    AddDataToMapping(crashinfo, crashinfo->dynamic_data,
-                     (uintptr_t)crashinfo->debug.dynamic);
+    AddDataToMapping(
+        crashinfo,
+        reinterpret_cast<const uint8_t*>(crashinfo->dynamic_data.data()),
+        crashinfo->dynamic_data.size(), true /* copy_data */,
+        (uintptr_t)crashinfo->debug.dynamic);
   }
 }
 
@@ -1029,6 +1109,13 @@ main(int argc, char** argv) {
 
   AugmentMappings(&crashinfo, dump);
 
+  // If the output is a regular file, zero ranges (alignment padding and
+  // absent pages) are seeked over rather than written, producing a
+  // sparse core.
+  struct stat out_stat;
+  out_seekable = fstat(1, &out_stat) == 0 && S_ISREG(out_stat.st_mode) &&
+                 lseek(1, 0, SEEK_CUR) != (off_t)-1;
+
   // Write the ELF header. The file will look like:
   //   ELF header
   //   Phdr for the PT_NOTE
@@ -1099,10 +1186,11 @@ main(int argc, char** argv) {
     }
     phdr.p_vaddr = mapping.start_address;
     phdr.p_memsz = mapping.end_address - mapping.start_address;
-    if (mapping.data.size()) {
+    size_t mapping_size = MappingFileSize(mapping);
+    if (mapping_size) {
       offset += filesz;
-      filesz = mapping.data.size();
-      phdr.p_filesz = mapping.data.size();
+      filesz = mapping_size;
+      phdr.p_filesz = mapping_size;
       phdr.p_offset = offset;
     } else {
       phdr.p_filesz = 0;
@@ -1112,6 +1200,10 @@ main(int argc, char** argv) {
       return 1;
   }
 
+  // Total size of the core file, needed to extend the output to its
+  // full size if it ends in a seeked-over hole.
+  const size_t total_size = offset + filesz;
+
   Nhdr nhdr;
   memset(&nhdr, 0, sizeof(nhdr));
   nhdr.n_namesz = 5;
@@ -1143,22 +1235,36 @@ main(int argc, char** argv) {
       WriteThread(crashinfo.threads[i], 0);
   }
 
-  if (note_align) {
-    google_breakpad::scoped_array<char> scratch(new char[note_align]);
-    memset(scratch.get(), 0, note_align);
-    if (!writea(1, scratch.get(), note_align))
-      return 1;
-  }
+  if (!writez(1, note_align))
+    return 1;
 
+  // Stream the contents of each mapping straight from the memory-mapped
+  // minidump (or the small synthesized buffers), emitting the
+  // page-alignment zeros around them as holes. Nothing larger than one
+  // region is ever held in memory.
   for (std::map<uint64_t, CrashedProcess::Mapping>::const_iterator iter =
          crashinfo.mappings.begin();
        iter != crashinfo.mappings.end(); ++iter) {
     const CrashedProcess::Mapping& mapping = iter->second;
-    if (mapping.data.size()) {
+    if (!MappingFileSize(mapping))
+      continue;
+    if (!writez(1, mapping.leading_zeros))
+      return 1;
+    if (mapping.borrowed_data) {
+      if (!writea(1, mapping.borrowed_data, mapping.borrowed_length))
+        return 1;
+    } else if (mapping.data.size()) {
       if (!writea(1, mapping.data.c_str(), mapping.data.size()))
         return 1;
     }
+    if (!writez(1, mapping.trailing_zeros))
+      return 1;
   }
 
+  // A core ending in a hole would otherwise come up short; extend the
+  // file to its full size.
+  if (out_seekable && ftruncate(1, total_size) != 0)
+    return 1;
+
   return 0;
 }
@@ -54,11 +54,15 @@
 using google_breakpad::HTTPUpload;
 
 typedef struct {
-  std::string symbolsPath;
+  std::vector<std::string> symbolsPaths;
   std::string uploadURLStr;
+  std::string checkURLStr;
   std::string proxy;
   std::string proxy_user_pwd;
   std::string version;
+  int jobs;
+  int retries;
+  bool compress;
   bool success;
 } Options;
 
@@ -116,33 +120,50 @@ static std::string CompactIdentifier(const std::string &uuid) {
 }
 
 //=============================================================================
-static void Start(Options *options) {
-  std::map<std::string, std::string> parameters;
-  options->success = false;
+// Fill in the upload parameters for one symbol file, from its MODULE
+// line and the command-line options.  Returns false if the file's
+// MODULE line cannot be parsed.
+static bool ParametersForSymbolFile(
+    const Options *options,
+    const std::string &symbols_path,
+    std::map<std::string, std::string> *parameters) {
   std::vector<std::string> module_parts;
-  if (!ModuleDataForSymbolFile(options->symbolsPath, &module_parts)) {
-    fprintf(stderr, "Failed to parse symbol file!\n");
-    return;
+  if (!ModuleDataForSymbolFile(symbols_path, &module_parts)) {
+    fprintf(stderr, "Failed to parse symbol file %s!\n",
+            symbols_path.c_str());
+    return false;
   }
 
   std::string compacted_id = CompactIdentifier(module_parts[3]);
 
   // Add parameters
   if (!options->version.empty())
-    parameters["version"] = options->version;
+    (*parameters)["version"] = options->version;
 
   // MODULE <os> <cpu> <uuid> <module-name>
   // 0      1    2     3      4
-  parameters["os"] = module_parts[1];
-  parameters["cpu"] = module_parts[2];
-  parameters["debug_file"] = module_parts[4];
-  parameters["code_file"] = module_parts[4];
-  parameters["debug_identifier"] = compacted_id;
+  (*parameters)["os"] = module_parts[1];
+  (*parameters)["cpu"] = module_parts[2];
+  (*parameters)["debug_file"] = module_parts[4];
+  (*parameters)["code_file"] = module_parts[4];
+  (*parameters)["debug_identifier"] = compacted_id;
+  return true;
+}
+
+//=============================================================================
+static void Start(Options *options) {
+  std::map<std::string, std::string> parameters;
+  options->success = false;
+  if (!ParametersForSymbolFile(options, options->symbolsPaths[0],
+                               &parameters)) {
+    return;
+  }
+
   std::string response, error;
   long response_code;
   bool success = HTTPUpload::SendRequest(options->uploadURLStr,
                                          parameters,
-                                         options->symbolsPath,
+                                         options->symbolsPaths[0],
                                          "symbol_file",
                                          options->proxy,
                                          options->proxy_user_pwd,
@@ -167,17 +188,99 @@ static void Start(Options *options) {
   options->success = success;
 }
 
+//=============================================================================
+// Upload every symbol file in one SendBatch call, so connections are
+// reused, uploads run in parallel, and transient failures retry.
+static void StartBatch(Options *options) {
+  options->success = false;
+
+  std::vector<HTTPUpload::UploadItem> items;
+  for (size_t path_index = 0;
+       path_index < options->symbolsPaths.size();
+       ++path_index) {
+    HTTPUpload::UploadItem item;
+    item.upload_file = options->symbolsPaths[path_index];
+    if (!ParametersForSymbolFile(options, item.upload_file,
+                                 &item.parameters)) {
+      return;
+    }
+    items.push_back(item);
+  }
+
+  // Ask the server which symbols it already has, and upload only the
+  // missing ones.  Most builds change few modules, so this typically
+  // skips nearly every file.  If the query fails (for instance, the
+  // server has no presence endpoint), upload everything as before.
+  if (!options->checkURLStr.empty()) {
+    size_t total_count = items.size();
+    size_t skipped_count = 0;
+    if (HTTPUpload::FilterPresentSymbols(options->checkURLStr,
+                                         options->proxy,
+                                         options->proxy_user_pwd,
+                                         "",
+                                         &items,
+                                         &skipped_count)) {
+      printf("Server already has %lu of %lu symbol files.\n",
+             static_cast<unsigned long>(skipped_count),
+             static_cast<unsigned long>(total_count));
+      if (items.empty()) {
+        options->success = true;
+        return;
+      }
+    } else {
+      printf("Symbol presence check failed; uploading all files.\n");
+    }
+  }
+
+  bool success = HTTPUpload::SendBatch(options->uploadURLStr,
+                                       "symbol_file",
+                                       options->proxy,
+                                       options->proxy_user_pwd,
+                                       "",
+                                       options->compress,
+                                       options->jobs,
+                                       options->retries,
+                                       &items);
+
+  for (size_t item_index = 0; item_index < items.size(); ++item_index) {
+    const HTTPUpload::UploadItem &item = items[item_index];
+    if (item.success && item.response_code == 200) {
+      printf("Successfully sent %s.\n", item.upload_file.c_str());
+    } else {
+      printf("Failed to send %s: %s (response code %ld)\n",
+             item.upload_file.c_str(),
+             item.error_description.c_str(),
+             item.response_code);
+      if (!item.response_body.empty()) {
+        printf("Response:\n");
+        printf("%s\n", item.response_body.c_str());
+      }
+    }
+  }
+  options->success = success;
+}
+
 //=============================================================================
 static void
 Usage(int argc, const char *argv[]) {
   fprintf(stderr, "Submit symbol information.\n");
-  fprintf(stderr, "Usage: %s [options...] <symbols> <upload-URL>\n", argv[0]);
+  fprintf(stderr, "Usage: %s [options...] <symbols...> <upload-URL>\n",
+          argv[0]);
   fprintf(stderr, "Options:\n");
   fprintf(stderr, "<symbols> should be created by using the dump_syms tool.\n");
+  fprintf(stderr, "Multiple symbol files are uploaded as one batch over\n");
+  fprintf(stderr, "reused connections.\n");
   fprintf(stderr, "<upload-URL> is the destination for the upload\n");
   fprintf(stderr, "-v:\t Version information (e.g., 1.2.3.4)\n");
+  fprintf(stderr, "-c:\t <check-URL> Ask this URL which symbols the server\n");
+  fprintf(stderr, "\t already has, and upload only the missing ones\n");
   fprintf(stderr, "-x:\t <host[:port]> Use HTTP proxy on given port\n");
   fprintf(stderr, "-u:\t <user[:password]> Set proxy user and password\n");
+  fprintf(stderr, "-j:\t <threads> Parallel uploads in batch mode "
+          "(default 4)\n");
+  fprintf(stderr, "-r:\t <retries> Retries per file on transient failures "
+          "(default 2)\n");
+  fprintf(stderr, "-z:\t gzip each symbol file before uploading it\n");
   fprintf(stderr, "-h:\t Usage\n");
   fprintf(stderr, "-?:\t Usage\n");
 }
@@ -188,8 +291,25 @@ SetupOptions(int argc, const char *argv[], Options *options) {
   extern int optind;
   char ch;
 
-  while ((ch = getopt(argc, (char * const *)argv, "u:v:x:h?")) != -1) {
+  options->jobs = 4;
+  options->retries = 2;
+  options->compress = false;
+
+  while ((ch = getopt(argc, (char * const *)argv, "c:j:r:u:v:x:zh?")) != -1) {
     switch (ch) {
+      case 'c':
+        options->checkURLStr = optarg;
+        break;
+      case 'j':
+        options->jobs = atoi(optarg);
+        if (options->jobs < 1)
+          options->jobs = 1;
+        break;
+      case 'r':
+        options->retries = atoi(optarg);
+        if (options->retries < 0)
+          options->retries = 0;
+        break;
       case 'u':
         options->proxy_user_pwd = optarg;
         break;
@@ -199,6 +319,9 @@ SetupOptions(int argc, const char *argv[], Options *options) {
       case 'x':
         options->proxy = optarg;
         break;
+      case 'z':
+        options->compress = true;
+        break;
 
       default:
         Usage(argc, argv);
@@ -207,20 +330,25 @@ SetupOptions(int argc, const char *argv[], Options *options) {
     }
   }
 
-  if ((argc - optind) != 2) {
+  if ((argc - optind) < 2) {
     fprintf(stderr, "%s: Missing symbols file and/or upload-URL\n", argv[0]);
     Usage(argc, argv);
     exit(1);
   }
 
-  options->symbolsPath = argv[optind];
-  options->uploadURLStr = argv[optind + 1];
+  for (int arg_index = optind; arg_index < argc - 1; ++arg_index)
+    options->symbolsPaths.push_back(argv[arg_index]);
+  options->uploadURLStr = argv[argc - 1];
 }
 
 //=============================================================================
 int main (int argc, const char * argv[]) {
   Options options;
   SetupOptions(argc, argv, &options);
-  Start(&options);
+  if (options.symbolsPaths.size() == 1 && !options.compress &&
+      options.checkURLStr.empty())
+    Start(&options);
+  else
+    StartBatch(&options);
   return options.success ? 0 : 1;
 }
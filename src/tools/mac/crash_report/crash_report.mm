@@ -118,10 +118,10 @@ static void PrintStack(const CallStack *stack, const string &cpu) {
       printf(" 0x%08llx ", instruction);
 
       // Function name
-      if (!frame->function_name.empty()) {
-        printf("%s", frame->function_name.c_str());
-        if (!frame->source_file_name.empty()) {
-          string source_file = PathnameStripper::File(frame->source_file_name);
+      if (frame->function_name && !frame->function_name->empty()) {
+        printf("%s", frame->function_name->c_str());
+        if (frame->source_file_name && !frame->source_file_name->empty()) {
+          string source_file = PathnameStripper::File(*frame->source_file_name);
           printf(" + 0x%llx (%s:%d)",
                  instruction - frame->source_line_base,
                  source_file.c_str(), frame->source_line);
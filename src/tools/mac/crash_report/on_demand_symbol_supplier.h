@@ -76,6 +76,12 @@ class OnDemandSymbolSupplier : public SymbolSupplier {
   string search_dir_;
   string symbol_search_dir_;
 
+  // Directory holding symbol files generated by earlier runs, keyed by
+  // Mach-O UUID.  Defaults to a per-user cache directory; override with
+  // the BREAKPAD_SYMBOL_CACHE environment variable.  Empty if the
+  // directory cannot be created, which disables the persistent cache.
+  string symbol_cache_dir_;
+
   // When we create a symbol file for a module, save the name of the module
   // and the path to that module's symbol file.
   map<string, string> module_file_map_;
@@ -99,6 +105,13 @@ class OnDemandSymbolSupplier : public SymbolSupplier {
   // returned, then |module| doesn't have a symbol file.
   string GetModuleSymbolFile(const CodeModule *module);
 
+  // Return the persistent cache path for |module|'s symbol file, keyed
+  // by the module's Mach-O UUID (its debug identifier in the dump), so
+  // different builds of the same framework never collide.  Returns an
+  // empty string if the module carries no identifier or the cache is
+  // disabled.
+  string GetSymbolCachePath(const CodeModule *module);
+
   // Generate the breakpad symbol file for |module|.  Return true if successful.
   // File is generated in /tmp.
   bool GenerateSymbolFile(const CodeModule *module,
@@ -54,6 +54,29 @@ OnDemandSymbolSupplier::OnDemandSymbolSupplier(const string &search_dir,
                                                const string &symbol_search_dir)
   : search_dir_(search_dir) {
   NSFileManager *mgr = [NSFileManager defaultManager];
+
+  // Set up the persistent symbol cache.  Symbol files generated by
+  // earlier invocations live here keyed by Mach-O UUID, so triaging a
+  // batch of dumps against the same build only dumps each framework
+  // once.
+  const char *cache_override = getenv("BREAKPAD_SYMBOL_CACHE");
+  NSString *cachePath;
+  if (cache_override && cache_override[0]) {
+    cachePath = [mgr stringWithFileSystemRepresentation:cache_override
+                                                 length:strlen(cache_override)];
+  } else {
+    cachePath = [NSHomeDirectory()
+      stringByAppendingPathComponent:@"Library/Caches/com.google.Breakpad.crash_report"];
+  }
+  BOOL isDir;
+  BOOL haveCacheDir = [mgr fileExistsAtPath:cachePath isDirectory:&isDir] ?
+    isDir : [mgr createDirectoryAtPath:cachePath
+           withIntermediateDirectories:YES
+                            attributes:nil
+                                 error:nil];
+  if (haveCacheDir)
+    symbol_cache_dir_ = [cachePath fileSystemRepresentation];
+
   size_t length = symbol_search_dir.length();
   if (length) {
     // Load all sym files in symbol_search_dir into our module_file_map
@@ -237,8 +260,40 @@ string OnDemandSymbolSupplier::GetNameForModule(const CodeModule *module) {
 string OnDemandSymbolSupplier::GetModuleSymbolFile(const CodeModule *module) {
   string name(GetNameForModule(module));
   map<string, string>::iterator result = module_file_map_.find(name);
+  if (result != module_file_map_.end())
+    return (*result).second;
+
+  // Not seen this run; check whether an earlier run already generated
+  // symbols for this exact build.
+  string cache_path = GetSymbolCachePath(module);
+  if (!cache_path.empty()) {
+    NSFileManager *mgr = [NSFileManager defaultManager];
+    const char *cachePathStr = cache_path.c_str();
+    NSString *cachePath =
+      [mgr stringWithFileSystemRepresentation:cachePathStr
+                                       length:strlen(cachePathStr)];
+    if ([mgr fileExistsAtPath:cachePath]) {
+      module_file_map_[name] = cache_path;
+      return cache_path;
+    }
+  }
 
-  return (result == module_file_map_.end()) ? "" : (*result).second;
+  return "";
+}
+
+string OnDemandSymbolSupplier::GetSymbolCachePath(const CodeModule *module) {
+  if (symbol_cache_dir_.empty())
+    return "";
+
+  // The debug identifier is the module's Mach-O UUID as recorded in the
+  // dump, so it changes with every build; a cache entry can never be
+  // stale, only absent.
+  string identifier = module->debug_identifier();
+  if (identifier.empty())
+    return "";
+
+  return symbol_cache_dir_ + "/" + identifier + "-" +
+    GetNameForModule(module) + ".sym";
 }
 
 static float GetFileModificationTime(const char *path) {
@@ -256,24 +311,44 @@ bool OnDemandSymbolSupplier::GenerateSymbolFile(const CodeModule *module,
   bool result = true;
   string name = GetNameForModule(module);
   string module_path = GetLocalModulePath(module);
-  NSString *symbol_path = [NSString stringWithFormat:@"/tmp/%s.%s.sym",
-    name.c_str(), system_info->cpu.c_str()];
+
+  // Generate into the persistent UUID-keyed cache when it is available,
+  // so the work survives this invocation; fall back on the old
+  // name-keyed file in /tmp when the module has no identifier.
+  string cache_path = GetSymbolCachePath(module);
+  NSString *symbol_path;
+  if (!cache_path.empty()) {
+    const char *cachePathStr = cache_path.c_str();
+    symbol_path =
+      [[NSFileManager defaultManager]
+        stringWithFileSystemRepresentation:cachePathStr
+                                    length:strlen(cachePathStr)];
+  } else {
+    symbol_path = [NSString stringWithFormat:@"/tmp/%s.%s.sym",
+      name.c_str(), system_info->cpu.c_str()];
+  }
 
   if (module_path.empty())
     return false;
 
-  // Check if there's already a symbol file cached.  Ensure that the file is
-  // newer than the module.  Otherwise, generate a new one.
+  // Check if there's already a symbol file cached.  A UUID-keyed file
+  // can only describe this exact build, so its existence is enough; for
+  // the /tmp fallback, ensure that the file is newer than the module.
+  // Otherwise, generate a new one.
   BOOL generate_file = YES;
   if ([[NSFileManager defaultManager] fileExistsAtPath:symbol_path]) {
-    // Check if the module file is newer than the saved symbols
-    float cache_time =
-      GetFileModificationTime([symbol_path fileSystemRepresentation]);
-    float module_time =
-      GetFileModificationTime(module_path.c_str());
-
-    if (cache_time > module_time)
+    if (!cache_path.empty()) {
       generate_file = NO;
+    } else {
+      // Check if the module file is newer than the saved symbols
+      float cache_time =
+        GetFileModificationTime([symbol_path fileSystemRepresentation]);
+      float module_time =
+        GetFileModificationTime(module_path.c_str());
+
+      if (cache_time > module_time)
+        generate_file = NO;
+    }
   }
 
   if (generate_file) {
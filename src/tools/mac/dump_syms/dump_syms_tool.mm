@@ -46,10 +46,11 @@ using google_breakpad::DumpSymbols;
 using std::vector;
 
 struct Options {
-  Options() : srcPath(), arch(), cfi(true) { }
+  Options() : srcPath(), arch(), cfi(true), allArchs(false) { }
   NSString *srcPath;
   const NXArchInfo *arch;
   bool cfi;
+  bool allArchs;
 };
 
 //=============================================================================
@@ -59,6 +60,12 @@ static bool Start(const Options &options) {
   if (!dump_symbols.Read(options.srcPath))
     return false;
 
+  if (options.allArchs) {
+    // Dump every slice of a fat binary concurrently; the symbol files
+    // appear on stdout one after another in architecture order.
+    return dump_symbols.WriteSymbolFilesForAllArchitectures(std::cout);
+  }
+
   if (options.arch) {
     if (!dump_symbols.SetArchitecture(options.arch->cputype,
                                       options.arch->cpusubtype)) {
@@ -92,10 +99,12 @@ static bool Start(const Options &options) {
 //=============================================================================
 static void Usage(int argc, const char *argv[]) {
   fprintf(stderr, "Output a Breakpad symbol file from a Mach-o file.\n");
-  fprintf(stderr, "Usage: %s [-a ARCHITECTURE] [-c] <Mach-o file>\n",
+  fprintf(stderr, "Usage: %s [-a ARCHITECTURE | -A] [-c] <Mach-o file>\n",
           argv[0]);
   fprintf(stderr, "\t-a: Architecture type [default: native, or whatever is\n");
   fprintf(stderr, "\t    in the file, if it contains only one architecture]\n");
+  fprintf(stderr, "\t-A: Dump all architectures in the file, in parallel,\n");
+  fprintf(stderr, "\t    writing the symbol files to stdout one after another\n");
   fprintf(stderr, "\t-c: Do not generate CFI section\n");
   fprintf(stderr, "\t-h: Usage\n");
   fprintf(stderr, "\t-?: Usage\n");
@@ -106,8 +115,11 @@ static void SetupOptions(int argc, const char *argv[], Options *options) {
   extern int optind;
   signed char ch;
 
-  while ((ch = getopt(argc, (char * const *)argv, "a:ch?")) != -1) {
+  while ((ch = getopt(argc, (char * const *)argv, "Aa:ch?")) != -1) {
     switch (ch) {
+      case 'A':
+        options->allArchs = true;
+        break;
       case 'a': {
         const NXArchInfo *arch_info =
             google_breakpad::BreakpadGetArchInfoFromName(optarg);
@@ -130,6 +142,12 @@ static void SetupOptions(int argc, const char *argv[], Options *options) {
     }
   }
 
+  if (options->allArchs && options->arch) {
+    fprintf(stderr, "%s: -A and -a are mutually exclusive\n", argv[0]);
+    Usage(argc, argv);
+    exit(1);
+  }
+
   if ((argc - optind) != 1) {
     fprintf(stderr, "Must specify Mach-o file\n");
     Usage(argc, argv);
@@ -37,6 +37,8 @@
 #include <Windows.h>
 #include <DbgHelp.h>
 
+#include <process.h>
+
 #include <cassert>
 #include <cstdio>
 
@@ -426,6 +428,18 @@ MSSymbolServerConverter::LocateAndConvertSymbolFile(
     *symbol_file = pdb_file;
   }
 
+  return ConvertSymbolFile(missing, pdb_file, keep_symbol_file,
+                           converted_symbol_file);
+}
+
+MSSymbolServerConverter::LocateResult
+MSSymbolServerConverter::ConvertSymbolFile(const MissingSymbolInfo &missing,
+                                           const string &pdb_file,
+                                           bool keep_symbol_file,
+                                           string *converted_symbol_file) {
+  assert(converted_symbol_file);
+  converted_symbol_file->clear();
+
   // Conversion may fail because the file is corrupt.  If a broken file is
   // kept in the local cache, LocateSymbolFile will not hit the network again
   // to attempt to locate it.  To guard against problems like this, the
@@ -519,4 +533,147 @@ MSSymbolServerConverter::LocateAndConvertSymbolFile(
   return LOCATE_SUCCESS;
 }
 
+namespace {
+
+// Shared state for one LocateAndConvertSymbolFiles pipeline.  The
+// calling thread fetches pdb files and appends the index of each
+// successfully fetched job to |ready|; conversion workers claim
+// indices by advancing |next_ready|.  |ready_semaphore| is released
+// once per appended index, plus once per worker when fetching
+// finishes so that idle workers wake up, observe |fetch_done|, and
+// exit.  |lock| guards |ready|, |next_ready|, and |fetch_done|.
+struct ConversionPipeline {
+  MSSymbolServerConverter *converter;
+  vector<MSSymbolServerConverter::ConversionJob> *jobs;
+  vector<string> *pdb_files;  // Fetched pdb pathnames, parallel to |jobs|.
+  bool keep_symbol_files;
+  vector<size_t> ready;
+  size_t next_ready;
+  bool fetch_done;
+  CRITICAL_SECTION lock;
+  HANDLE ready_semaphore;
+};
+
+}  // namespace
+
+// static
+unsigned __stdcall MSSymbolServerConverter::ConversionWorkerMain(
+    void *context) {
+  ConversionPipeline *pipeline = static_cast<ConversionPipeline *>(context);
+
+  for (;;) {
+    WaitForSingleObject(pipeline->ready_semaphore, INFINITE);
+
+    size_t job_index = 0;
+    bool have_job = false;
+    EnterCriticalSection(&pipeline->lock);
+    if (pipeline->next_ready < pipeline->ready.size()) {
+      job_index = pipeline->ready[pipeline->next_ready++];
+      have_job = true;
+    }
+    bool fetch_done = pipeline->fetch_done;
+    LeaveCriticalSection(&pipeline->lock);
+
+    if (!have_job) {
+      if (fetch_done) {
+        return 0;
+      }
+      continue;
+    }
+
+    ConversionJob *job = &(*pipeline->jobs)[job_index];
+    job->result = pipeline->converter->ConvertSymbolFile(
+        job->missing,
+        (*pipeline->pdb_files)[job_index],
+        pipeline->keep_symbol_files,
+        &job->converted_symbol_file);
+  }
+}
+
+void MSSymbolServerConverter::LocateAndConvertSymbolFiles(
+    bool keep_symbol_files,
+    int conversion_threads,
+    vector<ConversionJob> *jobs) {
+  assert(jobs);
+  assert(conversion_threads > 0);
+
+  vector<string> pdb_files(jobs->size());
+
+  ConversionPipeline pipeline;
+  pipeline.converter = this;
+  pipeline.jobs = jobs;
+  pipeline.pdb_files = &pdb_files;
+  pipeline.keep_symbol_files = keep_symbol_files;
+  pipeline.next_ready = 0;
+  pipeline.fetch_done = false;
+  InitializeCriticalSection(&pipeline.lock);
+  pipeline.ready_semaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+
+  vector<HANDLE> workers;
+  if (pipeline.ready_semaphore) {
+    for (int thread_index = 0;
+         thread_index < conversion_threads;
+         ++thread_index) {
+      unsigned thread_id;
+      uintptr_t worker = _beginthreadex(NULL, 0, ConversionWorkerMain,
+                                        &pipeline, 0, &thread_id);
+      if (!worker) {
+        // Carry on with the workers that did start.  If none started at
+        // all, conversion runs serially on this thread below.
+        break;
+      }
+      workers.push_back(reinterpret_cast<HANDLE>(worker));
+    }
+  }
+
+  for (size_t job_index = 0; job_index < jobs->size(); ++job_index) {
+    ConversionJob *job = &(*jobs)[job_index];
+    job->converted_symbol_file.clear();
+    job->symbol_file.clear();
+
+    string pdb_file;
+    job->result = LocateSymbolFile(job->missing, &pdb_file);
+    if (job->result != LOCATE_SUCCESS) {
+      continue;
+    }
+
+    if (keep_symbol_files) {
+      job->symbol_file = pdb_file;
+    }
+
+    if (workers.empty()) {
+      job->result = ConvertSymbolFile(job->missing, pdb_file,
+                                      keep_symbol_files,
+                                      &job->converted_symbol_file);
+      continue;
+    }
+
+    pdb_files[job_index] = pdb_file;
+    EnterCriticalSection(&pipeline.lock);
+    pipeline.ready.push_back(job_index);
+    LeaveCriticalSection(&pipeline.lock);
+    ReleaseSemaphore(pipeline.ready_semaphore, 1, NULL);
+  }
+
+  if (!workers.empty()) {
+    EnterCriticalSection(&pipeline.lock);
+    pipeline.fetch_done = true;
+    LeaveCriticalSection(&pipeline.lock);
+    ReleaseSemaphore(pipeline.ready_semaphore,
+                     static_cast<LONG>(workers.size()), NULL);
+
+    for (size_t worker_index = 0;
+         worker_index < workers.size();
+         ++worker_index) {
+      WaitForSingleObject(workers[worker_index], INFINITE);
+      CloseHandle(workers[worker_index]);
+    }
+  }
+
+  if (pipeline.ready_semaphore) {
+    CloseHandle(pipeline.ready_semaphore);
+  }
+  DeleteCriticalSection(&pipeline.lock);
+}
+
 }  // namespace google_breakpad
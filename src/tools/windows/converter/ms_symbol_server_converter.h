@@ -168,7 +168,50 @@ class MSSymbolServerConverter {
                                           string *converted_symbol_file,
                                           string *symbol_file);
 
+  // One module in a LocateAndConvertSymbolFiles batch.  missing
+  // identifies the module to fetch, and is the only field the caller
+  // needs to set; the remaining fields are filled in as the pipeline
+  // completes the entry, with the same meanings as the corresponding
+  // LocateAndConvertSymbolFile arguments and return value.
+  struct ConversionJob {
+    MissingSymbolInfo missing;
+    LocateResult result;
+    string converted_symbol_file;
+    string symbol_file;
+  };
+
+  // Processes each entry in |jobs| as LocateAndConvertSymbolFile would,
+  // but pipelined: the calling thread works through the symbol-server
+  // lookups one at a time (DbgHelp is single-threaded, so fetches
+  // cannot overlap one another), while up to |conversion_threads|
+  // worker threads convert pdb files that have already been fetched.
+  // Fetching is network-bound and conversion is CPU-bound, so
+  // overlapping the two stages keeps both busy when working through a
+  // backlog of missing modules.  The SymCallback and
+  // SymFindFileInPathCallback progress reporting applies to the fetch
+  // stage exactly as it does in single-file operation.  If no worker
+  // threads can be created, conversion degrades to running serially on
+  // the calling thread between fetches.
+  void LocateAndConvertSymbolFiles(bool keep_symbol_files,
+                                   int conversion_threads,
+                                   vector<ConversionJob> *jobs);
+
  private:
+  // The conversion half of LocateAndConvertSymbolFile: converts the
+  // already-fetched |pdb_file| to the dumped-symbol format, stored
+  // adjacent to it, returning LOCATE_SUCCESS or LOCATE_FAILURE and
+  // observing the same local-cache cleanup rules.  Unlike
+  // LocateSymbolFile, this touches no object state, so several
+  // threads may call it concurrently.
+  LocateResult ConvertSymbolFile(const MissingSymbolInfo &missing,
+                                 const string &pdb_file,
+                                 bool keep_symbol_file,
+                                 string *converted_symbol_file);
+
+  // Thread entry point for LocateAndConvertSymbolFiles conversion
+  // workers.  context is the pipeline's shared ConversionPipeline.
+  static unsigned __stdcall ConversionWorkerMain(void *context);
+
   // Called by various SymSrv functions to report status as progress is made
   // and to allow the callback to influence processing.  Messages sent to this
   // callback can be used to distinguish between the various failure modes
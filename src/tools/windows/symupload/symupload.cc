@@ -154,32 +154,35 @@ static bool DumpSymbolsToTempFile(const wchar_t *file,
 }
 
 void printUsageAndExit() {
-  wprintf(L"Usage: symupload [--timeout NN] <file.exe|file.dll> <symbol upload URL>\n\n");
+  wprintf(L"Usage: symupload [--timeout NN] [--check URL] "
+          L"<file.exe|file.dll> <symbol upload URL>\n\n");
   wprintf(L"Timeout is in milliseconds, or can be 0 to be unlimited\n\n");
+  wprintf(L"--check asks the given URL whether the server already has\n");
+  wprintf(L"this module's symbols, and skips the upload if it does\n\n");
   wprintf(L"Example:\n\n\tsymupload.exe --timeout 0 chrome.dll http://no.free.symbol.server.for.you\n");
   exit(0);
 }
 int wmain(int argc, wchar_t *argv[]) {
-  if ((argc != 3) &&
-      (argc != 5)) {
-    printUsageAndExit();
-  }
-
-  const wchar_t *module, *url;
+  const wchar_t *check_url = NULL;
   int timeout = -1;
-  if (argc == 3) {
-    module = argv[1];
-    url = argv[2];
-  } else {
-    // check for timeout flag
-    if (!wcscmp(L"--timeout", argv[1])) {
-      timeout  = _wtoi(argv[2]);
-      module = argv[3];
-      url = argv[4];
+  int arg_index = 1;
+  while (arg_index < argc && wcsncmp(L"--", argv[arg_index], 2) == 0) {
+    if (!wcscmp(L"--timeout", argv[arg_index]) && arg_index + 1 < argc) {
+      timeout = _wtoi(argv[arg_index + 1]);
+      arg_index += 2;
+    } else if (!wcscmp(L"--check", argv[arg_index]) && arg_index + 1 < argc) {
+      check_url = argv[arg_index + 1];
+      arg_index += 2;
     } else {
       printUsageAndExit();
     }
   }
+  if (argc - arg_index != 2) {
+    printUsageAndExit();
+  }
+
+  const wchar_t *module = argv[arg_index];
+  const wchar_t *url = argv[arg_index + 1];
 
   wstring symbol_file;
   PDBModuleInfo pdb_info;
@@ -206,6 +209,28 @@ int wmain(int argc, wchar_t *argv[]) {
     fwprintf(stderr, L"Warning: Could not get file version for %s\n", module);
   }
 
+  // Ask the server whether it already has this module's symbols
+  // before sending them; most modules in a build are unchanged from
+  // the last upload.  If the query fails, upload unconditionally as
+  // before.
+  if (check_url) {
+    vector<HTTPUpload::UploadItem> items(1);
+    items[0].parameters = parameters;
+    items[0].upload_file = symbol_file;
+    size_t skipped_count = 0;
+    if (HTTPUpload::FilterPresentSymbols(check_url,
+                                         timeout == -1 ? NULL : &timeout,
+                                         &items,
+                                         &skipped_count) &&
+        items.empty()) {
+      _wunlink(symbol_file.c_str());
+      wprintf(L"Server already has symbols for windows-%s/%s/%s\n",
+              pdb_info.cpu.c_str(), pdb_info.debug_file.c_str(),
+              pdb_info.debug_identifier.c_str());
+      return 0;
+    }
+  }
+
   bool success = HTTPUpload::SendRequest(url, parameters,
                                          symbol_file, L"symbol_file",
 										 timeout == -1 ? NULL : &timeout,